@@ -0,0 +1,496 @@
+/*
+
+Measure the running time of code under repeatable conditions, so that changes
+to an implementation can be compared between versions. Since every file in this
+collection is self-contained, the harness below is meant to be pasted above the
+code being measured (or the code pasted above the Example Usage of a copy of
+this file), with the file's own main() replaced by benchmark cases.
+
+- rng(seed) constructs a xorshift64* pseudorandom generator, so that the same
+  seed yields the same inputs on every machine and compiler.
+  - next() returns a 64-bit unsigned value, below(n) returns an integer in
+    [0, n), and uniform() returns a double in [0, 1).
+- random_ints(n, pattern, seed) returns n integers in one of the patterns
+  RANDOM, SORTED, REVERSED, FEW_UNIQUE (at most 16 distinct values), or
+  NEARLY_SORTED (sorted, then with n/100 random swaps).
+- random_string(n, alphabet, seed) returns a string of n characters drawn
+  uniformly from the first alphabet lowercase letters.
+- random_graph(n, m, seed) returns m directed edges (u, v) with u != v between
+  n nodes, and grid_graph(r, c) returns the edges of an r by c grid in both
+  directions.
+- random_points(n, seed) returns n points uniform in the unit square, and
+  clustered_points(n, k, seed) returns n points normally distributed around k
+  random centers.
+- random_matrix(r, c, seed) returns an r by c matrix of doubles in [-1, 1).
+- benchmark(name, n, f, warmup, runs) times a case f, which must provide a
+  method setup() called untimed before each run, and a method run() returning a
+  long long checksum (which is accumulated so that the work cannot be optimized
+  away). After warmup untimed runs, runs timed runs are made and summarized by
+  their minimum, median, mean, and sample standard deviation in seconds, along
+  with the checksum and n (the input size, for computing throughput). If the
+  platform allows it, the CPU cycles and instructions of the fastest run are
+  also recorded, otherwise both are -1.
+- print_table(res) writes results in human-readable columns, and to_json(res)
+  returns them as a JSON array with one object per line, which can be saved
+  per version and compared with standard tools.
+
+Hardware counters are read through perf_event_open() on Linux, and are skipped
+elsewhere or when the kernel refuses access (e.g. due to perf_event_paranoid
+or in a container). Wall-clock time uses a monotonic clock where available.
+
+Time Complexity:
+- O(1) per call to next(), below(), and uniform().
+- O(n) per call to each generator, where n is the size of the output.
+- O(warmup + runs) calls to f.setup() and f.run() per call to benchmark(), plus
+  O(runs log runs) to summarize them.
+- O(r) per call to print_table(res) and to_json(res), where r is the number of
+  results.
+
+Space Complexity:
+- O(n) for the output of each generator.
+- O(runs) auxiliary heap space for benchmark().
+
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+class rng {
+  unsigned long long state;
+
+ public:
+  rng(unsigned long long seed = 1) : state(seed*2 + 1) {}
+
+  unsigned long long next() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state*2685821657736338717ULL;
+  }
+
+  long long below(long long n) {
+    return (long long)(next() % (unsigned long long)n);
+  }
+
+  double uniform() {
+    return (next() >> 11)*(1.0/9007199254740992.0);
+  }
+};
+
+enum int_pattern { RANDOM, SORTED, REVERSED, FEW_UNIQUE, NEARLY_SORTED };
+
+std::vector<int> random_ints(int n, int_pattern pattern = RANDOM,
+                             unsigned long long seed = 1) {
+  rng r(seed);
+  std::vector<int> res(n);
+  for (int i = 0; i < n; i++) {
+    res[i] = (pattern == FEW_UNIQUE) ? (int)r.below(16) : (int)r.next();
+  }
+  if (pattern == SORTED || pattern == NEARLY_SORTED) {
+    std::sort(res.begin(), res.end());
+  } else if (pattern == REVERSED) {
+    std::sort(res.rbegin(), res.rend());
+  }
+  if (pattern == NEARLY_SORTED && n > 0) {
+    for (int i = 0; i < n/100; i++) {
+      std::swap(res[r.below(n)], res[r.below(n)]);
+    }
+  }
+  return res;
+}
+
+std::string random_string(int n, int alphabet = 26,
+                          unsigned long long seed = 1) {
+  rng r(seed);
+  std::string res(n, 'a');
+  for (int i = 0; i < n; i++) {
+    res[i] = (char)('a' + r.below(alphabet));
+  }
+  return res;
+}
+
+typedef std::pair<int, int> edge;
+
+std::vector<edge> random_graph(int n, long long m,
+                               unsigned long long seed = 1) {
+  rng r(seed);
+  std::vector<edge> res;
+  res.reserve(m);
+  while ((long long)res.size() < m) {
+    int u = r.below(n), v = r.below(n);
+    if (u != v) {
+      res.push_back(edge(u, v));
+    }
+  }
+  return res;
+}
+
+std::vector<edge> grid_graph(int rows, int cols) {
+  std::vector<edge> res;
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++) {
+      int u = i*cols + j;
+      if (j + 1 < cols) {
+        res.push_back(edge(u, u + 1));
+        res.push_back(edge(u + 1, u));
+      }
+      if (i + 1 < rows) {
+        res.push_back(edge(u, u + cols));
+        res.push_back(edge(u + cols, u));
+      }
+    }
+  }
+  return res;
+}
+
+typedef std::pair<double, double> point;
+
+std::vector<point> random_points(int n, unsigned long long seed = 1) {
+  rng r(seed);
+  std::vector<point> res(n);
+  for (int i = 0; i < n; i++) {
+    res[i].first = r.uniform();
+    res[i].second = r.uniform();
+  }
+  return res;
+}
+
+std::vector<point> clustered_points(int n, int k, double spread = 0.01,
+                                    unsigned long long seed = 1) {
+  rng r(seed);
+  std::vector<point> centers(k), res(n);
+  for (int i = 0; i < k; i++) {
+    centers[i] = point(r.uniform(), r.uniform());
+  }
+  for (int i = 0; i < n; i++) {
+    // Box-Muller transform of two uniform values.
+    double radius = spread*sqrt(-2*log(1 - r.uniform()));
+    double angle = 2*acos(-1.0)*r.uniform();
+    const point &c = centers[r.below(k)];
+    res[i] = point(c.first + radius*cos(angle), c.second + radius*sin(angle));
+  }
+  return res;
+}
+
+std::vector<std::vector<double> > random_matrix(int rows, int cols,
+                                                unsigned long long seed = 1) {
+  rng r(seed);
+  std::vector<std::vector<double> > res(rows, std::vector<double>(cols));
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < cols; j++) {
+      res[i][j] = 2*r.uniform() - 1;
+    }
+  }
+  return res;
+}
+
+double seconds() {
+#if defined(CLOCK_MONOTONIC)
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec*1e-9;
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+// Counts CPU cycles and retired instructions of the calling thread between
+// start() and stop(), or reports -1 for both if the counters are unavailable.
+class perf_counters {
+  int fd[2];
+
+#ifdef __linux__
+  static int open_counter(unsigned long long config, int group) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = (group < 0) ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+  }
+#endif
+
+  perf_counters(const perf_counters &);
+  perf_counters& operator=(const perf_counters &);
+
+ public:
+  perf_counters() {
+    fd[0] = fd[1] = -1;
+#ifdef __linux__
+    fd[0] = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (fd[0] >= 0) {
+      fd[1] = open_counter(PERF_COUNT_HW_INSTRUCTIONS, fd[0]);
+    }
+#endif
+  }
+
+  ~perf_counters() {
+#ifdef __linux__
+    for (int i = 0; i < 2; i++) {
+      if (fd[i] >= 0) {
+        close(fd[i]);
+      }
+    }
+#endif
+  }
+
+  bool available() const {
+    return fd[0] >= 0 && fd[1] >= 0;
+  }
+
+  void start() {
+#ifdef __linux__
+    if (available()) {
+      ioctl(fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+  }
+
+  void stop(long long &cycles, long long &instructions) {
+    cycles = instructions = -1;
+#ifdef __linux__
+    if (available()) {
+      ioctl(fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+      long long c, i;
+      if (read(fd[0], &c, sizeof(c)) == sizeof(c) &&
+          read(fd[1], &i, sizeof(i)) == sizeof(i)) {
+        cycles = c;
+        instructions = i;
+      }
+    }
+#endif
+  }
+};
+
+struct bench_result {
+  std::string name;
+  long long n, checksum, cycles, instructions;
+  int runs;
+  double min, median, mean, stddev;
+};
+
+template<class Case>
+bench_result benchmark(const std::string &name, long long n, Case &f,
+                       int warmup = 1, int runs = 5) {
+  bench_result res;
+  res.name = name;
+  res.n = n;
+  res.runs = runs;
+  res.checksum = 0;
+  res.cycles = res.instructions = -1;
+  for (int i = 0; i < warmup; i++) {
+    f.setup();
+    res.checksum += f.run();
+  }
+  perf_counters counters;
+  std::vector<double> times;
+  for (int i = 0; i < runs; i++) {
+    f.setup();
+    long long cycles, instructions;
+    counters.start();
+    double start = seconds();
+    res.checksum += f.run();
+    double t = seconds() - start;
+    counters.stop(cycles, instructions);
+    if (times.empty() || t < *std::min_element(times.begin(), times.end())) {
+      res.cycles = cycles;
+      res.instructions = instructions;
+    }
+    times.push_back(t);
+  }
+  std::sort(times.begin(), times.end());
+  res.min = times[0];
+  res.median = (runs % 2 == 1) ? times[runs/2]
+                               : (times[runs/2 - 1] + times[runs/2])/2;
+  res.mean = res.stddev = 0;
+  for (int i = 0; i < runs; i++) {
+    res.mean += times[i]/runs;
+  }
+  for (int i = 0; i < runs && runs > 1; i++) {
+    res.stddev += (times[i] - res.mean)*(times[i] - res.mean)/(runs - 1);
+  }
+  res.stddev = sqrt(res.stddev);
+  return res;
+}
+
+void print_table(const std::vector<bench_result> &res, FILE *out = stdout) {
+  fprintf(out, "%-24s %9s %9s %9s %6s %8s\n", "case", "n", "median(s)",
+          "min(s)", "+/-(%)", "ns/item");
+  for (int i = 0; i < (int)res.size(); i++) {
+    const bench_result &r = res[i];
+    fprintf(out, "%-24s %9lld %9.6f %9.6f %6.2f %8.2f\n", r.name.c_str(),
+            r.n, r.median, r.min, (r.median > 0) ? 100*r.stddev/r.median : 0,
+            (r.n > 0) ? r.median*1e9/r.n : 0);
+  }
+}
+
+std::string to_json(const std::vector<bench_result> &res) {
+  std::string s = "[\n";
+  char buf[512];
+  for (int i = 0; i < (int)res.size(); i++) {
+    const bench_result &r = res[i];
+    std::string name;
+    for (int j = 0; j < (int)r.name.size(); j++) {
+      if (r.name[j] == '"' || r.name[j] == '\\') {
+        name += '\\';
+      }
+      name += r.name[j];
+    }
+    sprintf(buf, "  {\"name\": \"%s\", \"n\": %lld, \"runs\": %d, "
+            "\"min\": %.9f, \"median\": %.9f, \"mean\": %.9f, "
+            "\"stddev\": %.9f, \"cycles\": %lld, \"instructions\": %lld, "
+            "\"checksum\": %lld}%s\n", name.substr(0, 200).c_str(), r.n,
+            r.runs, r.min, r.median, r.mean, r.stddev, r.cycles,
+            r.instructions, r.checksum, (i + 1 < (int)res.size()) ? "," : "");
+    s += buf;
+  }
+  return s + "]\n";
+}
+
+/*** Example Usage and Output (with timings from one machine):
+
+case                             n median(s)    min(s) +/-(%)  ns/item
+std::sort random           1000000  0.085201  0.083645   3.21    85.20
+std::sort sorted           1000000  0.016458  0.016273   0.64    16.46
+std::sort few_unique       1000000  0.030161  0.028080   6.45    30.16
+std::sort nearly_sorted    1000000  0.019383  0.019322   1.84    19.38
+tr1::unordered_map         1000000  0.295318  0.266326  23.68   295.32
+memmem absent             10000000  0.021967  0.021817   4.72     2.20
+memmem late               10000000  0.018921  0.018016   5.49     1.89
+***/
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <tr1/unordered_map>
+using namespace std;
+
+struct sort_case {
+  vector<int> input, a;
+
+  sort_case(const vector<int> &input) : input(input) {}
+
+  void setup() {
+    a = input;
+  }
+
+  long long run() {
+    sort(a.begin(), a.end());
+    return a[a.size()/2];
+  }
+};
+
+struct hash_map_case {
+  vector<int> keys;
+  tr1::unordered_map<int, int> m;
+
+  hash_map_case(const vector<int> &keys) : keys(keys) {}
+
+  void setup() {
+    m = tr1::unordered_map<int, int>();
+  }
+
+  // Inserts every key, then looks up each key and its successor.
+  long long run() {
+    for (int i = 0; i < (int)keys.size(); i++) {
+      m[keys[i]] = i;
+    }
+    long long sum = 0;
+    for (int i = 0; i < (int)keys.size(); i++) {
+      sum += m.count(keys[i]) + m.count(keys[i] + 1);
+    }
+    return sum;
+  }
+};
+
+struct memmem_case {
+  string text, pattern;
+
+  memmem_case(const string &text, const string &pattern)
+      : text(text), pattern(pattern) {}
+
+  void setup() {}
+
+  long long run() {
+    const void *p = memmem(text.data(), text.size(), pattern.data(),
+                           pattern.size());
+    return (p == NULL) ? -1 : (const char*)p - text.data();
+  }
+};
+
+int main(int argc, char **argv) {
+  // Generators are deterministic and have the requested shapes.
+  assert(random_ints(1000, RANDOM, 7) == random_ints(1000, RANDOM, 7));
+  assert(random_ints(1000, RANDOM, 7) != random_ints(1000, RANDOM, 8));
+  vector<int> v = random_ints(1000, REVERSED);
+  assert(adjacent_find(v.begin(), v.end(), less<int>()) == v.end());
+  v = random_ints(1000, FEW_UNIQUE);
+  sort(v.begin(), v.end());
+  assert(unique(v.begin(), v.end()) - v.begin() <= 16);
+  string s = random_string(1000, 4);
+  assert(s.size() == 1000 && s.find_first_not_of("abcd") == string::npos);
+  vector<edge> g = random_graph(100, 500);
+  for (int i = 0; i < (int)g.size(); i++) {
+    assert(g[i].first != g[i].second && 0 <= min(g[i].first, g[i].second));
+    assert(max(g[i].first, g[i].second) < 100);
+  }
+  assert(grid_graph(3, 4).size() == 2*(3*3 + 2*4));
+  vector<point> p = random_points(1000);
+  for (int i = 0; i < (int)p.size(); i++) {
+    assert(0 <= p[i].first && p[i].first < 1);
+    assert(0 <= p[i].second && p[i].second < 1);
+  }
+  assert(clustered_points(1000, 5).size() == 1000);
+  vector<vector<double> > mat = random_matrix(3, 5);
+  assert(mat.size() == 3 && mat[2].size() == 5 && fabs(mat[1][4]) <= 1);
+
+  // The baselines to track between versions.
+  const int n = 1000000, text_size = 10000000;
+  vector<bench_result> res;
+  const int_pattern patterns[] = {RANDOM, SORTED, FEW_UNIQUE, NEARLY_SORTED};
+  const char *names[] = {"random", "sorted", "few_unique", "nearly_sorted"};
+  for (int i = 0; i < 4; i++) {
+    sort_case c(random_ints(n, patterns[i]));
+    res.push_back(benchmark(string("std::sort ") + names[i], n, c));
+    assert(res.back().min <= res.back().median + 1e-12);
+  }
+  hash_map_case h(random_ints(n));
+  res.push_back(benchmark("tr1::unordered_map", n, h));
+  assert(res.back().checksum >= 6LL*n);
+  string text = random_string(text_size, 2);
+  memmem_case absent(text, random_string(64, 2, 2));
+  res.push_back(benchmark("memmem absent", text_size, absent));
+  assert(res.back().checksum == -6);
+  memmem_case late(text, text.substr(text_size - 64));
+  res.push_back(benchmark("memmem late", text_size, late));
+  assert(res.back().checksum >= 0 && res.back().checksum <= 6LL*text_size);
+  print_table(res);
+
+  // Saves the results to the file named by the first argument, if any.
+  string json = to_json(res);
+  assert(json.find("\"name\": \"std::sort random\"") != string::npos);
+  if (argc > 1) {
+    FILE *f = fopen(argv[1], "w");
+    assert(f != NULL);
+    fputs(json.c_str(), f);
+    fclose(f);
+  }
+  return 0;
+}
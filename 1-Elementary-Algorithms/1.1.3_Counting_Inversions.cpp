@@ -93,9 +93,282 @@ long long inversions(int n, int a[]) {
   return res;
 }
 
+/*
+
+For repeated use on large inputs, the following avoid the per-level allocations
+of inversions(lo, hi) and leave the input range unmodified.
+
+- inversion_counter<T> holds two scratch buffers which are reused across calls,
+  so that no heap allocations are made once they have grown to the largest
+  input size. Calling count(lo, hi) copies the range into the first buffer,
+  counts the shifts made by insertion sort on short runs, then repeatedly
+  merges runs of doubling width back and forth between the two buffers. Each
+  time an element is taken from the right run of a merge, every element still
+  remaining in the left run forms an inversion with it.
+- count(lo, hi, grain_size) is the same, except that halves larger than
+  grain_size are counted in parallel as OpenMP tasks, and each merge of two
+  halves is itself split into independent pieces of about grain_size elements
+  by a binary search along the merge path. Compile with -fopenmp to enable
+  threading; otherwise this runs serially with the same result.
+- inversions_fenwick(lo, hi, m) counts inversions of a range of integers in
+  [0, m) by scanning from right to left with a Fenwick tree of counts, adding
+  the number of smaller values seen so far. This is faster than merging when m
+  is small relative to the number of elements.
+- kendall_tau_distance holds a reference permutation of 0 to n - 1 and reports
+  the Kendall tau distance (the number of pairs ordered differently) between it
+  and other permutations. Each permutation is relabeled by its values' positions
+  in the reference, which was inverted once at construction, and the inversions
+  of the relabeled sequence are counted. distance_batch() scores many
+  permutations in parallel, with one set of scratch buffers per thread.
+
+Time Complexity:
+- O(n log n) per call to count(lo, hi), or O(n log n / p) with p threads for
+  count(lo, hi, grain_size).
+- O(n log m) per call to inversions_fenwick(lo, hi, m).
+- O(n) per call to the kendall_tau_distance constructor and O(n log n) per
+  permutation passed to distance() or distance_batch().
+
+Space Complexity:
+- O(n) auxiliary heap space for count(), reused between calls.
+- O(m) auxiliary heap space for inversions_fenwick(lo, hi, m).
+- O(n) auxiliary heap space per thread for kendall_tau_distance.
+
+*/
+
+template<class T>
+long long merge_and_count(const T *src, int lo, int mid, int hi, int left_end,
+                          T *dst) {
+  long long res = 0;
+  int i = lo, j = mid, k = lo;
+  while (i < mid && j < hi) {
+    if (src[j] < src[i]) {
+      res += left_end - i;
+      dst[k++] = src[j++];
+    } else {
+      dst[k++] = src[i++];
+    }
+  }
+  std::copy(src + i, src + mid, dst + k);
+  std::copy(src + j, src + hi, dst + k + (mid - i));
+  return res;
+}
+
+template<class T>
+long long sort_and_count(T *a, T *b, int n) {
+  const int insertion_run_len = 32;
+  long long res = 0;
+  for (int lo = 0; lo < n; lo += insertion_run_len) {
+    int hi = std::min(lo + insertion_run_len, n);
+    for (int i = lo + 1; i < hi; i++) {
+      T tmp = a[i];
+      int j = i;
+      for (; j > lo && tmp < a[j - 1]; j--) {
+        a[j] = a[j - 1];
+      }
+      a[j] = tmp;
+      res += i - j;
+    }
+  }
+  T *src = a, *dst = b;
+  for (int width = insertion_run_len; width < n; width *= 2) {
+    for (int lo = 0; lo < n; lo += 2*width) {
+      int mid = std::min(lo + width, n), hi = std::min(lo + 2*width, n);
+      res += merge_and_count(src, lo, mid, hi, mid, dst);
+    }
+    std::swap(src, dst);
+  }
+  if (src != a) {
+    std::copy(src, src + n, a);
+  }
+  return res;
+}
+
+// Merges sorted a[0, na) and a[na, n) into b[0, n) using pieces of the merge
+// path which may be processed independently.
+template<class T>
+long long parallel_merge_and_count(const T *a, int na, int n, T *b,
+                                   int grain_size) {
+  const T *r = a + na;
+  int nr = n - na, pieces = std::min(64, std::max(1, n/grain_size));
+  std::vector<int> split(pieces + 1, na);
+  std::vector<long long> res(pieces, 0);
+  split[0] = 0;
+  for (int p = 1; p < pieces; p++) {
+    // Find how many of the first k merged elements come from the left half.
+    int k = (int)((long long)n*p/pieces);
+    int lo = std::max(0, k - nr), hi = std::min(k, na);
+    while (lo < hi) {
+      int i = lo + (hi - lo)/2;
+      if (r[k - i - 1] < a[i]) {
+        hi = i;
+      } else {
+        lo = i + 1;
+      }
+    }
+    split[p] = lo;
+  }
+  for (int p = 0; p < pieces; p++) {
+#ifdef _OPENMP
+#pragma omp task shared(res, split) firstprivate(p)
+#endif
+    {
+      int k = (int)((long long)n*p/pieces);
+      int k2 = (int)((long long)n*(p + 1)/pieces);
+      int i = split[p], i2 = split[p + 1], j = k - i, j2 = k2 - i2;
+      const T *l = a;
+      T *out = b + k;
+      while (i < i2 && j < j2) {
+        if (r[j] < l[i]) {
+          res[p] += na - i;
+          *out++ = r[j++];
+        } else {
+          *out++ = l[i++];
+        }
+      }
+      // Right elements after the left part of this piece is exhausted are
+      // still inverted with the left elements of later pieces.
+      res[p] += (long long)(j2 - j)*(na - i2);
+      out = std::copy(l + i, l + i2, out);
+      std::copy(r + j, r + j2, out);
+    }
+  }
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+  long long total = 0;
+  for (int p = 0; p < pieces; p++) {
+    total += res[p];
+  }
+  return total;
+}
+
+template<class T>
+long long parallel_sort_and_count(T *a, T *b, int n, int grain_size) {
+  if (n <= grain_size) {
+    return sort_and_count(a, b, n);
+  }
+  int half = n/2;
+  long long left = 0, right = 0;
+#ifdef _OPENMP
+#pragma omp task shared(left) firstprivate(a, b, half, grain_size)
+#endif
+  left = parallel_sort_and_count(a, b, half, grain_size);
+  right = parallel_sort_and_count(a + half, b + half, n - half, grain_size);
+#ifdef _OPENMP
+#pragma omp taskwait
+#endif
+  long long res = left + right + parallel_merge_and_count(a, half, n, b,
+                                                          grain_size);
+  std::copy(b, b + n, a);
+  return res;
+}
+
+template<class T>
+class inversion_counter {
+  std::vector<T> a, b;
+
+  template<class It>
+  int load(It lo, It hi) {
+    int n = hi - lo;
+    if ((int)a.size() < n) {
+      a.resize(n);
+      b.resize(n);
+    }
+    std::copy(lo, hi, a.begin());
+    return n;
+  }
+
+ public:
+  template<class It>
+  long long count(It lo, It hi) {
+    int n = load(lo, hi);
+    return (n < 2) ? 0 : sort_and_count(&a[0], &b[0], n);
+  }
+
+  template<class It>
+  long long count(It lo, It hi, int grain_size) {
+    int n = load(lo, hi);
+    if (n < 2) {
+      return 0;
+    }
+    long long res = 0;
+    grain_size = std::max(grain_size, 2);
+#ifdef _OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    res = parallel_sort_and_count(&a[0], &b[0], n, grain_size);
+    return res;
+  }
+};
+
+template<class It>
+long long inversions_fenwick(It lo, It hi, int m) {
+  std::vector<int> t(m + 1, 0);
+  long long res = 0;
+  for (It it = hi; it != lo; ) {
+    int x = *--it;
+    for (int i = x; i > 0; i -= i & -i) {
+      res += t[i];
+    }
+    for (int i = x + 1; i <= m; i += i & -i) {
+      t[i]++;
+    }
+  }
+  return res;
+}
+
+class kendall_tau_distance {
+  std::vector<int> pos, mapped;
+  inversion_counter<int> counter;
+
+  template<class It>
+  long long distance(It lo, std::vector<int> &mapped,
+                     inversion_counter<int> &counter) const {
+    for (int i = 0; i < (int)pos.size(); i++, ++lo) {
+      mapped[i] = pos[*lo];
+    }
+    return counter.count(mapped.begin(), mapped.end());
+  }
+
+ public:
+  template<class It>
+  kendall_tau_distance(It lo, It hi) : pos(hi - lo), mapped(hi - lo) {
+    for (int i = 0; lo != hi; ++lo) {
+      pos[*lo] = i++;
+    }
+  }
+
+  template<class It>
+  long long distance(It lo) {
+    return distance(lo, mapped, counter);
+  }
+
+  std::vector<long long> distance_batch(
+      const std::vector<std::vector<int> > &perms) const {
+    int num = perms.size();
+    std::vector<long long> res(num);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      std::vector<int> mapped(pos.size());
+      inversion_counter<int> counter;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+      for (int i = 0; i < num; i++) {
+        res[i] = distance(perms[i].begin(), mapped, counter);
+      }
+    }
+    return res;
+  }
+};
+
 /*** Example Usage ***/
 
 #include <cassert>
+#include <cstdlib>
 
 int main() {
   {
@@ -106,5 +379,36 @@ int main() {
     int a[] = {6, 9, 1, 14, 8, 12, 3, 2};
     assert(inversions(8, a) == 16);
   }
+  {
+    int a[] = {6, 9, 1, 14, 8, 12, 3, 2};
+    inversion_counter<int> counter;
+    assert(counter.count(a, a + 8) == 16);
+    assert(counter.count(a, a + 8, 2) == 16);
+    assert(inversions_fenwick(a, a + 8, 15) == 16);
+    assert(a[0] == 6 && a[7] == 2);  // The input is left unmodified.
+  }
+  {
+    std::vector<int> v;
+    for (int i = 0; i < 100000; i++) {
+      v.push_back(rand() % 1000);
+    }
+    inversion_counter<int> counter;
+    long long res = counter.count(v.begin(), v.end());
+    assert(counter.count(v.begin(), v.end(), 1000) == res);
+    assert(inversions_fenwick(v.begin(), v.end(), 1000) == res);
+    assert(inversions(v.begin(), v.end()) == res);
+  }
+  {
+    int ref[] = {0, 1, 2, 3, 4}, p[] = {4, 3, 2, 1, 0}, q[] = {1, 0, 2, 3, 4};
+    kendall_tau_distance kt(ref, ref + 5);
+    assert(kt.distance(p) == 10);
+    assert(kt.distance(q) == 1);
+    std::vector<std::vector<int> > perms;
+    perms.push_back(std::vector<int>(p, p + 5));
+    perms.push_back(std::vector<int>(q, q + 5));
+    kendall_tau_distance kt2(p, p + 5);
+    std::vector<long long> res = kt2.distance_batch(perms);
+    assert(res[0] == 0 && res[1] == 9);
+  }
   return 0;
 }
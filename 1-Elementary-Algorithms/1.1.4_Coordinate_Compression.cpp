@@ -53,6 +53,120 @@ template<class It> void compress2(It lo, It hi) {
   }
 }
 
+/*
+
+Version 3 keeps the mapping between values and compressed integers for reuse,
+instead of discarding it after rewriting the range. A compression_index stores
+the sorted distinct values in an array, so that value(r) returns the value with
+rank r in O(1). It also stores a copy of the values in Eytzinger (breadth-first
+binary heap) order, where the children of index i are at 2*i and 2*i + 1. The
+top levels of this layout are shared by every search and stay in cache, and
+the search loop rank(x) has no unpredictable branches, since each step only
+computes the next index using the result of one comparison.
+
+- compression_index(lo, hi) builds the index from the values in [lo, hi).
+- size() returns the number of distinct values k.
+- rank(x) returns the number of distinct values less than x, which is the
+  compressed integer in [0, k) for x if x was indexed, or k if x is greater
+  than all values.
+- value(r) returns the value with rank r.
+- contains(x) returns whether x was indexed.
+- insert(lo, hi) adds the values of a range to the index. The new values are
+  sorted separately and merged with the existing values, rather than sorting
+  everything again. Note that this changes the ranks of existing values that
+  are greater than any inserted value.
+- compress(lo, hi) assigns each value in the range to its rank, similar to the
+  functions above.
+
+Time Complexity:
+- O(n log n) per call to the constructor, where n is the distance between lo
+  and hi.
+- O(1) per call to size() and value().
+- O(log k) per call to rank() and contains().
+- O(k + m log m) per call to insert(lo, hi), where m is the distance between lo
+  and hi.
+- O(m log k) per call to compress(lo, hi).
+
+Space Complexity:
+- O(k) for storage of the index.
+- O(k + m) auxiliary heap space for insert(lo, hi).
+
+*/
+
+template<class T>
+class compression_index {
+  std::vector<T> vals, eyt;
+  std::vector<int> eyt_rank;
+
+  int build(int i, int k) {
+    if (k <= (int)vals.size()) {
+      i = build(i, 2*k);
+      eyt[k] = vals[i];
+      eyt_rank[k] = i++;
+      i = build(i, 2*k + 1);
+    }
+    return i;
+  }
+
+  void rebuild() {
+    int k = vals.size();
+    eyt.resize(k + 1);
+    eyt_rank.assign(k + 1, k);  // eyt_rank[0] is the rank when x > max.
+    build(0, 1);
+  }
+
+ public:
+  template<class It>
+  compression_index(It lo, It hi) : vals(lo, hi) {
+    std::sort(vals.begin(), vals.end());
+    vals.resize(std::unique(vals.begin(), vals.end()) - vals.begin());
+    rebuild();
+  }
+
+  int size() const {
+    return vals.size();
+  }
+
+  int rank(const T &x) const {
+    int k = 1, n = vals.size();
+    while (k <= n) {
+      k = 2*k + (eyt[k] < x);
+    }
+    // Undo the trailing right turns, plus one left turn, to recover the
+    // last node where the search went left (i.e. the lower bound).
+    k >>= __builtin_ffs(~k);
+    return eyt_rank[k];
+  }
+
+  const T &value(int r) const {
+    return vals[r];
+  }
+
+  bool contains(const T &x) const {
+    int r = rank(x);
+    return r < (int)vals.size() && !(x < vals[r]);
+  }
+
+  template<class It>
+  void insert(It lo, It hi) {
+    std::vector<T> add(lo, hi), merged;
+    std::sort(add.begin(), add.end());
+    merged.reserve(vals.size() + add.size());
+    std::merge(vals.begin(), vals.end(), add.begin(), add.end(),
+               std::back_inserter(merged));
+    merged.resize(std::unique(merged.begin(), merged.end()) - merged.begin());
+    vals.swap(merged);
+    rebuild();
+  }
+
+  template<class It>
+  void compress(It lo, It hi) const {
+    for (It it = lo; it != hi; ++it) {
+      *it = rank(*it);
+    }
+  }
+};
+
 /*** Example Usage and Output:
 
 0 4 4 1 3 2 5 5
@@ -61,6 +175,7 @@ template<class It> void compress2(It lo, It hi) {
 
 ***/
 
+#include <cassert>
 #include <iostream>
 using namespace std;
 
@@ -87,5 +202,25 @@ int main() {
     compress1(a, a + 6);
     print_range(a, a + 6);
   }
+  {  // The index can be kept for lookups in both directions.
+    int a[] = {1, 30, 30, 7, 9, 8, 99, 99};
+    compression_index<int> index(a, a + 8);
+    assert(index.size() == 6);
+    assert(index.rank(30) == 4 && index.value(4) == 30);
+    assert(index.rank(0) == 0 && index.rank(100) == 6);
+    assert(!index.contains(10) && index.rank(10) == 4);
+    int b[] = {10, 0, 10, 1000};
+    index.insert(b, b + 4);
+    assert(index.size() == 9);
+    assert(index.contains(10) && index.rank(10) == 5);
+    assert(index.value(0) == 0 && index.value(8) == 1000);
+    int c[] = {1, 30, 30, 7, 9, 8, 99, 99};
+    compress1(c, c + 8);
+    index = compression_index<int>(a, a + 8);
+    index.compress(a, a + 8);
+    for (int i = 0; i < 8; i++) {
+      assert(a[i] == c[i]);
+    }
+  }
   return 0;
 }
@@ -18,8 +18,10 @@ Space Complexity:
 */
 
 #include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <iterator>
+#include <vector>
 
 int rand32() {
   return (rand() & 0x7fff) | ((rand() & 0x7fff) << 15);
@@ -46,6 +48,161 @@ void nth_element2(It lo, It nth, It hi) {
   }
 }
 
+/*
+
+floyd_rivest_select() has the same interface and effect as nth_element2(), but
+chooses its pivots much more carefully. On a range longer than 600 elements, it
+first recursively selects from a small sample around the expected position of
+nth, obtaining two pivots that bracket nth with high probability. Partitioning
+then typically leaves only a small range of O(sqrt(n)) elements around nth,
+taking about n + min(k, n - k) comparisons in total, where k = nth - lo. If the
+total length of the ranges partitioned, including those of the samples, exceeds
+4n, the remaining range is handed to median_of_medians_select(), which picks the
+median of the medians of groups of five elements as a pivot and therefore runs
+in O(n) time in the worst case. Like introsort, this keeps the fast average case
+and bounds the worst case.
+
+select_many() takes a range [lo, hi) and a vector of ranks (i.e. indices in the
+range), and rearranges the range so that for every rank r, *(lo + r) is the
+element that would be there if the range were sorted. Instead of making one
+full selection pass per rank, this selects the median rank, then recurses on
+the ranks below and above it within the subranges on either side. This is
+useful for finding several quantiles of the same data at once.
+
+Time Complexity:
+- O(n) on average and in the worst case per call to floyd_rivest_select() and
+  median_of_medians_select().
+- O(n log k) per call to select_many() with k distinct ranks.
+
+Space Complexity:
+- O(log n) auxiliary stack space for floyd_rivest_select() and
+  median_of_medians_select().
+- O(k) auxiliary heap space for select_many().
+
+*/
+
+template<class It>
+void small_sort(It lo, It hi) {
+  for (It i = lo; i != hi; ++i) {
+    for (It j = i; j != lo && *j < *(j - 1); --j) {
+      std::iter_swap(j, j - 1);
+    }
+  }
+}
+
+template<class It>
+void median_of_medians_select(It lo, It nth, It hi) {
+  typedef typename std::iterator_traits<It>::value_type T;
+  while (hi - lo > 5) {
+    // Gather the medians of each group of five at the front of the range.
+    It m = lo;
+    for (It g = lo; g < hi; g += 5) {
+      It g_hi = (hi - g < 5) ? hi : g + 5;
+      small_sort(g, g_hi);
+      std::iter_swap(m++, g + (g_hi - g)/2);
+      if (g_hi == hi) {
+        break;
+      }
+    }
+    It mid = lo + (m - lo)/2;
+    median_of_medians_select(lo, mid, m);
+    T pivot = *mid;
+    It lt = lo, i = lo, gt = hi;
+    while (i < gt) {
+      if (*i < pivot) {
+        std::iter_swap(lt++, i++);
+      } else if (pivot < *i) {
+        std::iter_swap(i, --gt);
+      } else {
+        ++i;
+      }
+    }
+    if (nth < lt) {
+      hi = lt;
+    } else if (gt <= nth) {
+      lo = gt;
+    } else {
+      return;
+    }
+  }
+  small_sort(lo, hi);
+}
+
+template<class It>
+void floyd_rivest_select(It lo, It nth, It hi, long long &budget) {
+  typedef typename std::iterator_traits<It>::value_type T;
+  It left = lo, right = hi - 1;
+  while (left < right) {
+    budget -= right - left + 1;
+    if (budget < 0) {
+      median_of_medians_select(left, nth, right + 1);
+      return;
+    }
+    if (right - left > 600) {
+      double n = right - left + 1, i = nth - left + 1, z = std::log(n);
+      double s = 0.5*std::exp(2*z/3);
+      double sd = 0.5*std::sqrt(z*s*(n - s)/n)*(i < n/2 ? -1 : 1);
+      It new_left = left + (int)std::max(0.0, i - i*s/n + sd - 1);
+      It new_right = left + (int)std::min(n - 1, i + (n - i)*s/n + sd - 1);
+      floyd_rivest_select(new_left, nth, new_right + 1, budget);
+    }
+    T t = *nth;
+    It i = left, j = right;
+    std::iter_swap(left, nth);
+    if (t < *right) {
+      std::iter_swap(right, left);
+    }
+    while (i < j) {
+      std::iter_swap(i++, j--);
+      while (*i < t) {
+        ++i;
+      }
+      while (t < *j) {
+        --j;
+      }
+    }
+    if (!(*left < t) && !(t < *left)) {
+      std::iter_swap(left, j);
+    } else {
+      std::iter_swap(++j, right);
+    }
+    if (j <= nth) {
+      left = j + 1;
+    }
+    if (nth <= j) {
+      right = j - 1;
+    }
+  }
+}
+
+template<class It>
+void floyd_rivest_select(It lo, It nth, It hi) {
+  long long budget = 4LL*(hi - lo);
+  floyd_rivest_select(lo, nth, hi, budget);
+}
+
+template<class It>
+void select_many(It lo, It hi, const int *rank_lo, const int *rank_hi,
+                 int offset) {
+  if (rank_lo == rank_hi) {
+    return;
+  }
+  const int *mid = rank_lo + (rank_hi - rank_lo)/2;
+  It nth = lo + (*mid - offset);
+  floyd_rivest_select(lo, nth, hi);
+  select_many(lo, nth, rank_lo, mid, offset);
+  select_many(nth + 1, hi, mid + 1, rank_hi, *mid + 1);
+}
+
+template<class It>
+void select_many(It lo, It hi, std::vector<int> ranks) {
+  std::sort(ranks.begin(), ranks.end());
+  ranks.resize(std::unique(ranks.begin(), ranks.end()) - ranks.begin());
+  if (!ranks.empty()) {
+    select_many(lo, hi, &ranks[0], &ranks[0] + ranks.size(), 0);
+  }
+}
+
 /*** Example Usage and Output:
 
 2 3 3 4 5 6 6 7 9
@@ -70,5 +227,43 @@ int main () {
   nth_element2(a, a + n/2, a + n);
   assert(a[n/2] == 5);
   print_range(a, a + n);
+
+  vector<int> v, sorted;
+  for (int i = 0; i < 100000; i++) {
+    v.push_back(rand32() % (i % 2 ? 1000000 : 100));
+  }
+  sorted = v;
+  sort(sorted.begin(), sorted.end());
+  for (int k = 0; k < (int)v.size(); k += 9973) {
+    vector<int> v2(v), v3(v);
+    floyd_rivest_select(v2.begin(), v2.begin() + k, v2.end());
+    assert(v2[k] == sorted[k]);
+    median_of_medians_select(v3.begin(), v3.begin() + k, v3.end());
+    assert(v3[k] == sorted[k]);
+  }
+  for (int len = 1; len <= 40; len++) {
+    for (int k = 0; k < len; k++) {
+      vector<int> w(len, 7), w2(len);
+      floyd_rivest_select(w.begin(), w.begin() + k, w.end());
+      assert(w[k] == 7);
+      for (int i = 0; i < len; i++) {
+        w2[i] = rand32() % 5;
+      }
+      w = w2;
+      sort(w2.begin(), w2.end());
+      floyd_rivest_select(w.begin(), w.begin() + k, w.end());
+      assert(w[k] == w2[k]);
+    }
+  }
+  // Find the p50, p90, p99 and p999 quantiles in one pass.
+  vector<int> ranks;
+  ranks.push_back(v.size()*50/100);
+  ranks.push_back(v.size()*90/100);
+  ranks.push_back(v.size()*99/100);
+  ranks.push_back(v.size()*999/1000);
+  select_many(v.begin(), v.end(), ranks);
+  for (int i = 0; i < (int)ranks.size(); i++) {
+    assert(v[ranks[i]] == sorted[ranks[i]]);
+  }
   return 0;
 }
@@ -16,6 +16,8 @@ Space Complexity:
 
 */
 
+#include <algorithm>
+#include <functional>
 #include <iterator>
 #include <vector>
 
@@ -41,19 +43,115 @@ longest_increasing_subsequence(It lo, It hi) {
     tail[h] = i;
   }
   std::vector<typename std::iterator_traits<It>::value_type> res(len);
+  if (len == 0) {
+    return res;
+  }
   for (int i = tail[len - 1]; i != -1; i = prev[i]) {
     res[--len] = *(lo + i);
   }
   return res;
 }
 
+/*
+
+lis_solver is meant for solving many instances in a row. It keeps its buffers
+between calls, so no heap allocations are made once they have grown to the
+length of the longest input. The comparator comp specifies the order (e.g.
+std::greater<T>() for decreasing subsequences). If strict is false, then
+consecutive elements of the subsequence may also be equivalent under comp, so
+for instance the default comparator finds nondecreasing subsequences.
+
+- length(lo, hi) returns the length of a longest subsequence. This is the fast
+  path, keeping only the smallest tail value of an increasing subsequence for
+  each length (patience sorting), with no predecessor arrays.
+- subsequence(lo, hi, out) writes a longest subsequence to the output iterator
+  out in order, returning its length.
+
+Time Complexity:
+- O(n log k) per call to length() and subsequence(), where n is the distance
+  between lo and hi and k is the length of the answer.
+
+Space Complexity:
+- O(k) auxiliary heap space for length() and O(n) for subsequence(), reused
+  across calls.
+
+*/
+
+template<class T, class Compare = std::less<T> >
+class lis_solver {
+  bool strict;
+  Compare comp;
+  std::vector<T> tails;
+  std::vector<int> tail_index, prev;
+
+  // Returns the position in tails that x should replace, for a tails array of
+  // values ordered by comp.
+  int find_pos(const T &x) const {
+    typename std::vector<T>::const_iterator it = strict ?
+        std::lower_bound(tails.begin(), tails.end(), x, comp) :
+        std::upper_bound(tails.begin(), tails.end(), x, comp);
+    return it - tails.begin();
+  }
+
+ public:
+  lis_solver(bool strict = true, const Compare &comp = Compare())
+      : strict(strict), comp(comp) {}
+
+  template<class It>
+  int length(It lo, It hi) {
+    tails.clear();
+    for (It it = lo; it != hi; ++it) {
+      int pos = find_pos(*it);
+      if (pos == (int)tails.size()) {
+        tails.push_back(*it);
+      } else {
+        tails[pos] = *it;
+      }
+    }
+    return tails.size();
+  }
+
+  template<class It, class OutIt>
+  int subsequence(It lo, It hi, OutIt out) {
+    int n = hi - lo;
+    tails.clear();
+    tail_index.clear();
+    prev.resize(n);
+    for (int i = 0; i < n; i++) {
+      const T &x = *(lo + i);
+      int pos = find_pos(x);
+      prev[i] = (pos > 0) ? tail_index[pos - 1] : -1;
+      if (pos == (int)tails.size()) {
+        tails.push_back(x);
+        tail_index.push_back(i);
+      } else {
+        tails[pos] = x;
+        tail_index[pos] = i;
+      }
+    }
+    // Reuse tail_index to hold the answer's indices in order.
+    int len = tails.size();
+    for (int i = len - 1, j = (len > 0) ? tail_index[i] : -1; i >= 0; i--) {
+      tail_index[i] = j;
+      j = prev[j];
+    }
+    for (int i = 0; i < len; i++) {
+      *out++ = *(lo + tail_index[i]);
+    }
+    return len;
+  }
+};
+
 /*** Example Usage and Output:
 
 -5 1 9 10 11 13
 
 ***/
 
+#include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <iterator>
 using namespace std;
 
 template<class It> void print_range(It lo, It hi) {
@@ -67,5 +165,27 @@ int main () {
   int a[] = {-2, -5, 1, 9, 10, 8, 11, 10, 13, 11};
   vector<int> res = longest_increasing_subsequence(a, a + 10);
   print_range(res.begin(), res.end());
+
+  lis_solver<int> solver;
+  assert(solver.length(a, a + 10) == 6);
+  vector<int> res2;
+  assert(solver.subsequence(a, a + 10, back_inserter(res2)) == 6);
+  assert(res == res2);
+  assert(solver.length(a, a) == 0);
+  lis_solver<int> nonstrict(false);
+  int b[] = {3, 3, 1, 3, 2, 2, 2};
+  assert(solver.length(b, b + 7) == 2);
+  assert(nonstrict.length(b, b + 7) == 4);
+  lis_solver<int, greater<int> > decreasing;
+  assert(decreasing.length(b, b + 7) == 2);
+  // Many short sequences may be solved without reallocating.
+  for (int i = 0; i < 1000; i++) {
+    int c[16];
+    for (int j = 0; j < 16; j++) {
+      c[j] = rand() % 100;
+    }
+    vector<int> expected = longest_increasing_subsequence(c, c + 16);
+    assert(solver.length(c, c + 16) == (int)expected.size());
+  }
   return 0;
 }
@@ -104,6 +104,151 @@ T max_submatrix_sum(const std::vector<std::vector<T> > &matrix,
   return max_sum;
 }
 
+/*
+
+The maximal subarray sum can also be computed by a reduction over blocks of the
+array, which may be processed independently. Each block is summarized by its
+total sum, its maximal nonempty prefix sum, its maximal nonempty suffix sum,
+and its maximal nonempty subarray sum. The summary of two adjacent blocks can
+be computed from theirs, since the best subarray of the concatenation either
+lies within one block or is a suffix of the left block followed by a prefix of
+the right block. This combination is associative, so the blocks may be reduced
+in any grouping.
+
+- subarray_summary<T> is the summary described above, with combine(a, b)
+  returning the summary of block a followed by block b.
+- summarize(lo, hi) returns the summary of a nonempty range in one pass.
+- parallel_max_subarray_sum(lo, hi, block_size) summarizes blocks of block_size
+  elements in parallel, then combines the block summaries in order.
+- parallel_max_submatrix_sum(matrix, &r1, &c1, &r2, &c2) is equivalent to
+  max_submatrix_sum(), except that the loop over the leftmost column is
+  distributed across threads. The matrix is first transposed, so that the row
+  sums are updated by adding a contiguous column to them. If several
+  submatrices have the maximal sum, then the one with the leftmost starting
+  column is reported.
+
+Both parallel functions use OpenMP, and run serially when compiled without
+-fopenmp.
+
+Time Complexity:
+- O(n/p + n/block_size) per call to parallel_max_subarray_sum() on p threads.
+- O(n*m^2/p) per call to parallel_max_submatrix_sum() on p threads.
+
+Space Complexity:
+- O(n/block_size) auxiliary heap space for parallel_max_subarray_sum().
+- O(n*m) auxiliary heap space for parallel_max_submatrix_sum().
+
+*/
+
+template<class T>
+struct subarray_summary {
+  T total, prefix, suffix, best;
+
+  static subarray_summary combine(const subarray_summary &a,
+                                  const subarray_summary &b) {
+    subarray_summary res;
+    res.total = a.total + b.total;
+    res.prefix = std::max(a.prefix, a.total + b.prefix);
+    res.suffix = std::max(b.suffix, a.suffix + b.total);
+    res.best = std::max(std::max(a.best, b.best), a.suffix + b.prefix);
+    return res;
+  }
+};
+
+template<class It>
+subarray_summary<typename std::iterator_traits<It>::value_type>
+summarize(It lo, It hi) {
+  typedef typename std::iterator_traits<It>::value_type T;
+  subarray_summary<T> res;
+  res.total = res.prefix = res.suffix = res.best = *lo;
+  for (++lo; lo != hi; ++lo) {
+    res.total += *lo;
+    res.prefix = std::max(res.prefix, res.total);
+    // The maximal suffix is also the maximal subarray ending at *lo.
+    res.suffix = std::max(res.suffix + *lo, *lo);
+    res.best = std::max(res.best, res.suffix);
+  }
+  return res;
+}
+
+template<class It>
+typename std::iterator_traits<It>::value_type
+parallel_max_subarray_sum(It lo, It hi, int block_size = 1 << 16) {
+  typedef typename std::iterator_traits<It>::value_type T;
+  int n = hi - lo, num_blocks = (n + block_size - 1)/block_size;
+  std::vector<subarray_summary<T> > blocks(num_blocks);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (int i = 0; i < num_blocks; i++) {
+    blocks[i] = summarize(lo + i*block_size,
+                          lo + std::min(n, (i + 1)*block_size));
+  }
+  subarray_summary<T> res = blocks[0];
+  for (int i = 1; i < num_blocks; i++) {
+    res = subarray_summary<T>::combine(res, blocks[i]);
+  }
+  return res.best;
+}
+
+template<class T>
+T parallel_max_submatrix_sum(const std::vector<std::vector<T> > &matrix,
+    int *r1 = NULL, int *c1 = NULL, int *r2 = NULL, int *c2 = NULL) {
+  int n = matrix.size(), m = matrix[0].size();
+  std::vector<T> cols(n*m);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < m; j++) {
+      cols[j*n + i] = matrix[i][j];
+    }
+  }
+  T max_sum = std::numeric_limits<T>::min();
+  int best[4] = {0, 0, 0, 0};
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<T> sums(n);
+    T local_max = std::numeric_limits<T>::min();
+    int local_best[4] = {0, 0, 0, 0};
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1) nowait
+#endif
+    for (int clo = 0; clo < m; clo++) {
+      std::fill(sums.begin(), sums.end(), 0);
+      for (int chi = clo; chi < m; chi++) {
+        const T *col = &cols[chi*n];
+        for (int i = 0; i < n; i++) {
+          sums[i] += col[i];
+        }
+        int rlo, rhi;
+        T sum = max_subarray_sum(sums.begin(), sums.end(), &rlo, &rhi);
+        if (local_max < sum) {
+          local_max = sum;
+          local_best[0] = rlo;
+          local_best[1] = clo;
+          local_best[2] = rhi;
+          local_best[3] = chi;
+        }
+      }
+    }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+    if (max_sum < local_max ||
+        (!(local_max < max_sum) && local_best[1] < best[1])) {
+      max_sum = local_max;
+      std::copy(local_best, local_best + 4, best);
+    }
+  }
+  if (r1 != NULL && c1 != NULL && r2 != NULL && c2 != NULL) {
+    *r1 = best[0];
+    *c1 = best[1];
+    *r2 = best[2];
+    *c2 = best[3];
+  }
+  return max_sum;
+}
+
 /*** Example Usage and Output:
 
 Maximal sum subarray:
@@ -131,6 +276,10 @@ int main() {
       cout << a[i] << " ";
     }
     cout << endl;
+    assert(parallel_max_subarray_sum(a, a + 3) == -1);
+    for (int block_size = 1; block_size <= 10; block_size++) {
+      assert(parallel_max_subarray_sum(a, a + 9, block_size) == 6);
+    }
   }
   {
     const int n = 4, m = 5;
@@ -151,6 +300,9 @@ int main() {
       }
       cout << endl;
     }
+    int q1 = 0, d1 = 0, q2 = 0, d2 = 0;
+    assert(parallel_max_submatrix_sum(matrix, &q1, &d1, &q2, &d2) == 15);
+    assert(q1 == r1 && d1 == c1 && q2 == r2 && d2 == c2);
   }
   return 0;
 }
@@ -40,14 +40,184 @@ It majority(It lo, It hi) {
   return candidate;
 }
 
+/*
+
+For data which can only be read once, such as a stream arriving in chunks, the
+following single-pass summaries report candidates instead. A candidate is not
+guaranteed to occur frequently, but every element that does occur frequently
+is guaranteed to be reported, so a second pass is only needed if false
+positives must be ruled out. Summaries of disjoint parts of the input (e.g.
+chunks processed by different threads) may be merged into a summary of their
+concatenation, in which case the same guarantees hold.
+
+- majority_stream<T> is the Boyer-Moore vote as an accumulator. add(x) and
+  add(lo, hi) feed elements, candidate() returns the only possible majority
+  element, and merge(s) absorbs another summary by letting their candidates'
+  votes cancel out. This requires operator == on T.
+- heavy_hitters<T> is the Misra-Gries generalization, keeping at most k - 1
+  counters. When a new element arrives and all counters are taken, every
+  counter is decremented instead. Each element occurring more than n/k times
+  in the n elements seen so far will be among candidates(), and its counter
+  underestimates its frequency by at most n/k. merge(s) adds the counters of
+  another summary, then subtracts the k-th largest counter from all counters
+  and discards those that are no longer positive, which preserves the same
+  guarantees for the combined input. This requires operator < on T.
+
+Time Complexity:
+- O(1) per call to majority_stream::add(x) and majority_stream::merge().
+- O(log k) amortized per call to heavy_hitters::add(x), since each counter can
+  only be decremented as many times as it was incremented.
+- O(k log k) per call to heavy_hitters::merge() and candidates().
+
+Space Complexity:
+- O(1) for majority_stream and O(k) for heavy_hitters.
+
+*/
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+
+template<class T>
+class majority_stream {
+  T cand;
+  long long count;
+
+ public:
+  majority_stream() : count(0) {}
+
+  void add(const T &x, long long times = 1) {
+    if (count == 0) {
+      cand = x;
+      count = times;
+    } else if (x == cand) {
+      count += times;
+    } else if (count >= times) {
+      count -= times;
+    } else {
+      cand = x;
+      count = times - count;
+    }
+  }
+
+  template<class It>
+  void add(It lo, It hi) {
+    for (; lo != hi; ++lo) {
+      add(*lo);
+    }
+  }
+
+  void merge(const majority_stream &s) {
+    if (s.count > 0) {
+      add(s.cand, s.count);
+    }
+  }
+
+  bool empty() const {
+    return count == 0;
+  }
+
+  const T &candidate() const {
+    return cand;
+  }
+};
+
+template<class T>
+class heavy_hitters {
+  typedef typename std::map<T, long long>::iterator iter;
+
+  int k;
+  long long total;
+  std::map<T, long long> counters;
+
+  void subtract(long long d) {
+    for (iter it = counters.begin(); it != counters.end(); ) {
+      if ((it->second -= d) <= 0) {
+        counters.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+ public:
+  heavy_hitters(int k) : k(k), total(0) {}
+
+  void add(const T &x) {
+    total++;
+    iter it = counters.find(x);
+    if (it != counters.end()) {
+      it->second++;
+    } else if ((int)counters.size() < k - 1) {
+      counters[x] = 1;
+    } else {
+      subtract(1);
+    }
+  }
+
+  template<class It>
+  void add(It lo, It hi) {
+    for (; lo != hi; ++lo) {
+      add(*lo);
+    }
+  }
+
+  void merge(const heavy_hitters &s) {
+    total += s.total;
+    typename std::map<T, long long>::const_iterator it;
+    for (it = s.counters.begin(); it != s.counters.end(); ++it) {
+      counters[it->first] += it->second;
+    }
+    if ((int)counters.size() >= k) {
+      std::vector<long long> c;
+      for (iter it = counters.begin(); it != counters.end(); ++it) {
+        c.push_back(it->second);
+      }
+      std::nth_element(c.begin(), c.begin() + (k - 1), c.end(),
+                       std::greater<long long>());
+      subtract(c[k - 1]);
+    }
+  }
+
+  long long size() const {
+    return total;
+  }
+
+  // Returns candidates with lower bounds on their frequencies.
+  std::vector<std::pair<T, long long> > candidates() const {
+    return std::vector<std::pair<T, long long> >(counters.begin(),
+                                                 counters.end());
+  }
+};
+
 /*** Example Usage ***/
 
 #include <cassert>
+using namespace std;
 
 int main() {
   int a[] = {3, 2, 3, 1, 3};
   assert(*majority(a, a + 5) == 3);
   int b[] = {2, 3, 3, 3, 2, 1};
   assert(majority(b, b + 6) == b + 6);
+
+  // Streaming in two chunks summarized separately.
+  majority_stream<int> s1, s2;
+  s1.add(a, a + 2);
+  s2.add(a + 2, a + 5);
+  s1.merge(s2);
+  assert(!s1.empty() && s1.candidate() == 3);
+
+  // 1 is the only element occurring more than n/3 times.
+  int c[] = {1, 4, 2, 1, 4, 3, 1, 4, 5, 1, 1, 6};
+  heavy_hitters<int> h1(3), h2(3);
+  h1.add(c, c + 6);
+  h2.add(c + 6, c + 12);
+  h1.merge(h2);
+  assert(h1.size() == 12);
+  vector<pair<int, long long> > res = h1.candidates();
+  assert(res.size() <= 2 && res[0].first == 1);
+  assert(5 - 12/3 <= res[0].second && res[0].second <= 5);
   return 0;
 }
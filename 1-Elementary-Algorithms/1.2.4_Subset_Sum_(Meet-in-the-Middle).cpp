@@ -54,6 +54,119 @@ long long sum_lower_bound(It lo, It hi, long long v) {
   return curr;
 }
 
+/*
+
+The computation of sum_lower_bound() is dominated by sorting each half's 2^(n/2)
+subset sums. Instead, sorted_subset_sums() generates them already sorted: after
+processing a prefix of the elements, the sorted sums of its subsets are merged
+with a copy of themselves shifted by the next element, which yields the sorted
+sums of the subsets of the longer prefix. Since the list doubles each time, the
+total work is linear in the final size, not a factor of n more.
+
+- sorted_subset_sums(lo, hi, &res, &buf) stores the 2^n sorted subset sums of
+  [lo, hi) in res, using buf as a second merge buffer. Both vectors are reused
+  if they already have enough capacity.
+- fast_sum_lower_bound(lo, hi, v) is equivalent to sum_lower_bound(), matching
+  the two sorted halves with a two-pointer sweep.
+- count_subsets_at_most(lo, hi, v) returns the number of subsets (including the
+  empty subset) with a sum less than or equal to v, without storing any of the
+  matching subsets.
+
+Both halves are generated concurrently as OpenMP sections; compile with
+-fopenmp to enable this.
+
+Time Complexity:
+- O(2^n) per call to sorted_subset_sums().
+- O(2^(n/2)) per call to fast_sum_lower_bound() and count_subsets_at_most().
+
+Space Complexity:
+- O(2^(n/2)) auxiliary heap space.
+
+*/
+
+template<class It>
+void sorted_subset_sums(It lo, It hi, std::vector<long long> *res,
+                        std::vector<long long> *buf) {
+  res->assign(1, 0);
+  buf->clear();
+  for (It it = lo; it != hi; ++it) {
+    long long x = *it;
+    int len = res->size();
+    buf->resize(2*len);
+    // Merge res with res + x, reading the shifted list as it is merged.
+    int i = 0, j = 0, k = 0;
+    const long long *a = &(*res)[0];
+    long long *out = &(*buf)[0];
+    while (i < len && j < len) {
+      out[k++] = (a[j] + x < a[i]) ? a[j++] + x : a[i++];
+    }
+    while (i < len) {
+      out[k++] = a[i++];
+    }
+    while (j < len) {
+      out[k++] = a[j++] + x;
+    }
+    res->swap(*buf);
+  }
+}
+
+template<class It>
+void sorted_half_sums(It lo, It hi, std::vector<long long> *lsum,
+                      std::vector<long long> *hsum) {
+  int half = (hi - lo)/2;
+#ifdef _OPENMP
+#pragma omp parallel sections
+#endif
+  {
+#ifdef _OPENMP
+#pragma omp section
+#endif
+    {
+      std::vector<long long> buf;
+      sorted_subset_sums(lo, lo + half, lsum, &buf);
+    }
+#ifdef _OPENMP
+#pragma omp section
+#endif
+    {
+      std::vector<long long> buf;
+      sorted_subset_sums(lo + half, hi, hsum, &buf);
+    }
+  }
+}
+
+template<class It>
+long long fast_sum_lower_bound(It lo, It hi, long long v) {
+  std::vector<long long> lsum, hsum;
+  sorted_half_sums(lo, hi, &lsum, &hsum);
+  int l = 0, h = (int)hsum.size() - 1, llen = lsum.size();
+  long long curr = std::numeric_limits<long long>::min();
+  while (l < llen && h >= 0) {
+    if (lsum[l] + hsum[h] <= v) {
+      curr = std::max(curr, lsum[l] + hsum[h]);
+      l++;
+    } else {
+      h--;
+    }
+  }
+  return curr;
+}
+
+template<class It>
+long long count_subsets_at_most(It lo, It hi, long long v) {
+  std::vector<long long> lsum, hsum;
+  sorted_half_sums(lo, hi, &lsum, &hsum);
+  long long res = 0;
+  int h = (int)hsum.size() - 1;
+  for (int l = 0; l < (int)lsum.size(); l++) {
+    while (h >= 0 && lsum[l] + hsum[h] > v) {
+      h--;
+    }
+    res += h + 1;
+  }
+  return res;
+}
+
 /*** Example Usage ***/
 
 #include <cassert>
@@ -63,5 +176,10 @@ int main() {
   assert(sum_lower_bound(a, a + 7, 8) == 7);
   int b[] = {-7, -3, -2, 5, 8};
   assert(sum_lower_bound(b, b + 5, 0) == 0);
+  assert(fast_sum_lower_bound(a, a + 7, 8) == 7);
+  assert(fast_sum_lower_bound(b, b + 5, 0) == 0);
+  // 16 of the 32 subsets of b have a nonpositive sum.
+  assert(count_subsets_at_most(b, b + 5, 0) == 16);
+  assert(count_subsets_at_most(a, a + 7, 1000) == 128);
   return 0;
 }
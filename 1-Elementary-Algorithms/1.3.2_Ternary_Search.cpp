@@ -13,12 +13,36 @@ returns a number x such that f is strictly increasing on the interval [lo, x]
 and strictly decreasing on the interval [x, hi]. For the function to be correct
 and deterministic, such an x must exist and be unique.
 
+golden_section_search_min() and golden_section_search_max() find the same
+points as the functions above, but place the two interior points at the golden
+ratio of the interval. After the interval shrinks, one of the points becomes an
+interior point of the new interval, so its value is reused and only one new
+call to f() is made per iteration rather than two. The interval shrinks by a
+factor of about 0.618 per call instead of 0.816, which makes these preferable
+when f() is expensive.
+
+k_section_search_min() and k_section_search_max() evaluate f() at k >= 2 evenly
+spaced interior points at once, in parallel, and shrink the interval to the two
+grid cells around the best point, i.e. by a factor of 2/(k + 1) per round. This
+makes more calls to f() in total, but fewer rounds, so it finishes sooner in
+wall-clock time when f() is expensive and enough threads are available. f()
+must be safe to call concurrently. Compile with -fopenmp to enable; otherwise
+the points are evaluated serially.
+
+make_counted(f, &count) wraps a function so that every call increments
+count, which may be used to measure the number of evaluations made by any of
+the searches above. The count is safely updated from parallel calls.
+
 Time Complexity:
-- O(log n) calls will be made to f(), where n is the distance between lo and hi
-  divided by the specified absolute error (epsilon).
+- O(log n) calls will be made to f() by the ternary and golden section
+  searches, where n is the distance between lo and hi divided by the specified
+  absolute error (epsilon).
+- O(log n / log((k + 1)/2)) rounds of k parallel calls will be made to f() by
+  the k-section searches.
 
 Space Complexity:
-- O(1) auxiliary for both operations.
+- O(1) auxiliary for the ternary and golden section searches.
+- O(k) auxiliary for the k-section searches.
 
 */
 
@@ -54,10 +78,120 @@ double ternary_search_max(double lo, double hi, UnimodalFunction f,
   return hi;
 }
 
+#include <cmath>
+#include <vector>
+
+template<class UnimodalFunction>
+double golden_section_search_min(double lo, double hi, UnimodalFunction f,
+                                 const double EPS = 1e-12) {
+  const double r = (sqrt(5.0) - 1)/2;
+  double x1 = hi - r*(hi - lo), x2 = lo + r*(hi - lo);
+  double f1 = f(x1), f2 = f(x2);
+  while (hi - lo > EPS) {
+    if (f1 < f2) {
+      hi = x2;
+      x2 = x1;
+      f2 = f1;
+      x1 = hi - r*(hi - lo);
+      f1 = f(x1);
+    } else {
+      lo = x1;
+      x1 = x2;
+      f1 = f2;
+      x2 = lo + r*(hi - lo);
+      f2 = f(x2);
+    }
+  }
+  return lo;
+}
+
+template<class UnimodalFunction>
+double golden_section_search_max(double lo, double hi, UnimodalFunction f,
+                                 const double EPS = 1e-12) {
+  const double r = (sqrt(5.0) - 1)/2;
+  double x1 = hi - r*(hi - lo), x2 = lo + r*(hi - lo);
+  double f1 = f(x1), f2 = f(x2);
+  while (hi - lo > EPS) {
+    if (f1 < f2) {
+      lo = x1;
+      x1 = x2;
+      f1 = f2;
+      x2 = lo + r*(hi - lo);
+      f2 = f(x2);
+    } else {
+      hi = x2;
+      x2 = x1;
+      f2 = f1;
+      x1 = hi - r*(hi - lo);
+      f1 = f(x1);
+    }
+  }
+  return hi;
+}
+
+template<class UnimodalFunction>
+double k_section_search(double lo, double hi, UnimodalFunction f, int k,
+                        double EPS, bool maximize) {
+  std::vector<double> x(k + 2), y(k + 2);
+  while (hi - lo > EPS) {
+    for (int i = 0; i <= k + 1; i++) {
+      x[i] = lo + (hi - lo)*i/(k + 1);
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int i = 1; i <= k; i++) {
+      y[i] = f(x[i]);
+    }
+    int best = 1;
+    for (int i = 2; i <= k; i++) {
+      if (maximize ? (y[best] < y[i]) : (y[i] < y[best])) {
+        best = i;
+      }
+    }
+    lo = x[best - 1];
+    hi = x[best + 1];
+  }
+  return maximize ? hi : lo;
+}
+
+template<class UnimodalFunction>
+double k_section_search_min(double lo, double hi, UnimodalFunction f, int k,
+                            const double EPS = 1e-12) {
+  return k_section_search(lo, hi, f, k, EPS, false);
+}
+
+template<class UnimodalFunction>
+double k_section_search_max(double lo, double hi, UnimodalFunction f, int k,
+                            const double EPS = 1e-12) {
+  return k_section_search(lo, hi, f, k, EPS, true);
+}
+
+template<class Function>
+class counted_function {
+  Function f;
+  long long *count;
+
+ public:
+  counted_function(Function f, long long *count) : f(f), count(count) {}
+
+  double operator()(double x) {
+#ifdef _OPENMP
+    #pragma omp atomic
+#endif
+    (*count)++;
+    return f(x);
+  }
+};
+
+template<class Function>
+counted_function<Function> make_counted(Function f, long long *count) {
+  return counted_function<Function>(f, count);
+}
+
 /*** Example Usage ***/
 
 #include <cassert>
-#include <cmath>
 
 bool equal(double a, double b) {
   return fabs(a - b) < 1e-7;
@@ -82,5 +216,18 @@ int main() {
   assert(equal(ternary_search_min(-1000, 1000, f1), -2));
   assert(equal(ternary_search_max(-1000, 1000, f2), 2.0/19));
   assert(equal(ternary_search_min(-1000, 1000, f3), 30));
+  assert(equal(golden_section_search_min(-1000, 1000, f1), -2));
+  assert(equal(golden_section_search_max(-1000, 1000, f2), 2.0/19));
+  assert(equal(golden_section_search_min(-1000, 1000, f3), 30));
+  for (int k = 2; k <= 9; k++) {
+    assert(equal(k_section_search_min(-1000, 1000, f1, k), -2));
+    assert(equal(k_section_search_max(-1000, 1000, f2, k), 2.0/19));
+    assert(equal(k_section_search_min(-1000, 1000, f3, k), 30));
+  }
+
+  long long ternary_calls = 0, golden_calls = 0;
+  ternary_search_min(-1000, 1000, make_counted(f1, &ternary_calls));
+  golden_section_search_min(-1000, 1000, make_counted(f1, &golden_calls));
+  assert(golden_calls < ternary_calls/2);
   return 0;
 }
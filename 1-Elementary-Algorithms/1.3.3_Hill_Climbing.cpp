@@ -13,27 +13,62 @@ and the same process repeats until a desired absolute error is reached. The
 technique's success heavily depends on the behavior of f and the initial guess.
 Therefore, the result is not guaranteed to be the global minimum.
 
+The step size schedule may be customized by passing a schedule object, which
+is called as schedule(step) to get the reduced step size whenever no direction
+improves the answer. geometric_schedule(r) multiplies the step by a factor of
+r in (0, 1) each time, with the default find_min() using r = 0.5.
+
+multi_start_find_min() runs independent climbs from num_starts initial guesses
+in the rectangle [xlo, xhi] by [ylo, yhi], returning the best minimum found by
+any of them. The guesses are drawn by Latin hypercube sampling, so that their
+projections onto each axis fall into distinct strips of equal width, spreading
+them more evenly than independent uniform draws would. Climbs are run in
+parallel using OpenMP. Compile with -fopenmp to enable; otherwise they run
+serially. Once a climb's step size falls to prune_step or below, it is taken to
+be settled into its local basin, and it is cancelled if its value is then worse
+than the best value found so far by any finished climb. f must be safe to call
+concurrently. Initial guesses are generated using rand(), so srand() may be
+used to vary them between runs.
+
 Time Complexity:
 - O(d log n) call will be made to f, where d is the number of directions
   considered at each position and n is the search space that is approximately
   proportional to the maximum possible step size divided by the minimum possible
   step size.
+- O(k d log n) calls will be made to f by multi_start_find_min(), where k is
+  the number of starts, spread over the available threads.
 
 Space Complexity:
-- O(1) auxiliary.
+- O(1) auxiliary for find_min().
+- O(k) auxiliary for multi_start_find_min().
 
 */
 
+#include <algorithm>
 #include <cstddef>
 #include <cmath>
+#include <cstdlib>
+#include <vector>
 
-template<class ContinuousFunction>
-double find_min(ContinuousFunction f, double x0, double y0,
-                double *critical_x = NULL, double *critical_y = NULL,
-                const double STEP_MIN = 1e-9, const double STEP_MAX = 1e6,
-                const int NUM_DIRECTIONS = 6) {
+struct geometric_schedule {
+  double ratio;
+
+  explicit geometric_schedule(double ratio = 0.5) : ratio(ratio) {}
+
+  double operator()(double step) const {
+    return step*ratio;
+  }
+};
+
+// Climbs from (x, y) with current value res. If best_so_far is not NULL, the
+// climb stops early once the step is at most prune_step and res is worse than
+// *best_so_far. Returns false if the climb was stopped early.
+template<class ContinuousFunction, class StepSchedule>
+bool hill_climb(ContinuousFunction f, double &x, double &y, double &res,
+                StepSchedule schedule, const double STEP_MIN,
+                const double STEP_MAX, const int NUM_DIRECTIONS,
+                const double *best_so_far = NULL, double prune_step = 0) {
   static const double PI = acos(-1.0);
-  double x = x0, y = y0, res = f(x0, y0);
   for (double step = STEP_MAX; step > STEP_MIN; ) {
     double best = res, best_x = x, best_y = y;
     bool found = false;
@@ -49,13 +84,34 @@ double find_min(ContinuousFunction f, double x0, double y0,
       }
     }
     if (!found) {
-      step /= 2.0;
+      step = schedule(step);
+      if (best_so_far != NULL && step <= prune_step) {
+        bool dominated;
+#ifdef _OPENMP
+        #pragma omp critical(hill_climb_best)
+#endif
+        dominated = (*best_so_far < res);
+        if (dominated) {
+          return false;
+        }
+      }
     } else {
       x = best_x;
       y = best_y;
       res = best;
     }
   }
+  return true;
+}
+
+template<class ContinuousFunction, class StepSchedule>
+double find_min(ContinuousFunction f, double x0, double y0,
+                StepSchedule schedule,
+                double *critical_x = NULL, double *critical_y = NULL,
+                const double STEP_MIN = 1e-9, const double STEP_MAX = 1e6,
+                const int NUM_DIRECTIONS = 6) {
+  double x = x0, y = y0, res = f(x0, y0);
+  hill_climb(f, x, y, res, schedule, STEP_MIN, STEP_MAX, NUM_DIRECTIONS);
   if (critical_x != NULL && critical_y != NULL) {
     *critical_x = x;
     *critical_y = y;
@@ -63,6 +119,73 @@ double find_min(ContinuousFunction f, double x0, double y0,
   return res;
 }
 
+template<class ContinuousFunction>
+double find_min(ContinuousFunction f, double x0, double y0,
+                double *critical_x = NULL, double *critical_y = NULL,
+                const double STEP_MIN = 1e-9, const double STEP_MAX = 1e6,
+                const int NUM_DIRECTIONS = 6) {
+  return find_min(f, x0, y0, geometric_schedule(), critical_x, critical_y,
+                  STEP_MIN, STEP_MAX, NUM_DIRECTIONS);
+}
+
+template<class ContinuousFunction, class StepSchedule>
+double multi_start_find_min(ContinuousFunction f, double xlo, double xhi,
+                            double ylo, double yhi, int num_starts,
+                            StepSchedule schedule,
+                            double *critical_x = NULL,
+                            double *critical_y = NULL,
+                            const double STEP_MIN = 1e-9,
+                            const double PRUNE_STEP = 1e-3,
+                            const int NUM_DIRECTIONS = 6) {
+  std::vector<double> xs(num_starts), ys(num_starts);
+  std::vector<int> strip(num_starts);
+  for (int i = 0; i < num_starts; i++) {
+    strip[i] = i;
+  }
+  for (int i = num_starts - 1; i > 0; i--) {
+    std::swap(strip[i], strip[rand() % (i + 1)]);
+  }
+  for (int i = 0; i < num_starts; i++) {
+    double u = (double)rand()/RAND_MAX, v = (double)rand()/RAND_MAX;
+    xs[i] = xlo + (xhi - xlo)*(i + u)/num_starts;
+    ys[i] = ylo + (yhi - ylo)*(strip[i] + v)/num_starts;
+  }
+  // Start each climb at about the spacing between the initial guesses.
+  double step_max = std::max(xhi - xlo, yhi - ylo)/num_starts;
+  double best = HUGE_VAL, best_x = xlo, best_y = ylo;
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (int i = 0; i < num_starts; i++) {
+    double x = xs[i], y = ys[i], res = f(x, y);
+    if (hill_climb(f, x, y, res, schedule, STEP_MIN, step_max,
+                   NUM_DIRECTIONS, &best, PRUNE_STEP)) {
+#ifdef _OPENMP
+      #pragma omp critical(hill_climb_best)
+#endif
+      if (res < best) {
+        best = res;
+        best_x = x;
+        best_y = y;
+      }
+    }
+  }
+  if (critical_x != NULL && critical_y != NULL) {
+    *critical_x = best_x;
+    *critical_y = best_y;
+  }
+  return best;
+}
+
+template<class ContinuousFunction>
+double multi_start_find_min(ContinuousFunction f, double xlo, double xhi,
+                            double ylo, double yhi, int num_starts,
+                            double *critical_x = NULL,
+                            double *critical_y = NULL) {
+  return multi_start_find_min(f, xlo, xhi, ylo, yhi, num_starts,
+                              geometric_schedule(), critical_x, critical_y);
+}
+
 /*** Example Usage ***/
 
 #include <cassert>
@@ -77,9 +200,19 @@ double f(double x, double y) {
   return (x - 2)*(x - 2) + (y - 3)*(y - 3);
 }
 
+// Many local minima, with the global minimum at g(7, -4) = -2.
+double g(double x, double y) {
+  double dx = x - 7, dy = y + 4;
+  return 0.05*(dx*dx + dy*dy) - cos(2*dx) - cos(2*dy);
+}
+
 int main() {
   double x, y;
   assert(eq(find_min(f, 0, 0, &x, &y), 0));
   assert(eq(x, 2) && eq(y, 3));
+  assert(eq(find_min(f, 0, 0, geometric_schedule(0.7), &x, &y), 0));
+  assert(eq(x, 2) && eq(y, 3));
+  assert(eq(multi_start_find_min(g, -10, 10, -10, 10, 64, &x, &y), -2));
+  assert(eq(x, 7) && eq(y, -4));
   return 0;
 }
@@ -11,7 +11,21 @@ hull optimization technique. It supports an an interlaced sequence of add_line()
 and query() calls, as long as the preconditions of descending m and ascending x
 are satisfied. As a result, it may be necessary to sort the lines and queries
 before calling the functions. In that case, the overall time complexity will be
-dominated by the sorting step.
+dominated by the sorting step. If only the lines are sorted, query_any(x) may
+be called with x in any order instead, binary searching the hull for the line
+that is optimal at x. Each monotone_hull_optimizer instance maintains its own
+hull, so several may be used at once (e.g. one per layer of a DP).
+
+li_chao_tree is an alternative for when the lines cannot be added in order of
+slope. It is a segment tree over the integer x-coordinates [lo, hi] in which
+every node stores the line that is minimal at the middle of its range among
+the lines that have reached the node. Adding a line keeps the better of the
+new and the stored line at each node visited and pushes the other one down to
+the only child range in which it can still be better, so add_line() and
+query() each visit one root-to-leaf path. Nodes are created on demand in a
+single vector, so memory is proportional to the number of lines rather than to
+the range of x-coordinates. query() returns LLONG_MAX if no line has been added.
+For maximum queries, negate m and b of every line as well as the answer.
 
 Time Complexity:
 - O(n) for any interlaced sequence of add_line() and query() calls, where n is
@@ -19,53 +33,179 @@ Time Complexity:
   by add_line() and query() are respectively bounded by the number of lines.
   Thus a single call to either add_line() or query() will have an amortized O(1)
   running time.
+- O(log n) per call to query_any(x).
+- O(log(hi - lo)) per call to li_chao_tree::add_line() and query().
 
 Space Complexity:
 - O(n) for storage of the lines.
-- O(1) auxiliary for add_line() and query().
+- O(1) auxiliary for all operations.
 
 */
 
+#include <algorithm>
+#include <climits>
 #include <vector>
 
-std::vector<long long> M, B;
-int ptr = 0;
+class monotone_hull_optimizer {
+  std::vector<long long> M, B;
+  int ptr;
 
-void add_line(long long m, long long b) {
-  int len = M.size();
-  while (len > 1 && (B[len - 2] - B[len - 1])*(m - M[len - 1]) >=
-                    (B[len - 1] - b)*(M[len - 1] - M[len - 2])) {
-    len--;
+  long long value(int i, long long x) const {
+    return M[i]*x + B[i];
   }
-  M.resize(len);
-  B.resize(len);
-  M.push_back(m);
-  B.push_back(b);
-}
 
-long long query(long long x) {
-  if (ptr >= (int)M.size()) {
-    ptr = (int)M.size() - 1;
+ public:
+  monotone_hull_optimizer() : ptr(0) {}
+
+  void add_line(long long m, long long b) {
+    int len = M.size();
+    while (len > 1 && (B[len - 2] - B[len - 1])*(m - M[len - 1]) >=
+                      (B[len - 1] - b)*(M[len - 1] - M[len - 2])) {
+      len--;
+    }
+    M.resize(len);
+    B.resize(len);
+    M.push_back(m);
+    B.push_back(b);
   }
-  while (ptr + 1 < (int)M.size() &&
-         M[ptr + 1]*x + B[ptr + 1] <= M[ptr]*x + B[ptr]) {
-    ptr++;
+
+  long long query(long long x) {
+    if (ptr >= (int)M.size()) {
+      ptr = (int)M.size() - 1;
+    }
+    while (ptr + 1 < (int)M.size() && value(ptr + 1, x) <= value(ptr, x)) {
+      ptr++;
+    }
+    return value(ptr, x);
   }
-  return M[ptr]*x + B[ptr];
-}
+
+  long long query_any(long long x) const {
+    int lo = 0, hi = (int)M.size() - 1;
+    while (lo < hi) {
+      int mid = lo + (hi - lo)/2;
+      if (value(mid + 1, x) <= value(mid, x)) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return value(lo, x);
+  }
+};
+
+class li_chao_tree {
+  struct node {
+    long long m, b;
+    int left, right;
+
+    node(long long m, long long b) : m(m), b(b), left(-1), right(-1) {}
+
+    long long value(long long x) const {
+      return m*x + b;
+    }
+  };
+
+  long long lo, hi;
+  std::vector<node> nodes;
+
+ public:
+  li_chao_tree(long long lo, long long hi) : lo(lo), hi(hi) {}
+
+  void add_line(long long m, long long b) {
+    node l(m, b);
+    if (nodes.empty()) {
+      nodes.push_back(l);
+      return;
+    }
+    int i = 0;
+    for (long long a = lo, c = hi; ; ) {
+      long long mid = a + (c - a)/2;
+      node &n = nodes[i];
+      bool better_lo = l.value(a) < n.value(a);
+      if (l.value(mid) < n.value(mid)) {
+        std::swap(l.m, n.m);
+        std::swap(l.b, n.b);
+        better_lo = !better_lo;
+      }
+      if (a == c) {
+        return;
+      }
+      int &child = better_lo ? n.left : n.right;
+      if (better_lo) {
+        c = mid;
+      } else {
+        a = mid + 1;
+      }
+      if (child == -1) {
+        child = nodes.size();
+        nodes.push_back(l);
+        return;
+      }
+      i = child;
+    }
+  }
+
+  long long query(long long x) const {
+    long long res = LLONG_MAX;
+    int i = nodes.empty() ? -1 : 0;
+    for (long long a = lo, c = hi; i != -1; ) {
+      res = std::min(res, nodes[i].value(x));
+      long long mid = a + (c - a)/2;
+      if (x <= mid) {
+        c = mid;
+        i = nodes[i].left;
+      } else {
+        a = mid + 1;
+        i = nodes[i].right;
+      }
+    }
+    return res;
+  }
+};
 
 /*** Example Usage ***/
 
 #include <cassert>
+#include <cstdlib>
+using namespace std;
 
 int main() {
-  add_line(3, 0);
-  add_line(2, 1);
-  add_line(1, 2);
-  add_line(0, 6);
-  assert(query(0) == 0);
-  assert(query(1) == 3);
-  assert(query(2) == 4);
-  assert(query(3) == 5);
+  monotone_hull_optimizer h;
+  h.add_line(3, 0);
+  h.add_line(2, 1);
+  h.add_line(1, 2);
+  h.add_line(0, 6);
+  assert(h.query_any(3) == 5);
+  assert(h.query_any(1) == 3);
+  assert(h.query(0) == 0);
+  assert(h.query(1) == 3);
+  assert(h.query(2) == 4);
+  assert(h.query(3) == 5);
+
+  li_chao_tree t(-100, 100);
+  assert(t.query(0) == LLONG_MAX);
+  t.add_line(0, 6);
+  t.add_line(2, 1);
+  t.add_line(3, 0);
+  t.add_line(1, 2);
+  assert(t.query(3) == 5);
+  assert(t.query(0) == 0);
+  assert(t.query(2) == 4);
+  assert(t.query(1) == 3);
+
+  for (int tests = 0; tests < 100; tests++) {
+    li_chao_tree t(-1000, 1000);
+    vector<long long> ms, bs;
+    for (int i = 0; i < 50; i++) {
+      ms.push_back(rand() % 200 - 100);
+      bs.push_back(rand() % 20000 - 10000);
+      t.add_line(ms[i], bs[i]);
+      long long x = rand() % 2001 - 1000, best = ms[0]*x + bs[0];
+      for (int j = 1; j <= i; j++) {
+        best = min(best, ms[j]*x + bs[j]);
+      }
+      assert(t.query(x) == best);
+    }
+  }
   return 0;
 }
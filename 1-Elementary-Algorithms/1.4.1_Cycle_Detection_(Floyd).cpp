@@ -1,6 +1,6 @@
 /*
 
-Given a function f mapping a set of integers to itself and an x-coordinate in
+Given a function f mapping a set of values to itself and an initial value in
 the set, return a pair containing the (position, length) of a cycle in the
 sequence of numbers obtained from repeatedly composing f with itself starting
 with the initial x. Formally, since f maps a finite set S to itself, some value
@@ -20,32 +20,51 @@ forward and the "hare" two steps forward in the sequence, comparing the sequence
 values at each step. The first value which is simultaneously pointed to by both
 pointers is the start of the sequence.
 
+The values may be of any type T supporting operator== and operator!=, such as
+64-bit integers or user-defined states. Positions and lengths are returned as
+64-bit integers.
+
+find_cycle_nivasch() implements Nivasch's stack algorithm, which additionally
+requires T to support operator<. A stack of (value, index) pairs is maintained
+with values increasing from bottom to top. For each new value, larger values
+are popped, and the cycle is detected once the top of the stack holds the same
+value. This happens once the smallest value in the cycle is seen for a second
+time, within m + 2n steps, and the difference in indices gives the length n
+exactly. The stack entry below the top, if any, holds a value smaller than any
+in the cycle, so it is a point before the start of the cycle from which the
+cycle start is located, rather than walking again from the initial value. The
+expected size of the stack is O(log(m + n)) for random f.
+
 Time Complexity:
-- O(m + n) per call to find_cycle_floyd(), where m is the smallest index of the
-  sequence which is the beginning of a cycle, and n is the cycle's length.
+- O(m + n) per call to find_cycle_floyd() and find_cycle_nivasch(), where m is
+  the smallest index of the sequence which is the beginning of a cycle, and n
+  is the cycle's length.
 
 Space Complexity:
-- O(1) auxiliary.
+- O(1) auxiliary for find_cycle_floyd().
+- O(m + n) auxiliary in the worst case for find_cycle_nivasch(), but expected
+  O(log(m + n)) for random f.
 
 */
 
 #include <utility>
+#include <vector>
 
-template<class IntFunction>
-std::pair<int, int> find_cycle_floyd(IntFunction f, int x0) {
-  int tortoise = f(x0), hare = f(f(x0));
+template<class T, class Function>
+std::pair<long long, long long> find_cycle_floyd(Function f, T x0) {
+  T tortoise = f(x0), hare = f(f(x0));
   while (tortoise != hare) {
     tortoise = f(tortoise);
     hare = f(f(hare));
   }
-  int start = 0;
+  long long start = 0;
   tortoise = x0;
   while (tortoise != hare) {
     tortoise = f(tortoise);
     hare = f(hare);
     start++;
   }
-  int length = 1;
+  long long length = 1;
   hare = f(tortoise);
   while (tortoise != hare) {
     hare = f(hare);
@@ -54,6 +73,39 @@ std::pair<int, int> find_cycle_floyd(IntFunction f, int x0) {
   return std::make_pair(start, length);
 }
 
+template<class T, class Function>
+std::pair<long long, long long> find_cycle_nivasch(Function f, T x0) {
+  std::vector<std::pair<T, long long> > stack;
+  T x = x0;
+  long long i = 0;
+  for (;; i++) {
+    while (!stack.empty() && x < stack.back().first) {
+      stack.pop_back();
+    }
+    if (!stack.empty() && !(stack.back().first < x)) {
+      break;
+    }
+    stack.push_back(std::make_pair(x, i));
+    x = f(x);
+  }
+  long long start = 0, length = i - stack.back().second;
+  T tortoise = x0;
+  if (stack.size() > 1) {
+    tortoise = stack[stack.size() - 2].first;
+    start = stack[stack.size() - 2].second;
+  }
+  T hare = tortoise;
+  for (long long j = 0; j < length; j++) {
+    hare = f(hare);
+  }
+  while (tortoise != hare) {
+    tortoise = f(tortoise);
+    hare = f(hare);
+    start++;
+  }
+  return std::make_pair(start, length);
+}
+
 /*** Example Usage ***/
 
 #include <cassert>
@@ -82,10 +134,20 @@ void verify(int x0, int start, int length) {
   assert(startx == x);
 }
 
+// 64-bit linear congruential generator truncated to 40 bits.
+unsigned long long g(unsigned long long x) {
+  return (x*6364136223846793005ULL + 1442695040888963407ULL) >> 24;
+}
+
 int main () {
   int x0 = 0;
-  pair<int, int> res = find_cycle_floyd(f, x0);
-  assert(res == make_pair(4, 2));
+  pair<long long, long long> res = find_cycle_floyd(f, x0);
+  assert(res == make_pair(4LL, 2LL));
   verify(x0, res.first, res.second);
+  for (int i = 0; i < 1337; i++) {
+    assert(find_cycle_nivasch(f, i) == find_cycle_floyd(f, i));
+  }
+  unsigned long long y0 = 12345;
+  assert(find_cycle_nivasch(g, y0) == find_cycle_floyd(g, y0));
   return 0;
 }
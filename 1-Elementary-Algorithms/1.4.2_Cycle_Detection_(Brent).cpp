@@ -1,6 +1,6 @@
 /*
 
-Given a function f mapping a set of integers to itself and an x-coordinate in
+Given a function f mapping a set of values to itself and an initial value in
 the set, return a pair containing the (position, length) of a cycle in the
 sequence of numbers obtained from repeatedly composing f with itself starting
 with the initial x. Formally, since f maps a finite set S to itself, some value
@@ -20,20 +20,54 @@ power of two. The smallest power of two at which they meet is the start of the
 first cycle. This improves upon the constant factor of Floyd's algorithm by
 reducing the number of calls made to f.
 
+The values may be of any type T supporting operator== and operator!=, such as
+64-bit integers or user-defined states. Positions and lengths are returned as
+64-bit integers.
+
+find_cycles_brent() runs the same algorithm on many initial values [lo, hi),
+writing the resulting pairs in the same order to the output iterator out. The
+searches advance in lanes of interleaved state machines, each taking one step
+per round, so that the calls to f for up to lanes searches are independent of
+each other and may overlap (e.g. when f is memory bound). Each lane is refilled
+with the next initial value as soon as its search finishes.
+
+find_collision() uses parallel collision search with distinguished points to
+find two distinct values a and b such that f(a) = f(b), additionally requiring
+T to support operator<. Starting from each of the initial values in the random
+access range [lo, hi), a trail is followed until it reaches a value x
+for which is_distinguished(x) is true, and the trail's start and length are
+recorded in a table keyed by x that is shared by all threads. Once two trails
+with different starts reach the same distinguished point, they must have
+merged, so the longer trail is advanced until both are the same distance from
+the point, and then both are advanced together until the step before they
+meet. Trails that do not reach a distinguished point within max_length steps
+(e.g. because they enter a cycle with none) are abandoned. The function returns
+whether a collision was found, storing it in *a and *b. Trails are followed in
+parallel using OpenMP. Compile with -fopenmp to enable; otherwise they run
+serially.
+
 Time Complexity:
 - O(m + n) per call to find_cycle_brent(), where m is the smallest index of the
   sequence which is the beginning of a cycle, and n is the cycle's length.
+- O(m + n) per initial value for find_cycles_brent().
+- O(1/d) expected calls to f() per trail for find_collision(), where d is the
+  fraction of values that are distinguished, plus O(max_length) calls to
+  locate the collision. Each table access takes O(log t), where t is the
+  number of trails which have reached a distinguished point.
 
 Space Complexity:
-- O(1) auxiliary.
+- O(1) auxiliary for find_cycle_brent().
+- O(lanes) auxiliary for find_cycles_brent().
+- O(t) auxiliary for find_collision().
 
 */
 
 #include <utility>
 
-template<class IntFunction>
-std::pair<int, int> find_cycle_brent(IntFunction f, int x0) {
-  int power = 1, length = 1, tortoise = x0, hare = f(x0);
+template<class T, class Function>
+std::pair<long long, long long> find_cycle_brent(Function f, T x0) {
+  long long power = 1, length = 1;
+  T tortoise = x0, hare = f(x0);
   while (tortoise != hare) {
     if (power == length) {
       tortoise = hare;
@@ -44,10 +78,10 @@ std::pair<int, int> find_cycle_brent(IntFunction f, int x0) {
     length++;
   }
   hare = x0;
-  for (int i = 0; i < length; i++) {
+  for (long long i = 0; i < length; i++) {
     hare = f(hare);
   }
-  int start = 0;
+  long long start = 0;
   tortoise = x0;
   while (tortoise != hare) {
     tortoise = f(tortoise);
@@ -57,9 +91,158 @@ std::pair<int, int> find_cycle_brent(IntFunction f, int x0) {
   return std::make_pair(start, length);
 }
 
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <vector>
+
+template<class T>
+struct brent_lane {
+  enum { FIND_LENGTH, ADVANCE_HARE, FIND_START, IDLE };
+  int phase, index;
+  T x0, tortoise, hare;
+  long long power, length, steps;
+
+  brent_lane() : phase(IDLE) {}
+};
+
+template<class Function, class It, class OutIt>
+OutIt find_cycles_brent(Function f, It lo, It hi, OutIt out,
+                        const int lanes = 16) {
+  typedef brent_lane<typename std::iterator_traits<It>::value_type> lane;
+  std::vector<lane> l(lanes);
+  std::vector<std::pair<long long, long long> > res(std::distance(lo, hi));
+  int active = 0, next = 0;
+  do {
+    for (int j = 0; j < lanes; j++) {
+      lane &c = l[j];
+      if (c.phase == lane::IDLE) {
+        if (lo == hi) {
+          continue;
+        }
+        c.index = next++;
+        c.x0 = c.tortoise = *lo++;
+        c.hare = f(c.x0);
+        c.power = c.length = 1;
+        c.phase = lane::FIND_LENGTH;
+        active++;
+      }
+      if (c.phase == lane::FIND_LENGTH) {
+        if (c.tortoise != c.hare) {
+          if (c.power == c.length) {
+            c.tortoise = c.hare;
+            c.power *= 2;
+            c.length = 0;
+          }
+          c.hare = f(c.hare);
+          c.length++;
+          continue;
+        }
+        c.hare = c.x0;
+        c.steps = 0;
+        c.phase = lane::ADVANCE_HARE;
+      }
+      if (c.phase == lane::ADVANCE_HARE) {
+        if (c.steps < c.length) {
+          c.hare = f(c.hare);
+          c.steps++;
+          continue;
+        }
+        c.tortoise = c.x0;
+        c.steps = 0;
+        c.phase = lane::FIND_START;
+      }
+      if (c.tortoise != c.hare) {
+        c.tortoise = f(c.tortoise);
+        c.hare = f(c.hare);
+        c.steps++;
+      } else {
+        res[c.index] = std::make_pair(c.steps, c.length);
+        c.phase = lane::IDLE;
+        active--;
+      }
+    }
+  } while (active > 0);
+  return std::copy(res.begin(), res.end(), out);
+}
+
+template<class Function, class DistinguishedPredicate, class It, class T>
+bool find_collision(Function f, DistinguishedPredicate is_distinguished,
+                    It lo, It hi, T *a, T *b,
+                    const long long max_length = 1 << 20) {
+  // Maps each distinguished point to the start and length of its trail.
+  typedef std::map<T, std::pair<T, long long> > table;
+  table trails;
+  bool found = false;
+  int n = hi - lo;
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (int i = 0; i < n; i++) {
+    T start = lo[i];
+    bool done;
+#ifdef _OPENMP
+    #pragma omp critical(find_collision)
+#endif
+    done = found;
+    if (done) {
+      continue;
+    }
+    T x = start;
+    long long length = 0;
+    while (!is_distinguished(x) && length < max_length) {
+      x = f(x);
+      length++;
+    }
+    if (length == max_length) {
+      continue;
+    }
+    std::pair<T, long long> other(start, length);
+#ifdef _OPENMP
+    #pragma omp critical(find_collision)
+#endif
+    {
+      typename table::iterator it = trails.find(x);
+      if (it == trails.end()) {
+        trails[x] = other;
+      } else {
+        other = it->second;
+      }
+    }
+    if (other.first == start) {
+      continue;
+    }
+    T u = start, v = other.first;
+    for (; length > other.second; length--) {
+      u = f(u);
+    }
+    for (long long len = other.second; len > length; len--) {
+      v = f(v);
+    }
+    // One trail started on the other, so they never meet from two values.
+    if (u == v) {
+      continue;
+    }
+    while (f(u) != f(v)) {
+      u = f(u);
+      v = f(v);
+    }
+#ifdef _OPENMP
+    #pragma omp critical(find_collision)
+#endif
+    if (!found) {
+      found = true;
+      *a = u;
+      *b = v;
+    }
+  }
+  return found;
+}
+
 /*** Example Usage ***/
 
 #include <cassert>
+#include <iterator>
 #include <set>
 using namespace std;
 
@@ -67,6 +250,10 @@ int f(int x) {
   return (123*x*x + 4567890) % 1337;
 }
 
+bool is_distinguished(int x) {
+  return x % 8 == 0;
+}
+
 void verify(int x0, int start, int length) {
   set<int> s;
   int x = x0;
@@ -85,10 +272,43 @@ void verify(int x0, int start, int length) {
   assert(startx == x);
 }
 
+// 64-bit linear congruential generator truncated to 40 bits.
+unsigned long long g(unsigned long long x) {
+  return (x*6364136223846793005ULL + 1442695040888963407ULL) >> 24;
+}
+
+bool g_is_distinguished(unsigned long long x) {
+  return (x & 0xfff) == 0;
+}
+
 int main () {
   int x0 = 0;
-  pair<int, int> res = find_cycle_brent(f, x0);
-  assert(res == make_pair(4, 2));
+  pair<long long, long long> res = find_cycle_brent(f, x0);
+  assert(res == make_pair(4LL, 2LL));
   verify(x0, res.first, res.second);
+
+  vector<int> seeds;
+  vector<pair<long long, long long> > results;
+  for (int i = 0; i < 1337; i++) {
+    seeds.push_back(i);
+  }
+  find_cycles_brent(f, seeds.begin(), seeds.end(), back_inserter(results));
+  for (int i = 0; i < 1337; i++) {
+    assert(results[i] == find_cycle_brent(f, i));
+  }
+
+  int a, b;
+  assert(find_collision(f, is_distinguished, seeds.begin(),
+                        seeds.begin() + 100, &a, &b));
+  assert(a != b && f(a) == f(b));
+
+  vector<unsigned long long> seeds64;
+  for (int i = 0; i < 4096; i++) {
+    seeds64.push_back(i);
+  }
+  unsigned long long c, d;
+  assert(find_collision(g, g_is_distinguished, seeds64.begin(), seeds64.end(),
+                        &c, &d));
+  assert(c != d && g(c) == g(d));
   return 0;
 }
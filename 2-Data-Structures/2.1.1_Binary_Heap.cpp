@@ -6,20 +6,56 @@ ordering on the set of possible elements defined by the < operator. A binary
 min-heap implements a priority queue by inserting and deleting nodes into a
 binary tree such that the parent of any node is always less than its children.
 
+The arity D of the tree may be chosen at compile time, with D = 2 by default.
+A larger D makes the tree shallower and pushes cheaper, at the cost of more
+comparisons per level during pops. D = 4 or 8 is often fastest in practice,
+since all D children of a node are adjacent in memory. The elements are stored
+after D - 1 unused slots, so that the children of every node start at a
+multiple of D from the start of the array, and never straddle a boundary of
+D*sizeof(T) bytes relative to it (e.g. a 64-byte cache line for D = 16 on
+4-byte elements when the array itself is aligned). The padding requires T to
+be default constructible.
+
 - binary_heap() constructs an empty priority queue.
 - binary_heap(lo, hi) constructs a priority queue from two ForwardIterators,
   consisting of elements in the range [lo, hi).
 - size() returns the size of the priority queue.
 - empty() returns whether the priority queue is empty.
 - push(v) inserts the value v into the priority queue.
+- push_range(lo, hi) inserts the values in the range [lo, hi). If the range is
+  large relative to the heap, the whole heap is rebuilt bottom-up in linear
+  time instead of inserting the values one at a time.
 - pop() removes the minimum element from the priority queue.
 - top() returns the minimum element in the priority queue.
 
+indexed_heap<T, D> is a D-ary min-heap which additionally returns a handle for
+every pushed element, which remains valid until the element is removed. The
+handles may be used to modify or remove arbitrary elements, e.g. to decrease
+the distance of a vertex in Dijkstra's algorithm instead of pushing it again.
+Handles of removed elements are reused by later pushes.
+
+- indexed_heap() constructs an empty priority queue.
+- size(), empty(), and top() are the same as above.
+- push(v) inserts the value v and returns its handle.
+- push_range(lo, hi, out) inserts the values in the range [lo, hi), writing
+  their handles in the same order to the output iterator out.
+- top_handle() returns the handle of the minimum element.
+- contains(h) returns whether the handle h refers to an element in the heap.
+- value(h) returns the element with handle h.
+- decrease_key(h, v) replaces the element with handle h by v, which must not
+  be greater than it.
+- erase(h) removes the element with handle h.
+- pop() removes the minimum element.
+
 Time Complexity:
-- O(1) per call to the first constructor, size(), empty(), and top().
-- O(log n) per call to push() and pop(), where n is the number of elements
-  in the priority queue.
+- O(1) per call to the first constructor, size(), empty(), top(), top_handle(),
+  contains(), and value().
+- O(log n) per call to push() and decrease_key(), and O(D log n) per call to
+  pop() and erase(), where n is the number of elements in the priority queue
+  and logarithms are base D.
 - O(n) per call to the second constructor on the distance between lo and hi.
+- O(min(k log(n + k), n + k)) per call to push_range(), where k is the
+  distance between lo and hi.
 
 Space Complexity:
 - O(n) for storage of the priority queue elements.
@@ -28,73 +64,272 @@ Space Complexity:
 */
 
 #include <algorithm>
+#include <iterator>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
-template<class T>
+template<class T, int D = 2>
 class binary_heap {
+  // Element i is stored at heap[i + D - 1], with children D*i + 1 to D*i + D.
   std::vector<T> heap;
 
+  void sift_up(int i) {
+    T v = heap[i + D - 1];
+    while (i > 0) {
+      int parent = (i - 1)/D;
+      if (!(v < heap[parent + D - 1])) {
+        break;
+      }
+      heap[i + D - 1] = heap[parent + D - 1];
+      i = parent;
+    }
+    heap[i + D - 1] = v;
+  }
+
+  void sift_down(int i) {
+    int n = size();
+    T v = heap[i + D - 1];
+    for (;;) {
+      int child = D*i + 1;
+      if (child >= n) {
+        break;
+      }
+      int end = std::min(child + D, n);
+      for (int j = child + 1; j < end; j++) {
+        if (heap[j + D - 1] < heap[child + D - 1]) {
+          child = j;
+        }
+      }
+      if (!(heap[child + D - 1] < v)) {
+        break;
+      }
+      heap[i + D - 1] = heap[child + D - 1];
+      i = child;
+    }
+    heap[i + D - 1] = v;
+  }
+
  public:
-  binary_heap() {}
+  binary_heap() : heap(D - 1) {}
 
   template<class It>
-  binary_heap(It lo, It hi) {
-    while (lo != hi) {
-      push(*(lo++));
-    }
+  binary_heap(It lo, It hi) : heap(D - 1) {
+    push_range(lo, hi);
   }
 
   int size() const {
-    return heap.size();
+    return heap.size() - (D - 1);
   }
 
   bool empty() const {
-    return heap.empty();
+    return size() == 0;
   }
 
   void push(const T &v) {
     heap.push_back(v);
-    int i = heap.size() - 1;
-    while (i > 0) {
-      int parent = (i - 1)/2;
-      if (!(heap[i] < heap[parent])) {
-        break;
+    sift_up(size() - 1);
+  }
+
+  template<class It>
+  void push_range(It lo, It hi) {
+    int n = size();
+    heap.insert(heap.end(), lo, hi);
+    int k = size() - n, depth = 1;
+    for (int m = size(); m > 1; m /= D) {
+      depth++;
+    }
+    if ((long long)k*depth < size()) {
+      for (int i = n; i < size(); i++) {
+        sift_up(i);
+      }
+    } else if (size() > 1) {
+      for (int i = (size() - 2)/D; i >= 0; i--) {
+        sift_down(i);
       }
-      std::swap(heap[i], heap[parent]);
-      i = parent;
     }
   }
 
   void pop() {
-    if (heap.empty()) {
+    if (empty()) {
       throw std::runtime_error("Cannot pop from empty heap.");
     }
-    heap[0] = heap.back();
+    heap[D - 1] = heap.back();
     heap.pop_back();
-    int i = 0;
+    if (!empty()) {
+      sift_down(0);
+    }
+  }
+
+  T top() const {
+    if (empty()) {
+      throw std::runtime_error("Cannot get top of empty heap.");
+    }
+    return heap[D - 1];
+  }
+};
+
+template<class T, int D = 4>
+class indexed_heap {
+  typedef std::pair<T, int> entry;
+
+  // Stored with the same layout as binary_heap. pos[h] is the index of the
+  // element with handle h, or -1 if there is none.
+  std::vector<entry> heap;
+  std::vector<int> pos, free_handles;
+
+  void place(int i, const entry &e) {
+    heap[i + D - 1] = e;
+    pos[e.second] = i;
+  }
+
+  void sift_up(int i) {
+    entry e = heap[i + D - 1];
+    while (i > 0) {
+      int parent = (i - 1)/D;
+      if (!(e.first < heap[parent + D - 1].first)) {
+        break;
+      }
+      place(i, heap[parent + D - 1]);
+      i = parent;
+    }
+    place(i, e);
+  }
+
+  void sift_down(int i) {
+    int n = size();
+    entry e = heap[i + D - 1];
     for (;;) {
-      int child = 2*i + 1;
-      if (child >= (int)heap.size()) {
+      int child = D*i + 1;
+      if (child >= n) {
         break;
       }
-      if (child + 1 < (int)heap.size() && heap[child + 1] < heap[child]) {
-        child++;
+      int end = std::min(child + D, n);
+      for (int j = child + 1; j < end; j++) {
+        if (heap[j + D - 1].first < heap[child + D - 1].first) {
+          child = j;
+        }
       }
-      if (heap[child] < heap[i]) {
-        std::swap(heap[i], heap[child]);
-        i = child;
-      } else {
+      if (!(heap[child + D - 1].first < e.first)) {
         break;
       }
+      place(i, heap[child + D - 1]);
+      i = child;
+    }
+    place(i, e);
+  }
+
+  int new_handle() {
+    if (free_handles.empty()) {
+      pos.push_back(-1);
+      return pos.size() - 1;
+    }
+    int h = free_handles.back();
+    free_handles.pop_back();
+    return h;
+  }
+
+ public:
+  indexed_heap() : heap(D - 1) {}
+
+  int size() const {
+    return heap.size() - (D - 1);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  int push(const T &v) {
+    int h = new_handle();
+    heap.push_back(entry(v, h));
+    pos[h] = size() - 1;
+    sift_up(size() - 1);
+    return h;
+  }
+
+  template<class It, class OutIt>
+  OutIt push_range(It lo, It hi, OutIt out) {
+    int n = size();
+    for (; lo != hi; ++lo) {
+      int h = new_handle();
+      heap.push_back(entry(*lo, h));
+      pos[h] = size() - 1;
+      *out++ = h;
+    }
+    int k = size() - n, depth = 1;
+    for (int m = size(); m > 1; m /= D) {
+      depth++;
+    }
+    if ((long long)k*depth < size()) {
+      for (int i = n; i < size(); i++) {
+        sift_up(i);
+      }
+    } else if (size() > 1) {
+      for (int i = (size() - 2)/D; i >= 0; i--) {
+        sift_down(i);
+      }
+    }
+    return out;
+  }
+
+  bool contains(int h) const {
+    return 0 <= h && h < (int)pos.size() && pos[h] != -1;
+  }
+
+  T value(int h) const {
+    if (!contains(h)) {
+      throw std::runtime_error("Handle is not in the heap.");
+    }
+    return heap[pos[h] + D - 1].first;
+  }
+
+  void decrease_key(int h, const T &v) {
+    if (!contains(h)) {
+      throw std::runtime_error("Handle is not in the heap.");
+    }
+    if (heap[pos[h] + D - 1].first < v) {
+      throw std::runtime_error("Cannot increase key with decrease_key().");
+    }
+    heap[pos[h] + D - 1].first = v;
+    sift_up(pos[h]);
+  }
+
+  void erase(int h) {
+    if (!contains(h)) {
+      throw std::runtime_error("Handle is not in the heap.");
+    }
+    int i = pos[h];
+    entry last = heap.back();
+    heap.pop_back();
+    pos[h] = -1;
+    free_handles.push_back(h);
+    if (i < size()) {
+      place(i, last);
+      sift_up(i);
+      sift_down(pos[last.second]);
     }
   }
 
+  void pop() {
+    if (empty()) {
+      throw std::runtime_error("Cannot pop from empty heap.");
+    }
+    erase(heap[D - 1].second);
+  }
+
   T top() const {
-    if (heap.empty()) {
+    if (empty()) {
+      throw std::runtime_error("Cannot get top of empty heap.");
+    }
+    return heap[D - 1].first;
+  }
+
+  int top_handle() const {
+    if (empty()) {
       throw std::runtime_error("Cannot get top of empty heap.");
     }
-    return heap[0];
+    return heap[D - 1].second;
   }
 };
 
@@ -108,9 +343,85 @@ class binary_heap {
 
 ***/
 
+#include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <queue>
 using namespace std;
 
+template<int D>
+void test_binary_heap() {
+  int one = 7;
+  binary_heap<int, D> empty_heap(&one, &one), single(&one, &one + 1);
+  assert(empty_heap.empty() && single.size() == 1 && single.top() == 7);
+  binary_heap<int, D> h;
+  priority_queue<int, vector<int>, greater<int> > pq;
+  for (int i = 0; i < 10000; i++) {
+    if (rand() % 3 == 0 && !pq.empty()) {
+      assert(h.top() == pq.top());
+      h.pop();
+      pq.pop();
+    } else if (rand() % 100 == 0) {
+      vector<int> v(rand() % 1000);
+      for (int j = 0; j < (int)v.size(); j++) {
+        v[j] = rand() % 1000;
+        pq.push(v[j]);
+      }
+      h.push_range(v.begin(), v.end());
+    } else {
+      int v = rand() % 1000;
+      h.push(v);
+      pq.push(v);
+    }
+    assert(h.size() == (int)pq.size());
+  }
+}
+
+template<int D>
+void test_indexed_heap() {
+  indexed_heap<int, D> h;
+  vector<int> handles, value;
+  int one = 7;
+  h.push_range(&one, &one, back_inserter(handles));
+  assert(h.empty() && handles.empty());
+  h.push_range(&one, &one + 1, back_inserter(handles));
+  assert(h.size() == 1 && h.top() == 7 && h.value(handles[0]) == 7);
+  h.pop();
+  handles.clear();
+  for (int i = 0; i < 10000; i++) {
+    int op = rand() % 4;
+    if (op == 0 && !h.empty()) {
+      int best = -1;
+      for (int j = 0; j < (int)handles.size(); j++) {
+        if (best == -1 || value[j] < value[best]) {
+          best = j;
+        }
+      }
+      assert(h.top() == value[best]);
+      h.pop();
+      handles.erase(handles.begin() + best);
+      value.erase(value.begin() + best);
+    } else if (op == 1 && !h.empty()) {
+      int j = rand() % handles.size();
+      value[j] -= rand() % 100;
+      h.decrease_key(handles[j], value[j]);
+    } else if (op == 2 && !h.empty()) {
+      int j = rand() % handles.size();
+      h.erase(handles[j]);
+      assert(!h.contains(handles[j]));
+      handles.erase(handles.begin() + j);
+      value.erase(value.begin() + j);
+    } else {
+      value.push_back(rand() % 1000);
+      handles.push_back(h.push(value.back()));
+    }
+    assert(h.size() == (int)handles.size());
+  }
+  for (int j = 0; j < (int)handles.size(); j++) {
+    assert(h.value(handles[j]) == value[j]);
+  }
+}
+
 int main() {
   int a[] = {0, 5, -1, 12};
   binary_heap<int> h(a, a + 4);
@@ -119,5 +430,22 @@ int main() {
     cout << h.top() << endl;
     h.pop();
   }
+
+  test_binary_heap<2>();
+  test_binary_heap<3>();
+  test_binary_heap<4>();
+  test_binary_heap<8>();
+  test_indexed_heap<2>();
+  test_indexed_heap<4>();
+  test_indexed_heap<7>();
+
+  indexed_heap<int> ih;
+  vector<int> handles;
+  ih.push_range(a, a + 4, back_inserter(handles));
+  ih.decrease_key(handles[3], -5);
+  assert(ih.top() == -5 && ih.top_handle() == handles[3]);
+  ih.erase(handles[2]);
+  ih.pop();
+  assert(ih.top() == 0 && ih.size() == 2);
   return 0;
 }
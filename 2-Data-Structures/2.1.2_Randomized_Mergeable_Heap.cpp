@@ -15,25 +15,185 @@ coin-toss to recursively combine nodes of two binary trees.
 - pop() removes the minimum element from the priority queue.
 - top() returns the minimum element in the priority queue.
 - absorb(h) inserts every value from h and sets h to the empty priority queue.
+- stats() returns a reference to the statistics policy object of the priority
+  queue.
+
+Nodes are allocated through the policy Pool<node_t>, which must provide
+allocate() returning uninitialized storage for one node, deallocate(n), and
+absorb(p) taking over the storage of another pool when heaps are merged. The
+default node_pool carves nodes out of large slabs and reuses freed nodes, which
+avoids a call to the global allocator per push and pop. new_allocator may be
+passed instead to allocate every node separately, or arena_allocator to bump
+allocate nodes from growing chunks that are only freed with the heap. The
+destructor frees the nodes iteratively in O(1) auxiliary space by rotating each
+node's left subtree into its right, so that degenerate heaps cannot overflow the
+stack.
+
+The policy Stats receives a call to on_allocate() per node allocation and
+on_visit() per step of merge() that combines two nonempty trees, so that the
+visits of an operation count the nodes on its merge path. Heaps do not rotate,
+so on_rotate() is never called. The default no_stats ignores these at no cost,
+while counting_stats accumulates them into counters that may be read and reset
+through stats() to profile individual operations.
 
 Time Complexity:
 - O(1) per call to the first constructor, size(), empty(), and top().
 - O(log n) expected worst case per call to push(), pop(), and absorb(), where n
   is the number of elements in the priority queue.
+- absorb() also absorbs the pool of h, which is linear in the number of slabs
+  and free nodes of h for node_pool, linear in the number of chunks of h for
+  arena_allocator, and O(1) for new_allocator.
 - O(n) per call to the second constructor on the distance between lo and hi.
 
 Space Complexity:
 - O(n) for storage of the priority queue elements.
 - O(log n) auxiliary stack space for push(), pop(), and absorb().
-- O(1) auxiliary for all other operations.
+- O(1) auxiliary for all other operations, including destruction.
 
 */
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdlib>
+#include <new>
 #include <stdexcept>
+#include <vector>
+
+// Default allocation policy, handing out nodes from slabs of SLAB_SIZE nodes
+// and recycling freed nodes through a free list. Slabs are only released when
+// the pool is destroyed.
+template<class Node>
+class node_pool {
+  static const int SLAB_SIZE = 1024;
+
+  std::vector<Node*> slabs, free_nodes;
+  int used;
+
+  node_pool(const node_pool &);
+  node_pool& operator=(const node_pool &);
+
+ public:
+  node_pool() : used(SLAB_SIZE) {}
+
+  ~node_pool() {
+    for (int i = 0; i < (int)slabs.size(); i++) {
+      ::operator delete(slabs[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (!free_nodes.empty()) {
+      Node *n = free_nodes.back();
+      free_nodes.pop_back();
+      return n;
+    }
+    if (used == SLAB_SIZE) {
+      void *slab = ::operator new(SLAB_SIZE*sizeof(Node));
+      slabs.push_back(static_cast<Node*>(slab));
+      used = 0;
+    }
+    return slabs.back() + used++;
+  }
+
+  void deallocate(Node *n) {
+    free_nodes.push_back(n);
+  }
+
+  // Takes ownership of every slab of p, leaving p empty.
+  void absorb(node_pool &p) {
+    for (; p.used < SLAB_SIZE; p.used++) {
+      free_nodes.push_back(p.slabs.back() + p.used);
+    }
+    free_nodes.insert(free_nodes.end(), p.free_nodes.begin(),
+                      p.free_nodes.end());
+    slabs.insert(slabs.begin(), p.slabs.begin(), p.slabs.end());
+    p.slabs.clear();
+    p.free_nodes.clear();
+  }
+};
+
+// Alternative allocation policy, calling operator new and delete per node.
+template<class Node>
+struct new_allocator {
+  Node* allocate() {
+    return static_cast<Node*>(::operator new(sizeof(Node)));
+  }
+
+  void deallocate(Node *n) {
+    ::operator delete(n);
+  }
+
+  void absorb(new_allocator &) {}
+};
+
+// Alternative allocation policy, handing out nodes from chunks of growing size
+// (up to MAX_CHUNK nodes) without ever reusing freed nodes. All storage is
+// released at once when the arena is destroyed, which suits heaps that are
+// filled and then discarded as a whole.
+template<class Node>
+class arena_allocator {
+  static const int MAX_CHUNK = 65536;
+
+  std::vector<Node*> chunks;
+  int used, capacity;
+
+  arena_allocator(const arena_allocator &);
+  arena_allocator& operator=(const arena_allocator &);
+
+ public:
+  arena_allocator() : used(0), capacity(0) {}
+
+  ~arena_allocator() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+      ::operator delete(chunks[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (used == capacity) {
+      capacity = (capacity == 0) ? 16 : std::min(2*capacity, (int)MAX_CHUNK);
+      void *chunk = ::operator new(capacity*sizeof(Node));
+      chunks.push_back(static_cast<Node*>(chunk));
+      used = 0;
+    }
+    return chunks.back() + used++;
+  }
+
+  void deallocate(Node *) {}
 
-template<class T>
+  // Takes ownership of every chunk of p, leaving p empty.
+  void absorb(arena_allocator &p) {
+    chunks.insert(chunks.begin(), p.chunks.begin(), p.chunks.end());
+    p.chunks.clear();
+    p.used = p.capacity = 0;
+  }
+};
+
+// Default statistics policy, whose empty hooks compile away entirely.
+struct no_stats {
+  void on_allocate() {}
+  void on_rotate() {}
+  void on_visit() {}
+};
+
+// Alternative statistics policy, counting node allocations, rotations, and
+// nodes visited on merge paths since construction or the last reset().
+struct counting_stats {
+  long long allocations, rotations, visits;
+
+  counting_stats() : allocations(0), rotations(0), visits(0) {}
+
+  void on_allocate() { allocations++; }
+  void on_rotate() { rotations++; }
+  void on_visit() { visits++; }
+
+  void reset() {
+    allocations = rotations = visits = 0;
+  }
+};
+
+template<class T, template<class> class Pool = node_pool,
+         class Stats = no_stats>
 class randomized_heap {
   struct node_t {
     T value;
@@ -43,14 +203,27 @@ class randomized_heap {
   } *root;
 
   int num_nodes;
+  Pool<node_t> pool;
+  mutable Stats st;
 
-  static node_t* merge(node_t *a, node_t *b) {
+  node_t* create(const T &v) {
+    st.on_allocate();
+    return new (pool.allocate()) node_t(v);
+  }
+
+  void destroy(node_t *n) {
+    n->~node_t();
+    pool.deallocate(n);
+  }
+
+  node_t* merge(node_t *a, node_t *b) {
     if (a == NULL) {
       return b;
     }
     if (b == NULL) {
       return a;
     }
+    st.on_visit();
     if (b->value < a->value) {
       std::swap(a, b);
     }
@@ -61,11 +234,18 @@ class randomized_heap {
     return a;
   }
 
-  static void clean_up(node_t *n) {
-    if (n != NULL) {
-      clean_up(n->left);
-      clean_up(n->right);
-      delete n;
+  void clean_up(node_t *n) {
+    while (n != NULL) {
+      if (n->left != NULL) {
+        node_t *l = n->left;
+        n->left = l->right;
+        l->right = n;
+        n = l;
+      } else {
+        node_t *right = n->right;
+        destroy(n);
+        n = right;
+      }
     }
   }
 
@@ -92,7 +272,7 @@ class randomized_heap {
   }
 
   void push(const T &v) {
-    root = merge(root, new node_t(v));
+    root = merge(root, create(v));
     num_nodes++;
   }
 
@@ -102,7 +282,7 @@ class randomized_heap {
     }
     node_t *tmp = root;
     root = merge(root->left, root->right);
-    delete tmp;
+    destroy(tmp);
     num_nodes--;
   }
 
@@ -114,8 +294,19 @@ class randomized_heap {
   }
 
   void absorb(randomized_heap &h) {
+    pool.absorb(h.pool);
     root = merge(root, h.root);
+    num_nodes += h.num_nodes;
     h.root = NULL;
+    h.num_nodes = 0;
+  }
+
+  const Stats& stats() const {
+    return st;
+  }
+
+  Stats& stats() {
+    return st;
   }
 };
 
@@ -129,6 +320,7 @@ class randomized_heap {
 
 ***/
 
+#include <cassert>
 #include <iostream>
 using namespace std;
 
@@ -144,5 +336,53 @@ int main() {
     cout << h.top() << endl;
     h.pop();
   }
+
+  randomized_heap<int, new_allocator> h3;
+  randomized_heap<int, arena_allocator> h6, h7;
+  randomized_heap<int> h4, h5;
+  for (int i = 0; i < 3000; i++) {
+    h3.push(i % 100);
+    h4.push(i);
+    h5.push(-i);
+  }
+  h4.absorb(h5);
+  assert(h4.size() == 6000 && h5.empty() && h5.size() == 0);
+  for (int i = 0; i < 3000; i++) {
+    assert(h4.top() == i - 2999);
+    h4.pop();
+  }
+  for (int i = 0; i < 1000; i++) {
+    h5.push(i);
+    h4.pop();
+  }
+  assert(h4.size() == 2000 && h4.top() == 1000 && h3.top() == 0);
+  for (int i = 0; i < 100000; i++) {
+    h6.push(i % 1000);
+    h7.push(-i);
+  }
+  h6.absorb(h7);
+  assert(h6.size() == 200000 && h7.empty());
+  for (int i = 0; i < 100000; i++) {
+    assert(h6.top() == i - 99999);
+    h6.pop();
+  }
+  assert(h6.top() == 0);
+  h7.push(5);
+  assert(h7.top() == 5);
+
+  // Operation statistics.
+  randomized_heap<int, arena_allocator, counting_stats> profiled;
+  for (int i = 0; i < 1000; i++) {
+    profiled.push(i*7919 % 1000);
+  }
+  assert(profiled.stats().allocations == 1000);
+  assert(profiled.stats().rotations == 0);
+  profiled.stats().reset();
+  for (int i = 0; i < 500; i++) {
+    assert(profiled.top() == i);
+    profiled.pop();
+  }
+  // Each pop walks a merge path of O(log n) nodes on average.
+  assert(profiled.stats().visits > 0 && profiled.stats().visits < 500*40);
   return 0;
 }
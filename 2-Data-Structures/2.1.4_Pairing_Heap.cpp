@@ -11,54 +11,241 @@ multi-way tree, using a two-pass merge to self-adjust during each deletion.
   consisting of elements in the range [lo, hi).
 - size() returns the size of the priority queue.
 - empty() returns whether the priority queue is empty.
-- push(v) inserts the value v into the priority queue.
+- push(v) inserts the value v into the priority queue, returning a handle to
+  it which remains valid until the value is removed, even if it is absorbed
+  into another heap.
 - pop() removes the minimum element from the priority queue.
 - top() returns the minimum element in the priority queue.
+- value(h) returns the element for the handle h.
+- decrease_key(h, v) replaces the element for the handle h with v, which must
+  not be greater than it.
+- erase(h) removes the element for the handle h.
 - absorb(h) inserts every value from h and sets h to the empty priority queue.
+- stats() returns a reference to the statistics policy object of the priority
+  queue.
+
+Every node links to its first child, its next sibling, and either its previous
+sibling or, for a first child, its parent, so that any node can be cut out of
+the tree in O(1) time. decrease_key() cuts the node and merges it with the
+root, while erase() cuts the node and merges the two-pass combination of its
+children with the root. The two-pass merge is done iteratively, pairing up the
+children from left to right and then merging the pairs from right to left.
+
+Nodes are allocated through the policy Pool<node_t>, which must provide
+allocate() returning uninitialized storage for one node, deallocate(n), and
+absorb(p) taking over the storage of another pool when heaps are merged. The
+default node_pool carves nodes out of large slabs and reuses freed nodes, which
+avoids a call to the global allocator per push and pop. new_allocator may be
+passed instead to allocate every node separately, or arena_allocator to bump
+allocate nodes from growing chunks that are only freed with the heap. The
+destructor frees the nodes iteratively in O(1) auxiliary space by rotating each
+node's first child into its siblings, so that degenerate heaps cannot overflow
+the stack.
+
+The policy Stats receives a call to on_allocate() per node allocation and
+on_visit() per pair of trees linked by a merge, including the links made by the
+two-pass merge of pop() and erase(). Heaps do not rotate, so on_rotate() is
+never called. The default no_stats ignores these at no cost, while
+counting_stats accumulates them into counters that may be read and reset
+through stats() to profile individual operations.
 
 Time Complexity:
-- O(1) per call to the first constructor, size(), empty(), top(), push(), and
-  absorb().
-- O(log n) amortized per call to pop().
+- O(1) per call to the first constructor, size(), empty(), top(), and push().
+- O(1) per call to absorb() to merge the two heaps, plus absorbing the pool of
+  h, which is linear in the number of slabs and free nodes of h for node_pool,
+  linear in the number of chunks of h for arena_allocator, and O(1) for
+  new_allocator.
+- O(log n) amortized per call to pop() and erase().
+- O(log n) amortized per call to decrease_key(), which is o(log n) in practice
+  and conjectured to be O(log log n).
 - O(n) per call to the second constructor on the distance between lo and hi.
 
 Space Complexity:
 - O(n) for storage of the priority queue elements.
-- O(log n) amortized auxiliary stack space for pop().
-- O(1) auxiliary for all other operations.
+- O(1) auxiliary for all other operations, including destruction.
 
 */
 
+#include <algorithm>
 #include <cstddef>
+#include <new>
 #include <stdexcept>
+#include <vector>
+
+// Default allocation policy, handing out nodes from slabs of SLAB_SIZE nodes
+// and recycling freed nodes through a free list. Slabs are only released when
+// the pool is destroyed.
+template<class Node>
+class node_pool {
+  static const int SLAB_SIZE = 1024;
+
+  std::vector<Node*> slabs, free_nodes;
+  int used;
+
+  node_pool(const node_pool &);
+  node_pool& operator=(const node_pool &);
+
+ public:
+  node_pool() : used(SLAB_SIZE) {}
+
+  ~node_pool() {
+    for (int i = 0; i < (int)slabs.size(); i++) {
+      ::operator delete(slabs[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (!free_nodes.empty()) {
+      Node *n = free_nodes.back();
+      free_nodes.pop_back();
+      return n;
+    }
+    if (used == SLAB_SIZE) {
+      void *slab = ::operator new(SLAB_SIZE*sizeof(Node));
+      slabs.push_back(static_cast<Node*>(slab));
+      used = 0;
+    }
+    return slabs.back() + used++;
+  }
+
+  void deallocate(Node *n) {
+    free_nodes.push_back(n);
+  }
+
+  // Takes ownership of every slab of p, leaving p empty.
+  void absorb(node_pool &p) {
+    for (; p.used < SLAB_SIZE; p.used++) {
+      free_nodes.push_back(p.slabs.back() + p.used);
+    }
+    free_nodes.insert(free_nodes.end(), p.free_nodes.begin(),
+                      p.free_nodes.end());
+    slabs.insert(slabs.begin(), p.slabs.begin(), p.slabs.end());
+    p.slabs.clear();
+    p.free_nodes.clear();
+  }
+};
+
+// Alternative allocation policy, calling operator new and delete per node.
+template<class Node>
+struct new_allocator {
+  Node* allocate() {
+    return static_cast<Node*>(::operator new(sizeof(Node)));
+  }
+
+  void deallocate(Node *n) {
+    ::operator delete(n);
+  }
+
+  void absorb(new_allocator &) {}
+};
+
+// Alternative allocation policy, handing out nodes from chunks of growing size
+// (up to MAX_CHUNK nodes) without ever reusing freed nodes. All storage is
+// released at once when the arena is destroyed, which suits heaps that are
+// filled and then discarded as a whole.
+template<class Node>
+class arena_allocator {
+  static const int MAX_CHUNK = 65536;
 
-template<class T>
+  std::vector<Node*> chunks;
+  int used, capacity;
+
+  arena_allocator(const arena_allocator &);
+  arena_allocator& operator=(const arena_allocator &);
+
+ public:
+  arena_allocator() : used(0), capacity(0) {}
+
+  ~arena_allocator() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+      ::operator delete(chunks[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (used == capacity) {
+      capacity = (capacity == 0) ? 16 : std::min(2*capacity, (int)MAX_CHUNK);
+      void *chunk = ::operator new(capacity*sizeof(Node));
+      chunks.push_back(static_cast<Node*>(chunk));
+      used = 0;
+    }
+    return chunks.back() + used++;
+  }
+
+  void deallocate(Node *) {}
+
+  // Takes ownership of every chunk of p, leaving p empty.
+  void absorb(arena_allocator &p) {
+    chunks.insert(chunks.begin(), p.chunks.begin(), p.chunks.end());
+    p.chunks.clear();
+    p.used = p.capacity = 0;
+  }
+};
+
+// Default statistics policy, whose empty hooks compile away entirely.
+struct no_stats {
+  void on_allocate() {}
+  void on_rotate() {}
+  void on_visit() {}
+};
+
+// Alternative statistics policy, counting node allocations, rotations, and
+// nodes visited on merge paths since construction or the last reset().
+struct counting_stats {
+  long long allocations, rotations, visits;
+
+  counting_stats() : allocations(0), rotations(0), visits(0) {}
+
+  void on_allocate() { allocations++; }
+  void on_rotate() { rotations++; }
+  void on_visit() { visits++; }
+
+  void reset() {
+    allocations = rotations = visits = 0;
+  }
+};
+
+template<class T, template<class> class Pool = node_pool,
+         class Stats = no_stats>
 class pairing_heap {
   struct node_t {
     T value;
-    node_t *left, *next;
+    node_t *left, *next, *prev;
 
-    node_t(const T &v) : value(v), left(NULL), next(NULL) {}
+    node_t(const T &v) : value(v), left(NULL), next(NULL), prev(NULL) {}
 
     void add_child(node_t *n) {
-      if (left == NULL) {
-        left = n;
-      } else {
-        n->next = left;
-        left = n;
+      n->next = left;
+      if (left != NULL) {
+        left->prev = n;
       }
+      n->prev = this;
+      left = n;
     }
   } *root;
 
   int num_nodes;
+  Pool<node_t> pool;
+  mutable Stats st;
+
+  node_t* create(const T &v) {
+    st.on_allocate();
+    return new (pool.allocate()) node_t(v);
+  }
 
-  static node_t* merge(node_t *a, node_t *b) {
+  void destroy(node_t *n) {
+    n->~node_t();
+    pool.deallocate(n);
+  }
+
+  node_t* merge(node_t *a, node_t *b) {
     if (a == NULL) {
       return b;
     }
     if (b == NULL) {
       return a;
     }
+    st.on_visit();
     if (a->value < b->value) {
       a->add_child(b);
       return a;
@@ -67,24 +254,66 @@ class pairing_heap {
     return b;
   }
 
-  static node_t* merge_pairs(node_t *n) {
-    if (n == NULL || n->next == NULL) {
-      return n;
+  node_t* merge_pairs(node_t *n) {
+    if (n == NULL) {
+      return NULL;
     }
-    node_t *a = n, *b = n->next, *c = n->next->next;
-    a->next = b->next = NULL;
-    return merge(merge(a, b), merge_pairs(c));
+    // Merge pairs from left to right, linking the results in reverse order.
+    node_t *pairs = NULL;
+    while (n != NULL) {
+      node_t *a = n, *b = n->next;
+      n = (b == NULL) ? NULL : b->next;
+      a->next = a->prev = NULL;
+      if (b != NULL) {
+        b->next = b->prev = NULL;
+        a = merge(a, b);
+      }
+      a->next = pairs;
+      pairs = a;
+    }
+    node_t *res = pairs;
+    pairs = pairs->next;
+    res->next = NULL;
+    while (pairs != NULL) {
+      node_t *next = pairs->next;
+      pairs->next = NULL;
+      res = merge(pairs, res);
+      pairs = next;
+    }
+    return res;
+  }
+
+  // Detaches a non-root node and its subtree from the tree.
+  static void cut(node_t *n) {
+    if (n->prev->left == n) {
+      n->prev->left = n->next;
+    } else {
+      n->prev->next = n->next;
+    }
+    if (n->next != NULL) {
+      n->next->prev = n->prev;
+    }
+    n->next = n->prev = NULL;
   }
 
-  static void clean_up(node_t *n) {
-    if (n != NULL) {
-      clean_up(n->left);
-      clean_up(n->next);
-      delete n;
+  void clean_up(node_t *n) {
+    while (n != NULL) {
+      if (n->left != NULL) {
+        node_t *l = n->left;
+        n->left = l->next;
+        l->next = n;
+        n = l;
+      } else {
+        node_t *next = n->next;
+        destroy(n);
+        n = next;
+      }
     }
   }
 
  public:
+  typedef node_t *handle;
+
   pairing_heap() : root(NULL), num_nodes(0) {}
 
   template<class It>
@@ -106,9 +335,11 @@ class pairing_heap {
     return root == NULL;
   }
 
-  void push(const T &v) {
-    root = merge(root, new node_t(v));
+  handle push(const T &v) {
+    node_t *n = create(v);
+    root = merge(root, n);
     num_nodes++;
+    return n;
   }
 
   void pop() {
@@ -117,7 +348,7 @@ class pairing_heap {
     }
     node_t *tmp = root;
     root = merge_pairs(root->left);
-    delete tmp;
+    destroy(tmp);
     num_nodes--;
   }
 
@@ -128,9 +359,46 @@ class pairing_heap {
     return root->value;
   }
 
+  T value(handle h) const {
+    return h->value;
+  }
+
+  void decrease_key(handle h, const T &v) {
+    if (h->value < v) {
+      throw std::runtime_error("Cannot increase key with decrease_key().");
+    }
+    h->value = v;
+    if (h != root) {
+      cut(h);
+      root = merge(root, h);
+    }
+  }
+
+  void erase(handle h) {
+    if (h == root) {
+      pop();
+      return;
+    }
+    cut(h);
+    root = merge(root, merge_pairs(h->left));
+    destroy(h);
+    num_nodes--;
+  }
+
   void absorb(pairing_heap &h) {
+    pool.absorb(h.pool);
     root = merge(root, h.root);
+    num_nodes += h.num_nodes;
     h.root = NULL;
+    h.num_nodes = 0;
+  }
+
+  const Stats& stats() const {
+    return st;
+  }
+
+  Stats& stats() {
+    return st;
   }
 };
 
@@ -141,12 +409,92 @@ class pairing_heap {
 5
 10
 12
+Dijkstra's algorithm on 100000 vertices:
+m = 200000: lazy binary heap 0.056s, pairing heap with decrease_key() 0.077s
+m = 800000: lazy binary heap 0.208s, pairing heap with decrease_key() 0.151s
+m = 3200000: lazy binary heap 0.941s, pairing heap with decrease_key() 0.252s
 
 ***/
 
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
 #include <iostream>
+#include <queue>
+#include <set>
+#include <utility>
+#include <vector>
 using namespace std;
 
+typedef vector<vector<pair<int, int> > > graph;
+
+graph random_graph(int n, int m) {
+  graph adj(n);
+  for (int i = 1; i < n; i++) {
+    adj[rand() % i].push_back(make_pair(i, rand() % 1000 + 1));
+  }
+  for (int i = n - 1; i < m; i++) {
+    adj[rand() % n].push_back(make_pair(rand() % n, rand() % 1000 + 1));
+  }
+  return adj;
+}
+
+long long dijkstra_lazy(const graph &adj) {
+  vector<long long> dist(adj.size(), -1);
+  priority_queue<pair<long long, int>, vector<pair<long long, int> >,
+                 greater<pair<long long, int> > > pq;
+  pq.push(make_pair(0LL, 0));
+  long long total = 0;
+  while (!pq.empty()) {
+    long long d = pq.top().first;
+    int u = pq.top().second;
+    pq.pop();
+    if (dist[u] != -1) {
+      continue;
+    }
+    dist[u] = d;
+    total += d;
+    for (int j = 0; j < (int)adj[u].size(); j++) {
+      int v = adj[u][j].first;
+      if (dist[v] == -1) {
+        pq.push(make_pair(d + adj[u][j].second, v));
+      }
+    }
+  }
+  return total;
+}
+
+long long dijkstra_decrease_key(const graph &adj) {
+  typedef pairing_heap<pair<long long, int> > heap;
+  int n = adj.size();
+  vector<long long> dist(n, -1);
+  vector<heap::handle> handle(n, NULL);
+  heap h;
+  handle[0] = h.push(make_pair(0LL, 0));
+  long long total = 0;
+  while (!h.empty()) {
+    long long d = h.top().first;
+    int u = h.top().second;
+    h.pop();
+    dist[u] = d;
+    total += d;
+    for (int j = 0; j < (int)adj[u].size(); j++) {
+      int v = adj[u][j].first;
+      long long nd = d + adj[u][j].second;
+      if (dist[v] != -1) {
+        continue;
+      }
+      if (handle[v] == NULL) {
+        handle[v] = h.push(make_pair(nd, v));
+      } else if (nd < h.value(handle[v]).first) {
+        h.decrease_key(handle[v], make_pair(nd, v));
+      }
+    }
+  }
+  return total;
+}
+
 int main() {
   pairing_heap<int> h, h2;
   h.push(12);
@@ -159,5 +507,109 @@ int main() {
     cout << h.top() << endl;
     h.pop();
   }
+
+  pairing_heap<int, new_allocator> h3;
+  pairing_heap<int, arena_allocator> a1, a2;
+  pairing_heap<int> h4, h5;
+  for (int i = 0; i < 3000; i++) {
+    h3.push(i % 100);
+    h4.push(i);
+    h5.push(-i);
+  }
+  h4.absorb(h5);
+  assert(h4.size() == 6000 && h5.empty() && h5.size() == 0);
+  for (int i = 0; i < 3000; i++) {
+    assert(h4.top() == i - 2999);
+    h4.pop();
+  }
+  for (int i = 0; i < 1000; i++) {
+    h5.push(i);
+    h4.pop();
+  }
+  assert(h4.size() == 2000 && h4.top() == 1000 && h3.top() == 0);
+  for (int i = 0; i < 100000; i++) {
+    a1.push(i % 1000);
+    a2.push(-i);
+  }
+  a1.absorb(a2);
+  assert(a1.size() == 200000 && a2.empty());
+  for (int i = 0; i < 100000; i++) {
+    assert(a1.top() == i - 99999);
+    a1.pop();
+  }
+  assert(a1.top() == 0);
+  a2.push(5);
+  assert(a2.top() == 5);
+
+  // Operation statistics. Each push links the new node under the root, and the
+  // first pop pairs up the 999 children of the root with 998 more links.
+  pairing_heap<int, arena_allocator, counting_stats> profiled;
+  for (int i = 0; i < 1000; i++) {
+    profiled.push(i);
+  }
+  assert(profiled.stats().allocations == 1000);
+  assert(profiled.stats().visits == 999 && profiled.stats().rotations == 0);
+  profiled.stats().reset();
+  profiled.pop();
+  assert(profiled.top() == 1 && profiled.stats().visits == 998);
+
+  // Elements are (value, id) pairs so that each handle's element is unique and
+  // the popped element identifies exactly which handle was invalidated.
+  pairing_heap<pair<int, int> > h6;
+  set<pair<int, int> > s;
+  vector<pairing_heap<pair<int, int> >::handle> handles;
+  vector<int> values;
+  for (int i = 0; i < 20000; i++) {
+    int op = rand() % 4;
+    if (op == 0 && !s.empty()) {
+      pair<int, int> t = h6.top();
+      assert(t == *s.begin());
+      int j = t.second;
+      assert(h6.value(handles[j]) == t);
+      h6.pop();
+      s.erase(s.begin());
+      handles[j] = NULL;
+    } else if (op == 1 && !s.empty()) {
+      int j = rand() % handles.size();
+      if (handles[j] != NULL) {
+        assert(h6.value(handles[j]) == make_pair(values[j], j));
+        s.erase(make_pair(values[j], j));
+        values[j] -= rand() % 1000;
+        h6.decrease_key(handles[j], make_pair(values[j], j));
+        s.insert(make_pair(values[j], j));
+      }
+    } else if (op == 2 && !s.empty()) {
+      int j = rand() % handles.size();
+      if (handles[j] != NULL) {
+        assert(h6.value(handles[j]) == make_pair(values[j], j));
+        s.erase(make_pair(values[j], j));
+        h6.erase(handles[j]);
+        handles[j] = NULL;
+      }
+    } else {
+      int j = (int)values.size();
+      values.push_back(rand() % 1000);
+      handles.push_back(h6.push(make_pair(values[j], j)));
+      s.insert(make_pair(values[j], j));
+    }
+    assert(h6.size() == (int)s.size());
+  }
+
+  const int n = 100000;
+  cout << "Dijkstra's algorithm on " << n << " vertices:" << endl;
+  cout.precision(3);
+  cout << fixed;
+  for (int degree = 2; degree <= 32; degree *= 4) {
+    graph adj = random_graph(n, n*degree);
+    clock_t start = clock();
+    long long res1 = dijkstra_lazy(adj);
+    double t1 = (double)(clock() - start)/CLOCKS_PER_SEC;
+    start = clock();
+    long long res2 = dijkstra_decrease_key(adj);
+    double t2 = (double)(clock() - start)/CLOCKS_PER_SEC;
+    assert(res1 == res2);
+    cout << "m = " << n*degree << ": lazy binary heap " << t1
+         << "s, pairing heap with decrease_key() " << t2 << "s" << endl;
+  }
   return 0;
 }
@@ -0,0 +1,755 @@
+/*
+
+Maintain a map, that is, a collection of key-value pairs such that each possible
+key appears at most once in the collection. This implementations requires an
+ordering on the set of possible keys defined by the < operator on the key type,
+and both the key and value types to be default constructible. A B+ tree stores
+sorted runs of many entries per node, so that a search touches only a few nodes
+of O(log n) height, each of which spans a handful of contiguous cache lines
+instead of a single key. Every entry is stored in the leaves, and the leaves are
+linked from left to right so that entries can be visited in order without going
+back up the tree.
+
+Nodes are sized to approximately NODE_BYTES bytes (by default 256, i.e. four
+64-byte cache lines), from which the number of entries per leaf and the number
+of children per internal node are derived. Every node other than the root is
+kept at least half full. When an insertion overflows a node, it is split into
+two halves and the separating key is inserted into the parent. When an erasure
+leaves a node less than half full, it borrows an entry from a neighbouring
+sibling if the sibling can spare one, and otherwise merges with the sibling.
+
+- b_plus_tree() constructs an empty map.
+- b_plus_tree(lo, hi) constructs a map by bulk loading the (key, value) pairs in
+  the range [lo, hi), which must be sorted by strictly ascending keys. Entries
+  are distributed evenly into full leaves, and the upper levels are built on
+  top of them directly rather than by repeated insertion.
+- size() returns the size of the map.
+- empty() returns whether the map is empty.
+- insert(k, v) adds an entry with key k and value v to the map, returning true
+  if an new entry was added or false if the key already exists (in which case
+  the map is unchanged and the old value associated with the key is preserved).
+- erase(k) removes the entry with key k from the map, returning true if the
+  removal was successful or false if the key to be removed was not found.
+- find(k) returns a pointer to a const value associated with key k, or NULL if
+  the key was not found.
+- walk(f) calls the function f(k, v) on each entry of the map, in ascending
+  order of keys.
+- walk(lo, hi, f) calls the function f(k, v) on each entry of the map with a key
+  in the range [lo, hi], in ascending order of keys.
+- stats() returns a reference to the statistics policy object of the map.
+
+Leaves and internal nodes are allocated through the policies Pool<leaf_t> and
+Pool<inner_t>, which must provide allocate() returning uninitialized storage
+for one node and deallocate(n). The default node_pool carves nodes out of large
+slabs and reuses freed nodes, which avoids a call to the global allocator per
+split and merge. new_allocator may be passed instead to allocate every node
+separately, or arena_allocator to bump allocate nodes from growing chunks that
+are only freed with the map. The policy Stats receives a call to on_allocate()
+per node allocation and on_visit() per node on the root-to-leaf path of
+insert(), erase(), find(), and walk(lo, hi, f). Nodes are split, merged, and
+redistributed rather than rotated, so on_rotate() is never called. The default
+no_stats ignores these at no cost, while counting_stats accumulates them into
+counters that may be read and reset through stats() to profile individual
+operations.
+
+Time Complexity:
+- O(1) per call to the first constructor, size(), and empty().
+- O(n) per call to the second constructor, where n is the distance between lo
+  and hi.
+- O(B log n) per call to insert() and erase(), and O(log n) per call to find(),
+  where n is the number of entries currently in the map, B is the number of
+  entries per node, and logarithms are base B/2 or greater.
+- O(n) per call to walk(f).
+- O(log n + m) per call to walk(lo, hi, f), where m is the number of entries
+  which are visited.
+
+Space Complexity:
+- O(n) for storage of the map elements, with every node at least half full.
+- O(log n) auxiliary stack space for insert(), erase(), and destruction.
+- O(1) auxiliary for all other operations.
+
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Default allocation policy, handing out nodes from slabs of SLAB_SIZE nodes
+// and recycling freed nodes through a free list. Slabs are only released when
+// the pool is destroyed.
+template<class Node>
+class node_pool {
+  static const int SLAB_SIZE = 1024;
+
+  std::vector<Node*> slabs, free_nodes;
+  int used;
+
+  node_pool(const node_pool &);
+  node_pool& operator=(const node_pool &);
+
+ public:
+  node_pool() : used(SLAB_SIZE) {}
+
+  ~node_pool() {
+    for (int i = 0; i < (int)slabs.size(); i++) {
+      ::operator delete(slabs[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (!free_nodes.empty()) {
+      Node *n = free_nodes.back();
+      free_nodes.pop_back();
+      return n;
+    }
+    if (used == SLAB_SIZE) {
+      void *slab = ::operator new(SLAB_SIZE*sizeof(Node));
+      slabs.push_back(static_cast<Node*>(slab));
+      used = 0;
+    }
+    return slabs.back() + used++;
+  }
+
+  void deallocate(Node *n) {
+    free_nodes.push_back(n);
+  }
+};
+
+// Alternative allocation policy, calling operator new and delete per node.
+template<class Node>
+struct new_allocator {
+  Node* allocate() {
+    return static_cast<Node*>(::operator new(sizeof(Node)));
+  }
+
+  void deallocate(Node *n) {
+    ::operator delete(n);
+  }
+};
+
+// Alternative allocation policy, handing out nodes from chunks of growing size
+// (up to MAX_CHUNK nodes) without ever reusing freed nodes. All storage is
+// released at once when the arena is destroyed, which suits maps that are
+// built and then discarded as a whole.
+template<class Node>
+class arena_allocator {
+  static const int MAX_CHUNK = 65536;
+
+  std::vector<Node*> chunks;
+  int used, capacity;
+
+  arena_allocator(const arena_allocator &);
+  arena_allocator& operator=(const arena_allocator &);
+
+ public:
+  arena_allocator() : used(0), capacity(0) {}
+
+  ~arena_allocator() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+      ::operator delete(chunks[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (used == capacity) {
+      capacity = (capacity == 0) ? 16 : std::min(2*capacity, (int)MAX_CHUNK);
+      void *chunk = ::operator new(capacity*sizeof(Node));
+      chunks.push_back(static_cast<Node*>(chunk));
+      used = 0;
+    }
+    return chunks.back() + used++;
+  }
+
+  void deallocate(Node *) {}
+};
+
+// Default statistics policy, whose empty hooks compile away entirely.
+struct no_stats {
+  void on_allocate() {}
+  void on_rotate() {}
+  void on_visit() {}
+};
+
+// Alternative statistics policy, counting node allocations, rotations, and
+// nodes visited on search paths since construction or the last reset().
+struct counting_stats {
+  long long allocations, rotations, visits;
+
+  counting_stats() : allocations(0), rotations(0), visits(0) {}
+
+  void on_allocate() { allocations++; }
+  void on_rotate() { rotations++; }
+  void on_visit() { visits++; }
+
+  void reset() {
+    allocations = rotations = visits = 0;
+  }
+};
+
+template<class K, class V, int NODE_BYTES = 256,
+         template<class> class Pool = node_pool, class Stats = no_stats>
+class b_plus_tree {
+  static const int LEAF_FIT = (NODE_BYTES - 16)/(sizeof(K) + sizeof(V));
+  static const int INNER_FIT = (NODE_BYTES - 16)/(sizeof(K) + sizeof(void *));
+  static const int LEAF_SIZE = (LEAF_FIT < 4) ? 4 : LEAF_FIT;
+  static const int INNER_SIZE = (INNER_FIT < 4) ? 4 : INNER_FIT;
+
+  // count is the number of entries of a leaf, or children of an inner node.
+  struct node_t {
+    int count;
+    bool is_leaf;
+
+    node_t(bool is_leaf) : count(0), is_leaf(is_leaf) {}
+  };
+
+  struct leaf_t : node_t {
+    K keys[LEAF_SIZE];
+    V values[LEAF_SIZE];
+    leaf_t *next;
+
+    leaf_t() : node_t(true), next(NULL) {}
+  };
+
+  struct inner_t : node_t {
+    K keys[INNER_SIZE - 1];
+    node_t *children[INNER_SIZE];
+
+    inner_t() : node_t(false) {}
+
+    // Index of the child whose subtree would contain the key k.
+    int child_index(const K &k) const {
+      return std::upper_bound(keys, keys + node_t::count - 1, k) - keys;
+    }
+  };
+
+  node_t *root;
+  int num_nodes;
+  Pool<leaf_t> leaf_pool;
+  Pool<inner_t> inner_pool;
+  mutable Stats st;
+
+  leaf_t* create_leaf() {
+    st.on_allocate();
+    return new (leaf_pool.allocate()) leaf_t();
+  }
+
+  inner_t* create_inner() {
+    st.on_allocate();
+    return new (inner_pool.allocate()) inner_t();
+  }
+
+  void destroy(leaf_t *n) {
+    n->~leaf_t();
+    leaf_pool.deallocate(n);
+  }
+
+  void destroy(inner_t *n) {
+    n->~inner_t();
+    inner_pool.deallocate(n);
+  }
+
+  static leaf_t* as_leaf(node_t *n) {
+    return static_cast<leaf_t*>(n);
+  }
+
+  static inner_t* as_inner(node_t *n) {
+    return static_cast<inner_t*>(n);
+  }
+
+  // Returns the new right sibling if n was split, setting sep to the smallest
+  // key in its subtree, or NULL otherwise.
+  node_t* insert(node_t *n, const K &k, const V &v, K &sep, bool &inserted) {
+    st.on_visit();
+    if (n->is_leaf) {
+      leaf_t *l = as_leaf(n);
+      int i = std::lower_bound(l->keys, l->keys + l->count, k) - l->keys;
+      if (i < l->count && !(k < l->keys[i])) {
+        inserted = false;
+        return NULL;
+      }
+      inserted = true;
+      leaf_t *r = NULL;
+      if (l->count == LEAF_SIZE) {
+        r = create_leaf();
+        int half = LEAF_SIZE/2;
+        std::copy(l->keys + half, l->keys + LEAF_SIZE, r->keys);
+        std::copy(l->values + half, l->values + LEAF_SIZE, r->values);
+        r->count = LEAF_SIZE - half;
+        l->count = half;
+        r->next = l->next;
+        l->next = r;
+        if (i > half) {
+          l = r;
+          i -= half;
+        }
+      }
+      std::copy_backward(l->keys + i, l->keys + l->count,
+                         l->keys + l->count + 1);
+      std::copy_backward(l->values + i, l->values + l->count,
+                         l->values + l->count + 1);
+      l->keys[i] = k;
+      l->values[i] = v;
+      l->count++;
+      if (r != NULL) {
+        sep = r->keys[0];
+      }
+      return r;
+    }
+    inner_t *p = as_inner(n);
+    int i = p->child_index(k);
+    K child_sep;
+    node_t *child = insert(p->children[i], k, v, child_sep, inserted);
+    if (child == NULL) {
+      return NULL;
+    }
+    inner_t *r = NULL;
+    if (p->count == INNER_SIZE) {
+      // The left half keeps half children, and keys[half - 1] moves up.
+      r = create_inner();
+      int half = INNER_SIZE/2;
+      std::copy(p->keys + half, p->keys + INNER_SIZE - 1, r->keys);
+      std::copy(p->children + half, p->children + INNER_SIZE, r->children);
+      r->count = INNER_SIZE - half;
+      p->count = half;
+      sep = p->keys[half - 1];
+      if (i >= half) {
+        p = r;
+        i -= half;
+      }
+    }
+    std::copy_backward(p->keys + i, p->keys + p->count - 1,
+                       p->keys + p->count);
+    std::copy_backward(p->children + i + 1, p->children + p->count,
+                       p->children + p->count + 1);
+    p->keys[i] = child_sep;
+    p->children[i + 1] = child;
+    p->count++;
+    return r;
+  }
+
+  // Merges or redistributes the underfull child i of p with a sibling.
+  void rebalance(inner_t *p, int i) {
+    int j = (i > 0) ? i - 1 : i + 1;
+    int left = std::min(i, j), right = std::max(i, j);
+    node_t *a = p->children[left], *b = p->children[right];
+    if (a->is_leaf) {
+      leaf_t *x = as_leaf(a), *y = as_leaf(b);
+      if (x->count + y->count <= LEAF_SIZE) {
+        std::copy(y->keys, y->keys + y->count, x->keys + x->count);
+        std::copy(y->values, y->values + y->count, x->values + x->count);
+        x->count += y->count;
+        x->next = y->next;
+        destroy(y);
+      } else {
+        if (x->count < y->count) {
+          x->keys[x->count] = y->keys[0];
+          x->values[x->count] = y->values[0];
+          x->count++;
+          std::copy(y->keys + 1, y->keys + y->count, y->keys);
+          std::copy(y->values + 1, y->values + y->count, y->values);
+          y->count--;
+        } else {
+          std::copy_backward(y->keys, y->keys + y->count,
+                             y->keys + y->count + 1);
+          std::copy_backward(y->values, y->values + y->count,
+                             y->values + y->count + 1);
+          y->keys[0] = x->keys[x->count - 1];
+          y->values[0] = x->values[x->count - 1];
+          y->count++;
+          x->count--;
+        }
+        p->keys[left] = y->keys[0];
+        return;
+      }
+    } else {
+      inner_t *x = as_inner(a), *y = as_inner(b);
+      if (x->count + y->count <= INNER_SIZE) {
+        x->keys[x->count - 1] = p->keys[left];
+        std::copy(y->keys, y->keys + y->count - 1, x->keys + x->count);
+        std::copy(y->children, y->children + y->count,
+                  x->children + x->count);
+        x->count += y->count;
+        destroy(y);
+      } else {
+        if (x->count < y->count) {
+          x->keys[x->count - 1] = p->keys[left];
+          x->children[x->count] = y->children[0];
+          x->count++;
+          p->keys[left] = y->keys[0];
+          std::copy(y->keys + 1, y->keys + y->count - 1, y->keys);
+          std::copy(y->children + 1, y->children + y->count, y->children);
+          y->count--;
+        } else {
+          std::copy_backward(y->keys, y->keys + y->count - 1,
+                             y->keys + y->count);
+          std::copy_backward(y->children, y->children + y->count,
+                             y->children + y->count + 1);
+          y->keys[0] = p->keys[left];
+          y->children[0] = x->children[x->count - 1];
+          y->count++;
+          p->keys[left] = x->keys[x->count - 2];
+          x->count--;
+        }
+        return;
+      }
+    }
+    // The right node was merged into the left one, so remove it from p.
+    std::copy(p->keys + right, p->keys + p->count - 1, p->keys + left);
+    std::copy(p->children + right + 1, p->children + p->count,
+              p->children + right);
+    p->count--;
+  }
+
+  bool erase(node_t *n, const K &k) {
+    st.on_visit();
+    if (n->is_leaf) {
+      leaf_t *l = as_leaf(n);
+      int i = std::lower_bound(l->keys, l->keys + l->count, k) - l->keys;
+      if (i == l->count || k < l->keys[i]) {
+        return false;
+      }
+      std::copy(l->keys + i + 1, l->keys + l->count, l->keys + i);
+      std::copy(l->values + i + 1, l->values + l->count, l->values + i);
+      l->count--;
+      return true;
+    }
+    inner_t *p = as_inner(n);
+    int i = p->child_index(k);
+    if (!erase(p->children[i], k)) {
+      return false;
+    }
+    node_t *c = p->children[i];
+    if (c->count < (c->is_leaf ? LEAF_SIZE : INNER_SIZE)/2) {
+      rebalance(p, i);
+    }
+    return true;
+  }
+
+  // Builds a level of inner nodes over the given nodes, whose smallest keys
+  // are given by mins, replacing both with those of the new level.
+  void build_level(std::vector<node_t*> &nodes, std::vector<K> &mins) {
+    int n = nodes.size(), m = (n + INNER_SIZE - 1)/INNER_SIZE;
+    std::vector<node_t*> parents;
+    std::vector<K> parent_mins;
+    for (int i = 0, j = 0; i < m; i++) {
+      inner_t *p = create_inner();
+      p->count = n/m + (i < n % m ? 1 : 0);
+      parent_mins.push_back(mins[j]);
+      for (int c = 0; c < p->count; c++, j++) {
+        p->children[c] = nodes[j];
+        if (c > 0) {
+          p->keys[c - 1] = mins[j];
+        }
+      }
+      parents.push_back(p);
+    }
+    nodes.swap(parents);
+    mins.swap(parent_mins);
+  }
+
+  template<class KVFunction>
+  static void walk_leaves(leaf_t *l, int i, const K *hi, KVFunction f) {
+    for (; l != NULL; l = l->next, i = 0) {
+      for (; i < l->count; i++) {
+        if (hi != NULL && *hi < l->keys[i]) {
+          return;
+        }
+        f(l->keys[i], l->values[i]);
+      }
+    }
+  }
+
+  // The recursion is only as deep as the height of the tree, which is at most
+  // logarithmic in base INNER_SIZE/2 since every node is kept half full.
+  void clean_up(node_t *n) {
+    if (!n->is_leaf) {
+      inner_t *p = as_inner(n);
+      for (int i = 0; i < p->count; i++) {
+        clean_up(p->children[i]);
+      }
+      destroy(p);
+    } else {
+      destroy(as_leaf(n));
+    }
+  }
+
+  leaf_t* find_leaf(const K &k) const {
+    node_t *n = root;
+    while (!n->is_leaf) {
+      st.on_visit();
+      inner_t *p = as_inner(n);
+      n = p->children[p->child_index(k)];
+    }
+    st.on_visit();
+    return as_leaf(n);
+  }
+
+ public:
+  b_plus_tree() : num_nodes(0) {
+    root = create_leaf();
+  }
+
+  template<class It>
+  b_plus_tree(It lo, It hi) : num_nodes(0) {
+    std::vector<node_t*> nodes;
+    std::vector<K> mins;
+    std::vector<std::pair<K, V> > entries(lo, hi);
+    int n = entries.size(), m = std::max(1, (n + LEAF_SIZE - 1)/LEAF_SIZE);
+    leaf_t *prev = NULL;
+    for (int i = 0, j = 0; i < m; i++) {
+      leaf_t *l = create_leaf();
+      l->count = n/m + (i < n % m ? 1 : 0);
+      for (int c = 0; c < l->count; c++, j++) {
+        l->keys[c] = entries[j].first;
+        l->values[c] = entries[j].second;
+      }
+      mins.push_back(l->count > 0 ? l->keys[0] : K());
+      if (prev != NULL) {
+        prev->next = l;
+      }
+      nodes.push_back(prev = l);
+    }
+    while (nodes.size() > 1) {
+      build_level(nodes, mins);
+    }
+    root = nodes[0];
+    num_nodes = n;
+  }
+
+  ~b_plus_tree() {
+    clean_up(root);
+  }
+
+  int size() const {
+    return num_nodes;
+  }
+
+  bool empty() const {
+    return num_nodes == 0;
+  }
+
+  bool insert(const K &k, const V &v) {
+    K sep;
+    bool inserted;
+    node_t *r = insert(root, k, v, sep, inserted);
+    if (r != NULL) {
+      inner_t *p = create_inner();
+      p->children[0] = root;
+      p->children[1] = r;
+      p->keys[0] = sep;
+      p->count = 2;
+      root = p;
+    }
+    if (inserted) {
+      num_nodes++;
+    }
+    return inserted;
+  }
+
+  bool erase(const K &k) {
+    if (!erase(root, k)) {
+      return false;
+    }
+    if (!root->is_leaf && root->count == 1) {
+      inner_t *p = as_inner(root);
+      root = p->children[0];
+      destroy(p);
+    }
+    num_nodes--;
+    return true;
+  }
+
+  const V* find(const K &k) const {
+    leaf_t *l = find_leaf(k);
+    int i = std::lower_bound(l->keys, l->keys + l->count, k) - l->keys;
+    if (i == l->count || k < l->keys[i]) {
+      return NULL;
+    }
+    return &(l->values[i]);
+  }
+
+  template<class KVFunction>
+  void walk(KVFunction f) const {
+    node_t *n = root;
+    while (!n->is_leaf) {
+      n = as_inner(n)->children[0];
+    }
+    walk_leaves(as_leaf(n), 0, (const K*)NULL, f);
+  }
+
+  template<class KVFunction>
+  void walk(const K &lo, const K &hi, KVFunction f) const {
+    leaf_t *l = find_leaf(lo);
+    int i = std::lower_bound(l->keys, l->keys + l->count, lo) - l->keys;
+    walk_leaves(l, i, &hi, f);
+  }
+
+  const Stats& stats() const {
+    return st;
+  }
+
+  Stats& stats() {
+    return st;
+  }
+};
+
+/*** Example Usage and Output:
+
+abcde
+bcde
+cd
+Inserting and finding 1000000 random keys:
+std::map: insert 1.397s, find 1.326s
+b_plus_tree: insert 0.378s, find 0.462s
+
+***/
+
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+using namespace std;
+
+void printch(int k, char v) {
+  cout << v;
+}
+
+vector<pair<int, int> > walked;
+
+void record(int k, int v) {
+  walked.push_back(make_pair(k, v));
+}
+
+template<int NODE_BYTES>
+void test_against_map() {
+  b_plus_tree<int, int, NODE_BYTES> t;
+  map<int, int> m;
+  for (int i = 0; i < 100000; i++) {
+    int k = rand() % 5000;
+    if (rand() % 2 == 0) {
+      assert(t.insert(k, i) == m.insert(make_pair(k, i)).second);
+    } else {
+      assert(t.erase(k) == (m.erase(k) > 0));
+    }
+    assert(t.size() == (int)m.size());
+    int q = rand() % 5000;
+    const int *v = t.find(q);
+    assert((v == NULL) == (m.find(q) == m.end()));
+    assert(v == NULL || *v == m[q]);
+  }
+  walked.clear();
+  t.walk(record);
+  vector<pair<int, int> > expected(m.begin(), m.end());
+  assert(walked == expected);
+  walked.clear();
+  t.walk(1000, 2000, record);
+  expected.assign(m.lower_bound(1000), m.upper_bound(2000));
+  assert(walked == expected);
+}
+
+int main() {
+  b_plus_tree<int, char> t;
+  t.insert(2, 'b');
+  t.insert(1, 'a');
+  t.insert(3, 'c');
+  t.insert(5, 'e');
+  assert(t.insert(4, 'd'));
+  assert(*t.find(4) == 'd');
+  assert(!t.insert(4, 'd'));
+  t.walk(printch);
+  cout << endl;
+  assert(t.erase(1));
+  assert(!t.erase(1));
+  assert(t.find(1) == NULL);
+  t.walk(printch);
+  cout << endl;
+  t.walk(3, 4, printch);
+  cout << endl;
+
+  // Allocation policies and operation statistics. Nodes of 64 bytes hold six
+  // int entries per leaf and four children per internal node.
+  vector<pair<int, int> > sorted;
+  for (int i = 0; i < 600; i++) {
+    sorted.push_back(make_pair(i, -i));
+  }
+  b_plus_tree<int, int, 64, arena_allocator, counting_stats> profiled(
+      sorted.begin(), sorted.end());
+  // 100 full leaves under levels of 25, 7, 2, and 1 internal nodes.
+  assert(profiled.stats().allocations == 100 + 25 + 7 + 2 + 1);
+  profiled.stats().reset();
+  assert(*profiled.find(123) == -123 && profiled.stats().visits == 5);
+  assert(profiled.stats().rotations == 0);
+  b_plus_tree<int, int, 64, new_allocator> separate(sorted.begin(),
+                                                    sorted.end());
+  for (int i = 0; i < 600; i++) {
+    if (i % 3 != 0) {
+      assert(separate.erase(i));
+    }
+  }
+  assert(separate.size() == 200 && *separate.find(597) == -597);
+
+  test_against_map<64>();
+  test_against_map<256>();
+  test_against_map<4096>();
+
+  for (int n = 0; n < 2000; n += 37) {
+    vector<pair<int, int> > entries;
+    for (int i = 0; i < n; i++) {
+      entries.push_back(make_pair(2*i, i));
+    }
+    b_plus_tree<int, int, 64> b(entries.begin(), entries.end());
+    assert(b.size() == n);
+    walked.clear();
+    b.walk(record);
+    assert(walked == entries);
+    for (int i = 0; i < n; i++) {
+      assert(*b.find(2*i) == i && b.find(2*i + 1) == NULL);
+    }
+    for (int i = 0; i < n; i += 2) {
+      assert(b.erase(2*i) && b.insert(2*i + 1, i));
+    }
+    assert(b.size() == n);
+  }
+
+  const int n = 1000000;
+  vector<int> keys(n);
+  for (int i = 0; i < n; i++) {
+    keys[i] = rand() ^ (rand() << 15);
+  }
+  cout << "Inserting and finding " << n << " random keys:" << endl;
+  cout.precision(3);
+  cout << fixed;
+  clock_t start = clock();
+  map<int, int> m;
+  for (int i = 0; i < n; i++) {
+    m.insert(make_pair(keys[i], i));
+  }
+  double insert_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  long long sum1 = 0;
+  for (int i = 0; i < n; i++) {
+    sum1 += m.find(keys[i])->second;
+  }
+  cout << "std::map: insert " << insert_time << "s, find "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s" << endl;
+  start = clock();
+  b_plus_tree<int, int> b;
+  for (int i = 0; i < n; i++) {
+    b.insert(keys[i], i);
+  }
+  insert_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  long long sum2 = 0;
+  for (int i = 0; i < n; i++) {
+    sum2 += *b.find(keys[i]);
+  }
+  cout << "b_plus_tree: insert " << insert_time << "s, find "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s" << endl;
+  assert(sum1 == sum2);
+  return 0;
+}
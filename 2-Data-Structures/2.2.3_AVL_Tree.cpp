@@ -17,28 +17,264 @@ heights of the left and right subtrees at every node differ by at most 1.
   removal was successful or false if the key to be removed was not found.
 - find(k) returns a pointer to a const value associated with key k, or NULL if
   the key was not found.
+- select(r) returns a key-value pair of the node with a key of zero-based rank r
+  in the map, throwing an exception if the rank is not between 0 and size() - 1.
+- rank(k) returns the zero-based rank of key k in the map, throwing an
+  exception if the key was not found in the map.
 - walk(f) calls the function f(k, v) on each entry of the map, in ascending
   order of keys.
+- walk(lo, hi, f) calls the function f(k, v) on each entry of the map with a key
+  in the range [lo, hi], in ascending order of keys, skipping every subtree
+  that lies entirely outside of the range.
+- stats() returns a reference to the statistics policy object of the map.
+- begin() returns a cursor to the entry with the smallest key in the map.
+- lower_bound(k) returns a cursor to the entry with the smallest key not less
+  than k, and upper_bound(k) returns a cursor to the entry with the smallest key
+  greater than k.
+- split(k, t) moves every entry with a key not less than k into the map t,
+  which must be empty.
+- join(t) moves every entry of t into this map, leaving t empty. Every key in t
+  must be greater than every key in this map.
+- union_with(t) moves every entry of t with a key not in this map into this
+  map, leaving t empty.
+- intersect_with(t) removes every entry whose key is not in t, leaving t empty.
+- difference_with(t) removes every entry whose key is in t, leaving t empty.
+
+A cursor c points to an entry of the map, or past the last entry if c.valid()
+is false. c.key() and c.value() return the key and value of the entry, and
+c.next() advances c to the entry with the next greater key. A cursor keeps the
+path of unvisited ancestors on an explicit stack, and is invalidated by any
+modification of the map.
+
+The set operations are built on splitting and joining. The root of this map
+is used to split t into the keys that are less and greater than it, the two
+halves are combined recursively with the corresponding subtrees of the root,
+and the results are then joined back together with or without the root. The
+two recursive calls are independent, so they are run as parallel tasks down to
+a depth of PARALLEL_DEPTH. Compile with -fopenmp to enable; otherwise they run
+serially. For entries with keys in both maps, the values of this map are kept.
+
+If the template parameter ORDER_STATISTICS is true, every node is augmented
+with the size of its subtree, which is maintained through rotations, insertions
+and erasures to support select() and rank(). Otherwise, nodes carry no size
+field and calling either function is a compile-time error.
+
+Nodes are allocated through the policy Pool<node_t>, which must provide
+allocate() returning uninitialized storage for one node, deallocate(n), and
+absorb(p) taking over the storage of another pool when the nodes of t are moved
+into this map by join() and the set operations. split() instead moves the nodes
+it detaches into storage from the pool of t, so that each map only ever owns
+nodes of its own pool. The default node_pool carves nodes out of large slabs
+and reuses freed nodes, which avoids a call to the global allocator per
+insertion and erasure. new_allocator may be passed instead to allocate every
+node separately, or arena_allocator to bump allocate nodes from growing chunks
+that are only freed with the map. The destructor frees the nodes iteratively in
+O(1) auxiliary space. Deallocations made by the parallel set operations are
+serialized by a critical section.
+
+The policy Stats receives a call to on_allocate() per node allocation,
+on_rotate() per rotation made by insert() and erase(), and on_visit() per node
+visited by the searches of insert(), erase(), and find(). The default no_stats
+ignores these at no cost, while counting_stats accumulates them into counters
+that may be read and reset through stats() to profile individual operations.
 
 Time Complexity:
 - O(1) per call to the constructor, size(), and empty().
-- O(log n) per call to insert(), erase(), and find(), where n is the number of
-  entries currently in the map.
-- O(n) per call to walk().
+- O(log n) per call to insert(), erase(), find(), select(), and rank(), where n
+  is the number of entries currently in the map.
+- O(n) per call to walk(f).
+- O(log n) per call to begin(), lower_bound(), and upper_bound(), and
+  O(log n + m) per call to walk(lo, hi, f), where m is the number of entries
+  which are visited.
+- O(1) amortized per call to next() when iterating over consecutive entries.
+- O(log n) per call to join(), and O(log n + m) per call to split(), where m is
+  the number of entries moved into t.
+- join() and the set operations also absorb the pool of t, which is linear in
+  the number of slabs and free nodes of t for node_pool, linear in the number
+  of chunks of t for arena_allocator, and O(1) for new_allocator.
+- O(m log(n/m + 1)) work for union_with(), intersect_with(), and
+  difference_with(), where n and m are the sizes of the larger and smaller of
+  the two maps, with O(log^2 n) span when run in parallel.
 
 Space Complexity:
 - O(n) for storage of the map elements.
-- O(log n) auxiliary stack space for insert(), erase(), and walk().
+- O(log n) auxiliary stack space for insert(), erase(), walk(), split(),
+  join(), and the set operations.
+- O(1) auxiliary for destruction.
+- O(h) auxiliary heap space per cursor for the stack of ancestors, where h is
+  the height of the tree.
 - O(1) auxiliary for all other operations.
 
 */
 
 #include <algorithm>
 #include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Default allocation policy, handing out nodes from slabs of SLAB_SIZE nodes
+// and recycling freed nodes through a free list. Slabs are only released when
+// the pool is destroyed.
+template<class Node>
+class node_pool {
+  static const int SLAB_SIZE = 1024;
+
+  std::vector<Node*> slabs, free_nodes;
+  int used;
+
+  node_pool(const node_pool &);
+  node_pool& operator=(const node_pool &);
+
+ public:
+  node_pool() : used(SLAB_SIZE) {}
+
+  ~node_pool() {
+    for (int i = 0; i < (int)slabs.size(); i++) {
+      ::operator delete(slabs[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (!free_nodes.empty()) {
+      Node *n = free_nodes.back();
+      free_nodes.pop_back();
+      return n;
+    }
+    if (used == SLAB_SIZE) {
+      void *slab = ::operator new(SLAB_SIZE*sizeof(Node));
+      slabs.push_back(static_cast<Node*>(slab));
+      used = 0;
+    }
+    return slabs.back() + used++;
+  }
+
+  void deallocate(Node *n) {
+    free_nodes.push_back(n);
+  }
+
+  void absorb(node_pool &p) {
+    for (; p.used < SLAB_SIZE; p.used++) {
+      free_nodes.push_back(p.slabs.back() + p.used);
+    }
+    free_nodes.insert(free_nodes.end(), p.free_nodes.begin(),
+                      p.free_nodes.end());
+    slabs.insert(slabs.begin(), p.slabs.begin(), p.slabs.end());
+    p.slabs.clear();
+    p.free_nodes.clear();
+  }
+};
+
+// Alternative allocation policy, calling operator new and delete per node.
+template<class Node>
+struct new_allocator {
+  Node* allocate() {
+    return static_cast<Node*>(::operator new(sizeof(Node)));
+  }
+
+  void deallocate(Node *n) {
+    ::operator delete(n);
+  }
 
-template<class K, class V>
+  void absorb(new_allocator &) {}
+};
+
+// Alternative allocation policy, handing out nodes from chunks of growing size
+// (up to MAX_CHUNK nodes) without ever reusing freed nodes. All storage is
+// released at once when the arena is destroyed, which suits maps that are
+// built and then discarded as a whole.
+template<class Node>
+class arena_allocator {
+  static const int MAX_CHUNK = 65536;
+
+  std::vector<Node*> chunks;
+  int used, capacity;
+
+  arena_allocator(const arena_allocator &);
+  arena_allocator& operator=(const arena_allocator &);
+
+ public:
+  arena_allocator() : used(0), capacity(0) {}
+
+  ~arena_allocator() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+      ::operator delete(chunks[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (used == capacity) {
+      capacity = (capacity == 0) ? 16 : std::min(2*capacity, (int)MAX_CHUNK);
+      void *chunk = ::operator new(capacity*sizeof(Node));
+      chunks.push_back(static_cast<Node*>(chunk));
+      used = 0;
+    }
+    return chunks.back() + used++;
+  }
+
+  void deallocate(Node *) {}
+
+  void absorb(arena_allocator &p) {
+    chunks.insert(chunks.begin(), p.chunks.begin(), p.chunks.end());
+    p.chunks.clear();
+    p.used = p.capacity = 0;
+  }
+};
+
+// Default statistics policy, whose empty hooks compile away entirely.
+struct no_stats {
+  void on_allocate() {}
+  void on_rotate() {}
+  void on_visit() {}
+};
+
+// Alternative statistics policy, counting node allocations, rotations, and
+// nodes visited on search paths since construction or the last reset().
+struct counting_stats {
+  long long allocations, rotations, visits;
+
+  counting_stats() : allocations(0), rotations(0), visits(0) {}
+
+  void on_allocate() { allocations++; }
+  void on_rotate() { rotations++; }
+  void on_visit() { visits++; }
+
+  void reset() {
+    allocations = rotations = visits = 0;
+  }
+};
+
+template<class K, class V, bool ORDER_STATISTICS = false,
+         template<class> class Pool = node_pool, class Stats = no_stats>
 class avl_tree {
-  struct node_t {
+  // Subtree sizes are only stored when ORDER_STATISTICS is true, so that the
+  // unaugmented tree carries no extra field and no extra updates.
+  template<bool AUGMENTED, class Dummy = void>
+  struct size_field {
+    int size;
+
+    size_field() : size(1) {}
+
+    int get_size() const {
+      return size;
+    }
+
+    void set_size(int s) {
+      size = s;
+    }
+  };
+
+  template<class Dummy>
+  struct size_field<false, Dummy> {
+    int get_size() const {
+      return 0;
+    }
+
+    void set_size(int s) {}
+  };
+
+  struct node_t : public size_field<ORDER_STATISTICS> {
     K key;
     V value;
     int height;
@@ -50,13 +286,40 @@ class avl_tree {
 
   int num_nodes;
 
+  static const int PARALLEL_DEPTH = 8;
+
+  Pool<node_t> pool;
+  mutable Stats st;
+
+  node_t* create(const K &k, const V &v) {
+    st.on_allocate();
+    return new (pool.allocate()) node_t(k, v);
+  }
+
+  // Nodes are also freed by the parallel tasks of the set operations, which
+  // must not use the pool concurrently.
+  void destroy(node_t *n) {
+    n->~node_t();
+#ifdef _OPENMP
+    #pragma omp critical(avl_tree_pool)
+#endif
+    pool.deallocate(n);
+  }
+
   static int height(node_t *n) {
     return (n != NULL) ? n->height : 0;
   }
 
-  static void update_height(node_t *n) {
+  static int size(node_t *n) {
+    return (n != NULL) ? n->get_size() : 0;
+  }
+
+  static void update(node_t *n) {
     if (n != NULL) {
       n->height = 1 + std::max(height(n->left), height(n->right));
+      if (ORDER_STATISTICS) {
+        n->set_size(1 + size(n->left) + size(n->right));
+      }
     }
   }
 
@@ -65,8 +328,8 @@ class avl_tree {
     n = n->right;
     tmp->right = n->left;
     n->left = tmp;
-    update_height(tmp);
-    update_height(n);
+    update(tmp);
+    update(n);
   }
 
   static void rotate_right(node_t *&n) {
@@ -74,82 +337,115 @@ class avl_tree {
     n = n->left;
     tmp->left = n->right;
     n->right = tmp;
-    update_height(tmp);
-    update_height(n);
+    update(tmp);
+    update(n);
   }
 
   static int balance_factor(node_t *n) {
     return (n != NULL) ? (height(n->left) - height(n->right)) : 0;
   }
 
-  static void rebalance(node_t *&n) {
+  // Restores the balance of n, returning the number of rotations made.
+  static int rebalance(node_t *&n) {
     if (n == NULL) {
-      return;
+      return 0;
     }
-    update_height(n);
+    update(n);
     int bf = balance_factor(n);
     if (bf > 1 && balance_factor(n->left) >= 0) {
       rotate_right(n);
+      return 1;
     } else if (bf > 1 && balance_factor(n->left) < 0) {
       rotate_left(n->left);
       rotate_right(n);
+      return 2;
     } else if (bf < -1 && balance_factor(n->right) <= 0) {
       rotate_left(n);
+      return 1;
     } else if (bf < -1 && balance_factor(n->right) > 0) {
       rotate_right(n->right);
       rotate_left(n);
+      return 2;
     }
+    return 0;
   }
 
-  static bool insert(node_t *&n, const K &k, const V &v) {
+  // Rebalances n for insert() and erase(), which report their rotations. The
+  // rotations of split() and join() are not reported, since they may be run
+  // by concurrent tasks of the set operations.
+  void rebalance_counted(node_t *&n) {
+    for (int i = rebalance(n); i > 0; i--) {
+      st.on_rotate();
+    }
+  }
+
+  bool insert(node_t *&n, const K &k, const V &v) {
     if (n == NULL) {
-      n = new node_t(k, v);
+      n = create(k, v);
       return true;
     }
+    st.on_visit();
     if ((k < n->key && insert(n->left, k, v)) ||
         (n->key < k && insert(n->right, k, v))) {
-      rebalance(n);
+      rebalance_counted(n);
       return true;
     }
     return false;
   }
 
-  static bool erase(node_t *&n, const K &k) {
+  bool erase(node_t *&n, const K &k) {
     if (n == NULL) {
       return false;
     }
+    st.on_visit();
     if (!(k < n->key || n->key < k)) {
       if (n->left != NULL && n->right != NULL) {
-        node_t *tmp = n->right, *parent = NULL;
+        node_t *tmp = n->right;
         while (tmp->left != NULL) {
-          parent = tmp;
           tmp = tmp->left;
         }
         n->key = tmp->key;
         n->value = tmp->value;
-        if (parent != NULL) {
-          if (!erase(parent->left, parent->left->key)) {
-            return false;
-          }
-        } else if (!erase(n->right, n->right->key)) {
-          return false;
-        }
+        erase(n->right, tmp->key);
       } else {
         node_t *tmp = (n->left != NULL) ? n->left : n->right;
-        delete n;
+        destroy(n);
         n = tmp;
       }
-      rebalance(n);
+      rebalance_counted(n);
       return true;
     }
     if ((k < n->key && erase(n->left, k)) ||
         (n->key < k && erase(n->right, k))) {
-      rebalance(n);
+      rebalance_counted(n);
       return true;
     }
     return false;
   }
 
+  static std::pair<K, V> select(node_t *n, int r) {
+    int rank = size(n->left);
+    if (r < rank) {
+      return select(n->left, r);
+    } else if (r > rank) {
+      return select(n->right, r - rank - 1);
+    }
+    return std::make_pair(n->key, n->value);
+  }
+
+  static int rank(node_t *n, const K &k) {
+    if (n == NULL) {
+      throw std::runtime_error("Cannot rank key that's not in tree.");
+    }
+    int r = size(n->left);
+    if (k < n->key) {
+      return rank(n->left, k);
+    } else if (n->key < k) {
+      return rank(n->right, k) + r + 1;
+    }
+    return r;
+  }
+
   template<class KVFunction>
   static void walk(node_t *n, KVFunction f) {
     if (n != NULL) {
@@ -159,15 +455,202 @@ class avl_tree {
     }
   }
 
-  static void clean_up(node_t *n) {
+  template<class KVFunction>
+  static void walk(node_t *n, const K &lo, const K &hi, KVFunction f) {
     if (n != NULL) {
-      clean_up(n->left);
-      clean_up(n->right);
-      delete n;
+      if (lo < n->key) {
+        walk(n->left, lo, hi, f);
+      }
+      if (!(n->key < lo || hi < n->key)) {
+        f(n->key, n->value);
+      }
+      if (n->key < hi) {
+        walk(n->right, lo, hi, f);
+      }
+    }
+  }
+
+  // Joins l, m, and r, where every key in l is less than the key of m, which
+  // is in turn less than every key in r.
+  static node_t* join(node_t *l, node_t *m, node_t *r) {
+    int hl = height(l), hr = height(r);
+    if (hl > hr + 1) {
+      l->right = join(l->right, m, r);
+      rebalance(l);
+      return l;
+    }
+    if (hr > hl + 1) {
+      r->left = join(l, m, r->left);
+      rebalance(r);
+      return r;
+    }
+    m->left = l;
+    m->right = r;
+    update(m);
+    return m;
+  }
+
+  // Removes the node with the largest key from n into last, returning the rest.
+  static node_t* split_last(node_t *n, node_t *&last) {
+    if (n->right == NULL) {
+      last = n;
+      return n->left;
+    }
+    node_t *rest = split_last(n->right, last);
+    return join(n->left, n, rest);
+  }
+
+  // Joins l and r, where every key in l is less than every key in r.
+  static node_t* join(node_t *l, node_t *r) {
+    if (l == NULL) {
+      return r;
+    }
+    node_t *last, *rest = split_last(l, last);
+    return join(rest, last, r);
+  }
+
+  // Splits n into the trees l and r of keys less and greater than k,
+  // returning the detached node with key k, or NULL if there is none.
+  static node_t* split(node_t *n, const K &k, node_t *&l, node_t *&r) {
+    if (n == NULL) {
+      l = r = NULL;
+      return NULL;
+    }
+    node_t *m, *mid;
+    if (n->key < k) {
+      m = split(n->right, k, mid, r);
+      l = join(n->left, n, mid);
+    } else if (k < n->key) {
+      m = split(n->left, k, l, mid);
+      r = join(mid, n, n->right);
+    } else {
+      l = n->left;
+      r = n->right;
+      n->left = n->right = NULL;
+      update(n);
+      m = n;
     }
+    return m;
+  }
+
+  enum { UNION, INTERSECTION, DIFFERENCE };
+
+  // Combines a and b, keeping the values of a for keys in both, and adding the
+  // number of nodes deleted to removed.
+  node_t* combine(int op, node_t *a, node_t *b, int &removed,
+                         int depth) {
+    if (a == NULL || b == NULL) {
+      if (op == UNION) {
+        return (a == NULL) ? b : a;
+      }
+      removed += clean_up(b);
+      if (op == INTERSECTION) {
+        removed += clean_up(a);
+        return NULL;
+      }
+      return a;
+    }
+    node_t *bl, *br, *dup = split(b, a->key, bl, br);
+    node_t *al = a->left, *ar = a->right, *l, *r;
+    int removed_l = 0, removed_r = 0;
+#ifdef _OPENMP
+    #pragma omp task shared(l, removed_l) if (depth < PARALLEL_DEPTH)
+#endif
+    l = combine(op, al, bl, removed_l, depth + 1);
+    r = combine(op, ar, br, removed_r, depth + 1);
+#ifdef _OPENMP
+    #pragma omp taskwait
+#endif
+    removed += removed_l + removed_r;
+    if (dup != NULL) {
+      destroy(dup);
+      removed++;
+    }
+    if (op == UNION || (op == INTERSECTION) == (dup != NULL)) {
+      return join(l, a, r);
+    }
+    destroy(a);
+    removed++;
+    return join(l, r);
+  }
+
+  void combine_with(int op, avl_tree &t) {
+    node_t *res;
+    int removed = 0;
+    pool.absorb(t.pool);
+#ifdef _OPENMP
+    #pragma omp parallel
+    #pragma omp single
+#endif
+    res = combine(op, root, t.root, removed, 0);
+    root = res;
+    num_nodes += t.num_nodes - removed;
+    t.root = NULL;
+    t.num_nodes = 0;
+  }
+
+  // Moves the nodes of n into the pool of t, returning the copy of n and adding
+  // the number of nodes moved to moved.
+  node_t* transfer(node_t *n, avl_tree &t, int &moved) {
+    if (n == NULL) {
+      return NULL;
+    }
+    t.st.on_allocate();
+    node_t *res = new (t.pool.allocate()) node_t(*n);
+    res->left = transfer(n->left, t, moved);
+    res->right = transfer(n->right, t, moved);
+    destroy(n);
+    moved++;
+    return res;
+  }
+
+  // Frees the nodes of n in O(1) auxiliary space by rotating each left child
+  // up until the current node has none, returning the number of nodes freed.
+  int clean_up(node_t *n) {
+    int res = 0;
+    while (n != NULL) {
+      if (n->left != NULL) {
+        node_t *l = n->left;
+        n->left = l->right;
+        l->right = n;
+        n = l;
+      } else {
+        node_t *right = n->right;
+        destroy(n);
+        n = right;
+        res++;
+      }
+    }
+    return res;
   }
 
  public:
+  class cursor {
+    friend class avl_tree;
+    std::vector<const node_t*> path;
+
+   public:
+    bool valid() const {
+      return !path.empty();
+    }
+
+    const K& key() const {
+      return path.back()->key;
+    }
+
+    const V& value() const {
+      return path.back()->value;
+    }
+
+    void next() {
+      const node_t *n = path.back()->right;
+      path.pop_back();
+      for (; n != NULL; n = n->left) {
+        path.push_back(n);
+      }
+    }
+  };
+
   avl_tree() : root(NULL), num_nodes(0) {}
 
   ~avl_tree() {
@@ -201,6 +684,7 @@ class avl_tree {
   const V* find(const K &k) const {
     node_t *n = root;
     while (n != NULL) {
+      st.on_visit();
       if (k < n->key) {
         n = n->left;
       } else if (n->key < k) {
@@ -212,27 +696,136 @@ class avl_tree {
     return NULL;
   }
 
+  std::pair<K, V> select(int r) const {
+    (void)sizeof(char[ORDER_STATISTICS ? 1 : -1]);  // Requires augmentation.
+    if (r < 0 || r >= num_nodes) {
+      throw std::runtime_error("Select rank must be between 0 and size() - 1.");
+    }
+    return select(root, r);
+  }
+
+  int rank(const K &k) const {
+    (void)sizeof(char[ORDER_STATISTICS ? 1 : -1]);  // Requires augmentation.
+    return rank(root, k);
+  }
+
   template<class KVFunction>
   void walk(KVFunction f) const {
     walk(root, f);
   }
+
+  template<class KVFunction>
+  void walk(const K &lo, const K &hi, KVFunction f) const {
+    walk(root, lo, hi, f);
+  }
+
+  const Stats& stats() const {
+    return st;
+  }
+
+  Stats& stats() {
+    return st;
+  }
+
+  cursor begin() const {
+    cursor c;
+    for (node_t *n = root; n != NULL; n = n->left) {
+      c.path.push_back(n);
+    }
+    return c;
+  }
+
+  cursor lower_bound(const K &k) const {
+    cursor c;
+    node_t *n = root;
+    while (n != NULL) {
+      if (n->key < k) {
+        n = n->right;
+      } else {
+        c.path.push_back(n);
+        n = n->left;
+      }
+    }
+    return c;
+  }
+
+  cursor upper_bound(const K &k) const {
+    cursor c;
+    node_t *n = root;
+    while (n != NULL) {
+      if (k < n->key) {
+        c.path.push_back(n);
+        n = n->left;
+      } else {
+        n = n->right;
+      }
+    }
+    return c;
+  }
+
+  void split(const K &k, avl_tree &t) {
+    node_t *l, *r, *m = split(root, k, l, r);
+    if (m != NULL) {
+      r = join(NULL, m, r);
+    }
+    root = l;
+    t.num_nodes = 0;
+    t.root = transfer(r, t, t.num_nodes);
+    num_nodes -= t.num_nodes;
+  }
+
+  void join(avl_tree &t) {
+    pool.absorb(t.pool);
+    root = join(root, t.root);
+    num_nodes += t.num_nodes;
+    t.root = NULL;
+    t.num_nodes = 0;
+  }
+
+  void union_with(avl_tree &t) {
+    combine_with(UNION, t);
+  }
+
+  void intersect_with(avl_tree &t) {
+    combine_with(INTERSECTION, t);
+  }
+
+  void difference_with(avl_tree &t) {
+    combine_with(DIFFERENCE, t);
+  }
 };
 
 /*** Example Usage and Output:
 
 abcde
 bcde
+Ranking 1000000 random keys:
+avl_tree (augmented): insert 2.072s, rank 1.634s, select+rank 0.363s
+avl_tree: insert 1.767s
 
 ***/
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+#include <vector>
 using namespace std;
 
 void printch(int k, char v) {
   cout << v;
 }
 
+vector<int> walked;
+
+void record(int k, int v) {
+  walked.push_back(k);
+}
+
 int main() {
   avl_tree<int, char> t;
   t.insert(2, 'b');
@@ -249,5 +842,209 @@ int main() {
   assert(t.find(1) == NULL);
   t.walk(printch);
   cout << endl;
+
+  srand(1);
+  for (int tests = 0; tests < 300; tests++) {
+    avl_tree<int, int> a, b;
+    set<int> sa, sb;
+    int n = rand() % 200, range = rand() % 300 + 1;
+    for (int i = 0; i < n; i++) {
+      int x = rand() % range, y = rand() % range;
+      a.insert(x, 1);
+      b.insert(y, 2);
+      sa.insert(x);
+      sb.insert(y);
+    }
+    set<int> expected;
+    int op = tests % 4;
+    if (op == 0) {
+      a.union_with(b);
+      set_union(sa.begin(), sa.end(), sb.begin(), sb.end(),
+                inserter(expected, expected.begin()));
+    } else if (op == 1) {
+      a.intersect_with(b);
+      set_intersection(sa.begin(), sa.end(), sb.begin(), sb.end(),
+                       inserter(expected, expected.begin()));
+    } else if (op == 2) {
+      a.difference_with(b);
+      set_difference(sa.begin(), sa.end(), sb.begin(), sb.end(),
+                     inserter(expected, expected.begin()));
+    } else {
+      int k = rand() % (range + 1);
+      avl_tree<int, int> c;
+      a.split(k, c);
+      assert(c.size() == (int)distance(sa.lower_bound(k), sa.end()));
+      a.join(c);
+      assert(c.empty());
+      b.intersect_with(c);
+      expected = sa;
+    }
+    assert(a.size() == (int)expected.size() && b.empty() && b.size() == 0);
+    walked.clear();
+    a.walk(record);
+    assert(walked == vector<int>(expected.begin(), expected.end()));
+    for (set<int>::iterator it = expected.begin(); it != expected.end(); ++it) {
+      assert(*a.find(*it) == (sa.count(*it) ? 1 : 2));
+    }
+  }
+
+  const int n = 1000000;
+  avl_tree<int, int> big1, big2;
+  for (int i = 0; i < n; i++) {
+    big1.insert(2*i, i);
+    big2.insert(3*i, i);
+  }
+  big1.union_with(big2);
+  assert(big1.size() == n + n - (n + 2)/3);
+
+  srand(2);
+  typedef avl_tree<int, int>::cursor cursor;
+  avl_tree<int, int> m;
+  set<int> s;
+  for (int i = 0; i < 3000; i++) {
+    int x = rand() % 1000;
+    if (rand() % 3 == 0) {
+      assert(m.erase(x) == (s.erase(x) > 0));
+    } else {
+      assert(m.insert(x, -x) == s.insert(x).second);
+    }
+  }
+  assert(m.size() == (int)s.size());
+  for (int i = 0; i < 300; i++) {
+    int lo = rand() % 1100 - 50, hi = lo + rand() % 200;
+    vector<int> expected(s.lower_bound(lo), s.upper_bound(hi));
+    walked.clear();
+    m.walk(lo, hi, record);
+    assert(walked == expected);
+    walked.clear();
+    for (cursor c = m.lower_bound(lo); c.valid() && c.key() <= hi; c.next()) {
+      assert(c.value() == -c.key());
+      walked.push_back(c.key());
+    }
+    assert(walked == expected);
+    cursor c = m.upper_bound(lo);
+    set<int>::iterator it = s.upper_bound(lo);
+    assert(c.valid() ? (it != s.end() && c.key() == *it) : it == s.end());
+  }
+  walked.clear();
+  for (cursor c = m.begin(); c.valid(); c.next()) {
+    walked.push_back(c.key());
+  }
+  assert(walked == vector<int>(s.begin(), s.end()));
+
+  avl_tree<int, int, true> o;
+  set<int> os;
+  for (int i = 0; i < 5000; i++) {
+    int x = rand() % 2000;
+    if (rand() % 3 == 0) {
+      assert(o.erase(x) == (os.erase(x) > 0));
+    } else {
+      assert(o.insert(x, -x) == os.insert(x).second);
+    }
+    if (i % 500 == 0) {
+      int r = 0;
+      for (set<int>::iterator it = os.begin(); it != os.end(); ++it, r++) {
+        assert(o.rank(*it) == r && o.select(r).first == *it);
+        assert(o.select(r).second == -*it);
+      }
+    }
+  }
+  assert(o.size() == (int)os.size());
+  try {
+    o.select(o.size());
+    assert(false);
+  } catch (std::runtime_error &) {}
+  avl_tree<int, int, true> o2;
+  for (int i = 0; i < 3000; i++) {
+    int x = rand() % 4000;
+    o2.insert(x, -x);
+    os.insert(x);
+  }
+  o.union_with(o2);
+  for (int r = 0; r < o.size(); r++) {
+    assert(o.rank(o.select(r).first) == r);
+  }
+  assert(o.size() == (int)os.size());
+  assert(o.select(o.size() - 1).first == *os.rbegin());
+
+  const int num_keys = 1000000;
+  vector<int> keys(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    keys[i] = ((rand() & 0x7fff) << 15) ^ (rand() & 0x7fff);
+  }
+  cout << "Ranking " << num_keys << " random keys:" << endl;
+  cout.precision(3);
+  cout << fixed;
+  clock_t start = clock();
+  avl_tree<int, int, true> t2;
+  for (int i = 0; i < num_keys; i++) {
+    t2.insert(keys[i], i);
+  }
+  double insert_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  long long rank_sum = 0, select_sum = 0;
+  for (int i = 0; i < num_keys; i++) {
+    rank_sum += t2.rank(keys[i]);
+  }
+  double rank_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  for (int i = 0; i < t2.size(); i++) {
+    select_sum += t2.rank(t2.select(i).first);
+  }
+  cout << "avl_tree (augmented): insert " << insert_time
+       << "s, rank "
+       << rank_time << "s, select+rank "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s" << endl;
+  start = clock();
+  avl_tree<int, int> t1;
+  for (int i = 0; i < num_keys; i++) {
+    t1.insert(keys[i], i);
+  }
+  cout << "avl_tree: insert " << (double)(clock() - start)/CLOCKS_PER_SEC
+       << "s" << endl;
+  // Against the positions of the keys in a sorted copy without duplicates.
+  vector<int> sorted(keys);
+  sort(sorted.begin(), sorted.end());
+  sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+  long long distinct = sorted.size(), expected = 0;
+  for (int i = 0; i < num_keys; i++) {
+    expected += lower_bound(sorted.begin(), sorted.end(), keys[i]) -
+                sorted.begin();
+  }
+  assert(t2.size() == distinct && rank_sum == expected);
+  assert(select_sum == distinct*(distinct - 1)/2);
+  for (int i = 0; i < distinct; i += 997) {
+    assert(t2.select(i).first == sorted[i]);
+  }
+
+  // Maps that exchange nodes may be destroyed in any order.
+  typedef avl_tree<int, int, true, arena_allocator, counting_stats> counted;
+  counted *lo = new counted(), *hi = new counted();
+  for (int i = 0; i < 1023; i++) {
+    assert(lo->insert(i, i));
+  }
+  // Sorted insertions into an AVL tree make n - log2(n + 1) rotations.
+  assert(lo->stats().allocations == 1023 && lo->stats().rotations == 1013);
+  lo->stats().reset();
+  assert(*lo->find(0) == 0 && lo->stats().visits == 10);
+  lo->split(500, *hi);
+  assert(hi->stats().allocations == 523 && hi->rank(1000) == 500);
+  delete lo;
+  lo = new counted();
+  for (int i = 0; i < 500; i++) {
+    assert(lo->insert(i, -i));
+  }
+  lo->join(*hi);
+  delete hi;
+  for (int i = 0; i < 1023; i++) {
+    assert(*lo->find(i) == ((i < 500) ? -i : i) && lo->rank(i) == i);
+  }
+  delete lo;
+  avl_tree<int, int, false, new_allocator> evens, odds;
+  for (int i = 0; i < 1000; i++) {
+    ((i % 2 == 0) ? evens : odds).insert(i, i);
+  }
+  evens.intersect_with(odds);
+  assert(evens.empty() && odds.empty());
   return 0;
 }
@@ -6,7 +6,17 @@ ordering on the set of possible keys defined by the < operator on the key type.
 A splay tree is a balanced binary search tree with the additional property that
 recently accessed elements are quick to access again.
 
-- splay_tree() constructs an empty map.
+Splaying is done top-down and iteratively in a single pass from the root,
+rather than by recursing to the accessed node and rotating on the way back up.
+Lookups may optionally splay only a random fraction p of the time, trading the
+move-to-root adaptivity for fewer writes on workloads where restructuring cost
+dominates. For a skewed access distribution, even a small p moves frequently
+accessed keys near the root after a few accesses, while most lookups become
+plain searches that leave the tree unchanged.
+
+- splay_tree(p) constructs an empty map in which find() splays the accessed
+  node with probability p (by default 1, i.e. on every access). Insertions,
+  erasures, and range queries always splay.
 - size() returns the size of the map.
 - empty() returns whether the map is empty.
 - insert(k, v) adds an entry with key k and value v to the map, returning true
@@ -16,25 +26,182 @@ recently accessed elements are quick to access again.
   removal was successful or false if the key to be removed was not found.
 - find(k) returns a pointer to a const value associated with key k, or NULL if
   the key was not found.
+- peek(k) is like find(k), but never splays. Since it does not modify the tree,
+  it may be called concurrently from multiple threads in the absence of writes
+  (as long as Stats is no_stats).
 - walk(f) calls the function f(k, v) on each entry of the map, in ascending
   order of keys.
+- walk(lo, hi, f) calls the function f(k, v) on each entry of the map with a key
+  in the range [lo, hi], in ascending order of keys, skipping every subtree
+  that lies entirely outside of the range.
+- stats() returns a reference to the statistics policy object of the map.
+- begin() returns a cursor to the entry with the smallest key in the map.
+- lower_bound(k) returns a cursor to the entry with the smallest key not less
+  than k, and upper_bound(k) returns a cursor to the entry with the smallest key
+  greater than k.
+
+A cursor c points to an entry of the map, or past the last entry if c.valid()
+is false. c.key() and c.value() return the key and value of the entry, and
+c.next() advances c to the entry with the next greater key. A cursor keeps the
+path of unvisited ancestors on an explicit stack, and is invalidated by any
+modification of the map.
+
+Nodes are allocated through the policy Pool<node_t>, which must provide
+allocate() returning uninitialized storage for one node and deallocate(n). The
+default node_pool carves nodes out of large slabs and reuses freed nodes, which
+avoids a call to the global allocator per insertion and erasure. new_allocator
+may be passed instead to allocate every node separately, or arena_allocator to
+bump allocate nodes from growing chunks that are only freed with the map. The
+destructor frees the nodes iteratively in O(1) auxiliary space.
+
+The policy Stats receives a call to on_allocate() per node allocation,
+on_rotate() per rotation, and on_visit() per node visited while searching or
+splaying. The default no_stats ignores these at no cost, while counting_stats
+accumulates them into counters that may be read and reset through stats()
+to profile individual operations.
 
 Time Complexity:
 - O(1) per call to the constructor, size(), and empty().
-- O(log n) per call to insert(), erase(), and find(), where n is the number of
-  entries currently in the map.
-- O(n) per call to walk().
+- O(log n) amortized per call to insert(), erase(), and find(), where n is the
+  number of entries currently in the map. When find() splays with probability
+  p < 1, the bound holds in expectation, plus an additive O(n log n / p) over
+  the whole sequence of operations.
+- O(h) per call to peek(), where h is the height of the tree.
+- O(n) per call to walk(f).
+- O(log n) amortized per call to lower_bound() and upper_bound(), which splay
+  k to the root, and O(log n + m) amortized per call to walk(lo, hi, f), which
+  splays hi and then lo, where m is the number of entries which are visited.
+- O(h) per call to begin(), where h is the height of the tree.
+- O(1) amortized per call to next() when iterating over consecutive entries.
 
 Space Complexity:
 - O(n) for storage of the map elements.
-- O(log n) auxiliary stack space for insert(), erase(), and walk().
-- O(1) auxiliary for all other operations.
+- O(h) auxiliary stack space for walk().
+- O(h) auxiliary heap space per cursor for the stack of ancestors, where h is
+  the height of the tree.
+- O(1) auxiliary for all other operations, including destruction.
 
 */
 
+#include <algorithm>
 #include <cstddef>
+#include <new>
+#include <vector>
+
+// Default allocation policy, handing out nodes from slabs of SLAB_SIZE nodes
+// and recycling freed nodes through a free list. Slabs are only released when
+// the pool is destroyed.
+template<class Node>
+class node_pool {
+  static const int SLAB_SIZE = 1024;
+
+  std::vector<Node*> slabs, free_nodes;
+  int used;
+
+  node_pool(const node_pool &);
+  node_pool& operator=(const node_pool &);
+
+ public:
+  node_pool() : used(SLAB_SIZE) {}
+
+  ~node_pool() {
+    for (int i = 0; i < (int)slabs.size(); i++) {
+      ::operator delete(slabs[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (!free_nodes.empty()) {
+      Node *n = free_nodes.back();
+      free_nodes.pop_back();
+      return n;
+    }
+    if (used == SLAB_SIZE) {
+      void *slab = ::operator new(SLAB_SIZE*sizeof(Node));
+      slabs.push_back(static_cast<Node*>(slab));
+      used = 0;
+    }
+    return slabs.back() + used++;
+  }
+
+  void deallocate(Node *n) {
+    free_nodes.push_back(n);
+  }
+};
+
+// Alternative allocation policy, calling operator new and delete per node.
+template<class Node>
+struct new_allocator {
+  Node* allocate() {
+    return static_cast<Node*>(::operator new(sizeof(Node)));
+  }
+
+  void deallocate(Node *n) {
+    ::operator delete(n);
+  }
+};
+
+// Alternative allocation policy, handing out nodes from chunks of growing size
+// (up to MAX_CHUNK nodes) without ever reusing freed nodes. All storage is
+// released at once when the arena is destroyed, which suits maps that are
+// built and then discarded as a whole.
+template<class Node>
+class arena_allocator {
+  static const int MAX_CHUNK = 65536;
+
+  std::vector<Node*> chunks;
+  int used, capacity;
 
-template<class K, class V>
+  arena_allocator(const arena_allocator &);
+  arena_allocator& operator=(const arena_allocator &);
+
+ public:
+  arena_allocator() : used(0), capacity(0) {}
+
+  ~arena_allocator() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+      ::operator delete(chunks[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (used == capacity) {
+      capacity = (capacity == 0) ? 16 : std::min(2*capacity, (int)MAX_CHUNK);
+      void *chunk = ::operator new(capacity*sizeof(Node));
+      chunks.push_back(static_cast<Node*>(chunk));
+      used = 0;
+    }
+    return chunks.back() + used++;
+  }
+
+  void deallocate(Node *) {}
+};
+
+// Default statistics policy, whose empty hooks compile away entirely.
+struct no_stats {
+  void on_allocate() {}
+  void on_rotate() {}
+  void on_visit() {}
+};
+
+// Alternative statistics policy, counting node allocations, rotations, and
+// nodes visited on search paths since construction or the last reset().
+struct counting_stats {
+  long long allocations, rotations, visits;
+
+  counting_stats() : allocations(0), rotations(0), visits(0) {}
+
+  void on_allocate() { allocations++; }
+  void on_rotate() { rotations++; }
+  void on_visit() { visits++; }
+
+  void reset() {
+    allocations = rotations = visits = 0;
+  }
+};
+
+template<class K, class V, template<class> class Pool = node_pool,
+         class Stats = no_stats>
 class splay_tree {
   struct node_t {
     K key;
@@ -46,68 +213,118 @@ class splay_tree {
   } *root;
 
   int num_nodes;
+  double splay_probability;
+  unsigned int seed;
+  Pool<node_t> pool;
+  mutable Stats st;
+
+  node_t* create(const K &k, const V &v) {
+    st.on_allocate();
+    return new (pool.allocate()) node_t(k, v);
+  }
 
-  static void rotate_left(node_t *&n) {
+  void destroy(node_t *n) {
+    n->~node_t();
+    pool.deallocate(n);
+  }
+
+  // Returns whether an access should splay, using a xorshift generator.
+  bool should_splay() {
+    if (splay_probability >= 1) {
+      return true;
+    }
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed < splay_probability*4294967296.0;
+  }
+
+  node_t* search(node_t *n, const K &k) const {
+    while (n != NULL) {
+      st.on_visit();
+      if (k < n->key) {
+        n = n->left;
+      } else if (n->key < k) {
+        n = n->right;
+      } else {
+        return n;
+      }
+    }
+    return NULL;
+  }
+
+  void rotate_left(node_t *&n) {
+    st.on_rotate();
     node_t *tmp = n;
     n = n->right;
     tmp->right = n->left;
     n->left = tmp;
   }
 
-  static void rotate_right(node_t *&n) {
+  void rotate_right(node_t *&n) {
+    st.on_rotate();
     node_t *tmp = n;
     n = n->left;
     tmp->left = n->right;
     n->right = tmp;
   }
 
-  static void splay(node_t *&n, const K &k) {
+  // Splays the node with key k (or the last node on its search path if k is
+  // not in the tree) to the root of n. This is done top-down in a single pass,
+  // unlinking the nodes less than and greater than k into two trees which are
+  // reattached as the left and right subtrees of the new root.
+  void splay(node_t *&n, const K &k) {
     if (n == NULL) {
       return;
     }
-    if (k < n->key && n->left != NULL) {
-      if (k < n->left->key) {
-        splay(n->left->left, k);
-        rotate_right(n);
-      } else if (n->left->key < k) {
-        splay(n->left->right, k);
-        if (n->left->right != NULL) {
-          rotate_left(n->left);
+    node_t *t = n, *l = NULL, *r = NULL, **l_max = &l, **r_min = &r;
+    for (;;) {
+      st.on_visit();
+      if (k < t->key) {
+        if (t->left != NULL && k < t->left->key) {
+          rotate_right(t);
         }
-      }
-      if (n->left != NULL) {
-        rotate_right(n);
-      }
-    } else if (n->key < k && n->right != NULL) {
-      if (k < n->right->key) {
-        splay(n->right->left, k);
-        if (n->right->left != NULL) {
-          rotate_right(n->right);
+        if (t->left == NULL) {
+          break;
         }
-      } else if (n->right->key < k) {
-        splay(n->right->right, k);
-        rotate_left(n);
-      }
-      if (n->right != NULL) {
-        rotate_left(n);
+        *r_min = t;
+        r_min = &(t->left);
+        t = t->left;
+      } else if (t->key < k) {
+        if (t->right != NULL && t->right->key < k) {
+          rotate_left(t);
+        }
+        if (t->right == NULL) {
+          break;
+        }
+        *l_max = t;
+        l_max = &(t->right);
+        t = t->right;
+      } else {
+        break;
       }
     }
+    *l_max = t->left;
+    *r_min = t->right;
+    t->left = l;
+    t->right = r;
+    n = t;
   }
 
-  static bool insert(node_t *&n, const K &k, const V &v) {
+  bool insert(node_t *&n, const K &k, const V &v) {
     if (n == NULL) {
-      n = new node_t(k, v);
+      n = create(k, v);
       return true;
     }
     splay(n, k);
     if (k < n->key) {
-      node_t *tmp = new node_t(k, v);
+      node_t *tmp = create(k, v);
       tmp->left = n->left;
       tmp->right = n;
       n->left = NULL;
       n = tmp;
     } else if (n->key < k) {
-      node_t *tmp = new node_t(k, v);
+      node_t *tmp = create(k, v);
       tmp->left = n;
       tmp->right = n->right;
       n->right = NULL;
@@ -118,7 +335,7 @@ class splay_tree {
     return true;
   }
 
-  static bool erase(node_t *&n, const K &k) {
+  bool erase(node_t *&n, const K &k) {
     if (n == NULL) {
       return false;
     }
@@ -134,7 +351,7 @@ class splay_tree {
       n = n->left;
       n->right = tmp->right;
     }
-    delete tmp;
+    destroy(tmp);
     return true;
   }
 
@@ -147,16 +364,68 @@ class splay_tree {
     }
   }
 
-  static void clean_up(node_t *n) {
+  template<class KVFunction>
+  static void walk(node_t *n, const K &lo, const K &hi, KVFunction f) {
     if (n != NULL) {
-      clean_up(n->left);
-      clean_up(n->right);
-      delete n;
+      if (lo < n->key) {
+        walk(n->left, lo, hi, f);
+      }
+      if (!(n->key < lo || hi < n->key)) {
+        f(n->key, n->value);
+      }
+      if (n->key < hi) {
+        walk(n->right, lo, hi, f);
+      }
+    }
+  }
+
+  // Frees the nodes of n in O(1) auxiliary space by rotating each left child
+  // up until the current node has none, so that deep paths are safe.
+  void clean_up(node_t *n) {
+    while (n != NULL) {
+      if (n->left != NULL) {
+        node_t *l = n->left;
+        n->left = l->right;
+        l->right = n;
+        n = l;
+      } else {
+        node_t *right = n->right;
+        destroy(n);
+        n = right;
+      }
     }
   }
 
  public:
-  splay_tree() : root(NULL), num_nodes(0) {}
+  class cursor {
+    friend class splay_tree;
+    std::vector<const node_t*> path;
+
+   public:
+    bool valid() const {
+      return !path.empty();
+    }
+
+    const K& key() const {
+      return path.back()->key;
+    }
+
+    const V& value() const {
+      return path.back()->value;
+    }
+
+    void next() {
+      const node_t *n = path.back()->right;
+      path.pop_back();
+      for (; n != NULL; n = n->left) {
+        path.push_back(n);
+      }
+    }
+  };
+
+  splay_tree(double splay_probability = 1)
+      : root(NULL), num_nodes(0), splay_probability(splay_probability),
+        seed(2463534242u) {}
 
   ~splay_tree() {
     clean_up(root);
@@ -187,31 +456,110 @@ class splay_tree {
   }
 
   const V* find(const K &k) {
+    if (!should_splay()) {
+      return peek(k);
+    }
     splay(root, k);
-    return (k < root->key || root->key < k) ? NULL : &(root->value);
+    if (root == NULL || k < root->key || root->key < k) {
+      return NULL;
+    }
+    return &(root->value);
+  }
+
+  const V* peek(const K &k) const {
+    node_t *n = search(root, k);
+    return (n == NULL) ? NULL : &(n->value);
   }
 
   template<class KVFunction>
   void walk(KVFunction f) const {
     walk(root, f);
   }
+
+  template<class KVFunction>
+  void walk(const K &lo, const K &hi, KVFunction f) {
+    splay(root, hi);
+    splay(root, lo);
+    walk(root, lo, hi, f);
+  }
+
+  const Stats& stats() const {
+    return st;
+  }
+
+  Stats& stats() {
+    return st;
+  }
+
+  cursor begin() const {
+    cursor c;
+    for (node_t *n = root; n != NULL; n = n->left) {
+      c.path.push_back(n);
+    }
+    return c;
+  }
+
+  cursor lower_bound(const K &k) {
+    splay(root, k);
+    cursor c;
+    node_t *n = root;
+    while (n != NULL) {
+      if (n->key < k) {
+        n = n->right;
+      } else {
+        c.path.push_back(n);
+        n = n->left;
+      }
+    }
+    return c;
+  }
+
+  cursor upper_bound(const K &k) {
+    splay(root, k);
+    cursor c;
+    node_t *n = root;
+    while (n != NULL) {
+      if (k < n->key) {
+        c.path.push_back(n);
+        n = n->left;
+      } else {
+        n = n->right;
+      }
+    }
+    return c;
+  }
 };
 
 /*** Example Usage and Output:
 
 abcde
 bcde
+Looking up 2000000 keys in a map of 100000:
+p = 1.000: uniform 0.599s, skewed 0.257s
+p = 0.100: uniform 0.723s, skewed 0.378s
+p = 0.000: uniform 1.235s, skewed 0.805s
 
 ***/
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
+#include <set>
+#include <vector>
 using namespace std;
 
 void printch(int k, char v) {
   cout << v;
 }
 
+vector<int> walked;
+
+void record(int k, int v) {
+  walked.push_back(k);
+}
+
 int main() {
   splay_tree<int, char> t;
   t.insert(2, 'b');
@@ -228,5 +576,129 @@ int main() {
   assert(t.find(1) == NULL);
   t.walk(printch);
   cout << endl;
+
+  srand(2);
+  typedef splay_tree<int, int>::cursor cursor;
+  splay_tree<int, int> m;
+  set<int> s;
+  for (int i = 0; i < 3000; i++) {
+    int x = rand() % 1000;
+    if (rand() % 3 == 0) {
+      assert(m.erase(x) == (s.erase(x) > 0));
+    } else {
+      assert(m.insert(x, -x) == s.insert(x).second);
+    }
+  }
+  assert(m.size() == (int)s.size());
+  for (int i = 0; i < 300; i++) {
+    int lo = rand() % 1100 - 50, hi = lo + rand() % 200;
+    vector<int> expected(s.lower_bound(lo), s.upper_bound(hi));
+    walked.clear();
+    m.walk(lo, hi, record);
+    assert(walked == expected);
+    walked.clear();
+    for (cursor c = m.lower_bound(lo); c.valid() && c.key() <= hi; c.next()) {
+      assert(c.value() == -c.key());
+      walked.push_back(c.key());
+    }
+    assert(walked == expected);
+    cursor c = m.upper_bound(lo);
+    set<int>::iterator it = s.upper_bound(lo);
+    assert(c.valid() ? (it != s.end() && c.key() == *it) : it == s.end());
+  }
+  walked.clear();
+  for (cursor c = m.begin(); c.valid(); c.next()) {
+    walked.push_back(c.key());
+  }
+  assert(walked == vector<int>(s.begin(), s.end()));
+
+  for (int pass = 0; pass < 2; pass++) {
+    splay_tree<int, int> t2((pass == 0) ? 1 : 0.25);
+    set<int> s2;
+    assert(t2.find(0) == NULL && t2.peek(0) == NULL);
+    for (int i = 0; i < 20000; i++) {
+      int x = rand() % 500, op = rand() % 4;
+      if (op == 0) {
+        assert(t2.erase(x) == (s2.erase(x) > 0));
+      } else if (op == 1) {
+        assert(t2.insert(x, -x) == s2.insert(x).second);
+      } else {
+        const int *v = (op == 2) ? t2.find(x) : t2.peek(x);
+        assert((v != NULL) == (s2.count(x) > 0) && (v == NULL || *v == -x));
+      }
+    }
+    assert(t2.size() == (int)s2.size());
+    walked.clear();
+    t2.walk(record);
+    assert(walked == vector<int>(s2.begin(), s2.end()));
+  }
+
+  // Splaying a sorted sequence of inserts creates a path of depth n, which the
+  // iterative splay handles without running out of stack.
+  splay_tree<int, int> path;
+  for (int i = 0; i < 1000000; i++) {
+    path.insert(i, i);
+  }
+  assert(*path.find(0) == 0 && *path.find(500000) == 500000);
+
+  // Allocation policies and operation statistics.
+  splay_tree<int, int, arena_allocator, counting_stats> counted;
+  splay_tree<int, int, new_allocator> separate;
+  for (int i = 0; i < 1000; i++) {
+    assert(counted.insert(i, i) && separate.insert(i, -i));
+  }
+  assert(counted.stats().allocations == 1000);
+  assert(counted.stats().rotations == 0);
+  counted.stats().reset();
+  assert(*counted.find(0) == 0);
+  long long deep = counted.stats().visits;
+  assert(deep >= 500 && counted.stats().rotations >= 499);
+  counted.stats().reset();
+  assert(*counted.find(0) == 0 && counted.stats().visits == 1);
+  assert(counted.stats().allocations == 0 && counted.stats().rotations == 0);
+  for (int i = 0; i < 1000; i += 2) {
+    assert(counted.erase(i) && separate.erase(i));
+  }
+  for (int i = 0; i < 1000; i++) {
+    assert((counted.peek(i) != NULL) == (i % 2 == 1));
+    assert((separate.find(i) == NULL) == (i % 2 == 0));
+  }
+
+  const int n = 100000, num_queries = 2000000;
+  vector<int> keys(n), uniform(num_queries), skewed(num_queries);
+  for (int i = 0; i < n; i++) {
+    keys[i] = i;
+  }
+  random_shuffle(keys.begin(), keys.end());
+  for (int i = 0; i < num_queries; i++) {
+    uniform[i] = rand() % n;
+    // Roughly 90% of lookups go to 1% of the keys.
+    skewed[i] = keys[(rand() % 10 != 0) ? rand() % (n / 100) : rand() % n];
+  }
+  cout << "Looking up " << num_queries << " keys in a map of " << n << ":"
+       << endl;
+  cout.precision(3);
+  cout << fixed;
+  const double probabilities[] = {1, 0.1, 0};
+  for (int i = 0; i < 3; i++) {
+    splay_tree<int, int> t3(probabilities[i]);
+    for (int j = 0; j < n; j++) {
+      t3.insert(keys[j], j);
+    }
+    long long sum = 0;
+    clock_t start = clock();
+    for (int j = 0; j < num_queries; j++) {
+      sum += *t3.find(uniform[j]);
+    }
+    double uniform_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+    start = clock();
+    for (int j = 0; j < num_queries; j++) {
+      sum += *t3.find(skewed[j]);
+    }
+    cout << "p = " << probabilities[i] << ": uniform " << uniform_time
+         << "s, skewed " << (double)(clock() - start)/CLOCKS_PER_SEC << "s"
+         << endl;
+    assert(sum >= 0);
+  }
   return 0;
 }
@@ -23,25 +23,175 @@ size of its subtree, using it to maintain balance and compute order statistics.
   exception if the key was not found in the map.
 - walk(f) calls the function f(k, v) on each entry of the map, in ascending
   order of keys.
+- walk(lo, hi, f) calls the function f(k, v) on each entry of the map with a key
+  in the range [lo, hi], in ascending order of keys, skipping every subtree
+  that lies entirely outside of the range.
+- stats() returns a reference to the statistics policy object of the map.
+- begin() returns a cursor to the entry with the smallest key in the map.
+- lower_bound(k) returns a cursor to the entry with the smallest key not less
+  than k, and upper_bound(k) returns a cursor to the entry with the smallest key
+  greater than k.
+
+A cursor c points to an entry of the map, or past the last entry if c.valid()
+is false. c.key() and c.value() return the key and value of the entry, and
+c.next() advances c to the entry with the next greater key. A cursor keeps the
+path of unvisited ancestors on an explicit stack, and is invalidated by any
+modification of the map.
+
+Nodes are allocated through the policy Pool<node_t>, which must provide
+allocate() returning uninitialized storage for one node and deallocate(n). The
+default node_pool carves nodes out of large slabs and reuses freed nodes, which
+avoids a call to the global allocator per insertion and erasure. new_allocator
+may be passed instead to allocate every node separately, or arena_allocator to
+bump allocate nodes from growing chunks that are only freed with the map. The
+destructor frees the nodes iteratively in O(1) auxiliary space.
+
+The policy Stats receives a call to on_allocate() per node allocation,
+on_rotate() per rotation, and on_visit() per node visited by the searches of
+insert(), erase(), and find(). The default no_stats ignores these at no cost,
+while counting_stats accumulates them into counters that may be read and reset
+through stats() to profile individual operations.
 
 Time Complexity:
 - O(1) per call to the constructor, size(), and empty().
 - O(log n) per call to insert(), erase(), find(), select(), and rank(), where n
   is the number of entries currently in the map.
-- O(n) per call to walk().
+- O(n) per call to walk(f).
+- O(log n) per call to begin(), lower_bound(), and upper_bound(), and
+  O(log n + m) per call to walk(lo, hi, f), where m is the number of entries
+  which are visited.
+- O(1) amortized per call to next() when iterating over consecutive entries.
 
 Space Complexity:
 - O(n) for storage of the map elements.
 - O(log n) auxiliary stack space for insert(), erase(), and walk().
-- O(1) auxiliary for all other operations.
+- O(h) auxiliary heap space per cursor for the stack of ancestors, where h is
+  the height of the tree.
+- O(1) auxiliary for all other operations, including destruction.
 
 */
 
+#include <algorithm>
 #include <cstddef>
+#include <new>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
-template<class K, class V>
+// Default allocation policy, handing out nodes from slabs of SLAB_SIZE nodes
+// and recycling freed nodes through a free list. Slabs are only released when
+// the pool is destroyed.
+template<class Node>
+class node_pool {
+  static const int SLAB_SIZE = 1024;
+
+  std::vector<Node*> slabs, free_nodes;
+  int used;
+
+  node_pool(const node_pool &);
+  node_pool& operator=(const node_pool &);
+
+ public:
+  node_pool() : used(SLAB_SIZE) {}
+
+  ~node_pool() {
+    for (int i = 0; i < (int)slabs.size(); i++) {
+      ::operator delete(slabs[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (!free_nodes.empty()) {
+      Node *n = free_nodes.back();
+      free_nodes.pop_back();
+      return n;
+    }
+    if (used == SLAB_SIZE) {
+      void *slab = ::operator new(SLAB_SIZE*sizeof(Node));
+      slabs.push_back(static_cast<Node*>(slab));
+      used = 0;
+    }
+    return slabs.back() + used++;
+  }
+
+  void deallocate(Node *n) {
+    free_nodes.push_back(n);
+  }
+};
+
+// Alternative allocation policy, calling operator new and delete per node.
+template<class Node>
+struct new_allocator {
+  Node* allocate() {
+    return static_cast<Node*>(::operator new(sizeof(Node)));
+  }
+
+  void deallocate(Node *n) {
+    ::operator delete(n);
+  }
+};
+
+// Alternative allocation policy, handing out nodes from chunks of growing size
+// (up to MAX_CHUNK nodes) without ever reusing freed nodes. All storage is
+// released at once when the arena is destroyed, which suits maps that are
+// built and then discarded as a whole.
+template<class Node>
+class arena_allocator {
+  static const int MAX_CHUNK = 65536;
+
+  std::vector<Node*> chunks;
+  int used, capacity;
+
+  arena_allocator(const arena_allocator &);
+  arena_allocator& operator=(const arena_allocator &);
+
+ public:
+  arena_allocator() : used(0), capacity(0) {}
+
+  ~arena_allocator() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+      ::operator delete(chunks[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (used == capacity) {
+      capacity = (capacity == 0) ? 16 : std::min(2*capacity, (int)MAX_CHUNK);
+      void *chunk = ::operator new(capacity*sizeof(Node));
+      chunks.push_back(static_cast<Node*>(chunk));
+      used = 0;
+    }
+    return chunks.back() + used++;
+  }
+
+  void deallocate(Node *) {}
+};
+
+// Default statistics policy, whose empty hooks compile away entirely.
+struct no_stats {
+  void on_allocate() {}
+  void on_rotate() {}
+  void on_visit() {}
+};
+
+// Alternative statistics policy, counting node allocations, rotations, and
+// nodes visited on search paths since construction or the last reset().
+struct counting_stats {
+  long long allocations, rotations, visits;
+
+  counting_stats() : allocations(0), rotations(0), visits(0) {}
+
+  void on_allocate() { allocations++; }
+  void on_rotate() { rotations++; }
+  void on_visit() { visits++; }
+
+  void reset() {
+    allocations = rotations = visits = 0;
+  }
+};
+
+template<class K, class V, template<class> class Pool = node_pool,
+         class Stats = no_stats>
 class size_balanced_tree {
   struct node_t {
     K key;
@@ -67,11 +217,25 @@ class size_balanced_tree {
     }
   } *root;
 
+  Pool<node_t> pool;
+  mutable Stats st;
+
+  node_t* create(const K &k, const V &v) {
+    st.on_allocate();
+    return new (pool.allocate()) node_t(k, v);
+  }
+
+  void destroy(node_t *n) {
+    n->~node_t();
+    pool.deallocate(n);
+  }
+
   static inline int size(node_t *n) {
     return (n == NULL) ? 0 : n->size;
   }
 
-  static void rotate(node_t *&n, int c) {
+  void rotate(node_t *&n, int c) {
+    st.on_rotate();
     node_t *tmp = n->child(c);
     n->child(c) = tmp->child(!c);
     tmp->child(!c) = n;
@@ -80,7 +244,7 @@ class size_balanced_tree {
     n = tmp;
   }
 
-  static void maintain(node_t *&n, int c) {
+  void maintain(node_t *&n, int c) {
     if (n == NULL || n->child(c) == NULL) {
       return;
     }
@@ -99,11 +263,12 @@ class size_balanced_tree {
     maintain(n, 1);
   }
 
-  static bool insert(node_t *&n, const K &k, const V &v) {
+  bool insert(node_t *&n, const K &k, const V &v) {
     if (n == NULL) {
-      n = new node_t(k, v);
+      n = create(k, v);
       return true;
     }
+    st.on_visit();
     bool result;
     if (k < n->key) {
       result = insert(n->left, k, v);
@@ -118,10 +283,11 @@ class size_balanced_tree {
     return result;
   }
 
-  static bool erase(node_t *&n, const K &k) {
+  bool erase(node_t *&n, const K &k) {
     if (n == NULL) {
       return false;
     }
+    st.on_visit();
     bool result;
     int c = (k < n->key);
     if (k < n->key) {
@@ -132,7 +298,7 @@ class size_balanced_tree {
       if (n->right == NULL || n->left == NULL) {
         node_t *tmp = n;
         n = (n->right == NULL) ? n->left : n->right;
-        delete tmp;
+        destroy(tmp);
         return true;
       }
       node_t *p = n->right;
@@ -140,6 +306,7 @@ class size_balanced_tree {
         p = p->left;
       }
       n->key = p->key;
+      n->value = p->value;
       result = erase(n->right, p->key);
     }
     maintain(n, c);
@@ -179,15 +346,65 @@ class size_balanced_tree {
     }
   }
 
-  static void clean_up(node_t *n) {
+  template<class KVFunction>
+  static void walk(node_t *n, const K &lo, const K &hi, KVFunction f) {
     if (n != NULL) {
-      clean_up(n->left);
-      clean_up(n->right);
-      delete n;
+      if (lo < n->key) {
+        walk(n->left, lo, hi, f);
+      }
+      if (!(n->key < lo || hi < n->key)) {
+        f(n->key, n->value);
+      }
+      if (n->key < hi) {
+        walk(n->right, lo, hi, f);
+      }
+    }
+  }
+
+  // Frees the nodes of n in O(1) auxiliary space by rotating each left child
+  // up until the current node has none, so that deep paths are safe.
+  void clean_up(node_t *n) {
+    while (n != NULL) {
+      if (n->left != NULL) {
+        node_t *l = n->left;
+        n->left = l->right;
+        l->right = n;
+        n = l;
+      } else {
+        node_t *right = n->right;
+        destroy(n);
+        n = right;
+      }
     }
   }
 
  public:
+  class cursor {
+    friend class size_balanced_tree;
+    std::vector<const node_t*> path;
+
+   public:
+    bool valid() const {
+      return !path.empty();
+    }
+
+    const K& key() const {
+      return path.back()->key;
+    }
+
+    const V& value() const {
+      return path.back()->value;
+    }
+
+    void next() {
+      const node_t *n = path.back()->right;
+      path.pop_back();
+      for (; n != NULL; n = n->left) {
+        path.push_back(n);
+      }
+    }
+  };
+
   size_balanced_tree() : root(NULL) {}
 
   ~size_balanced_tree() {
@@ -213,6 +430,7 @@ class size_balanced_tree {
   const V* find(const K &k) const {
     node_t *n = root;
     while (n != NULL) {
+      st.on_visit();
       if (k < n->key) {
         n = n->left;
       } else if (n->key < k) {
@@ -239,23 +457,84 @@ class size_balanced_tree {
   void walk(KVFunction f) const {
     walk(root, f);
   }
+
+  template<class KVFunction>
+  void walk(const K &lo, const K &hi, KVFunction f) const {
+    walk(root, lo, hi, f);
+  }
+
+  const Stats& stats() const {
+    return st;
+  }
+
+  Stats& stats() {
+    return st;
+  }
+
+  cursor begin() const {
+    cursor c;
+    for (node_t *n = root; n != NULL; n = n->left) {
+      c.path.push_back(n);
+    }
+    return c;
+  }
+
+  cursor lower_bound(const K &k) const {
+    cursor c;
+    node_t *n = root;
+    while (n != NULL) {
+      if (n->key < k) {
+        n = n->right;
+      } else {
+        c.path.push_back(n);
+        n = n->left;
+      }
+    }
+    return c;
+  }
+
+  cursor upper_bound(const K &k) const {
+    cursor c;
+    node_t *n = root;
+    while (n != NULL) {
+      if (k < n->key) {
+        c.path.push_back(n);
+        n = n->left;
+      } else {
+        n = n->right;
+      }
+    }
+    return c;
+  }
 };
 
 /*** Example Usage and Output:
 
 abcde
 bcde
+Ranking 1000000 random keys:
+size_balanced_tree: insert 1.899s, rank 1.236s, select+rank 0.332s
 
 ***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
+#include <set>
+#include <vector>
 using namespace std;
 
 void printch(int k, char v) {
   cout << v;
 }
 
+vector<int> walked;
+
+void record(int k, int v) {
+  walked.push_back(k);
+}
+
 int main() {
   size_balanced_tree<int, char> t;
   t.insert(2, 'b');
@@ -278,5 +557,104 @@ int main() {
   assert(t.select(0).first == 2);
   assert(t.select(1).first == 3);
   assert(t.select(2).first == 4);
+
+  srand(2);
+  typedef size_balanced_tree<int, int>::cursor cursor;
+  size_balanced_tree<int, int> m;
+  set<int> s;
+  for (int i = 0; i < 3000; i++) {
+    int x = rand() % 1000;
+    if (rand() % 3 == 0) {
+      assert(m.erase(x) == (s.erase(x) > 0));
+    } else {
+      assert(m.insert(x, -x) == s.insert(x).second);
+    }
+  }
+  assert(m.size() == (int)s.size());
+  for (int i = 0; i < 300; i++) {
+    int lo = rand() % 1100 - 50, hi = lo + rand() % 200;
+    vector<int> expected(s.lower_bound(lo), s.upper_bound(hi));
+    walked.clear();
+    m.walk(lo, hi, record);
+    assert(walked == expected);
+    walked.clear();
+    for (cursor c = m.lower_bound(lo); c.valid() && c.key() <= hi; c.next()) {
+      assert(c.value() == -c.key());
+      walked.push_back(c.key());
+    }
+    assert(walked == expected);
+    cursor c = m.upper_bound(lo);
+    set<int>::iterator it = s.upper_bound(lo);
+    assert(c.valid() ? (it != s.end() && c.key() == *it) : it == s.end());
+  }
+  walked.clear();
+  for (cursor c = m.begin(); c.valid(); c.next()) {
+    walked.push_back(c.key());
+  }
+  assert(walked == vector<int>(s.begin(), s.end()));
+
+  // Allocation policies and operation statistics.
+  size_balanced_tree<int, int, arena_allocator, counting_stats> counted;
+  size_balanced_tree<int, int, new_allocator> separate;
+  for (int i = 0; i < 1023; i++) {
+    assert(counted.insert(i, i) && separate.insert(i, -i));
+  }
+  assert(counted.stats().allocations == 1023);
+  assert(counted.stats().rotations > 0 && counted.stats().rotations < 1023);
+  counted.stats().reset();
+  for (int i = 0; i < 1023; i++) {
+    assert(*counted.find(i) == i);
+  }
+  // Sorted insertions keep the tree within a few levels of perfect balance.
+  assert(counted.stats().visits <= 1023*12 && counted.stats().rotations == 0);
+  for (int i = 0; i < 1023; i += 2) {
+    assert(counted.erase(i) && separate.erase(i));
+  }
+  for (int i = 0; i < 1023; i++) {
+    assert((counted.find(i) != NULL) == (i % 2 == 1));
+  }
+  assert(separate.rank(511) == 255 && separate.select(0).second == -1);
+
+  const int num_keys = 1000000;
+  vector<int> keys(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    keys[i] = ((rand() & 0x7fff) << 15) ^ (rand() & 0x7fff);
+  }
+  cout << "Ranking " << num_keys << " random keys:" << endl;
+  cout.precision(3);
+  cout << fixed;
+  clock_t start = clock();
+  size_balanced_tree<int, int> t2;
+  for (int i = 0; i < num_keys; i++) {
+    t2.insert(keys[i], i);
+  }
+  double insert_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  long long rank_sum = 0, select_sum = 0;
+  for (int i = 0; i < num_keys; i++) {
+    rank_sum += t2.rank(keys[i]);
+  }
+  double rank_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  for (int i = 0; i < t2.size(); i++) {
+    select_sum += t2.rank(t2.select(i).first);
+  }
+  cout << "size_balanced_tree: insert " << insert_time << "s, rank "
+       << rank_time << "s, select+rank "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s" << endl;
+  // Against the positions of the keys in a sorted copy without duplicates.
+  vector<int> sorted(keys);
+  sort(sorted.begin(), sorted.end());
+  sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+  long long distinct = sorted.size(), expected = 0;
+  for (int i = 0; i < num_keys; i++) {
+    expected += lower_bound(sorted.begin(), sorted.end(), keys[i]) -
+                sorted.begin();
+  }
+  assert(t2.size() == distinct && rank_sum == expected);
+  assert(select_sum == distinct*(distinct - 1)/2);
+  for (int i = 0; i < distinct; i += 997) {
+    assert(t2.select(i).first == sorted[i]);
+  }
   return 0;
 }
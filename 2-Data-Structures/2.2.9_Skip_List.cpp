@@ -21,38 +21,218 @@ skipping over fewer elements than the previous one.
   constructed value if key k was not originally found.
 - walk(f) calls the function f(k, v) on each entry of the map, in ascending
   order of keys.
+- select(r) returns a key-value pair of the entry with a key of zero-based rank
+  r in the map, throwing an exception if the rank is not between 0 and
+  size() - 1.
+- rank(k) returns the zero-based rank of key k in the map, throwing an
+  exception if the key is not in the map.
+- insert_sorted_batch(lo, hi) inserts every key-value pair in the range [lo, hi)
+  of std::pair whose key is not already in the map, given that the range is
+  sorted by key. Each search resumes from where the previous one ended at each
+  level, so the whole batch is threaded into the list in a single pass. Returns
+  the number of entries added.
+- stats() returns a reference to the statistics policy object of the map.
+
+Each forward pointer stores the number of entries it skips over, which is what
+makes select() and rank() run in logarithmic time.
+
+Nodes of skip_list are allocated through the policy Pool<node_t>, which must
+provide allocate() returning uninitialized storage for one node and
+deallocate(n). The default node_pool carves nodes out of large slabs and reuses
+freed nodes, which avoids a call to the global allocator per insertion and
+erasure. new_allocator may be passed instead to allocate every node separately,
+or arena_allocator to bump allocate nodes from growing chunks that are only
+freed with the map. The towers of next pointers and widths remain separately
+allocated vectors. The policy Stats receives a call to on_allocate() per node
+allocation and on_visit() per node stepped onto by the searches of insert(),
+erase(), insert_sorted_batch(), and find(). Skip lists do not rotate, so
+on_rotate() is never called. The default no_stats ignores these at no cost,
+while counting_stats accumulates them into counters that may be read and reset
+through stats() to profile individual operations.
+
+concurrent_skip_list may be shared by many threads at once without locks. Each
+node is a single allocation holding its tower of next pointers inline. insert()
+and erase() modify the list only by compare-and-swap, with erase() first marking
+every level of a node's tower and then unlinking it, helped by any other thread
+that encounters the mark. find() never writes to or waits on nodes, and simply
+steps over marked ones. Unlinked nodes are freed by epoch-based reclamation once
+no operation which could still be reading them remains. It supports size(),
+empty(), insert(k, v), erase(k), and walk(f) as above, with find(k, &v) instead
+returning whether key k exists, copying its value into v if so. Since values
+cannot be safely modified in place, operator[] is not supported. size() and
+walk(f) do not observe a single snapshot of the list while other threads are
+modifying it. Its nodes are allocated with operator new rather than through a
+Pool policy, since they are freed by whichever thread advances the epoch and
+the pools are not thread-safe. The example tests run in parallel if compiled
+with -fopenmp; otherwise they run serially.
 
 Time Complexity:
 - O(1) per call to the constructor, size(), and empty().
-- O(log n) on average per call to insert(), erase(), find(), and operator[],
-  where n is the number of entries currently in the map.
+- O(log n) on average per call to insert(), erase(), find(), operator[],
+  select(), and rank(), where n is the number of entries currently in the map.
+- O(m log(n/m + 2)) on average per call to insert_sorted_batch(lo, hi), where m
+  is the distance between lo and hi.
 - O(n) per call to walk().
+- O(log n) on average per call to the operations of concurrent_skip_list, in
+  the absence of contention.
 
 Space Complexity:
 - O(n) on average for storage of the map elements.
-- O(n) auxiliary heap space for insert() and erase().
-- O(1) auxiliary for all other operations.
+- O(1) auxiliary for all operations.
 
 */
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
-template<class K, class V>
+// Default allocation policy, handing out nodes from slabs of SLAB_SIZE nodes
+// and recycling freed nodes through a free list. Slabs are only released when
+// the pool is destroyed.
+template<class Node>
+class node_pool {
+  static const int SLAB_SIZE = 1024;
+
+  std::vector<Node*> slabs, free_nodes;
+  int used;
+
+  node_pool(const node_pool &);
+  node_pool& operator=(const node_pool &);
+
+ public:
+  node_pool() : used(SLAB_SIZE) {}
+
+  ~node_pool() {
+    for (int i = 0; i < (int)slabs.size(); i++) {
+      ::operator delete(slabs[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (!free_nodes.empty()) {
+      Node *n = free_nodes.back();
+      free_nodes.pop_back();
+      return n;
+    }
+    if (used == SLAB_SIZE) {
+      void *slab = ::operator new(SLAB_SIZE*sizeof(Node));
+      slabs.push_back(static_cast<Node*>(slab));
+      used = 0;
+    }
+    return slabs.back() + used++;
+  }
+
+  void deallocate(Node *n) {
+    free_nodes.push_back(n);
+  }
+};
+
+// Alternative allocation policy, calling operator new and delete per node.
+template<class Node>
+struct new_allocator {
+  Node* allocate() {
+    return static_cast<Node*>(::operator new(sizeof(Node)));
+  }
+
+  void deallocate(Node *n) {
+    ::operator delete(n);
+  }
+};
+
+// Alternative allocation policy, handing out nodes from chunks of growing size
+// (up to MAX_CHUNK nodes) without ever reusing freed nodes. All storage is
+// released at once when the arena is destroyed, which suits maps that are
+// built and then discarded as a whole.
+template<class Node>
+class arena_allocator {
+  static const int MAX_CHUNK = 65536;
+
+  std::vector<Node*> chunks;
+  int used, capacity;
+
+  arena_allocator(const arena_allocator &);
+  arena_allocator& operator=(const arena_allocator &);
+
+ public:
+  arena_allocator() : used(0), capacity(0) {}
+
+  ~arena_allocator() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+      ::operator delete(chunks[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (used == capacity) {
+      capacity = (capacity == 0) ? 16 : std::min(2*capacity, (int)MAX_CHUNK);
+      void *chunk = ::operator new(capacity*sizeof(Node));
+      chunks.push_back(static_cast<Node*>(chunk));
+      used = 0;
+    }
+    return chunks.back() + used++;
+  }
+
+  void deallocate(Node *) {}
+};
+
+// Default statistics policy, whose empty hooks compile away entirely.
+struct no_stats {
+  void on_allocate() {}
+  void on_rotate() {}
+  void on_visit() {}
+};
+
+// Alternative statistics policy, counting node allocations, rotations, and
+// nodes visited on search paths since construction or the last reset().
+struct counting_stats {
+  long long allocations, rotations, visits;
+
+  counting_stats() : allocations(0), rotations(0), visits(0) {}
+
+  void on_allocate() { allocations++; }
+  void on_rotate() { rotations++; }
+  void on_visit() { visits++; }
+
+  void reset() {
+    allocations = rotations = visits = 0;
+  }
+};
+
+template<class K, class V, template<class> class Pool = node_pool,
+         class Stats = no_stats>
 class skip_list {
   static const int MAX_LEVELS = 32;  // log2(max possible keys)
 
+  // width[i] is the number of bottom level links skipped over by next[i]. It is
+  // only maintained for links that are not NULL.
   struct node_t {
     K key;
     V value;
     std::vector<node_t*> next;
+    std::vector<int> width;
 
     node_t(const K &k, const V &v, int levels)
-        : key(k), value(v), next(levels, (node_t*)NULL) {}
+        : key(k), value(v), next(levels, (node_t*)NULL), width(levels, 0) {}
   } *head;
 
   int num_nodes;
+  Pool<node_t> pool;
+  mutable Stats st;
+
+  node_t* create(const K &k, const V &v, int levels) {
+    st.on_allocate();
+    return new (pool.allocate()) node_t(k, v, levels);
+  }
+
+  void destroy(node_t *n) {
+    n->~node_t();
+    pool.deallocate(n);
+  }
 
   static int random_level() {
     static const double p = 0.5;
@@ -71,15 +251,74 @@ class skip_list {
     return i + 1;
   }
 
+  int top_level() const {
+    int level = node_level(head->next);
+    return (level < MAX_LEVELS) ? level : MAX_LEVELS;
+  }
+
+  // Sets update[i] to the last node at level i with a key less than k, and
+  // pos[i] to its one-based position in the list (with the head at 0), for
+  // each level i from the given one down. The search for each level resumes
+  // from update[i] if it is already further along, which is valid as long as
+  // update[] and pos[] were last located for a key not greater than k.
+  void locate(const K &k, node_t **update, int *pos, int from) const {
+    node_t *n = update[from];
+    int p = pos[from];
+    for (int i = from + 1; i-- > 0; ) {
+      if (pos[i] > p) {
+        n = update[i];
+        p = pos[i];
+      }
+      while (n->next[i] != NULL && n->next[i]->key < k) {
+        p += n->width[i];
+        n = n->next[i];
+        st.on_visit();
+      }
+      update[i] = n;
+      pos[i] = p;
+    }
+  }
+
+  void reset(node_t **update, int *pos) const {
+    for (int i = 0; i < MAX_LEVELS; i++) {
+      update[i] = head;
+      pos[i] = 0;
+    }
+  }
+
+  // Links a new node after update[0], which must be located for key k, and
+  // moves update[] and pos[] to the new node at each of its levels.
+  void link(const K &k, const V &v, int levels, node_t **update, int *pos) {
+    node_t *n = create(k, v, levels);
+    int r = pos[0] + 1;
+    for (int i = 0; i < levels; i++) {
+      n->next[i] = update[i]->next[i];
+      n->width[i] = update[i]->width[i] - (r - pos[i]) + 1;
+      update[i]->next[i] = n;
+      update[i]->width[i] = r - pos[i];
+      update[i] = n;
+      pos[i] = r;
+    }
+    for (int i = levels; i < MAX_LEVELS; i++) {
+      update[i]->width[i]++;
+    }
+    num_nodes++;
+  }
+
  public:
-  skip_list() : head(new node_t(K(), V(), MAX_LEVELS)), num_nodes(0) {
+  skip_list() : num_nodes(0) {
+    head = create(K(), V(), MAX_LEVELS);
     for (int i = 0; i < (int)head->next.size(); i++) {
       head->next[i] = NULL;
     }
   }
 
   ~skip_list() {
-    delete head;
+    while (head != NULL) {
+      node_t *next = head->next[0];
+      destroy(head);
+      head = next;
+    }
   }
 
   int size() const {
@@ -91,56 +330,104 @@ class skip_list {
   }
 
   bool insert(const K &k, const V &v) {
-    std::vector<node_t*> update(head->next);
-    int curr_level = node_level(update);
-    node_t *n = head;
-    for (int i = curr_level; i-- > 0; ) {
-      while (n->next[i] != NULL && n->next[i]->key < k) {
-        n = n->next[i];
-      }
-      update[i] = n;
-    }
-    n = n->next[0];
+    node_t *update[MAX_LEVELS];
+    int pos[MAX_LEVELS];
+    reset(update, pos);
+    locate(k, update, pos, top_level() - 1);
+    node_t *n = update[0]->next[0];
     if (n != NULL && n->key == k) {
       return false;
     }
-    int new_level = random_level();
-    if (new_level > curr_level) {
-      for (int i = curr_level; i < new_level; i++) {
-        update[i] = head;
+    link(k, v, random_level(), update, pos);
+    return true;
+  }
+
+  // Inserts the key-value pairs in [lo, hi), which must be sorted by key, in a
+  // single forward pass. Each search climbs from the previous key's position
+  // only as high as needed to pass the new key, and then descends from there.
+  // Levels are drawn from the trailing zeros of a random word per entry, rather
+  // than from one call to rand() per level. Returns the number of new entries
+  // that were added.
+  template<class It>
+  int insert_sorted_batch(It lo, It hi) {
+    node_t *update[MAX_LEVELS];
+    int pos[MAX_LEVELS], inserted = 0;
+    reset(update, pos);
+    unsigned int state = ((rand() & 0x7fff) << 15) ^ (rand() & 0x7fff) ^ 1;
+    for (; lo != hi; ++lo) {
+      int i = 0, top = top_level();
+      while (i < top - 1 && update[i]->next[i] != NULL &&
+             update[i]->next[i]->key < lo->first) {
+        i++;
       }
+      locate(lo->first, update, pos, i);
+      node_t *n = update[0]->next[0];
+      // update[0] is the entry just linked if the batch repeats its key.
+      if ((n != NULL && n->key == lo->first) ||
+          (update[0] != head && update[0]->key == lo->first)) {
+        continue;
+      }
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      link(lo->first, lo->second, 1 + __builtin_ctz(state | (1u << 31)),
+           update, pos);
+      inserted++;
     }
-    n = new node_t(k, v, new_level);
-    for (int i = 0; i < new_level; i++) {
-      n->next[i] = update[i]->next[i];
-      update[i]->next[i] = n;
+    return inserted;
+  }
+
+  bool erase(const K &k) {
+    node_t *update[MAX_LEVELS];
+    int pos[MAX_LEVELS];
+    reset(update, pos);
+    locate(k, update, pos, top_level() - 1);
+    node_t *n = update[0]->next[0];
+    if (n == NULL || !(n->key == k)) {
+      return false;
     }
-    num_nodes++;
+    for (int i = 0; i < MAX_LEVELS; i++) {
+      if (i < (int)n->next.size() && update[i]->next[i] == n) {
+        update[i]->next[i] = n->next[i];
+        update[i]->width[i] += n->width[i] - 1;
+      } else {
+        update[i]->width[i]--;
+      }
+    }
+    destroy(n);
+    num_nodes--;
     return true;
   }
 
-  bool erase(const K &k) {
-    std::vector<node_t*> update(head->next);
+  std::pair<K, V> select(int r) const {
+    if (r < 0 || r >= num_nodes) {
+      throw std::runtime_error("Select rank must be between 0 and size() - 1.");
+    }
     node_t *n = head;
-    for (int i = node_level(update); i-- > 0; ) {
+    int p = 0;
+    for (int i = node_level(head->next); i-- > 0; ) {
+      while (n->next[i] != NULL && p + n->width[i] <= r + 1) {
+        p += n->width[i];
+        n = n->next[i];
+      }
+    }
+    return std::make_pair(n->key, n->value);
+  }
+
+  int rank(const K &k) const {
+    node_t *n = head;
+    int p = 0;
+    for (int i = node_level(head->next); i-- > 0; ) {
       while (n->next[i] != NULL && n->next[i]->key < k) {
+        p += n->width[i];
         n = n->next[i];
       }
-      update[i] = n;
     }
     n = n->next[0];
-    if (n != NULL && n->key == k) {
-      for (int i = 0; i < (int)update.size(); i++) {
-        if (update[i]->next[i] != n) {
-          break;
-        }
-        update[i]->next[i] = n->next[i];
-      }
-      delete n;
-      num_nodes--;
-      return true;
+    if (n == NULL || !(n->key == k)) {
+      throw std::runtime_error("Cannot rank key that's not in skip list.");
     }
-    return false;
+    return p;
   }
 
   V* find(const K &k) const {
@@ -148,6 +435,7 @@ class skip_list {
     for (int i = node_level(n->next); i-- > 0; ) {
       while (n->next[i] != NULL && n->next[i]->key < k) {
         n = n->next[i];
+        st.on_visit();
       }
     }
     n = n->next[0];
@@ -171,23 +459,555 @@ class skip_list {
       n = n->next[0];
     }
   }
+
+  const Stats& stats() const {
+    return st;
+  }
+
+  Stats& stats() {
+    return st;
+  }
+};
+
+template<class K, class V>
+class concurrent_skip_list {
+  static const int MAX_LEVELS = 32;
+  static const int RECLAIM_INTERVAL = 64;
+
+  // Each node is a single allocation, with its tower of next pointers stored
+  // inline past the end of the struct. The lowest bit of next[i] marks that the
+  // node is being erased at level i. refs counts the inserting and the erasing
+  // thread which have not yet finished unlinking the node.
+  struct node_t {
+    K key;
+    V value;
+    int levels, refs;
+    node_t *retired_next;
+    node_t *next[1];
+
+    node_t(const K &k, const V &v, int levels)
+        : key(k), value(v), levels(levels), refs(2), retired_next(NULL) {}
+  } *head;
+
+  // Epoch-based reclamation. Each operation registers in active[e & 1], where e
+  // is the epoch at which it began. Unlinked nodes are retired to the list for
+  // the epoch current at their retirement. The list for epoch e - 1 is freed
+  // once no operation is registered for it, after which the epoch advances.
+  unsigned int epoch;
+  mutable int active[2];
+  int num_nodes, num_retired, reclaiming;
+  node_t *retired[2];
+
+  static bool is_marked(node_t *p) {
+    return (reinterpret_cast<std::size_t>(p) & 1) != 0;
+  }
+
+  static node_t* marked(node_t *p) {
+    return reinterpret_cast<node_t*>(reinterpret_cast<std::size_t>(p) | 1);
+  }
+
+  static node_t* unmarked(node_t *p) {
+    return reinterpret_cast<node_t*>(reinterpret_cast<std::size_t>(p) & ~1);
+  }
+
+  static node_t* load(node_t *const &p) {
+    return __atomic_load_n(&p, __ATOMIC_ACQUIRE);
+  }
+
+  static bool cas(node_t *&p, node_t *expected, node_t *desired) {
+    return __atomic_compare_exchange_n(&p, &expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  }
+
+  static node_t* new_node(const K &k, const V &v, int levels) {
+    void *p = operator new(sizeof(node_t) + (levels - 1)*sizeof(node_t*));
+    node_t *n = new (p) node_t(k, v, levels);
+    for (int i = 0; i < levels; i++) {
+      n->next[i] = NULL;
+    }
+    return n;
+  }
+
+  static void delete_node(node_t *n) {
+    n->~node_t();
+    operator delete(n);
+  }
+
+  // Returns a level from the geometric distribution with p = 1/2, using a
+  // per-thread xorshift generator so that threads never contend on a seed.
+  static int random_level() {
+    static __thread unsigned long long state = 0;
+    if (state == 0) {
+      state = reinterpret_cast<std::size_t>(&state)*0x9e3779b97f4a7c15ULL | 1;
+    }
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return 1 + __builtin_ctzll(state | (1ULL << (MAX_LEVELS - 1)));
+  }
+
+  struct epoch_guard {
+    const concurrent_skip_list *l;
+    int slot;
+
+    epoch_guard(const concurrent_skip_list *l) : l(l) {
+      for (;;) {
+        unsigned int e = __atomic_load_n(&l->epoch, __ATOMIC_SEQ_CST);
+        slot = e & 1;
+        __atomic_add_fetch(&l->active[slot], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&l->epoch, __ATOMIC_SEQ_CST) == e) {
+          break;
+        }
+        __atomic_sub_fetch(&l->active[slot], 1, __ATOMIC_SEQ_CST);
+      }
+    }
+
+    ~epoch_guard() {
+      __atomic_sub_fetch(&l->active[slot], 1, __ATOMIC_SEQ_CST);
+    }
+  };
+
+  static void delete_list(node_t *n) {
+    while (n != NULL) {
+      node_t *next = n->retired_next;
+      delete_node(n);
+      n = next;
+    }
+  }
+
+  // Frees the nodes retired in the previous epoch if no operation from it is
+  // still running. Only one thread reclaims at a time, and others skip it.
+  void try_reclaim() {
+    if (__atomic_exchange_n(&reclaiming, 1, __ATOMIC_ACQUIRE)) {
+      return;
+    }
+    unsigned int e = __atomic_load_n(&epoch, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&active[(e - 1) & 1], __ATOMIC_SEQ_CST) == 0) {
+      node_t *n = __atomic_exchange_n(&retired[(e - 1) & 1], (node_t*)NULL,
+                                      __ATOMIC_SEQ_CST);
+      __atomic_store_n(&epoch, e + 1, __ATOMIC_SEQ_CST);
+      delete_list(n);
+    }
+    __atomic_store_n(&reclaiming, 0, __ATOMIC_RELEASE);
+  }
+
+  // Drops one reference to an unlinked node, retiring it once both the
+  // inserting and the erasing thread are done with it.
+  void release(node_t *n) {
+    if (__atomic_sub_fetch(&n->refs, 1, __ATOMIC_SEQ_CST) != 0) {
+      return;
+    }
+    node_t *&list = retired[__atomic_load_n(&epoch, __ATOMIC_SEQ_CST) & 1];
+    do {
+      n->retired_next = load(list);
+    } while (!cas(list, n->retired_next, n));
+    if (__atomic_add_fetch(&num_retired, 1, __ATOMIC_RELAXED) %
+            RECLAIM_INTERVAL == 0) {
+      try_reclaim();
+    }
+  }
+
+  // Fills preds[] and succs[] with the neighbors of key k at every level,
+  // physically unlinking any marked nodes along the way. Returns whether an
+  // unmarked node with key k was found at the bottom level. If pred is marked
+  // by an eraser while the search stands on it, the search restarts.
+  bool search(const K &k, node_t **preds, node_t **succs) {
+  retry:
+    node_t *pred = head;
+    for (int i = MAX_LEVELS; i-- > 0; ) {
+      node_t *curr = load(pred->next[i]);
+      if (is_marked(curr)) {
+        goto retry;
+      }
+      while (curr != NULL) {
+        node_t *succ = load(curr->next[i]);
+        if (is_marked(succ)) {
+          if (!cas(pred->next[i], curr, unmarked(succ))) {
+            goto retry;
+          }
+          curr = unmarked(succ);
+        } else if (curr->key < k) {
+          pred = curr;
+          curr = succ;
+        } else {
+          break;
+        }
+      }
+      preds[i] = pred;
+      succs[i] = curr;
+    }
+    return succs[0] != NULL && succs[0]->key == k;
+  }
+
+ public:
+  concurrent_skip_list()
+      : head(new_node(K(), V(), MAX_LEVELS)), epoch(0), num_nodes(0),
+        num_retired(0), reclaiming(0) {
+    active[0] = active[1] = 0;
+    retired[0] = retired[1] = NULL;
+  }
+
+  // Must not run concurrently with any other operation.
+  ~concurrent_skip_list() {
+    delete_list(retired[0]);
+    delete_list(retired[1]);
+    for (node_t *n = head, *next; n != NULL; n = next) {
+      next = unmarked(n->next[0]);
+      delete_node(n);
+    }
+  }
+
+  int size() const {
+    return __atomic_load_n(&num_nodes, __ATOMIC_RELAXED);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  bool insert(const K &k, const V &v) {
+    epoch_guard guard(this);
+    node_t *preds[MAX_LEVELS], *succs[MAX_LEVELS];
+    int levels = random_level();
+    node_t *n = NULL;
+    for (;;) {
+      if (search(k, preds, succs)) {
+        if (n != NULL) {
+          delete_node(n);
+        }
+        return false;
+      }
+      if (n == NULL) {
+        n = new_node(k, v, levels);
+      }
+      for (int i = 0; i < levels; i++) {
+        n->next[i] = succs[i];
+      }
+      if (cas(preds[0]->next[0], succs[0], n)) {
+        break;
+      }
+    }
+    __atomic_add_fetch(&num_nodes, 1, __ATOMIC_RELAXED);
+    // Link the upper levels, giving up as soon as an eraser marks the node.
+    bool linking = true;
+    for (int i = 1; linking && i < levels; i++) {
+      for (;;) {
+        node_t *succ = load(n->next[i]);
+        if (is_marked(succ)) {
+          linking = false;
+          break;
+        }
+        if (succ != succs[i] && !cas(n->next[i], succ, succs[i])) {
+          continue;
+        }
+        if (cas(preds[i]->next[i], succs[i], n)) {
+          break;
+        }
+        if (!search(k, preds, succs) || succs[0] != n) {
+          linking = false;
+          break;
+        }
+      }
+    }
+    // An eraser may have already unlinked the node before some upper level was
+    // linked above, so unlink it again before giving up our reference.
+    if (is_marked(load(n->next[0]))) {
+      search(k, preds, succs);
+    }
+    release(n);
+    return true;
+  }
+
+  bool erase(const K &k) {
+    epoch_guard guard(this);
+    node_t *preds[MAX_LEVELS], *succs[MAX_LEVELS];
+    if (!search(k, preds, succs)) {
+      return false;
+    }
+    node_t *n = succs[0];
+    for (int i = n->levels - 1; i > 0; i--) {
+      node_t *succ = load(n->next[i]);
+      while (!is_marked(succ) && !cas(n->next[i], succ, marked(succ))) {
+        succ = load(n->next[i]);
+      }
+    }
+    // The thread which marks the bottom level is the one that erased the key.
+    for (;;) {
+      node_t *succ = load(n->next[0]);
+      if (is_marked(succ)) {
+        return false;
+      }
+      if (cas(n->next[0], succ, marked(succ))) {
+        break;
+      }
+    }
+    __atomic_sub_fetch(&num_nodes, 1, __ATOMIC_RELAXED);
+    search(k, preds, succs);
+    release(n);
+    return true;
+  }
+
+  // Wait-free apart from entering the epoch: never modifies or waits on nodes,
+  // and simply steps over nodes that are marked for erasure.
+  bool find(const K &k, V *v = NULL) const {
+    epoch_guard guard(this);
+    node_t *pred = head, *curr = NULL;
+    for (int i = MAX_LEVELS; i-- > 0; ) {
+      curr = unmarked(load(pred->next[i]));
+      while (curr != NULL) {
+        node_t *succ = load(curr->next[i]);
+        if (!is_marked(succ) && !(curr->key < k)) {
+          break;
+        }
+        if (!is_marked(succ)) {
+          pred = curr;
+        }
+        curr = unmarked(succ);
+      }
+    }
+    if (curr == NULL || !(curr->key == k)) {
+      return false;
+    }
+    if (v != NULL) {
+      *v = curr->value;
+    }
+    return true;
+  }
+
+  // Visits the entries present throughout the walk in ascending order of keys.
+  template<class KVFunction>
+  void walk(KVFunction f) const {
+    epoch_guard guard(this);
+    for (node_t *n = unmarked(load(head->next[0])); n != NULL; ) {
+      node_t *next = load(n->next[0]);
+      if (!is_marked(next)) {
+        f(n->key, n->value);
+      }
+      n = unmarked(next);
+    }
+  }
 };
 
 /*** Example Usage and Output:
 
 abcde
 bcde
+skip_list: 1000000 inserts in 2.82866s
+concurrent_skip_list: 1000000 inserts in 1.70453s of CPU time
+100 sorted batches of 10000: insert() 1.51874s, insert_sorted_batch() 1.44295s
 
 ***/
 
+#include <algorithm>
 #include <cassert>
+#include <ctime>
 #include <iostream>
+#include <map>
+#include <stdexcept>
+#include <vector>
 using namespace std;
 
 void printch(int k, char v) {
   cout << v;
 }
 
+struct check_sorted {
+  int *prev, *count;
+
+  check_sorted(int *prev, int *count) : prev(prev), count(count) {}
+
+  void operator()(int k, int v) {
+    assert(*prev < k && v == -k);
+    *prev = k;
+    (*count)++;
+  }
+};
+
+void test_select_rank() {
+  skip_list<int, int> l;
+  map<int, int> ref;
+  for (int round = 0; round < 200; round++) {
+    for (int i = 0; i < 50; i++) {
+      int k = rand() % 2000;
+      if (rand() % 3 == 0) {
+        assert(l.erase(k) == (ref.erase(k) > 0));
+      } else {
+        assert(l.insert(k, -k) == ref.insert(make_pair(k, -k)).second);
+      }
+    }
+    if (round % 5 == 0) {
+      vector<pair<int, int> > batch;
+      for (int k = rand() % 50; k < 2000; k += 1 + rand() % 50) {
+        batch.push_back(make_pair(k, -k));
+      }
+      int added = 0;
+      for (int i = 0; i < (int)batch.size(); i++) {
+        added += ref.insert(batch[i]).second;
+      }
+      assert(l.insert_sorted_batch(batch.begin(), batch.end()) == added);
+    }
+    assert(l.size() == (int)ref.size());
+    int r = 0;
+    for (map<int, int>::iterator it = ref.begin(); it != ref.end(); ++it, r++) {
+      pair<int, int> entry = l.select(r);
+      assert(l.rank(it->first) == r && entry.first == it->first);
+      assert(entry.second == it->second);
+    }
+  }
+  try {
+    l.select(l.size());
+    assert(false);
+  } catch (runtime_error &) {}
+  try {
+    l.rank(-1);
+    assert(false);
+  } catch (runtime_error &) {}
+}
+
+// Inserts sorted batches of 10^4 keys, as one call each or key by key.
+void benchmark_batches(int num_batches) {
+  const int batch_size = 10000;
+  vector<vector<pair<int, int> > > batches(num_batches);
+  for (int b = 0; b < num_batches; b++) {
+    for (int i = 0; i < batch_size; i++) {
+      int k = ((rand() & 0x7fff) << 15) ^ (rand() & 0x7fff);
+      batches[b].push_back(make_pair(k, i));
+    }
+    sort(batches[b].begin(), batches[b].end());
+  }
+  skip_list<int, int> a, b;
+  clock_t start = clock();
+  for (int i = 0; i < num_batches; i++) {
+    for (int j = 0; j < batch_size; j++) {
+      a.insert(batches[i][j].first, batches[i][j].second);
+    }
+  }
+  double insert_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  for (int i = 0; i < num_batches; i++) {
+    b.insert_sorted_batch(batches[i].begin(), batches[i].end());
+  }
+  double batch_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  assert(a.size() == b.size());
+  for (int i = 0; i < a.size(); i += 997) {
+    assert(a.select(i) == b.select(i));
+  }
+  cout << num_batches << " sorted batches of " << batch_size << ": insert() "
+       << insert_time << "s, insert_sorted_batch() " << batch_time << "s"
+       << endl;
+}
+
+void test_concurrent_skip_list() {
+  concurrent_skip_list<int, int> l;
+  map<int, int> ref;
+  for (int i = 0; i < 100000; i++) {
+    int k = rand() % 1000, v;
+    if (rand() % 2 == 0) {
+      assert(l.insert(k, -k) == ref.insert(make_pair(k, -k)).second);
+    } else if (rand() % 2 == 0) {
+      assert(l.erase(k) == (ref.erase(k) > 0));
+    } else {
+      assert(l.find(k, &v) == (ref.count(k) > 0));
+    }
+    assert(l.size() == (int)ref.size());
+  }
+
+  // Every key is inserted twice in parallel, but only one insertion succeeds.
+  const int n = 200000;
+  concurrent_skip_list<int, int> c;
+  int inserted = 0;
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 64) reduction(+:inserted)
+#endif
+  for (int i = 0; i < 2*n; i++) {
+    inserted += c.insert(i % n, -(i % n));
+  }
+  assert(inserted == n && c.size() == n);
+  // Erase the even keys while inserting new ones and reading the odd ones.
+  int erased = 0;
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 64) reduction(+:erased)
+#endif
+  for (int i = 0; i < 3*n; i++) {
+    int k = i / 3, v;
+    if (i % 3 == 0) {
+      erased += (k % 2 == 0) && c.erase(k);
+    } else if (i % 3 == 1) {
+      assert(c.insert(n + k, -(n + k)));
+    } else if (k % 2 == 1) {
+      assert(c.find(k, &v) && v == -k);
+    }
+  }
+  assert(erased == n/2 && c.size() == 3*n/2);
+  int prev = -1, count = 0;
+  c.walk(check_sorted(&prev, &count));
+  assert(count == 3*n/2);
+  for (int k = 0; k < 2*n; k++) {
+    assert(c.find(k) == (k >= n || k % 2 == 1));
+  }
+}
+
+// Eight threads insert, erase, and find random keys out of only 64, so that
+// most operations contend on the same nodes. Each thread counts its successful
+// insertions and erasures per key, which must net to the final contents.
+void stress_concurrent_skip_list() {
+  const int num_threads = 8, num_keys = 64, num_ops = 200000;
+  concurrent_skip_list<int, int> c;
+  vector<int> net(num_keys, 0);
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+#endif
+  for (int t = 0; t < num_threads; t++) {
+    unsigned int seed = 2654435761u*(t + 1);
+    for (int i = 0; i < num_ops; i++) {
+      seed = seed*1103515245u + 12345u;
+      int k = (seed >> 16) % num_keys, v, op = (seed >> 8) % 3;
+      if (op == 0) {
+        if (c.insert(k, -k)) {
+          __atomic_add_fetch(&net[k], 1, __ATOMIC_RELAXED);
+        }
+      } else if (op == 1) {
+        if (c.erase(k)) {
+          __atomic_sub_fetch(&net[k], 1, __ATOMIC_RELAXED);
+        }
+      } else if (c.find(k, &v)) {
+        assert(v == -k);
+      }
+    }
+  }
+  int prev = -1, count = 0;
+  c.walk(check_sorted(&prev, &count));
+  assert(count == c.size());
+  for (int k = 0; k < num_keys; k++) {
+    assert(net[k] == 0 || net[k] == 1);
+    assert(c.find(k) == (net[k] == 1));
+    count -= net[k];
+  }
+  assert(count == 0);
+}
+
+void benchmark() {
+  const int n = 1000000;
+  clock_t start = clock();
+  skip_list<int, int> l;
+  for (int i = 0; i < n; i++) {
+    l.insert((int)(i*7919LL % n), i);
+  }
+  cout << "skip_list: " << n << " inserts in "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s" << endl;
+  start = clock();
+  concurrent_skip_list<int, int> c;
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 1024)
+#endif
+  for (int i = 0; i < n; i++) {
+    c.insert((int)(i*7919LL % n), i);
+  }
+  cout << "concurrent_skip_list: " << n << " inserts in "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s of CPU time" << endl;
+  assert(l.size() == n && c.size() == n);
+}
+
 int main() {
   skip_list<int, char> l;
   l.insert(2, 'b');
@@ -204,5 +1024,30 @@ int main() {
   assert(l.find(1) == NULL);
   l.walk(printch);
   cout << endl;
+
+  // Allocation policies and operation statistics.
+  skip_list<int, int, arena_allocator, counting_stats> profiled;
+  skip_list<int, int, new_allocator> separate;
+  for (int i = 0; i < 1000; i++) {
+    assert(profiled.insert(i, i) && separate.insert(i, -i));
+  }
+  // The head is a node as well.
+  assert(profiled.stats().allocations == 1001);
+  assert(profiled.stats().rotations == 0);
+  profiled.stats().reset();
+  for (int i = 0; i < 1000; i++) {
+    assert(*profiled.find(i) == i);
+  }
+  // Each search steps onto about 2 log2(n) nodes on average.
+  assert(profiled.stats().visits > 0 && profiled.stats().visits < 1000*100);
+  for (int i = 0; i < 1000; i += 2) {
+    assert(separate.erase(i));
+  }
+  assert(separate.size() == 500 && separate.rank(999) == 499);
+  test_select_rank();
+  test_concurrent_skip_list();
+  stress_concurrent_skip_list();
+  benchmark();
+  benchmark_batches(100);
   return 0;
 }
@@ -1,61 +1,344 @@
 /*
 
 Given a static array with indices from 0 to n - 1, precompute a table that may
-later be used perform range minimum queries on the array in constant time. This
-version is simplified to only work on integer arrays.
+later be used perform range queries on the array in constant time.
 
-The dynamic programming state dp[i][j] holds the index of the minimum value in
-the sub-array starting at i and having length 2^j. Each dp[i][j] will always be
-equal to either dp[i][j - 1] or dp[i + 2^(j - 1) - 1)][j - 1], whichever of the
-indices corresponds to the smaller value in the array.
+The query operation is defined by a function object op(a, b) which must be
+associative, that is, op(x, op(y, z)) = op(op(x, y), z) for all values x, y, and
+z in the array. The default operation below returns the "min" of two values.
+
+- sparse_table(lo, hi, op) constructs a table from two random-access iterators
+  as a range [lo, hi), for an operation op that must also be idempotent, that
+  is, op(x, x) = x for every value x in the array (as for "min", "max", "gcd",
+  and bitwise "and" or "or"). The table[j][i] holds the result of applying op to
+  the sub-array starting at i with length 2^j. Each table[j][i] is computed from
+  table[j - 1][i] and table[j - 1][i + 2^(j - 1)], with each level stored in its
+  own contiguous array. Any range is covered by two overlapping ranges of the
+  same power-of-two length, which the idempotence of op tolerates.
+- disjoint_sparse_table(lo, hi, op) constructs a table supporting the same
+  queries for any associative operation, such as "sum" or "product modulo p".
+  At level j, the array is split into blocks of length 2^(j + 1), and for every
+  index i, table[j][i] holds the result of op over the range from i to the
+  middle of its block. Any range [lo, hi] with lo != hi straddles the middle of
+  exactly one such block at the level given by the highest bit of lo ^ hi, and
+  is answered by joining just two precomputed values.
+- linear_rmq(lo, hi, comp) constructs a range minimum query structure using only
+  linear memory, given a strict weak ordering comp (which defaults to <). The
+  array is split into blocks of 64 elements, with a sparse table built over the
+  indices of the minimum of each block. Within every block, index i stores a
+  64-bit mask of the positions in its block up to i which are the minimum of the
+  range from themselves to i. The minimum of the range from any position p to i
+  within a block is thus at the lowest bit of the mask at or above p.
+- size() returns the size of the array.
+- at(i) returns the value at index i.
+- query(lo, hi) returns the result of op applied to all indices from lo to hi,
+  inclusive. For linear_rmq, query() returns the minimum value and
+  query_index(lo, hi) returns the index of its leftmost occurrence.
 
 Time Complexity:
-- O(n log n) per call to build(), where n is the size of the array.
-- O(1) per call to query_min().
+- O(n log n) per call to the sparse_table and disjoint_sparse_table
+  constructors, where n is the size of the array.
+- O(n) per call to the linear_rmq constructor.
+- O(1) per call to size(), at(), query(), and query_index().
 
 Space Complexity:
-- O(n log n) for storage of the sparse table, where n is the size of the array.
-- O(1) auxiliary for query().
+- O(n log n) for storage of sparse_table and disjoint_sparse_table.
+- O(n) for storage of linear_rmq.
+- O(1) auxiliary for all operations.
 
 */
 
+#include <functional>
 #include <vector>
 
-const int MAXN = 1000;
-std::vector<int> table, dp[MAXN];
+template<class T>
+struct min_op {
+  T operator()(const T &a, const T &b) const {
+    return (b < a) ? b : a;
+  }
+};
 
-void build(int n, int a[]) {
-  table.resize(n + 1);
-  for (int i = 2; i <= n; i++) {
-    table[i] = table[i >> 1] + 1;
+template<class T>
+struct max_op {
+  T operator()(const T &a, const T &b) const {
+    return (a < b) ? b : a;
   }
-  for (int i = 0; i < n; i++) {
-    dp[i].resize(table[n] + 1);
-    dp[i][0] = i;
+};
+
+inline int floor_log2(unsigned int x) {
+  return 31 - __builtin_clz(x);
+}
+
+template<class T, class Op = min_op<T> >
+class sparse_table {
+  Op op;
+  std::vector<std::vector<T> > table;
+
+ public:
+  template<class It>
+  sparse_table(It lo, It hi, const Op &op = Op()) : op(op), table(1) {
+    int n = hi - lo;
+    table[0].assign(lo, hi);
+    for (int j = 1; (1 << j) <= n; j++) {
+      table.push_back(std::vector<T>(n - (1 << j) + 1));
+      const std::vector<T> &prev = table[j - 1];
+      int half = 1 << (j - 1);
+      for (int i = 0; i + (1 << j) <= n; i++) {
+        table[j][i] = op(prev[i], prev[i + half]);
+      }
+    }
   }
-  for (int j = 1; (1 << j) < n; j++) {
-    for (int i = 0; i + (1 << j) <= n; i++) {
-      int x = dp[i][j - 1];
-      int y = dp[i + (1 << (j - 1))][j - 1];
-      dp[i][j] = (a[x] < a[y]) ? x : y;
+
+  int size() const {
+    return table[0].size();
+  }
+
+  T at(int i) const {
+    return table[0][i];
+  }
+
+  T query(int lo, int hi) const {
+    int j = floor_log2(hi - lo + 1);
+    return op(table[j][lo], table[j][hi - (1 << j) + 1]);
+  }
+};
+
+template<class T, class Op = std::plus<T> >
+class disjoint_sparse_table {
+  Op op;
+  std::vector<std::vector<T> > table;
+
+ public:
+  template<class It>
+  disjoint_sparse_table(It lo, It hi, const Op &op = Op()) : op(op), table(1) {
+    int n = hi - lo;
+    table[0].assign(lo, hi);
+    // Indices past the middle of the last block are never queried at a level.
+    for (int j = 0; (1 << j) < n; j++) {
+      table.push_back(std::vector<T>(n));
+      const std::vector<T> &a = table[0];
+      std::vector<T> &level = table.back();
+      int half = 1 << j;
+      for (int mid = half; mid < n; mid += 2*half) {
+        level[mid - 1] = a[mid - 1];
+        for (int i = mid - 2; i >= mid - half; i--) {
+          level[i] = op(a[i], level[i + 1]);
+        }
+        level[mid] = a[mid];
+        for (int i = mid + 1; i < mid + half && i < n; i++) {
+          level[i] = op(level[i - 1], a[i]);
+        }
+      }
     }
   }
-}
 
-int query(int a[], int lo, int hi) {
-  int j = table[hi - lo];
-  int x = dp[lo][j];
-  int y = dp[hi - (1 << j) + 1][j];
-  return (a[x] < a[y]) ? a[x] : a[y];
-}
+  int size() const {
+    return table[0].size();
+  }
+
+  T at(int i) const {
+    return table[0][i];
+  }
+
+  T query(int lo, int hi) const {
+    if (lo == hi) {
+      return table[0][lo];
+    }
+    int j = floor_log2(lo ^ hi) + 1;
+    return op(table[j][lo], table[j][hi]);
+  }
+};
+
+template<class T, class Compare = std::less<T> >
+class linear_rmq {
+  static const int BLOCK_SIZE = 64;
+
+  Compare comp;
+  std::vector<T> value;
+  std::vector<unsigned long long> mask;
+  std::vector<std::vector<int> > table;
+
+  int min_index(int i, int j) const {
+    return comp(value[j], value[i]) ? j : i;
+  }
+
+  // Returns the index of the minimum from lo to hi within a single block.
+  int in_block(int lo, int hi) const {
+    unsigned long long m = mask[hi] >> (lo % BLOCK_SIZE);
+    return lo + __builtin_ctzll(m);
+  }
+
+ public:
+  template<class It>
+  linear_rmq(It lo, It hi, const Compare &comp = Compare())
+      : comp(comp), value(lo, hi), mask(value.size()), table(1) {
+    int n = value.size();
+    int num_blocks = (n + BLOCK_SIZE - 1)/BLOCK_SIZE;
+    // Maintain a stack of the in-block positions whose values are strictly
+    // less than everything after them, as a bitmask.
+    for (int b = 0; b < num_blocks; b++) {
+      unsigned long long m = 0;
+      int start = b*BLOCK_SIZE;
+      for (int i = start; i < n && i < start + BLOCK_SIZE; i++) {
+        while (m != 0) {
+          int top = start + 63 - __builtin_clzll(m);
+          if (comp(value[i], value[top])) {
+            m ^= 1ULL << (top - start);
+          } else {
+            break;
+          }
+        }
+        m |= 1ULL << (i - start);
+        mask[i] = m;
+      }
+    }
+    table[0].resize(num_blocks);
+    for (int b = 0; b < num_blocks; b++) {
+      int end = (b + 1)*BLOCK_SIZE < n ? (b + 1)*BLOCK_SIZE : n;
+      table[0][b] = in_block(b*BLOCK_SIZE, end - 1);
+    }
+    for (int j = 1; (1 << j) <= num_blocks; j++) {
+      table.push_back(std::vector<int>(num_blocks - (1 << j) + 1));
+      for (int i = 0; i + (1 << j) <= num_blocks; i++) {
+        table[j][i] = min_index(table[j - 1][i],
+                                table[j - 1][i + (1 << (j - 1))]);
+      }
+    }
+  }
 
-/*** Example Usage ***/
+  int size() const {
+    return value.size();
+  }
+
+  T at(int i) const {
+    return value[i];
+  }
+
+  int query_index(int lo, int hi) const {
+    int lb = lo/BLOCK_SIZE, hb = hi/BLOCK_SIZE;
+    if (lb == hb) {
+      return in_block(lo, hi);
+    }
+    // Ties keep the left argument of min_index(), so the joins below must go
+    // from left to right to find the leftmost minimum.
+    int res = in_block(lo, lb*BLOCK_SIZE + BLOCK_SIZE - 1);
+    if (lb + 1 < hb) {
+      int j = floor_log2(hb - lb - 1);
+      res = min_index(res, min_index(table[j][lb + 1],
+                                     table[j][hb - (1 << j)]));
+    }
+    return min_index(res, in_block(hb*BLOCK_SIZE, hi));
+  }
 
+  T query(int lo, int hi) const {
+    return value[query_index(lo, hi)];
+  }
+};
+
+/*** Example Usage and Output:
+
+sparse_table: build 0.571723s, 4194304 queries 0.129245s (sum 63198827592)
+linear_rmq: build 0.074068s, 4194304 queries 0.360402s (sum 63198827592)
+
+***/
+
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+using namespace std;
+
+struct mul_mod {
+  long long operator()(long long a, long long b) const {
+    return a*b % 1000000007;
+  }
+};
+
+template<class Table, class Op>
+void check_all_ranges(const vector<long long> &a, const Table &t, Op op) {
+  assert(t.size() == (int)a.size());
+  for (int lo = 0; lo < (int)a.size(); lo++) {
+    long long res = a[lo];
+    assert(t.at(lo) == a[lo] && t.query(lo, lo) == a[lo]);
+    for (int hi = lo + 1; hi < (int)a.size(); hi++) {
+      res = op(res, a[hi]);
+      assert(t.query(lo, hi) == res);
+    }
+  }
+}
+
+void test_rmq_index(const vector<long long> &a) {
+  linear_rmq<long long> t(a.begin(), a.end());
+  for (int lo = 0; lo < (int)a.size(); lo++) {
+    int best = lo;
+    for (int hi = lo; hi < (int)a.size(); hi++) {
+      if (a[hi] < a[best]) {
+        best = hi;
+      }
+      assert(t.query_index(lo, hi) == best);
+    }
+  }
+}
+
+template<class Table>
+void benchmark(const char *name, const vector<int> &a,
+               const vector<pair<int, int> > &queries) {
+  clock_t start = clock();
+  Table t(a.begin(), a.end());
+  double build_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  long long sum = 0;
+  for (int i = 0; i < (int)queries.size(); i++) {
+    sum += t.query(queries[i].first, queries[i].second);
+  }
+  double query_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  cout << name << ": build " << build_time << "s, " << queries.size()
+       << " queries " << query_time << "s (sum " << sum << ")" << endl;
+}
 
 int main() {
-  int arr[5] = {6, -2, 1, 8, 10};
-  build(5, arr);
-  assert(query(arr, 0, 3) == -2);
+  {
+    int arr[5] = {6, -2, 1, 8, 10};
+    sparse_table<int> t(arr, arr + 5);
+    assert(t.query(0, 3) == -2);
+    sparse_table<int, max_op<int> > t2(arr, arr + 5);
+    assert(t2.query(0, 3) == 8);
+    disjoint_sparse_table<int> t3(arr, arr + 5);
+    assert(t3.query(1, 3) == 7);
+    linear_rmq<int> t4(arr, arr + 5);
+    assert(t4.query(2, 4) == 1 && t4.query_index(0, 4) == 1);
+  }
+  for (int n = 1; n <= 300; n += (n < 140) ? 1 : 37) {
+    vector<long long> a(n);
+    for (int i = 0; i < n; i++) {
+      a[i] = rand() % ((n % 3 == 0) ? 5 : 1000000);
+    }
+    check_all_ranges(a, sparse_table<long long>(a.begin(), a.end()),
+                     min_op<long long>());
+    check_all_ranges(a, sparse_table<long long, max_op<long long> >(
+                            a.begin(), a.end()),
+                     max_op<long long>());
+    check_all_ranges(a, disjoint_sparse_table<long long>(a.begin(), a.end()),
+                     plus<long long>());
+    check_all_ranges(a, disjoint_sparse_table<long long, mul_mod>(
+                            a.begin(), a.end()),
+                     mul_mod());
+    check_all_ranges(a, linear_rmq<long long>(a.begin(), a.end()),
+                     min_op<long long>());
+    test_rmq_index(a);
+  }
+
+  int n = 1 << 22;
+  vector<int> a(n);
+  vector<pair<int, int> > queries(n);
+  for (int i = 0; i < n; i++) {
+    a[i] = rand();
+    int lo = ((rand() & 0x7fff) << 15 ^ (rand() & 0x7fff)) % n;
+    int hi = ((rand() & 0x7fff) << 15 ^ (rand() & 0x7fff)) % n;
+    queries[i] = make_pair(min(lo, hi), max(lo, hi));
+  }
+  benchmark<sparse_table<int> >("sparse_table", a, queries);
+  benchmark<linear_rmq<int> >("linear_rmq", a, queries);
   return 0;
 }
@@ -19,19 +19,44 @@ should be defined to return "v + d".
 The operations supported by this data structure are identical to those of the
 point update segment tree found in this section.
 
+- sqrt_decomposition<T>::block_length(n) returns the block length used for an
+  array of size n.
+- mo_process(n, queries, mo, answers, hilbert) answers a batch of offline range
+  queries on an array of size n using Mo's algorithm. Each query is a pair of
+  indices (lo, hi) specifying an inclusive range. The object mo must define
+  add(i) and remove(i) to include or exclude index i from the current range, as
+  well as answer() to return the answer for the current range, which is stored
+  in answers[j] for the j-th query. Queries are processed in an order which
+  keeps the total movement of the range endpoints small: that of a Hilbert curve
+  over the (lo, hi) plane if hilbert is true (the default), which tends to be
+  faster due to better locality, or otherwise sorted by the block of lo with
+  the same block length as above, then by hi.
+- mo_process_with_updates(n, queries, times, mo, answers) additionally supports
+  updates to the array. The j-th query is answered after exactly the first
+  times[j] updates have been applied, and mo must further define apply(t, lo,
+  hi) and undo(t, lo, hi) to perform and revert the t-th update while the
+  current range is [lo, hi]. Queries are sorted by the blocks of lo and hi, for
+  a block length of n^(2/3), and then by time.
+
 Time Complexity:
 - O(n) per call to both constructors, where n is the size of the array.
 - O(1) per call to size().
 - O(sqrt n) per call to at(), update(), and query().
+- O((n + q) sqrt n) calls to add() and remove() per call to mo_process(), where
+  q is the number of queries.
+- O(n^(5/3) + q n^(2/3)) calls to the callbacks per call to
+  mo_process_with_updates(), given O(q) updates.
 
 Space Complexity:
 - O(n) for storage of the array elements.
-- O(1) auxiliary for all operations.
+- O(q) auxiliary heap space for mo_process() and mo_process_with_updates().
+- O(1) auxiliary for all other operations.
 
 */
 
 #include <algorithm>
 #include <cmath>
+#include <utility>
 #include <vector>
 
 template<class T>
@@ -48,7 +73,7 @@ class sqrt_decomposition {
   std::vector<T> value, block;
 
   void init() {
-    blocklen = (int)sqrt(len);
+    blocklen = block_length(len);
     int nblocks = (len + blocklen - 1)/blocklen;
     for (int i = 0; i < nblocks; i++) {
       T blockval = value[i*blocklen];
@@ -61,6 +86,10 @@ class sqrt_decomposition {
   }
 
  public:
+  static int block_length(int n) {
+    return std::max(1, (int)sqrt(n));
+  }
+
   sqrt_decomposition(int n, const T &v = T()) : len(n), value(n, v) {
     init();
   }
@@ -112,16 +141,260 @@ class sqrt_decomposition {
   }
 };
 
+// Returns the position of (x, y) along a Hilbert curve filling the grid of
+// 2^bits by 2^bits cells. Consecutive positions along the curve are adjacent
+// cells, so sorting queries by it keeps consecutive queries close together.
+inline long long hilbert_order(int x, int y, int bits) {
+  long long res = 0;
+  for (int s = 1 << (bits - 1); s > 0; s >>= 1) {
+    int rx = (x & s) > 0, ry = (y & s) > 0;
+    res += (long long)s*s*((3*rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s - 1 - x;
+        y = s - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return res;
+}
+
+template<class Key>
+struct mo_order {
+  const std::vector<Key> *key;
+
+  mo_order(const std::vector<Key> *key) : key(key) {}
+
+  bool operator()(int a, int b) const {
+    return (*key)[a] < (*key)[b];
+  }
+};
+
+// Moves the current range [*cl, *cr] to [lo, hi], growing it before shrinking
+// it so that the range is never empty with *cl > *cr + 1.
+template<class Mo>
+void mo_move(int lo, int hi, int *cl, int *cr, Mo &mo) {
+  while (*cl > lo) {
+    mo.add(--*cl);
+  }
+  while (*cr < hi) {
+    mo.add(++*cr);
+  }
+  while (*cl < lo) {
+    mo.remove((*cl)++);
+  }
+  while (*cr > hi) {
+    mo.remove((*cr)--);
+  }
+}
+
+template<class Mo, class Answer>
+void mo_process(int n, const std::vector<std::pair<int, int> > &queries,
+                Mo &mo, std::vector<Answer> &answers, bool hilbert = true) {
+  int q = queries.size(), bits = 1, blocklen = 0;
+  while ((1 << bits) < n) {
+    bits++;
+  }
+  if (!hilbert) {
+    blocklen = sqrt_decomposition<int>::block_length(n);
+  }
+  std::vector<long long> key(q);
+  std::vector<int> order(q);
+  for (int i = 0; i < q; i++) {
+    int lo = queries[i].first, hi = queries[i].second;
+    if (hilbert) {
+      key[i] = hilbert_order(lo, hi, bits);
+    } else {
+      // Alternate the direction of hi in every other block of lo.
+      int b = lo/blocklen;
+      key[i] = (long long)b*(n + 1) + ((b % 2 == 0) ? hi : n - hi);
+    }
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), mo_order<long long>(&key));
+  answers.resize(q);
+  int cl = 0, cr = -1;
+  for (int i = 0; i < q; i++) {
+    int j = order[i];
+    mo_move(queries[j].first, queries[j].second, &cl, &cr, mo);
+    answers[j] = mo.answer();
+  }
+}
+
+template<class Mo, class Answer>
+void mo_process_with_updates(int n,
+                             const std::vector<std::pair<int, int> > &queries,
+                             const std::vector<int> &times, Mo &mo,
+                             std::vector<Answer> &answers) {
+  int q = queries.size();
+  int blocklen = std::max(1, (int)pow((double)n, 2.0/3));
+  std::vector<std::pair<std::pair<int, int>, int> > key(q);
+  std::vector<int> order(q);
+  for (int i = 0; i < q; i++) {
+    key[i] = std::make_pair(std::make_pair(queries[i].first/blocklen,
+                                           queries[i].second/blocklen),
+                            times[i]);
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(),
+            mo_order<std::pair<std::pair<int, int>, int> >(&key));
+  answers.resize(q);
+  int cl = 0, cr = -1, t = 0;
+  for (int i = 0; i < q; i++) {
+    int j = order[i];
+    mo_move(queries[j].first, queries[j].second, &cl, &cr, mo);
+    while (t < times[j]) {
+      mo.apply(t++, cl, cr);
+    }
+    while (t > times[j]) {
+      mo.undo(--t, cl, cr);
+    }
+    answers[j] = mo.answer();
+  }
+}
+
 /*** Example Usage and Output:
 
 Values: 6 -2 4 8 10
+500000 distinct count queries on 500000 values:
+  brute force ~134.39s
+  block order 1.04795s
+  Hilbert order 1.12046s
 
 ***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
 using namespace std;
 
+// Counts the distinct values in the current range, where every value is less
+// than the size of the array. Updates assign a value to an index.
+struct distinct_counter {
+  vector<int> a, count, pos, val;
+  int distinct;
+
+  distinct_counter(const vector<int> &a)
+      : a(a), count(a.size() + 1), distinct(0) {}
+
+  void add(int i) {
+    distinct += (count[a[i]]++ == 0);
+  }
+
+  void remove(int i) {
+    distinct -= (--count[a[i]] == 0);
+  }
+
+  int answer() const {
+    return distinct;
+  }
+
+  // Swaps the value at pos[t] with val[t], so that undoing reapplies the swap.
+  void apply(int t, int lo, int hi) {
+    bool inside = (lo <= pos[t] && pos[t] <= hi);
+    if (inside) {
+      remove(pos[t]);
+    }
+    swap(a[pos[t]], val[t]);
+    if (inside) {
+      add(pos[t]);
+    }
+  }
+
+  void undo(int t, int lo, int hi) {
+    apply(t, lo, hi);
+  }
+};
+
+int brute_distinct(const vector<int> &a, int lo, int hi) {
+  vector<bool> seen(a.size() + 1);
+  int res = 0;
+  for (int i = lo; i <= hi; i++) {
+    res += !seen[a[i]];
+    seen[a[i]] = true;
+  }
+  return res;
+}
+
+void random_queries(int n, int q, vector<pair<int, int> > &queries) {
+  queries.resize(q);
+  for (int i = 0; i < q; i++) {
+    int lo = rand() % n, hi = rand() % n;
+    queries[i] = make_pair(min(lo, hi), max(lo, hi));
+  }
+}
+
+void test_mo() {
+  for (int n = 1; n <= 200; n += 13) {
+    vector<int> a(n);
+    for (int i = 0; i < n; i++) {
+      a[i] = rand() % (n/4 + 1);
+    }
+    vector<pair<int, int> > queries;
+    random_queries(n, 300, queries);
+    for (int hilbert = 0; hilbert < 2; hilbert++) {
+      distinct_counter mo(a);
+      vector<int> answers;
+      mo_process(n, queries, mo, answers, hilbert == 1);
+      for (int i = 0; i < (int)queries.size(); i++) {
+        assert(answers[i] ==
+               brute_distinct(a, queries[i].first, queries[i].second));
+      }
+    }
+    // Interleave 100 updates with the queries, replaying them to check.
+    distinct_counter mo(a);
+    vector<int> times(queries.size());
+    for (int t = 0; t < 100; t++) {
+      mo.pos.push_back(rand() % n);
+      mo.val.push_back(rand() % (n/4 + 1));
+    }
+    for (int i = 0; i < (int)queries.size(); i++) {
+      times[i] = rand() % 101;
+    }
+    // The values of applied updates are swapped out, so replay from a copy.
+    vector<int> pos(mo.pos), val(mo.val), answers;
+    mo_process_with_updates(n, queries, times, mo, answers);
+    for (int i = 0; i < (int)queries.size(); i++) {
+      vector<int> b(a);
+      for (int t = 0; t < times[i]; t++) {
+        b[pos[t]] = val[t];
+      }
+      assert(answers[i] ==
+             brute_distinct(b, queries[i].first, queries[i].second));
+    }
+  }
+}
+
+void benchmark_mo(int n, int q) {
+  vector<int> a(n);
+  for (int i = 0; i < n; i++) {
+    a[i] = rand() % n;
+  }
+  vector<pair<int, int> > queries;
+  random_queries(n, q, queries);
+  vector<int> block_answers, hilbert_answers;
+  distinct_counter mo1(a), mo2(a);
+  clock_t start = clock();
+  mo_process(n, queries, mo1, block_answers, false);
+  double block_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  mo_process(n, queries, mo2, hilbert_answers, true);
+  double hilbert_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  assert(block_answers == hilbert_answers);
+  start = clock();
+  long long sum = 0;
+  for (int i = 0; i < 100; i++) {
+    sum += brute_distinct(a, queries[i].first, queries[i].second);
+  }
+  double brute_time = (double)(clock() - start)/CLOCKS_PER_SEC*q/100;
+  cout << q << " distinct count queries on " << n << " values:" << endl
+       << "  brute force ~" << brute_time << "s" << endl
+       << "  block order " << block_time << "s" << endl
+       << "  Hilbert order " << hilbert_time << "s" << endl;
+}
+
 int main() {
   int arr[5] = {6, -2, 1, 8, 10};
   sqrt_decomposition<int> sd(arr, arr + 5);
@@ -132,5 +405,7 @@ int main() {
   }
   cout << endl;
   assert(sd.query(0, 3) == -2);
+  test_mo();
+  benchmark_mo(500000, 500000);
   return 0;
 }
@@ -27,19 +27,49 @@ should be defined to return "v + d".
   specified value is returned.
 - update(i, d) assigns the value v at index i to join_value_with_delta(v, d).
 
+bottom_up_segment_tree supports the same operations with the same customization
+points, storing only 2n values. The leaves occupy indices n to 2n - 1, and each
+internal node i < n holds the join of nodes 2i and 2i + 1. Updates walk from a
+leaf up to the root and queries walk from the two ends of the range upwards,
+both in simple loops. Queries keep separate results for the left and right ends
+of the range, so join_values() is still only required to be associative.
+
+wide_segment_tree<T, Op, B> supports the same operations with a branching
+factor of B, which defaults to the number of values in a 64-byte cache line (16
+for 32-bit integers). The operation is given by a function object op(a, b) with
+an identity value op.identity(), such as sum_op or min_op below, and update(i,
+v) sets the value at index i to v. Each level of the tree is a contiguous array
+padded with identity values to a multiple of B and aligned to B values, so that
+the B children of every node occupy a single cache line. Node j of a level
+holds the join of block j of the level below. A query touches at most two
+blocks per level, each reduced by a fixed-length loop over all B values with
+out of range values masked to the identity, which the compiler may vectorize.
+This is at most 2*ceil(log_B n) cache lines, or about 2*log_16(n) for 32-bit
+integers. Prefix queries query(0, hi) are no cheaper, since the range begins at
+index 1 rather than 0 on every level above the first, so they also touch two
+blocks per level. A copy of the tree keeps the layout of the original, so its
+blocks are only aligned if its own storage happens to be.
+
 Time Complexity:
-- O(n) per call to both constructors, where n is the size of the array.
-- O(1) per call to size().
-- O(log n) per call to at(), update(), and query().
+- O(n) per call to the constructors, where n is the size of the array.
+- O(1) per call to size(), as well as at() for bottom_up_segment_tree and
+  wide_segment_tree.
+- O(log n) per call to update() and query(), as well as at() for segment_tree.
+- O(B log_B n) per call to update() and query() for wide_segment_tree, with
+  O(log_B n) cache lines accessed.
 
 Space Complexity:
-- O(n) for storage of the array elements.
-- O(log n) auxiliary stack space for update() and query().
-- O(1) auxiliary for size().
+- O(n) for storage of the array elements, with 4n values allocated for
+  segment_tree, 2n for bottom_up_segment_tree, and about n*B/(B - 1) for
+  wide_segment_tree.
+- O(log n) auxiliary stack space for update() and query() of segment_tree.
+- O(1) auxiliary for all other operations.
 
 */
 
 #include <algorithm>
+#include <cstddef>
+#include <limits>
 #include <vector>
 
 template<class T>
@@ -110,7 +140,7 @@ class segment_tree {
 
  public:
   segment_tree(int n, const T &v = T()) : len(n), value(4*len) {
-    build(0, 0, len - 1, false, 0, v);
+    build(0, 0, len - 1, v);
   }
 
   template<class It>
@@ -135,17 +165,295 @@ class segment_tree {
   }
 };
 
+template<class T>
+class bottom_up_segment_tree {
+  static T join_values(const T &a, const T &b) {
+    return std::min(a, b);
+  }
+
+  static T join_value_with_delta(const T &v, const T &d) {
+    return d;
+  }
+
+  int len;
+  std::vector<T> value;
+
+  void build() {
+    for (int i = len - 1; i > 0; i--) {
+      value[i] = join_values(value[i*2], value[i*2 + 1]);
+    }
+  }
+
+ public:
+  bottom_up_segment_tree(int n, const T &v = T()) : len(n), value(2*len, v) {
+    build();
+  }
+
+  template<class It>
+  bottom_up_segment_tree(It lo, It hi) : len(hi - lo), value(2*len) {
+    std::copy(lo, hi, value.begin() + len);
+    build();
+  }
+
+  int size() const {
+    return len;
+  }
+
+  T at(int i) const {
+    return value[len + i];
+  }
+
+  T query(int lo, int hi) const {
+    int l = lo + len, r = hi + len + 1;
+    bool has_left = false, has_right = false;
+    T left = T(), right = T();
+    for (; l < r; l /= 2, r /= 2) {
+      if (l % 2 == 1) {
+        left = has_left ? join_values(left, value[l]) : value[l];
+        has_left = true;
+        l++;
+      }
+      if (r % 2 == 1) {
+        r--;
+        right = has_right ? join_values(value[r], right) : value[r];
+        has_right = true;
+      }
+    }
+    if (!has_right) {
+      return left;
+    }
+    return has_left ? join_values(left, right) : right;
+  }
+
+  void update(int i, const T &d) {
+    i += len;
+    value[i] = join_value_with_delta(value[i], d);
+    for (i /= 2; i > 0; i /= 2) {
+      value[i] = join_values(value[i*2], value[i*2 + 1]);
+    }
+  }
+};
+
+template<class T>
+struct sum_op {
+  T operator()(const T &a, const T &b) const {
+    return a + b;
+  }
+
+  T identity() const {
+    return 0;
+  }
+};
+
+template<class T>
+struct min_op {
+  T operator()(const T &a, const T &b) const {
+    return (b < a) ? b : a;
+  }
+
+  T identity() const {
+    return std::numeric_limits<T>::max();
+  }
+};
+
+template<class T, class Op = sum_op<T>, int B = 64/sizeof(T)>
+class wide_segment_tree {
+  int len;
+  Op op;
+  T id;
+  std::vector<T> data;
+  // Level k starts at data[offset[k]]. Offsets rather than pointers are kept
+  // so that copies of the tree refer to their own data.
+  std::vector<int> offset, level_size;
+
+  T *level(int k) {
+    return &data[offset[k]];
+  }
+
+  const T *level(int k) const {
+    return &data[offset[k]];
+  }
+
+  // Joins the values at indices from to to - 1 within the block at a.
+  T reduce(const T *a, int from, int to) const {
+    T res = id;
+    for (int j = 0; j < B; j++) {
+      res = op(res, (from <= j && j < to) ? a[j] : id);
+    }
+    return res;
+  }
+
+  void init() {
+    int total = 0;
+    for (int n = len; ; n = (n + B - 1)/B) {
+      int padded = (n + B - 1)/B*B;
+      level_size.push_back(padded);
+      total += padded;
+      if (n <= B) {
+        break;
+      }
+    }
+    data.assign(total + B, id);
+    int i = (B - (size_t)&data[0]/sizeof(T) % B) % B;
+    for (int k = 0; k < (int)level_size.size(); k++) {
+      offset.push_back(i);
+      i += level_size[k];
+    }
+  }
+
+  void build() {
+    for (int k = 1; k < (int)level_size.size(); k++) {
+      for (int j = 0; j < level_size[k - 1]/B; j++) {
+        level(k)[j] = reduce(level(k - 1) + j*B, 0, B);
+      }
+    }
+  }
+
+ public:
+  wide_segment_tree(int n, const T &v = T(), const Op &op = Op())
+      : len(n), op(op), id(op.identity()) {
+    init();
+    std::fill(level(0), level(0) + len, v);
+    build();
+  }
+
+  template<class It>
+  wide_segment_tree(It lo, It hi, const Op &op = Op())
+      : len(hi - lo), op(op), id(op.identity()) {
+    init();
+    std::copy(lo, hi, level(0));
+    build();
+  }
+
+  int size() const {
+    return len;
+  }
+
+  T at(int i) const {
+    return level(0)[i];
+  }
+
+  T query(int lo, int hi) const {
+    T left = id, right = id;
+    for (int k = 0; ; k++) {
+      const T *a = level(k);
+      int lb = lo/B, hb = hi/B;
+      if (lb == hb) {
+        return op(op(left, reduce(a + lb*B, lo - lb*B, hi - lb*B + 1)), right);
+      }
+      left = op(left, reduce(a + lb*B, lo - lb*B, B));
+      right = op(reduce(a + hb*B, 0, hi - hb*B + 1), right);
+      lo = lb + 1;
+      hi = hb - 1;
+      if (lo > hi) {
+        return op(left, right);
+      }
+    }
+  }
+
+  void update(int i, const T &v) {
+    level(0)[i] = v;
+    for (int k = 1; k < (int)level_size.size(); k++) {
+      i /= B;
+      level(k)[i] = reduce(level(k - 1) + i*B, 0, B);
+    }
+  }
+};
+
 /*** Example Usage and Output:
 
 Values: 6 -2 4 8 10
-The minimum value in the range [0, 3] is -2.
+1000000 updates, each followed by a min query:
+  segment_tree: 0.665948s (sum 51246375142)
+  bottom_up_segment_tree: 0.366275s (sum 51246375142)
+  wide_segment_tree: 0.268196s (sum 51246375142)
+1000000 prefix sum queries:
+  wide_segment_tree: 0.194713s (xor 384296201652612)
 
 ***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
 using namespace std;
 
+template<class Tree>
+void test_against_brute() {
+  for (int n = 1; n <= 70; n++) {
+    vector<int> a(n);
+    for (int i = 0; i < n; i++) {
+      a[i] = rand() % 100;
+    }
+    Tree t(a.begin(), a.end()), t2(n, 7);
+    assert(t.size() == n && t2.query(0, n - 1) == 7);
+    for (int k = 0; k < 300; k++) {
+      int i = rand() % n, v = rand() % 100;
+      a[i] = v;
+      t.update(i, v);
+      int lo = rand() % n, hi = rand() % n;
+      if (lo > hi) {
+        swap(lo, hi);
+      }
+      assert(t.at(i) == v);
+      assert(t.query(lo, hi) ==
+             *min_element(a.begin() + lo, a.begin() + hi + 1));
+    }
+  }
+}
+
+template<class T, class Op>
+void test_wide(Op op) {
+  for (int n = 1; n <= 600; n += (n < 40) ? 1 : 59) {
+    vector<T> a(n);
+    for (int i = 0; i < n; i++) {
+      a[i] = rand() % 1000 - 500;
+    }
+    wide_segment_tree<T, Op> t(a.begin(), a.end());
+    wide_segment_tree<T, Op, 2> t2(a.begin(), a.end());
+    for (int k = 0; k < 500; k++) {
+      int i = rand() % n, lo = rand() % n, hi = rand() % n;
+      T v = rand() % 1000 - 500;
+      a[i] = v;
+      t.update(i, v);
+      t2.update(i, v);
+      if (lo > hi) {
+        swap(lo, hi);
+      }
+      T res = a[lo];
+      for (int j = lo + 1; j <= hi; j++) {
+        res = op(res, a[j]);
+      }
+      assert(t.at(i) == v && t.query(lo, hi) == res && t2.query(lo, hi) == res);
+    }
+    // Copies must not refer to the storage of the original.
+    wide_segment_tree<T, Op> *orig =
+        new wide_segment_tree<T, Op>(a.begin(), a.end());
+    wide_segment_tree<T, Op> copy(*orig), assigned(1);
+    assigned = *orig;
+    delete orig;
+    copy.update(0, a[0]);
+    assert(copy.query(0, n - 1) == t.query(0, n - 1));
+    assert(assigned.size() == n);
+    assert(assigned.query(0, n - 1) == t.query(0, n - 1));
+  }
+}
+
+template<class Tree>
+void benchmark(const char *name, const vector<int> &a,
+               const vector<int> &ops) {
+  clock_t start = clock();
+  Tree t(a.begin(), a.end());
+  long long sum = 0;
+  for (int k = 0; k + 2 < (int)ops.size(); k += 3) {
+    t.update(ops[k], ops[k + 1]);
+    int lo = min(ops[k], ops[k + 2]), hi = max(ops[k], ops[k + 2]);
+    sum += t.query(lo, hi);
+  }
+  cout << "  " << name << ": " << (double)(clock() - start)/CLOCKS_PER_SEC
+       << "s (sum " << sum << ")" << endl;
+}
+
 int main() {
   int arr[5] = {6, -2, 1, 8, 10};
   segment_tree<int> t(arr, arr + 5);
@@ -156,5 +464,38 @@ int main() {
   }
   cout << endl;
   assert(t.query(0, 3) == -2);
+  bottom_up_segment_tree<int> t2(arr, arr + 5);
+  t2.update(2, 4);
+  assert(t2.at(2) == 4 && t2.query(0, 3) == -2 && t2.query(2, 4) == 4);
+  test_against_brute<segment_tree<int> >();
+  test_against_brute<bottom_up_segment_tree<int> >();
+  test_against_brute<wide_segment_tree<int, min_op<int> > >();
+  test_wide<int>(min_op<int>());
+  test_wide<long long>(sum_op<long long>());
+  test_wide<int>(sum_op<int>());
+
+  int n = 1000000;
+  vector<int> a(n), ops(3*n);
+  for (int k = 0; k < n; k++) {
+    a[k] = rand();
+    ops[3*k] = ((rand() & 0x7fff) << 15 ^ (rand() & 0x7fff)) % n;
+    ops[3*k + 1] = rand();
+    ops[3*k + 2] = ((rand() & 0x7fff) << 15 ^ (rand() & 0x7fff)) % n;
+  }
+  cout << n << " updates, each followed by a min query:" << endl;
+  benchmark<segment_tree<int> >("segment_tree", a, ops);
+  benchmark<bottom_up_segment_tree<int> >("bottom_up_segment_tree", a, ops);
+  benchmark<wide_segment_tree<int, min_op<int> > >("wide_segment_tree", a, ops);
+
+  // Prefix sums, the query pattern of a range-sum service.
+  wide_segment_tree<long long> t3(a.begin(), a.end());
+  clock_t start = clock();
+  long long x = 0;
+  for (int k = 0; k < n; k++) {
+    x ^= t3.query(0, ops[3*k]);
+  }
+  cout << n << " prefix sum queries:" << endl << "  wide_segment_tree: "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s (xor " << x << ")"
+       << endl;
   return 0;
 }
@@ -3,7 +3,11 @@
 Maintain a fixed-size array while supporting both dynamic queries and updates of
 contiguous subarrays via the lazy propagation technique. This implementation
 uses lazy initialization of nodes to conserve memory while supporting large
-indices.
+indices. Nodes are stored contiguously in a pool, linked to their children by
+32-bit indices, so that a node takes no more space for links than two ints and
+all nodes are released at once without traversing the tree. Indices are 64-bit
+integers within a range [lo, hi] given at construction, where hi - lo must not
+exceed the maximum value of a long long.
 
 The query operation is defined by an associative join_values() function which
 satisfies join_values(x, join_values(y, z)) = join_values(join_values(x, y), z)
@@ -25,12 +29,13 @@ new value. Another possible update operation is "increment", in which case
 join_value_with_delta(v, d, len) should be defined to return "v + d*len" and
 join_deltas(d1, d2) should be defined to return "d1 + d2".
 
-- segment_tree(n, v) constructs an array of size n with indices from 0 to n - 1,
-  inclusive, and all values initialized to v.
-- segment_tree(lo, hi) constructs an array from two random-access iterators as a
-  range [lo, hi), initialized to the elements of the range in the same order.
-- size() returns the size of the array.
-- at(i) returns the value at index i, where i is between 0 and size() - 1.
+- segment_tree(v, lo, hi) constructs an array with indices from lo to hi,
+  inclusive, defaulting to 0 and MAXN, and all values initialized to v.
+- nodes() returns the number of nodes in the pool.
+- reserve(n) preallocates space for n nodes in the pool.
+- clear() resets every value in the array to v, keeping the pool's memory for
+  reuse by later updates.
+- at(i) returns the value at index i.
 - query(lo, hi) returns the result of join_values() applied to all indices from
   lo to hi, inclusive. If the distance between lo and hi is 1, then the single
   specified value is returned.
@@ -39,37 +44,36 @@ join_deltas(d1, d2) should be defined to return "d1 + d2".
   inclusive, by respectively joining them with d using join_value_with_delta().
 
 Time Complexity:
-- O(n) per call to both constructors, where n is the size of the array.
-- O(1) per call to size().
-- O(log n) per call to at(), update(), and query().
+- O(1) per call to the constructor, nodes(), and clear() (the latter given a
+  trivially destructible T).
+- O(n) per call to reserve(n).
+- O(log r) per call to at(), update(), and query(), where r = hi - lo + 1 is
+  the size of the index range.
 
 Space Complexity:
-- O(n) for storage of the array elements.
-- O(log n) auxiliary stack space for update() and query().
-- O(1) auxiliary for size().
+- O(min(r, u log r)) for storage of the array elements, where u is the number
+  of updates since construction or the last call to clear().
+- O(log r) auxiliary stack space for at(), update(), and query().
+- O(1) auxiliary for all other operations.
 
 */
 
 #include <algorithm>
-#include <cstddef>
+#include <vector>
 
 template<class T>
 class segment_tree {
-  static const int MAXN = 1000000000;
+  static const long long MAXN = 1000000000;
 
-  static T neutral_value() {
-    return 0;  // For indices which haven't been updated.
-  }
-    
   static T join_values(const T &a, const T &b) {
-    return std::max(a, b);
+    return std::min(a, b);
   }
 
-  static T join_segment(const T &v, int len) {
+  static T join_segment(const T &v, long long len) {
     return v;
   }
 
-  static T join_value_with_delta(const T &v, const T &d, int len) {
+  static T join_value_with_delta(const T &v, const T &d, long long len) {
     return d;
   }
 
@@ -80,105 +84,128 @@ class segment_tree {
   struct node_t {
     T value, delta;
     bool pending;
-    node_t *left, *right;
+    int left, right;
 
-    node_t(const T &v) : value(v), pending(false), left(NULL), right(NULL) {}
-  } *root;
+    node_t(const T &v) : value(v), pending(false), left(-1), right(-1) {}
+  };
 
+  long long min_index, max_index;
   T init;
+  std::vector<node_t> pool;
+  int root;
+
+  // Nodes are referred to by their indices into the pool, since pushing a new
+  // node may reallocate it and invalidate any references.
+  int make_node(long long len) {
+    pool.push_back(node_t(join_segment(init, len)));
+    return pool.size() - 1;
+  }
 
-  void update_delta(node_t *&n, const T &d, int len) {
-    if (n == NULL) {
-      n = new node_t(join_segment(init, len));
-    }
-    n->delta = n->pending ? join_deltas(n->delta, d) : d;
-    n->pending = true;
+  void update_delta(int n, const T &d) {
+    node_t &node = pool[n];
+    node.delta = node.pending ? join_deltas(node.delta, d) : d;
+    node.pending = true;
   }
 
-  void push_delta(node_t *n, int lo, int hi) {
-    if (n == NULL) {
+  void push_delta(int n, long long lo, long long hi) {
+    if (!pool[n].pending) {
       return;
     }
-    if (n->pending) {
-      n->value = join_value_with_delta(n->value, n->delta, hi - lo + 1);
-      if (lo != hi) {
-        int mid = lo + (hi - lo)/2;
-        update_delta(n->left, n->delta, mid - lo + 1);
-        update_delta(n->right, n->delta, hi - mid);
+    pool[n].value = join_value_with_delta(pool[n].value, pool[n].delta,
+                                          hi - lo + 1);
+    if (lo != hi) {
+      long long mid = lo + (hi - lo)/2;
+      if (pool[n].left < 0) {
+        int l = make_node(mid - lo + 1);
+        pool[n].left = l;
+      }
+      if (pool[n].right < 0) {
+        int r = make_node(hi - mid);
+        pool[n].right = r;
       }
+      update_delta(pool[n].left, pool[n].delta);
+      update_delta(pool[n].right, pool[n].delta);
     }
-    n->pending = false;
+    pool[n].pending = false;
   }
 
-  T query(node_t *n, int lo, int hi, int tgt_lo, int tgt_hi) {
-    if (n == NULL) {
-      return neutral_value();
+  T query(int n, long long lo, long long hi, long long tgt_lo,
+          long long tgt_hi) {
+    if (n < 0) {
+      return join_segment(init, tgt_hi - tgt_lo + 1);
     }
     push_delta(n, lo, hi);
     if (lo == tgt_lo && hi == tgt_hi) {
-      return (n == NULL) ? join_segment(init, hi - lo + 1) : n->value;
+      return pool[n].value;
     }
-    int mid = lo + (hi - lo)/2;
+    long long mid = lo + (hi - lo)/2;
+    int l = pool[n].left, r = pool[n].right;
     if (tgt_lo <= mid && mid < tgt_hi) {
       return join_values(
-          query(n->left, lo, mid, tgt_lo, std::min(tgt_hi, mid)),
-          query(n->right, mid + 1, hi, std::max(tgt_lo, mid + 1), tgt_hi));
+          query(l, lo, mid, tgt_lo, std::min(tgt_hi, mid)),
+          query(r, mid + 1, hi, std::max(tgt_lo, mid + 1), tgt_hi));
     }
     if (tgt_lo <= mid) {
-      return query(n->left, lo, mid, tgt_lo, std::min(tgt_hi, mid));
+      return query(l, lo, mid, tgt_lo, std::min(tgt_hi, mid));
     }
-    return query(n->right, mid + 1, hi, std::max(tgt_lo, mid + 1), tgt_hi);
+    return query(r, mid + 1, hi, std::max(tgt_lo, mid + 1), tgt_hi);
   }
 
-  void update(node_t *&n, int lo, int hi, int tgt_lo, int tgt_hi, const T &d) {
-    if (n == NULL) {
-      n = new node_t(join_segment(init, hi - lo + 1));
+  // Returns the index of node n, which is created first if n is -1.
+  int update(int n, long long lo, long long hi, long long tgt_lo,
+             long long tgt_hi, const T &d) {
+    if (n < 0) {
+      n = make_node(hi - lo + 1);
     }
     push_delta(n, lo, hi);
     if (hi < tgt_lo || lo > tgt_hi) {
-      return;
+      return n;
     }
     if (tgt_lo <= lo && hi <= tgt_hi) {
-      n->delta = d;
-      n->pending = true;
+      update_delta(n, d);
       push_delta(n, lo, hi);
-      return;
+      return n;
     }
-    int mid = lo + (hi - lo)/2;
-    update(n->left, lo, mid, tgt_lo, tgt_hi, d);
-    update(n->right, mid + 1, hi, tgt_lo, tgt_hi, d);
-    n->value = join_values(n->left->value, n->right->value);
+    long long mid = lo + (hi - lo)/2;
+    int l = update(pool[n].left, lo, mid, tgt_lo, tgt_hi, d);
+    pool[n].left = l;
+    int r = update(pool[n].right, mid + 1, hi, tgt_lo, tgt_hi, d);
+    pool[n].right = r;
+    pool[n].value = join_values(pool[l].value, pool[r].value);
+    return n;
   }
 
-  void clean_up(node_t *n) {
-    if (n != NULL) {
-      clean_up(n->left);
-      clean_up(n->right);
-      delete n;
-    }
+ public:
+  segment_tree(const T &v = T(), long long lo = 0, long long hi = MAXN)
+      : min_index(lo), max_index(hi), init(v), root(-1) {}
+
+  long long nodes() const {
+    return pool.size();
   }
 
- public:
-  segment_tree(const T &v = T()) : root(NULL), init(v) {}
+  void reserve(int n) {
+    pool.reserve(n);
+  }
 
-  ~segment_tree() {
-    clean_up(root);
+  void clear() {
+    pool.clear();
+    root = -1;
   }
 
-  T at(int i) {
+  T at(long long i) {
     return query(i, i);
   }
 
-  T query(int lo, int hi) {
-    return query(root, 0, MAXN, lo, hi);
+  T query(long long lo, long long hi) {
+    return query(root, min_index, max_index, lo, hi);
   }
 
-  void update(int i, const T &d) {
-    return update(i, i, d);
+  void update(long long i, const T &d) {
+    update(i, i, d);
   }
 
-  void update(int lo, int hi, const T &d) {
-    return update(root, 0, MAXN, lo, hi, d);
+  void update(long long lo, long long hi, const T &d) {
+    root = update(root, min_index, max_index, lo, hi, d);
   }
 };
 
@@ -186,13 +213,76 @@ class segment_tree {
 
 Values: 6 -2 4 8 10
 Values: 5 5 5 1 5
+20 trees of 10000 updates over 64-bit indices: 2.16973s
+(sum 115584493399127, 4805749 nodes)
 
 ***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
 using namespace std;
 
+long long rand64() {
+  unsigned long long r = 0;
+  for (int i = 0; i < 4; i++) {
+    r = (r << 15) ^ (rand() & 0x7fff);
+  }
+  return (long long)(r & 0x7fffffffffffffffULL);
+}
+
+// Checks a window of w indices at the top of a 64-bit index range.
+void test_against_brute() {
+  const long long lo = -4000000000000000000LL, hi = 4000000000000000000LL;
+  const int w = 200;
+  long long base = hi - w + 1;
+  segment_tree<int> t(7, lo, hi);
+  for (int round = 0; round < 3; round++) {
+    vector<int> a(w, 7);
+    t.clear();
+    assert(t.nodes() == 0 && t.query(lo, hi) == 7);
+    for (int k = 0; k < 2000; k++) {
+      int l = rand() % w, r = rand() % w, d = rand() % 100;
+      if (l > r) {
+        swap(l, r);
+      }
+      t.update(base + l, base + r, d);
+      for (int i = l; i <= r; i++) {
+        a[i] = d;
+      }
+      l = rand() % w;
+      r = rand() % w;
+      if (l > r) {
+        swap(l, r);
+      }
+      int res = *min_element(a.begin() + l, a.begin() + r + 1);
+      assert(t.query(base + l, base + r) == res);
+      assert(t.query(lo, base + r) == min(res, 7) || l != 0);
+      assert(t.at(base - 1) == 7 && t.at(base + l) == a[l]);
+    }
+  }
+}
+
+void benchmark(int num_trees, int num_updates) {
+  segment_tree<int> t(0, 0, 4000000000000000000LL);
+  t.reserve(num_updates*128);
+  clock_t start = clock();
+  long long sum = 0;
+  for (int k = 0; k < num_trees; k++) {
+    t.clear();
+    for (int j = 0; j < num_updates; j++) {
+      long long a = rand64() % 4000000000000000000LL;
+      long long b = rand64() % 4000000000000000000LL;
+      t.update(min(a, b), max(a, b), rand());
+      sum += t.query(min(a, b)/2, max(a, b));
+    }
+  }
+  cout << num_trees << " trees of " << num_updates << " updates over 64-bit "
+       << "indices: " << (double)(clock() - start)/CLOCKS_PER_SEC << "s"
+       << endl << "(sum " << sum << ", " << t.nodes() << " nodes)" << endl;
+}
+
 int main() {
   segment_tree<int> t(0);
   t.update(0, 6);
@@ -215,5 +305,7 @@ int main() {
   }
   cout << endl;
   assert(t.query(0, 3) == 1);
+  test_against_brute();
+  benchmark(20, 10000);
   return 0;
 }
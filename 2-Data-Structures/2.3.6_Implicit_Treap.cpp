@@ -29,23 +29,186 @@ join_deltas(d1, d2) should be defined to return "d1 + d2".
 This data structure shares every operation of one-dimensional segment trees in
 this section, with the additional operations empty(), insert(), erase(),
 push_back(), and pop_back() analogous to those of std::vector (here, insert()
-and erase() both take an index instead of an iterator).
+and erase() both take an index instead of an iterator). Both constructors build
+the treap in linear time as the Cartesian tree of the random priorities.
+stats() returns a reference to the statistics policy object of the array.
+
+Nodes of implicit_treap are allocated through the policy Pool<node_t>, which
+must provide allocate() returning uninitialized storage for one node and
+deallocate(n). The default node_pool carves nodes out of large slabs and reuses
+freed nodes, which avoids a call to the global allocator per insertion and
+erasure. new_allocator may be passed instead to allocate every node separately,
+or arena_allocator to bump allocate nodes from growing chunks that are only
+freed with the array. The destructor frees the nodes iteratively in O(1)
+auxiliary space. The policy Stats receives a call to on_allocate() per node
+allocation and on_visit() per node visited by splits, merges, insertions,
+erasures, and at(). The treap is maintained by splitting and merging rather
+than rotating, so on_rotate() is never called. The default no_stats ignores
+these at no cost, while counting_stats accumulates them into counters that may
+be read and reset through stats() to profile individual operations.
+
+rope<T, B> is an implicit treap without queries or updates, where each node
+stores a chunk of up to B consecutive elements instead of one, for sequences
+such as text buffers that are mostly edited in place. When two trees are
+joined, the chunks on either side of the seam are fused if they fit in one
+chunk, so every pair of adjacent chunks holds more than B elements in total and
+the rope uses about n/B nodes or less for n elements. Nodes are reference
+counted, so that copying a rope, taking a substr(), or inserting one rope into
+another takes O(log n) time and shares nodes. A node is copied before it is
+modified if it is shared, so every rope behaves as an independent value and
+past copies serve as persistent versions. Since a node may outlive the rope
+that allocated it, rope nodes are allocated with operator new rather than from
+a pool owned by each rope.
+- rope(lo, hi) constructs a rope from two random-access iterators as a range
+  [lo, hi), using full chunks.
+- size(), empty(), and at(i) are analogous to those of the implicit treap.
+- chunks() returns the number of chunks held by the rope.
+- insert(i, v), insert(i, lo, hi), and insert(i, s) inserts the value v, the
+  range [lo, hi), or the contents of the rope s before index i, respectively.
+- push_back(v) and append(s) insert the value v or the rope s at the end.
+- erase(i) and erase(lo, hi) removes index i or indices lo to hi, inclusive.
+- substr(lo, hi) returns a rope of the elements at indices lo to hi, inclusive.
+- copy(out) writes the elements in order to the output iterator out, returning
+  the iterator past the last element written.
 
 Time Complexity:
-- O(n) per call to both constructors, where n is the size of the array.
+- O(n) per call to both constructors of implicit_treap, where n is the size of
+  the array.
 - O(1) per call to size() and empty().
-- O(log n) on average per call to all other operations.
+- O(log n) on average per call to all other operations of implicit_treap.
+- O(m/B) per call to the range constructor of rope, where m = hi - lo.
+- O(B + log n) on average per call to insert(i, v), erase(), and substr() of
+  rope, plus O(m/B) for the range of insert(i, lo, hi).
+- O(log n) on average per call to at(), the copy constructor, and assignment
+  of rope, as well as O(n/B) for chunks() and O(n) for copy().
 
 Space Complexity:
 - O(n) for storage of the array elements.
-- O(1) auxiliary for size() and empty().
+- O(1) auxiliary for size(), empty(), and destruction of implicit_treap.
 - O(log n) auxiliary stack space for all other operations.
+- O(B log n) auxiliary heap space per modification of a rope that shares nodes.
 
 */
 
+#include <algorithm>
 #include <cstdlib>
+#include <new>
+#include <vector>
 
-template<class T>
+// Default allocation policy, handing out nodes from slabs of SLAB_SIZE nodes
+// and recycling freed nodes through a free list. Slabs are only released when
+// the pool is destroyed.
+template<class Node>
+class node_pool {
+  static const int SLAB_SIZE = 1024;
+
+  std::vector<Node*> slabs, free_nodes;
+  int used;
+
+  node_pool(const node_pool &);
+  node_pool& operator=(const node_pool &);
+
+ public:
+  node_pool() : used(SLAB_SIZE) {}
+
+  ~node_pool() {
+    for (int i = 0; i < (int)slabs.size(); i++) {
+      ::operator delete(slabs[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (!free_nodes.empty()) {
+      Node *n = free_nodes.back();
+      free_nodes.pop_back();
+      return n;
+    }
+    if (used == SLAB_SIZE) {
+      void *slab = ::operator new(SLAB_SIZE*sizeof(Node));
+      slabs.push_back(static_cast<Node*>(slab));
+      used = 0;
+    }
+    return slabs.back() + used++;
+  }
+
+  void deallocate(Node *n) {
+    free_nodes.push_back(n);
+  }
+};
+
+// Alternative allocation policy, calling operator new and delete per node.
+template<class Node>
+struct new_allocator {
+  Node* allocate() {
+    return static_cast<Node*>(::operator new(sizeof(Node)));
+  }
+
+  void deallocate(Node *n) {
+    ::operator delete(n);
+  }
+};
+
+// Alternative allocation policy, handing out nodes from chunks of growing size
+// (up to MAX_CHUNK nodes) without ever reusing freed nodes. All storage is
+// released at once when the arena is destroyed, which suits arrays that are
+// built and then discarded as a whole.
+template<class Node>
+class arena_allocator {
+  static const int MAX_CHUNK = 65536;
+
+  std::vector<Node*> chunks;
+  int used, capacity;
+
+  arena_allocator(const arena_allocator &);
+  arena_allocator& operator=(const arena_allocator &);
+
+ public:
+  arena_allocator() : used(0), capacity(0) {}
+
+  ~arena_allocator() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+      ::operator delete(chunks[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (used == capacity) {
+      capacity = (capacity == 0) ? 16 : std::min(2*capacity, (int)MAX_CHUNK);
+      void *chunk = ::operator new(capacity*sizeof(Node));
+      chunks.push_back(static_cast<Node*>(chunk));
+      used = 0;
+    }
+    return chunks.back() + used++;
+  }
+
+  void deallocate(Node *) {}
+};
+
+// Default statistics policy, whose empty hooks compile away entirely.
+struct no_stats {
+  void on_allocate() {}
+  void on_rotate() {}
+  void on_visit() {}
+};
+
+// Alternative statistics policy, counting node allocations, rotations, and
+// nodes visited on search paths since construction or the last reset().
+struct counting_stats {
+  long long allocations, rotations, visits;
+
+  counting_stats() : allocations(0), rotations(0), visits(0) {}
+
+  void on_allocate() { allocations++; }
+  void on_rotate() { rotations++; }
+  void on_visit() { visits++; }
+
+  void reset() {
+    allocations = rotations = visits = 0;
+  }
+};
+
+template<class T, template<class> class Pool = node_pool,
+         class Stats = no_stats>
 class implicit_treap {
   static T join_values(const T &a, const T &b) {
     return a < b ? a : b;
@@ -74,6 +237,19 @@ class implicit_treap {
           priority(rand32()), left(NULL), right(NULL) {}
   } *root;
 
+  Pool<node_t> pool;
+  mutable Stats st;
+
+  node_t* create(const T &v) {
+    st.on_allocate();
+    return new (pool.allocate()) node_t(v);
+  }
+
+  void destroy(node_t *n) {
+    n->~node_t();
+    pool.deallocate(n);
+  }
+
   static int size(node_t *n) {
     return (n == NULL) ? 0 : n->size;
   }
@@ -113,7 +289,8 @@ class implicit_treap {
     n->pending = false;
   }
 
-  static void merge(node_t *&n, node_t *left, node_t *right) {
+  void merge(node_t *&n, node_t *left, node_t *right) {
+    st.on_visit();
     push_delta(left);
     push_delta(right);
     if (left == NULL) {
@@ -130,7 +307,8 @@ class implicit_treap {
     update_value(n);
   }
 
-  static void split(node_t *n, node_t *&left, node_t *&right, int i) {
+  void split(node_t *n, node_t *&left, node_t *&right, int i) {
+    st.on_visit();
     push_delta(n);
     if (n == NULL) {
       left = right = NULL;
@@ -144,7 +322,8 @@ class implicit_treap {
     update_value(n);
   }
 
-  static void insert(node_t *&n, node_t *new_node, int i) {
+  void insert(node_t *&n, node_t *new_node, int i) {
+    st.on_visit();
     push_delta(n);
     if (n == NULL) {
       n = new_node;
@@ -159,11 +338,14 @@ class implicit_treap {
     update_value(n);
   }
 
-  static void erase(node_t *&n, int i) {
+  void erase(node_t *&n, int i) {
+    st.on_visit();
     push_delta(n);
     if (i == size(n->left)) {
-      delete n;
+      node_t *tmp = n;
       merge(n, n->left, n->right);
+      destroy(tmp);
+      return;
     } else if (i < size(n->left)) {
       erase(n->left, i);
     } else {
@@ -172,7 +354,8 @@ class implicit_treap {
     update_value(n);
   }
 
-  static node_t* select(node_t *n, int i) {
+  node_t* select(node_t *n, int i) const {
+    st.on_visit();
     push_delta(n);
     if (i < size(n->left)) {
       return select(n->left, i);
@@ -183,26 +366,61 @@ class implicit_treap {
     return n;
   }
 
-  void clean_up(node_t *&n) {
+  static void update_all(node_t *n) {
     if (n != NULL) {
-      clean_up(n->left);
-      clean_up(n->right);
-      delete n;
+      update_all(n->left);
+      update_all(n->right);
+      update_value(n);
+    }
+  }
+
+  // Builds the Cartesian tree of the priorities of the nodes in a stack of
+  // its right spine, in which every node is pushed and popped at most once.
+  template<class It>
+  void build(It lo, It hi) {
+    std::vector<node_t*> spine;
+    for (; lo != hi; ++lo) {
+      node_t *n = create(*lo), *last = NULL;
+      while (!spine.empty() && spine.back()->priority > n->priority) {
+        last = spine.back();
+        spine.pop_back();
+      }
+      n->left = last;
+      if (!spine.empty()) {
+        spine.back()->right = n;
+      }
+      spine.push_back(n);
+    }
+    root = spine.empty() ? NULL : spine[0];
+    update_all(root);
+  }
+
+  // Frees the nodes of n in O(1) auxiliary space by rotating each left child
+  // up until the current node has none, so that deep paths are safe.
+  void clean_up(node_t *n) {
+    while (n != NULL) {
+      if (n->left != NULL) {
+        node_t *l = n->left;
+        n->left = l->right;
+        l->right = n;
+        n = l;
+      } else {
+        node_t *right = n->right;
+        destroy(n);
+        n = right;
+      }
     }
   }
 
  public:
   implicit_treap(int n = 0, const T &v = T()) : root(NULL) {
-    for (int i = 0; i < n; i++) {
-      push_back(v);
-    }
+    std::vector<T> values(n, v);
+    build(values.begin(), values.end());
   }
 
   template<class It>
   implicit_treap(It lo, It hi) : root(NULL) {
-    for (; lo != hi; ++lo) {
-      push_back(*lo);
-    }
+    build(lo, hi);
   }
 
   ~implicit_treap() {
@@ -218,7 +436,7 @@ class implicit_treap {
   }
 
   void insert(int i, const T &v) {
-    insert(root, new node_t(v), i);
+    insert(root, create(v), i);
   }
 
   void erase(int i) {
@@ -259,6 +477,306 @@ class implicit_treap {
     merge(t, l2, r2);
     merge(root, t, r1);
   }
+
+  const Stats& stats() const {
+    return st;
+  }
+
+  Stats& stats() {
+    return st;
+  }
+};
+
+template<class T, int B = 256>
+class rope {
+  struct node_t {
+    static inline int rand32() {
+      return (rand() & 0x7fff) | ((rand() & 0x7fff) << 15);
+    }
+
+    std::vector<T> chunk;
+    int size, priority, refs;
+    node_t *left, *right;
+
+    template<class It>
+    node_t(It lo, It hi, int priority = rand32())
+        : chunk(lo, hi), size(hi - lo), priority(priority), refs(1),
+          left(NULL), right(NULL) {}
+  } *root;
+
+  static int size(node_t *n) {
+    return (n == NULL) ? 0 : n->size;
+  }
+
+  static void update_size(node_t *n) {
+    n->size = n->chunk.size() + size(n->left) + size(n->right);
+  }
+
+  static node_t* share(node_t *n) {
+    if (n != NULL) {
+      n->refs++;
+    }
+    return n;
+  }
+
+  static void release(node_t *n) {
+    if (n != NULL && --n->refs == 0) {
+      release(n->left);
+      release(n->right);
+      delete n;
+    }
+  }
+
+  // Returns a node that may be modified in place of n, which is a copy of n if
+  // n is shared with another rope. The copy takes over this rope's reference
+  // to n, and holds new references to the children of n.
+  static node_t* own(node_t *n) {
+    if (n->refs == 1) {
+      return n;
+    }
+    node_t *c = new node_t(n->chunk.begin(), n->chunk.end(), n->priority);
+    c->size = n->size;
+    c->left = share(n->left);
+    c->right = share(n->right);
+    n->refs--;
+    return c;
+  }
+
+  static node_t* merge(node_t *left, node_t *right) {
+    if (left == NULL) {
+      return right;
+    }
+    if (right == NULL) {
+      return left;
+    }
+    if (left->priority < right->priority) {
+      left = own(left);
+      left->right = merge(left->right, right);
+      update_size(left);
+      return left;
+    }
+    right = own(right);
+    right->left = merge(left, right->left);
+    update_size(right);
+    return right;
+  }
+
+  // Splits n into the first i elements and the rest. A chunk straddling index i
+  // is cut into two nodes of the same priority, one for each side.
+  static void split(node_t *n, int i, node_t *&left, node_t *&right) {
+    if (n == NULL) {
+      left = right = NULL;
+      return;
+    }
+    n = own(n);
+    int k = size(n->left), c = n->chunk.size();
+    if (i <= k) {
+      split(n->left, i, left, n->left);
+      right = n;
+    } else if (i >= k + c) {
+      split(n->right, i - k - c, n->right, right);
+      left = n;
+    } else {
+      node_t *tail = new node_t(n->chunk.begin() + (i - k), n->chunk.end(),
+                                n->priority);
+      tail->right = n->right;
+      n->right = NULL;
+      n->chunk.resize(i - k);
+      update_size(tail);
+      left = n;
+      right = tail;
+    }
+    update_size(n);
+  }
+
+  // Builds a tree of full chunks storing [lo, hi) in O((hi - lo)/B) time, as
+  // the Cartesian tree of their priorities.
+  template<class It>
+  static node_t* build(It lo, It hi) {
+    std::vector<node_t*> spine;
+    while (lo != hi) {
+      It mid = (hi - lo > B) ? lo + B : hi;
+      node_t *n = new node_t(lo, mid), *last = NULL;
+      while (!spine.empty() && spine.back()->priority > n->priority) {
+        last = spine.back();
+        spine.pop_back();
+        update_size(last);
+      }
+      n->left = last;
+      if (!spine.empty()) {
+        spine.back()->right = n;
+      }
+      spine.push_back(n);
+      lo = mid;
+    }
+    for (int j = (int)spine.size() - 1; j >= 0; j--) {
+      update_size(spine[j]);
+    }
+    return spine.empty() ? NULL : spine[0];
+  }
+
+  // Removes and returns the node holding the last chunk of n.
+  static node_t* pop_last(node_t *&n) {
+    n = own(n);
+    if (n->right == NULL) {
+      node_t *last = n;
+      n = n->left;
+      last->left = NULL;
+      update_size(last);
+      return last;
+    }
+    node_t *last = pop_last(n->right);
+    update_size(n);
+    return last;
+  }
+
+  static node_t* pop_first(node_t *&n) {
+    n = own(n);
+    if (n->left == NULL) {
+      node_t *first = n;
+      n = n->right;
+      first->right = NULL;
+      update_size(first);
+      return first;
+    }
+    node_t *first = pop_first(n->left);
+    update_size(n);
+    return first;
+  }
+
+  // Merges left and right, first fusing the chunks on either side of the seam
+  // if they fit in one chunk. This keeps chunks from fragmenting after edits.
+  static node_t* join(node_t *left, node_t *right) {
+    if (left == NULL || right == NULL) {
+      return merge(left, right);
+    }
+    node_t *a = pop_last(left), *b = pop_first(right);
+    if (a->chunk.size() + b->chunk.size() <= (size_t)B) {
+      a->chunk.insert(a->chunk.end(), b->chunk.begin(), b->chunk.end());
+      update_size(a);
+      release(b);
+      return merge(merge(left, a), right);
+    }
+    return merge(merge(left, a), merge(b, right));
+  }
+
+  static int count_chunks(node_t *n) {
+    return (n == NULL) ? 0 : 1 + count_chunks(n->left) +
+                             count_chunks(n->right);
+  }
+
+  template<class OutIt>
+  static OutIt copy(node_t *n, OutIt out) {
+    if (n != NULL) {
+      out = copy(n->left, out);
+      out = std::copy(n->chunk.begin(), n->chunk.end(), out);
+      out = copy(n->right, out);
+    }
+    return out;
+  }
+
+  explicit rope(node_t *n) : root(n) {}
+
+ public:
+  rope() : root(NULL) {}
+
+  template<class It>
+  rope(It lo, It hi) : root(build(lo, hi)) {}
+
+  rope(const rope &r) : root(share(r.root)) {}
+
+  rope& operator=(const rope &r) {
+    node_t *n = share(r.root);
+    release(root);
+    root = n;
+    return *this;
+  }
+
+  ~rope() {
+    release(root);
+  }
+
+  int size() const {
+    return size(root);
+  }
+
+  bool empty() const {
+    return root == NULL;
+  }
+
+  int chunks() const {
+    return count_chunks(root);
+  }
+
+  T at(int i) const {
+    node_t *n = root;
+    for (;;) {
+      int k = size(n->left), c = n->chunk.size();
+      if (i < k) {
+        n = n->left;
+      } else if (i < k + c) {
+        return n->chunk[i - k];
+      } else {
+        i -= k + c;
+        n = n->right;
+      }
+    }
+  }
+
+  void insert(int i, const T &v) {
+    node_t *l, *r;
+    split(root, i, l, r);
+    T arr[1] = {v};
+    root = join(join(l, build(arr, arr + 1)), r);
+  }
+
+  template<class It>
+  void insert(int i, It lo, It hi) {
+    node_t *l, *r;
+    split(root, i, l, r);
+    root = join(join(l, build(lo, hi)), r);
+  }
+
+  void insert(int i, const rope &s) {
+    // The reference to s is taken first, since s may be this rope.
+    node_t *l, *r, *m = share(s.root);
+    split(root, i, l, r);
+    root = join(join(l, m), r);
+  }
+
+  void push_back(const T &v) {
+    insert(size(), v);
+  }
+
+  void append(const rope &s) {
+    insert(size(), s);
+  }
+
+  void erase(int i) {
+    erase(i, i);
+  }
+
+  void erase(int lo, int hi) {
+    node_t *l, *m, *r;
+    split(root, hi + 1, m, r);
+    split(m, lo, l, m);
+    release(m);
+    root = join(l, r);
+  }
+
+  rope substr(int lo, int hi) const {
+    node_t *l, *m, *r, *n = share(root);
+    split(n, hi + 1, m, r);
+    split(m, lo, l, m);
+    release(l);
+    release(r);
+    return rope(m);
+  }
+
+  template<class OutIt>
+  OutIt copy(OutIt out) const {
+    return copy(root, out);
+  }
 };
 
 /*** Example Usage and Output:
@@ -266,10 +784,16 @@ class implicit_treap {
 Values: 99 -2 1 8 10 11 (min: -2)
 Values: 90 -2 1 8 10 11 (min: -2)
 Values: 2 2 1 8 10 11 (min: 1)
+implicit_treap of 1000000 values: built in 0.109798s
+rope of 16000000 chars: built in 0.005715s, 100000 edits in 0.244293s
+(106116 chunks, 16000000 chars still in the original copy)
 
 ***/
 
+#include <cassert>
+#include <ctime>
 #include <iostream>
+#include <string>
 using namespace std;
 
 void print(implicit_treap<int> &t) {
@@ -280,6 +804,133 @@ void print(implicit_treap<int> &t) {
   cout << " (min: " << t.query(0, t.size() - 1) << ")" << endl;
 }
 
+void test_implicit_treap() {
+  vector<int> a;
+  for (int i = 0; i < 1000; i++) {
+    a.push_back(rand() % 1000);
+  }
+  implicit_treap<int> t(a.begin(), a.end());
+  for (int k = 0; k < 2000; k++) {
+    int i = rand() % (a.size() + 1), v = rand() % 1000;
+    if (rand() % 2 == 0 && i < (int)a.size()) {
+      a.erase(a.begin() + i);
+      t.erase(i);
+    } else {
+      a.insert(a.begin() + i, v);
+      t.insert(i, v);
+    }
+    int lo = rand() % a.size(), hi = rand() % a.size();
+    if (lo > hi) {
+      swap(lo, hi);
+    }
+    assert(t.size() == (int)a.size());
+    assert(t.query(lo, hi) == *min_element(a.begin() + lo, a.begin() + hi + 1));
+  }
+  for (int i = 0; i < (int)a.size(); i++) {
+    assert(t.at(i) == a[i]);
+  }
+  implicit_treap<int> t2(10, 3);
+  assert(t2.size() == 10 && t2.query(0, 9) == 3);
+}
+
+string to_string(const rope<char, 16> &r) {
+  string s(r.size(), ' ');
+  r.copy(s.begin());
+  return s;
+}
+
+void test_rope() {
+  string s = "the quick brown fox jumps over the lazy dog";
+  rope<char, 16> r(s.begin(), s.end());
+  vector<pair<rope<char, 16>, string> > versions;
+  for (int k = 0; k < 3000; k++) {
+    int i = rand() % (s.size() + 1), op = rand() % 6;
+    if (op == 0 || s.empty()) {
+      char c = 'a' + rand() % 26;
+      s.insert(s.begin() + i, c);
+      r.insert(i, c);
+    } else if (op == 1) {
+      string t(rand() % 40, 'a' + rand() % 26);
+      s.insert(i, t);
+      r.insert(i, t.begin(), t.end());
+    } else if (op == 2 || op == 3) {
+      int lo = rand() % s.size(), hi = min((int)s.size() - 1, lo + rand() % 30);
+      if (op == 2) {
+        s.erase(lo, hi - lo + 1);
+        r.erase(lo, hi);
+      } else {
+        string t = s.substr(lo, hi - lo + 1);
+        s.insert(i, t);
+        r.insert(i, r.substr(lo, hi));
+      }
+    } else if (op == 4) {
+      versions.push_back(make_pair(r, s));
+    } else if (!versions.empty()) {
+      int j = rand() % versions.size();
+      const pair<rope<char, 16>, string> &v = versions[j];
+      if (s.size() + v.second.size() < 5000) {
+        s += v.second;
+        r.append(v.first);
+      }
+    }
+    assert(r.size() == (int)s.size());
+    assert(r.chunks() <= 2*(int)s.size()/16 + 1);
+    if (!s.empty()) {
+      int j = rand() % s.size();
+      assert(r.at(j) == s[j]);
+    }
+  }
+  assert(to_string(r) == s);
+  // A rope may be inserted into or appended to itself.
+  rope<char, 16> self(s.begin(), s.begin() + 40);
+  string expected = s.substr(0, 40);
+  self.append(self);
+  expected += expected;
+  self.insert(5, self);
+  expected.insert(5, expected);
+  assert(to_string(self) == expected && self.size() == 160);
+  // Every earlier version is unaffected by later edits.
+  for (int j = 0; j < (int)versions.size(); j++) {
+    assert(to_string(versions[j].first) == versions[j].second);
+  }
+}
+
+void benchmark(int n, int edits) {
+  vector<int> a(n);
+  for (int i = 0; i < n; i++) {
+    a[i] = rand();
+  }
+  clock_t start = clock();
+  {
+    implicit_treap<int> t(a.begin(), a.end());
+    assert(t.size() == n);
+  }
+  cout << "implicit_treap of " << n << " values: built in "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s" << endl;
+  string text(16*n, ' ');
+  for (int i = 0; i < (int)text.size(); i++) {
+    text[i] = 'a' + rand() % 26;
+  }
+  start = clock();
+  rope<char> r(text.begin(), text.end());
+  double build_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  rope<char> original(r);
+  start = clock();
+  for (int k = 0; k < edits; k++) {
+    int i = ((rand() & 0x7fff) << 15 ^ (rand() & 0x7fff)) % r.size();
+    if (k % 10 == 0) {
+      r.erase(i, min(r.size() - 1, i + rand() % 100));
+    } else {
+      r.insert(i, 'a' + rand() % 26);
+    }
+  }
+  double edit_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  cout << "rope of " << text.size() << " chars: built in " << build_time
+       << "s, " << edits << " edits in " << edit_time << "s" << endl;
+  cout << "(" << r.chunks() << " chunks, " << original.size()
+       << " chars still in the original copy)" << endl;
+}
+
 int main() {
   int arr[5] = {99, -2, 1, 8, 10};
   implicit_treap<int> t(arr, arr + 5);
@@ -292,5 +943,27 @@ int main() {
   print(t);
   t.update(0, 1, 2);
   print(t);
+
+  // Allocation policies and operation statistics.
+  vector<int> values(1000);
+  for (int i = 0; i < 1000; i++) {
+    values[i] = i;
+  }
+  implicit_treap<int, arena_allocator, counting_stats> profiled(
+      values.begin(), values.end());
+  profiled.push_back(1000);
+  assert(profiled.stats().allocations == 1001);
+  assert(profiled.stats().rotations == 0);
+  profiled.stats().reset();
+  assert(profiled.at(500) == 500 && profiled.stats().visits > 0);
+  implicit_treap<int, new_allocator> separate(values.begin(), values.end());
+  for (int i = 0; i < 500; i++) {
+    separate.erase(i);
+  }
+  assert(separate.size() == 500 && separate.query(0, 499) == 1);
+  assert(separate.at(499) == 999);
+  test_implicit_treap();
+  test_rope();
+  benchmark(1000000, 100000);
   return 0;
 }
@@ -0,0 +1,381 @@
+/*
+
+Maintain a fixed-size array while supporting both dynamic queries and updates of
+contiguous subarrays, where every update creates a new version of the array and
+all past versions remain available for querying.
+
+The query operation is defined by an associative join_values() function which
+satisfies join_values(x, join_values(y, z)) = join_values(join_values(x, y), z)
+for all values x, y, and z in the array. The default code below assumes a
+numerical array type, defining queries for the "min" of the target range.
+Another possible query operation is "sum", in which case the join_values()
+function should be defined to return "a + b".
+
+The update operation is defined by the join_value_with_delta() and join_deltas()
+functions, which determines the change made to array values. Updated nodes hold
+their deltas as tags which are never pushed down to their children, so that an
+update only copies the nodes along the paths to the boundaries of its range.
+The query result for a node's range is then its children's joined result with
+the node's tag applied on top. This requires that deltas be applicable in any
+order, that is, in addition to the requirements for the lazy propagation
+segment tree in this section:
+- join_deltas(d1, d2) = join_deltas(d2, d1).
+- join_value_with_delta(join_value_with_delta(v, d1, m), d2, m) should be equal
+  to join_value_with_delta(v, join_deltas(d1, d2), m).
+The default code below defines updates that "increment" the chosen array
+indices by a value. For "sum" queries, join_value_with_delta(v, d, len) should
+be defined to return "v + d*len". Updates that "set" array indices are not
+supported, as they depend on the order in which they are applied.
+
+Nodes are allocated from an arena of contiguous storage by pushing to its end,
+and are addressed by their indices into the arena. Versions are numbered by
+consecutive integers starting from 0 for the initial array.
+
+- persistent_segment_tree(n, v) constructs version 0 of an array of size n with
+  indices from 0 to n - 1, inclusive, and all values initialized to v.
+- persistent_segment_tree(lo, hi) constructs version 0 of an array from two
+  random-access iterators as a range [lo, hi), initialized to the elements of
+  the range in the same order.
+- size() returns the size of the array.
+- latest() returns the number of the most recent version.
+- nodes() returns the number of nodes occupying the arena.
+- at(i, v) returns the value at index i of version v, defaulting to the latest.
+- query(lo, hi, v) returns the result of join_values() applied to all indices
+  from lo to hi, inclusive, of version v, defaulting to the latest.
+- update(i, d) creates a new version from the latest one, where the value v at
+  index i is assigned to join_value_with_delta(v, d, 1), returning the number of
+  the new version.
+- update(lo, hi, d) creates a new version from the latest one, where the value
+  at each array index from lo to hi, inclusive, is joined with d using
+  join_value_with_delta(), returning the number of the new version.
+- snapshot(v) creates a new version identical to version v, returning its
+  number. Subsequent updates will thus branch off from version v.
+- drop_versions_before(v) discards every version numbered less than v, then
+  reclaims the arena memory which only they used by moving the nodes reachable
+  from the remaining versions into a new arena. The remaining versions keep
+  their numbers.
+
+Time Complexity:
+- O(n) per call to both constructors, where n is the size of the array.
+- O(1) per call to size(), latest(), nodes(), and snapshot().
+- O(log n) per call to at(), query(), and update(), with O(log n) nodes
+  allocated per call to update().
+- O(a) per call to drop_versions_before(), where a is the number of nodes in
+  the arena before the call.
+
+Space Complexity:
+- O(n + u log n) for storage of the nodes, where u is the number of updates
+  since the last call to drop_versions_before().
+- O(log n) auxiliary stack space for at(), query(), and update().
+- O(a) auxiliary heap space for drop_versions_before(), since the old arena is
+  kept alive while the reachable nodes are copied into the new one.
+- O(1) auxiliary for all other operations.
+
+*/
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+template<class T>
+class persistent_segment_tree {
+  static T join_values(const T &a, const T &b) {
+    return std::min(a, b);
+  }
+
+  static T join_value_with_delta(const T &v, const T &d, int len) {
+    return v + d;
+  }
+
+  static T join_deltas(const T &d1, const T &d2) {
+    return d1 + d2;
+  }
+
+  struct node_t {
+    T value, delta;
+    bool pending;
+    int left, right;
+
+    node_t(const T &v) : value(v), pending(false), left(-1), right(-1) {}
+  };
+
+  int len, base;
+  std::vector<node_t> arena;
+  std::vector<int> roots;
+
+  int root(int v) const {
+    if (v < base || v >= base + (int)roots.size()) {
+      throw std::runtime_error("Version does not exist.");
+    }
+    return roots[v - base];
+  }
+
+  int build(int lo, int hi, const T &v) {
+    if (lo == hi) {
+      arena.push_back(node_t(v));
+      return arena.size() - 1;
+    }
+    int mid = lo + (hi - lo)/2;
+    int l = build(lo, mid, v), r = build(mid + 1, hi, v);
+    return join_children(l, r);
+  }
+
+  template<class It>
+  int build(int lo, int hi, It arr) {
+    if (lo == hi) {
+      arena.push_back(node_t(*(arr + lo)));
+      return arena.size() - 1;
+    }
+    int mid = lo + (hi - lo)/2;
+    int l = build(lo, mid, arr), r = build(mid + 1, hi, arr);
+    return join_children(l, r);
+  }
+
+  int join_children(int l, int r) {
+    arena.push_back(node_t(join_values(arena[l].value, arena[r].value)));
+    arena.back().left = l;
+    arena.back().right = r;
+    return arena.size() - 1;
+  }
+
+  T query(int n, int lo, int hi, int tgt_lo, int tgt_hi) const {
+    const node_t &node = arena[n];
+    if (lo == tgt_lo && hi == tgt_hi) {
+      return node.value;
+    }
+    int mid = lo + (hi - lo)/2;
+    T res;
+    if (tgt_lo <= mid && mid < tgt_hi) {
+      res = join_values(
+          query(node.left, lo, mid, tgt_lo, std::min(tgt_hi, mid)),
+          query(node.right, mid + 1, hi, std::max(tgt_lo, mid + 1), tgt_hi));
+    } else if (tgt_lo <= mid) {
+      res = query(node.left, lo, mid, tgt_lo, std::min(tgt_hi, mid));
+    } else {
+      res = query(node.right, mid + 1, hi, std::max(tgt_lo, mid + 1), tgt_hi);
+    }
+    if (node.pending) {
+      res = join_value_with_delta(res, node.delta, tgt_hi - tgt_lo + 1);
+    }
+    return res;
+  }
+
+  // Returns the index of a copy of node n with the update applied. References
+  // into the arena are invalidated by the allocations, so nodes are accessed
+  // by index throughout.
+  int update(int n, int lo, int hi, int tgt_lo, int tgt_hi, const T &d) {
+    arena.push_back(arena[n]);
+    int c = arena.size() - 1;
+    if (tgt_lo <= lo && hi <= tgt_hi) {
+      node_t &node = arena[c];
+      node.value = join_value_with_delta(node.value, d, hi - lo + 1);
+      node.delta = node.pending ? join_deltas(node.delta, d) : d;
+      node.pending = true;
+      return c;
+    }
+    int mid = lo + (hi - lo)/2;
+    if (tgt_lo <= mid) {
+      int l = update(arena[c].left, lo, mid, tgt_lo, tgt_hi, d);
+      arena[c].left = l;
+    }
+    if (mid < tgt_hi) {
+      int r = update(arena[c].right, mid + 1, hi, tgt_lo, tgt_hi, d);
+      arena[c].right = r;
+    }
+    node_t &node = arena[c];
+    node.value = join_values(arena[node.left].value, arena[node.right].value);
+    if (node.pending) {
+      node.value = join_value_with_delta(node.value, node.delta, hi - lo + 1);
+    }
+    return c;
+  }
+
+  // Copies node n and its descendants from the old arena, each at most once.
+  int move_node(int n, const std::vector<node_t> &old,
+                std::vector<int> &moved) {
+    if (n < 0) {
+      return -1;
+    }
+    if (moved[n] < 0) {
+      int l = move_node(old[n].left, old, moved);
+      int r = move_node(old[n].right, old, moved);
+      arena.push_back(old[n]);
+      arena.back().left = l;
+      arena.back().right = r;
+      moved[n] = arena.size() - 1;
+    }
+    return moved[n];
+  }
+
+ public:
+  persistent_segment_tree(int n, const T &v = T()) : len(n), base(0) {
+    arena.reserve(2*len);
+    roots.push_back(build(0, len - 1, v));
+  }
+
+  template<class It>
+  persistent_segment_tree(It lo, It hi) : len(hi - lo), base(0) {
+    arena.reserve(2*len);
+    roots.push_back(build(0, len - 1, lo));
+  }
+
+  int size() const {
+    return len;
+  }
+
+  int latest() const {
+    return base + roots.size() - 1;
+  }
+
+  int nodes() const {
+    return arena.size();
+  }
+
+  T at(int i, int v) const {
+    return query(i, i, v);
+  }
+
+  T at(int i) const {
+    return query(i, i, latest());
+  }
+
+  T query(int lo, int hi, int v) const {
+    return query(root(v), 0, len - 1, lo, hi);
+  }
+
+  T query(int lo, int hi) const {
+    return query(lo, hi, latest());
+  }
+
+  int update(int i, const T &d) {
+    return update(i, i, d);
+  }
+
+  int update(int lo, int hi, const T &d) {
+    roots.push_back(update(roots.back(), 0, len - 1, lo, hi, d));
+    return latest();
+  }
+
+  int snapshot(int v) {
+    roots.push_back(root(v));
+    return latest();
+  }
+
+  void drop_versions_before(int v) {
+    root(v);
+    roots.erase(roots.begin(), roots.begin() + (v - base));
+    base = v;
+    std::vector<node_t> old;
+    old.swap(arena);
+    std::vector<int> moved(old.size(), -1);
+    for (int i = 0; i < (int)roots.size(); i++) {
+      roots[i] = move_node(roots[i], old, moved);
+    }
+  }
+};
+
+/*** Example Usage and Output:
+
+Version 0: 6 -2 1 8 10
+Version 1: 6 -2 4 8 10
+Version 2: 7 -1 5 9 11
+200000 range updates and versioned queries: 1.35105s (sum 123194018775)
+Nodes: 12896427, 2151260 after dropping all but 1001 versions in 0.153774s
+
+***/
+
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+using namespace std;
+
+void test_against_brute() {
+  for (int n = 1; n <= 40; n += 3) {
+    vector<vector<int> > versions(1, vector<int>(n));
+    for (int i = 0; i < n; i++) {
+      versions[0][i] = rand() % 100;
+    }
+    persistent_segment_tree<int> t(versions[0].begin(), versions[0].end());
+    int first = 0;
+    for (int k = 1; k <= 300; k++) {
+      if (rand() % 10 == 0) {
+        int v = first + rand() % (k - first);
+        assert(t.snapshot(v) == k);
+        versions.push_back(versions[v]);
+      } else {
+        int lo = rand() % n, hi = rand() % n, d = rand() % 21 - 10;
+        if (lo > hi) {
+          swap(lo, hi);
+        }
+        assert(t.update(lo, hi, d) == k);
+        versions.push_back(versions.back());
+        for (int i = lo; i <= hi; i++) {
+          versions[k][i] += d;
+        }
+      }
+      if (k % 50 == 0) {
+        first = k - rand() % 20;
+        int before = t.nodes();
+        t.drop_versions_before(first);
+        assert(t.nodes() <= before);
+      }
+      for (int q = 0; q < 5; q++) {
+        int v = first + rand() % (k - first + 1);
+        int lo = rand() % n, hi = rand() % n;
+        if (lo > hi) {
+          swap(lo, hi);
+        }
+        const vector<int> &a = versions[v];
+        assert(t.query(lo, hi, v) ==
+               *min_element(a.begin() + lo, a.begin() + hi + 1));
+        assert(t.at(lo, v) == a[lo]);
+      }
+    }
+    assert(t.latest() == 300);
+    bool caught = false;
+    try {
+      t.query(0, 0, first - 1);
+    } catch (runtime_error &) {
+      caught = true;
+    }
+    assert(caught || first == 0);
+  }
+}
+
+int main() {
+  int arr[5] = {6, -2, 1, 8, 10};
+  persistent_segment_tree<int> t(arr, arr + 5);
+  t.update(2, 3);
+  t.update(0, 4, 1);
+  for (int v = 0; v <= t.latest(); v++) {
+    cout << "Version " << v << ":";
+    for (int i = 0; i < t.size(); i++) {
+      cout << " " << t.at(i, v);
+    }
+    cout << endl;
+  }
+  assert(t.query(0, 3, 0) == -2 && t.query(0, 3) == -1);
+  assert(t.query(2, 4, 0) == 1 && t.query(2, 4, 1) == 4);
+  test_against_brute();
+
+  int n = 1 << 20, num_updates = 200000;
+  persistent_segment_tree<int> t2(n, 0);
+  clock_t start = clock();
+  long long sum = 0;
+  for (int k = 0; k < num_updates; k++) {
+    int lo = ((rand() & 0x7fff) << 15 ^ (rand() & 0x7fff)) % n;
+    int hi = ((rand() & 0x7fff) << 15 ^ (rand() & 0x7fff)) % n;
+    t2.update(min(lo, hi), max(lo, hi), rand() % 100);
+    sum += t2.query(min(lo, hi), max(lo, hi), rand() % (t2.latest() + 1));
+  }
+  cout << num_updates << " range updates and versioned queries: "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s (sum " << sum << ")"
+       << endl;
+  cout << "Nodes: " << t2.nodes();
+  start = clock();
+  t2.drop_versions_before(t2.latest() - 1000);
+  cout << ", " << t2.nodes() << " after dropping all but 1001 versions in "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s" << endl;
+  return 0;
+}
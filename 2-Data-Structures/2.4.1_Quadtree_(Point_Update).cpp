@@ -26,23 +26,183 @@ defined to return "v + d".
   value in the rectangular region consisting of rows from r1 to r2, inclusive,
   and columns from c1 to c2, inclusive.
 - update(r, c, d) assigns the value v at (r, c) to join_value_with_delta(v, d).
+- stats() returns a reference to the statistics policy object of the quadtree.
+
+Nodes are allocated through the policy Pool<node_t>, which must provide
+allocate() returning uninitialized storage for one node and deallocate(n). The
+default node_pool carves nodes out of large slabs, which avoids a call to the
+global allocator per node created by an update. new_allocator may be passed
+instead to allocate every node separately, or arena_allocator to bump allocate
+nodes from growing chunks. Nodes are only freed with the whole tree, whose
+height is at most about log2(max(MAXR, MAXC)) levels, so the destructor frees
+them recursively. The policy Stats receives a call to on_allocate() per node
+allocation and on_visit() per existing node visited by update() and query().
+Quadtrees do not rotate, so on_rotate() is never called. The default no_stats
+ignores these at no cost, while counting_stats accumulates them into counters
+that may be read and reset through stats() to profile individual operations.
+
+linear_quadtree is a pointer-free quadtree over rows and columns from 0 to
+2^30 - 1, built once from a set of updated entries. Each entry is keyed by the
+Morton (Z-order) code of its index, interleaving the bits of its row and column,
+so that every quadtree cell is a contiguous range of keys. The keys are stored
+in a sorted array, and their values are stored in the same order as the leaves
+of a bottom-up segment tree, using about 8 + 2*sizeof(T) bytes per entry. A
+query walks the cells intersecting the region from the root, locating the key
+range of each child cell by binary search within the range of its parent, and
+joins the values of every fully covered cell with the segment tree.
+- linear_quadtree(lo, hi, v) constructs a two-dimensional array with all values
+  initialized to v, then applies update(r, c, d) for each element ((r, c), d)
+  of a range [lo, hi) of std::pair given by two random-access iterators, in
+  order. The keys are sorted by a stable radix sort.
+- size() returns the number of distinct indices in the range.
+- at(r, c) and query(r1, c1, r2, c2) are analogous to those of quadtree.
+- count(r1, c1, r2, c2) returns the number of distinct indices in the range
+  that fall in the rectangular region.
+- update(r, c, d) is analogous to that of quadtree, but throws an exception if
+  (r, c) is not an index in the range given to the constructor.
 
 Time Complexity:
-- O(1) per call to the constructor.
-- O(max(MAXR, MAXC)) per call to at(), update(), and query().
+- O(1) per call to the constructor of quadtree.
+- O(max(MAXR, MAXC)) per call to at(), update(), and query() of quadtree.
+- O(n) per call to the constructor of linear_quadtree, where n is the number of
+  elements in the range.
+- O(1) per call to size().
+- O(log n) per call to at() and update() of linear_quadtree.
+- O(p log n) per call to query() and count() of linear_quadtree, where p is the
+  number of cells partially overlapping the region, which is O(2^30) but often
+  proportional to the perimeter of the region in the cells of the points.
 
 Space Complexity:
 - O(n) for storage of the array elements, where n is the number of updated
   entries in the array.
 - O(sqrt(max(MAXR, MAXC))) auxiliary stack space for update(), query(), and
-  at().
+  at() of quadtree.
+- O(n) auxiliary heap space for the constructor of linear_quadtree.
+- O(log n) auxiliary stack space for query() and count() of linear_quadtree.
+- O(1) auxiliary for all other operations.
 
 */
 
 #include <algorithm>
 #include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <vector>
 
-template<class T>
+// Default allocation policy, handing out nodes from slabs of SLAB_SIZE nodes
+// and recycling freed nodes through a free list. Slabs are only released when
+// the pool is destroyed.
+template<class Node>
+class node_pool {
+  static const int SLAB_SIZE = 1024;
+
+  std::vector<Node*> slabs, free_nodes;
+  int used;
+
+  node_pool(const node_pool &);
+  node_pool& operator=(const node_pool &);
+
+ public:
+  node_pool() : used(SLAB_SIZE) {}
+
+  ~node_pool() {
+    for (int i = 0; i < (int)slabs.size(); i++) {
+      ::operator delete(slabs[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (!free_nodes.empty()) {
+      Node *n = free_nodes.back();
+      free_nodes.pop_back();
+      return n;
+    }
+    if (used == SLAB_SIZE) {
+      void *slab = ::operator new(SLAB_SIZE*sizeof(Node));
+      slabs.push_back(static_cast<Node*>(slab));
+      used = 0;
+    }
+    return slabs.back() + used++;
+  }
+
+  void deallocate(Node *n) {
+    free_nodes.push_back(n);
+  }
+};
+
+// Alternative allocation policy, calling operator new and delete per node.
+template<class Node>
+struct new_allocator {
+  Node* allocate() {
+    return static_cast<Node*>(::operator new(sizeof(Node)));
+  }
+
+  void deallocate(Node *n) {
+    ::operator delete(n);
+  }
+};
+
+// Alternative allocation policy, handing out nodes from chunks of growing size
+// (up to MAX_CHUNK nodes) without ever reusing freed nodes. All storage is
+// released at once when the arena is destroyed, which suits quadtrees that are
+// built and then discarded as a whole.
+template<class Node>
+class arena_allocator {
+  static const int MAX_CHUNK = 65536;
+
+  std::vector<Node*> chunks;
+  int used, capacity;
+
+  arena_allocator(const arena_allocator &);
+  arena_allocator& operator=(const arena_allocator &);
+
+ public:
+  arena_allocator() : used(0), capacity(0) {}
+
+  ~arena_allocator() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+      ::operator delete(chunks[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (used == capacity) {
+      capacity = (capacity == 0) ? 16 : std::min(2*capacity, (int)MAX_CHUNK);
+      void *chunk = ::operator new(capacity*sizeof(Node));
+      chunks.push_back(static_cast<Node*>(chunk));
+      used = 0;
+    }
+    return chunks.back() + used++;
+  }
+
+  void deallocate(Node *) {}
+};
+
+// Default statistics policy, whose empty hooks compile away entirely.
+struct no_stats {
+  void on_allocate() {}
+  void on_rotate() {}
+  void on_visit() {}
+};
+
+// Alternative statistics policy, counting node allocations, rotations, and
+// nodes visited on search paths since construction or the last reset().
+struct counting_stats {
+  long long allocations, rotations, visits;
+
+  counting_stats() : allocations(0), rotations(0), visits(0) {}
+
+  void on_allocate() { allocations++; }
+  void on_rotate() { rotations++; }
+  void on_visit() { visits++; }
+
+  void reset() {
+    allocations = rotations = visits = 0;
+  }
+};
+
+template<class T, template<class> class Pool = node_pool,
+         class Stats = no_stats>
 class quadtree {
   static const int MAXR = 1000000000;
   static const int MAXC = 1000000000;
@@ -72,6 +232,18 @@ class quadtree {
 
   node_t *root;
   T init;
+  Pool<node_t> pool;
+  mutable Stats st;
+
+  node_t* create(const T &v) {
+    st.on_allocate();
+    return new (pool.allocate()) node_t(v);
+  }
+
+  void destroy(node_t *n) {
+    n->~node_t();
+    pool.deallocate(n);
+  }
 
   // Helper variables for query().
   int tgt_r1, tgt_c1, tgt_r2, tgt_c2;
@@ -90,6 +262,7 @@ class quadtree {
       found = true;
       return;
     }
+    st.on_visit();
     if (tgt_r1 <= r1 && r2 <= tgt_r2 && tgt_c1 <= c1 && c2 <= tgt_c2) {
       res = found ? join_values(res, n->value) : n->value;
       found = true;
@@ -108,7 +281,9 @@ class quadtree {
 
   void update(node_t *&n, int r1, int c1, int r2, int c2) {
     if (n == NULL) {
-      n = new node_t(join_region(init, (r2 - r1 + 1)*(c2 - r1 + 1)));
+      n = create(join_region(init, (r2 - r1 + 1)*(c2 - r1 + 1)));
+    } else {
+      st.on_visit();
     }
     if (tgt_r < r1 || tgt_r > r2 || tgt_c < c1 || tgt_c > c2) {
       return;
@@ -130,12 +305,12 @@ class quadtree {
     }
   }
 
-  static void clean_up(node_t *n) {
+  void clean_up(node_t *n) {
     if (n != NULL) {
       for (int i = 0; i < 4; i++) {
         clean_up(n->child[i]);
       }
-      delete n;
+      destroy(n);
     }
   }
 
@@ -166,21 +341,305 @@ class quadtree {
     delta = d;
     update(root, 0, 0, MAXR, MAXC);
   }
+
+  const Stats& stats() const {
+    return st;
+  }
+
+  Stats& stats() {
+    return st;
+  }
+};
+
+template<class T>
+class linear_quadtree {
+  static const int LEVELS = 30;
+
+  static T join_values(const T &a, const T &b) {
+    return std::min(a, b);
+  }
+
+  static T join_region(const T &v, long long area) {
+    return v;
+  }
+
+  static T join_value_with_delta(const T &v, const T &d) {
+    return d;
+  }
+
+  // Spreads the low 32 bits of x to the even bit positions of the result.
+  static unsigned long long spread(unsigned long long x) {
+    x &= 0xffffffffULL;
+    x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    x = (x | (x << 1)) & 0x5555555555555555ULL;
+    return x;
+  }
+
+  static unsigned long long morton(int r, int c) {
+    return (spread(r) << 1) | spread(c);
+  }
+
+  int n;
+  T init;
+  std::vector<unsigned long long> keys;
+  std::vector<T> tree;
+
+  // Sorts the keys with a stable least significant digit radix sort on 15 bits
+  // at a time, returning the permutation of indices that sorts them.
+  static std::vector<int> radix_sort(std::vector<unsigned long long> &k) {
+    int m = k.size();
+    std::vector<int> order(m), tmp_order(m);
+    std::vector<unsigned long long> tmp(m);
+    for (int i = 0; i < m; i++) {
+      order[i] = i;
+    }
+    for (int shift = 0; shift < 2*LEVELS; shift += 15) {
+      std::vector<int> count((1 << 15) + 1, 0);
+      for (int i = 0; i < m; i++) {
+        count[((k[i] >> shift) & 0x7fff) + 1]++;
+      }
+      for (int d = 0; d < (1 << 15); d++) {
+        count[d + 1] += count[d];
+      }
+      for (int i = 0; i < m; i++) {
+        int j = count[(k[i] >> shift) & 0x7fff]++;
+        tmp[j] = k[i];
+        tmp_order[j] = order[i];
+      }
+      k.swap(tmp);
+      order.swap(tmp_order);
+    }
+    return order;
+  }
+
+  // Returns the result of join_values() applied to the values of the points at
+  // sorted positions lo to hi, inclusive, from the bottom-up segment tree.
+  T range_value(int lo, int hi) const {
+    T left = tree[lo + n], right = tree[hi + n];
+    if (lo == hi) {
+      return left;
+    }
+    for (lo += n + 1, hi += n; lo < hi; lo /= 2, hi /= 2) {
+      if (lo % 2 == 1) {
+        left = join_values(left, tree[lo++]);
+      }
+      if (hi % 2 == 1) {
+        right = join_values(tree[--hi], right);
+      }
+    }
+    return join_values(left, right);
+  }
+
+  // Helper variables for query().
+  int tgt_r1, tgt_c1, tgt_r2, tgt_c2;
+  long long found;
+  T res;
+
+  // Visits the cell of side length 2^level at (r, c), whose points are at the
+  // sorted positions from lo to hi - 1 and have keys starting at base.
+  void query(int level, int r, int c, unsigned long long base, int lo,
+             int hi) {
+    int side = 1 << level;
+    if (lo == hi || tgt_r2 < r || r + side - 1 < tgt_r1 || tgt_c2 < c ||
+        c + side - 1 < tgt_c1) {
+      return;
+    }
+    if (tgt_r1 <= r && r + side - 1 <= tgt_r2 && tgt_c1 <= c &&
+        c + side - 1 <= tgt_c2) {
+      T v = range_value(lo, hi - 1);
+      res = (found > 0) ? join_values(res, v) : v;
+      found += hi - lo;
+      return;
+    }
+    int half = side / 2;
+    unsigned long long quarter = 1ULL << (2*level - 2);
+    for (int k = 0; k < 4; k++) {
+      unsigned long long b = base + k*quarter;
+      int l = std::lower_bound(keys.begin() + lo, keys.begin() + hi, b)
+              - keys.begin();
+      int h = std::lower_bound(keys.begin() + l, keys.begin() + hi,
+                               b + quarter) - keys.begin();
+      query(level - 1, r + (k >> 1)*half, c + (k & 1)*half, b, l, h);
+    }
+  }
+
+  int find(int r, int c) const {
+    unsigned long long key = morton(r, c);
+    int i = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+    return (i < n && keys[i] == key) ? i : -1;
+  }
+
+ public:
+  template<class It>
+  linear_quadtree(It lo, It hi, const T &v = T()) : init(v) {
+    std::vector<unsigned long long> k;
+    for (It it = lo; it != hi; ++it) {
+      k.push_back(morton(it->first.first, it->first.second));
+    }
+    std::vector<int> order = radix_sort(k);
+    // Points with equal keys are adjacent, in their original order.
+    std::vector<T> values;
+    for (int i = 0; i < (int)k.size(); i++) {
+      const T &d = (lo + order[i])->second;
+      if (i > 0 && k[i] == k[i - 1]) {
+        values.back() = join_value_with_delta(values.back(), d);
+      } else {
+        keys.push_back(k[i]);
+        values.push_back(join_value_with_delta(init, d));
+      }
+    }
+    n = keys.size();
+    tree.resize(2*n);
+    std::copy(values.begin(), values.end(), tree.begin() + n);
+    for (int i = n - 1; i > 0; i--) {
+      tree[i] = join_values(tree[2*i], tree[2*i + 1]);
+    }
+  }
+
+  int size() const {
+    return n;
+  }
+
+  T at(int r, int c) const {
+    int i = find(r, c);
+    return (i < 0) ? init : tree[i + n];
+  }
+
+  long long count(int r1, int c1, int r2, int c2) {
+    query(r1, c1, r2, c2);
+    return found;
+  }
+
+  T query(int r1, int c1, int r2, int c2) {
+    tgt_r1 = r1;
+    tgt_c1 = c1;
+    tgt_r2 = r2;
+    tgt_c2 = c2;
+    found = 0;
+    query(LEVELS, 0, 0, 0, 0, n);
+    long long area = (long long)(r2 - r1 + 1)*(c2 - c1 + 1);
+    if (found == area) {
+      return res;
+    }
+    T v = join_region(init, area - found);
+    return (found > 0) ? join_values(res, v) : v;
+  }
+
+  void update(int r, int c, const T &d) {
+    int i = find(r, c);
+    if (i < 0) {
+      throw std::runtime_error("Cannot update a point that was not built.");
+    }
+    i += n;
+    tree[i] = join_value_with_delta(tree[i], d);
+    for (i /= 2; i > 0; i /= 2) {
+      tree[i] = join_values(tree[2*i], tree[2*i + 1]);
+    }
+  }
 };
 
 /*** Example Usage and Output:
 
 Values:
-7 6 0
-5 4 0
-0 1 9
+7 6 0 
+5 4 0 
+0 1 9 
+quadtree: 262144 updates in 1.18658s
+linear_quadtree: built from 4194304 points in 0.581317s
+linear_quadtree: 10000 region counts in 0.438234s (8622207 points)
 
 ***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
+#include <vector>
 using namespace std;
 
+typedef pair<pair<int, int>, int> entry;
+
+int rand30() {
+  return ((rand() & 0x7fff) << 15) ^ (rand() & 0x7fff);
+}
+
+void test_linear_quadtree() {
+  for (int side = 1; side <= 40; side += 13) {
+    vector<entry> e;
+    vector<vector<int> > a(side, vector<int>(side, 50));
+    for (int k = 0; k < side*side/2 + 1; k++) {
+      int r = rand() % side, c = rand() % side, v = rand() % 100;
+      e.push_back(make_pair(make_pair(r, c), v));
+      a[r][c] = v;
+    }
+    linear_quadtree<int> t(e.begin(), e.end(), 50);
+    quadtree<int> t2(50);
+    for (int k = 0; k < (int)e.size(); k++) {
+      t2.update(e[k].first.first, e[k].first.second, e[k].second);
+    }
+    for (int k = 0; k < 200; k++) {
+      int r = rand() % side, c = rand() % side, v = rand() % 100;
+      if (k % 2 == 0 && a[r][c] != 50) {
+        a[r][c] = v;
+        t.update(r, c, v);
+        t2.update(r, c, v);
+      }
+      int r1 = rand() % side, r2 = rand() % side;
+      int c1 = rand() % side, c2 = rand() % side;
+      if (r1 > r2) {
+        swap(r1, r2);
+      }
+      if (c1 > c2) {
+        swap(c1, c2);
+      }
+      int res = a[r1][c1];
+      for (int i = r1; i <= r2; i++) {
+        for (int j = c1; j <= c2; j++) {
+          res = min(res, a[i][j]);
+        }
+      }
+      assert(t.query(r1, c1, r2, c2) == res);
+      assert(t2.query(r1, c1, r2, c2) == res);
+      assert(t.at(r, c) == a[r][c]);
+    }
+    // A region extending beyond all points includes initialized values.
+    assert(t.query(0, 0, 1000000000, 1000000000) == min(50, t.query(0, 0,
+                                                           side, side)));
+    assert(t.count(0, 0, side - 1, side - 1) == t.size());
+  }
+}
+
+void benchmark(int n, int num_queries) {
+  vector<entry> e(n);
+  for (int i = 0; i < n; i++) {
+    e[i] = make_pair(make_pair(rand30(), rand30()), rand());
+  }
+  clock_t start = clock();
+  quadtree<int> t1(0);
+  for (int i = 0; i < n/16; i++) {
+    t1.update(e[i].first.first, e[i].first.second, e[i].second);
+  }
+  double pointer_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  linear_quadtree<int> t2(e.begin(), e.end());
+  double linear_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  long long total = 0;
+  for (int k = 0; k < num_queries; k++) {
+    int r = rand30(), c = rand30(), side = 1 << (20 + rand() % 6);
+    total += t2.count(r, c, r + side, c + side);
+  }
+  double query_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  cout << "quadtree: " << n/16 << " updates in " << pointer_time << "s"
+       << endl << "linear_quadtree: built from " << n << " points in "
+       << linear_time << "s" << endl << "linear_quadtree: " << num_queries
+       << " region counts in " << query_time << "s (" << total << " points)"
+       << endl;
+}
+
 int main() {
   quadtree<int> t(0);
   t.update(0, 0, 7);
@@ -202,5 +661,22 @@ int main() {
   assert(t.query(0, 0, 1000000000, 1000000000) == 0);
   t.update(500000000, 500000000, -100);
   assert(t.query(0, 0, 1000000000, 1000000000) == -100);
+
+  // Allocation policies and operation statistics.
+  quadtree<int, arena_allocator, counting_stats> profiled(0);
+  profiled.update(3, 4, 5);
+  long long path = profiled.stats().allocations;
+  // Each level of the path to the cell creates all four children.
+  assert(path > 1 && path % 4 == 1);
+  profiled.update(3, 4, 2);
+  assert(profiled.stats().allocations == path);
+  profiled.stats().reset();
+  assert(profiled.at(3, 4) == 2 && profiled.stats().visits > 0);
+  assert(profiled.stats().rotations == 0);
+  quadtree<int, new_allocator> separate(0);
+  separate.update(7, 7, -1);
+  assert(separate.query(0, 0, 9, 9) == -1 && separate.at(9, 9) == 0);
+  test_linear_quadtree();
+  benchmark(1 << 22, 10000);
   return 0;
 }
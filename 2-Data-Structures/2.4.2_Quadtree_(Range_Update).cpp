@@ -37,6 +37,20 @@ join_deltas(d1, d2) should be defined to return "d1 + d2".
 - update(r1, c1, r2, c2) modifies the value at each index of the rectangular
   region consisting of rows from r1 to r2 and columns from c1 to c2, inclusive,
   by respectively joining them with d using join_value_with_delta().
+- stats() returns a reference to the statistics policy object of the quadtree.
+
+Nodes are allocated through the policy Pool<node_t>, which must provide
+allocate() returning uninitialized storage for one node and deallocate(n). The
+default node_pool carves nodes out of large slabs, which avoids a call to the
+global allocator per node created by an update. new_allocator may be passed
+instead to allocate every node separately, or arena_allocator to bump allocate
+nodes from growing chunks. Nodes are only freed with the whole tree, whose
+height is at most about log2(max(MAXR, MAXC)) levels, so the destructor frees
+them recursively. The policy Stats receives a call to on_allocate() per node
+allocation and on_visit() per existing node visited by update() and query().
+Quadtrees do not rotate, so on_rotate() is never called. The default no_stats
+ignores these at no cost, while counting_stats accumulates them into counters
+that may be read and reset through stats() to profile individual operations.
 
 Time Complexity:
 - O(1) per call to the constructor.
@@ -45,15 +59,130 @@ Time Complexity:
 Space Complexity:
 - O(n) for storage of the array elements, where n is the number of updated
   entries in the array.
-- O(sqrt(max(MAXR, MAXC))) auxiliary stack space for update(), query(), and
-  at().
+- O(sqrt(max(MAXR, MAXC))) auxiliary stack space for update(), query(), at(),
+  and destruction.
 
 */
 
 #include <algorithm>
 #include <cstddef>
+#include <new>
+#include <vector>
 
-template<class T>
+// Default allocation policy, handing out nodes from slabs of SLAB_SIZE nodes
+// and recycling freed nodes through a free list. Slabs are only released when
+// the pool is destroyed.
+template<class Node>
+class node_pool {
+  static const int SLAB_SIZE = 1024;
+
+  std::vector<Node*> slabs, free_nodes;
+  int used;
+
+  node_pool(const node_pool &);
+  node_pool& operator=(const node_pool &);
+
+ public:
+  node_pool() : used(SLAB_SIZE) {}
+
+  ~node_pool() {
+    for (int i = 0; i < (int)slabs.size(); i++) {
+      ::operator delete(slabs[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (!free_nodes.empty()) {
+      Node *n = free_nodes.back();
+      free_nodes.pop_back();
+      return n;
+    }
+    if (used == SLAB_SIZE) {
+      void *slab = ::operator new(SLAB_SIZE*sizeof(Node));
+      slabs.push_back(static_cast<Node*>(slab));
+      used = 0;
+    }
+    return slabs.back() + used++;
+  }
+
+  void deallocate(Node *n) {
+    free_nodes.push_back(n);
+  }
+};
+
+// Alternative allocation policy, calling operator new and delete per node.
+template<class Node>
+struct new_allocator {
+  Node* allocate() {
+    return static_cast<Node*>(::operator new(sizeof(Node)));
+  }
+
+  void deallocate(Node *n) {
+    ::operator delete(n);
+  }
+};
+
+// Alternative allocation policy, handing out nodes from chunks of growing size
+// (up to MAX_CHUNK nodes) without ever reusing freed nodes. All storage is
+// released at once when the arena is destroyed, which suits quadtrees that are
+// built and then discarded as a whole.
+template<class Node>
+class arena_allocator {
+  static const int MAX_CHUNK = 65536;
+
+  std::vector<Node*> chunks;
+  int used, capacity;
+
+  arena_allocator(const arena_allocator &);
+  arena_allocator& operator=(const arena_allocator &);
+
+ public:
+  arena_allocator() : used(0), capacity(0) {}
+
+  ~arena_allocator() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+      ::operator delete(chunks[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (used == capacity) {
+      capacity = (capacity == 0) ? 16 : std::min(2*capacity, (int)MAX_CHUNK);
+      void *chunk = ::operator new(capacity*sizeof(Node));
+      chunks.push_back(static_cast<Node*>(chunk));
+      used = 0;
+    }
+    return chunks.back() + used++;
+  }
+
+  void deallocate(Node *) {}
+};
+
+// Default statistics policy, whose empty hooks compile away entirely.
+struct no_stats {
+  void on_allocate() {}
+  void on_rotate() {}
+  void on_visit() {}
+};
+
+// Alternative statistics policy, counting node allocations, rotations, and
+// nodes visited on search paths since construction or the last reset().
+struct counting_stats {
+  long long allocations, rotations, visits;
+
+  counting_stats() : allocations(0), rotations(0), visits(0) {}
+
+  void on_allocate() { allocations++; }
+  void on_rotate() { rotations++; }
+  void on_visit() { visits++; }
+
+  void reset() {
+    allocations = rotations = visits = 0;
+  }
+};
+
+template<class T, template<class> class Pool = node_pool,
+         class Stats = no_stats>
 class quadtree {
   static const int MAXR = 1000000000;
   static const int MAXC = 1000000000;
@@ -87,10 +216,22 @@ class quadtree {
   } *root;
 
   T init;
+  Pool<node_t> pool;
+  mutable Stats st;
+
+  node_t* create(const T &v) {
+    st.on_allocate();
+    return new (pool.allocate()) node_t(v);
+  }
+
+  void destroy(node_t *n) {
+    n->~node_t();
+    pool.deallocate(n);
+  }
 
   void update_delta(node_t *&n, const T &d, int area) {
     if (n == NULL) {
-      n = new node_t(join_region(init, area));
+      n = create(join_region(init, area));
     }
     n->delta = n->pending ? join_deltas(n->delta, d) : d;
     n->pending = true;
@@ -130,6 +271,7 @@ class quadtree {
       found = true;
       return;
     }
+    st.on_visit();
     push_delta(n, r1, c1, r2, c2);
     if (tgt_r1 <= r1 && r2 <= tgt_r2 && tgt_c1 <= c1 && c2 <= tgt_c2) {
       res = found ? join_values(res, n->value) : n->value;
@@ -145,7 +287,9 @@ class quadtree {
 
   void update(node_t *&n, int r1, int c1, int r2, int c2) {
     if (n == NULL) {
-      n = new node_t(join_region(init, (r2 - r1 + 1)*(c2 - r1 + 1)));
+      n = create(join_region(init, (r2 - r1 + 1)*(c2 - r1 + 1)));
+    } else {
+      st.on_visit();
     }
     if (tgt_r2 < r1 || tgt_r1 > r2 || tgt_c2 < c1 || tgt_c1 > c2) {
       return;
@@ -168,12 +312,12 @@ class quadtree {
     }
   }
 
-  static void clean_up(node_t *n) {
+  void clean_up(node_t *n) {
     if (n != NULL) {
       for (int i = 0; i < 4; i++) {
         clean_up(n->child[i]);
       }
-      delete n;
+      destroy(n);
     }
   }
 
@@ -210,6 +354,14 @@ public:
     delta = d;
     update(root, 0, 0, MAXR, MAXC);
   }
+
+  const Stats& stats() const {
+    return st;
+  }
+
+  Stats& stats() {
+    return st;
+  }
 };
 
 /*** Example Usage and Output:
@@ -246,5 +398,20 @@ int main() {
   assert(t.query(0, 0, 1000000000, 1000000000) == 0);
   t.update(500000000, 500000000, -100);
   assert(t.query(0, 0, 1000000000, 1000000000) == -100);
+
+  // Allocation policies and operation statistics.
+  quadtree<int, arena_allocator, counting_stats> profiled(0);
+  profiled.update(3, 4, 5);
+  long long path = profiled.stats().allocations;
+  // Each level of the path to the cell creates all four children.
+  assert(path > 1 && path % 4 == 1);
+  profiled.update(3, 4, 2);
+  assert(profiled.stats().allocations == path);
+  profiled.stats().reset();
+  assert(profiled.at(3, 4) == 2 && profiled.stats().visits > 0);
+  assert(profiled.stats().rotations == 0);
+  quadtree<int, new_allocator> separate(0);
+  separate.update(5, 5, 7, 7, -1);
+  assert(separate.query(0, 0, 9, 9) == -1 && separate.at(9, 9) == 0);
   return 0;
 }
@@ -10,19 +10,66 @@ integer points and long doubles for intermediate calculations.
   as close or closer to (x, y) by Euclidean distance than any point on any
   other segment in the set.
 
+str_rtree is a static R-tree over a set of axis-aligned boxes with integer
+coordinates, bulk loaded by Sort-Tile-Recursive (STR) packing. Each level is
+built by sorting its entries by the x-coordinates of their centers, cutting them
+into about sqrt(P) vertical slices, where P is the number of nodes the level
+needs, and then sorting each slice by y and filling nodes in order. Every node
+occupies one page of PAGE_SIZE bytes and refers to its children by page number,
+so the whole tree is a flat image that can be written to a file and later
+memory-mapped and queried in place, without being rebuilt.
+- str_rtree(lo, hi) constructs a tree from two forward iterators to box as a
+  range [lo, hi), where each box is identified by its zero-based index in the
+  range. The corners of a box may be given in either order.
+- str_rtree(data, bytes) views an image of the given size in bytes, as returned
+  by data() and bytes() of a tree that was built before, without copying it.
+  The image must remain valid and be at least 4-byte aligned for as long as the
+  tree is used. An exception is thrown if the image is not valid.
+- data() and bytes() return the image of the tree and its size in bytes.
+- size() returns the number of boxes in the tree.
+- height() returns the number of levels of the tree.
+- intersecting(b, f) calls f(i, b2) for the id i and box b2 of each box in the
+  tree which intersects box b, including on its boundary.
+- contained(b, f) calls f(i, b2) for each box in the tree which lies inside b.
+- nearest(x, y, k, out, dist) sets out to the ids of the k boxes that are
+  closest to (x, y) in order of increasing distance (or all boxes, if there are
+  fewer than k) and then of increasing id, searching nodes best first with a
+  priority queue while keeping the k closest boxes in a max-heap. The function
+  dist(i, b, x, y) must return the exact squared distance of the object with id
+  i and bounding box b to (x, y), such as the distance to a segment inside the
+  box, which must not be less than the squared distance from (x, y) to b. If
+  dist is omitted, the squared distance to the box itself is used.
+
 Time Complexity:
-- O(n log n) per call to the constructor, where n is the number of segments.
-- O(log n) on average per call to nearest().
+- O(n log n) per call to the r_tree constructor, where n is the number of
+  segments.
+- O(log n) on average per call to nearest() of r_tree.
+- O(n log n) per call to the first str_rtree constructor, where n is the number
+  of boxes.
+- O(1) per call to the second str_rtree constructor, data(), bytes(), size(),
+  and height().
+- O(B log_B(n) + m) on average per call to intersecting() and contained(), where
+  B is the number of entries per page and m is the number of boxes reported,
+  for boxes that do not overlap much.
+- O(B (log_B(n) + k) log n) on average per call to nearest() of str_rtree.
 
 Space Complexity:
-- O(n) for storage of the segments.
-- O(log n) auxiliary stack space for nearest().
+- O(n) for storage of the segments of r_tree.
+- O(log n) auxiliary stack space for nearest() of r_tree.
+- O(n) for storage of the boxes of str_rtree, in about n/B + n/B^2 + ... pages.
+- O(B log_B(n)) auxiliary space for intersecting() and contained().
+- O(B (log_B(n) + k) log n) auxiliary space for nearest() of str_rtree.
 
 */
 
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
 #include <limits>
+#include <queue>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 struct segment {
@@ -144,11 +191,411 @@ class r_tree {
   }
 };
 
-/*** Example Usage ***/
+struct box {
+  int x1, y1, x2, y2;
+
+  box() : x1(0), y1(0), x2(0), y2(0) {}
+  box(int x1, int y1, int x2, int y2) : x1(x1), y1(y1), x2(x2), y2(y2) {}
+
+  bool operator==(const box &b) const {
+    return (x1 == b.x1) && (y1 == b.y1) && (x2 == b.x2) && (y2 == b.y2);
+  }
+};
+
+class str_rtree {
+ public:
+  static const int PAGE_SIZE = 4096;
+
+ private:
+  static const int MAGIC = 0x52545245;
+
+  // A child page or a box id, along with its bounding box.
+  struct entry_t {
+    int x1, y1, x2, y2, ref;
+  };
+
+  static const int CAPACITY = (PAGE_SIZE - 2*sizeof(int))/sizeof(entry_t);
+
+  struct node_t {
+    int count, leaf;
+    entry_t entry[CAPACITY];
+  };
+
+  // Page 0 of the image holds the header, followed by the nodes.
+  struct header_t {
+    int magic, num_pages, root, height, size;
+  };
+
+  // Either the image is owned by buffer, or it is viewed at external.
+  std::vector<char> buffer;
+  const char *external;
+
+  const char* image() const {
+    return external != NULL ? external : &buffer[0];
+  }
+
+  const header_t& header() const {
+    return *reinterpret_cast<const header_t*>(image());
+  }
+
+  const node_t& node(int i) const {
+    return *reinterpret_cast<const node_t*>(image() + (size_t)i*PAGE_SIZE);
+  }
+
+  static long long center_x(const entry_t &e) {
+    return (long long)e.x1 + e.x2;
+  }
+
+  static long long center_y(const entry_t &e) {
+    return (long long)e.y1 + e.y2;
+  }
+
+  static bool cmp_x(const entry_t &a, const entry_t &b) {
+    return center_x(a) < center_x(b);
+  }
+
+  static bool cmp_y(const entry_t &a, const entry_t &b) {
+    return center_y(a) < center_y(b);
+  }
+
+  static bool intersects(const entry_t &e, const box &b) {
+    return e.x1 <= b.x2 && b.x1 <= e.x2 && e.y1 <= b.y2 && b.y1 <= e.y2;
+  }
+
+  static bool contains(const box &b, const entry_t &e) {
+    return b.x1 <= e.x1 && e.x2 <= b.x2 && b.y1 <= e.y1 && e.y2 <= b.y2;
+  }
+
+  static double box_distance(const entry_t &e, int x, int y) {
+    long long dx = (x < e.x1) ? (long long)e.x1 - x
+                              : (x > e.x2 ? (long long)x - e.x2 : 0);
+    long long dy = (y < e.y1) ? (long long)e.y1 - y
+                              : (y > e.y2 ? (long long)y - e.y2 : 0);
+    return (double)(dx*dx + dy*dy);
+  }
+
+  struct default_distance {
+    double operator()(int i, const box &b, int x, int y) const {
+      entry_t e = {b.x1, b.y1, b.x2, b.y2, i};
+      return box_distance(e, x, y);
+    }
+  };
+
+  // Sort-Tile-Recursive packing of one level: the entries are sorted by x
+  // into ceil(sqrt(P)) vertical slices, where P is the number of nodes to
+  // fill, and each slice is sorted by y and cut into runs of CAPACITY.
+  std::vector<entry_t> pack(std::vector<entry_t> &v, bool leaf) {
+    int n = v.size();
+    int pages = (n + CAPACITY - 1)/CAPACITY;
+    int slices = (int)std::ceil(std::sqrt((double)pages));
+    int slice_size = ((pages + slices - 1)/slices)*CAPACITY;
+    std::sort(v.begin(), v.end(), cmp_x);
+    std::vector<entry_t> parents;
+    for (int lo = 0; lo < n; lo += slice_size) {
+      int hi = std::min(lo + slice_size, n);
+      std::sort(v.begin() + lo, v.begin() + hi, cmp_y);
+      for (int i = lo; i < hi; i += CAPACITY) {
+        int count = (hi - i < CAPACITY) ? hi - i : CAPACITY;
+        buffer.resize(buffer.size() + PAGE_SIZE);
+        node_t &p = *reinterpret_cast<node_t*>(&buffer[buffer.size() -
+                                                       PAGE_SIZE]);
+        p.count = count;
+        p.leaf = leaf;
+        entry_t parent = v[i];
+        parent.ref = buffer.size()/PAGE_SIZE - 1;
+        for (int j = 0; j < count; j++) {
+          const entry_t &e = p.entry[j] = v[i + j];
+          parent.x1 = std::min(parent.x1, e.x1);
+          parent.y1 = std::min(parent.y1, e.y1);
+          parent.x2 = std::max(parent.x2, e.x2);
+          parent.y2 = std::max(parent.y2, e.y2);
+        }
+        parents.push_back(parent);
+      }
+    }
+    return parents;
+  }
+
+  template<class ReportFunction>
+  void query(const box &b, bool contained, ReportFunction f) const {
+    if (header().root == 0) {
+      return;
+    }
+    std::vector<int> stack(1, header().root);
+    while (!stack.empty()) {
+      const node_t &p = node(stack.back());
+      stack.pop_back();
+      for (int i = 0; i < p.count; i++) {
+        const entry_t &e = p.entry[i];
+        if (!intersects(e, b)) {
+          continue;
+        }
+        if (!p.leaf) {
+          stack.push_back(e.ref);
+        } else if (!contained || contains(b, e)) {
+          f(e.ref, box(e.x1, e.y1, e.x2, e.y2));
+        }
+      }
+    }
+  }
+
+ public:
+  template<class It>
+  str_rtree(It lo, It hi) : buffer(PAGE_SIZE), external(NULL) {
+    std::vector<entry_t> level;
+    for (It it = lo; it != hi; ++it) {
+      entry_t e = {std::min(it->x1, it->x2), std::min(it->y1, it->y2),
+                   std::max(it->x1, it->x2), std::max(it->y1, it->y2),
+                   (int)level.size()};
+      level.push_back(e);
+    }
+    header_t h = {MAGIC, 0, 0, 0, (int)level.size()};
+    for (bool leaf = true; !level.empty(); leaf = false) {
+      level = pack(level, leaf);
+      h.height++;
+      if (level.size() == 1) {
+        h.root = level[0].ref;
+        break;
+      }
+    }
+    h.num_pages = buffer.size()/PAGE_SIZE;
+    *reinterpret_cast<header_t*>(&buffer[0]) = h;
+  }
+
+  // Views an image previously returned by data(), without copying it.
+  str_rtree(const char *data, size_t bytes) : external(data) {
+    if (bytes < (size_t)PAGE_SIZE || header().magic != MAGIC ||
+        (size_t)header().num_pages*PAGE_SIZE != bytes) {
+      throw std::runtime_error("Invalid R-tree image.");
+    }
+  }
+
+  const char* data() const {
+    return image();
+  }
+
+  size_t bytes() const {
+    return (size_t)header().num_pages*PAGE_SIZE;
+  }
+
+  int size() const {
+    return header().size;
+  }
+
+  int height() const {
+    return header().height;
+  }
+
+  template<class ReportFunction>
+  void intersecting(const box &b, ReportFunction f) const {
+    query(b, false, f);
+  }
+
+  template<class ReportFunction>
+  void contained(const box &b, ReportFunction f) const {
+    query(b, true, f);
+  }
+
+  template<class DistanceFunction>
+  void nearest(int x, int y, int k, std::vector<int> &out,
+               DistanceFunction dist) const {
+    out.clear();
+    if (header().root == 0 || k <= 0) {
+      return;
+    }
+    // Nodes are searched best first by the distance to their bounding boxes,
+    // which is a lower bound for the exact distance of any box inside them.
+    // The k closest boxes found so far are kept in a max-heap of (distance,
+    // id), and nothing farther than the k-th of them is ever expanded.
+    typedef std::pair<double, int> item;
+    std::priority_queue<item, std::vector<item>, std::greater<item> > q;
+    std::vector<item> best;
+    q.push(item(0, header().root));
+    while (!q.empty()) {
+      item top = q.top();
+      q.pop();
+      if ((int)best.size() == k && top.first > best.front().first) {
+        break;
+      }
+      const node_t &p = node(top.second);
+      for (int i = 0; i < p.count; i++) {
+        const entry_t &e = p.entry[i];
+        double d = box_distance(e, x, y);
+        if ((int)best.size() == k && d > best.front().first) {
+          continue;
+        }
+        if (!p.leaf) {
+          q.push(item(d, e.ref));
+          continue;
+        }
+        item b(dist(e.ref, box(e.x1, e.y1, e.x2, e.y2), x, y), e.ref);
+        if ((int)best.size() < k) {
+          best.push_back(b);
+          std::push_heap(best.begin(), best.end());
+        } else if (b < best.front()) {
+          std::pop_heap(best.begin(), best.end());
+          best.back() = b;
+          std::push_heap(best.begin(), best.end());
+        }
+      }
+    }
+    std::sort_heap(best.begin(), best.end());
+    for (int i = 0; i < (int)best.size(); i++) {
+      out.push_back(best[i].second);
+    }
+  }
+
+  void nearest(int x, int y, int k, std::vector<int> &out) const {
+    nearest(x, y, k, out, default_distance());
+  }
+};
+
+/*** Example Usage and Output:
+
+1000000 segments, 100000 nearest segment queries:
+  r_tree: build 0.366219s, queries 0.109458s
+  str_rtree: build 0.250109s, queries 1.21116s, 4929 pages, height 3
+  str_rtree from image: 1e-06s
+
+***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
 using namespace std;
 
+struct collector {
+  vector<int> *found;
+
+  collector(vector<int> *found) : found(found) {}
+
+  void operator()(int i, const box &b) {
+    found->push_back(i);
+  }
+};
+
+int rand_coord(int range) {
+  return (((rand() & 0x7fff) << 15) ^ (rand() & 0x7fff)) % range;
+}
+
+struct segment_distance {
+  const vector<segment> *s;
+
+  segment_distance(const vector<segment> *s) : s(s) {}
+
+  double operator()(int i, const box &b, int x, int y) const {
+    const segment &t = (*s)[i];
+    long long dx = t.x2 - t.x1, dy = t.y2 - t.y1;
+    long long px = x - t.x1, py = y - t.y1;
+    long long sqdist = dx*dx + dy*dy, dot = dx*px + dy*py;
+    if (dot <= 0 || sqdist == 0) {
+      return px*px + py*py;
+    }
+    if (dot >= sqdist) {
+      return (px - dx)*(px - dx) + (py - dy)*(py - dy);
+    }
+    double q = (double)dot / sqdist;
+    return (px - q*dx)*(px - q*dx) + (py - q*dy)*(py - q*dy);
+  }
+};
+
+void test_str_rtree(int n, int range) {
+  vector<box> boxes;
+  for (int i = 0; i < n; i++) {
+    int x = rand_coord(range), y = rand_coord(range);
+    boxes.push_back(box(x, y, x + rand_coord(range/10 + 1),
+                        y - rand_coord(range/10 + 1)));
+  }
+  str_rtree built(boxes.begin(), boxes.end());
+  vector<char> image(built.data(), built.data() + built.bytes());
+  str_rtree t(&image[0], image.size());
+  assert(t.size() == n && t.height() == built.height());
+  for (int k = 0; k < 100; k++) {
+    int x1 = rand_coord(range), x2 = rand_coord(range);
+    int y1 = rand_coord(range), y2 = rand_coord(range);
+    box q(min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2));
+    vector<int> found, found2, expected, expected2;
+    t.intersecting(q, collector(&found));
+    t.contained(q, collector(&found2));
+    vector<pair<double, int> > by_dist;
+    for (int i = 0; i < n; i++) {
+      int bx1 = boxes[i].x1, bx2 = boxes[i].x2;
+      int by1 = boxes[i].y2, by2 = boxes[i].y1;
+      if (bx1 <= q.x2 && q.x1 <= bx2 && by1 <= q.y2 && q.y1 <= by2) {
+        expected.push_back(i);
+      }
+      if (q.x1 <= bx1 && bx2 <= q.x2 && q.y1 <= by1 && by2 <= q.y2) {
+        expected2.push_back(i);
+      }
+      long long dx = max(0LL, max((long long)bx1 - x1, (long long)x1 - bx2));
+      long long dy = max(0LL, max((long long)by1 - y1, (long long)y1 - by2));
+      by_dist.push_back(make_pair((double)(dx*dx + dy*dy), i));
+    }
+    sort(found.begin(), found.end());
+    sort(found2.begin(), found2.end());
+    assert(found == expected && found2 == expected2);
+    sort(by_dist.begin(), by_dist.end());
+    vector<int> res;
+    t.nearest(x1, y1, 5, res);
+    assert((int)res.size() == min(n, 5));
+    for (int j = 0; j < (int)res.size(); j++) {
+      assert(res[j] == by_dist[j].second);
+    }
+  }
+  image[0] ^= 1;
+  try {
+    str_rtree bad(&image[0], image.size());
+    assert(false);
+  } catch (runtime_error &) {}
+}
+
+void benchmark(int n, int num_queries) {
+  vector<segment> s;
+  vector<box> boxes;
+  for (int i = 0; i < n; i++) {
+    int x = rand_coord(1000000000), y = rand_coord(1000000000);
+    s.push_back(segment(x, y, x + rand_coord(100000), y + rand_coord(100000)));
+    boxes.push_back(box(s[i].x1, s[i].y1, s[i].x2, s[i].y2));
+  }
+  clock_t start = clock();
+  r_tree t1(s.begin(), s.end());
+  double t1_build = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  str_rtree t2(boxes.begin(), boxes.end());
+  double t2_build = (double)(clock() - start)/CLOCKS_PER_SEC;
+  vector<int> qx(num_queries), qy(num_queries), res;
+  for (int i = 0; i < num_queries; i++) {
+    qx[i] = rand_coord(1000000000);
+    qy[i] = rand_coord(1000000000);
+  }
+  start = clock();
+  long long sum1 = 0, sum2 = 0;
+  for (int i = 0; i < num_queries; i++) {
+    sum1 += t1.nearest(qx[i], qy[i]).x1;
+  }
+  double t1_query = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  segment_distance dist(&s);
+  for (int i = 0; i < num_queries; i++) {
+    t2.nearest(qx[i], qy[i], 1, res, dist);
+    sum2 += s[res[0]].x1;
+  }
+  double t2_query = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  str_rtree t3(t2.data(), t2.bytes());
+  double t3_load = (double)(clock() - start)/CLOCKS_PER_SEC;
+  assert(sum1 == sum2 && t3.size() == n);
+  cout << n << " segments, " << num_queries << " nearest segment queries:"
+       << endl;
+  cout << "  r_tree: build " << t1_build << "s, queries " << t1_query << "s"
+       << endl;
+  cout << "  str_rtree: build " << t2_build << "s, queries " << t2_query
+       << "s, " << t2.bytes() / 4096 << " pages, height " << t2.height()
+       << endl;
+  cout << "  str_rtree from image: " << t3_load << "s" << endl;
+}
+
 int main() {
   segment s[4];
   s[0] = segment(0, 0, 0, 4);
@@ -158,5 +605,11 @@ int main() {
   r_tree t(s, s + 4);
   assert(t.nearest(-1, 2) == segment(0, 0, 0, 4));
   assert(t.nearest(100, 100) == segment(4, 4, 4, 0));
+  for (int n = 0; n <= 1000; n += (n < 10) ? 1 : 330) {
+    test_str_rtree(n, 100);
+    test_str_rtree(n, 1000000000);
+  }
+  test_str_rtree(100000, 1000000);
+  benchmark(1000000, 100000);
   return 0;
 }
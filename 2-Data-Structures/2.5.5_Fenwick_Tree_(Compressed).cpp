@@ -14,18 +14,41 @@ inclusive, are accessible.
 - sum(hi) returns the sum of all values at indices from 0 to hi, inclusive.
 - sum(lo, hi) returns the sum of all values at indices from lo to hi, inclusive.
 
+offline_fenwick_tree supports the same operations when every index that will be
+updated is known in advance, storing the tree in flat arrays instead of a map.
+Updates only ever touch the nodes of the Fenwick tree over the sorted, distinct
+endpoints of all updates. Since each sum is a linear function of the queried
+index between consecutive endpoints, sum() may be queried at any index, with
+the prefix of the tree determined by a binary search over the endpoints.
+- reserve(i) registers index i for later calls to add(i, x) and set(i, x).
+- reserve(lo, hi) registers the range from lo to hi, inclusive, for later calls
+  to add(lo, hi, x).
+- build() allocates the tree over all registered indices. It must be called
+  after all calls to reserve() and before any other operation.
+- add(), set(), sum(), and at() behave as above, where add() and set() throw an
+  exception if their indices were not registered.
+
 Time Complexity:
-- O(log^2 MAXN) per call to all member functions. If std::map is replaced with
-  std::unordered_map, then the amortized running time will become O(log MAXN).
+- O(log^2 MAXN) per call to all member functions of fenwick_tree. If std::map is
+  replaced with std::unordered_map, then the amortized running time will become
+  O(log MAXN).
+- O(1) amortized per call to reserve() of offline_fenwick_tree.
+- O(m log m) per call to build() of offline_fenwick_tree, where m is the number
+  of calls to reserve().
+- O(log m) per call to all other member functions of offline_fenwick_tree.
 
 Space Complexity:
 - O(n log MAXN) for storage of the array elements, where n is the number of
   distinct indices that have been accessed across all of the operations so far.
+- O(m) for storage of offline_fenwick_tree.
 - O(1) auxiliary for all operations.
 
 */
 
+#include <algorithm>
 #include <map>
+#include <stdexcept>
+#include <vector>
 
 template<class T>
 class fenwick_tree {
@@ -75,16 +98,129 @@ class fenwick_tree {
   }
 };
 
+template<class T>
+class offline_fenwick_tree {
+  std::vector<int> keys;
+  std::vector<T> tmul, tadd;
+
+  int find(int i) const {
+    std::vector<int>::const_iterator it =
+        std::lower_bound(keys.begin(), keys.end(), i);
+    if (it == keys.end() || *it != i) {
+      throw std::runtime_error("Index was not reserved.");
+    }
+    return it - keys.begin();
+  }
+
+  void add_helper(int k, const T &mul, const T &add) {
+    int n = keys.size();
+    for (int i = k + 1; i <= n; i += i & -i) {
+      tmul[i] += mul;
+      tadd[i] += add;
+    }
+  }
+
+ public:
+  void reserve(int lo, int hi) {
+    keys.push_back(lo);
+    keys.push_back(hi);
+  }
+
+  void reserve(int i) {
+    reserve(i, i);
+  }
+
+  void build() {
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    tmul.assign(keys.size() + 1, 0);
+    tadd.assign(keys.size() + 1, 0);
+  }
+
+  void add(int lo, int hi, const T &x) {
+    int klo = find(lo), khi = find(hi);
+    add_helper(klo, x, -x*(lo - 1));
+    add_helper(khi, -x, x*hi);
+  }
+
+  void add(int i, const T &x) {
+    add(i, i, x);
+  }
+
+  void set(int i, const T &x) {
+    add(i, x - at(i));
+  }
+
+  T sum(int hi) const {
+    T mul = 0, add = 0;
+    int i = std::upper_bound(keys.begin(), keys.end(), hi) - keys.begin();
+    for (; i > 0; i -= i & -i) {
+      mul += tmul[i];
+      add += tadd[i];
+    }
+    return mul*hi + add;
+  }
+
+  T sum(int lo, int hi) const {
+    return sum(hi) - sum(lo - 1);
+  }
+
+  T at(int i) const {
+    return sum(i, i);
+  }
+};
+
 /*** Example Usage and Output:
 
 Values: 15 6 7 -5 4
+200000 range updates and sums:
+  fenwick_tree: 7.24354s
+  offline_fenwick_tree: 0.176025s
 
 ***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
 using namespace std;
 
+int rand_index(int n) {
+  return ((rand() & 0x7fff) << 15 ^ (rand() & 0x7fff)) % n;
+}
+
+void benchmark(int num_ops) {
+  vector<int> lo(num_ops), hi(num_ops), q(num_ops);
+  for (int k = 0; k < num_ops; k++) {
+    lo[k] = rand_index(1000000000);
+    hi[k] = lo[k] + rand_index(1000000);
+    q[k] = rand_index(1000000000);
+  }
+  long long sum1 = 0, sum2 = 0;
+  clock_t start = clock();
+  fenwick_tree<long long> t1;
+  for (int k = 0; k < num_ops; k++) {
+    t1.add(lo[k], hi[k], k % 7);
+    sum1 += t1.sum(q[k]);
+  }
+  double map_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  offline_fenwick_tree<long long> t2;
+  for (int k = 0; k < num_ops; k++) {
+    t2.reserve(lo[k], hi[k]);
+  }
+  t2.build();
+  for (int k = 0; k < num_ops; k++) {
+    t2.add(lo[k], hi[k], k % 7);
+    sum2 += t2.sum(q[k]);
+  }
+  double offline_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  assert(sum1 == sum2);
+  cout << num_ops << " range updates and sums:" << endl;
+  cout << "  fenwick_tree: " << map_time << "s" << endl;
+  cout << "  offline_fenwick_tree: " << offline_time << "s" << endl;
+}
+
 int main() {
   int a[] = {10, 1, 2, 3, 4};
   fenwick_tree<int> t;
@@ -103,5 +239,37 @@ int main() {
   t.add(500000011, 500000015, 5);
   t.set(500000000, 10);
   assert(t.sum(0, 1000000000) == 92);
+
+  offline_fenwick_tree<long long> t2;
+  for (int i = 0; i < 5; i++) {
+    t2.reserve(i);
+  }
+  t2.reserve(0, 2);
+  t2.reserve(500000000);
+  t2.reserve(500000001, 500000010);
+  t2.reserve(500000011, 500000015);
+  t2.build();
+  for (int i = 0; i < 5; i++) {
+    t2.set(i, a[i]);
+  }
+  t2.add(0, 2, 5);
+  t2.set(3, -5);
+  for (int i = 0; i < 5; i++) {
+    assert(t2.at(i) == t.at(i));
+  }
+  assert(t2.sum(0, 4) == 27);
+  t2.add(500000001, 500000010, 3);
+  t2.add(500000011, 500000015, 5);
+  t2.set(500000000, 10);
+  assert(t2.sum(0, 1000000000) == 92);
+  assert(t2.sum(500000005, 500000012) == 28);
+  bool caught = false;
+  try {
+    t2.add(7, 1);
+  } catch (runtime_error &) {
+    caught = true;
+  }
+  assert(caught);
+  benchmark(200000);
   return 0;
 }
@@ -17,21 +17,47 @@ MAXR, inclusive, and columns have valid indices from 0 to MAXC, inclusive.
   (r1, c1) and lower-right corner (r2, c2).
 - at(r, c) returns the value at index (r, c).
 
+offline_fenwick_tree_2d supports the same operations when the coordinates of all
+updates are known in advance, as a Fenwick tree of sorted vectors with no map
+nodes at all. Each update is reduced to point updates at the corners of its
+rectangle and their projections onto row 0 and column 0, and each node of the
+Fenwick tree over the sorted, distinct rows of those points holds a Fenwick tree
+over the sorted, distinct columns of the points which it covers. All nodes are
+stored contiguously in flat arrays, and every index is found by binary search.
+Since each sum is a polynomial in the queried row and column between
+consecutive update coordinates, sum() may be queried at any index.
+- reserve(r, c) registers index (r, c) for later calls to add(r, c, x) and
+  set(r, c, x).
+- reserve(r1, c1, r2, c2) registers a rectangle for later calls to
+  add(r1, c1, r2, c2, x).
+- build() allocates the tree over all registered indices. It must be called
+  after all calls to reserve() and before any other operation.
+- add(), set(), sum(), and at() behave as above, where add() and set() throw an
+  exception if their indices were not registered.
+
 Time Complexity:
-- O(log^2(MAXR)*log^2(MAXC)) per call to all member functions. If std::map is
-  replaced with std::unordered_map, then the amortized running time will become
-  O(log(MAXR)*log(MAXC)).
+- O(log^2(MAXR)*log^2(MAXC)) per call to all member functions of
+  fenwick_tree_2d. If std::map is replaced with std::unordered_map, then the
+  amortized running time will become O(log(MAXR)*log(MAXC)).
+- O(1) amortized per call to reserve() of offline_fenwick_tree_2d.
+- O(m log^2 m) per call to build() of offline_fenwick_tree_2d, where m is the
+  number of calls to reserve().
+- O(log^2 m) per call to all other member functions of offline_fenwick_tree_2d.
 
 Space Complexity:
 - O(n*log(MAXR)*log(MAXC)) for storage of the array elements, where n is the
   number of distinct indices that have been accessed across all of the
   operations so far.
+- O(m log m) for storage of offline_fenwick_tree_2d.
 - O(1) auxiliary for all operations.
 
 */
 
+#include <algorithm>
 #include <map>
+#include <stdexcept>
 #include <utility>
+#include <vector>
 
 template<class T>
 class fenwick_tree_2d {
@@ -102,19 +128,231 @@ class fenwick_tree_2d {
   }
 };
 
+template<class T>
+class offline_fenwick_tree_2d {
+  std::vector<std::pair<int, int> > points;
+  std::vector<int> rows, cols, start;
+  std::vector<T> t1, t2, t3, t4;
+
+  void reserve_helper(int r, int c) {
+    points.push_back(std::make_pair(0, 0));
+    points.push_back(std::make_pair(0, c));
+    points.push_back(std::make_pair(r, 0));
+    points.push_back(std::make_pair(r, c));
+  }
+
+  // Returns the number of values at indices [lo, hi) of a sorted vector that
+  // are at most x, which is also the 1-based index of x in the range if found.
+  static int count(const std::vector<int> &v, int lo, int hi, int x) {
+    return std::upper_bound(v.begin() + lo, v.begin() + hi, x) -
+           (v.begin() + lo);
+  }
+
+  void check(int r, int c) const {
+    if (!std::binary_search(points.begin(), points.end(),
+                            std::make_pair(r, c))) {
+      throw std::runtime_error("Index was not reserved.");
+    }
+  }
+
+  void add(int r, int c, const T &x1, const T &x2, const T &x3, const T &x4) {
+    int nr = rows.size();
+    for (int i = count(rows, 0, nr, r); i <= nr; i += i & -i) {
+      int n = start[i + 1] - start[i];
+      for (int j = count(cols, start[i], start[i + 1], c); j <= n;
+           j += j & -j) {
+        int k = start[i] + j - 1;
+        t1[k] += x1;
+        t2[k] += x2;
+        t3[k] += x3;
+        t4[k] += x4;
+      }
+    }
+  }
+
+  void add_helper(int r, int c, const T &x) {
+    add(0, 0, x, 0, 0, 0);
+    add(0, c, -x, x*c, 0, 0);
+    add(r, 0, -x, 0, x*r, 0);
+    add(r, c, x, -x*c, -x*r, x*r*c);
+  }
+
+ public:
+  void reserve(int r1, int c1, int r2, int c2) {
+    reserve_helper(r2 + 1, c2 + 1);
+    reserve_helper(r1, c2 + 1);
+    reserve_helper(r2 + 1, c1);
+    reserve_helper(r1, c1);
+  }
+
+  void reserve(int r, int c) {
+    reserve(r, c, r, c);
+  }
+
+  void build() {
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    rows.clear();
+    for (int k = 0; k < (int)points.size(); k++) {
+      if (rows.empty() || rows.back() != points[k].first) {
+        rows.push_back(points[k].first);
+      }
+    }
+    int nr = rows.size();
+    std::vector<std::vector<int> > node(nr + 1);
+    for (int k = 0, r = 0; k < (int)points.size(); k++) {
+      while (rows[r] != points[k].first) {
+        r++;
+      }
+      for (int i = r + 1; i <= nr; i += i & -i) {
+        node[i].push_back(points[k].second);
+      }
+    }
+    start.assign(nr + 2, 0);
+    cols.clear();
+    for (int i = 1; i <= nr; i++) {
+      std::sort(node[i].begin(), node[i].end());
+      start[i] = cols.size();
+      for (int k = 0; k < (int)node[i].size(); k++) {
+        if (k == 0 || node[i][k] != node[i][k - 1]) {
+          cols.push_back(node[i][k]);
+        }
+      }
+    }
+    start[nr + 1] = cols.size();
+    t1.assign(cols.size(), 0);
+    t2.assign(cols.size(), 0);
+    t3.assign(cols.size(), 0);
+    t4.assign(cols.size(), 0);
+  }
+
+  void add(int r1, int c1, int r2, int c2, const T &x) {
+    check(r2 + 1, c2 + 1);
+    check(r1, c2 + 1);
+    check(r2 + 1, c1);
+    check(r1, c1);
+    add_helper(r2 + 1, c2 + 1, x);
+    add_helper(r1, c2 + 1, -x);
+    add_helper(r2 + 1, c1, -x);
+    add_helper(r1, c1, x);
+  }
+
+  void add(int r, int c, const T &x) {
+    add(r, c, r, c, x);
+  }
+
+  void set(int r, int c, const T &x) {
+    add(r, c, x - at(r, c));
+  }
+
+  T sum(int r, int c) const {
+    T s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+    for (int i = count(rows, 0, rows.size(), r); i > 0; i -= i & -i) {
+      for (int j = count(cols, start[i], start[i + 1], c); j > 0; j -= j & -j) {
+        int k = start[i] + j - 1;
+        s1 += t1[k];
+        s2 += t2[k];
+        s3 += t3[k];
+        s4 += t4[k];
+      }
+    }
+    r++;
+    c++;
+    return s1*r*c + s2*r + s3*c + s4;
+  }
+
+  T sum(int r1, int c1, int r2, int c2) const {
+    return sum(r2, c2) + sum(r1 - 1, c1 - 1) -
+           sum(r1 - 1, c2) - sum(r2, c1 - 1);
+  }
+
+  T at(int r, int c) const {
+    return sum(r, c, r, c);
+  }
+};
+
 /*** Example Usage and Output:
 
 Values:
 5 6 0
 3 5 5
 0 5 14
+2000 point updates and sums:
+  fenwick_tree_2d: 4.68619s
+  offline_fenwick_tree_2d: 0.026087s
 
 ***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
 using namespace std;
 
+void test_against_map(int n, int num_ops) {
+  vector<int> r1(num_ops), c1(num_ops), r2(num_ops), c2(num_ops);
+  offline_fenwick_tree_2d<long long> t1;
+  for (int k = 0; k < num_ops; k++) {
+    r1[k] = rand() % n;
+    c1[k] = rand() % n;
+    r2[k] = r1[k] + rand() % (n - r1[k]);
+    c2[k] = c1[k] + rand() % (n - c1[k]);
+    if (k % 3 == 0) {
+      t1.reserve(r1[k], c1[k]);
+    } else {
+      t1.reserve(r1[k], c1[k], r2[k], c2[k]);
+    }
+  }
+  t1.build();
+  fenwick_tree_2d<long long> t2;
+  for (int k = 0; k < num_ops; k++) {
+    long long x = rand() % 100 - 50;
+    if (k % 3 == 0) {
+      t1.set(r1[k], c1[k], x);
+      t2.set(r1[k], c1[k], x);
+    } else {
+      t1.add(r1[k], c1[k], r2[k], c2[k], x);
+      t2.add(r1[k], c1[k], r2[k], c2[k], x);
+    }
+    int qr = rand() % n, qc = rand() % n;
+    assert(t1.sum(qr, qc) == t2.sum(qr, qc));
+    assert(t1.sum(r2[k], c2[k], n, n) == t2.sum(r2[k], c2[k], n, n));
+  }
+}
+
+void benchmark(int num_ops) {
+  vector<int> r(num_ops), c(num_ops), qr(num_ops), qc(num_ops);
+  for (int k = 0; k < num_ops; k++) {
+    r[k] = rand() % 1000000;
+    c[k] = rand() % 1000000;
+    qr[k] = rand() % 1000000;
+    qc[k] = rand() % 1000000;
+  }
+  long long sum1 = 0, sum2 = 0;
+  clock_t start = clock();
+  fenwick_tree_2d<long long> t1;
+  for (int k = 0; k < num_ops; k++) {
+    t1.add(r[k], c[k], k % 7);
+    sum1 += t1.sum(qr[k], qc[k]);
+  }
+  double map_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  offline_fenwick_tree_2d<long long> t2;
+  for (int k = 0; k < num_ops; k++) {
+    t2.reserve(r[k], c[k]);
+  }
+  t2.build();
+  for (int k = 0; k < num_ops; k++) {
+    t2.add(r[k], c[k], k % 7);
+    sum2 += t2.sum(qr[k], qc[k]);
+  }
+  double offline_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  assert(sum1 == sum2);
+  cout << num_ops << " point updates and sums:" << endl;
+  cout << "  fenwick_tree_2d: " << map_time << "s" << endl;
+  cout << "  offline_fenwick_tree_2d: " << offline_time << "s" << endl;
+}
+
 int main() {
   fenwick_tree_2d<int> t;
   t.set(0, 0, 5);
@@ -135,5 +373,39 @@ int main() {
   assert(t.sum(1, 1, 2, 2) == 29);
   t.set(500000000, 500000000, 100);
   assert(t.sum(0, 0, 1000000000, 1000000000) == 143);
+
+  offline_fenwick_tree_2d<long long> t2;
+  t2.reserve(0, 0);
+  t2.reserve(0, 1);
+  t2.reserve(1, 0);
+  t2.reserve(2, 2);
+  t2.reserve(1, 1, 2, 2);
+  t2.reserve(100000000, 100000000);
+  t2.build();
+  t2.set(0, 0, 5);
+  t2.set(0, 1, 6);
+  t2.set(1, 0, 7);
+  t2.add(2, 2, 9);
+  t2.add(1, 0, -4);
+  t2.add(1, 1, 2, 2, 5);
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      assert(t2.at(i, j) == t.at(i, j));
+    }
+  }
+  assert(t2.sum(1, 1, 2, 2) == 29);
+  t2.set(100000000, 100000000, 100);
+  assert(t2.sum(0, 0, 1000000000, 1000000000) == 143);
+  bool caught = false;
+  try {
+    t2.add(5, 5, 1);
+  } catch (runtime_error &) {
+    caught = true;
+  }
+  assert(caught);
+  for (int n = 1; n <= 40; n += 3) {
+    test_against_map(n, 200);
+  }
+  benchmark(2000);
   return 0;
 }
@@ -8,18 +8,44 @@ pre-populated adjacency list adj[] which must only consist of nodes numbered
 with integers between 0 (inclusive) and the total number of nodes (exclusive),
 as passed in the function argument.
 
+lca_tree is a reusable alternative without global arrays or recursion, so that
+it may be built on trees of any depth. An iterative depth-first search records
+the Euler tour, on which the lowest common ancestor of u and v is the node of
+minimum depth between the first occurrences of u and v. The tour is split into
+blocks of 64 entries, with a sparse table over the minimum of each block. Within
+every block, entry i stores a 64-bit mask of the positions in its block up to i
+which have minimum depth from themselves to i, so the minimum from any position
+p to i is the lowest bit of the mask at or above p.
+- lca_tree(n, adj[], root) constructs the structure for a tree of n nodes given
+  by the adjacency list adj[], which must be a size n array of vectors, rooted
+  at the given node.
+- size() returns the number of nodes.
+- depth(u) returns the number of edges from the root to u.
+- lca(u, v) returns the lowest common ancestor of u and v.
+- lca(queries, out) answers a batch of (u, v) queries offline, using Tarjan's
+  algorithm on the Euler tour with a disjoint set forest. The answers are
+  stored in out, which is resized to the number of queries.
+
 Time Complexity:
 - O(n log n) per call to build(), where n is the number of nodes.
 - O(log n) per call to lca().
+- O(n) per call to the lca_tree constructor.
+- O(1) per call to size(), depth(), and lca(u, v) of lca_tree.
+- O(n + q a(n)) per call to lca(queries, out) of lca_tree, where q is the number
+  of queries, and a(n) is the extremely slow-growing inverse of the Ackermann
+  function.
 
 Space Complexity:
 - O(n) for storage of the segment tree, where n is the number of nodes.
 - O(n log n) auxiliary stack space for build().
 - O(log n) auxiliary stack space for lca().
+- O(n) for storage of lca_tree.
+- O(n + q) auxiliary heap space for lca(queries, out) of lca_tree.
 
 */
 
 #include <algorithm>
+#include <utility>
 #include <vector>
 
 const int MAXN = 1000;
@@ -85,11 +111,273 @@ int lca(int u, int v) {
                     0, 0, len - 1);
 }
 
-/*** Example Usage ***/
+class lca_tree {
+  static const int BLOCK_SIZE = 64;
+
+  std::vector<int> euler, level, first, last;
+  std::vector<unsigned long long> mask;
+  std::vector<std::vector<int> > table;
+
+  static int floor_log2(unsigned int x) {
+    return 31 - __builtin_clz(x);
+  }
+
+  void visit(int u, int d) {
+    if (first[u] == -1) {
+      first[u] = euler.size();
+    }
+    last[u] = euler.size();
+    euler.push_back(u);
+    level.push_back(d);
+  }
+
+  int min_index(int i, int j) const {
+    return (level[j] < level[i]) ? j : i;
+  }
+
+  int in_block(int lo, int hi) const {
+    unsigned long long m = mask[hi] >> (lo % BLOCK_SIZE);
+    return lo + __builtin_ctzll(m);
+  }
+
+  int query_index(int lo, int hi) const {
+    int lb = lo/BLOCK_SIZE, hb = hi/BLOCK_SIZE;
+    if (lb == hb) {
+      return in_block(lo, hi);
+    }
+    int res = in_block(lo, lb*BLOCK_SIZE + BLOCK_SIZE - 1);
+    if (lb + 1 < hb) {
+      int j = floor_log2(hb - lb - 1);
+      res = min_index(res, min_index(table[j][lb + 1],
+                                     table[j][hb - (1 << j)]));
+    }
+    return min_index(res, in_block(hb*BLOCK_SIZE, hi));
+  }
+
+  static int find_root(std::vector<int> &root, int u) {
+    while (root[u] != u) {
+      root[u] = root[root[u]];
+      u = root[u];
+    }
+    return u;
+  }
+
+ public:
+  lca_tree(int n, std::vector<int> adj[], int root = 0)
+      : first(n, -1), last(n) {
+    euler.reserve(2*n - 1);
+    level.reserve(2*n - 1);
+    std::vector<int> parent(n, -1), next(n, 0), stack(1, root);
+    visit(root, 0);
+    while (!stack.empty()) {
+      int u = stack.back();
+      if (next[u] < (int)adj[u].size()) {
+        int v = adj[u][next[u]++];
+        if (v != parent[u]) {
+          parent[v] = u;
+          stack.push_back(v);
+          visit(v, stack.size() - 1);
+        }
+      } else {
+        stack.pop_back();
+        if (!stack.empty()) {
+          visit(stack.back(), stack.size() - 1);
+        }
+      }
+    }
+    int len = euler.size(), num_blocks = (len + BLOCK_SIZE - 1)/BLOCK_SIZE;
+    mask.resize(len);
+    for (int b = 0; b < num_blocks; b++) {
+      unsigned long long m = 0;
+      int start = b*BLOCK_SIZE;
+      for (int i = start; i < len && i < start + BLOCK_SIZE; i++) {
+        while (m != 0 && level[i] < level[start + 63 - __builtin_clzll(m)]) {
+          m ^= 1ULL << (63 - __builtin_clzll(m));
+        }
+        m |= 1ULL << (i - start);
+        mask[i] = m;
+      }
+    }
+    table.assign(1, std::vector<int>(num_blocks));
+    for (int b = 0; b < num_blocks; b++) {
+      int end = (b + 1)*BLOCK_SIZE < len ? (b + 1)*BLOCK_SIZE : len;
+      table[0][b] = in_block(b*BLOCK_SIZE, end - 1);
+    }
+    for (int j = 1; (1 << j) <= num_blocks; j++) {
+      table.push_back(std::vector<int>(num_blocks - (1 << j) + 1));
+      for (int i = 0; i + (1 << j) <= num_blocks; i++) {
+        table[j][i] = min_index(table[j - 1][i],
+                                table[j - 1][i + (1 << (j - 1))]);
+      }
+    }
+  }
+
+  int size() const {
+    return first.size();
+  }
+
+  int depth(int u) const {
+    return level[first[u]];
+  }
+
+  int lca(int u, int v) const {
+    int lo = first[u], hi = first[v];
+    if (lo > hi) {
+      std::swap(lo, hi);
+    }
+    return euler[query_index(lo, hi)];
+  }
+
+  void lca(const std::vector<std::pair<int, int> > &queries,
+           std::vector<int> &out) const {
+    int n = size(), q = queries.size();
+    // Group the queries by each of their endpoints.
+    std::vector<int> start(n + 1, 0), other(2*q), id(2*q);
+    for (int i = 0; i < q; i++) {
+      start[queries[i].first + 1]++;
+      start[queries[i].second + 1]++;
+    }
+    for (int u = 0; u < n; u++) {
+      start[u + 1] += start[u];
+    }
+    std::vector<int> pos(start.begin(), start.end() - 1);
+    for (int i = 0; i < q; i++) {
+      int u = queries[i].first, v = queries[i].second;
+      other[pos[u]] = v;
+      id[pos[u]++] = i;
+      other[pos[v]] = u;
+      id[pos[v]++] = i;
+    }
+    // Walking the tour, a node is finished at its last occurrence, after which
+    // it is merged into its parent. The ancestor of a finished node's set is
+    // then the lowest node on the current path containing it.
+    std::vector<int> root(n), sz(n, 1), ancestor(n);
+    std::vector<bool> done(n, false);
+    for (int u = 0; u < n; u++) {
+      root[u] = ancestor[u] = u;
+    }
+    out.resize(q);
+    for (int i = 0; i < (int)euler.size(); i++) {
+      int u = euler[i];
+      if (i > 0 && level[i - 1] > level[i]) {
+        int c = euler[i - 1];
+        int ru = find_root(root, u), rc = find_root(root, c);
+        if (sz[ru] < sz[rc]) {
+          std::swap(ru, rc);
+        }
+        root[rc] = ru;
+        sz[ru] += sz[rc];
+        ancestor[ru] = u;
+      }
+      if (last[u] == i) {
+        for (int k = start[u]; k < start[u + 1]; k++) {
+          int v = other[k];
+          if (done[v] || v == u) {
+            out[id[k]] = ancestor[find_root(root, v)];
+          }
+        }
+        done[u] = true;
+      }
+    }
+  }
+};
+
+/*** Example Usage and Output:
+
+Random tree of 2000000 nodes:
+  build: 0.557169s
+  4000000 online queries: 0.468087s
+  4000000 offline queries: 1.27145s
+Path of 2000000 nodes:
+  build: 0.094068s
+  4000000 online queries: 0.587504s
+  4000000 offline queries: 0.772223s
+
+***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
 using namespace std;
 
+int rand_index(int n) {
+  return ((rand() & 0x7fff) << 15 ^ (rand() & 0x7fff)) % n;
+}
+
+// Builds a tree in which every node i > 0 has parent p[i] < i.
+vector<vector<int> > make_tree(const vector<int> &p) {
+  vector<vector<int> > adj(p.size());
+  for (int i = 1; i < (int)p.size(); i++) {
+    adj[i].push_back(p[i]);
+    adj[p[i]].push_back(i);
+  }
+  return adj;
+}
+
+void test_lca_tree(int n) {
+  vector<int> p(n), d(n, 0);
+  for (int i = 1; i < n; i++) {
+    p[i] = (rand() % 2 == 0) ? i - 1 : rand() % i;
+    d[i] = d[p[i]] + 1;
+  }
+  vector<vector<int> > adj = make_tree(p);
+  lca_tree t(n, &adj[0]);
+  assert(t.size() == n);
+  vector<pair<int, int> > queries;
+  vector<int> expected;
+  for (int k = 0; k < 3*n; k++) {
+    int u = rand() % n, v = (k % 7 == 0) ? u : rand() % n;
+    queries.push_back(make_pair(u, v));
+    while (u != v) {
+      if (d[u] < d[v]) {
+        swap(u, v);
+      }
+      u = p[u];
+    }
+    expected.push_back(u);
+  }
+  vector<int> out;
+  t.lca(queries, out);
+  for (int k = 0; k < (int)queries.size(); k++) {
+    int u = queries[k].first, v = queries[k].second;
+    assert(t.depth(u) == d[u] && t.lca(u, v) == expected[k]);
+    assert(out[k] == expected[k]);
+  }
+}
+
+void benchmark(const char *name, const vector<int> &p, int num_queries) {
+  int n = p.size();
+  vector<vector<int> > adj = make_tree(p);
+  clock_t start = clock();
+  lca_tree t(n, &adj[0]);
+  double build_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  vector<pair<int, int> > queries(num_queries);
+  for (int k = 0; k < num_queries; k++) {
+    queries[k] = make_pair(rand_index(n), rand_index(n));
+  }
+  start = clock();
+  long long sum1 = 0, sum2 = 0;
+  for (int k = 0; k < num_queries; k++) {
+    sum1 += t.lca(queries[k].first, queries[k].second);
+  }
+  double online_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  vector<int> out;
+  t.lca(queries, out);
+  for (int k = 0; k < num_queries; k++) {
+    sum2 += out[k];
+  }
+  double offline_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  assert(sum1 == sum2);
+  cout << name << " of " << n << " nodes:" << endl;
+  cout << "  build: " << build_time << "s" << endl;
+  cout << "  " << num_queries << " online queries: " << online_time << "s"
+       << endl;
+  cout << "  " << num_queries << " offline queries: " << offline_time << "s"
+       << endl;
+}
+
 int main() {
   adj[0].push_back(1);
   adj[1].push_back(0);
@@ -102,5 +390,21 @@ int main() {
   build(5, 0);
   assert(lca(3, 2) == 1);
   assert(lca(2, 4) == 0);
+
+  lca_tree t(5, adj, 0);
+  assert(t.lca(3, 2) == 1 && t.lca(2, 4) == 0 && t.depth(3) == 2);
+  for (int n = 1; n <= 300; n += (n < 70) ? 1 : 29) {
+    test_lca_tree(n);
+  }
+  int n = 2000000;
+  vector<int> p(n);
+  for (int i = 1; i < n; i++) {
+    p[i] = rand_index(i);
+  }
+  benchmark("Random tree", p, 4000000);
+  for (int i = 1; i < n; i++) {
+    p[i] = i - 1;
+  }
+  benchmark("Path", p, 4000000);
   return 0;
 }
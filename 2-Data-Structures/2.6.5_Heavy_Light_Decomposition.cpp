@@ -33,17 +33,30 @@ join_deltas(d1, d2) should be defined to return "d1 + d2".
   the graph must be connected.
 - query(u, v) returns the result of join_values() applied to all values on the
   path from node u to node v.
+- query_subtree(u) returns the result of join_values() applied to all values in
+  the subtree rooted at node u, excluding the edge from u to its parent if the
+  values are on edges.
 - update(u, v, d) modifies all values on the path from node u to node v by
   respectively joining them with d using join_value_with_delta().
+- update_subtree(u, d) modifies all values in the subtree rooted at node u, as
+  defined for query_subtree(), by joining them with d.
+
+The tree is traversed iteratively, and nodes are numbered in a preorder that
+visits the heavy child of every node first. Each heavy path and each subtree
+thus occupies a contiguous range of positions, all stored in a single segment
+tree over n leaves. Queries never modify the segment tree, instead combining
+the pending deltas of the ancestors of each node they visit, so any number of
+threads may call query() and query_subtree() at once while no thread updates.
 
 Time Complexity:
 - O(n) per call to the constructor, where n is the number of nodes.
-- O(log n) per call to query() and update();
+- O(log^2 n) per call to query() and update().
+- O(log n) per call to query_subtree() and update_subtree().
 
 Space Complexity:
 - O(n) for storage of the decomposition.
-- O(n) auxiliary stack space for the constructor.
-- O(1) auxiliary for query() and update().
+- O(n) auxiliary heap space for the constructor.
+- O(log n) auxiliary stack space for all other operations.
 
 */
 
@@ -68,201 +81,362 @@ class heavy_light {
     return d2;  // For "set" updates, the more recent delta prevails.
   }
 
-  int counter, paths;
-  std::vector<std::vector<T> > value, delta;
-  std::vector<std::vector<bool> > pending;
-  std::vector<std::vector<int> > len;
-  std::vector<int> size, parent, tin, tout, path, pathlen, pathpos, pathroot;
-  std::vector<int> *adj;
-
-  void dfs(int u, int p) {
-    tin[u] = counter++;
-    parent[u] = p;
-    size[u] = 1;
-    for (int j = 0; j < (int)adj[u].size(); j++) {
-      int v = adj[u][j];
-      if (v != p) {
-        dfs(v, u);
-        size[u] += size[v];
-      }
-    }
-    tout[u] = counter++;
-  }
+  struct node_t {
+    T value, delta;
+    bool pending;
 
-  int new_path(int u) {
-    pathroot[paths] = u;
-    return paths++;
-  }
+    node_t() : pending(false) {}
+  };
 
-  void build_paths(int u, int path) {
-    this->path[u] = path;
-    pathpos[u] = pathlen[path]++;
-    for (int j = 0; j < (int)adj[u].size(); j++) {
-      int v = adj[u][j];
-      if (v != parent[u]) {
-        build_paths(v, (2*size[v] >= size[u]) ? path : new_path(v));
-      }
-    }
+  int m;
+  std::vector<node_t> nodes;
+  std::vector<int> size, parent, head, pos;
+
+  // Returns the number of leaves below node i, for a tree of m leaves.
+  inline int length(int i) const {
+    return m >> (31 - __builtin_clz(i));
   }
 
-  inline T join_value_with_delta(int path, int i) {
-    return pending[path][i]
-        ? join_value_with_delta(value[path][i], delta[path][i], len[path][i])
-        : value[path][i];
+  inline T join_value_with_delta(int i) const {
+    const node_t &n = nodes[i];
+    return n.pending ? join_value_with_delta(n.value, n.delta, length(i))
+                     : n.value;
   }
 
-  void push_delta(int path, int i) {
+  void push_delta(int i) {
     int d = 0;
     while ((i >> d) > 0) {
       d++;
     }
     for (d -= 2; d >= 0; d--) {
-      int l = (i >> d), r = (l ^ 1), n = l/2;
-      if (pending[path][n]) {
-        value[path][n] = join_value_with_delta(path, n);
-        delta[path][l] =
-            pending[path][l] ? join_deltas(delta[path][l], delta[path][n])
-                             : delta[path][n];
-        delta[path][r] =
-            pending[path][r] ? join_deltas(delta[path][r], delta[path][n])
-                             : delta[path][n];
-        pending[path][l] = pending[path][r] = true;
-        pending[path][n] = false;
+      node_t &n = nodes[i >> (d + 1)];
+      if (n.pending) {
+        n.value = join_value_with_delta(i >> (d + 1));
+        node_t &l = nodes[(i >> d) & ~1], &r = nodes[(i >> d) | 1];
+        l.delta = l.pending ? join_deltas(l.delta, n.delta) : n.delta;
+        r.delta = r.pending ? join_deltas(r.delta, n.delta) : n.delta;
+        l.pending = r.pending = true;
+        n.pending = false;
       }
     }
   }
 
-  bool query(int path, int u, int v, T *res) {
-    push_delta(path, u += value[path].size()/2);
-    push_delta(path, v += value[path].size()/2);
-    bool found = false;
-    for (; u <= v; u = (u + 1)/2, v = (v - 1)/2) {
+  // The ancestors of every node covering part of a range are also ancestors of
+  // the leaf at one of its endpoints. Every update pushes all pending deltas
+  // off these paths before modifying the nodes in between, so the pending
+  // deltas of a node's ancestors are always more recent than its own. Rather
+  // than pushing, queries combine the deltas on both paths from the root down
+  // into acc[], with has_acc[] set where there is any delta, leaving the tree
+  // unchanged.
+  void combine_deltas(int leaf, T acc[], bool has_acc[]) const {
+    int h = 0;
+    while ((leaf >> h) > 1) {
+      h++;
+    }
+    has_acc[h + 1] = false;
+    for (int k = h; k >= 0; k--) {
+      const node_t &n = nodes[leaf >> k];
+      bool above = has_acc[k + 1];
+      has_acc[k] = above || n.pending;
+      if (n.pending) {
+        acc[k] = above ? join_deltas(n.delta, acc[k + 1]) : n.delta;
+      } else if (above) {
+        acc[k] = acc[k + 1];
+      }
+    }
+  }
+
+  T joined_value(int i, int k, const T acc[], const bool has_acc[]) const {
+    T v = join_value_with_delta(i);
+    return has_acc[k + 1] ? join_value_with_delta(v, acc[k + 1], 1 << k) : v;
+  }
+
+  bool query_range(int u, int v, T *res) const {
+    if (u > v) {
+      return false;
+    }
+    T acc_u[32], acc_v[32];
+    bool has_u[32], has_v[32];
+    combine_deltas(u += m, acc_u, has_u);
+    combine_deltas(v += m, acc_v, has_v);
+    bool found_u = false, found_v = false;
+    T res_v = T();
+    for (int k = 0; u <= v; u = (u + 1)/2, v = (v - 1)/2, k++) {
+      // The parent of a node taken on either side extends past the range on
+      // that side, so it is an ancestor of the leaf at that endpoint.
       if ((u & 1) != 0) {
-        T value = join_value_with_delta(path, u);
-        *res = found ? join_values(*res, value) : value;
-        found = true;
+        T value = joined_value(u, k, acc_u, has_u);
+        *res = found_u ? join_values(*res, value) : value;
+        found_u = true;
       }
       if ((v & 1) == 0) {
-        T value = join_value_with_delta(path, v);
-        *res = found ? join_values(*res, value) : value;
-        found = true;
+        T value = joined_value(v, k, acc_v, has_v);
+        res_v = found_v ? join_values(value, res_v) : value;
+        found_v = true;
       }
     }
-    return found;
+    if (found_v) {
+      *res = found_u ? join_values(*res, res_v) : res_v;
+    }
+    return found_u || found_v;
   }
 
-  void update(int path, int u, int v, const T &d) {
-    push_delta(path, u += value[path].size()/2);
-    push_delta(path, v += value[path].size()/2);
+  void update_range(int u, int v, const T &d) {
+    if (u > v) {
+      return;
+    }
+    push_delta(u += m);
+    push_delta(v += m);
     int tu = -1, tv = -1;
     for (; u <= v; u = (u + 1)/2, v = (v - 1)/2) {
       if ((u & 1) != 0) {
-        delta[path][u] = pending[path][u] ? join_deltas(delta[path][u], d) : d;
-        pending[path][u] = true;
+        nodes[u].delta = nodes[u].pending ? join_deltas(nodes[u].delta, d) : d;
+        nodes[u].pending = true;
         if (tu == -1) {
           tu = u;
         }
       }
       if ((v & 1) == 0) {
-        delta[path][v] = pending[path][v] ? join_deltas(delta[path][v], d) : d;
-        pending[path][v] = true;
+        nodes[v].delta = nodes[v].pending ? join_deltas(nodes[v].delta, d) : d;
+        nodes[v].pending = true;
         if (tv == -1) {
           tv = v;
         }
       }
     }
     for (int i = tu; i > 1; i /= 2) {
-      value[path][i/2] = join_values(join_value_with_delta(path, i),
-                                     join_value_with_delta(path, i ^ 1));
+      nodes[i/2].value = join_values(join_value_with_delta(i & ~1),
+                                     join_value_with_delta(i | 1));
     }
     for (int i = tv; i > 1; i /= 2) {
-      value[path][i/2] = join_values(join_value_with_delta(path, i),
-                                     join_value_with_delta(path, i ^ 1));
+      nodes[i/2].value = join_values(join_value_with_delta(i & ~1),
+                                     join_value_with_delta(i | 1));
     }
   }
 
-  inline bool is_ancestor(int parent, int child) {
-    return (tin[parent] <= tin[child]) && (tout[child] <= tout[parent]);
+  inline bool is_ancestor(int parent, int child) const {
+    return pos[parent] <= pos[child] && pos[child] < pos[parent] + size[parent];
+  }
+
+  void join_into(bool found, const T &value, bool *res_found, T *res) const {
+    if (found) {
+      *res = *res_found ? join_values(*res, value) : value;
+      *res_found = true;
+    }
   }
 
  public:
   heavy_light(int n, std::vector<int> adj[], const T &v = T())
-      : counter(0), paths(0), size(n), parent(n), tin(n), tout(n), path(n),
-        pathlen(n), pathpos(n), pathroot(n), adj(adj) {
-    dfs(0, -1);
-    build_paths(0, new_path(0));
-    value.resize(paths);
-    delta.resize(paths);
-    pending.resize(paths);
-    len.resize(paths);
-    for (int i = 0; i < paths; i++) {
-      int m = pathlen[i];
-      value[i].assign(2*m, v);
-      delta[i].resize(2*m);
-      pending[i].assign(2*m, false);
-      len[i].assign(2*m, 1);
-      for (int j = 2*m - 1; j > 1; j -= 2) {
-        value[i][j/2] = join_values(value[i][j], value[i][j ^ 1]);
-        len[i][j/2] = len[i][j] + len[i][j ^ 1];
+      : m(1), size(n, 1), parent(n, -1), head(n), pos(n) {
+    // Find a preorder with an explicit stack, then accumulate subtree sizes
+    // in reverse preorder.
+    std::vector<int> order, stack(1, 0);
+    order.reserve(n);
+    while (!stack.empty()) {
+      int u = stack.back();
+      stack.pop_back();
+      order.push_back(u);
+      for (int j = 0; j < (int)adj[u].size(); j++) {
+        int c = adj[u][j];
+        if (c != parent[u]) {
+          parent[c] = u;
+          stack.push_back(c);
+        }
       }
     }
+    for (int i = n - 1; i > 0; i--) {
+      size[parent[order[i]]] += size[order[i]];
+    }
+    // Assign positions in a preorder which visits each heavy child first, so
+    // that every heavy path and subtree occupies a contiguous range.
+    int counter = 0;
+    head[0] = 0;
+    stack.assign(1, 0);
+    while (!stack.empty()) {
+      int u = stack.back(), heavy = -1;
+      stack.pop_back();
+      pos[u] = counter++;
+      for (int j = 0; j < (int)adj[u].size(); j++) {
+        int c = adj[u][j];
+        if (c != parent[u] && (heavy == -1 || size[c] > size[heavy])) {
+          heavy = c;
+        }
+      }
+      for (int j = 0; j < (int)adj[u].size(); j++) {
+        int c = adj[u][j];
+        if (c != parent[u] && c != heavy) {
+          head[c] = c;
+          stack.push_back(c);
+        }
+      }
+      if (heavy != -1) {
+        head[heavy] = head[u];
+        stack.push_back(heavy);
+      }
+    }
+    while (m < n) {
+      m *= 2;
+    }
+    nodes.resize(2*m);
+    for (int i = 2*m - 1; i > 0; i--) {
+      nodes[i].value =
+          (i >= m) ? v : join_values(nodes[2*i].value, nodes[2*i + 1].value);
+    }
   }
 
-  T query(int u, int v) {
+  T query(int u, int v) const {
     if (VALUES_ON_EDGES && u == v) {
       throw std::runtime_error("No edge between u and v to be queried.");
     }
     bool found = false;
     T res = T(), value;
-    int root;
-    while (!is_ancestor(root = pathroot[path[u]], v)) {
-      if (query(path[u], 0, pathpos[u], &value)) {
-        res = found ? join_values(res, value) : value;
-        found = true;
-      }
-      u = parent[root];
+    while (!is_ancestor(head[u], v)) {
+      join_into(query_range(pos[head[u]], pos[u], &value), value, &found, &res);
+      u = parent[head[u]];
     }
-    while (!is_ancestor(root = pathroot[path[v]], u)) {
-      if (query(path[v], 0, pathpos[v], &value)) {
-        res = found ? join_values(res, value) : value;
-        found = true;
-      }
-      v = parent[root];
-    }
-    if (query(path[u], std::min(pathpos[u], pathpos[v]) + (int)VALUES_ON_EDGES,
-              std::max(pathpos[u], pathpos[v]), &value)) {
-      res = found ? join_values(res, value) : value;
-      found = true;
+    while (!is_ancestor(head[v], u)) {
+      join_into(query_range(pos[head[v]], pos[v], &value), value, &found, &res);
+      v = parent[head[v]];
     }
+    join_into(query_range(std::min(pos[u], pos[v]) + (int)VALUES_ON_EDGES,
+                          std::max(pos[u], pos[v]), &value),
+              value, &found, &res);
     if (!found) {
       throw std::runtime_error("Unexpected error: No values found.");
     }
     return res;
   }
 
+  T query_subtree(int u) const {
+    T res;
+    if (!query_range(pos[u] + (int)VALUES_ON_EDGES, pos[u] + size[u] - 1,
+                     &res)) {
+      throw std::runtime_error("No edge in the subtree to be queried.");
+    }
+    return res;
+  }
+
   void update(int u, int v, const T &d) {
     if (VALUES_ON_EDGES && u == v) {
       return;
     }
-    int root;
-    while (!is_ancestor(root = pathroot[path[u]], v)) {
-      update(path[u], 0, pathpos[u], d);
-      u = parent[root];
+    while (!is_ancestor(head[u], v)) {
+      update_range(pos[head[u]], pos[u], d);
+      u = parent[head[u]];
     }
-    while (!is_ancestor(root = pathroot[path[v]], u)) {
-      update(path[v], 0, pathpos[v], d);
-      v = parent[root];
+    while (!is_ancestor(head[v], u)) {
+      update_range(pos[head[v]], pos[v], d);
+      v = parent[head[v]];
     }
-    update(path[u], std::min(pathpos[u], pathpos[v]) + (int)VALUES_ON_EDGES,
-           std::max(pathpos[u], pathpos[v]), d);
+    update_range(std::min(pos[u], pos[v]) + (int)VALUES_ON_EDGES,
+                 std::max(pos[u], pos[v]), d);
+  }
+
+  void update_subtree(int u, const T &d) {
+    update_range(pos[u] + (int)VALUES_ON_EDGES, pos[u] + size[u] - 1, d);
   }
 };
 
-/*** Example Usage ***/
+/*** Example Usage and Output:
+
+Random tree of 1000000 nodes:
+  build: 0.332287s
+  1000000 path updates: 4.85193s
+  1000000 path queries: 3.95377s (sum 142648763084992)
+
+***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
 using namespace std;
 
+int rand_index(int n) {
+  return ((rand() & 0x7fff) << 15 ^ (rand() & 0x7fff)) % n;
+}
+
+// Compares against a naive tree where val[c] is the value on the edge from c
+// to its parent p[c] < c.
+void test_against_brute(int n) {
+  vector<int> p(n, -1), d(n, 0), val(n, 0);
+  vector<vector<int> > adj(n);
+  for (int i = 1; i < n; i++) {
+    p[i] = rand() % i;
+    d[i] = d[p[i]] + 1;
+    adj[i].push_back(p[i]);
+    adj[p[i]].push_back(i);
+  }
+  heavy_light<int> hld(n, &adj[0], 0);
+  for (int k = 0; k < 300; k++) {
+    int u = rand() % n, v = rand() % n, x = rand() % 1000;
+    vector<int> path, subtree;
+    for (int a = u, b = v; a != b; ) {
+      int &c = (d[a] < d[b]) ? b : a;
+      path.push_back(c);
+      c = p[c];
+    }
+    for (int c = u + 1; c < n; c++) {
+      int a = c;
+      while (a > u) {
+        a = p[a];
+      }
+      if (a == u) {
+        subtree.push_back(c);
+      }
+    }
+    vector<int> &target = (k % 2 == 0) ? path : subtree;
+    if (rand() % 2 == 0) {
+      for (int i = 0; i < (int)target.size(); i++) {
+        val[target[i]] = x;
+      }
+      if (k % 2 == 0) {
+        hld.update(u, v, x);
+      } else {
+        hld.update_subtree(u, x);
+      }
+    } else if (!target.empty()) {
+      int expected = val[target[0]];
+      for (int i = 1; i < (int)target.size(); i++) {
+        expected = min(expected, val[target[i]]);
+      }
+      assert((k % 2 == 0 ? hld.query(u, v) : hld.query_subtree(u)) ==
+             expected);
+    }
+  }
+}
+
+void benchmark(int n, int num_ops) {
+  vector<vector<int> > adj(n);
+  for (int i = 1; i < n; i++) {
+    int p = rand_index(i);
+    adj[i].push_back(p);
+    adj[p].push_back(i);
+  }
+  clock_t start = clock();
+  heavy_light<int> hld(n, &adj[0], 0);
+  double build_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  for (int k = 0; k < num_ops; k++) {
+    hld.update(rand_index(n), rand_index(n), rand());
+  }
+  double update_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  long long sum = 0;
+  for (int k = 0; k < num_ops; k++) {
+    int u = rand_index(n), v = rand_index(n);
+    if (u != v) {
+      sum += hld.query(u, v);
+    }
+  }
+  double query_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  cout << "Random tree of " << n << " nodes:" << endl;
+  cout << "  build: " << build_time << "s" << endl;
+  cout << "  " << num_ops << " path updates: " << update_time << "s" << endl;
+  cout << "  " << num_ops << " path queries: " << query_time << "s (sum "
+       << sum << ")" << endl;
+}
+
 int main() {
   //     w=40      w=20      w=10
   // 0---------1---------2---------3
@@ -287,5 +461,12 @@ int main() {
   assert(hld.query(2, 4) == 30);
   hld.update(3, 4, 5);
   assert(hld.query(1, 4) == 5);
+  assert(hld.query_subtree(2) == 5 && hld.query_subtree(0) == 5);
+  hld.update_subtree(1, 7);
+  assert(hld.query(0, 4) == 7 && hld.query_subtree(2) == 7);
+  for (int n = 2; n <= 60; n++) {
+    test_against_brute(n);
+  }
+  benchmark(1000000, 1000000);
   return 0;
 }
@@ -2,16 +2,25 @@
 
 Common string functions, many of which are substitutes for features which are
 not available in standard C++, or may not be available on compilers that do not
-support C++11 and later. These operations are naive implementations and often
-depend on certain std::string functions that have unspecified complexity.
+support C++11 and later. Most of these operations are naive implementations and
+often depend on certain std::string functions that have unspecified complexity.
+The final two sections give allocation-free versions of the splitting and
+numeric conversion functions for processing large inputs.
 
 */
 
 #include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 using std::string;
 
 /*
@@ -103,7 +112,7 @@ string to_title(const string &s) {
     } else {
       res.push_back(toupper(s[i]));
     }
-    prev = res.back();
+    prev = res[res.size() - 1];
   }
   return res;
 }
@@ -145,19 +154,85 @@ string& strip(string &s, const string &delim = " \n\t\v\f\r") {
 
 Find and Replace
 
+- string_ref(s) and string_ref(data, size) construct a non-owning reference to a
+  range of characters, much like std::string_view in C++17 and later. The
+  referenced string must outlive the reference and must not be modified while
+  it is in use. The method str() returns a copy of the range as a string.
+- find_first(haystack, needle, from) returns the first position not less than
+  from at which needle appears in haystack, or -1 if there is none. Needles of
+  one character are found with memchr(). For longer needles, SSE2 compares 16
+  candidate positions at a time against both the first and the last characters
+  of needle, and only positions matching both are verified with memcmp(). For
+  a search with a linear worst case, see the substring_searcher of section
+  3.2.1, which also falls back to the Knuth-Morris-Pratt algorithm.
 - find_all(haystack, needle) returns a vector of all positions where the string
-  needle appears in the string haystack.
+  needle appears in the string haystack, using find_first().
 - replace(s, old, replacement) returns a copy of s with all occurrences of the
   string old replaced with the given replacement.
+- replace_in_place(s, old, replacement) replaces all occurrences of old in s
+  with the given replacement in-place, returning a reference to s. All matches
+  are found first to compute the final length, after which every character is
+  moved at most once: forwards if the replacement is no longer than old, or
+  backwards from the end of the resized string otherwise.
 
 */
 
-std::vector<int> find_all(const string &haystack, const string &needle) {
+struct string_ref {
+  const char *data;
+  int size;
+
+  string_ref(const char *data, int size) : data(data), size(size) {}
+  string_ref(const char *s) : data(s), size(strlen(s)) {}
+  string_ref(const string &s) : data(s.data()), size(s.size()) {}
+
+  string str() const {
+    return string(data, size);
+  }
+
+  bool operator==(const string_ref &r) const {
+    return size == r.size && memcmp(data, r.data, size) == 0;
+  }
+};
+
+int find_first(string_ref haystack, string_ref needle, int from = 0) {
+  const char *h = haystack.data + from, *n = needle.data;
+  int len = haystack.size - from, m = needle.size;
+  if (m > len) {
+    return -1;
+  }
+  if (m <= 1) {
+    const void *p = (m == 0) ? h : memchr(h, n[0], len);
+    return (p == NULL) ? -1 : (const char*)p - haystack.data;
+  }
+  int i = 0, last = len - m;
+#ifdef __SSE2__
+  __m128i first_c = _mm_set1_epi8(n[0]), last_c = _mm_set1_epi8(n[m - 1]);
+  for (; i + 15 <= last; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(h + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(h + i + m - 1));
+    int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first_c),
+                                               _mm_cmpeq_epi8(b, last_c)));
+    for (; mask != 0; mask &= mask - 1) {
+      int j = i + __builtin_ctz(mask);
+      if (memcmp(h + j + 1, n + 1, m - 2) == 0) {
+        return from + j;
+      }
+    }
+  }
+#endif
+  for (; i <= last; i++) {
+    if (h[i] == n[0] && h[i + m - 1] == n[m - 1] && memcmp(h + i, n, m) == 0) {
+      return from + i;
+    }
+  }
+  return -1;
+}
+
+std::vector<int> find_all(string_ref haystack, string_ref needle) {
   std::vector<int> res;
-  size_t pos = haystack.find(needle, 0);
-  while (pos != string::npos) {
-      res.push_back(pos);
-      pos = haystack.find(needle, pos + 1);
+  int pos = find_first(haystack, needle);
+  for (; pos >= 0; pos = find_first(haystack, needle, pos + 1)) {
+    res.push_back(pos);
   }
   return res;
 }
@@ -175,6 +250,47 @@ string replace(const string &s, const string &old, const string &replacement) {
   return res;
 }
 
+string& replace_in_place(string &s, string_ref old, string_ref replacement) {
+  if (old.size == 0) {
+    return s;
+  }
+  std::vector<int> pos;
+  int p = find_first(s, old);
+  for (; p >= 0; p = find_first(s, old, p + old.size)) {
+    pos.push_back(p);
+  }
+  int n = s.size(), m = old.size, r = replacement.size, k = pos.size();
+  if (k == 0) {
+    return s;
+  }
+  pos.push_back(n);
+  int new_size = n + (r - m)*k;
+  if (r <= m) {
+    char *d = &s[0];
+    int write = pos[0];
+    for (int i = 0; i < k; i++) {
+      memcpy(d + write, replacement.data, r);
+      write += r;
+      int len = pos[i + 1] - (pos[i] + m);
+      memmove(d + write, d + pos[i] + m, len);
+      write += len;
+    }
+    s.resize(new_size);
+  } else {
+    s.resize(new_size);
+    char *d = &s[0];
+    int write = new_size;
+    for (int i = k - 1; i >= 0; i--) {
+      int len = pos[i + 1] - (pos[i] + m);
+      write -= len;
+      memmove(d + write, d + pos[i] + m, len);
+      write -= r;
+      memcpy(d + write, replacement.data, r);
+    }
+  }
+  return s;
+}
+
 /*
 
 Joining and Splitting
@@ -247,11 +363,577 @@ std::vector<string> explode(const string &s, const string &delim) {
   return res;
 }
 
-/*** Example Usage ***/
+/*
+
+Zero-Copy Splitting
+
+- split_ref(s, char delim, &res) stores the same tokens as split(s, delim) into
+  res as references into s, locating delimiters with memchr().
+- split_ref(s, string delim, &res) stores the same tokens as split(s, delim)
+  into res, looking each character up in a table of the delimiter characters.
+- explode_ref(s, delim, &res) stores the same tokens as explode(s, delim) into
+  res, for a non-empty delim.
+
+Reusing the same res vector across calls to the splitting functions avoids all
+memory allocation once its capacity has grown large enough.
+
+*/
+
+std::vector<string_ref>& split_ref(string_ref s, char delim,
+                                   std::vector<string_ref> &res) {
+  res.clear();
+  const char *p = s.data, *end = s.data + s.size;
+  while (p < end) {
+    const char *q = (const char*)memchr(p, delim, end - p);
+    if (q == NULL) {
+      res.push_back(string_ref(p, end - p));
+      break;
+    }
+    res.push_back(string_ref(p, q - p));
+    p = q + 1;
+  }
+  return res;
+}
+
+std::vector<string_ref>& split_ref(string_ref s, string_ref delim,
+                                   std::vector<string_ref> &res) {
+  bool is_delim[256] = {false};
+  for (int i = 0; i < delim.size; i++) {
+    is_delim[(unsigned char)delim.data[i]] = true;
+  }
+  res.clear();
+  int start = 0;
+  for (int i = 0; i < s.size; i++) {
+    if (is_delim[(unsigned char)s.data[i]]) {
+      if (i > start) {
+        res.push_back(string_ref(s.data + start, i - start));
+      }
+      start = i + 1;
+    }
+  }
+  if (s.size > start) {
+    res.push_back(string_ref(s.data + start, s.size - start));
+  }
+  return res;
+}
+
+std::vector<string_ref>& explode_ref(string_ref s, string_ref delim,
+                                     std::vector<string_ref> &res) {
+  res.clear();
+  int last = 0, next;
+  while (delim.size > 0 && (next = find_first(s, delim, last)) >= 0) {
+    res.push_back(string_ref(s.data + last, next - last));
+    last = next + delim.size;
+  }
+  res.push_back(string_ref(s.data + last, s.size - last));
+  return res;
+}
+
+/*
+
+Fast Numeric Conversion
+
+- parse_number(p, end, &res) parses the number at the start of the range [p,
+  end) into res, which may be a long long or a double, and returns a pointer
+  just past the parsed characters. The accepted format is an optional sign
+  followed by decimal digits, where doubles may also have a fractional part and
+  a decimal exponent. Unlike strtoll() and strtod(), leading whitespace, hex
+  and special values such as "inf" are not accepted. An exception is thrown if
+  there is no number or if an integer overflows. Digits are consumed eight at a
+  time by loading them into one 64-bit word, then checking and combining them
+  with three multiplications ("SWAR"). Doubles with at most 15 significant
+  digits and a decimal exponent of magnitude at most 22 are computed exactly
+  with a single multiplication or division by a power of 10, and any others
+  fall back to strtod(), which rounds correctly but depends on the locale.
+- parse_all(s, delim, &res) parses all numbers in s separated by the character
+  delim or by line breaks into res, throwing an exception for empty or
+  malformed fields, including the empty field after a trailing delim. A
+  trailing line break is allowed.
+- format_number(long long v, buf) writes the decimal representation of v to
+  buf, which must have room for at least 21 characters. Digits are written two
+  at a time from a table of all two-digit pairs. Returns the number of
+  characters written, excluding the null terminator.
+- format_number(double v, buf, precision) writes v in fixed-point notation with
+  the given number of digits after the decimal point (from 0 to 17) to buf,
+  which must have room for at least 32 characters. Values of magnitude 10^18
+  or more after scaling are written in exponent notation with sprintf(). The
+  last digit may differ from that of sprintf() when v lies within rounding
+  error of a tie.
+
+*/
+
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+static const double POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+inline bool is_eight_digits(unsigned long long x) {
+  return ((x & 0xF0F0F0F0F0F0F0F0ULL) |
+          (((x + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+         0x3333333333333333ULL;
+}
+
+// Combines eight digit characters of a little-endian word into their value.
+inline unsigned long long parse_eight_digits(unsigned long long x) {
+  x -= 0x3030303030303030ULL;
+  x = (x*10 + (x >> 8)) & 0x00FF00FF00FF00FFULL;
+  x = (x*100 + (x >> 16)) & 0x0000FFFF0000FFFFULL;
+  return (x*10000 + (x >> 32)) & 0xFFFFFFFFULL;
+}
+
+// Appends the digits at p to res and adds their count to count, ignoring the
+// values of any digits after the first 19 so that res cannot overflow.
+const char* read_digits(const char *p, const char *end, unsigned long long &res,
+                        int &count) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while (end - p >= 8 && count + 8 <= 19) {
+    unsigned long long x;
+    memcpy(&x, p, 8);
+    if (!is_eight_digits(x)) {
+      break;
+    }
+    res = res*100000000 + parse_eight_digits(x);
+    p += 8;
+    count += 8;
+  }
+#endif
+  for (; p < end && (unsigned int)(*p - '0') < 10; p++, count++) {
+    if (count < 19) {
+      res = res*10 + (*p - '0');
+    }
+  }
+  return p;
+}
+
+const char* parse_number(const char *p, const char *end, long long &res) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p++ == '-');
+  }
+  const char *digits = p;
+  while (p < end && *p == '0') {
+    p++;
+  }
+  unsigned long long value = 0;
+  int count = 0;
+  p = read_digits(p, end, value, count);
+  unsigned long long limit = negative ? 9223372036854775808ULL
+                                      : 9223372036854775807ULL;
+  if (p == digits || count > 19 || value > limit) {
+    throw std::runtime_error("parse_number failed");
+  }
+  res = negative ? (long long)(0 - value) : (long long)value;
+  return p;
+}
+
+const char* parse_number(const char *p, const char *end, double &res) {
+  const char *start = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p++ == '-');
+  }
+  const char *digits = p;
+  while (p < end && *p == '0') {
+    p++;
+  }
+  unsigned long long value = 0;
+  int count = 0, exponent = 0;
+  p = read_digits(p, end, value, count);
+  int num_digits = p - digits;
+  if (p < end && *p == '.') {
+    const char *fraction = ++p;
+    if (count == 0) {
+      while (p < end && *p == '0') {
+        p++;
+      }
+    }
+    p = read_digits(p, end, value, count);
+    num_digits += p - fraction;
+    exponent -= p - fraction;
+  }
+  if (num_digits == 0) {
+    throw std::runtime_error("parse_number failed");
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char *q = p + 1;
+    bool negative_exponent = false;
+    if (q < end && (*q == '-' || *q == '+')) {
+      negative_exponent = (*q++ == '-');
+    }
+    unsigned long long e = 0;
+    int e_count = 0;
+    const char *e_end = read_digits(q, end, e, e_count);
+    if (e_end > q) {
+      p = e_end;
+      exponent = (e_count > 9) ? 1000000000 : exponent +
+                 (negative_exponent ? -(int)e : (int)e);
+    }
+  }
+  if (count <= 15 && exponent >= -22 && exponent <= 22) {
+    res = (exponent < 0) ? value/POW10[-exponent] : value*POW10[exponent];
+    res = negative ? -res : res;
+  } else if (p - start < 64) {
+    char buf[64];
+    memcpy(buf, start, p - start);
+    buf[p - start] = '\0';
+    res = strtod(buf, NULL);
+  } else {
+    res = strtod(string(start, p).c_str(), NULL);
+  }
+  return p;
+}
+
+template<class T>
+std::vector<T>& parse_all(string_ref s, char delim, std::vector<T> &res) {
+  res.clear();
+  const char *p = s.data, *end = s.data + s.size;
+  while (p < end) {
+    T x;
+    p = parse_number(p, end, x);
+    res.push_back(x);
+    if (p < end && *p == '\r') {
+      p++;
+    }
+    if (p < end) {
+      char c = *p++;
+      if (c != '\n' && (c != delim || p == end)) {
+        throw std::runtime_error("parse_all failed");
+      }
+    }
+  }
+  return res;
+}
+
+int format_number(long long v, char *buf) {
+  unsigned long long u = (v < 0) ? 0 - (unsigned long long)v : v;
+  char tmp[20];
+  int i = 20;
+  for (; u >= 100; u /= 100) {
+    i -= 2;
+    memcpy(tmp + i, DIGIT_PAIRS + 2*(u % 100), 2);
+  }
+  if (u >= 10) {
+    i -= 2;
+    memcpy(tmp + i, DIGIT_PAIRS + 2*u, 2);
+  } else {
+    tmp[--i] = '0' + u;
+  }
+  int len = 0;
+  if (v < 0) {
+    buf[len++] = '-';
+  }
+  memcpy(buf + len, tmp + i, 20 - i);
+  len += 20 - i;
+  buf[len] = '\0';
+  return len;
+}
+
+int format_number(double v, char *buf, int precision = 6) {
+  double scaled = fabs(v)*POW10[precision];
+  if (!(scaled < 1e18)) {
+    return sprintf(buf, "%.*e", precision, v);
+  }
+  unsigned long long q = (unsigned long long)(scaled + 0.5);
+  unsigned long long unit = (unsigned long long)POW10[precision];
+  int len = 0;
+  if (v < 0) {
+    buf[len++] = '-';
+  }
+  len += format_number((long long)(q/unit), buf + len);
+  if (precision > 0) {
+    buf[len] = '.';
+    unsigned long long frac = q % unit;
+    for (int i = precision; i > 0; i--, frac /= 10) {
+      buf[len + i] = '0' + frac % 10;
+    }
+    len += precision + 1;
+    buf[len] = '\0';
+  }
+  return len;
+}
+
+/*** Example Usage and Output:
+
+Scanning 15.4542 MB of log lines:
+  split: 78.9012 MB/s
+  split_ref: 898.345 MB/s
+  std::string::find: 1632 MB/s
+  find_all: 5100.4 MB/s
+  replace: 8.28956 MB/s
+  replace_in_place: 1818.14 MB/s
+1000000 numbers of each type:
+  split and to_int: 0.395979s
+  parse_all<long long>: 0.022766s
+  strtod: 0.098226s
+  parse_all<double>: 0.040506s
+  to_str: 0.262771s
+  format_number(long long): 0.016037s
+  sprintf: 0.317579s
+  format_number(double): 0.023848s
+
+***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
 using namespace std;
 
+string random_string(int n, const char *alphabet) {
+  string res(n, ' ');
+  int k = strlen(alphabet);
+  for (int i = 0; i < n; i++) {
+    res[i] = alphabet[rand() % k];
+  }
+  return res;
+}
+
+vector<int> naive_find_all(const string &haystack, const string &needle) {
+  vector<int> res;
+  size_t pos = haystack.find(needle, 0);
+  while (pos != string::npos) {
+    res.push_back(pos);
+    pos = haystack.find(needle, pos + 1);
+  }
+  return res;
+}
+
+vector<string> to_strings(const vector<string_ref> &v) {
+  vector<string> res;
+  for (int i = 0; i < (int)v.size(); i++) {
+    res.push_back(v[i].str());
+  }
+  return res;
+}
+
+void test_against_naive(const string &s, const string &t) {
+  vector<string_ref> res;
+  assert(find_all(s, t) == naive_find_all(s, t));
+  assert(to_strings(split_ref(s, t[0], res)) == split(s, t[0]));
+  assert(to_strings(split_ref(s, t, res)) == split(s, t));
+  assert(to_strings(explode_ref(s, t, res)) == explode(s, t));
+  for (int len = 0; len <= 3; len++) {
+    string u(s), r(len, 'z');
+    assert(replace_in_place(u, t, r) == replace(s, t, r));
+  }
+}
+
+double elapsed(clock_t start) {
+  return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+void benchmark(int num_lines) {
+  string log;
+  for (int i = 0; i < num_lines; i++) {
+    log += "2024-01-01 12:00:00 host" + to_str(rand() % 100) + " GET /api/v1/"
+        + random_string(8 + rand() % 24, "abcdefghij/") + " status=200 ms="
+        + to_str(rand() % 1000) + "\n";
+  }
+  double mb = log.size()/1e6;
+  cout << "Scanning " << mb << " MB of log lines:" << endl;
+  clock_t start = clock();
+  size_t count1 = 0;
+  vector<string> lines = split(log, '\n');
+  for (int i = 0; i < (int)lines.size(); i++) {
+    count1 += split(lines[i], ' ').size();
+  }
+  double t1 = elapsed(start);
+  start = clock();
+  size_t count2 = 0;
+  vector<string_ref> line_refs, fields;
+  split_ref(log, '\n', line_refs);
+  for (int i = 0; i < (int)line_refs.size(); i++) {
+    count2 += split_ref(line_refs[i], ' ', fields).size();
+  }
+  double t2 = elapsed(start);
+  assert(count1 == count2);
+  cout << "  split: " << mb/t1 << " MB/s" << endl;
+  cout << "  split_ref: " << mb/t2 << " MB/s" << endl;
+  start = clock();
+  count1 = naive_find_all(log, "status=500").size() +
+           naive_find_all(log, "/a/").size();
+  t1 = elapsed(start);
+  start = clock();
+  count2 = find_all(log, "status=500").size() + find_all(log, "/a/").size();
+  t2 = elapsed(start);
+  assert(count1 == count2);
+  cout << "  std::string::find: " << 2*mb/t1 << " MB/s" << endl;
+  cout << "  find_all: " << 2*mb/t2 << " MB/s" << endl;
+  // replace() takes quadratic time, so only a prefix of the log is used.
+  string prefix = log.substr(0, log.size()/20);
+  start = clock();
+  string r1 = replace(prefix, "api", "service");
+  t1 = elapsed(start);
+  start = clock();
+  string r2(prefix);
+  replace_in_place(r2, "api", "service");
+  t2 = elapsed(start);
+  assert(r1 == r2);
+  cout << "  replace: " << mb/20/t1 << " MB/s" << endl;
+  cout << "  replace_in_place: " << mb/20/t2 << " MB/s" << endl;
+}
+
+void test_numeric_conversion() {
+  char buf[64];
+  long long ll;
+  double d;
+  long long edge[] = {0, 1, -1, 9, 10, 99, 100, 12345678, 123456789,
+                      9223372036854775807LL, -9223372036854775807LL - 1};
+  for (int i = 0; i < 11; i++) {
+    int len = format_number(edge[i], buf);
+    assert(string(buf) == to_str(edge[i]) && len == (int)strlen(buf));
+    assert(parse_number(buf, buf + len, ll) == buf + len && ll == edge[i]);
+  }
+  const char *bad[] = {"", "-", "+", "abc", "9223372036854775808",
+                       "-9223372036854775809", "100000000000000000000"};
+  for (int i = 0; i < 7; i++) {
+    try {
+      parse_number(bad[i], bad[i] + strlen(bad[i]), ll);
+      assert(false);
+    } catch (std::runtime_error &) {}
+  }
+  const char *s = "-000000000000000000000042xyz";
+  assert(parse_number(s, s + strlen(s), ll) == s + strlen(s) - 3);
+  assert(ll == -42);
+  for (int i = 0; i < 100000; i++) {
+    unsigned long long u = ((unsigned long long)rand() << 40) ^
+                           ((unsigned long long)rand() << 20) ^ rand();
+    ll = (long long)((u & ~(1ULL << 63)) >> (rand() % 63));
+    ll = (i % 2 == 0) ? -ll : ll;
+    int len = format_number(ll, buf);
+    assert(string(buf) == to_str(ll));
+    long long parsed;
+    parse_number(buf, buf + len, parsed);
+    assert(parsed == ll);
+  }
+  const char *doubles[] = {"0", "-0.5", "3.14159", ".25", "1.", "1e10",
+                           "2.5E-3", "1e", "123456789012345678901234",
+                           "0.000000000000000000001234",
+                           "1.7976931348623157e308", "4.9e-324", "1e400",
+                           "00012.50e+2"};
+  for (int i = 0; i < 14; i++) {
+    const char *end = doubles[i] + strlen(doubles[i]);
+    char *expected_end;
+    double expected = strtod(doubles[i], &expected_end);
+    assert(parse_number(doubles[i], end, d) == expected_end && d == expected);
+  }
+  for (int i = 0; i < 100000; i++) {
+    int precision = rand() % 10;
+    double v = (rand() - RAND_MAX/2)/(double)(1 << (rand() % 20));
+    int len = format_number(v, buf, precision);
+    assert(len == (int)strlen(buf));
+    parse_number(buf, buf + len, d);
+    assert(fabs(d - v) <= 0.5000001/POW10[precision] + fabs(v)*1e-15);
+    len = sprintf(buf, "%.*g", 1 + rand() % 17, v);
+    parse_number(buf, buf + len, d);
+    assert(d == strtod(buf, NULL));
+  }
+  assert(format_number(2.5, buf, 0) == 1 && string(buf) == "3");
+  assert(format_number(-1.005, buf, 1) == 4 && string(buf) == "-1.0");
+  assert(format_number(1e300, buf, 2) == (int)strlen(buf));
+  vector<long long> ints;
+  assert(parse_all("1,-2,3\r\n40,5\n", ',', ints).size() == 5);
+  assert(ints[2] == 3 && ints[3] == 40);
+  vector<double> values;
+  assert(parse_all("1.5 -2e3\n0.25", ' ', values).size() == 3);
+  assert(values[1] == -2000 && values[2] == 0.25);
+  try {
+    parse_all("1,,2", ',', ints);
+    assert(false);
+  } catch (std::runtime_error &) {}
+  try {
+    parse_all("1,2,", ',', ints);
+    assert(false);
+  } catch (std::runtime_error &) {}
+}
+
+void benchmark_numeric(int n) {
+  vector<long long> ints(n);
+  vector<double> values(n);
+  string csv, fixed_csv;
+  char buf[64];
+  for (int i = 0; i < n; i++) {
+    ints[i] = rand() % 2000000000 - 1000000000;
+    values[i] = (rand() - RAND_MAX/2)/1000.0;
+    csv += to_str(ints[i]) + ((i % 10 == 9) ? "\n" : ",");
+    format_number(values[i], buf, 3);
+    fixed_csv += string(buf) + ((i % 10 == 9) ? "\n" : ",");
+  }
+  cout << n << " numbers of each type:" << endl;
+  clock_t start = clock();
+  long long sum1 = 0, sum2 = 0;
+  vector<string> lines = split(csv, '\n');
+  for (int i = 0; i < (int)lines.size(); i++) {
+    vector<string> fields = split(lines[i], ',');
+    for (int j = 0; j < (int)fields.size(); j++) {
+      sum1 += to_int(fields[j]);
+    }
+  }
+  double t1 = elapsed(start);
+  start = clock();
+  vector<long long> parsed;
+  parse_all(csv, ',', parsed);
+  for (int i = 0; i < (int)parsed.size(); i++) {
+    sum2 += parsed[i];
+  }
+  double t2 = elapsed(start);
+  assert(sum1 == sum2);
+  cout << "  split and to_int: " << t1 << "s" << endl;
+  cout << "  parse_all<long long>: " << t2 << "s" << endl;
+  start = clock();
+  double total1 = 0, total2 = 0;
+  const char *p = fixed_csv.data();
+  for (int i = 0; i < n; i++) {
+    char *next;
+    total1 += strtod(p, &next);
+    p = next + 1;
+  }
+  t1 = elapsed(start);
+  start = clock();
+  vector<double> parsed_values;
+  parse_all(fixed_csv, ',', parsed_values);
+  for (int i = 0; i < (int)parsed_values.size(); i++) {
+    total2 += parsed_values[i];
+  }
+  t2 = elapsed(start);
+  assert(total1 == total2);
+  cout << "  strtod: " << t1 << "s" << endl;
+  cout << "  parse_all<double>: " << t2 << "s" << endl;
+  start = clock();
+  size_t len1 = 0, len2 = 0;
+  for (int i = 0; i < n; i++) {
+    len1 += to_str(ints[i]).size();
+  }
+  t1 = elapsed(start);
+  start = clock();
+  for (int i = 0; i < n; i++) {
+    len2 += format_number(ints[i], buf);
+  }
+  t2 = elapsed(start);
+  assert(len1 == len2);
+  cout << "  to_str: " << t1 << "s" << endl;
+  cout << "  format_number(long long): " << t2 << "s" << endl;
+  start = clock();
+  len1 = len2 = 0;
+  for (int i = 0; i < n; i++) {
+    len1 += sprintf(buf, "%.3f", values[i]);
+  }
+  t1 = elapsed(start);
+  start = clock();
+  for (int i = 0; i < n; i++) {
+    len2 += format_number(values[i], buf, 3);
+  }
+  t2 = elapsed(start);
+  assert(len1 == len2);
+  cout << "  sprintf: " << t1 << "s" << endl;
+  cout << "  format_number(double): " << t2 << "s" << endl;
+}
+
 int main() {
   assert(to_str(123) + "4" == "1234");
   assert(to_int("1234") == 1234);
@@ -278,5 +960,26 @@ int main() {
   assert(join(split("a\nb\ncde\nf", '\n'), "|") == "a|b|cde|f");  // split v1
   assert(join(split("a::b,cde:,f", ":,"), "|") == "a|b|cde|f");  // split v2
   assert(join(explode("a..b.cde....f", ".."), "|") == "a|b.cde||f");
+
+  vector<string_ref> tokens;
+  assert(find_first("abracadabra", "cad") == 4);
+  assert(find_first("abracadabra", "abra", 1) == 7);
+  assert(find_first("abracadabra", "xyz") == -1);
+  assert(find_all("abc", "") == naive_find_all("abc", ""));
+  split_ref("a\nb\ncde\nf", '\n', tokens);
+  assert(tokens.size() == 4 && tokens[2] == "cde");
+  assert(join(to_strings(explode_ref("a..b.cde....f", "..", tokens)), "|") ==
+         "a|b.cde||f");
+  string r("abcdabba");
+  assert(replace_in_place(r, "ab", "0") == "0cd0ba");
+  assert(replace_in_place(r, "0", "123") == "123cd123ba");
+  for (int i = 0; i < 2000; i++) {
+    string s = random_string(rand() % 100, (i % 2 == 0) ? "ab" : "abc:,");
+    string t = random_string(1 + rand() % 4, (i % 2 == 0) ? "ab" : "abc:,");
+    test_against_naive(s, t);
+  }
+  test_numeric_conversion();
+  benchmark(200000);
+  benchmark_numeric(1000000);
   return 0;
 }
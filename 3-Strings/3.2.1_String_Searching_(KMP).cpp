@@ -7,26 +7,74 @@ comparison, std::string::find runs in quadratic time.
 
 - kmp(needle) constructs the partial match table for a string needle that is to
   be searched for subsequently in haystack queries.
-- find_in(haystack) returns the first position that needle occurs in haystack,
-  or std::string::npos if it cannot be found. Note that the function can be
-  modified to return all matches by simply letting the loop run and storing
-  the results instead of returning early.
+- find_in(haystack, from) returns the first position not less than from that
+  needle occurs in haystack, or std::string::npos if it cannot be found.
+- find_all_in(haystack) returns all positions that a non-empty needle occurs in
+  haystack, including overlapping occurrences.
+
+A haystack arriving in chunks (for example, read from a large file or a socket)
+may be searched without copying or concatenating them using a kmp_stream, which
+keeps the length of the longest prefix of needle matched at the end of the last
+chunk. Whenever no prefix is matched, the scan skips ahead with memchr() to the
+next occurrence of the first character of needle.
+
+- kmp_stream(needle) constructs a matcher for a non-empty string needle.
+- feed(data, len, report) scans the next len characters of the stream starting
+  at pointer data, calling report(pos) for the position pos of every occurrence
+  of needle in the stream (relative to the start of the stream) which ends in
+  this chunk. Occurrences may overlap and may span multiple chunks.
+- position() returns the total number of characters fed so far.
+- reset() restarts the stream at position 0.
 
 Time Complexity:
-- O(m) per call to the constructor, where m is the length of needle.
+- O(m) per call to the constructors, where m is the length of needle.
 - O(n) per call to find_in(haystack), where n is the length of haystack.
+- O(len) per call to feed(data, len, report).
+- O(1) per call to position() and reset().
+
+For typical text, scanning one byte at a time is much slower than comparing many
+candidate positions at once with SIMD instructions. A substring_searcher chooses
+its method by the needle:
+- One-character needles are found with memchr().
+- Otherwise, 32 (with AVX2) or 16 (with SSE2) consecutive candidate positions
+  are compared at once against the first and last characters of needle, and
+  only the candidates matching both are verified with memcmp(). If the bytes
+  compared in verification exceed a constant multiple of the distance scanned,
+  the search finishes with the partial match table from that position to keep
+  its worst case linear.
+- When finding all matches, periodic needles (those with a border at least half
+  their length, such as "abab...") are found with the partial match table
+  directly, since their matches may overlap densely. Matches of any other
+  needle must be more than half its length apart, so that verifying each match
+  with memcmp() takes linear time overall.
+
+- substring_searcher(needle) constructs a searcher for needle.
+- find_in(haystack, from) and find_all_in(haystack) behave as in kmp above.
+
+Time Complexity:
+- O(m) per call to the constructor, where m is the length of needle.
+- O(n) per call to find_in(haystack, from), where n is the length of haystack.
+- O(n) per call to find_all_in(haystack).
 
 Space Complexity:
 - O(m) for storage of the partial match table, where m is the length of needle.
-- O(1) auxiliary space per call to find_in(haystack).
+- O(1) auxiliary space per call to find_in(haystack, from).
+- O(k) auxiliary space per call to find_all_in(haystack).
 
 */
 
+#include <cstring>
 #include <string>
 #include <vector>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 using std::string;
 
 class kmp {
+  friend class kmp_stream;
+  friend class substring_searcher;
+
   string needle;
   std::vector<int> table;
 
@@ -43,12 +91,12 @@ class kmp {
     }
   }
 
-  size_t find_in(const string &haystack) {
+  size_t find_in(const string &haystack, size_t from = 0) const {
     int m = needle.size();
     if (m == 0) {
-      return 0;
+      return (from <= haystack.size()) ? from : string::npos;
     }
-    for (int i = 0, j = 0; i < (int)haystack.size(); i++) {
+    for (int i = from, j = 0; i < (int)haystack.size(); i++) {
       while (j > 0 && needle[j] != haystack[i]) {
         j = table[j - 1];
       }
@@ -61,13 +109,359 @@ class kmp {
     }
     return string::npos;
   }
+
+  std::vector<size_t> find_all_in(const string &haystack) const {
+    std::vector<size_t> res;
+    int m = needle.size();
+    for (int i = 0, j = 0; m > 0 && i < (int)haystack.size(); i++) {
+      while (j > 0 && needle[j] != haystack[i]) {
+        j = table[j - 1];
+      }
+      if (needle[j] == haystack[i]) {
+        j++;
+      }
+      if (j == m) {
+        res.push_back(i + 1 - m);
+        j = table[m - 1];
+      }
+    }
+    return res;
+  }
+};
+
+class kmp_stream {
+  kmp matcher;
+  int matched;
+  long long offset;
+
+ public:
+  kmp_stream(const string &needle) : matcher(needle), matched(0), offset(0) {}
+
+  template<class ReportFunction>
+  void feed(const char *data, size_t len, ReportFunction report) {
+    const string &needle = matcher.needle;
+    const std::vector<int> &table = matcher.table;
+    int m = needle.size(), j = matched;
+    const char *p = data, *end = data + len;
+    while (p < end) {
+      if (j == 0 && (p = (const char*)memchr(p, needle[0], end - p)) == NULL) {
+        break;
+      }
+      while (j > 0 && needle[j] != *p) {
+        j = table[j - 1];
+      }
+      if (needle[j] == *p) {
+        j++;
+      }
+      p++;
+      if (j == m) {
+        report(offset + (p - data) - m);
+        j = table[m - 1];
+      }
+    }
+    matched = j;
+    offset += len;
+  }
+
+  long long position() const {
+    return offset;
+  }
+
+  void reset() {
+    matched = 0;
+    offset = 0;
+  }
+};
+
+class substring_searcher {
+  kmp fallback;
+  bool periodic;
+
+  // Returns the first match at or after from by verifying candidates which
+  // match the first and last characters of needle, 32 or 16 at a time.
+  size_t find_filtered(const string &haystack, size_t from) const {
+    const string &needle = fallback.needle;
+    const char *h = haystack.data(), *p = needle.data();
+    int n = haystack.size(), m = needle.size(), i = from, last = n - m;
+    long long work = 0;
+#if defined(__AVX2__)
+    const int WIDTH = 32;
+    __m256i first_c = _mm256_set1_epi8(p[0]);
+    __m256i last_c = _mm256_set1_epi8(p[m - 1]);
+#elif defined(__SSE2__)
+    const int WIDTH = 16;
+    __m128i first_c = _mm_set1_epi8(p[0]), last_c = _mm_set1_epi8(p[m - 1]);
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; i + WIDTH - 1 <= last; i += WIDTH) {
+#if defined(__AVX2__)
+      __m256i a = _mm256_loadu_si256((const __m256i*)(h + i));
+      __m256i b = _mm256_loadu_si256((const __m256i*)(h + i + m - 1));
+      unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(
+          _mm256_cmpeq_epi8(a, first_c), _mm256_cmpeq_epi8(b, last_c)));
+#else
+      __m128i a = _mm_loadu_si128((const __m128i*)(h + i));
+      __m128i b = _mm_loadu_si128((const __m128i*)(h + i + m - 1));
+      unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+          _mm_cmpeq_epi8(a, first_c), _mm_cmpeq_epi8(b, last_c)));
+#endif
+      for (; mask != 0; mask &= mask - 1) {
+        int j = i + __builtin_ctz(mask);
+        if (memcmp(h + j + 1, p + 1, m - 2) == 0) {
+          return j;
+        }
+        if ((work += m) > 8LL*(j - (int)from) + 256) {
+          return fallback.find_in(haystack, j);
+        }
+      }
+    }
+#endif
+    for (; i <= last; i++) {
+      if (h[i] == p[0] && h[i + m - 1] == p[m - 1]) {
+        if (memcmp(h + i + 1, p + 1, m - 2) == 0) {
+          return i;
+        }
+        if ((work += m) > 8LL*(i - (int)from) + 256) {
+          return fallback.find_in(haystack, i);
+        }
+      }
+    }
+    return string::npos;
+  }
+
+ public:
+  substring_searcher(const string &needle) : fallback(needle) {
+    int m = needle.size();
+    periodic = (m > 1 && 2*fallback.table[m - 1] >= m);
+  }
+
+  size_t find_in(const string &haystack, size_t from = 0) const {
+    const string &needle = fallback.needle;
+    if (from > haystack.size() || needle.size() > haystack.size() - from) {
+      return string::npos;
+    }
+    if (needle.size() <= 1) {
+      if (needle.empty()) {
+        return from;
+      }
+      const void *p = memchr(haystack.data() + from, needle[0],
+                             haystack.size() - from);
+      return (p == NULL) ? string::npos : (const char*)p - haystack.data();
+    }
+    return find_filtered(haystack, from);
+  }
+
+  std::vector<size_t> find_all_in(const string &haystack) const {
+    if (periodic || fallback.needle.empty()) {
+      return fallback.find_all_in(haystack);
+    }
+    std::vector<size_t> res;
+    size_t pos = find_in(haystack);
+    for (; pos != string::npos; pos = find_in(haystack, pos + 1)) {
+      res.push_back(pos);
+    }
+    return res;
+  }
 };
 
-/*** Example Usage ***/
+/*** Example Usage and Output:
+
+Searching 32 MB for "#":
+  std::string::find: 0.002657s
+  memmem: 0.002388s
+  kmp: 0.018972s
+  substring_searcher: 0.002553s
+Searching 32 MB for "the#":
+  std::string::find: 0.017889s
+  memmem: 0.011551s
+  kmp: 0.034832s
+  substring_searcher: 0.00404s
+Searching 32 MB for a 21-character needle:
+  std::string::find: 0.017197s
+  memmem: 0.005605s
+  kmp: 0.036319s
+  substring_searcher: 0.00458s
+Searching 32 MB for "abab..." of length 16:
+  std::string::find: 0.017903s
+  memmem: 0.004074s
+  kmp: 0.035926s
+  substring_searcher: 0.004556s
+Searching 16 MB for a^40 b a^40 in a text of only a's:
+  std::string::find: 0.131226s
+  memmem: 0.100175s
+  kmp: 0.053792s
+  substring_searcher: 0.059085s
+Searching 32 MB for "ERROR" (592 matches):
+  memmem on the whole buffer: 0.027076s
+  kmp_stream in 64 KB chunks: 0.034462s
+Searching 32 MB for "timeout" (1 matches):
+  memmem on the whole buffer: 0.009963s
+  kmp_stream in 64 KB chunks: 0.047494s
+
+***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+using namespace std;
+
+struct collect {
+  vector<long long> *res;
+
+  collect(vector<long long> *res) : res(res) {}
+
+  void operator()(long long pos) {
+    res->push_back(pos);
+  }
+};
+
+void test_stream(const string &haystack, const string &needle) {
+  vector<long long> expected, res;
+  for (int i = 0; i + needle.size() <= haystack.size(); i++) {
+    if (haystack.compare(i, needle.size(), needle) == 0) {
+      expected.push_back(i);
+    }
+  }
+  kmp_stream stream(needle);
+  for (int i = 0; i < (int)haystack.size(); ) {
+    int len = min((int)haystack.size() - i, rand() % 8);
+    stream.feed(haystack.data() + i, len, collect(&res));
+    i += len;
+  }
+  assert(res == expected && stream.position() == (long long)haystack.size());
+}
+
+struct counter {
+  long long *count;
+
+  counter(long long *count) : count(count) {}
+
+  void operator()(long long pos) {
+    ++*count;
+  }
+};
+
+void test_searcher(const string &haystack, const string &needle) {
+  kmp k(needle);
+  substring_searcher searcher(needle);
+  vector<size_t> expected;
+  for (size_t from = 0; from <= haystack.size() + 1; from++) {
+    size_t pos = haystack.find(needle, from);
+    assert(k.find_in(haystack, from) == pos);
+    assert(searcher.find_in(haystack, from) == pos);
+    if (pos == from && !needle.empty()) {
+      expected.push_back(pos);
+    }
+  }
+  assert(k.find_all_in(haystack) == expected);
+  assert(searcher.find_all_in(haystack) == expected);
+}
+
+void benchmark_searcher(const string &haystack, const string &needle,
+                        const string &label) {
+  clock_t start = clock();
+  size_t pos1 = haystack.find(needle);
+  double find_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  const char *p = (const char*)memmem(haystack.data(), haystack.size(),
+                                      needle.data(), needle.size());
+  size_t pos2 = (p == NULL) ? string::npos : p - haystack.data();
+  double memmem_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  size_t pos3 = kmp(needle).find_in(haystack);
+  double kmp_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  size_t pos4 = substring_searcher(needle).find_in(haystack);
+  double searcher_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  assert(pos1 == pos2 && pos2 == pos3 && pos3 == pos4);
+  cout << "Searching " << haystack.size()/(1 << 20) << " MB for " << label
+       << ":" << endl;
+  cout << "  std::string::find: " << find_time << "s" << endl;
+  cout << "  memmem: " << memmem_time << "s" << endl;
+  cout << "  kmp: " << kmp_time << "s" << endl;
+  cout << "  substring_searcher: " << searcher_time << "s" << endl;
+}
+
+void benchmark(int size, int chunk, const string &needle) {
+  string data(size, ' ');
+  for (int i = 0; i < size; i++) {
+    data[i] = (rand() % 8 == 0) ? ' ' : "ERROR: timeout\n"[rand() % 15];
+  }
+  clock_t start = clock();
+  long long count1 = 0;
+  const char *p = data.data(), *end = p + size;
+  while ((p = (const char*)memmem(p, end - p, needle.data(),
+                                   needle.size())) != NULL) {
+    count1++;
+    p++;
+  }
+  double memmem_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  long long count2 = 0;
+  kmp_stream stream(needle);
+  for (int i = 0; i < size; i += chunk) {
+    stream.feed(data.data() + i, min(chunk, size - i), counter(&count2));
+  }
+  double stream_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  assert(count1 == count2);
+  cout << "Searching " << size/(1 << 20) << " MB for \"" << needle << "\" ("
+       << count1 << " matches):" << endl;
+  cout << "  memmem on the whole buffer: " << memmem_time << "s" << endl;
+  cout << "  kmp_stream in " << chunk/1024 << " KB chunks: " << stream_time
+       << "s" << endl;
+}
 
 int main() {
   assert(15 == kmp("ABCDABD").find_in("ABC ABCDAB ABCDABCDABDE"));
+
+  vector<long long> res;
+  kmp_stream stream("aba");
+  stream.feed("xab", 3, collect(&res));
+  stream.feed("ababa", 5, collect(&res));
+  stream.feed("", 0, collect(&res));
+  stream.feed("ba", 2, collect(&res));
+  assert(res.size() == 4 && res[0] == 1 && res[1] == 3 && res[2] == 5);
+  assert(res[3] == 7 && stream.position() == 10);
+  stream.reset();
+  res.clear();
+  stream.feed("aba", 3, collect(&res));
+  assert(res.size() == 1 && res[0] == 0);
+  for (int i = 0; i < 3000; i++) {
+    string haystack(rand() % 60, 'a'), needle(1 + rand() % 5, 'a');
+    for (int j = 0; j < (int)haystack.size(); j++) {
+      haystack[j] += rand() % (1 + i % 3);
+    }
+    for (int j = 0; j < (int)needle.size(); j++) {
+      needle[j] += rand() % (1 + i % 3);
+    }
+    test_stream(haystack, needle);
+  }
+  for (int i = 0; i < 3000; i++) {
+    string haystack(rand() % 80, 'a'), needle(rand() % 6, 'a');
+    for (int j = 0; j < (int)haystack.size(); j++) {
+      haystack[j] += rand() % (1 + i % 3);
+    }
+    for (int j = 0; j < (int)needle.size(); j++) {
+      needle[j] += rand() % (1 + i % 3);
+    }
+    test_searcher(haystack, needle);
+  }
+  string sparse = string(40, 'a') + "b" + string(40, 'a');
+  test_searcher(string(300, 'a'), sparse);
+  test_searcher(string(300, 'a') + sparse + "a", sparse);
+
+  string text(1 << 25, ' ');
+  for (int i = 0; i < (int)text.size(); i++) {
+    text[i] = "abcdefghijklmnopqrstuvwxyz    "[rand() % 30];
+  }
+  benchmark_searcher(text, "#", "\"#\"");
+  benchmark_searcher(text, "the#", "\"the#\"");
+  benchmark_searcher(text, "quick brown fox jumps", "a 21-character needle");
+  benchmark_searcher(text, "abababababababab", "\"abab...\" of length 16");
+  benchmark_searcher(string(1 << 24, 'a'), sparse,
+                     "a^40 b a^40 in a text of only a's");
+  benchmark(1 << 25, 1 << 16, "ERROR");
+  benchmark(1 << 25, 1 << 16, "timeout");
   return 0;
 }
@@ -21,6 +21,29 @@ the log factors from the time complexities.
   occurs. The matches will be reported in increasing order of their ending
   positions within the haystack.
 
+A compiled_aho_corasick instead precomputes the full deterministic automaton,
+following every failure link in advance, so that matching costs exactly one
+table lookup per character of the haystack. Each byte is first mapped to a byte
+class, where every character used in the needles has its own class and all other
+characters share class 0, and the transitions are stored in a single flat array
+with one row of k + 1 entries per state. Instead of a set of outputs per state,
+each state stores the first needle ending there (with identical needles chained
+together) and a dictionary suffix link to the nearest state along its failure
+links at which a needle ends.
+
+- compiled_aho_corasick(needles) constructs the automaton for a set of needles.
+- find_all_in(haystack, report_match) is the same as above, except that matches
+  ending at the same position are reported from the longest needle to the
+  shortest.
+- find_all_in_parallel(haystack, report_match, chunk_size) reports the same
+  matches in the same order as find_all_in(), but splits the haystack into
+  chunks of the given size to be scanned in parallel using OpenMP, sharing the
+  automaton between threads. Each chunk is only reported for matches ending
+  within it, but its scan starts l - 1 characters early, where l is the length
+  of the longest needle, since the state of the automaton only depends on the
+  last l characters read. Matches are buffered for each chunk, then reported in
+  order by the calling thread.
+
 Time Complexity:
 - O(m*((log m) + l*log k)) per call to the constructor, where m is the number of
   needles, l is the maximum length for any needle, and k is the size of the
@@ -30,18 +53,26 @@ Time Complexity:
   the length of haystack, k is the size of the alphabet used by the needles, and
   z is the number of matches. If unordered containers are used, then the time
   complexity reduces to O(n + z), or linear on the input size.
+- O(m*l*k) per call to the compiled_aho_corasick constructor, and O(n + z) per
+  call to its find_all_in(haystack, report_match).
+- O(n*(1 + l/c)/p + z) per call to find_all_in_parallel(haystack, report_match,
+  c), where p is the number of threads.
 
 Space Complexity:
 - O(m*l) for storage of the automaton, where where m is the number of needles
   and l is the maximum length for any needle.
+- O(m*l*k) for storage of the compiled automaton.
 - O(1) auxiliary space per call to find_all_in(haystack, report_match).
+- O(z) auxiliary space per call to find_all_in_parallel().
 
 */
 
+#include <algorithm>
 #include <map>
 #include <queue>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 using std::string;
 
@@ -53,10 +84,11 @@ class aho_corasick {
 
   int next_state(int curr, char c) {
     int next = curr;
-    while (graph[next].find(c) == graph[next].end()) {
+    while (next > 0 && graph[next].find(c) == graph[next].end()) {
       next = fail[next];
     }
-    return graph[next][c];
+    std::map<char, int>::iterator it = graph[next].find(c);
+    return (it == graph[next].end()) ? 0 : it->second;
   }
 
  public:
@@ -65,9 +97,9 @@ class aho_corasick {
     for (int i = 0; i < (int)needles.size(); i++) {
       total_len += needles[i].size();
     }
-    fail.resize(total_len, -1);
-    graph.resize(total_len);
-    out.resize(total_len);
+    fail.resize(total_len + 1, -1);
+    graph.resize(total_len + 1);
+    out.resize(total_len + 1);
     int states = 1;
     std::map<char, int>::iterator it;
     for (int i = 0; i < (int)needles.size(); i++) {
@@ -93,12 +125,9 @@ class aho_corasick {
       int u = q.front();
       q.pop();
       for (it = graph[u].begin(); it != graph[u].end(); ++it) {
-        int v = it->second, f = fail[u];
-        while (graph[f].find(it->first) == graph[f].end()) {
-          f = fail[f];
-        }
-        f = graph[f].find(it->first)->second;
-        fail[v] = f;
+        int v = it->second;
+        fail[v] = next_state(fail[u], it->first);
+        int f = fail[v];
         out[v].insert(out[f].begin(), out[f].end());
         q.push(v);
       }
@@ -118,6 +147,118 @@ class aho_corasick {
   }
 };
 
+class compiled_aho_corasick {
+  std::vector<string> needles;
+  int classes, overlap;
+  int byte_class[256];
+  std::vector<int> delta, first_match, next_match, dict;
+
+ public:
+  compiled_aho_corasick(const std::vector<string> &needles)
+      : needles(needles), classes(1), overlap(0), first_match(1, -1),
+        dict(1, -1) {
+    for (int c = 0; c < 256; c++) {
+      byte_class[c] = 0;
+    }
+    for (int i = 0; i < (int)needles.size(); i++) {
+      overlap = std::max(overlap, (int)needles[i].size() - 1);
+      for (int j = 0; j < (int)needles[i].size(); j++) {
+        int &cls = byte_class[(unsigned char)needles[i][j]];
+        if (cls == 0) {
+          cls = classes++;
+        }
+      }
+    }
+    delta.assign(classes, -1);
+    next_match.assign(needles.size(), -1);
+    for (int i = 0; i < (int)needles.size(); i++) {
+      int curr = 0;
+      for (int j = 0; j < (int)needles[i].size(); j++) {
+        int c = byte_class[(unsigned char)needles[i][j]];
+        if (delta[curr*classes + c] < 0) {
+          delta[curr*classes + c] = first_match.size();
+          first_match.push_back(-1);
+          dict.push_back(-1);
+          delta.resize(delta.size() + classes, -1);
+        }
+        curr = delta[curr*classes + c];
+      }
+      next_match[i] = first_match[curr];
+      first_match[curr] = i;
+    }
+    // Breadth-first search, where the failure link of each state has already
+    // been completed since it is strictly shallower.
+    std::vector<int> fail(first_match.size(), 0);
+    std::queue<int> q;
+    for (int c = 0; c < classes; c++) {
+      int &v = delta[c];
+      if (v < 0) {
+        v = 0;
+      } else {
+        q.push(v);
+      }
+    }
+    while (!q.empty()) {
+      int u = q.front();
+      q.pop();
+      int f = fail[u];
+      dict[u] = (first_match[f] >= 0) ? f : dict[f];
+      for (int c = 0; c < classes; c++) {
+        int &v = delta[u*classes + c];
+        if (v < 0) {
+          v = delta[f*classes + c];
+        } else {
+          fail[v] = delta[f*classes + c];
+          q.push(v);
+        }
+      }
+    }
+  }
+
+  template<class ReportFunction>
+  void find_all_in(const string &haystack, ReportFunction report_match) const {
+    const int *table = &delta[0];
+    int state = 0;
+    for (int i = 0; i < (int)haystack.size(); i++) {
+      state = table[state*classes + byte_class[(unsigned char)haystack[i]]];
+      int s = (first_match[state] >= 0) ? state : dict[state];
+      for (; s >= 0; s = dict[s]) {
+        for (int j = first_match[s]; j >= 0; j = next_match[j]) {
+          report_match(needles[j], i - needles[j].size() + 1);
+        }
+      }
+    }
+  }
+
+  template<class ReportFunction>
+  void find_all_in_parallel(const string &haystack, ReportFunction report_match,
+                            int chunk_size = 1 << 16) const {
+    int n = haystack.size(), num_chunks = (n + chunk_size - 1)/chunk_size;
+    std::vector<std::vector<std::pair<int, int> > > matches(num_chunks);
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int c = 0; c < num_chunks; c++) {
+      const int *table = &delta[0];
+      int lo = c*chunk_size, hi = std::min(n, lo + chunk_size), state = 0;
+      for (int i = std::max(0, lo - overlap); i < hi; i++) {
+        state = table[state*classes + byte_class[(unsigned char)haystack[i]]];
+        int s = (i < lo) ? -1 : (first_match[state] >= 0) ? state : dict[state];
+        for (; s >= 0; s = dict[s]) {
+          for (int j = first_match[s]; j >= 0; j = next_match[j]) {
+            matches[c].push_back(std::make_pair(i - needles[j].size() + 1, j));
+          }
+        }
+      }
+    }
+    for (int c = 0; c < num_chunks; c++) {
+      for (int i = 0; i < (int)matches[c].size(); i++) {
+        report_match(needles[matches[c][i].second], matches[c][i].first);
+      }
+    }
+  }
+};
+
 /*** Example Usage and Output:
 
 Matched "a" at position 0.
@@ -128,16 +269,115 @@ Matched "c" at position 3.
 Matched "a" at position 4.
 Matched "ab" at position 4.
 Matched "abccab" at position 0.
+50000 needles in a haystack of length 4194304:
+  aho_corasick: build 0.360667s, match 2.39983s
+  compiled_aho_corasick: build 0.28289s, match 0.486927s
+  find_all_in_parallel: 0.503262s
 
 ***/
 
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 using namespace std;
 
+double wall_time() {
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
 void report_match(const string &needle, int pos) {
   cout << "Matched \"" << needle << "\" at position " << pos << "." << endl;
 }
 
+struct collect {
+  vector<pair<int, string> > *res;
+
+  collect(vector<pair<int, string> > *res) : res(res) {}
+
+  void operator()(const string &needle, int pos) {
+    res->push_back(make_pair(pos + (int)needle.size(), needle));
+  }
+};
+
+struct counter {
+  long long *count;
+
+  counter(long long *count) : count(count) {}
+
+  void operator()(const string &needle, int pos) {
+    *count += pos;
+  }
+};
+
+string random_string(int len, int alphabet) {
+  string res(len, 'a');
+  for (int i = 0; i < len; i++) {
+    res[i] += rand() % alphabet;
+  }
+  return res;
+}
+
+void test_compiled(int num_needles, int alphabet) {
+  vector<string> needles;
+  for (int i = 0; i < num_needles; i++) {
+    needles.push_back(random_string(1 + rand() % 5, alphabet));
+  }
+  string haystack = random_string(rand() % 200, alphabet + 1);
+  vector<pair<int, string> > res1, res2;
+  aho_corasick(needles).find_all_in(haystack, collect(&res1));
+  compiled_aho_corasick cac(needles);
+  cac.find_all_in(haystack, collect(&res2));
+  vector<pair<int, string> > res3;
+  cac.find_all_in_parallel(haystack, collect(&res3), 1 + rand() % 8);
+  assert(res2 == res3);
+  sort(res1.begin(), res1.end());
+  sort(res2.begin(), res2.end());
+  assert(res1 == res2);
+}
+
+void benchmark(int num_needles, int haystack_len) {
+  vector<string> needles;
+  for (int i = 0; i < num_needles; i++) {
+    needles.push_back(random_string(4 + rand() % 16, 26));
+  }
+  string haystack = random_string(haystack_len, 26);
+  clock_t start = clock();
+  aho_corasick ac(needles);
+  double build1 = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  long long sum1 = 0;
+  ac.find_all_in(haystack, counter(&sum1));
+  double match1 = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  compiled_aho_corasick cac(needles);
+  double build2 = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  long long sum2 = 0;
+  cac.find_all_in(haystack, counter(&sum2));
+  double match2 = (double)(clock() - start)/CLOCKS_PER_SEC;
+  double wall_start = wall_time();
+  long long sum3 = 0;
+  cac.find_all_in_parallel(haystack, counter(&sum3));
+  double match3 = wall_time() - wall_start;
+  assert(sum1 == sum2 && sum2 == sum3);
+  cout << num_needles << " needles in a haystack of length " << haystack_len
+       << ":" << endl;
+  cout << "  aho_corasick: build " << build1 << "s, match " << match1 << "s"
+       << endl;
+  cout << "  compiled_aho_corasick: build " << build2 << "s, match " << match2
+       << "s" << endl;
+  cout << "  find_all_in_parallel: " << match3 << "s" << endl;
+}
+
 int main() {
   vector<string> needles;
   needles.push_back("a");
@@ -150,5 +390,16 @@ int main() {
   needles.push_back("abccab");
 
   aho_corasick(needles).find_all_in("abccab", report_match);
+
+  vector<pair<int, string> > res;
+  needles.push_back("ab");
+  compiled_aho_corasick(needles).find_all_in("abccab", collect(&res));
+  assert(res.size() == 10 && res[0] == make_pair(1, string("a")));
+  assert(res[1].second == "ab" && res[2].second == "ab");
+  assert(res[7] == make_pair(6, string("abccab")) && res[9].second == "ab");
+  for (int i = 0; i < 2000; i++) {
+    test_compiled(1 + rand() % 20, 1 + rand() % 4);
+  }
+  benchmark(50000, 1 << 22);
   return 0;
 }
@@ -20,35 +20,40 @@ tokenization process may be ambiguous. For example, if ++ and + are both
 operators, then ++ may be split into either ["+", "+"] or ["++"] depending on
 the lexicographical ordering of conflicting operators.
 
+Operators are stored in a trie built once during construction, so that
+tokenization and evaluation look them up by walking characters in place rather
+than by constructing and comparing temporary strings. Tokens are non-owning
+string_ref views into the input, which must outlive them.
+
 - parser(unary_op, binary_op) initializes a parser with operators specified by
   maps unary_op (of operator to function pointer) and binary_op (of operator to
   pair of function pointer and operator precedence). Operator precedences should
   be numbered upwards starting at 0 (lowest precedence, evaluated last).
-- split(s) returns a vector of tokens for the expression s, split on the given
-  operators during construction. Each parenthesis, operator, and operand
-  satisfying is_operand() will be split into a separate token. The algorithm is
-  naive, matching operators lazily in the case of overlapping operators as
-  mentioned above. Under these circumstances, the parse may not always succeed.
+- tokenize(s, res) fills the vector res with the tokens of the expression s,
+  split on the given operators during construction. Each parenthesis, operator,
+  and operand satisfying is_operand() will be split into a separate token, which
+  holds its kind, a string_ref to its text in s, and the ID of its operator.
+  Reusing res across calls avoids any allocation.
+- split(s) returns the text of each token from tokenize(s) as a vector of
+  strings. The algorithm is naive, matching operators lazily in the case of
+  overlapping operators as mentioned above. Under these circumstances, the parse
+  may not always succeed.
 - eval(lo, hi) returns the evaluation of a range [lo, hi) of already split-up
   expression tokens, where lo and hi must be random-access iterators.
-- eval(s) returns the evaluation of expression s, after first calling split(s)
-  to obtain the tokens.
+- eval(s) returns the evaluation of expression s, after first calling
+  tokenize(s) to obtain the tokens.
 
 Time Complexity:
-- O(m) per call to the constructor, where m is the total number of operators.
-- O(nmk) per call to split(s), where n is the length of s, m is the total number
-  of operators defined for the parser instance, and k is the maximum length for
-  any operator representation.
-- O(n log m) per call to eval(lo, hi), where n is the distance between lo and hi
-  and m is the total number of operators defined for the parser instance. In
-  C++11 and later, std::unordered_map may be used in place of std::map for
-  storing the unary_ops and binary_ops, which will eliminate the log m factor
-  for a time complexity of O(n) per call.
-- O(nmk + n log m) per call to eval(s), where n is the distance between lo and
-  hi, and m and k are as defined previous.
+- O(mk) per call to the constructor, where m is the total number of operators
+  and k is the maximum length for any operator representation.
+- O(nk) per call to tokenize(s) and split(s), where n is the length of s, since
+  each operator lookup walks at most k trie nodes, independently of m.
+- O(nk + np) per call to eval(lo, hi), where n is the total length of the
+  tokens in the range [lo, hi) and p is the number of distinct precedences.
+- O(nk + np) per call to eval(s).
 
 Space Complexity:
-- O(mk) for storage of the m operators, of maximum length k.
+- O(mk) for storage of the trie of m operators, of maximum length k.
 - O(n) auxiliary stack space for split(s), eval(lo, hi), and eval(s), where n is
   the length of the argument.
 
@@ -56,169 +61,279 @@ Space Complexity:
 
 #include <algorithm>
 #include <cctype>
-#include <functional>
+#include <cstdlib>
+#include <cstring>
 #include <map>
-#include <set>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 using std::string;
 
+// A non-owning reference to a range of characters, which must outlive it.
+struct string_ref {
+  const char *data;
+  int size;
+
+  string_ref(const char *data, int size) : data(data), size(size) {}
+  string_ref(const string &s) : data(s.data()), size(s.size()) {}
+
+  string str() const {
+    return string(data, size);
+  }
+};
+
 // Define the custom operand type and representation below.
 typedef double Operand;
 typedef Operand (*UnaryOp)(Operand a);
 typedef Operand (*BinaryOp)(Operand a, Operand b);
 
-bool is_operand(const string &s) {
+bool is_operand(string_ref s) {
   int npoints = 0;
-  for (int i = 0; i < (int)s.size(); i++) {
-    if (s[i] == '.') {
+  for (int i = 0; i < s.size; i++) {
+    if (s.data[i] == '.') {
       if (++npoints > 1) {
         return false;
       }
-    } else if (!isdigit(s[i])) {
+    } else if (!isdigit((unsigned char)s.data[i])) {
       return false;
     }
   }
-  return !s.empty();
+  return s.size > 0;
 }
 
-Operand eval_operand(const string &s) {
-  Operand res;
-  std::stringstream ss(s);
-  ss >> res;
-  return res;
+Operand eval_operand(string_ref s) {
+  char buf[64];
+  if (s.size >= 64) {
+    return strtod(s.str().c_str(), NULL);
+  }
+  memcpy(buf, s.data, s.size);
+  buf[s.size] = '\0';
+  return strtod(buf, NULL);
 }
 
 class parser {
+ public:
+  enum token_kind { OPERAND, OPERATOR, LEFT_PAREN, RIGHT_PAREN };
+
+  struct token {
+    token_kind kind;
+    int id;
+    string_ref text;
+
+    token(token_kind kind, int id, string_ref text)
+        : kind(kind), id(id), text(text) {}
+  };
+
+ private:
   typedef std::map<string, UnaryOp> unary_op_map;
   typedef std::map<string, std::pair<BinaryOp, int> > binary_op_map;
-  unary_op_map unary_ops;
-  binary_op_map binary_ops;
-  std::set<string> ops;
+
+  struct op_info {
+    string name;
+    UnaryOp unary_op;
+    BinaryOp binary_op;
+    int precedence;
+  };
+
+  // The trie stores a row of 256 children for every node, where trie_op[u] is
+  // the ID (the index in ops) of the operator ending at node u, or -1.
+  std::vector<int> trie, trie_op;
+  std::vector<op_info> ops;
   int max_precedence;
 
-  template<class StrIt>
-  Operand eval_unary(StrIt &lo, StrIt hi) {
-    if (is_operand(*lo)) {
-      return eval_operand(*(lo++));
+  int add_op(const string &name) {
+    int u = 0;
+    for (int i = 0; i < (int)name.size(); i++) {
+      int c = (unsigned char)name[i];
+      if (trie[u*256 + c] < 0) {
+        trie[u*256 + c] = trie_op.size();
+        trie_op.push_back(-1);
+        trie.resize(trie.size() + 256, -1);
+      }
+      u = trie[u*256 + c];
+    }
+    if (trie_op[u] < 0) {
+      trie_op[u] = ops.size();
+      op_info op = {name, NULL, NULL, -1};
+      ops.push_back(op);
+    }
+    return trie_op[u];
+  }
+
+  // Returns the ID of the shortest operator starting at lo and ending by hi
+  // (which is also the lexicographically first), or -1 if there is none.
+  int match_op(const char *lo, const char *hi) const {
+    for (int u = 0; lo < hi && (u = trie[u*256 + (unsigned char)*lo]) >= 0;
+         lo++) {
+      if (trie_op[u] >= 0) {
+        return trie_op[u];
+      }
     }
-    unary_op_map::iterator it = unary_ops.find(*lo);
-    if (it != unary_ops.end()) {
-      return (it->second)(eval_unary(++lo, hi));
+    return -1;
+  }
+
+  int find_op(const string &s) const {
+    int u = 0;
+    for (int i = 0; i < (int)s.size() && u >= 0; i++) {
+      u = trie[u*256 + (unsigned char)s[i]];
     }
-    if (*lo != "(") {
+    return (u < 0) ? -1 : trie_op[u];
+  }
+
+  Operand eval_unary(const token *&lo, const token *hi) const {
+    if (lo == hi) {
+      throw std::runtime_error("Unexpected end of input during eval.");
+    }
+    if (lo->kind == OPERAND) {
+      return eval_operand((lo++)->text);
+    }
+    if (lo->kind == OPERATOR && ops[lo->id].unary_op != NULL) {
+      UnaryOp op = ops[lo->id].unary_op;
+      return op(eval_unary(++lo, hi));
+    }
+    if (lo->kind != LEFT_PAREN) {
       throw std::runtime_error("Expected \"(\" during eval.");
     }
     Operand res = eval_binary(++lo, hi, 0);
-    if (*lo != ")") {
+    if (lo == hi || lo->kind != RIGHT_PAREN) {
       throw std::runtime_error("Expected \")\" during eval.");
     }
     ++lo;
     return res;
   }
 
-  template<class StrIt>
-  Operand eval_binary(StrIt &lo, StrIt hi, Operand precedence) {
+  Operand eval_binary(const token *&lo, const token *hi,
+                      int precedence) const {
     if (precedence > max_precedence) {
       return eval_unary(lo, hi);
     }
     Operand v = eval_binary(lo, hi, precedence + 1);
     while (lo != hi) {
-      binary_op_map::iterator it;
-      it = binary_ops.find(*lo);
-      if (it == binary_ops.end() || it->second.second != precedence) {
+      if (lo->kind != OPERATOR || ops[lo->id].binary_op == NULL ||
+          ops[lo->id].precedence != precedence) {
         return v;
       }
-      v = (it->second.first)(v, eval_binary(++lo, hi, precedence + 1));
+      BinaryOp op = ops[lo->id].binary_op;
+      v = op(v, eval_binary(++lo, hi, precedence + 1));
     }
     return v;
   }
 
-  static string strip(string s) {
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(),
-            std::not1(std::ptr_fun<int, int>(std::isspace))));
-    s.erase(std::find_if(s.rbegin(), s.rend(),
-            std::not1(std::ptr_fun<int, int>(std::isspace))).base(), s.end());
-    return s;
+  Operand eval_tokens(const token *lo, const token *hi) const {
+    Operand res = eval_binary(lo, hi, 0);
+    if (lo != hi) {
+      throw std::runtime_error("Eval failed at token " + lo->text.str() + ".");
+    }
+    return res;
+  }
+
+  static string_ref strip(const char *lo, const char *hi) {
+    while (lo < hi && isspace((unsigned char)*lo)) {
+      lo++;
+    }
+    while (hi > lo && isspace((unsigned char)hi[-1])) {
+      hi--;
+    }
+    return string_ref(lo, hi - lo);
   }
 
  public:
   parser(const unary_op_map &unary_ops, const binary_op_map &binary_ops)
-      : unary_ops(unary_ops), binary_ops(binary_ops) {
+      : trie(256, -1), trie_op(1, -1), max_precedence(0) {
     for (unary_op_map::const_iterator it = unary_ops.begin();
          it != unary_ops.end(); ++it) {
-      ops.insert(it->first);
+      ops[add_op(it->first)].unary_op = it->second;
     }
-    max_precedence = 0;
     for (binary_op_map::const_iterator it = binary_ops.begin();
          it != binary_ops.end(); ++it) {
-      ops.insert(it->first);
+      int id = add_op(it->first);
+      ops[id].binary_op = it->second.first;
+      ops[id].precedence = it->second.second;
       max_precedence = std::max(max_precedence, it->second.second);
     }
   }
 
-  std::vector<string> split(const string &s) {
-    std::vector<string> res;
-    for (int i = 0; i < (int)s.size(); i++) {
-      if (s[i] == ' ') {
+  void tokenize(const string &s, std::vector<token> &res) const {
+    res.clear();
+    const char *str = s.c_str();
+    int n = s.size();
+    for (int i = 0; i < n; i++) {
+      if (str[i] == ' ') {
         continue;
       }
-      int next_paren = s.size();
-      for (int j = i; j < (int)s.size(); j++) {
-        if (s[j] == '(' || s[j] == ')') {
+      int next_paren = n;
+      for (int j = i; j < n; j++) {
+        if (str[j] == '(' || str[j] == ')') {
           next_paren = j;
           break;
         }
       }
       while (i < next_paren) {
-        int found = next_paren;
-        string found_op;
-        for (int j = i; j < next_paren && found == next_paren; j++) {
-          for (std::set<string>::iterator it = ops.begin();
-               it != ops.end(); ++it) {
-            if (s.substr(j, it->size()) == *it) {
-              found = j;
-              found_op = *it;
-              break;
-            }
+        int found = next_paren, op = -1;
+        for (int j = i; j < next_paren && op < 0; j++) {
+          if ((op = match_op(str + j, str + next_paren)) >= 0) {
+            found = j;
           }
         }
-        string term = strip(s.substr(i, found - i));
-        if (!term.empty()) {
-          res.push_back(term);
+        string_ref term = strip(str + i, str + found);
+        if (term.size > 0) {
           if (!is_operand(term)) {
-            throw std::runtime_error("Failed to split term: \"" + term + "\".");
+            throw std::runtime_error("Failed to split term: \"" + term.str() +
+                                     "\".");
           }
+          res.push_back(token(OPERAND, -1, term));
         }
-        if (found < next_paren) {
-          res.push_back(found_op);
-          i = found + found_op.size();
+        if (op >= 0) {
+          int len = ops[op].name.size();
+          res.push_back(token(OPERATOR, op, string_ref(str + found, len)));
+          i = found + len;
         } else {
           i = next_paren;
         }
       }
-      if (next_paren < s.size()) {
-        res.push_back(string(1, s[next_paren]));
+      if (next_paren < n) {
+        res.push_back(token(str[next_paren] == '(' ? LEFT_PAREN : RIGHT_PAREN,
+                            -1, string_ref(str + next_paren, 1)));
       }
     }
+  }
+
+  std::vector<string> split(const string &s) const {
+    std::vector<token> tokens;
+    tokenize(s, tokens);
+    std::vector<string> res;
+    for (int i = 0; i < (int)tokens.size(); i++) {
+      res.push_back(tokens[i].text.str());
+    }
     return res;
   }
 
   template<class StrIt>
-  Operand eval(StrIt lo, StrIt hi) {
-    Operand res = eval_binary(lo, hi, 0);
-    if (lo != hi) {
-      throw std::runtime_error("Eval failed at token " + *lo + ".");
+  Operand eval(StrIt lo, StrIt hi) const {
+    std::vector<token> tokens;
+    for (; lo != hi; ++lo) {
+      const string &s = *lo;
+      int op = find_op(s);
+      if (is_operand(s)) {
+        tokens.push_back(token(OPERAND, -1, s));
+      } else if (s == "(" || s == ")") {
+        tokens.push_back(token(s == "(" ? LEFT_PAREN : RIGHT_PAREN, -1, s));
+      } else if (op >= 0) {
+        tokens.push_back(token(OPERATOR, op, s));
+      } else {
+        throw std::runtime_error("Eval failed at token " + s + ".");
+      }
     }
-    return res;
+    return tokens.empty() ? eval_tokens(NULL, NULL)
+                          : eval_tokens(&tokens[0], &tokens[0] + tokens.size());
   }
 
-  Operand eval(const string &s) {
-    std::vector<string> tokens = split(s);
-    return eval(tokens.begin(), tokens.end());
+  Operand eval(const string &s) const {
+    std::vector<token> tokens;
+    tokenize(s, tokens);
+    return tokens.empty() ? eval_tokens(NULL, NULL)
+                          : eval_tokens(&tokens[0], &tokens[0] + tokens.size());
   }
 };
 
@@ -261,5 +376,24 @@ int main() {
             351854.28968253968));
   assert(EQ(p.eval("-(5-(5-(5-(5-(5-2)))))+(3-(3-(3-(3-(3+3)))))*"
                    "(7-(7-(7-(7-(7-7+4*5)))))"), 117));
+
+  vector<parser::token> tokens;
+  string expr = "2.5*(1 - -1)";
+  p.tokenize(expr, tokens);
+  assert(tokens.size() == 8);
+  assert(tokens[0].text.data == expr.c_str() && tokens[0].text.str() == "2.5");
+  assert(tokens[2].kind == parser::LEFT_PAREN);
+  assert(tokens[4].kind == parser::OPERATOR && tokens[4].text.str() == "-");
+  assert(tokens[5].kind == parser::OPERATOR && tokens[5].id == tokens[4].id);
+  vector<string> parts = p.split(expr);
+  assert(parts.size() == 8 && parts[3] == "1" && parts[7] == ")");
+  assert(EQ(p.eval(parts.begin(), parts.end()), 5));
+  const char *bad[] = {"1 +", "(1", "1)", "2 * x", ""};
+  for (int i = 0; i < 5; i++) {
+    try {
+      p.eval(bad[i]);
+      assert(false);
+    } catch (runtime_error &) {}
+  }
   return 0;
 }
@@ -20,220 +20,522 @@ tokenization process may be ambiguous. For example, if ++ and + are both
 operators, then ++ may be split into either ["+", "+"] or ["++"] depending on
 the lexicographical ordering of conflicting operators.
 
+Operators are stored in a trie built once during construction, so that
+tokenization and compilation look them up by walking characters in place rather
+than by constructing and comparing temporary strings. Tokens are non-owning
+string_ref views into the input, which must outlive them.
+
 - parser(unary_op, binary_op) initializes a parser with operators specified by
   maps unary_op (of operator to function pointer) and binary_op (of operator to
   pair of function pointer and operator precedence). Operator precedences should
   be numbered upwards starting at 0 (lowest precedence, evaluated last).
-- split(s) returns a vector of tokens for the expression s, split on the given
-  operators during construction. Each parenthesis, operator, and operand
-  satisfying is_operand() will be split into a separate token. The algorithm is
-  naive, matching operators lazily in the case of overlapping operators as
-  mentioned above. Under these circumstances, the parse may not always succeed.
+- tokenize(s, res, variables) fills the vector res with the tokens of the
+  expression s, split on the given operators during construction. Each
+  parenthesis, operator, and operand satisfying is_operand() or equal to a name
+  in the optional vector variables will be split into a separate token, which
+  holds its kind, a string_ref to its text in s, and the ID of its operator or
+  the index of its variable. Reusing res across calls avoids any allocation. The
+  algorithm is naive, matching operators lazily in the case of overlapping
+  operators as mentioned above. Under these circumstances, the parse may not
+  always succeed.
+- split(s, variables) returns the text of each token from tokenize(s, ...) as a
+  vector of strings.
+- compile(lo, hi, variables) returns a compiled_expression for a range [lo, hi)
+  of already split-up expression tokens, where lo and hi must be random-access
+  iterators. Instead of evaluating operators as the shunting yard algorithm
+  pops them, their function pointers are appended to a flat program in reverse
+  Polish notation. Any operator applied only to constants is evaluated during
+  compilation (constant folding), so that "x*(2+3)" compiles to the program
+  [x, 5, *]. Tokens equal to the i-th name in variables read the i-th variable.
+- compile(s, variables) compiles the tokens from tokenize(s, ..., variables)
+  directly, without creating a string for any token.
 - eval(lo, hi) returns the evaluation of a range [lo, hi) of already split-up
-  expression tokens, where lo and hi must be random-access iterators.
-- eval(s) returns the evaluation of expression s, after first calling split(s)
-  to obtain the tokens.
+  expression tokens, by compiling and then running them.
+- eval(s) returns the evaluation of expression s, by compiling and then running
+  it.
+
+A compiled_expression may be run any number of times without any string work or
+memory allocation, using a value stack sized during compilation. Since the stack
+is reused, a single compiled_expression must not be run from multiple threads
+at once (each thread may use its own copy).
+
+- size() returns the number of instructions in the program.
+- run(variables) returns the value of the expression, where variables[i] is the
+  value of the i-th variable.
+- run_batch(columns, n, out) evaluates the expression for n rows, where
+  columns[i][r] is the value of the i-th variable for row r, storing the result
+  for row r into out[r]. Instructions are run one at a time over blocks of 256
+  rows, so that the cost of dispatching each instruction is shared by a block.
 
 Time Complexity:
-- O(m) per call to the constructor, where m is the total number of operators.
-- O(nmk) per call to split(s), where n is the length of s, m is the total number
-  of operators defined for the parser instance, and k is the maximum length for
-  any operator representation.
-- O(n log m) per call to eval(lo, hi), where n is the distance between lo and hi
-  and m is the total number of operators defined for the parser instance. In
-  C++11 and later, std::unordered_map may be used in place of std::map for
-  storing the unary_ops and binary_ops, which will eliminate the log m factor
-  for a time complexity of O(n) per call.
-- O(nmk + n log m) per call to eval(s), where n is the distance between lo and
-  hi, and m and k are as defined previous.
+- O(mk) per call to the constructor, where m is the total number of operators
+  and k is the maximum length for any operator representation.
+- O(nk) per call to tokenize(s) and split(s), where n is the length of s, since
+  each operator lookup walks at most k trie nodes, independently of m.
+- O(nk) per call to eval(lo, hi), where n is the total length of the tokens in
+  the range [lo, hi).
+- O(nk) per call to eval(s).
+- O(n(k + v)) per call to compile(lo, hi, variables) and compile(s, variables),
+  where v is the number of variables.
+- O(p) per call to run(variables), and O(np) per call to run_batch(columns, n,
+  out), where p is the size of the program.
 
 Space Complexity:
-- O(mk) for storage of the m operators, of maximum length k.
+- O(mk) for storage of the trie of m operators, of maximum length k.
 - O(n) auxiliary stack space for split(s), eval(lo, hi), and eval(s), where n is
   the length of the argument.
+- O(n) for storage of a compiled_expression of n tokens, and O(1) auxiliary
+  space per call to run() and run_batch().
 
 */
 
 #include <algorithm>
 #include <cctype>
-#include <functional>
+#include <cstdlib>
+#include <cstring>
 #include <map>
-#include <set>
-#include <sstream>
-#include <stack>
 #include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 using std::string;
 
+// A non-owning reference to a range of characters, which must outlive it.
+struct string_ref {
+  const char *data;
+  int size;
+
+  string_ref(const char *data, int size) : data(data), size(size) {}
+  string_ref(const string &s) : data(s.data()), size(s.size()) {}
+
+  string str() const {
+    return string(data, size);
+  }
+};
+
 // Define the custom operand type and representation below.
 typedef double Operand;
 typedef Operand (*UnaryOp)(Operand a);
 typedef Operand (*BinaryOp)(Operand a, Operand b);
 
-bool is_operand(const string &s) {
+bool is_operand(string_ref s) {
   int npoints = 0;
-  for (int i = 0; i < (int)s.size(); i++) {
-    if (s[i] == '.') {
+  for (int i = 0; i < s.size; i++) {
+    if (s.data[i] == '.') {
       if (++npoints > 1) {
         return false;
       }
-    } else if (!isdigit(s[i])) {
+    } else if (!isdigit((unsigned char)s.data[i])) {
       return false;
     }
   }
-  return !s.empty();
+  return s.size > 0;
 }
 
-Operand eval_operand(const string &s) {
-  Operand res;
-  std::stringstream ss(s);
-  ss >> res;
-  return res;
+Operand eval_operand(string_ref s) {
+  char buf[64];
+  if (s.size >= 64) {
+    return strtod(s.str().c_str(), NULL);
+  }
+  memcpy(buf, s.data, s.size);
+  buf[s.size] = '\0';
+  return strtod(buf, NULL);
 }
 
+class compiled_expression {
+  friend class parser;
+  static const int BLOCK_SIZE = 256;
+  enum kind_t { CONSTANT, VARIABLE, UNARY, BINARY };
+
+  struct instruction {
+    kind_t kind;
+    int var;
+    Operand value;
+    UnaryOp unary_op;
+    BinaryOp binary_op;
+  };
+
+  std::vector<instruction> code;
+  int depth, max_depth;
+  mutable std::vector<Operand> stack, batch;
+
+  compiled_expression() : depth(0), max_depth(0) {}
+
+  void push(kind_t kind, int var, Operand value) {
+    instruction ins;
+    ins.kind = kind;
+    ins.var = var;
+    ins.value = value;
+    code.push_back(ins);
+    max_depth = std::max(max_depth, ++depth);
+  }
+
+  void push_unary(UnaryOp op) {
+    if (depth < 1) {
+      throw std::runtime_error("Missing operand for unary op.");
+    }
+    if (code.back().kind == CONSTANT) {
+      code.back().value = op(code.back().value);
+      return;
+    }
+    instruction ins;
+    ins.kind = UNARY;
+    ins.unary_op = op;
+    code.push_back(ins);
+  }
+
+  void push_binary(BinaryOp op) {
+    if (depth < 2) {
+      throw std::runtime_error("Missing operand for binary op.");
+    }
+    depth--;
+    int n = code.size();
+    if (code[n - 1].kind == CONSTANT && code[n - 2].kind == CONSTANT) {
+      code[n - 2].value = op(code[n - 2].value, code[n - 1].value);
+      code.pop_back();
+      return;
+    }
+    instruction ins;
+    ins.kind = BINARY;
+    ins.binary_op = op;
+    code.push_back(ins);
+  }
+
+ public:
+  int size() const {
+    return code.size();
+  }
+
+  Operand run(const Operand *variables = NULL) const {
+    Operand *s = &stack[0];
+    int top = 0;
+    for (int i = 0; i < (int)code.size(); i++) {
+      const instruction &ins = code[i];
+      switch (ins.kind) {
+        case CONSTANT: s[top++] = ins.value; break;
+        case VARIABLE: s[top++] = variables[ins.var]; break;
+        case UNARY: s[top - 1] = ins.unary_op(s[top - 1]); break;
+        case BINARY: top--; s[top - 1] = ins.binary_op(s[top - 1], s[top]);
+      }
+    }
+    return s[0];
+  }
+
+  void run_batch(const Operand *const *columns, int n, Operand *out) const {
+    for (int lo = 0; lo < n; lo += BLOCK_SIZE) {
+      int len = (n - lo < BLOCK_SIZE) ? n - lo : BLOCK_SIZE;
+      Operand *top = &batch[0];
+      for (int i = 0; i < (int)code.size(); i++) {
+        const instruction &ins = code[i];
+        if (ins.kind == CONSTANT) {
+          std::fill(top, top + len, ins.value);
+          top += BLOCK_SIZE;
+        } else if (ins.kind == VARIABLE) {
+          std::copy(columns[ins.var] + lo, columns[ins.var] + lo + len, top);
+          top += BLOCK_SIZE;
+        } else if (ins.kind == UNARY) {
+          Operand *a = top - BLOCK_SIZE;
+          for (int r = 0; r < len; r++) {
+            a[r] = ins.unary_op(a[r]);
+          }
+        } else {
+          top -= BLOCK_SIZE;
+          Operand *a = top - BLOCK_SIZE, *b = top;
+          for (int r = 0; r < len; r++) {
+            a[r] = ins.binary_op(a[r], b[r]);
+          }
+        }
+      }
+      std::copy(&batch[0], &batch[0] + len, out + lo);
+    }
+  }
+};
+
 class parser {
   typedef std::map<string, UnaryOp> unary_op_map;
   typedef std::map<string, std::pair<BinaryOp, int> > binary_op_map;
-  unary_op_map unary_ops;
-  binary_op_map binary_ops;
-  std::set<string> ops;
-
-  static string strip(string s) {
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(),
-            std::not1(std::ptr_fun<int, int>(std::isspace))));
-    s.erase(std::find_if(s.rbegin(), s.rend(),
-            std::not1(std::ptr_fun<int, int>(std::isspace))).base(), s.end());
-    return s;
+
+  struct op_info {
+    string name;
+    UnaryOp unary_op;
+    BinaryOp binary_op;
+    int precedence;
+  };
+
+  // The trie stores a row of 256 children for every node, where trie_op[u] is
+  // the ID (the index in ops) of the operator ending at node u, or -1.
+  std::vector<int> trie, trie_op;
+  std::vector<op_info> ops;
+
+  int add_op(const string &name) {
+    int u = 0;
+    for (int i = 0; i < (int)name.size(); i++) {
+      int c = (unsigned char)name[i];
+      if (trie[u*256 + c] < 0) {
+        trie[u*256 + c] = trie_op.size();
+        trie_op.push_back(-1);
+        trie.resize(trie.size() + 256, -1);
+      }
+      u = trie[u*256 + c];
+    }
+    if (trie_op[u] < 0) {
+      trie_op[u] = ops.size();
+      op_info op = {name, NULL, NULL, -1};
+      ops.push_back(op);
+    }
+    return trie_op[u];
+  }
+
+  // Returns the ID of the shortest operator starting at lo and ending by hi
+  // (which is also the lexicographically first), or -1 if there is none.
+  int match_op(const char *lo, const char *hi) const {
+    for (int u = 0; lo < hi && (u = trie[u*256 + (unsigned char)*lo]) >= 0;
+         lo++) {
+      if (trie_op[u] >= 0) {
+        return trie_op[u];
+      }
+    }
+    return -1;
+  }
+
+  int find_op(const string &s) const {
+    int u = 0;
+    for (int i = 0; i < (int)s.size() && u >= 0; i++) {
+      u = trie[u*256 + (unsigned char)s[i]];
+    }
+    return (u < 0) ? -1 : trie_op[u];
+  }
+
+  static int find_variable(string_ref s, const std::vector<string> &variables) {
+    for (int i = 0; i < (int)variables.size(); i++) {
+      if ((int)variables[i].size() == s.size &&
+          memcmp(variables[i].data(), s.data, s.size) == 0) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  static string_ref strip(const char *lo, const char *hi) {
+    while (lo < hi && isspace((unsigned char)*lo)) {
+      lo++;
+    }
+    while (hi > lo && isspace((unsigned char)hi[-1])) {
+      hi--;
+    }
+    return string_ref(lo, hi - lo);
   }
 
  public:
+  enum token_kind { OPERAND, VARIABLE, OPERATOR, LEFT_PAREN, RIGHT_PAREN };
+
+  struct token {
+    token_kind kind;
+    int id;
+    string_ref text;
+
+    token(token_kind kind, int id, string_ref text)
+        : kind(kind), id(id), text(text) {}
+  };
+
   parser(const unary_op_map &unary_ops, const binary_op_map &binary_ops)
-      : unary_ops(unary_ops), binary_ops(binary_ops) {
+      : trie(256, -1), trie_op(1, -1) {
     for (unary_op_map::const_iterator it = unary_ops.begin();
          it != unary_ops.end(); ++it) {
-      ops.insert(it->first);
+      ops[add_op(it->first)].unary_op = it->second;
     }
     for (binary_op_map::const_iterator it = binary_ops.begin();
          it != binary_ops.end(); ++it) {
-      ops.insert(it->first);
+      int id = add_op(it->first);
+      ops[id].binary_op = it->second.first;
+      ops[id].precedence = it->second.second;
     }
   }
 
-  std::vector<string> split(const string &s) {
-    std::vector<string> res;
-    for (int i = 0; i < (int)s.size(); i++) {
-      if (s[i] == ' ') {
+  void tokenize(const string &s, std::vector<token> &res,
+                const std::vector<string> &variables =
+                    std::vector<string>()) const {
+    res.clear();
+    const char *str = s.c_str();
+    int n = s.size();
+    for (int i = 0; i < n; i++) {
+      if (str[i] == ' ') {
         continue;
       }
-      int next_paren = s.size();
-      for (int j = i; j < (int)s.size(); j++) {
-        if (s[j] == '(' || s[j] == ')') {
+      int next_paren = n;
+      for (int j = i; j < n; j++) {
+        if (str[j] == '(' || str[j] == ')') {
           next_paren = j;
           break;
         }
       }
       while (i < next_paren) {
-        int found = next_paren;
-        string found_op;
-        for (int j = i; j < next_paren && found == next_paren; j++) {
-          for (std::set<string>::iterator it = ops.begin();
-               it != ops.end(); ++it) {
-            if (s.substr(j, it->size()) == *it) {
-              found = j;
-              found_op = *it;
-              break;
-            }
+        int found = next_paren, op = -1;
+        for (int j = i; j < next_paren && op < 0; j++) {
+          if ((op = match_op(str + j, str + next_paren)) >= 0) {
+            found = j;
           }
         }
-        string term = strip(s.substr(i, found - i));
-        if (!term.empty()) {
-          res.push_back(term);
-          if (!is_operand(term)) {
-            throw std::runtime_error("Failed to split term: \"" + term + "\".");
+        string_ref term = strip(str + i, str + found);
+        if (term.size > 0) {
+          int var = find_variable(term, variables);
+          if (is_operand(term)) {
+            res.push_back(token(OPERAND, -1, term));
+          } else if (var >= 0) {
+            res.push_back(token(VARIABLE, var, term));
+          } else {
+            throw std::runtime_error("Failed to split term: \"" + term.str() +
+                                     "\".");
           }
         }
-        if (found < next_paren) {
-          res.push_back(found_op);
-          i = found + found_op.size();
+        if (op >= 0) {
+          int len = ops[op].name.size();
+          res.push_back(token(OPERATOR, op, string_ref(str + found, len)));
+          i = found + len;
         } else {
           i = next_paren;
         }
       }
-      if (next_paren < s.size()) {
-        res.push_back(string(1, s[next_paren]));
+      if (next_paren < n) {
+        res.push_back(token(str[next_paren] == '(' ? LEFT_PAREN : RIGHT_PAREN,
+                            -1, string_ref(str + next_paren, 1)));
       }
     }
+  }
+
+  std::vector<string> split(const string &s,
+                            const std::vector<string> &variables =
+                                std::vector<string>()) const {
+    std::vector<token> tokens;
+    tokenize(s, tokens, variables);
+    std::vector<string> res;
+    for (int i = 0; i < (int)tokens.size(); i++) {
+      res.push_back(tokens[i].text.str());
+    }
     return res;
   }
 
-  template<class StrIt>
-  Operand eval(StrIt lo, StrIt hi) {
-    std::stack<Operand> vals;
-    std::stack<std::pair<string, bool> > ops;
-    ops.push(std::make_pair("(", false));
-    StrIt prev = hi;
-    do {
-      string curr = (lo == hi) ? ")" : *lo;
-      if (is_operand(curr)) {
-        vals.push(eval_operand(curr));
-      } else if (curr == "(") {
-        ops.push(std::make_pair(curr, false));
-      } else if (unary_ops.find(curr) != unary_ops.end() && (prev == hi ||
-                 *prev == "(" || binary_ops.find(*prev) != binary_ops.end())) {
-        ops.push(std::make_pair(curr, true));
+  compiled_expression compile_tokens(const token *lo,
+                                     const token *hi) const {
+    compiled_expression res;
+    // Pairs of an operator ID (or -1 for a left parenthesis) and whether it is
+    // applied as a unary operator.
+    std::vector<std::pair<int, bool> > stack(1, std::make_pair(-1, false));
+    for (const token *curr = lo, *prev = NULL; ; prev = curr++) {
+      token_kind kind = (curr == hi) ? RIGHT_PAREN : curr->kind;
+      int id = (curr == hi) ? -1 : curr->id;
+      if (kind == OPERAND) {
+        res.push(compiled_expression::CONSTANT, 0, eval_operand(curr->text));
+      } else if (kind == VARIABLE) {
+        res.push(compiled_expression::VARIABLE, id, Operand());
+      } else if (kind == LEFT_PAREN) {
+        stack.push_back(std::make_pair(-1, false));
+      } else if (kind == OPERATOR && ops[id].unary_op != NULL &&
+                 (prev == NULL || prev->kind == LEFT_PAREN ||
+                  (prev->kind == OPERATOR &&
+                   ops[prev->id].binary_op != NULL))) {
+        stack.push_back(std::make_pair(id, true));
       } else {
+        int precedence = (kind == OPERATOR) ? ops[id].precedence : -1;
         for (;;) {
-          string op = ops.top().first;
-          bool is_unary = ops.top().second;
-          binary_op_map::iterator it1 = binary_ops.find(op);
-          binary_op_map::iterator it2 = binary_ops.find(curr);
-          if (!is_unary &&
-              (it1 == binary_ops.end() ? -1 : it1->second.second) <
-              (it2 == binary_ops.end() ? -1 : it2->second.second)) {
+          if (stack.empty()) {
+            throw std::runtime_error("Unbalanced \")\" during compile.");
+          }
+          int op = stack.back().first;
+          bool is_unary = stack.back().second;
+          if (!is_unary && (op < 0 ? -1 : ops[op].precedence) < precedence) {
             break;
           }
-          ops.pop();
-          if (op == "(") {
+          stack.pop_back();
+          if (op < 0) {
             break;
           }
-          Operand b = vals.top();
-          vals.pop();
           if (is_unary) {
-            unary_op_map::iterator it = unary_ops.find(op);
-            if (it == unary_ops.end()) {
-              throw std::runtime_error("Failed to eval unary op: " + op);
-            }
-            vals.push((it->second)(b));
+            res.push_unary(ops[op].unary_op);
           } else {
-            Operand a = vals.top();
-            vals.pop();
-            if (it1 == binary_ops.end()) {
-              throw std::runtime_error("Failed to eval binary op: " + op);
+            if (ops[op].binary_op == NULL) {
+              throw std::runtime_error("Failed to eval binary op: " +
+                                       ops[op].name);
             }
-            vals.push((it1->second.first)(a, b));
+            res.push_binary(ops[op].binary_op);
           }
         }
-        if (curr != ")") {
-          ops.push(std::make_pair(*lo, false));
+        if (kind != RIGHT_PAREN) {
+          stack.push_back(std::make_pair(id, false));
         }
       }
-      prev = lo;
-    } while (lo++ != hi);
-    return vals.top();
+      if (curr == hi) {
+        break;
+      }
+    }
+    if (res.depth != 1) {
+      throw std::runtime_error("Failed to compile expression.");
+    }
+    res.stack.resize(res.max_depth);
+    res.batch.resize(res.max_depth*compiled_expression::BLOCK_SIZE);
+    return res;
   }
 
-  Operand eval(const string &s) {
-    std::vector<string> tokens = split(s);
-    return eval(tokens.begin(), tokens.end());
+  template<class StrIt>
+  compiled_expression compile(StrIt lo, StrIt hi,
+                              const std::vector<string> &variables =
+                                  std::vector<string>()) const {
+    std::vector<token> tokens;
+    for (; lo != hi; ++lo) {
+      const string &s = *lo;
+      int var = find_variable(s, variables), op = find_op(s);
+      if (is_operand(s)) {
+        tokens.push_back(token(OPERAND, -1, s));
+      } else if (var >= 0) {
+        tokens.push_back(token(VARIABLE, var, s));
+      } else if (s == "(" || s == ")") {
+        tokens.push_back(token(s == "(" ? LEFT_PAREN : RIGHT_PAREN, -1, s));
+      } else if (op >= 0) {
+        tokens.push_back(token(OPERATOR, op, s));
+      } else {
+        throw std::runtime_error("Failed to compile token: " + s);
+      }
+    }
+    return tokens.empty() ? compile_tokens(NULL, NULL)
+                          : compile_tokens(&tokens[0],
+                                           &tokens[0] + tokens.size());
+  }
+
+  compiled_expression compile(const string &s,
+                              const std::vector<string> &variables =
+                                  std::vector<string>()) const {
+    std::vector<token> tokens;
+    tokenize(s, tokens, variables);
+    return tokens.empty() ? compile_tokens(NULL, NULL)
+                          : compile_tokens(&tokens[0],
+                                           &tokens[0] + tokens.size());
+  }
+
+  template<class StrIt>
+  Operand eval(StrIt lo, StrIt hi) const {
+    return compile(lo, hi).run();
+  }
+
+  Operand eval(const string &s) const {
+    return compile(s).run();
   }
 };
 
-/*** Example Usage ***/
+/*** Example Usage and Output:
+
+Evaluating "(a + b) * 2.5 - c / (1 + 2 * 3) + a * -a ^ 2" for 100000 rows:
+  eval: 0.531067s
+  compile and run: 0.003812s
+  compile and run_batch: 0.00357s
+
+***/
 
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <sstream>
 using namespace std;
 
 #define EQ(a, b) (fabs((a) - (b)) < 1e-7)
@@ -245,6 +547,65 @@ double sub(double a, double b) { return a - b; }
 double mul(double a, double b) { return a * b; }
 double div(double a, double b) { return a / b; }
 
+string to_str(double x) {
+  ostringstream oss;
+  oss.precision(17);
+  oss << x;
+  return oss.str();
+}
+
+void benchmark(const parser &p, const string &expr, int rows) {
+  vector<string> names;
+  names.push_back("a");
+  names.push_back("b");
+  names.push_back("c");
+  vector<vector<double> > cols(3, vector<double>(rows));
+  for (int i = 0; i < 3; i++) {
+    for (int r = 0; r < rows; r++) {
+      cols[i][r] = 1 + rand() % 1000;
+    }
+  }
+  // Without variables, eval() can only be given the values as tokens.
+  clock_t start = clock();
+  vector<string> tokens = p.split(expr, names), row_tokens;
+  double sum1 = 0;
+  for (int r = 0; r < rows; r++) {
+    row_tokens = tokens;
+    for (int i = 0; i < (int)tokens.size(); i++) {
+      int var = find(names.begin(), names.end(), tokens[i]) - names.begin();
+      if (var < 3) {
+        row_tokens[i] = to_str(cols[var][r]);
+      }
+    }
+    sum1 += p.eval(row_tokens.begin(), row_tokens.end());
+  }
+  double eval_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  compiled_expression e = p.compile(expr, names);
+  double sum2 = 0, vars[3];
+  for (int r = 0; r < rows; r++) {
+    for (int i = 0; i < 3; i++) {
+      vars[i] = cols[i][r];
+    }
+    sum2 += e.run(vars);
+  }
+  double run_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  const double *columns[] = {&cols[0][0], &cols[1][0], &cols[2][0]};
+  vector<double> out(rows);
+  e.run_batch(columns, rows, &out[0]);
+  double sum3 = 0;
+  for (int r = 0; r < rows; r++) {
+    sum3 += out[r];
+  }
+  double batch_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  assert(EQ(sum1/rows, sum2/rows) && sum2 == sum3);
+  cout << "Evaluating \"" << expr << "\" for " << rows << " rows:" << endl;
+  cout << "  eval: " << eval_time << "s" << endl;
+  cout << "  compile and run: " << run_time << "s" << endl;
+  cout << "  compile and run_batch: " << batch_time << "s" << endl;
+}
+
 int main() {
   map<string, UnaryOp> unary_ops;
   unary_ops["+"] = pos;
@@ -269,5 +630,48 @@ int main() {
             351854.28968253968));
   assert(EQ(p.eval("-(5-(5-(5-(5-(5-2)))))+(3-(3-(3-(3-(3+3)))))*"
                    "(7-(7-(7-(7-(7-7+4*5)))))"), 117));
+
+  double vars[] = {1.5, 4};
+  vector<parser::token> tokens;
+  string expr = "2.5*(x - -1)";
+  try {
+    p.tokenize(expr, tokens);
+    assert(false);
+  } catch (runtime_error &) {}
+  vector<string> names;
+  names.push_back("x");
+  names.push_back("y");
+  p.tokenize(expr, tokens, names);
+  assert(tokens.size() == 8);
+  assert(tokens[0].text.data == expr.c_str() && tokens[0].text.str() == "2.5");
+  assert(tokens[2].kind == parser::LEFT_PAREN);
+  assert(tokens[3].kind == parser::VARIABLE && tokens[3].id == 0);
+  assert(tokens[4].kind == parser::OPERATOR && tokens[4].text.str() == "-");
+  assert(tokens[5].kind == parser::OPERATOR && tokens[5].id == tokens[4].id);
+  vector<string> parts = p.split(expr, names);
+  assert(parts.size() == 8 && parts[3] == "x" && parts[6] == "1");
+  assert(EQ(p.compile(parts.begin(), parts.end(), names).run(vars), 6.25));
+  compiled_expression e = p.compile("-x*(2+3) + y^2/(-4)", names);
+  assert(e.size() == 10);
+  assert(EQ(e.run(vars), -11.5));
+  assert(EQ(p.compile("2^(1+2)*-(3)").run(), -24));
+  assert(p.compile("2^(1+2)*-(3)").size() == 1);
+  double xs[] = {0, 1, 2, 3}, ys[] = {2, 0, -2, 4}, out[4];
+  const double *columns[] = {xs, ys};
+  e.run_batch(columns, 4, out);
+  for (int r = 0; r < 4; r++) {
+    vars[0] = xs[r];
+    vars[1] = ys[r];
+    assert(out[r] == e.run(vars));
+  }
+  try {
+    p.compile("x + z", names);
+    assert(false);
+  } catch (runtime_error &) {}
+  try {
+    p.compile("x +", names);
+    assert(false);
+  } catch (runtime_error &) {}
+  benchmark(p, "(a + b) * 2.5 - c / (1 + 2 * 3) + a * -a ^ 2", 100000);
   return 0;
 }
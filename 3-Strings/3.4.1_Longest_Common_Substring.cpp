@@ -1,18 +1,41 @@
 /*
 
 Given two strings, determine their longest common substring (i.e. consecutive
-subsequence) using dynamic programming.
+subsequence) using dynamic programming. Given many strings, determine the
+longest substring common to at least k of them using a suffix array.
+
+- longest_common_substring(s1, s2) returns the longest common substring of s1
+  and s2, computing dp[i][j] (the length of the longest common suffix of the
+  length i prefix of s1 and the length j prefix of s2) one row at a time.
+- longest_common_substring(strs, k) returns the longest string which occurs as
+  a substring of at least k of the strings in strs, or "" if there is none. The
+  strings are concatenated into one integer text, with each followed by its own
+  unique separator so that no common prefix can extend past the end of a
+  string. The suffix array of the text is built with the linear time DC3/skew
+  algorithm (as in section 3.5.3), along with its LCP array. Every window of
+  consecutive suffixes that comes from at least k distinct strings shares a
+  prefix of length equal to the minimum LCP inside the window, so a sliding
+  window over the suffix array, with a monotonic deque of LCP values, finds the
+  longest such prefix in a single pass.
+- longest_common_substring(strs) returns the longest common substring of all of
+  the strings in strs.
 
 Time Complexity:
 - O(n*m) per call to longest_common_substring(s1, s2), where n and m are the
   lengths of s1 and s2, respectively.
+- O(N) per call to longest_common_substring(strs, k), where N is the total
+  length of the strings in strs.
 
 Space Complexity:
-- O(min(n, m)) auxiliary heap space, where n and m are the lengths of s1 and
-  s2, respectively.
+- O(min(n, m)) auxiliary heap space for longest_common_substring(s1, s2), where
+  n and m are the lengths of s1 and s2, respectively.
+- O(N) auxiliary heap space for longest_common_substring(strs, k), which is
+  about 20 bytes per character.
 
 */
 
+#include <algorithm>
+#include <deque>
 #include <string>
 #include <vector>
 using std::string;
@@ -44,11 +67,283 @@ string longest_common_substring(const string &s1, const string &s2) {
   return s1.substr(pos, len);
 }
 
-/*** Example Usage ***/
+// Builds the suffix array sa of the n values s[0..n - 1] in [1, K], where
+// s[n], s[n + 1], and s[n + 2] must be 0.
+inline bool leq(int a1, int a2, int b1, int b2) {
+  return (a1 < b1) || (a1 == b1 && a2 <= b2);
+}
+
+inline bool leq(int a1, int a2, int a3, int b1, int b2, int b3) {
+  return (a1 < b1) || (a1 == b1 && leq(a2, a3, b2, b3));
+}
+
+template<class It>
+void radix_pass(It a, It b, It r, int n, int K) {
+  std::vector<int> cnt(K + 1);
+  for (int i = 0; i < n; i++) {
+    cnt[r[a[i]]]++;
+  }
+  for (int i = 1; i <= K; i++) {
+    cnt[i] += cnt[i - 1];
+  }
+  for (int i = n - 1; i >= 0; i--) {
+    b[--cnt[r[a[i]]]] = a[i];
+  }
+}
+
+template<class It>
+void suffix_array_dc3(It s, It sa, int n, int K) {
+  int n0 = (n + 2)/3, n1 = (n + 1)/3, n2 = n/3, n02 = n0 + n2;
+  std::vector<int> s12(n02 + 3), sa12(n02 + 3), s0(n0), sa0(n0);
+  s12[n02] = s12[n02 + 1] = s12[n02 + 2] = 0;
+  sa12[n02] = sa12[n02 + 1] = sa12[n02 + 2] = 0;
+  for (int i = 0, j = 0; i < n + n0 - n1; i++) {
+    if (i % 3 != 0) {
+      s12[j++] = i;
+    }
+  }
+  radix_pass(s12.begin(), sa12.begin(), s + 2, n02, K);
+  radix_pass(sa12.begin(), s12.begin(), s + 1, n02, K);
+  radix_pass(s12.begin(), sa12.begin(), s, n02, K);
+  int name = 0, c0 = -1, c1 = -1, c2 = -1;
+  for (int i = 0; i < n02; i++) {
+    if (s[sa12[i]] != c0 || s[sa12[i] + 1] != c1 || s[sa12[i] + 2] != c2) {
+      name++;
+      c0 = s[sa12[i]];
+      c1 = s[sa12[i] + 1];
+      c2 = s[sa12[i] + 2];
+    }
+    (sa12[i] % 3 == 1 ? s12[sa12[i]/3] : s12[sa12[i]/3 + n0]) = name;
+  }
+  if (name < n02) {
+    suffix_array_dc3(s12.begin(), sa12.begin(), n02, name);
+    for (int i = 0; i < n02; i++) {
+      s12[sa12[i]] = i + 1;
+    }
+  } else {
+    for (int i = 0; i < n02; i++) {
+      sa12[s12[i] - 1] = i;
+    }
+  }
+  for (int i = 0, j = 0; i < n02; i++) {
+    if (sa12[i] < n0) {
+      s0[j++] = 3*sa12[i];
+    }
+  }
+  radix_pass(s0.begin(), sa0.begin(), s, n0, K);
+  for (int p = 0, t = n0 - n1, k = 0; k < n; k++) {
+    int i = (sa12[t] < n0) ? 3*sa12[t] + 1 : 3*(sa12[t] - n0) + 2, j = sa0[p];
+    if (sa12[t] < n0 ? leq(s[i], s12[sa12[t] + n0], s[j], s12[j/3])
+                     : leq(s[i], s[i + 1], s12[sa12[t] - n0 + 1], s[j],
+                           s[j + 1], s12[j/3 + n0])) {
+      sa[k] = i;
+      if (++t == n02) {
+        for (k++; p < n0; p++, k++) {
+          sa[k] = sa0[p];
+        }
+      }
+    } else {
+      sa[k] = j;
+      if (++p == n0) {
+        for (k++; t < n02; t++, k++) {
+          sa[k] = (sa12[t] < n0) ? 3*sa12[t] + 1 : 3*(sa12[t] - n0) + 2;
+        }
+      }
+    }
+  }
+}
+
+string longest_common_substring(const std::vector<string> &strs, int k) {
+  int m = strs.size();
+  if (k <= 1) {
+    string res;
+    for (int i = 0; i < m; i++) {
+      if (strs[i].size() > res.size()) {
+        res = strs[i];
+      }
+    }
+    return (k == 1) ? res : string();
+  }
+  if (m < k) {
+    return string();
+  }
+  // Separators are 1 to m in order, and characters follow from m + 1.
+  std::vector<int> text, owner, start(m);
+  for (int i = 0; i < m; i++) {
+    start[i] = text.size();
+    for (int j = 0; j < (int)strs[i].size(); j++) {
+      text.push_back(m + 1 + (unsigned char)strs[i][j]);
+    }
+    text.push_back(i + 1);
+    owner.resize(text.size(), i);
+  }
+  int n = text.size();
+  std::vector<int> sa(n), lcp(n, 0), rank(n);
+  text.resize(n + 3, 0);
+  suffix_array_dc3(text.begin(), sa.begin(), n, m + 256);
+  for (int i = 0; i < n; i++) {
+    rank[sa[i]] = i;
+  }
+  // Since every separator is unique, matching always stops before reaching a
+  // separator, and thus never runs off the end of the text.
+  for (int i = 0, h = 0; i < n; i++) {
+    if (rank[i] + 1 < n) {
+      int j = sa[rank[i] + 1];
+      while (text[i + h] == text[j + h] && text[i + h] > m) {
+        h++;
+      }
+      lcp[rank[i]] = h;
+      if (h > 0) {
+        h--;
+      }
+    } else {
+      h = 0;
+    }
+  }
+  // The first m suffixes begin with the separators, so they are skipped. Then,
+  // lcp[i] is the LCP of suffixes i and i + 1, and the window [lo, hi] has
+  // minimum LCP equal to the front of the deque over indices lo to hi - 1.
+  std::vector<int> count(m, 0);
+  std::deque<int> window;
+  int distinct = 0, best_len = 0, best_pos = 0;
+  for (int lo = m, hi = m; hi < n; hi++) {
+    if (count[owner[sa[hi]]]++ == 0) {
+      distinct++;
+    }
+    if (hi > lo) {
+      while (!window.empty() && lcp[window.back()] >= lcp[hi - 1]) {
+        window.pop_back();
+      }
+      window.push_back(hi - 1);
+    }
+    while (distinct - (count[owner[sa[lo]]] == 1 ? 1 : 0) >= k) {
+      if (--count[owner[sa[lo]]] == 0) {
+        distinct--;
+      }
+      lo++;
+      while (!window.empty() && window.front() < lo) {
+        window.pop_front();
+      }
+    }
+    if (distinct >= k && lcp[window.front()] > best_len) {
+      best_len = lcp[window.front()];
+      best_pos = sa[hi];
+    }
+  }
+  int i = owner[best_pos];
+  return strs[i].substr(best_pos - start[i], best_len);
+}
+
+string longest_common_substring(const std::vector<string> &strs) {
+  return longest_common_substring(strs, (int)strs.size());
+}
+
+/*** Example Usage and Output:
+
+Longest common substring of 100 strings of length 20000:
+  dp on the first two: 1.35466s
+  suffix array on the first two: 0.007385s
+  suffix array on all: 0.709026s
+
+***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+using namespace std;
+
+string random_string(int n, int alphabet) {
+  string res(n, 'a');
+  for (int i = 0; i < n; i++) {
+    res[i] = (char)('a' + rand() % alphabet);
+  }
+  return res;
+}
+
+// Returns the length of the longest substring of some string in strs that also
+// occurs in at least k of the strings, by trying every candidate.
+int naive_len(const vector<string> &strs, int k) {
+  int best = 0;
+  for (int s = 0; s < (int)strs.size(); s++) {
+    const string &t = strs[s];
+    for (int i = 0; i < (int)t.size(); i++) {
+      for (int len = best + 1; i + len <= (int)t.size(); len++) {
+        int cnt = 0;
+        for (int j = 0; j < (int)strs.size(); j++) {
+          cnt += (strs[j].find(t.substr(i, len)) != string::npos) ? 1 : 0;
+        }
+        if (cnt < k) {
+          break;
+        }
+        best = len;
+      }
+    }
+  }
+  return best;
+}
+
+void test_random() {
+  for (int t = 0; t < 300; t++) {
+    int m = 1 + rand() % 5, alphabet = 1 + rand() % 4;
+    vector<string> strs(m);
+    for (int i = 0; i < m; i++) {
+      strs[i] = random_string(rand() % 30, alphabet);
+    }
+    int k = 1 + rand() % m;
+    string res = longest_common_substring(strs, k);
+    assert((int)res.size() == naive_len(strs, k));
+    int cnt = 0;
+    for (int i = 0; i < m; i++) {
+      cnt += (strs[i].find(res) != string::npos) ? 1 : 0;
+    }
+    assert(cnt >= k);
+    if (m == 2 && k == 2) {
+      assert(longest_common_substring(strs[0], strs[1]).size() == res.size());
+    }
+  }
+}
+
+void benchmark(int m, int len) {
+  vector<string> strs(m);
+  string shared = random_string(200, 26);
+  for (int i = 0; i < m; i++) {
+    strs[i] = random_string(len, 4);
+    strs[i].insert(rand() % len, shared);
+  }
+  cout << "Longest common substring of " << m << " strings of length " << len
+       << ":" << endl;
+  clock_t start = clock();
+  string res = longest_common_substring(strs[0], strs[1]);
+  cout << "  dp on the first two: " << (double)(clock() - start)/CLOCKS_PER_SEC
+       << "s" << endl;
+  assert(res.size() >= shared.size());
+  vector<string> two(strs.begin(), strs.begin() + 2);
+  start = clock();
+  string res2 = longest_common_substring(two);
+  cout << "  suffix array on the first two: "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s" << endl;
+  assert(res2.size() == res.size());
+  start = clock();
+  string res_all = longest_common_substring(strs);
+  cout << "  suffix array on all: " << (double)(clock() - start)/CLOCKS_PER_SEC
+       << "s" << endl;
+  assert(res_all == shared);
+}
 
 int main() {
   assert(longest_common_substring("bbbabca", "aababcd") == "babc");
+  vector<string> strs;
+  strs.push_back("xabcdey");
+  strs.push_back("abcdz");
+  strs.push_back("zzbcdezz");
+  assert(longest_common_substring(strs) == "bcd");
+  assert(longest_common_substring(strs, 2).size() == 4);
+  assert(longest_common_substring(strs, 1) == "zzbcdezz");
+  assert(longest_common_substring(strs, 4).empty());
+  strs.push_back("");
+  assert(longest_common_substring(strs).empty());
+  test_random();
+  benchmark(100, 20000);
   return 0;
 }
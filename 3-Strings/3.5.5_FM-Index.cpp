@@ -0,0 +1,528 @@
+/*
+
+Given a string s, the Burrows-Wheeler transform (BWT) of s is the string of the
+characters preceding each suffix of s, in the order of the suffix array, where
+a sentinel character that is smaller than every other character is appended to
+s and precedes the first suffix. An FM-index (Ferragina & Manzini, 2000) stores
+the BWT along with a rank structure and a sample of the suffix array, which
+together support counting and locating the occurrences of any pattern in space
+that is a fraction of the text, as opposed to the 4 bytes per character of the
+suffix array alone.
+
+The suffix array is built by the SA-IS algorithm with 32-bit indices (see
+section 3.5.4), and is discarded after construction. Characters are remapped to
+codes 1 to sigma (with 0 for the sentinel), where sigma is the number of
+distinct characters in s. The BWT of codes is stored in a wavelet matrix of
+ceil(log2(sigma + 1)) levels, each a bit vector supporting rank in constant time
+with one count per 512 bits. The number of occurrences of c in the first i
+characters of the BWT is then found with one rank per level.
+
+- bit_vector(bits) builds a bit vector from a vector of bools, where get(i)
+  returns bit i and rank1(i) returns the number of 1 bits before position i.
+- wavelet_matrix(a, levels) builds a wavelet matrix over the values in a, each
+  less than 2^levels. access_rank(i, c) stores the value at index i into c and
+  returns the number of occurrences of c before i, in a single pass over the
+  levels. rank(c, i) returns the number of occurrences of c before index i.
+- fm_index(s, sample_rate) builds an FM-index for s, keeping the suffix array
+  entry for every row whose text position is a multiple of sample_rate.
+- size() returns the length of s.
+- find_all(p) returns the half-open range of rows [lo, hi) of the suffix array
+  for the suffixes beginning with p, by backward search. Starting with all rows,
+  each character c of p from last to first maps the range [lo, hi) to [C[c] +
+  rank(c, lo), C[c] + rank(c, hi)), where C[c] is the number of characters in
+  the text less than c.
+- count(p) returns the number of occurrences of p in s.
+- locate_row(i) returns the position in s of the suffix at row i, by repeatedly
+  stepping from a row to the row of the suffix starting one character earlier
+  (the LF-mapping) until a sampled row is reached.
+- locate(p) returns the positions of all occurrences of p in s, in no
+  particular order.
+- bytes() returns the number of bytes used by the index.
+
+Time Complexity:
+- O(n log sigma) per call to the constructor, where n is the length of s.
+- O(m log sigma) per call to find_all(p) and count(p), where m is the length of
+  p, which is O(m) for a fixed alphabet.
+- O(r log sigma) per call to locate_row(i), where r is the sample_rate, and
+  O((m + k*r) log sigma) per call to locate(p), where k is the number of
+  occurrences.
+
+Space Complexity:
+- O(n log sigma) bits for storage of the BWT, plus O(n/r) indices for the
+  sampled suffix array. For DNA with r = 32, this is about 0.65 bytes per
+  character, including the rank directories and the sample marks.
+- O(n) auxiliary heap space for the constructor, which needs about 5n bytes to
+  build the suffix array.
+
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+using std::string;
+
+typedef unsigned int index_t;
+
+const index_t EMPTY = ~0u;
+
+inline bool get_type(const std::vector<unsigned char> &t, index_t i) {
+  return (t[i >> 3] >> (i & 7)) & 1;
+}
+
+inline bool is_lms(const std::vector<unsigned char> &t, index_t i) {
+  return i > 0 && i != EMPTY && get_type(t, i) && !get_type(t, i - 1);
+}
+
+// Returns the i-th character of s, shifted up by 1 to make room for the virtual
+// sentinel at position n.
+template<class Char>
+inline index_t chr(const Char *s, index_t n, index_t i) {
+  return (i == n) ? 0 : (index_t)s[i] + 1;
+}
+
+template<class Char>
+void get_buckets(const Char *s, index_t n, index_t K, index_t *bkt, bool end) {
+  std::fill(bkt, bkt + K + 1, 0);
+  bkt[0] = 1;
+  for (index_t i = 0; i < n; i++) {
+    bkt[(index_t)s[i] + 1]++;
+  }
+  for (index_t c = 0, sum = 0; c <= K; c++) {
+    sum += bkt[c];
+    bkt[c] = end ? sum : sum - bkt[c];
+  }
+}
+
+// Induces the order of the L-type suffixes from left to right, then the order
+// of the S-type suffixes from right to left.
+template<class Char>
+void induce(const Char *s, index_t n, index_t K,
+            const std::vector<unsigned char> &t, index_t *sa, index_t *bkt) {
+  get_buckets(s, n, K, bkt, false);
+  for (index_t i = 0; i <= n; i++) {
+    index_t j = sa[i];
+    if (j != EMPTY && j > 0 && !get_type(t, j - 1)) {
+      sa[bkt[chr(s, n, j - 1)]++] = j - 1;
+    }
+  }
+  get_buckets(s, n, K, bkt, true);
+  for (index_t i = n + 1; i-- > 0; ) {
+    index_t j = sa[i];
+    if (j != EMPTY && j > 0 && get_type(t, j - 1)) {
+      sa[--bkt[chr(s, n, j - 1)]] = j - 1;
+    }
+  }
+}
+
+template<class Char>
+void sa_is(const Char *s, index_t n, index_t K, index_t *sa, index_t *bkt) {
+  if (n == 0) {
+    sa[0] = 0;
+    return;
+  }
+  // The type of i is S (stored as 1) if the suffix at i is smaller than the
+  // suffix at i + 1, and L (stored as 0) otherwise.
+  std::vector<unsigned char> t(n/8 + 1, 0);
+  t[n >> 3] |= 1 << (n & 7);
+  for (index_t i = n - 1; i-- > 0; ) {
+    if (s[i] < s[i + 1] || (s[i] == s[i + 1] && get_type(t, i + 1))) {
+      t[i >> 3] |= 1 << (i & 7);
+    }
+  }
+  std::vector<index_t> own_bkt;
+  if (bkt == NULL) {
+    own_bkt.resize(K + 1);
+    bkt = &own_bkt[0];
+  }
+  // Stage 1: sort the LMS substrings by inducing from their unsorted positions
+  // at the ends of their buckets.
+  get_buckets(s, n, K, bkt, true);
+  std::fill(sa, sa + n + 1, EMPTY);
+  for (index_t i = 1; i <= n; i++) {
+    if (is_lms(t, i)) {
+      sa[--bkt[chr(s, n, i)]] = i;
+    }
+  }
+  induce(s, n, K, t, sa, bkt);
+  // Compact the sorted LMS positions into the first n1 slots, then name them
+  // into the second half, where no two LMS positions i and j have i/2 == j/2.
+  index_t n1 = 0;
+  for (index_t i = 0; i <= n; i++) {
+    if (is_lms(t, sa[i])) {
+      sa[n1++] = sa[i];
+    }
+  }
+  std::fill(sa + n1, sa + n + 1, EMPTY);
+  index_t name = 0, prev = EMPTY;
+  for (index_t i = 0; i < n1; i++) {
+    index_t pos = sa[i];
+    bool diff = (prev == EMPTY);
+    for (index_t d = 0; !diff; d++) {
+      if (pos + d == n || prev + d == n ||
+          s[pos + d] != s[prev + d] ||
+          get_type(t, pos + d) != get_type(t, prev + d)) {
+        diff = true;
+      } else if (d > 0 && (is_lms(t, pos + d) || is_lms(t, prev + d))) {
+        break;
+      }
+    }
+    if (diff) {
+      name++;
+      prev = pos;
+    }
+    sa[n1 + pos/2] = name - 1;
+  }
+  for (index_t i = n + 1, j = n + 1; i-- > n1; ) {
+    if (sa[i] != EMPTY) {
+      sa[--j] = sa[i];
+    }
+  }
+  // Stage 2: sort the reduced string s1, which ends in the unique name 0 of the
+  // sentinel, so the rest of s1 is passed with names from 1 to name - 1.
+  index_t *sa1 = sa, *s1 = sa + n + 1 - n1;
+  if (name < n1) {
+    index_t gap = n + 1 - 2*n1;
+    sa_is((const index_t*)s1, n1 - 1, name, sa1,
+          (name + 1 <= gap) ? sa + n1 : NULL);
+  } else {
+    for (index_t i = 0; i < n1; i++) {
+      sa1[s1[i]] = i;
+    }
+  }
+  // Stage 3: place the sorted LMS suffixes at the ends of their buckets, and
+  // induce the order of all other suffixes from them.
+  for (index_t i = 1, j = 0; i <= n; i++) {
+    if (is_lms(t, i)) {
+      s1[j++] = i;
+    }
+  }
+  for (index_t i = 0; i < n1; i++) {
+    sa1[i] = s1[sa1[i]];
+  }
+  std::fill(sa + n1, sa + n + 1, EMPTY);
+  get_buckets(s, n, K, bkt, true);
+  for (index_t i = n1; i-- > 0; ) {
+    index_t j = sa[i];
+    sa[i] = EMPTY;
+    sa[--bkt[chr(s, n, j)]] = j;
+  }
+  induce(s, n, K, t, sa, bkt);
+}
+
+
+class bit_vector {
+  std::vector<unsigned long long> words;
+  // counts[b] is the number of 1 bits in the words before block b of 8 words.
+  std::vector<index_t> counts;
+
+ public:
+  bit_vector() {}
+
+  bit_vector(const std::vector<bool> &bits)
+      : words(bits.size()/64 + 1, 0), counts(bits.size()/512 + 2, 0) {
+    for (index_t i = 0; i < bits.size(); i++) {
+      if (bits[i]) {
+        words[i/64] |= 1ULL << (i % 64);
+      }
+    }
+    for (index_t w = 0; w < words.size(); w++) {
+      counts[w/8 + 1] += __builtin_popcountll(words[w]);
+    }
+    for (index_t b = 1; b < counts.size(); b++) {
+      counts[b] += counts[b - 1];
+    }
+  }
+
+  bool get(index_t i) const {
+    return (words[i/64] >> (i % 64)) & 1;
+  }
+
+  index_t rank1(index_t i) const {
+    index_t w = i/64, res = counts[w/8];
+    for (index_t k = w - w % 8; k < w; k++) {
+      res += __builtin_popcountll(words[k]);
+    }
+    return res + __builtin_popcountll(words[w] & ((1ULL << (i % 64)) - 1));
+  }
+
+  size_t bytes() const {
+    return words.size()*sizeof(words[0]) + counts.size()*sizeof(counts[0]);
+  }
+};
+
+class wavelet_matrix {
+  int levels;
+  std::vector<bit_vector> bits;
+  // zeros[l] is the number of 0 bits at level l, and start[c] is the index of
+  // the first occurrence of c in the order after the last level.
+  std::vector<index_t> zeros, start;
+
+ public:
+  wavelet_matrix() : levels(0) {}
+
+  wavelet_matrix(std::vector<unsigned short> a, int levels)
+      : levels(levels), bits(levels), zeros(levels), start(1 << levels, 0) {
+    index_t n = a.size();
+    std::vector<unsigned short> next(n);
+    std::vector<bool> b(n);
+    for (int l = 0; l < levels; l++) {
+      index_t z = 0;
+      for (index_t i = 0; i < n; i++) {
+        b[i] = (a[i] >> (levels - 1 - l)) & 1;
+        z += b[i] ? 0 : 1;
+      }
+      bits[l] = bit_vector(b);
+      zeros[l] = z;
+      for (index_t i = 0, p0 = 0, p1 = z; i < n; i++) {
+        next[b[i] ? p1++ : p0++] = a[i];
+      }
+      a.swap(next);
+    }
+    for (index_t i = n; i-- > 0; ) {
+      start[a[i]] = i;
+    }
+  }
+
+  index_t access_rank(index_t i, unsigned short &c) const {
+    c = 0;
+    for (int l = 0; l < levels; l++) {
+      index_t ones = bits[l].rank1(i);
+      if (bits[l].get(i)) {
+        c = (c << 1) | 1;
+        i = zeros[l] + ones;
+      } else {
+        c <<= 1;
+        i -= ones;
+      }
+    }
+    return i - start[c];
+  }
+
+  index_t rank(unsigned short c, index_t i) const {
+    for (int l = 0; l < levels; l++) {
+      index_t ones = bits[l].rank1(i);
+      i = ((c >> (levels - 1 - l)) & 1) ? zeros[l] + ones : i - ones;
+    }
+    return i - start[c];
+  }
+
+  size_t bytes() const {
+    size_t res = (zeros.size() + start.size())*sizeof(index_t);
+    for (int l = 0; l < levels; l++) {
+      res += bits[l].bytes();
+    }
+    return res;
+  }
+};
+
+class fm_index {
+  index_t n;
+  // Codes range up to 256 when s contains every byte value.
+  unsigned short code[256];
+  std::vector<index_t> C, samples;
+  wavelet_matrix bwt;
+  bit_vector sampled;
+
+ public:
+  fm_index(const string &s, int sample_rate = 32) : n(s.size()) {
+    const unsigned char *p = (const unsigned char*)s.data();
+    std::vector<index_t> freq(256, 0);
+    for (index_t i = 0; i < n; i++) {
+      freq[p[i]]++;
+    }
+    int sigma = 0;
+    for (int c = 0; c < 256; c++) {
+      code[c] = (freq[c] > 0) ? ++sigma : 0;
+    }
+    int levels = 1;
+    while ((1 << levels) <= sigma) {
+      levels++;
+    }
+    C.assign(sigma + 2, 0);
+    C[1] = 1;
+    for (int c = 0; c < 256; c++) {
+      if (code[c] > 0) {
+        C[code[c] + 1] = C[code[c]] + freq[c];
+      }
+    }
+    std::vector<index_t> sa(n + 1);
+    sa_is(p, n, 256, &sa[0], NULL);
+    std::vector<unsigned short> last(n + 1);
+    std::vector<bool> marks(n + 1);
+    for (index_t i = 0; i <= n; i++) {
+      last[i] = (sa[i] == 0) ? 0 : code[p[sa[i] - 1]];
+      marks[i] = (sa[i] % sample_rate == 0);
+      if (marks[i]) {
+        samples.push_back(sa[i]);
+      }
+    }
+    std::vector<index_t>().swap(sa);
+    bwt = wavelet_matrix(last, levels);
+    sampled = bit_vector(marks);
+  }
+
+  index_t size() const {
+    return n;
+  }
+
+  std::pair<index_t, index_t> find_all(const string &p) const {
+    // Row 0 is the bare sentinel, which only the empty pattern would match.
+    index_t lo = p.empty() ? 1 : 0, hi = n + 1;
+    for (index_t k = p.size(); k-- > 0 && lo < hi; ) {
+      unsigned short c = code[(unsigned char)p[k]];
+      if (c == 0) {
+        return std::make_pair(lo, lo);
+      }
+      lo = C[c] + bwt.rank(c, lo);
+      hi = C[c] + bwt.rank(c, hi);
+    }
+    return std::make_pair(lo, std::max(lo, hi));
+  }
+
+  index_t count(const string &p) const {
+    std::pair<index_t, index_t> range = find_all(p);
+    return range.second - range.first;
+  }
+
+  // The row of text position 0 is always sampled, so the LF-mapping never
+  // reaches the sentinel.
+  index_t locate_row(index_t i) const {
+    index_t steps = 0;
+    while (!sampled.get(i)) {
+      unsigned short c;
+      index_t r = bwt.access_rank(i, c);
+      i = C[c] + r;
+      steps++;
+    }
+    return samples[sampled.rank1(i)] + steps;
+  }
+
+  std::vector<index_t> locate(const string &p) const {
+    std::pair<index_t, index_t> range = find_all(p);
+    std::vector<index_t> res;
+    for (index_t i = range.first; i < range.second; i++) {
+      res.push_back(locate_row(i));
+    }
+    return res;
+  }
+
+  size_t bytes() const {
+    return sizeof(*this) + (C.size() + samples.size())*sizeof(index_t) +
+           bwt.bytes() + sampled.bytes();
+  }
+};
+
+/*** Example Usage and Output:
+
+FM-index of 4194304 DNA characters:
+  build: 0.548328s, 0.656387 bytes per character
+  100000 counts of length 20: 0.329777s
+  100000 locates of length 20: 0.499784s
+
+***/
+
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+using namespace std;
+
+vector<index_t> naive_locate(const string &s, const string &p) {
+  vector<index_t> res;
+  for (size_t i = s.find(p); i != string::npos; i = s.find(p, i + 1)) {
+    res.push_back(i);
+  }
+  return res;
+}
+
+void test_random() {
+  for (int t = 0; t < 300; t++) {
+    int n = rand() % 300, alphabet = 1 + rand() % 10;
+    string s(n, 'a');
+    for (int i = 0; i < n; i++) {
+      s[i] = (i >= 5 && rand() % 4 == 0) ? s[i - 5]
+                                         : (char)('a' + rand() % alphabet);
+    }
+    fm_index fm(s, 1 + rand() % 40);
+    assert(fm.size() == (index_t)n);
+    for (int q = 0; q < 30; q++) {
+      int len = 1 + rand() % 6, pos = (n > 0) ? rand() % n : 0;
+      string p = (q % 2 == 0) ? s.substr(pos, len)
+                              : string(len, (char)('a' + rand() % 12));
+      if (p.empty()) {
+        continue;
+      }
+      vector<index_t> expected = naive_locate(s, p), res = fm.locate(p);
+      sort(res.begin(), res.end());
+      assert(res == expected && fm.count(p) == expected.size());
+    }
+    assert(fm.count("") == (index_t)n);
+  }
+}
+
+// Binary text containing every byte value, so that sigma + 1 = 257 codes
+// including the sentinel need 9 levels.
+void test_all_bytes() {
+  string s;
+  for (int r = 0; r < 3; r++) {
+    for (int c = 0; c < 256; c++) {
+      s += (char)c;
+    }
+  }
+  fm_index fm(s, 7);
+  for (int c = 0; c < 256; c++) {
+    vector<index_t> res = fm.locate(string(1, (char)c));
+    sort(res.begin(), res.end());
+    assert(res.size() == 3 && res[0] == (index_t)c && res[2] == 512u + c);
+  }
+  assert(fm.count("\xff") == 3 && fm.count(string("\xff\0", 2)) == 2);
+  assert(fm.count(string("\0\x01", 2)) == 3 && fm.count(s) == 1);
+}
+
+void benchmark(int n, int queries, int len) {
+  string s(n, 'a');
+  for (int i = 0; i < n; i++) {
+    s[i] = "ACGT"[rand() % 4];
+  }
+  vector<string> patterns(queries);
+  for (int i = 0; i < queries; i++) {
+    patterns[i] = s.substr(rand() % (n - len), len);
+  }
+  clock_t start = clock();
+  fm_index fm(s);
+  double build_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  cout << "FM-index of " << n << " DNA characters:" << endl;
+  cout << "  build: " << build_time << "s, " << (double)fm.bytes()/n
+       << " bytes per character" << endl;
+  start = clock();
+  long long total = 0;
+  for (int i = 0; i < queries; i++) {
+    total += fm.count(patterns[i]);
+  }
+  cout << "  " << queries << " counts of length " << len << ": "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s" << endl;
+  start = clock();
+  long long sum = 0;
+  for (int i = 0; i < queries; i++) {
+    vector<index_t> res = fm.locate(patterns[i]);
+    sum += res.size();
+  }
+  cout << "  " << queries << " locates of length " << len << ": "
+       << (double)(clock() - start)/CLOCKS_PER_SEC << "s" << endl;
+  assert(sum == total && total >= queries);
+}
+
+int main() {
+  fm_index fm("abracadabra", 4);
+  assert(fm.count("abra") == 2 && fm.count("a") == 5 && fm.count("x") == 0);
+  vector<index_t> pos = fm.locate("abra");
+  sort(pos.begin(), pos.end());
+  assert(pos.size() == 2 && pos[0] == 0 && pos[1] == 7);
+  assert(fm.count("cadabrax") == 0 && fm.locate("bra").size() == 2);
+  test_random();
+  test_all_bytes();
+  benchmark(1 << 22, 100000, 20);
+  return 0;
+}
@@ -17,6 +17,39 @@ from the root to a node that is flagged as a terminal node.
   NULL if the key was not found.
 - walk(f) calls the function f(s, v) on each entry of the map, in
   lexicographically ascending order of the string keys.
+- walk_prefix(p, f) calls the function f(s, v) on each entry of the map whose
+  key s starts with p, in lexicographically ascending order of the keys.
+- top_k(p, k) returns a vector of up to k (key, value) pairs with the largest
+  values (as compared by operator <) among the keys starting with p, in
+  descending order of values. Every node stores the maximum value in its
+  subtree, so a best-first search from the node for p expands only the nodes
+  whose maximum may still be among the top k.
+- stats() returns a reference to the statistics policy object of the trie.
+- double_array_trie(lo, hi) constructs a static map from a random-access range
+  [lo, hi) of (string key, value) pairs, which must be sorted in strictly
+  ascending order of keys. Every trie node is one 8-byte unit (base, check) in a
+  single array, where the child of node p along (byte) code c is the unit
+  t = base[p] + c if and only if check[t] = p. Code 0 marks the end of a key,
+  and the base of its unit stores the index of the key's value. The bases are
+  placed by scanning for free slots from the first position that is not almost
+  entirely occupied. Since the structure is immutable, any updates should be
+  made to a dynamic trie and then frozen into a new double_array_trie.
+- double_array_trie::find(s), size(), empty() and walk(f) behave as above, and
+  units() returns the number of slots in its array (trie nodes plus holes).
+
+Nodes of trie are allocated through the policy Pool<node_t>, which must provide
+allocate() returning uninitialized storage for one node and deallocate(n). The
+default node_pool carves nodes out of large slabs and reuses freed nodes, which
+avoids a call to the global allocator per node created by insert(). The child
+maps of the nodes still allocate through std::map. new_allocator may be passed
+instead to allocate every node separately, or arena_allocator to bump allocate
+nodes from growing chunks that are only freed with the trie. The destructor
+frees the nodes with an explicit stack. The policy Stats receives a call to
+on_allocate() per node allocation and on_visit() per node visited along the key
+by insert(), erase(), find(), walk_prefix(), and top_k(). Tries do not rotate,
+so on_rotate() is never called. The default no_stats ignores these at no cost,
+while counting_stats accumulates them into counters that may be read and reset
+through stats() to profile individual operations.
 
 Time Complexity:
 - O(n) per call to insert(s, v), erase(s), and find(s), where n is the length of
@@ -27,52 +60,229 @@ Time Complexity:
   is guaranteed.
 - O(l) per call to walk(), where l is the total length of string keys that are
   currently in the map.
+- O(n + l) per call to walk_prefix(p, f), where n is the length of p and l is
+  the total length of the keys visited.
+- O(n + m log m) per call to top_k(p, k), where m is the number of nodes pushed
+  onto the search queue, which is at most k times the maximum key length times
+  the alphabet size, but is typically proportional to k times the key length.
+  Since erase(s) recomputes the maximums along the path of s, it has a hidden
+  factor of the alphabet size.
+- O(n) per call to double_array_trie::find(s), with no hidden factor.
+- O(l*k) in the worst case per call to the double_array_trie constructor, where
+  k = 257 is the number of codes, but closer to O(l) in practice.
+- O(l) per call to double_array_trie::walk(), with a hidden factor of k.
 - O(1) per call to all other operations.
 
 Space Complexity:
 - O(l) for storage of the trie, where l is the total length of string keys that
   are currently in the map.
-- O(n) auxiliary stack space for construction, destruction, walk(), where n is
-  the maximum length of any string that has been inserted so far.
+- O(n) auxiliary stack space for walk(), where n is the maximum length of any
+  string that has been inserted so far.
+- O(n) auxiliary heap space for destruction, with a hidden factor of the
+  alphabet size.
 - O(n) auxiliary stack space for erase(s), where n is the length of s.
+- O(l) for storage of the double_array_trie, with 8 bytes per trie node plus
+  unused slots (usually a small fraction), and O(number of keys) for values.
 - O(1) auxiliary for all other operations.
 
 */
 
+#include <algorithm>
 #include <cstddef>
 #include <map>
+#include <new>
+#include <queue>
+#include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 using std::string;
 
-template<class V>
+// Default allocation policy, handing out nodes from slabs of SLAB_SIZE nodes
+// and recycling freed nodes through a free list. Slabs are only released when
+// the pool is destroyed.
+template<class Node>
+class node_pool {
+  static const int SLAB_SIZE = 1024;
+
+  std::vector<Node*> slabs, free_nodes;
+  int used;
+
+  node_pool(const node_pool &);
+  node_pool& operator=(const node_pool &);
+
+ public:
+  node_pool() : used(SLAB_SIZE) {}
+
+  ~node_pool() {
+    for (int i = 0; i < (int)slabs.size(); i++) {
+      ::operator delete(slabs[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (!free_nodes.empty()) {
+      Node *n = free_nodes.back();
+      free_nodes.pop_back();
+      return n;
+    }
+    if (used == SLAB_SIZE) {
+      void *slab = ::operator new(SLAB_SIZE*sizeof(Node));
+      slabs.push_back(static_cast<Node*>(slab));
+      used = 0;
+    }
+    return slabs.back() + used++;
+  }
+
+  void deallocate(Node *n) {
+    free_nodes.push_back(n);
+  }
+};
+
+// Alternative allocation policy, calling operator new and delete per node.
+template<class Node>
+struct new_allocator {
+  Node* allocate() {
+    return static_cast<Node*>(::operator new(sizeof(Node)));
+  }
+
+  void deallocate(Node *n) {
+    ::operator delete(n);
+  }
+};
+
+// Alternative allocation policy, handing out nodes from chunks of growing size
+// (up to MAX_CHUNK nodes) without ever reusing freed nodes. All storage is
+// released at once when the arena is destroyed, which suits tries that are
+// built and then discarded as a whole.
+template<class Node>
+class arena_allocator {
+  static const int MAX_CHUNK = 65536;
+
+  std::vector<Node*> chunks;
+  int used, capacity;
+
+  arena_allocator(const arena_allocator &);
+  arena_allocator& operator=(const arena_allocator &);
+
+ public:
+  arena_allocator() : used(0), capacity(0) {}
+
+  ~arena_allocator() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+      ::operator delete(chunks[i]);
+    }
+  }
+
+  Node* allocate() {
+    if (used == capacity) {
+      capacity = (capacity == 0) ? 16 : std::min(2*capacity, (int)MAX_CHUNK);
+      void *chunk = ::operator new(capacity*sizeof(Node));
+      chunks.push_back(static_cast<Node*>(chunk));
+      used = 0;
+    }
+    return chunks.back() + used++;
+  }
+
+  void deallocate(Node *) {}
+};
+
+// Default statistics policy, whose empty hooks compile away entirely.
+struct no_stats {
+  void on_allocate() {}
+  void on_rotate() {}
+  void on_visit() {}
+};
+
+// Alternative statistics policy, counting node allocations, rotations, and
+// nodes visited on search paths since construction or the last reset().
+struct counting_stats {
+  long long allocations, rotations, visits;
+
+  counting_stats() : allocations(0), rotations(0), visits(0) {}
+
+  void on_allocate() { allocations++; }
+  void on_rotate() { rotations++; }
+  void on_visit() { visits++; }
+
+  void reset() {
+    allocations = rotations = visits = 0;
+  }
+};
+
+template<class V, template<class> class Pool = node_pool,
+         class Stats = no_stats>
 class trie {
   struct node_t {
-    V value;
+    V value, max_value;
     bool is_terminal;
     std::map<char, node_t*> children;
 
     node_t() : is_terminal(false) {}
   } *root;
 
+  Pool<node_t> pool;
+  mutable Stats st;
+
+  node_t* create() {
+    st.on_allocate();
+    return new (pool.allocate()) node_t();
+  }
+
+  void destroy(node_t *n) {
+    n->~node_t();
+    pool.deallocate(n);
+  }
+
   typedef typename std::map<char, node_t*>::iterator cit;
 
-  static bool erase(node_t *n, const string &s, int i) {
+  struct queue_item {
+    V priority;
+    bool is_key;
+    node_t *n;
+    string s;
+
+    queue_item(const V &priority, bool is_key, node_t *n, const string &s)
+        : priority(priority), is_key(is_key), n(n), s(s) {}
+
+    bool operator<(const queue_item &q) const {
+      return priority < q.priority;
+    }
+  };
+
+  // Recomputes the maximum value in the non-empty subtree of n.
+  static void update(node_t *n) {
+    bool found = n->is_terminal;
+    if (found) {
+      n->max_value = n->value;
+    }
+    for (cit it = n->children.begin(); it != n->children.end(); ++it) {
+      if (!found || n->max_value < it->second->max_value) {
+        n->max_value = it->second->max_value;
+        found = true;
+      }
+    }
+  }
+
+  bool erase(node_t *n, const string &s, int i) {
+    st.on_visit();
     if (i == (int)s.size()) {
       if (!n->is_terminal) {
         return false;
       }
       n->is_terminal = false;
+      update(n);
       return true;
     }
     cit it = n->children.find(s[i]);
     if (it == n->children.end() || !erase(it->second, s, i + 1)) {
       return false;
     }
-    if (it->second->children.empty()) {
-      delete it->second;
+    if (it->second->children.empty() && !it->second->is_terminal) {
+      destroy(it->second);
       n->children.erase(it);
     }
+    update(n);
     return true;
   }
 
@@ -84,21 +294,43 @@ class trie {
     for (cit it = n->children.begin(); it != n->children.end(); ++it) {
       s += it->first;
       walk(it->second, s, f);
-      s.pop_back();
+      s.erase(s.size() - 1);
     }
   }
 
-  static void clean_up(node_t *n) {
-    for (cit it = n->children.begin(); it != n->children.end(); ++it) {
-      clean_up(it->second);
+  // Frees the subtree of n with an explicit stack, so that long keys cannot
+  // overflow the call stack.
+  void clean_up(node_t *n) {
+    std::vector<node_t*> stack(1, n);
+    while (!stack.empty()) {
+      n = stack.back();
+      stack.pop_back();
+      for (cit it = n->children.begin(); it != n->children.end(); ++it) {
+        stack.push_back(it->second);
+      }
+      destroy(n);
     }
-    delete n;
+  }
+
+  node_t* find_node(const string &s) const {
+    node_t *n = root;
+    for (int i = 0; i < (int)s.size(); i++) {
+      st.on_visit();
+      cit it = n->children.find(s[i]);
+      if (it == n->children.end()) {
+        return NULL;
+      }
+      n = it->second;
+    }
+    return n;
   }
 
   int num_terminals;
 
  public:
-  trie() : root(new node_t()), num_terminals(0) {}
+  trie() : num_terminals(0) {
+    root = create();
+  }
 
   ~trie() {
     clean_up(root);
@@ -114,10 +346,14 @@ class trie {
 
   bool insert(const string &s, const V &v) {
     node_t *n = root;
+    // The nodes at depths >= fresh were created here and are still empty.
+    int fresh = (num_terminals == 0) ? 0 : s.size() + 1;
     for (int i = 0; i < (int)s.size(); i++) {
+      st.on_visit();
       cit it = n->children.find(s[i]);
       if (it == n->children.end()) {
-        n->children[s[i]] = new node_t();
+        n->children[s[i]] = create();
+        fresh = std::min(fresh, i + 1);
       }
       n = n->children[s[i]];
     }
@@ -127,6 +363,15 @@ class trie {
     num_terminals++;
     n->is_terminal = true;
     n->value = v;
+    n = root;
+    for (int i = 0; i <= (int)s.size(); i++) {
+      if (i >= fresh || n->max_value < v) {
+        n->max_value = v;
+      }
+      if (i < (int)s.size()) {
+        n = n->children[s[i]];
+      }
+    }
     return true;
   }
 
@@ -139,21 +384,215 @@ class trie {
   }
 
   const V* find(const string &s) const {
-    node_t *n = root;
-    for (int i = 0; i < (int)s.size(); i++) {
-      cit it = n->children.find(s[i]);
-      if (it == n->children.end()) {
+    node_t *n = find_node(s);
+    return (n != NULL && n->is_terminal) ? &(n->value) : NULL;
+  }
+
+  template<class KVFunction>
+  void walk(KVFunction f) const {
+    string s = "";
+    walk(root, s, f);
+  }
+
+  template<class KVFunction>
+  void walk_prefix(const string &p, KVFunction f) const {
+    node_t *n = find_node(p);
+    if (n != NULL) {
+      string s(p);
+      walk(n, s, f);
+    }
+  }
+
+  std::vector<std::pair<string, V> > top_k(const string &p, int k) const {
+    std::vector<std::pair<string, V> > res;
+    node_t *n = find_node(p);
+    if (n == NULL || num_terminals == 0 || k <= 0) {
+      return res;
+    }
+    std::priority_queue<queue_item> q;
+    q.push(queue_item(n->max_value, false, n, p));
+    while (!q.empty() && (int)res.size() < k) {
+      queue_item top = q.top();
+      q.pop();
+      if (top.is_key) {
+        res.push_back(std::make_pair(top.s, top.priority));
+        continue;
+      }
+      n = top.n;
+      if (n->is_terminal) {
+        q.push(queue_item(n->value, true, NULL, top.s));
+      }
+      for (cit it = n->children.begin(); it != n->children.end(); ++it) {
+        q.push(queue_item(it->second->max_value, false, it->second,
+                          top.s + it->first));
+      }
+    }
+    return res;
+  }
+
+  const Stats& stats() const {
+    return st;
+  }
+
+  Stats& stats() {
+    return st;
+  }
+};
+
+template<class V>
+class double_array_trie {
+  static const int FREE = -1, ROOT_CHECK = -2, NUM_CODES = 257;
+
+  struct unit_t {
+    int base, check;
+  };
+
+  std::vector<unit_t> arr;
+  std::vector<V> values;
+  int next_check_pos;
+
+  static int code(const string &s, int depth) {
+    return (depth == (int)s.size()) ? 0 : (unsigned char)s[depth] + 1;
+  }
+
+  void reserve(int n) {
+    if (n > (int)arr.size()) {
+      unit_t u = {0, FREE};
+      arr.resize(std::max(n, 2*(int)arr.size()), u);
+    }
+  }
+
+  // Returns the smallest base >= 1 (found by scanning from next_check_pos) for
+  // which every slot base + codes[i] is free.
+  int find_base(const std::vector<int> &codes) {
+    int first = codes[0], last = codes.back();
+    int pos = std::max(next_check_pos, first + 1), start = -1, nonzero = 0;
+    for (;; pos++) {
+      reserve(pos - first + last + 1);
+      if (arr[pos].check != FREE) {
+        nonzero++;
+        continue;
+      }
+      if (start < 0) {
+        start = pos;
+      }
+      int base = pos - first;
+      bool ok = true;
+      for (int i = 1; ok && i < (int)codes.size(); i++) {
+        ok = (arr[base + codes[i]].check == FREE);
+      }
+      if (ok) {
+        break;
+      }
+    }
+    // Skip over a region once it is nearly full, to keep later scans short.
+    next_check_pos = start;
+    if (nonzero >= 0.95*(pos - next_check_pos + 1)) {
+      next_check_pos = pos + 1;
+    }
+    return pos - first;
+  }
+
+  // Builds the subtree at unit p from the keys lo[i] for i in [l, h), which
+  // all share their first depth characters.
+  template<class It>
+  void build(int p, It lo, int l, int h, int depth) {
+    std::vector<int> codes, starts;
+    for (int i = l; i < h; i++) {
+      int c = code(lo[i].first, depth);
+      if (codes.empty() || codes.back() != c) {
+        codes.push_back(c);
+        starts.push_back(i);
+      }
+    }
+    starts.push_back(h);
+    int base = find_base(codes);
+    arr[p].base = base;
+    for (int i = 0; i < (int)codes.size(); i++) {
+      arr[base + codes[i]].check = p;
+    }
+    for (int i = 0; i < (int)codes.size(); i++) {
+      if (codes[i] == 0) {
+        arr[base].base = ~starts[i];
+      } else {
+        build(base + codes[i], lo, starts[i], starts[i + 1], depth + 1);
+      }
+    }
+  }
+
+  template<class KVFunction>
+  void walk(int p, string &s, KVFunction f) const {
+    for (int c = 0; c < NUM_CODES; c++) {
+      int t = arr[p].base + c;
+      if (t >= (int)arr.size()) {
+        break;
+      }
+      if (arr[t].check != p) {
+        continue;
+      }
+      if (c == 0) {
+        f(s, values[~arr[t].base]);
+      } else {
+        s += (char)(c - 1);
+        walk(t, s, f);
+        s.erase(s.size() - 1);
+      }
+    }
+  }
+
+ public:
+  template<class It>
+  double_array_trie(It lo, It hi) : next_check_pos(1) {
+    int n = hi - lo;
+    for (int i = 1; i < n; i++) {
+      if (!(lo[i - 1].first < lo[i].first)) {
+        throw std::runtime_error("Keys must be sorted and unique.");
+      }
+    }
+    reserve(NUM_CODES + 1);
+    unit_t root = {0, ROOT_CHECK};
+    arr[0] = root;
+    values.reserve(n);
+    for (int i = 0; i < n; i++) {
+      values.push_back(lo[i].second);
+    }
+    if (n > 0) {
+      build(0, lo, 0, n, 0);
+    }
+    while (arr.size() > 1 && arr.back().check == FREE) {
+      arr.pop_back();
+    }
+    std::vector<unit_t>(arr).swap(arr);
+  }
+
+  int size() const {
+    return values.size();
+  }
+
+  bool empty() const {
+    return values.empty();
+  }
+
+  int units() const {
+    return arr.size();
+  }
+
+  const V* find(const string &s) const {
+    int p = 0, n = arr.size();
+    for (int i = 0; i <= (int)s.size(); i++) {
+      int t = arr[p].base + code(s, i);
+      if (t >= n || arr[t].check != p) {
         return NULL;
       }
-      n = it->second;
+      p = t;
     }
-    return n->is_terminal ? &(n->value) : NULL;
+    return &values[~arr[p].base];
   }
 
   template<class KVFunction>
   void walk(KVFunction f) const {
     string s = "";
-    walk(root, s, f);
+    walk(0, s, f);
   }
 };
 
@@ -168,10 +607,15 @@ class trie {
 ("ted", 4)
 ("ten", 5)
 ("to", 2)
+360968 keys, 1641008 trie nodes, 2003369 double-array units (build 0.18077s)
+500000 lookups: trie 0.356685s, double_array_trie 0.063627s
+10000 top-10 queries: 62.7751 microseconds per query
 
 ***/
 
 #include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
 using namespace std;
 
@@ -179,6 +623,130 @@ void print_entry(const string &k, int v) {
   cout << "(\"" << k << "\", " << v << ")" << endl;
 }
 
+vector<pair<string, int> > entries;
+
+void collect_entry(const string &k, int v) {
+  entries.push_back(make_pair(k, v));
+}
+
+string random_key(int max_len, int alphabet) {
+  string s(rand() % (max_len + 1), 0);
+  for (int i = 0; i < (int)s.size(); i++) {
+    s[i] = (char)(alphabet < 256 ? 'a' + rand() % alphabet : rand() % 256);
+  }
+  return s;
+}
+
+void test_double_array(int n, int max_len, int alphabet) {
+  map<string, int> m;
+  for (int i = 0; i < n; i++) {
+    m[random_key(max_len, alphabet)] = i;
+  }
+  vector<pair<string, int> > v(m.begin(), m.end());
+  double_array_trie<int> d(v.begin(), v.end());
+  assert(d.size() == (int)m.size());
+  for (int i = 0; i < 2*n; i++) {
+    string k = random_key(max_len, alphabet);
+    const int *res = d.find(k);
+    assert((res == NULL) == (m.count(k) == 0));
+    assert(res == NULL || *res == m[k]);
+  }
+  entries.clear();
+  d.walk(collect_entry);
+  assert(entries == v);
+}
+
+bool has_prefix(const string &s, const string &p) {
+  return s.compare(0, p.size(), p) == 0;
+}
+
+void test_prefix_queries(int n, int max_len, int alphabet) {
+  map<string, int> m;
+  trie<int> t;
+  for (int i = 0; i < n; i++) {
+    string k = random_key(max_len, alphabet);
+    if (rand() % 3 != 0) {
+      int v = rand() % 100;
+      assert(t.insert(k, v) == m.insert(make_pair(k, v)).second);
+    } else {
+      assert(t.erase(k) == (m.erase(k) == 1));
+    }
+  }
+  for (int i = 0; i < 20; i++) {
+    string p = random_key(max_len/2, alphabet);
+    vector<pair<string, int> > expected;
+    vector<int> values;
+    map<string, int>::iterator it = m.lower_bound(p);
+    for (; it != m.end() && has_prefix(it->first, p); ++it) {
+      expected.push_back(*it);
+      values.push_back(it->second);
+    }
+    entries.clear();
+    t.walk_prefix(p, collect_entry);
+    assert(entries == expected);
+    sort(values.rbegin(), values.rend());
+    int k = rand() % 6;
+    vector<pair<string, int> > res = t.top_k(p, k);
+    assert((int)res.size() == min(k, (int)values.size()));
+    for (int j = 0; j < (int)res.size(); j++) {
+      assert(res[j].second == values[j] && has_prefix(res[j].first, p));
+      assert(m[res[j].first] == res[j].second);
+    }
+  }
+}
+
+void benchmark(int n) {
+  vector<string> keys(n);
+  for (int i = 0; i < n; i++) {
+    keys[i] = random_key(12, 26);
+  }
+  trie<int> t;
+  for (int i = 0; i < n; i++) {
+    t.insert(keys[i], i);
+  }
+  entries.clear();
+  t.walk(collect_entry);
+  int nodes = 1;
+  for (int i = 0; i < (int)entries.size(); i++) {
+    const string &a = entries[i].first, &b = i ? entries[i - 1].first : "";
+    int l = 0;
+    while (l < (int)a.size() && l < (int)b.size() && a[l] == b[l]) {
+      l++;
+    }
+    nodes += a.size() - l;
+  }
+  clock_t start = clock();
+  double_array_trie<int> d(entries.begin(), entries.end());
+  double build_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  cout << entries.size() << " keys, " << nodes << " trie nodes, "
+       << d.units() << " double-array units (build " << build_time << "s)"
+       << endl;
+  long long sum1 = 0, sum2 = 0;
+  start = clock();
+  for (int i = 0; i < n; i++) {
+    sum1 += *t.find(keys[i]);
+  }
+  double trie_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  for (int i = 0; i < n; i++) {
+    sum2 += *d.find(keys[i]);
+  }
+  double da_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  assert(sum1 == sum2);
+  cout << n << " lookups: trie " << trie_time << "s, double_array_trie "
+       << da_time << "s" << endl;
+  int queries = 10000;
+  start = clock();
+  for (int i = 0; i < queries; i++) {
+    string p = random_key(3, 26);
+    vector<pair<string, int> > res = t.top_k(p, 10);
+    assert(res.empty() || *t.find(res[0].first) == res[0].second);
+  }
+  double top_time = (double)(clock() - start)/CLOCKS_PER_SEC;
+  cout << queries << " top-10 queries: " << top_time*1e6/queries
+       << " microseconds per query" << endl;
+}
+
 int main() {
   string s[9] = {"", "a", "to", "tea", "ted", "ten", "i", "in", "inn"};
   trie<int> t;
@@ -193,10 +761,59 @@ int main() {
   assert(t.size() == 9);
   assert(*t.find("") == 0);
   assert(*t.find("ten") == 5);
+
+  // Freeze the dynamic trie into a double array.
+  entries.clear();
+  t.walk(collect_entry);
+  double_array_trie<int> d(entries.begin(), entries.end());
+  assert(d.size() == 9 && *d.find("") == 0 && *d.find("inn") == 8);
+  assert(d.find("te") == NULL && d.find("tent") == NULL);
+  assert(d.find("x") == NULL);
+  double_array_trie<int> e(entries.begin(), entries.begin());
+  assert(e.empty() && e.find("") == NULL && e.find("a") == NULL);
+  bool thrown = false;
+  try {
+    swap(entries[1], entries[2]);
+    double_array_trie<int> bad(entries.begin(), entries.end());
+  } catch (runtime_error &) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  entries.clear();
+  t.walk_prefix("te", collect_entry);
+  assert(entries.size() == 3 && entries[0].first == "tea");
+  vector<pair<string, int> > top = t.top_k("t", 2);
+  assert(top.size() == 2 && top[0].first == "ten" && top[1].first == "ted");
+  assert(t.top_k("x", 2).empty() && t.top_k("", 20).size() == 9);
+
+  // Allocation policies and operation statistics.
+  trie<int, arena_allocator, counting_stats> profiled;
+  assert(profiled.insert("abc", 1) && profiled.insert("abd", 2));
+  // The root, the nodes for "a", "ab", "abc", and the node for "abd".
+  assert(profiled.stats().allocations == 5);
+  profiled.stats().reset();
+  assert(*profiled.find("abd") == 2 && profiled.stats().visits == 3);
+  assert(profiled.stats().rotations == 0);
+  trie<int, new_allocator> separate;
+  // A long key forms a path of 100001 nodes, which is destroyed iteratively.
+  assert(separate.insert(string(100000, 'a'), 1) && !separate.erase(""));
+  assert(separate.insert("ab", 2) && separate.erase("ab"));
+  assert(separate.size() == 1);
+
   assert(t.erase("tea"));
   assert(t.size() == 8);
   assert(t.find("tea") == NULL);
   assert(t.erase(""));
   assert(t.find("") == NULL);
+  assert(t.erase("inn") && *t.find("in") == 7);
+  assert(t.top_k("", 1)[0].first == "in");
+
+  for (int iter = 0; iter < 50; iter++) {
+    test_double_array(rand() % 300, 1 + rand() % 6, 2 + rand() % 4);
+    test_double_array(rand() % 300, 1 + rand() % 4, 256);
+    test_prefix_queries(rand() % 300, 1 + rand() % 8, 2 + rand() % 3);
+  }
+  benchmark(500000);
   return 0;
 }
@@ -12,22 +12,38 @@ The nodes of the graph are identified by integers indices numbered consecutively
 starting from 0. The total number of nodes will automatically increase based on
 the maximum node index passed to add_edge() so far.
 
+All traversals run on a single depth-first search engine with an explicit
+stack, so that they are not limited by the depth of the call stack (e.g. on a
+path of millions of nodes). traverse(start, visit, v) visits every unvisited
+node reachable from start, marking them in visit, and calls the following
+member functions of the visitor v:
+- v.pre(u, p) when node u is first visited from its parent p (or -1 if u is
+  start).
+- v.edge(u, w, tree) for each edge from u to w when it is examined, where tree
+  is true if w was not visited yet, in which case w is visited next.
+- v.post(u, p) once all edges of u have been examined, just before the search
+  returns to its parent p.
+The events occur in exactly the same order as in a recursive implementation.
+
 Time Complexity:
 - O(1) amortized per call to add_edge(), or O(max(n, m)) for n calls where the
   maximum node index passed as an argument is m.
-- O(max(n, m)) per call for dfs(), has_cycle(), is_tree(), or is_dag(), where n
-  is the number of nodes and and m is the number of edges.
+- O(max(n, m)) per call for traverse(), dfs(), has_cycle(), is_tree(), or
+  is_dag(), where n is the number of nodes and and m is the number of edges,
+  not counting the time taken by the visitor.
 - O(1) per call to all other public member functions.
 
 Space Complexity:
 - O(max(n, m)) for storage of the graph, where n is the number of nodes and m
   is the number of edges.
-- O(n) auxiliary stack space for dfs(), has_cycle(), is_tree(), and is_dag().
+- O(n) auxiliary heap space for traverse(), dfs(), has_cycle(), is_tree(), and
+  is_dag().
 - O(1) auxiliary for all other public member functions.
 
 */
 
 #include <algorithm>
+#include <utility>
 #include <vector>
 
 class graph {
@@ -35,36 +51,44 @@ class graph {
   bool directed;
 
   template<class ReportFunction>
-  void dfs(int n, std::vector<bool> &visit, ReportFunction f) const {
-    f(n);
-    visit[n] = true;
-    std::vector<int>::const_iterator it;
-    for (it = adj[n].begin(); it != adj[n].end(); ++it) {
-      if (!visit[*it]) {
-        dfs(*it, visit, f);
-      }
+  struct preorder_visitor {
+    ReportFunction f;
+
+    preorder_visitor(ReportFunction f) : f(f) {}
+
+    void pre(int u, int) {
+      f(u);
     }
-  }
 
-  bool has_cycle(int n, int prev, std::vector<bool> &visit,
-                 std::vector<bool> &onstack) const {
-    visit[n] = true;
-    onstack[n] = true;
-    std::vector<int>::const_iterator it;
-    for (it = adj[n].begin(); it != adj[n].end(); ++it) {
-      if (directed && onstack[*it]) {
-        return true;
-      }
-      if (!directed && visit[*it] && *it != prev) {
-        return true;
-      }
-      if (!visit[*it] && has_cycle(*it, n, visit, onstack)) {
-        return true;
+    void edge(int, int, bool) {}
+    void post(int, int) {}
+  };
+
+  // A back edge to a node on the stack closes a cycle in a directed graph, and
+  // any edge to a visited node other than the parent does in an undirected one.
+  struct cycle_visitor {
+    bool directed, found;
+    std::vector<bool> onstack;
+    std::vector<int> parent;
+
+    cycle_visitor(bool directed, int n)
+        : directed(directed), found(false), onstack(n), parent(n) {}
+
+    void pre(int u, int p) {
+      onstack[u] = true;
+      parent[u] = p;
+    }
+
+    void edge(int u, int v, bool tree) {
+      if (!tree && (directed ? onstack[v] : v != parent[u])) {
+        found = true;
       }
     }
-    onstack[n] = false;
-    return false;
-  }
+
+    void post(int u, int) {
+      onstack[u] = false;
+    }
+  };
 
  public:
   graph(bool directed = true) : directed(directed) {}
@@ -92,15 +116,41 @@ class graph {
     return directed;
   }
 
+  template<class Visitor>
+  void traverse(int start, std::vector<bool> &visit, Visitor &v) const {
+    // Each frame holds a node and the index of its next edge to examine.
+    std::vector<std::pair<int, int> > frames;
+    visit[start] = true;
+    v.pre(start, -1);
+    frames.push_back(std::make_pair(start, 0));
+    while (!frames.empty()) {
+      int u = frames.back().first, j = frames.back().second++;
+      if (j == (int)adj[u].size()) {
+        frames.pop_back();
+        v.post(u, frames.empty() ? -1 : frames.back().first);
+        continue;
+      }
+      int w = adj[u][j];
+      bool tree = !visit[w];
+      v.edge(u, w, tree);
+      if (tree) {
+        visit[w] = true;
+        v.pre(w, u);
+        frames.push_back(std::make_pair(w, 0));
+      }
+    }
+  }
+
   bool has_cycle() const {
     int n = adj.size();
-    std::vector<bool> visit(n, false), onstack(n, false);
-    for (int i = 0; i < n; i++) {
-      if (!visit[i] && has_cycle(i, -1, visit, onstack)) {
-        return true;
+    std::vector<bool> visit(n, false);
+    cycle_visitor v(directed, n);
+    for (int i = 0; i < n && !v.found; i++) {
+      if (!visit[i]) {
+        traverse(i, visit, v);
       }
     }
-    return false;
+    return v.found;
   }
 
   bool is_tree() const {
@@ -114,7 +164,8 @@ class graph {
   template<class ReportFunction>
   void dfs(int start, ReportFunction f) const {
     std::vector<bool> visit(adj.size(), false);
-    dfs(start, visit, f);
+    preorder_visitor<ReportFunction> v(f);
+    traverse(start, visit, v);
   }
 };
 
@@ -132,6 +183,27 @@ void print(int n) {
   cout << n << " ";
 }
 
+struct event_visitor {
+  vector<int> tin, tout, events;
+
+  event_visitor(int n) : tin(n, -1), tout(n, -1) {}
+
+  void pre(int u, int) {
+    tin[u] = events.size();
+    events.push_back(u);
+  }
+
+  void edge(int u, int v, bool tree) {
+    assert(tin[u] != -1 && tout[u] == -1);
+    assert(tree == (tin[v] == -1));
+  }
+
+  void post(int u, int) {
+    tout[u] = events.size();
+    events.push_back(~u);
+  }
+};
+
 int main() {
   {
     graph g;
@@ -164,5 +236,37 @@ int main() {
     tree.add_edge(2, 3);
     assert(!tree.is_tree());
   }
+  {
+    graph g;
+    g.add_edge(0, 1);
+    g.add_edge(1, 2);
+    g.add_edge(0, 2);
+    g.add_edge(2, 0);
+    vector<bool> visit(3, false);
+    event_visitor v(3);
+    g.traverse(0, visit, v);
+    int expected[6] = {0, 1, 2, ~2, ~1, ~0};
+    assert(v.events == vector<int>(expected, expected + 6));
+    assert(g.has_cycle());
+  }
+  {
+    // A recursive search would overflow the call stack on such a long path.
+    int n = 1000000;
+    graph path(false);
+    for (int i = 0; i + 1 < n; i++) {
+      path.add_edge(i, i + 1);
+    }
+    assert(path.is_tree());
+    int count = 0;
+    vector<bool> visit(n, false);
+    event_visitor v(n);
+    path.traverse(0, visit, v);
+    for (int i = 0; i < n; i++) {
+      count += (v.tin[i] == i && v.tout[i] == 2*n - 1 - i);
+    }
+    assert(count == n);
+    path.add_edge(n - 1, 0);
+    assert(!path.is_tree());
+  }
   return 0;
 }
@@ -8,62 +8,332 @@ toposort(nodes) takes a directed graph stored as a global adjacency list with
 nodes indexed from 0 to (nodes - 1) and assigns a valid topological ordering to
 the global result vector. An error is thrown if the graph contains a cycle.
 
+The search runs on the explicit-stack depth-first search engine of section
+4.1.1, whose visitor is notified when each node is entered, for each edge, and
+when each node is finished. Nodes are appended to the result as they finish,
+and an edge to a node that is entered but not finished closes a cycle. Since
+no recursion is used, the graph may have paths of any length.
+
+incremental_toposort maintains a topological order of a graph as edges are
+inserted one at a time, using the algorithm of Pearce and Kelly (2006). The
+position of every node in the order is stored along with the node at every
+position. Inserting an edge (u, v) into a graph with u already before v leaves
+the order unchanged. Otherwise, the affected region is the range of positions
+from v to u. A search forward from v and a search backward from u only visit
+the nodes of that region, and if the forward search reaches u, the edge would
+close a cycle. Else, the nodes found backward from u must all come before those
+found forward from v, so both sets are reassigned the positions that they held
+between them, each keeping its own relative order, with no other nodes moving.
+
+- incremental_toposort(n) constructs a graph of n nodes and no edges, whose
+  initial order is 0, 1, ..., n - 1.
+- nodes() returns the number of nodes.
+- add_node() adds a node at the end of the order, returning its index.
+- add_edge(u, v) inserts the edge from u to v and returns true, or returns false
+  without inserting it if it would create a cycle (including if u == v).
+- position(v) returns the position of node v in the current order.
+- node_at(i) returns the node at position i in the current order.
+- order() returns the nodes in the current order.
+
 Time Complexity:
 - O(max(n, m)) per call to toposort(), where n is the number of nodes and m is
   the number of edges.
+- O(1) per call to the nodes(), add_node(), position(), and node_at().
+- O(d log d) per call to add_edge(), where d is the number of nodes visited by
+  both searches and their edges, all of which lie within the affected region.
+  This is O(1) if the edge already agrees with the order.
+- O(n) per call to order() and the incremental_toposort constructor.
 
 Space Complexity:
 - O(max(n, m)) for storage of the graph, where n is the number of nodes and m
   is the number of edges.
-- O(n) auxiliary stack space for toposort().
+- O(n) auxiliary heap space for toposort().
+- O(n + m) for storage of incremental_toposort, plus O(d) auxiliary heap space
+  per call to add_edge().
 
 */
 
 #include <algorithm>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
-const int MAXN = 100;
+const int MAXN = 1000000;
 std::vector<int> adj[MAXN], res;
 std::vector<bool> visit(MAXN), done(MAXN);
 
-void dfs(int u) {
-  if (visit[u]) {
-    throw std::runtime_error("Not a directed acyclic graph.");
+template<class Visitor>
+void dfs(int start, Visitor &v) {
+  std::vector<std::pair<int, int> > frames;
+  visit[start] = true;
+  v.pre(start, -1);
+  frames.push_back(std::make_pair(start, 0));
+  while (!frames.empty()) {
+    int u = frames.back().first, j = frames.back().second++;
+    if (j == (int)adj[u].size()) {
+      frames.pop_back();
+      v.post(u, frames.empty() ? -1 : frames.back().first);
+      continue;
+    }
+    int w = adj[u][j];
+    bool tree = !visit[w];
+    v.edge(u, w, tree);
+    if (tree) {
+      visit[w] = true;
+      v.pre(w, u);
+      frames.push_back(std::make_pair(w, 0));
+    }
   }
-  if (done[u]) {
-    return;
+}
+
+struct toposort_visitor {
+  void pre(int, int) {}
+
+  void edge(int, int v, bool tree) {
+    if (!tree && !done[v]) {
+      throw std::runtime_error("Not a directed acyclic graph.");
+    }
   }
-  visit[u] = true;
-  for (int j = 0; j < (int)adj[u].size(); j++) {
-    dfs(adj[u][j]);
+
+  void post(int u, int) {
+    done[u] = true;
+    res.push_back(u);
   }
-  visit[u] = false;
-  done[u] = true;
-  res.push_back(u);
-}
+};
 
 void toposort(int nodes) {
-  fill(visit.begin(), visit.end(), false);
-  fill(done.begin(), done.end(), false);
+  std::fill(visit.begin(), visit.begin() + nodes, false);
+  std::fill(done.begin(), done.begin() + nodes, false);
   res.clear();
+  toposort_visitor v;
   for (int i = 0; i < nodes; i++) {
-    if (!done[i]) {
-      dfs(i);
+    if (!visit[i]) {
+      dfs(i, v);
     }
   }
   std::reverse(res.begin(), res.end());
 }
 
+class incremental_toposort {
+  std::vector<std::vector<int> > out, in;
+  std::vector<int> pos, node;
+  std::vector<bool> mark;
+  std::vector<int> forward, backward, stack;
+
+  struct by_position {
+    const std::vector<int> &pos;
+
+    by_position(const std::vector<int> &pos) : pos(pos) {}
+
+    bool operator()(int a, int b) const {
+      return pos[a] < pos[b];
+    }
+  };
+
+  // Marks and appends to res every node reachable from start through adj that
+  // lies within positions [lo, hi], returning true as soon as target is found.
+  bool search(int start, const std::vector<std::vector<int> > &adj, int lo,
+              int hi, int target, std::vector<int> &res) {
+    mark[start] = true;
+    res.push_back(start);
+    stack.assign(1, start);
+    while (!stack.empty()) {
+      int x = stack.back();
+      stack.pop_back();
+      for (int j = 0; j < (int)adj[x].size(); j++) {
+        int y = adj[x][j];
+        if (y == target) {
+          return true;
+        }
+        if (!mark[y] && lo <= pos[y] && pos[y] <= hi) {
+          mark[y] = true;
+          res.push_back(y);
+          stack.push_back(y);
+        }
+      }
+    }
+    return false;
+  }
+
+  void unmark(const std::vector<int> &nodes) {
+    for (int i = 0; i < (int)nodes.size(); i++) {
+      mark[nodes[i]] = false;
+    }
+  }
+
+ public:
+  incremental_toposort(int nodes = 0)
+      : out(nodes), in(nodes), pos(nodes), node(nodes), mark(nodes, false) {
+    for (int i = 0; i < nodes; i++) {
+      pos[i] = node[i] = i;
+    }
+  }
+
+  int nodes() const {
+    return node.size();
+  }
+
+  int add_node() {
+    int v = node.size();
+    out.push_back(std::vector<int>());
+    in.push_back(std::vector<int>());
+    pos.push_back(v);
+    node.push_back(v);
+    mark.push_back(false);
+    return v;
+  }
+
+  bool add_edge(int u, int v) {
+    if (u == v) {
+      return false;
+    }
+    int lo = pos[v], hi = pos[u];
+    if (lo < hi) {
+      forward.clear();
+      backward.clear();
+      if (search(v, out, lo, hi, u, forward)) {
+        unmark(forward);
+        return false;
+      }
+      search(u, in, lo, hi, -1, backward);
+      std::sort(forward.begin(), forward.end(), by_position(pos));
+      std::sort(backward.begin(), backward.end(), by_position(pos));
+      // The backward set takes the lowest of the freed positions.
+      std::vector<int> slots;
+      for (int i = 0; i < (int)backward.size(); i++) {
+        slots.push_back(pos[backward[i]]);
+      }
+      for (int i = 0; i < (int)forward.size(); i++) {
+        slots.push_back(pos[forward[i]]);
+      }
+      std::sort(slots.begin(), slots.end());
+      backward.insert(backward.end(), forward.begin(), forward.end());
+      for (int i = 0; i < (int)backward.size(); i++) {
+        pos[backward[i]] = slots[i];
+        node[slots[i]] = backward[i];
+      }
+      unmark(backward);
+    }
+    out[u].push_back(v);
+    in[v].push_back(u);
+    return true;
+  }
+
+  int position(int v) const {
+    return pos[v];
+  }
+
+  int node_at(int i) const {
+    return node[i];
+  }
+
+  std::vector<int> order() const {
+    return node;
+  }
+};
+
 /*** Example Usage and Output:
 
 The topological order: 2 1 0 4 3 7 6 5
+399997 inserts into 100000 nodes:
+  incremental_toposort 0.402808us per insert
+  toposort 24498.9us per recomputation
 
 ***/
 
+#include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <sys/time.h>
 using namespace std;
 
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+int rand30() {
+  return (rand() & 0x7fff) << 15 ^ (rand() & 0x7fff);
+}
+
+// Returns whether target is reachable from start through the edges in adj.
+bool reachable(const vector<vector<int> > &adj, int start, int target) {
+  vector<bool> seen(adj.size(), false);
+  vector<int> q(1, start);
+  seen[start] = true;
+  for (int i = 0; i < (int)q.size(); i++) {
+    if (q[i] == target) {
+      return true;
+    }
+    for (int j = 0; j < (int)adj[q[i]].size(); j++) {
+      if (!seen[adj[q[i]][j]]) {
+        seen[adj[q[i]][j]] = true;
+        q.push_back(adj[q[i]][j]);
+      }
+    }
+  }
+  return false;
+}
+
+void test_incremental(int n, int inserts) {
+  incremental_toposort t(n);
+  vector<vector<int> > g(n);
+  for (int k = 0; k < inserts; k++) {
+    if (rand() % 50 == 0) {
+      assert(t.add_node() == n++);
+      g.push_back(vector<int>());
+    }
+    int u = rand() % n, v = rand() % n;
+    bool cycle = reachable(g, v, u);
+    assert(t.add_edge(u, v) == !cycle);
+    if (!cycle) {
+      g[u].push_back(v);
+    }
+    vector<int> order = t.order();
+    assert(t.nodes() == n && (int)order.size() == n);
+    for (int i = 0; i < n; i++) {
+      assert(t.node_at(t.position(i)) == i && order[t.position(i)] == i);
+      for (int j = 0; j < (int)g[i].size(); j++) {
+        assert(t.position(i) < t.position(g[i][j]));
+      }
+    }
+  }
+}
+
+void benchmark(int n, int m) {
+  // Random edges oriented by a hidden order, so that none closes a cycle.
+  vector<int> hidden(n);
+  for (int i = 0; i < n; i++) {
+    hidden[i] = i;
+    adj[i].clear();
+  }
+  for (int i = n - 1; i > 0; i--) {
+    swap(hidden[i], hidden[rand30() % (i + 1)]);
+  }
+  vector<pair<int, int> > edges;
+  for (int i = 0; i < m; i++) {
+    int a = rand30() % n, b = rand30() % n;
+    if (a != b) {
+      edges.push_back(make_pair(hidden[min(a, b)], hidden[max(a, b)]));
+    }
+  }
+  incremental_toposort t(n);
+  double start = wall_time();
+  for (int i = 0; i < (int)edges.size(); i++) {
+    assert(t.add_edge(edges[i].first, edges[i].second));
+    adj[edges[i].first].push_back(edges[i].second);
+  }
+  double incremental_time = wall_time() - start;
+  start = wall_time();
+  toposort(n);
+  double recompute_time = wall_time() - start;
+  cout << edges.size() << " inserts into " << n << " nodes:" << endl
+       << "  incremental_toposort " << 1e6*incremental_time/edges.size()
+       << "us per insert" << endl << "  toposort " << 1e6*recompute_time
+       << "us per recomputation" << endl;
+}
+
 int main() {
   adj[0].push_back(3);
   adj[0].push_back(4);
@@ -80,5 +350,41 @@ int main() {
     cout << " " << res[i];
   }
   cout << endl;
+  int expected[8] = {2, 1, 0, 4, 3, 7, 6, 5};
+  assert(res == vector<int>(expected, expected + 8));
+
+  adj[5].push_back(0);
+  bool thrown = false;
+  try {
+    toposort(8);
+  } catch (runtime_error &) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  // A recursive search would overflow the call stack on such a long path.
+  int n = MAXN;
+  for (int i = 0; i < n; i++) {
+    adj[i].clear();
+  }
+  for (int i = n - 1; i > 0; i--) {
+    adj[i].push_back(i - 1);
+  }
+  toposort(n);
+  assert((int)res.size() == n && res[0] == n - 1 && res[n - 1] == 0);
+
+  {
+    incremental_toposort t(8);
+    assert(t.add_edge(3, 1) && t.add_edge(1, 0) && t.add_edge(2, 3));
+    int expected[8] = {2, 3, 1, 0, 4, 5, 6, 7};
+    assert(t.order() == vector<int>(expected, expected + 8));
+    assert(!t.add_edge(0, 2) && !t.add_edge(5, 5));
+    assert(t.order() == vector<int>(expected, expected + 8));
+    assert(t.add_edge(7, 1) && t.position(7) < t.position(1));
+  }
+  for (int n = 1; n <= 40; n += 3) {
+    test_incremental(n, 3*n);
+  }
+  benchmark(100000, 400000);
   return 0;
 }
@@ -28,11 +28,37 @@ Space Complexity:
   number of edges if the used[][] bit matrix is replaced with an
   std::unordered_set<std::pair<int, int>>.
 
+For large graphs, the following versions take a csr_graph (see section 4.1.5),
+or any graph type with the same read-only interface, and allow parallel edges
+and self-loops. Both are the iterative algorithm of Hierholzer above, where
+every node keeps a cursor to the next of its edges to be tried, so that every
+edge is examined a constant number of times and the graph is not modified.
+- euler_cycle_directed(g, u) returns an Eulerian cycle from u in the directed
+  graph g.
+- euler_cycle_undirected(g, u) returns an Eulerian cycle from u in the
+  undirected graph g, which must be built as csr_graph(n, edges, ids, true)
+  where ids[i] = i for each edge i. Both directions of an edge then have its
+  index as their weight, and a bitmap of used edges replaces the bit matrix.
+
+Time Complexity:
+- O(n + m) per call to either function on g, where n and m are the numbers of
+  nodes and edges respectively.
+
+Space Complexity:
+- O(n + m) auxiliary heap space for either function on g, most of which is for
+  the stack and the result. The used edges take only m bits.
+
 */
 
 #include <algorithm>
 #include <bitset>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 #include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 const int MAXN = 100;
 
@@ -74,16 +100,249 @@ std::vector<int> euler_cycle_undirected(std::vector<int> adj[], int u) {
   return res;
 }
 
+typedef unsigned int edge_index_t;
+
+template<class W = int>
+class csr_graph {
+  int num_nodes;
+  std::vector<edge_index_t> offsets;
+  std::vector<int> targets;
+  std::vector<W> weights;
+
+  void build(const std::vector<std::pair<int, int> > &edges, const W *w,
+             bool symmetric) {
+    int n = num_nodes;
+    long long total = (long long)edges.size()*(symmetric ? 2 : 1);
+    if (total > (long long)std::numeric_limits<edge_index_t>::max()) {
+      throw std::runtime_error("Too many edges for 32-bit offsets.");
+    }
+    edge_index_t m = total, half = edges.size();
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = std::max(1, std::min(omp_get_max_threads(),
+                                       (int)(m/65536) + 1));
+#endif
+    // count[t*n + u] is the number of edges from u in chunk t, which is then
+    // replaced by the first slot of those edges within the list of u.
+    std::vector<edge_index_t> count((size_t)num_threads*n, 0);
+    offsets.assign(n + 1, 0);
+    targets.resize(m);
+    if (w != NULL) {
+      weights.resize(m);
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        c[(e < half) ? edges[e].first : edges[e - half].second]++;
+      }
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(num_threads)
+#endif
+    for (int u = 0; u < n; u++) {
+      edge_index_t sum = 0;
+      for (int t = 0; t < num_threads; t++) {
+        edge_index_t c = count[(size_t)t*n + u];
+        count[(size_t)t*n + u] = sum;
+        sum += c;
+      }
+      offsets[u + 1] = sum;
+    }
+    for (int u = 0; u < n; u++) {
+      offsets[u + 1] += offsets[u];
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        int u = edges[(e < half) ? e : e - half].first;
+        int v = edges[(e < half) ? e : e - half].second;
+        if (e >= half) {
+          std::swap(u, v);
+        }
+        edge_index_t slot = offsets[u] + c[u]++;
+        targets[slot] = v;
+        if (w != NULL) {
+          weights[slot] = w[(e < half) ? e : e - half];
+        }
+      }
+    }
+  }
+
+ public:
+  typedef W weight_type;
+
+  csr_graph() : num_nodes(0), offsets(1, 0) {}
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            bool symmetric = false) : num_nodes(nodes) {
+    build(edges, NULL, symmetric);
+  }
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            const std::vector<W> &weights, bool symmetric = false)
+      : num_nodes(nodes) {
+    if (weights.size() != edges.size()) {
+      throw std::runtime_error("Expected one weight per edge.");
+    }
+    build(edges, weights.empty() ? NULL : &weights[0], symmetric);
+  }
+
+  int nodes() const {
+    return num_nodes;
+  }
+
+  edge_index_t edges() const {
+    return offsets[num_nodes];
+  }
+
+  edge_index_t offset(int u) const {
+    return offsets[u];
+  }
+
+  int degree(int u) const {
+    return offsets[u + 1] - offsets[u];
+  }
+
+  int target(edge_index_t e) const {
+    return targets[e];
+  }
+
+  W weight(edge_index_t e) const {
+    return weights.empty() ? W(1) : weights[e];
+  }
+
+  bool is_weighted() const {
+    return !weights.empty();
+  }
+};
+
+template<class Graph>
+std::vector<int> euler_cycle_directed(const Graph &g, int u) {
+  // The cursor and end of the edges of a node share a cache line.
+  std::vector<std::pair<edge_index_t, edge_index_t> > edge(g.nodes());
+  for (int v = 0; v < g.nodes(); v++) {
+    edge[v] = std::make_pair(g.offset(v), g.offset(v + 1));
+  }
+  std::vector<int> stack(1, u), res;
+  while (!stack.empty()) {
+    u = stack.back();
+    stack.pop_back();
+    while (edge[u].first < edge[u].second) {
+      stack.push_back(u);
+      u = g.target(edge[u].first++);
+    }
+    res.push_back(u);
+  }
+  std::reverse(res.begin(), res.end());
+  return res;
+}
+
+template<class Graph>
+std::vector<int> euler_cycle_undirected(const Graph &g, int u) {
+  // The cursor and end of the edges of a node share a cache line.
+  std::vector<std::pair<edge_index_t, edge_index_t> > edge(g.nodes());
+  for (int v = 0; v < g.nodes(); v++) {
+    edge[v] = std::make_pair(g.offset(v), g.offset(v + 1));
+  }
+  std::vector<bool> used(g.edges()/2 + 1, false);
+  std::vector<int> stack(1, u), res;
+  while (!stack.empty()) {
+    u = stack.back();
+    stack.pop_back();
+    while (edge[u].first < edge[u].second) {
+      edge_index_t e = edge[u].first++;
+      if (!used[g.weight(e)]) {
+        used[g.weight(e)] = true;
+        stack.push_back(u);
+        u = g.target(e);
+      }
+    }
+    res.push_back(u);
+  }
+  std::reverse(res.begin(), res.end());
+  return res;
+}
+
 /*** Example Usage and Output:
 
 Eulerian cycle from 0 (directed): 0 1 3 4 1 2 0
 Eulerian cycle from 2 (undirected): 2 1 3 4 1 0 2
+de Bruijn graph with 8388608 edges: 1.33789s
+Undirected graph with 5000000 edges: 2.33472s
 
 ***/
 
+#include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <sys/time.h>
 using namespace std;
 
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+int rand30() {
+  return (rand() & 0x7fff) << 15 | (rand() & 0x7fff);
+}
+
+// Checks that cycle uses every edge exactly once, in either direction if not
+// directed.
+void check_cycle(vector<pair<int, int> > edges, const vector<int> &cycle,
+                 bool directed) {
+  assert(cycle.size() == edges.size() + 1 && cycle[0] == cycle.back());
+  vector<pair<int, int> > walked;
+  for (int i = 0; i + 1 < (int)cycle.size(); i++) {
+    walked.push_back(make_pair(cycle[i], cycle[i + 1]));
+    if (!directed && walked.back().first > walked.back().second) {
+      swap(walked.back().first, walked.back().second);
+    }
+  }
+  for (int i = 0; i < (int)edges.size() && !directed; i++) {
+    if (edges[i].first > edges[i].second) {
+      swap(edges[i].first, edges[i].second);
+    }
+  }
+  sort(edges.begin(), edges.end());
+  sort(walked.begin(), walked.end());
+  assert(edges == walked);
+}
+
+// Returns the edges of a union of random closed walks over n nodes from 0.
+vector<pair<int, int> > random_eulerian(int n, int walks, int length) {
+  vector<pair<int, int> > edges;
+  for (int i = 0; i < walks; i++) {
+    int start = (i == 0) ? 0 : edges[rand30() % edges.size()].first, u = start;
+    for (int j = 1; j < length; j++) {
+      int v = rand30() % n;
+      edges.push_back(make_pair(u, v));
+      u = v;
+    }
+    edges.push_back(make_pair(u, start));
+  }
+  return edges;
+}
+
 int main() {
   {
     vector<int> g[5], cycle;
@@ -121,5 +380,41 @@ int main() {
     }
     cout << endl;
   }
+  for (int n = 1; n <= 10; n++) {
+    for (int t = 0; t < 50; t++) {
+      vector<pair<int, int> > edges = random_eulerian(n, 1 + t % 4, 1 + t % 7);
+      vector<int> ids(edges.size());
+      for (int i = 0; i < (int)ids.size(); i++) {
+        ids[i] = i;
+      }
+      check_cycle(edges, euler_cycle_directed(csr_graph<>(n, edges), 0), true);
+      check_cycle(edges, euler_cycle_undirected(csr_graph<>(n, edges, ids,
+                                                            true), 0), false);
+    }
+  }
+
+  // The de Bruijn graph of order 23 over {0, 1}, whose nodes are the strings
+  // of length 22 and whose edges are the strings of length 23.
+  int n = 1 << 22;
+  vector<pair<int, int> > edges;
+  for (int u = 0; u < n; u++) {
+    edges.push_back(make_pair(u, (u << 1) & (n - 1)));
+    edges.push_back(make_pair(u, ((u << 1) | 1) & (n - 1)));
+  }
+  double start = wall_time();
+  vector<int> cycle = euler_cycle_directed(csr_graph<>(n, edges), 0);
+  cout << "de Bruijn graph with " << edges.size() << " edges: "
+       << wall_time() - start << "s" << endl;
+  check_cycle(edges, cycle, true);
+  edges = random_eulerian(1000000, 100, 50000);
+  vector<int> ids(edges.size());
+  for (int i = 0; i < (int)ids.size(); i++) {
+    ids[i] = i;
+  }
+  start = wall_time();
+  cycle = euler_cycle_undirected(csr_graph<>(1000000, edges, ids, true), 0);
+  cout << "Undirected graph with " << edges.size() << " edges: "
+       << wall_time() - start << "s" << endl;
+  check_cycle(edges, cycle, false);
   return 0;
 }
@@ -8,19 +8,72 @@ adjacency list adj[] which consists of only nodes numbered with integers between
 0 (inclusive) and the total number of nodes (exclusive), as passed in the
 function argument.
 
+For large graphs, the following operate on a csr_graph (see section 4.1.5),
+or any graph type with the same read-only interface.
+
+- bfs(g, start, dist, pred) computes the same distances and predecessors into
+  the vectors dist and pred, using a serial queue.
+- parallel_bfs(out, in, start, dist, pred, alpha, beta) computes them with the
+  direction-optimizing BFS of Beamer, Asanovic & Patterson (2012), given the
+  graph out and its transpose in (for an undirected graph, both may be the same
+  symmetric graph). Each level is expanded either top-down, where the nodes of
+  the frontier claim their unvisited neighbors by atomically setting bits in a
+  visited bitmap, or bottom-up, where every unvisited node scans its incoming
+  edges for any parent in the frontier bitmap and stops at the first one found.
+  Bottom-up steps are cheaper once the frontier holds a large part of the graph,
+  since most unvisited nodes then find a parent almost immediately. The search
+  switches to bottom-up when the edges out of the frontier exceed 1/alpha of
+  the edges out of unvisited nodes, and back to top-down when the frontier has
+  fewer than 1/beta of all nodes. Levels are processed in parallel if compiled
+  with -fopenmp, in which case the predecessors may differ from those of a
+  serial search (though each is still a shortest path tree).
+- multi_source_bfs<K>(in, sources, visit) runs a bit-parallel BFS from up to
+  64*K sources at once, following Then et al. (2014), given the transpose in of
+  the graph (for an undirected graph, the symmetric graph itself). Every node
+  holds a source_set of K 64-bit words, where bit i is set if sources[i] has
+  seen the node. At each level, every node ORs together the frontier sets of its
+  in-neighbors and keeps the bits it has not yet seen, so that one scan of the
+  edges advances all of the searches, and nodes already seen by every source are
+  skipped. For every node v newly reached at distance d by a nonempty set s of
+  sources, visit(v, d, s) is called, concurrently for different nodes if
+  compiled with -fopenmp.
+- hop_matrix(in, sources, dist) sets dist[i][v] to the number of edges on the
+  shortest path from sources[i] to v (or INF if v is unreachable), running
+  multi_source_bfs() on batches of 256 sources.
+- hop_statistics(in, sources, sum, reached) sets sum[v] to the total distance
+  to node v from all sources which can reach it, and reached[v] to the number
+  of such sources, without storing any per-source distances. For an undirected
+  graph, sum[v]/reached[v] over a random sample of sources estimates the mean
+  distance from v to every other node (as for closeness centrality).
+
 Time Complexity:
-- O(n) per call to bfs(), where n is the number of nodes.
+- O(max(n, m)) per call to bfs() and parallel_bfs(), where n is the number of
+  nodes and m is the number of edges. parallel_bfs() usually examines only a
+  fraction of the edges if the graph has a small diameter.
+- O(d*(n + m)*K) per call to multi_source_bfs(), where d is the largest
+  distance reached from any source.
+- O(d*(n + m)*s/64) per call to hop_matrix() and hop_statistics(), where s is
+  the number of sources. hop_matrix() also takes O(n*s) to fill the matrix.
 
 Space Complexity:
 - O(max(n, m)) for storage of the graph, where n is the number of nodes and m
   is the number of edges.
-- O(n) auxiliary heap space for bfs().
+- O(n) auxiliary heap space for bfs() and parallel_bfs(), where parallel_bfs()
+  uses three bitmaps of n bits each beyond the queue of the frontier.
+- O(n*K) auxiliary heap space for multi_source_bfs() and O(n) for
+  hop_statistics(), beyond the O(n*s) for the output of hop_matrix().
 
 */
 
+#include <algorithm>
+#include <limits>
 #include <queue>
+#include <stdexcept>
 #include <utility>
 #include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 const int MAXN = 100, INF = 0x3f3f3f3f;
 std::vector<int> adj[MAXN];
@@ -32,18 +85,21 @@ void bfs(int nodes, int start) {
     dist[i] = INF;
     pred[i] = -1;
   }
+  // Nodes are marked as they are queued, so that each is assigned only once.
   std::queue<std::pair<int, int> > q;
   q.push(std::make_pair(start, 0));
+  visit[start] = true;
+  dist[start] = 0;
   while (!q.empty()) {
     int u = q.front().first;
     int d = q.front().second;
     q.pop();
-    visit[u] = true;
     for (int j = 0; j < (int)adj[u].size(); j++) {
       int v = adj[u][j];
       if (visit[v]) {
         continue;
       }
+      visit[v] = true;
       dist[v] = d + 1;
       pred[v] = u;
       q.push(std::make_pair(v, d + 1));
@@ -51,16 +107,593 @@ void bfs(int nodes, int start) {
   }
 }
 
+typedef unsigned int edge_index_t;
+
+template<class W = int>
+class csr_graph {
+  int num_nodes;
+  std::vector<edge_index_t> offsets;
+  std::vector<int> targets;
+  std::vector<W> weights;
+
+  void build(const std::vector<std::pair<int, int> > &edges, const W *w,
+             bool symmetric) {
+    int n = num_nodes;
+    long long total = (long long)edges.size()*(symmetric ? 2 : 1);
+    if (total > (long long)std::numeric_limits<edge_index_t>::max()) {
+      throw std::runtime_error("Too many edges for 32-bit offsets.");
+    }
+    edge_index_t m = total, half = edges.size();
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = std::max(1, std::min(omp_get_max_threads(),
+                                       (int)(m/65536) + 1));
+#endif
+    // count[t*n + u] is the number of edges from u in chunk t, which is then
+    // replaced by the first slot of those edges within the list of u.
+    std::vector<edge_index_t> count((size_t)num_threads*n, 0);
+    offsets.assign(n + 1, 0);
+    targets.resize(m);
+    if (w != NULL) {
+      weights.resize(m);
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        c[(e < half) ? edges[e].first : edges[e - half].second]++;
+      }
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(num_threads)
+#endif
+    for (int u = 0; u < n; u++) {
+      edge_index_t sum = 0;
+      for (int t = 0; t < num_threads; t++) {
+        edge_index_t c = count[(size_t)t*n + u];
+        count[(size_t)t*n + u] = sum;
+        sum += c;
+      }
+      offsets[u + 1] = sum;
+    }
+    for (int u = 0; u < n; u++) {
+      offsets[u + 1] += offsets[u];
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        int u = edges[(e < half) ? e : e - half].first;
+        int v = edges[(e < half) ? e : e - half].second;
+        if (e >= half) {
+          std::swap(u, v);
+        }
+        edge_index_t slot = offsets[u] + c[u]++;
+        targets[slot] = v;
+        if (w != NULL) {
+          weights[slot] = w[(e < half) ? e : e - half];
+        }
+      }
+    }
+  }
+
+ public:
+  typedef W weight_type;
+
+  csr_graph() : num_nodes(0), offsets(1, 0) {}
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            bool symmetric = false) : num_nodes(nodes) {
+    build(edges, NULL, symmetric);
+  }
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            const std::vector<W> &weights, bool symmetric = false)
+      : num_nodes(nodes) {
+    if (weights.size() != edges.size()) {
+      throw std::runtime_error("Expected one weight per edge.");
+    }
+    build(edges, weights.empty() ? NULL : &weights[0], symmetric);
+  }
+
+  int nodes() const {
+    return num_nodes;
+  }
+
+  edge_index_t edges() const {
+    return offsets[num_nodes];
+  }
+
+  edge_index_t offset(int u) const {
+    return offsets[u];
+  }
+
+  int degree(int u) const {
+    return offsets[u + 1] - offsets[u];
+  }
+
+  int target(edge_index_t e) const {
+    return targets[e];
+  }
+
+  W weight(edge_index_t e) const {
+    return weights.empty() ? W(1) : weights[e];
+  }
+
+  bool is_weighted() const {
+    return !weights.empty();
+  }
+};
+
+template<class Graph>
+void bfs(const Graph &g, int start, std::vector<int> &dist,
+         std::vector<int> &pred) {
+  dist.assign(g.nodes(), INF);
+  pred.assign(g.nodes(), -1);
+  std::vector<int> q(1, start);
+  dist[start] = 0;
+  for (int i = 0; i < (int)q.size(); i++) {
+    int u = q[i];
+    for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+      int v = g.target(e);
+      if (dist[v] == INF) {
+        dist[v] = dist[u] + 1;
+        pred[v] = u;
+        q.push_back(v);
+      }
+    }
+  }
+}
+
+typedef unsigned long long word_t;
+
+inline bool test_bit(const std::vector<word_t> &bits, int i) {
+  return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+// Returns whether bit i was clear and has now been set by the calling thread.
+inline bool claim_bit(std::vector<word_t> &bits, int i) {
+  word_t mask = 1ULL << (i & 63);
+  return (__atomic_fetch_or(&bits[i >> 6], mask, __ATOMIC_RELAXED) & mask) == 0;
+}
+
+template<class Graph>
+void parallel_bfs(const Graph &out, const Graph &in, int start,
+                  std::vector<int> &dist, std::vector<int> &pred,
+                  int alpha = 14, int beta = 24) {
+  int n = out.nodes(), words = (n + 63)/64;
+  dist.assign(n, INF);
+  pred.assign(n, -1);
+  std::vector<word_t> visited(words, 0), front(words, 0), next(words, 0);
+  std::vector<int> queue(1, start);
+  visited[start >> 6] |= 1ULL << (start & 63);
+  dist[start] = 0;
+  // The edges out of the frontier, and out of all unvisited nodes.
+  long long frontier_edges = out.degree(start);
+  long long unexplored_edges = (long long)out.edges() - frontier_edges;
+  long long frontier_size = 1;
+  bool bottom_up = false;
+  for (int level = 0; frontier_size > 0; level++) {
+    if (!bottom_up && frontier_edges > unexplored_edges/alpha) {
+      std::fill(front.begin(), front.end(), 0);
+      for (int i = 0; i < (int)queue.size(); i++) {
+        front[queue[i] >> 6] |= 1ULL << (queue[i] & 63);
+      }
+      bottom_up = true;
+    } else if (bottom_up && frontier_size < n/beta) {
+      queue.clear();
+      for (int w = 0; w < words; w++) {
+        for (word_t b = front[w]; b != 0; b &= b - 1) {
+          queue.push_back(w*64 + __builtin_ctzll(b));
+        }
+      }
+      bottom_up = false;
+    }
+    long long size = 0, edges = 0;
+    if (bottom_up) {
+#ifdef _OPENMP
+      #pragma omp parallel for schedule(dynamic, 256) reduction(+:size, edges)
+#endif
+      for (int w = 0; w < words; w++) {
+        word_t found = 0, unvisited = ~visited[w];
+        if (w == words - 1 && n % 64 != 0) {
+          unvisited &= (1ULL << (n % 64)) - 1;
+        }
+        for (; unvisited != 0; unvisited &= unvisited - 1) {
+          int b = __builtin_ctzll(unvisited), v = w*64 + b;
+          for (edge_index_t e = in.offset(v); e < in.offset(v + 1); e++) {
+            int u = in.target(e);
+            if (test_bit(front, u)) {
+              dist[v] = level + 1;
+              pred[v] = u;
+              found |= 1ULL << b;
+              size++;
+              edges += out.degree(v);
+              break;
+            }
+          }
+        }
+        // Only this iteration writes to word w, so no atomics are needed.
+        next[w] = found;
+        visited[w] |= found;
+      }
+      front.swap(next);
+    } else {
+      std::vector<int> next_queue;
+#ifdef _OPENMP
+      #pragma omp parallel reduction(+:edges)
+#endif
+      {
+        std::vector<int> local;
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic, 64) nowait
+#endif
+        for (int i = 0; i < (int)queue.size(); i++) {
+          int u = queue[i];
+          for (edge_index_t e = out.offset(u); e < out.offset(u + 1); e++) {
+            int v = out.target(e);
+            if (!test_bit(visited, v) && claim_bit(visited, v)) {
+              dist[v] = level + 1;
+              pred[v] = u;
+              local.push_back(v);
+              edges += out.degree(v);
+            }
+          }
+        }
+#ifdef _OPENMP
+        #pragma omp critical(parallel_bfs_merge)
+#endif
+        next_queue.insert(next_queue.end(), local.begin(), local.end());
+      }
+      queue.swap(next_queue);
+      size = queue.size();
+    }
+    frontier_size = size;
+    frontier_edges = edges;
+    unexplored_edges -= edges;
+  }
+}
+
+// A set of up to 64*K sources of a multi-source search, one bit per source.
+template<int K>
+struct source_set {
+  word_t word[K];
+
+  void clear() {
+    for (int i = 0; i < K; i++) {
+      word[i] = 0;
+    }
+  }
+
+  bool empty() const {
+    for (int i = 0; i < K; i++) {
+      if (word[i] != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  int count() const {
+    int res = 0;
+    for (int i = 0; i < K; i++) {
+      res += __builtin_popcountll(word[i]);
+    }
+    return res;
+  }
+
+  void set(int i) {
+    word[i >> 6] |= 1ULL << (i & 63);
+  }
+};
+
+template<int K, class Graph, class Visitor>
+void multi_source_bfs(const Graph &in, const std::vector<int> &sources,
+                      Visitor &visit) {
+  if ((int)sources.size() > 64*K) {
+    throw std::runtime_error("Too many sources for one multi-source BFS.");
+  }
+  int n = in.nodes();
+  source_set<K> all;
+  all.clear();
+  std::vector<source_set<K> > seen(n, all), front(n, all), next(n, all);
+  for (int i = 0; i < (int)sources.size(); i++) {
+    all.set(i);
+    seen[sources[i]].set(i);
+    front[sources[i]].set(i);
+  }
+  for (int v = 0; v < n; v++) {
+    if (!front[v].empty()) {
+      visit(v, 0, front[v]);
+    }
+  }
+  for (int level = 1, found = 1; found > 0; level++) {
+    found = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 256) reduction(+:found)
+#endif
+    for (int v = 0; v < n; v++) {
+      source_set<K> &s = next[v];
+      s.clear();
+      bool done = true;
+      for (int i = 0; i < K; i++) {
+        done &= (seen[v].word[i] == all.word[i]);
+      }
+      if (done) {
+        continue;
+      }
+      for (edge_index_t e = in.offset(v); e < in.offset(v + 1); e++) {
+        const source_set<K> &f = front[in.target(e)];
+        for (int i = 0; i < K; i++) {
+          s.word[i] |= f.word[i];
+        }
+      }
+      for (int i = 0; i < K; i++) {
+        s.word[i] &= ~seen[v].word[i];
+        seen[v].word[i] |= s.word[i];
+      }
+      if (!s.empty()) {
+        visit(v, level, s);
+        found++;
+      }
+    }
+    front.swap(next);
+  }
+}
+
+template<int K>
+struct hop_matrix_visitor {
+  std::vector<std::vector<int> > *dist;
+  int offset;
+
+  void operator()(int v, int level, const source_set<K> &s) {
+    for (int i = 0; i < K; i++) {
+      for (word_t b = s.word[i]; b != 0; b &= b - 1) {
+        (*dist)[offset + i*64 + __builtin_ctzll(b)][v] = level;
+      }
+    }
+  }
+};
+
+template<class Graph>
+void hop_matrix(const Graph &in, const std::vector<int> &sources,
+                std::vector<std::vector<int> > &dist) {
+  dist.assign(sources.size(), std::vector<int>(in.nodes(), INF));
+  hop_matrix_visitor<4> visit;
+  visit.dist = &dist;
+  for (int lo = 0; lo < (int)sources.size(); lo += 256) {
+    int hi = std::min((int)sources.size(), lo + 256);
+    visit.offset = lo;
+    multi_source_bfs<4>(in, std::vector<int>(sources.begin() + lo,
+                                             sources.begin() + hi), visit);
+  }
+}
+
+template<int K>
+struct hop_statistics_visitor {
+  long long *sum;
+  int *reached;
+
+  void operator()(int v, int level, const source_set<K> &s) {
+    int c = s.count();
+    sum[v] += (long long)level*c;
+    reached[v] += c;
+  }
+};
+
+template<class Graph>
+void hop_statistics(const Graph &in, const std::vector<int> &sources,
+                    std::vector<long long> &sum, std::vector<int> &reached) {
+  sum.assign(in.nodes(), 0);
+  reached.assign(in.nodes(), 0);
+  hop_statistics_visitor<4> visit;
+  visit.sum = sum.empty() ? 0 : &sum[0];
+  visit.reached = reached.empty() ? 0 : &reached[0];
+  for (int lo = 0; lo < (int)sources.size(); lo += 256) {
+    int hi = std::min((int)sources.size(), lo + 256);
+    multi_source_bfs<4>(in, std::vector<int>(sources.begin() + lo,
+                                             sources.begin() + hi), visit);
+  }
+}
+
 /*** Example Usage and Output:
 
-The shortest distance from 0 to 3 is 2.
-Take the path: 0->1->3.
+The shortest distance from 0 to 3 is 1.
+Take the path: 0->3.
+5 searches over 8388608 edges: bfs 1.29247s, parallel_bfs 0.31694s
+256 sources over 2097152 edges: bfs 7.55108s,
+  multi_source_bfs<1> 0.385956s, multi_source_bfs<4> 0.406714s
 
 ***/
 
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
 using namespace std;
 
+double wall_time() {
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+int rand30() {
+  return (rand() & 0x7fff) << 15 | (rand() & 0x7fff);
+}
+
+vector<pair<int, int> > reversed(const vector<pair<int, int> > &edges) {
+  vector<pair<int, int> > res(edges.size());
+  for (int i = 0; i < (int)edges.size(); i++) {
+    res[i] = make_pair(edges[i].second, edges[i].first);
+  }
+  return res;
+}
+
+// Checks that dist matches expected and that every predecessor is a parent
+// on some shortest path in g.
+void check_tree(const csr_graph<> &g, int start, const vector<int> &expected,
+                const vector<int> &dist, const vector<int> &pred) {
+  assert(dist == expected && pred[start] == -1);
+  for (int v = 0; v < g.nodes(); v++) {
+    if (v == start || dist[v] == INF) {
+      assert(v == start || pred[v] == -1);
+      continue;
+    }
+    int u = pred[v];
+    assert(dist[u] + 1 == dist[v]);
+    bool found = false;
+    for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+      found |= (g.target(e) == v);
+    }
+    assert(found);
+  }
+}
+
+void test_parallel_bfs(int n, int m, bool symmetric) {
+  vector<pair<int, int> > edges(m);
+  for (int i = 0; i < m; i++) {
+    edges[i] = make_pair(rand() % n, rand() % n);
+  }
+  csr_graph<> g(n, edges, symmetric);
+  csr_graph<> gt(n, symmetric ? edges : reversed(edges), symmetric);
+  int start = rand() % n;
+  vector<int> expected, dist, pred;
+  bfs(g, start, expected, pred);
+  // Forces top-down only, bottom-up only, and switching at the defaults.
+  int alphas[3] = {1 << 30, 1, 14}, betas[3] = {24, 1 << 30, 24};
+  for (int i = 0; i < 3; i++) {
+    parallel_bfs(g, gt, start, dist, pred, alphas[i], betas[i]);
+    check_tree(g, start, expected, dist, pred);
+  }
+}
+
+void benchmark(int n, int m) {
+  vector<pair<int, int> > edges(m);
+  for (int i = 0; i < m; i++) {
+    edges[i] = make_pair(rand30() % n, rand30() % n);
+  }
+  csr_graph<> g(n, edges, true);
+  vector<int> dist1, dist2, pred;
+  double start = wall_time();
+  for (int i = 0; i < 5; i++) {
+    bfs(g, i, dist1, pred);
+  }
+  double serial_time = wall_time() - start;
+  start = wall_time();
+  for (int i = 0; i < 5; i++) {
+    parallel_bfs(g, g, i, dist2, pred);
+  }
+  double parallel_time = wall_time() - start;
+  assert(dist1 == dist2);
+  cout << "5 searches over " << g.edges() << " edges: bfs " << serial_time
+       << "s, parallel_bfs " << parallel_time << "s" << endl;
+}
+
+void test_multi_source_bfs(int n, int m, int num_sources, bool symmetric) {
+  vector<pair<int, int> > edges(m);
+  for (int i = 0; i < m; i++) {
+    edges[i] = make_pair(rand() % n, rand() % n);
+  }
+  csr_graph<> g(n, edges, symmetric);
+  csr_graph<> gt(n, symmetric ? edges : reversed(edges), symmetric);
+  vector<int> sources(num_sources);
+  for (int i = 0; i < num_sources; i++) {
+    sources[i] = rand() % n;  // Duplicates are allowed.
+  }
+  vector<vector<int> > matrix;
+  hop_matrix(gt, sources, matrix);
+  vector<long long> sum, expected_sum(n, 0);
+  vector<int> reached, expected_reached(n, 0), dist, pred;
+  hop_statistics(gt, sources, sum, reached);
+  for (int i = 0; i < num_sources; i++) {
+    bfs(g, sources[i], dist, pred);
+    assert(matrix[i] == dist);
+    for (int v = 0; v < n; v++) {
+      if (dist[v] != INF) {
+        expected_sum[v] += dist[v];
+        expected_reached[v]++;
+      }
+    }
+  }
+  assert(sum == expected_sum && reached == expected_reached);
+  if (num_sources <= 64) {
+    hop_matrix_visitor<1> visit;
+    visit.dist = &matrix;
+    visit.offset = 0;
+    matrix.assign(num_sources, vector<int>(n, INF));
+    multi_source_bfs<1>(gt, sources, visit);
+    for (int i = 0; i < num_sources; i++) {
+      bfs(g, sources[i], dist, pred);
+      assert(matrix[i] == dist);
+    }
+  }
+}
+
+template<int K>
+double time_multi_source_bfs(const csr_graph<> &g,
+                             const vector<int> &sources,
+                             vector<long long> &sum) {
+  vector<int> reached(g.nodes(), 0);
+  sum.assign(g.nodes(), 0);
+  hop_statistics_visitor<K> visit;
+  visit.sum = &sum[0];
+  visit.reached = &reached[0];
+  double start = wall_time();
+  for (int lo = 0; lo < (int)sources.size(); lo += 64*K) {
+    int hi = min(lo + 64*K, (int)sources.size());
+    multi_source_bfs<K>(g, vector<int>(sources.begin() + lo,
+                                       sources.begin() + hi), visit);
+  }
+  return wall_time() - start;
+}
+
+void benchmark_multi_source(int n, int m, int num_sources) {
+  vector<pair<int, int> > edges(m);
+  for (int i = 0; i < m; i++) {
+    edges[i] = make_pair(rand30() % n, rand30() % n);
+  }
+  csr_graph<> g(n, edges, true);
+  vector<int> sources(num_sources), dist, pred;
+  for (int i = 0; i < num_sources; i++) {
+    sources[i] = rand30() % n;
+  }
+  vector<long long> expected(n, 0), sum;
+  double start = wall_time();
+  for (int i = 0; i < num_sources; i++) {
+    bfs(g, sources[i], dist, pred);
+    for (int v = 0; v < n; v++) {
+      expected[v] += (dist[v] == INF) ? 0 : dist[v];
+    }
+  }
+  double serial_time = wall_time() - start;
+  double time64 = time_multi_source_bfs<1>(g, sources, sum);
+  assert(sum == expected);
+  double time256 = time_multi_source_bfs<4>(g, sources, sum);
+  assert(sum == expected);
+  cout << num_sources << " sources over " << g.edges() << " edges: bfs "
+       << serial_time << "s," << endl << "  multi_source_bfs<1> " << time64
+       << "s, multi_source_bfs<4> " << time256 << "s" << endl;
+}
+
 void print_path(int dest) {
   vector<int> path;
   for (int j = dest; pred[j] != -1; j = pred[j]) {
@@ -86,5 +719,17 @@ int main() {
   cout << "The shortest distance from " << start << " to " << dest << " is "
        << dist[dest] << "." << endl;
   print_path(dest);
+  assert(dist[3] == 1 && dist[2] == 2 && dist[0] == 0 && pred[2] == 1);
+
+  for (int iter = 0; iter < 300; iter++) {
+    int n = 1 + rand() % 200;
+    test_parallel_bfs(n, rand() % (4*n), iter % 2 == 0);
+  }
+  for (int iter = 0; iter < 100; iter++) {
+    int n = 1 + rand() % 200;
+    test_multi_source_bfs(n, rand() % (3*n), 1 + rand() % 300, iter % 2 == 0);
+  }
+  benchmark(1 << 20, 1 << 22);
+  benchmark_multi_source(1 << 18, 1 << 20, 256);
   return 0;
 }
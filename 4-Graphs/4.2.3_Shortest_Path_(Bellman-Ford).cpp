@@ -10,24 +10,50 @@ numbered with integers between 0 (inclusive) and the total number of nodes
 
 This function will also detect whether the graph contains negative-weighted
 cycles, in which case there is no shortest path and an error will be thrown.
+The edges are relaxed in rounds, stopping early once a round changes nothing,
+which takes only as many rounds as the largest number of edges on a shortest
+path (plus one). A change in the n-th round implies a negative-weight cycle
+reachable from the start.
+
+- spfa(nodes, start) computes the same result with the Shortest Path Faster
+  Algorithm, which only relaxes the edges out of nodes whose distance changed,
+  kept in a queue. Two heuristics reorder the queue, which is a deque: "small
+  label first" (SLF) pushes a node to the front rather than the back if its
+  distance is smaller than that of the current front, and "large label last"
+  (LLL) moves the front to the back while its distance exceeds the average of
+  the queue. A negative-weight cycle is detected once the path to some node (as
+  counted by the number of edges since the start) reaches n edges.
+- parallel_bellman_ford(nodes, start) computes the same result as
+  bellman_ford() with the edges of each round relaxed in parallel if compiled
+  with -fopenmp. Each distance is packed with its predecessor into a 64-bit word
+  (distance first), so that both are lowered together by an atomic
+  compare-and-swap, keeping the predecessor consistent with the distance.
 
 Time Complexity:
-- O(n*m) per call to bellman_ford(), where n is the number of nodes and m is the
-  number of edges.
+- O(n*m) per call to bellman_ford() and parallel_bellman_ford(), where n is the
+  number of nodes and m is the number of edges, but O(k*m) if every shortest
+  path has fewer than k edges. parallel_bellman_ford() splits the m relaxations
+  of each round among threads.
+- O(n*m) per call to spfa(), though it often takes O(m) on random graphs.
 
 Space Complexity:
 - O(max(n, m)) for storage of the graph, where n is the number of nodes and m is
   the number of edges.
-- O(n) auxiliary heap space for bellman_ford(), where n is the number of nodes.
+- O(n) auxiliary heap space for bellman_ford() and parallel_bellman_ford(), and
+  O(n + m) for spfa().
 
 */
 
+#include <deque>
 #include <stdexcept>
 #include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 struct edge { int u, v, w; };  // Edge from u to v with weight w.
 
-const int MAXN = 100, INF = 0x3f3f3f3f;
+const int MAXN = 100000, INF = 0x3f3f3f3f;
 std::vector<edge> e;
 int dist[MAXN], pred[MAXN];
 
@@ -37,32 +63,243 @@ void bellman_ford(int nodes, int start) {
     pred[i] = -1;
   }
   dist[start] = 0;
-  for (int i = 0; i < nodes; i++) {
+  bool changed = true;
+  for (int i = 0; i < nodes && changed; i++) {
+    changed = false;
     for (int j = 0; j < (int)e.size(); j++) {
-      if (dist[e[j].v] > dist[e[j].u] + e[j].w) {
+      if (dist[e[j].u] < INF && dist[e[j].v] > dist[e[j].u] + e[j].w) {
         dist[e[j].v] = dist[e[j].u] + e[j].w;
         pred[e[j].v] = e[j].u;
+        changed = true;
       }
     }
   }
   // Optional: Report negative-weighted cycles.
+  if (changed) {
+    throw std::runtime_error("Negative-weight cycle found.");
+  }
+}
+
+void spfa(int nodes, int start) {
+  // Bucket the edges by their source into adjacency lists.
+  std::vector<int> offset(nodes + 1, 0), order(e.size());
   for (int i = 0; i < (int)e.size(); i++) {
-    if (dist[e[i].v] > dist[e[i].u] + e[i].w) {
-      throw std::runtime_error("Negative-weight cycle found.");
+    offset[e[i].u + 1]++;
+  }
+  for (int i = 0; i < nodes; i++) {
+    offset[i + 1] += offset[i];
+  }
+  std::vector<int> slot(offset.begin(), offset.end() - 1);
+  for (int i = 0; i < (int)e.size(); i++) {
+    order[slot[e[i].u]++] = i;
+  }
+  for (int i = 0; i < nodes; i++) {
+    dist[i] = INF;
+    pred[i] = -1;
+  }
+  std::vector<int> edges_to(nodes, 0);
+  std::vector<bool> queued(nodes, false);
+  std::deque<int> q(1, start);
+  dist[start] = 0;
+  queued[start] = true;
+  long long sum = 0;  // The sum of distances in the queue, for LLL.
+  while (!q.empty()) {
+    while (dist[q.front()]*(long long)q.size() > sum) {
+      q.push_back(q.front());
+      q.pop_front();
+    }
+    int u = q.front();
+    q.pop_front();
+    queued[u] = false;
+    sum -= dist[u];
+    for (int j = offset[u]; j < offset[u + 1]; j++) {
+      const edge &ed = e[order[j]];
+      if (dist[ed.v] > dist[u] + ed.w) {
+        int v = ed.v;
+        if (queued[v]) {
+          sum -= dist[v];
+        }
+        dist[v] = dist[u] + ed.w;
+        pred[v] = u;
+        edges_to[v] = edges_to[u] + 1;
+        if (edges_to[v] >= nodes) {
+          throw std::runtime_error("Negative-weight cycle found.");
+        }
+        if (queued[v]) {
+          sum += dist[v];
+          continue;
+        }
+        queued[v] = true;
+        sum += dist[v];
+        if (!q.empty() && dist[v] < dist[q.front()]) {
+          q.push_front(v);
+        } else {
+          q.push_back(v);
+        }
+      }
     }
   }
 }
 
+// Packs distance d above predecessor p, with d biased to be unsigned so that
+// the upper halves of packed words compare in the same order as distances.
+inline unsigned long long pack(int d, int p) {
+  return (unsigned long long)(d + 0x80000000u) << 32 | (unsigned int)p;
+}
+
+void parallel_bellman_ford(int nodes, int start) {
+  std::vector<unsigned long long> label(nodes, pack(INF, -1));
+  label[start] = pack(0, -1);
+  int m = e.size();
+  bool changed = true;
+  for (int i = 0; i < nodes && changed; i++) {
+    int num_changed = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static, 4096) reduction(+:num_changed)
+#endif
+    for (int j = 0; j < m; j++) {
+      const edge &ed = e[j];
+      unsigned long long lu = __atomic_load_n(&label[ed.u], __ATOMIC_RELAXED);
+      int du = (int)((lu >> 32) - 0x80000000u);
+      if (du >= INF) {
+        continue;
+      }
+      unsigned long long x = pack(du + ed.w, ed.u);
+      unsigned long long cur = __atomic_load_n(&label[ed.v], __ATOMIC_RELAXED);
+      // Only a strictly shorter distance counts as a change, so that rounds
+      // still end once distances stop changing.
+      while ((x >> 32) < (cur >> 32)) {
+        if (__atomic_compare_exchange_n(&label[ed.v], &cur, x, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+          num_changed++;
+          break;
+        }
+      }
+    }
+    changed = num_changed > 0;
+  }
+  for (int i = 0; i < nodes; i++) {
+    dist[i] = (int)((label[i] >> 32) - 0x80000000u);
+    pred[i] = (int)(unsigned int)label[i];
+  }
+  if (changed) {
+    throw std::runtime_error("Negative-weight cycle found.");
+  }
+}
+
 /*** Example Usage and Output:
 
 The shortest distance from 0 to 2 is 3.
 Take the path: 0->1->2.
+Dense graph (1000 nodes, 1000000 edges): bellman_ford 0.0148399s,
+  spfa 0.0418931s, parallel_bellman_ford 0.0264243s
+Sparse graph (65536 nodes, 524288 edges): bellman_ford 0.0192038s,
+  spfa 0.0272248s, parallel_bellman_ford 0.0229078s
 
 ***/
 
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
 using namespace std;
 
+double wall_time() {
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+// Checks dist[] and pred[] computed for a graph with no negative cycles
+// against expected distances.
+void check(int n, int start, const vector<int> &expected) {
+  for (int v = 0; v < n; v++) {
+    assert(dist[v] == expected[v]);
+    if (v == start || dist[v] == INF) {
+      assert(pred[v] == -1);
+      continue;
+    }
+    bool found = false;
+    for (int i = 0; i < (int)e.size(); i++) {
+      found |= (e[i].u == pred[v] && e[i].v == v &&
+                dist[pred[v]] + e[i].w == dist[v]);
+    }
+    assert(found);
+  }
+}
+
+void add_edge(int u, int v, int w) {
+  edge ed = {u, v, w};
+  e.push_back(ed);
+}
+
+// Generates m edges on n nodes whose weights, adjusted by node potentials,
+// are nonnegative, so that there are negative edges but no negative cycles.
+void random_graph(int n, int m, int max_weight) {
+  vector<int> potential(n);
+  for (int i = 0; i < n; i++) {
+    potential[i] = rand() % (max_weight + 1);
+  }
+  e.clear();
+  for (int i = 0; i < m; i++) {
+    int u = rand() % n, v = rand() % n;
+    add_edge(u, v, rand() % (max_weight + 1) + potential[u] - potential[v]);
+  }
+}
+
+template<class F>
+bool throws(F f, int n, int start) {
+  try {
+    f(n, start);
+  } catch (std::runtime_error &) {
+    return true;
+  }
+  return false;
+}
+
+void test_random(int n, int m) {
+  random_graph(n, m, 20);
+  int start = rand() % n;
+  bellman_ford(n, start);
+  vector<int> expected(dist, dist + n);
+  check(n, start, expected);
+  spfa(n, start);
+  check(n, start, expected);
+  parallel_bellman_ford(n, start);
+  check(n, start, expected);
+  // A negative cycle reachable from the start is always found.
+  int u = rand() % n, v = rand() % n;
+  add_edge(start, u, 0);
+  add_edge(u, v, -1);
+  add_edge(v, u, -1);
+  add_edge(u, u, -1);
+  assert(throws(bellman_ford, n, start));
+  assert(throws(spfa, n, start));
+  assert(throws(parallel_bellman_ford, n, start));
+}
+
+template<class F>
+double time_search(F f, int n) {
+  double start = wall_time();
+  f(n, 0);
+  return wall_time() - start;
+}
+
+void benchmark(const char *name, int n, int m) {
+  random_graph(n, m, 1000);
+  double t1 = time_search(bellman_ford, n);
+  vector<int> expected(dist, dist + n);
+  double t2 = time_search(spfa, n);
+  assert(vector<int>(dist, dist + n) == expected);
+  double t3 = time_search(parallel_bellman_ford, n);
+  assert(vector<int>(dist, dist + n) == expected);
+  cout << name << " (" << n << " nodes, " << m << " edges): bellman_ford "
+       << t1 << "s," << endl << "  spfa " << t2 << "s, parallel_bellman_ford "
+       << t3 << "s" << endl;
+}
+
 void print_path(int dest) {
   vector<int> path;
   for (int j = dest; pred[j] != -1; j = pred[j]) {
@@ -78,12 +315,25 @@ void print_path(int dest) {
 
 int main() {
   int start = 0, dest = 2;
-  e.push_back((edge){0, 1, 1});
-  e.push_back((edge){1, 2, 2});
-  e.push_back((edge){0, 2, 5});
+  add_edge(0, 1, 1);
+  add_edge(1, 2, 2);
+  add_edge(0, 2, 5);
   bellman_ford(3, start);
   cout << "The shortest distance from " << start << " to " << dest << " is "
        << dist[dest] << "." << endl;
   print_path(dest);
+  assert(dist[2] == 3 && pred[2] == 1);
+  spfa(3, start);
+  assert(dist[2] == 3 && pred[2] == 1);
+  parallel_bellman_ford(3, start);
+  assert(dist[2] == 3 && pred[2] == 1);
+
+  for (int iter = 0; iter < 300; iter++) {
+    int n = 1 + rand() % 100;
+    test_random(n, rand() % (5*n));
+  }
+  // A complete graph, like the exchange rates between currencies.
+  benchmark("Dense graph", 1000, 1000*1000);
+  benchmark("Sparse graph", 1 << 16, 1 << 19);
   return 0;
 }
@@ -11,20 +11,45 @@ valid nodes u and v.
 
 This function will also detect whether the graph contains negative-weighted
 cycles, in which case there is no shortest path and an error will be thrown.
+Sums involving an INF distance are never taken as paths, so unreachable pairs
+stay at exactly INF even if there are negative weights.
+
+- blocked_floyd_warshall(n, d, parent, block_size) computes the same distances
+  in place for an n by n matrix d stored in row-major order (with INF for
+  missing edges), along with the parent matrix in the same form if it is not
+  NULL. The matrix is tiled into blocks of block_size by block_size entries, so
+  that each step reads and writes three blocks which fit in cache rather than
+  streaming the whole matrix once per k. For each block of k values, the
+  diagonal block is first solved by itself, then the blocks in its row and
+  column are updated from it, and finally every remaining block (i, j) is
+  updated from blocks (i, k) and (k, j). The blocks of the second and of the
+  third phase are independent of each other and are processed in parallel if
+  compiled with -fopenmp. The innermost min-plus update over j uses SSE2, 4
+  entries at a time, if available.
 
 Time Complexity:
 - O(n^2) per call to initialize(), where n is the number of nodes.
-- O(n^3) per call to floyd_warshall().
+- O(n^3) per call to floyd_warshall() and blocked_floyd_warshall(), the latter
+  with O(n^3/B) cache misses for a block size of B instead of O(n^3).
 
 Space Complexity:
 - O(n^2) for storage of the graph, where n is the number of nodes.
 - O(n^2) auxiliary heap space for initialize() and floyd_warshall().
+- O(1) auxiliary space for blocked_floyd_warshall().
 
 */
 
+#include <algorithm>
+#include <cstddef>
 #include <stdexcept>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-const int MAXN = 100, INF = 0x3f3f3f3f;
+const int MAXN = 1024, INF = 0x3f3f3f3f;
 int dist[MAXN][MAXN], parent[MAXN][MAXN];
 
 void initialize(int nodes) {
@@ -40,7 +65,8 @@ void floyd_warshall(int nodes) {
   for (int k = 0; k < nodes; k++) {
     for (int i = 0; i < nodes; i++) {
       for (int j = 0; j < nodes; j++) {
-        if (dist[i][j] > dist[i][k] + dist[k][j]) {
+        if (dist[i][k] < INF && dist[k][j] < INF &&
+            dist[i][j] > dist[i][k] + dist[k][j]) {
           dist[i][j] = dist[i][k] + dist[k][j];
           parent[i][j] = parent[i][k];
         }
@@ -55,18 +81,129 @@ void floyd_warshall(int nodes) {
   }
 }
 
+// Relaxes d[i][j] through every k in [k0, k1), for all i in [i0, i1) and j in
+// [j0, j1). For each k, the row d[k] is only read at columns which the update
+// of row k itself leaves unchanged, so any of the ranges may overlap.
+void relax_block(int n, int *d, int *parent, int i0, int i1, int j0, int j1,
+                 int k0, int k1) {
+  for (int k = k0; k < k1; k++) {
+    const int *dk = d + (size_t)k*n;
+    for (int i = i0; i < i1; i++) {
+      int *di = d + (size_t)i*n, a = di[k];
+      if (a >= INF) {
+        continue;
+      }
+      int *pi = (parent == NULL) ? NULL : parent + (size_t)i*n;
+      int pk = (parent == NULL) ? 0 : pi[k];
+      int j = j0;
+#ifdef __SSE2__
+      __m128i va = _mm_set1_epi32(a), vinf = _mm_set1_epi32(INF);
+      __m128i vp = _mm_set1_epi32(pk);
+      for (; j + 4 <= j1; j += 4) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(dk + j));
+        __m128i c = _mm_loadu_si128((const __m128i*)(di + j));
+        __m128i sum = _mm_add_epi32(va, b);
+        __m128i less = _mm_and_si128(_mm_cmplt_epi32(sum, c),
+                                     _mm_cmplt_epi32(b, vinf));
+        _mm_storeu_si128((__m128i*)(di + j),
+                         _mm_or_si128(_mm_and_si128(less, sum),
+                                      _mm_andnot_si128(less, c)));
+        if (pi != NULL && _mm_movemask_epi8(less) != 0) {
+          __m128i q = _mm_loadu_si128((const __m128i*)(pi + j));
+          _mm_storeu_si128((__m128i*)(pi + j),
+                           _mm_or_si128(_mm_and_si128(less, vp),
+                                        _mm_andnot_si128(less, q)));
+        }
+      }
+#endif
+      for (; j < j1; j++) {
+        if (dk[j] < INF && a + dk[j] < di[j]) {
+          di[j] = a + dk[j];
+          if (pi != NULL) {
+            pi[j] = pk;
+          }
+        }
+      }
+    }
+  }
+}
+
+void blocked_floyd_warshall(int n, int *d, int *parent = NULL,
+                            int block_size = 64) {
+  int b = block_size, num_blocks = (n + b - 1)/b;
+  for (int kb = 0; kb < num_blocks; kb++) {
+    int k0 = kb*b, k1 = std::min(n, k0 + b);
+    relax_block(n, d, parent, k0, k1, k0, k1, k0, k1);
+    // The blocks in row kb (t < num_blocks) and column kb (t >= num_blocks).
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int t = 0; t < 2*num_blocks; t++) {
+      int x = t % num_blocks, x0 = x*b, x1 = std::min(n, x0 + b);
+      if (x == kb) {
+        continue;
+      }
+      if (t < num_blocks) {
+        relax_block(n, d, parent, k0, k1, x0, x1, k0, k1);
+      } else {
+        relax_block(n, d, parent, x0, x1, k0, k1, k0, k1);
+      }
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int t = 0; t < num_blocks*num_blocks; t++) {
+      int ib = t/num_blocks, jb = t % num_blocks;
+      if (ib == kb || jb == kb) {
+        continue;
+      }
+      int i0 = ib*b, j0 = jb*b;
+      relax_block(n, d, parent, i0, std::min(n, i0 + b), j0,
+                  std::min(n, j0 + b), k0, k1);
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    if (d[(size_t)i*n + i] < 0) {
+      throw std::runtime_error("Negative-weight cycle found.");
+    }
+  }
+}
+
 /*** Example Usage and Output:
 
 The shortest distance from 0 to 2 is 3.
 Take the path: 0->1->2.
+n = 1024: floyd_warshall 1.13915s
+  blocked_floyd_warshall (block size 32) 0.321594s
+  blocked_floyd_warshall (block size 64) 0.278478s
+  blocked_floyd_warshall (block size 128) 0.288447s
 
 ***/
 
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
+#include <vector>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
 using namespace std;
 
+// Returns the wall clock time in seconds. On Windows, clock() measures wall
+// time rather than processor time.
+double wall_time() {
+#ifdef _WIN32
+  return (double)clock()/CLOCKS_PER_SEC;
+#else
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+#endif
+}
+
 void print_path(int u, int v) {
-  cout << "Take the path " << u;
+  cout << "Take the path: " << u;
   while (u != v) {
     u = parent[u][v];
     cout << "->" << u;
@@ -74,6 +211,97 @@ void print_path(int u, int v) {
   cout << "." << endl;
 }
 
+// Fills dist[][] and the flat matrix w with a random graph whose weights are
+// shifted by node potentials, so that they may be negative without any
+// negative cycles.
+void random_graph(int n, int num_edges, bool negative, vector<int> &w) {
+  initialize(n);
+  vector<int> potential(n);
+  for (int i = 0; i < n; i++) {
+    potential[i] = negative ? rand() % 50 : 0;
+  }
+  for (int e = 0; e < num_edges; e++) {
+    int u = rand() % n, v = rand() % n;
+    if (u != v) {
+      int c = rand() % 100 + potential[u] - potential[v];
+      dist[u][v] = std::min(dist[u][v], c);
+    }
+  }
+  w.resize(n*n);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      w[i*n + j] = dist[i][j];
+    }
+  }
+}
+
+void test_blocked(int n, int num_edges, bool negative, int block_size) {
+  vector<int> w, d, p(n*n);
+  random_graph(n, num_edges, negative, w);
+  d = w;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      p[i*n + j] = j;
+    }
+  }
+  floyd_warshall(n);
+  blocked_floyd_warshall(n, &d[0], &p[0], block_size);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      assert(d[i*n + j] == dist[i][j]);
+      if (i == j || d[i*n + j] == INF) {
+        continue;
+      }
+      // The parent pointers must trace out a path of the shortest length.
+      int len = 0, steps = 0;
+      for (int u = i; u != j; steps++) {
+        int v = p[u*n + j];
+        assert(w[u*n + v] < INF && steps < n);
+        len += w[u*n + v];
+        u = v;
+      }
+      assert(len == d[i*n + j]);
+    }
+  }
+}
+
+bool throws_on_negative_cycle(int n, int block_size) {
+  vector<int> d(n*n, INF);
+  for (int i = 0; i < n; i++) {
+    d[i*n + i] = 0;
+    d[i*n + (i + 1) % n] = (i == 0) ? -n : 1;
+  }
+  try {
+    blocked_floyd_warshall(n, &d[0], NULL, block_size);
+  } catch (std::runtime_error &) {
+    return true;
+  }
+  return false;
+}
+
+void benchmark(int n) {
+  vector<int> w, d;
+  random_graph(n, 8*n, false, w);
+  double start = wall_time();
+  floyd_warshall(n);
+  cout << "n = " << n << ": floyd_warshall " << wall_time() - start << "s"
+       << endl;
+  int block_sizes[] = {32, 64, 128};
+  for (int b = 0; b < 3; b++) {
+    d = w;
+    start = wall_time();
+    blocked_floyd_warshall(n, &d[0], NULL, block_sizes[b]);
+    double t = wall_time() - start;
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) {
+        assert(d[i*n + j] == dist[i][j]);
+      }
+    }
+    cout << "  blocked_floyd_warshall (block size " << block_sizes[b] << ") "
+         << t << "s" << endl;
+  }
+}
+
 int main() {
   initialize(3);
   int start = 0, dest = 2;
@@ -84,5 +312,17 @@ int main() {
   cout << "The shortest distance from " << start << " to " << dest << " is "
        << dist[start][dest] << "." << endl;
   print_path(start, dest);
+
+  for (int n = 1; n <= 70; n += (n < 10) ? 1 : 13) {
+    int block_sizes[] = {1, 3, 8, 16, 64};
+    for (int b = 0; b < 5; b++) {
+      test_blocked(n, 2*n, false, block_sizes[b]);
+      test_blocked(n, 4*n, true, block_sizes[b]);
+      test_blocked(n, n*n, true, block_sizes[b]);
+    }
+  }
+  assert(throws_on_negative_cycle(2, 1) && throws_on_negative_cycle(37, 8));
+  assert(throws_on_negative_cycle(100, 64));
+  benchmark(1024);
   return 0;
 }
@@ -0,0 +1,1075 @@
+/*
+
+A contraction hierarchy answers point-to-point shortest path queries on a large,
+static, weighted, directed graph with nonnegative weights (such as a road
+network) in a small fraction of the time of Dijkstra's algorithm, after a
+one-time preprocessing step. Nodes are contracted one by one in order of
+increasing "importance". Contracting a node v removes it from the remaining
+graph, adding a shortcut edge (u, w) through v for every pair of remaining edges
+(u, v) and (v, w) unless a local witness search finds another path from u to w
+that is no longer. The hierarchy holds every original edge and shortcut, each
+directed from the node contracted earlier to the one contracted later. Every
+shortest path then has an equally short path in the hierarchy which only moves
+up to some highest node and then only moves down, which a bidirectional search
+of the upward edges from both ends can find while visiting only a few hundred
+nodes on a road network. The hierarchy builds on the csr_graph of section 4.1.5
+and the indexed heap of section 4.2.2.
+
+- build_hierarchy(g, hierarchy, witness_limit) contracts all nodes of any graph
+  g with the interface of csr_graph (whose weights must be nonnegative), storing
+  the result into hierarchy as a csr_graph with ch_arc weights and 2n nodes.
+  Node v holds the edges from v to nodes contracted after it, and node n + v
+  holds the edges into v from nodes contracted after it, reversed. Each edge is
+  labeled with the node it shortcuts, or -1 if it is an original edge. Nodes are
+  ordered by a priority queue on their edge difference (the number of shortcuts
+  needed minus the number of edges removed) plus their number of contracted
+  neighbors. Priorities are updated lazily, recomputing that of each node as it
+  is popped and requeueing it if it is no longer the smallest. A witness search
+  stops once every target has a witness, or after settling witness_limit nodes,
+  which only adds unnecessary shortcuts but never loses a shortest path.
+- Since the hierarchy is an ordinary csr_graph, it may be written to a file by
+  mapped_csr_graph<ch_arc<W> >::write(path, hierarchy) and reopened as a
+  mapped_csr_graph<ch_arc<W> >, which is then ready for queries in constant
+  time.
+- ch_query(hierarchy) prepares queries on a hierarchy of either type.
+  query(start, target) returns the distance from start to target, or the maximum
+  value of the weight type if there is no path. The forward search from start
+  and the backward search from target alternate as in bidirectional Dijkstra,
+  but each only stops once its own smallest key reaches the best distance
+  found. A node is skipped without relaxing its edges (stall-on-demand) if
+  some higher node already reached by the same search has a shorter path into
+  it. Only the nodes reached by the previous query are reset. path() returns the
+  nodes of a shortest path in the original graph found by the last query (or an
+  empty vector if there was none), recursively unpacking every shortcut (u, w)
+  through m into the edges (u, m) and (m, w) of the hierarchy.
+
+Time Complexity:
+- O(r*d*s log s) per call to build_hierarchy(), where r is the number of times
+  a priority is computed (a small multiple of the number of nodes n), d is the
+  largest number of edges of a node at its contraction, and s is the witness
+  limit. The degrees d grow quickly on graphs without small separators.
+- O(n' log n' + m') per call to query(), where n' and m' are the numbers of
+  nodes and edges explored in the hierarchy, which are typically in the hundreds
+  and thousands respectively for road networks of millions of nodes.
+- O(k*d) per call to path(), where k is the number of edges on the path.
+- O(n) per call to the ch_query constructor.
+
+Space Complexity:
+- O(n + m') for storage of the hierarchy, where m' is the number of original
+  edges plus shortcuts, which is typically less than twice the number of edges
+  on road networks.
+- O(n + m') auxiliary heap space for build_hierarchy(), and O(n) for storage of
+  a ch_query.
+
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define CSR_GRAPH_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+typedef unsigned int edge_index_t;
+
+template<class W = int>
+class csr_graph {
+  int num_nodes;
+  std::vector<edge_index_t> offsets;
+  std::vector<int> targets;
+  std::vector<W> weights;
+
+  void build(const std::vector<std::pair<int, int> > &edges, const W *w,
+             bool symmetric) {
+    int n = num_nodes;
+    long long total = (long long)edges.size()*(symmetric ? 2 : 1);
+    if (total > (long long)std::numeric_limits<edge_index_t>::max()) {
+      throw std::runtime_error("Too many edges for 32-bit offsets.");
+    }
+    edge_index_t m = total, half = edges.size();
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = std::max(1, std::min(omp_get_max_threads(),
+                                       (int)(m/65536) + 1));
+#endif
+    // count[t*n + u] is the number of edges from u in chunk t, which is then
+    // replaced by the first slot of those edges within the list of u.
+    std::vector<edge_index_t> count((size_t)num_threads*n, 0);
+    offsets.assign(n + 1, 0);
+    targets.resize(m);
+    if (w != NULL) {
+      weights.resize(m);
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        c[(e < half) ? edges[e].first : edges[e - half].second]++;
+      }
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(num_threads)
+#endif
+    for (int u = 0; u < n; u++) {
+      edge_index_t sum = 0;
+      for (int t = 0; t < num_threads; t++) {
+        edge_index_t c = count[(size_t)t*n + u];
+        count[(size_t)t*n + u] = sum;
+        sum += c;
+      }
+      offsets[u + 1] = sum;
+    }
+    for (int u = 0; u < n; u++) {
+      offsets[u + 1] += offsets[u];
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        int u = edges[(e < half) ? e : e - half].first;
+        int v = edges[(e < half) ? e : e - half].second;
+        if (e >= half) {
+          std::swap(u, v);
+        }
+        edge_index_t slot = offsets[u] + c[u]++;
+        targets[slot] = v;
+        if (w != NULL) {
+          weights[slot] = w[(e < half) ? e : e - half];
+        }
+      }
+    }
+  }
+
+ public:
+  typedef W weight_type;
+
+  csr_graph() : num_nodes(0), offsets(1, 0) {}
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            bool symmetric = false) : num_nodes(nodes) {
+    build(edges, NULL, symmetric);
+  }
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            const std::vector<W> &weights, bool symmetric = false)
+      : num_nodes(nodes) {
+    if (weights.size() != edges.size()) {
+      throw std::runtime_error("Expected one weight per edge.");
+    }
+    build(edges, weights.empty() ? NULL : &weights[0], symmetric);
+  }
+
+  int nodes() const {
+    return num_nodes;
+  }
+
+  edge_index_t edges() const {
+    return offsets[num_nodes];
+  }
+
+  edge_index_t offset(int u) const {
+    return offsets[u];
+  }
+
+  int degree(int u) const {
+    return offsets[u + 1] - offsets[u];
+  }
+
+  int target(edge_index_t e) const {
+    return targets[e];
+  }
+
+  W weight(edge_index_t e) const {
+    return weights.empty() ? W(1) : weights[e];
+  }
+
+  bool is_weighted() const {
+    return !weights.empty();
+  }
+};
+
+template<class W = int>
+class mapped_csr_graph {
+  struct header {
+    char magic[8];
+    unsigned int num_nodes, weight_size;
+    unsigned long long num_edges;
+  };
+
+  static const char *magic() {
+    return "CSRGRAPH";
+  }
+
+  const char *data;
+  size_t bytes;
+  std::vector<char> buffer;
+  int num_nodes;
+  const edge_index_t *offsets;
+  const int *targets;
+  const W *weights;
+
+  mapped_csr_graph(const mapped_csr_graph &);
+  mapped_csr_graph &operator=(const mapped_csr_graph &);
+
+  void release() {
+#ifdef CSR_GRAPH_MMAP
+    if (data != NULL) {
+      munmap((void*)data, bytes);
+    }
+#endif
+    data = NULL;
+    std::vector<char>().swap(buffer);
+  }
+
+  static size_t padded(size_t n) {
+    return (n + 7)/8*8;
+  }
+
+  // Writes the k values f(0) to f(k - 1) of type T in chunks, then zeros up to
+  // the next multiple of 8 bytes.
+  template<class T, class Graph, class Getter>
+  static bool write_array(FILE *f, const Graph &g, size_t k, Getter get) {
+    std::vector<T> chunk;
+    chunk.reserve(1 << 16);
+    for (size_t i = 0; i < k; i += chunk.size()) {
+      chunk.clear();
+      for (size_t j = i; j < k && chunk.size() < chunk.capacity(); j++) {
+        chunk.push_back(get(g, j));
+      }
+      if (fwrite(&chunk[0], sizeof(T), chunk.size(), f) != chunk.size()) {
+        return false;
+      }
+    }
+    char zeros[8] = {0};
+    size_t pad = padded(k*sizeof(T)) - k*sizeof(T);
+    return fwrite(zeros, 1, pad, f) == pad;
+  }
+
+  template<class Graph>
+  static edge_index_t get_offset(const Graph &g, size_t i) {
+    return g.offset(i);
+  }
+
+  template<class Graph>
+  static int get_target(const Graph &g, size_t i) {
+    return g.target(i);
+  }
+
+  template<class Graph>
+  static W get_weight(const Graph &g, size_t i) {
+    return g.weight(i);
+  }
+
+ public:
+  typedef W weight_type;
+
+  template<class Graph>
+  static void write(const std::string &path, const Graph &g) {
+    header h;
+    std::copy(magic(), magic() + 8, h.magic);
+    h.num_nodes = g.nodes();
+    h.weight_size = g.is_weighted() ? sizeof(W) : 0;
+    h.num_edges = g.edges();
+    FILE *f = fopen(path.c_str(), "wb");
+    if (f == NULL) {
+      throw std::runtime_error("Failed to open " + path + " for writing.");
+    }
+    size_t n = h.num_nodes, m = h.num_edges;
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              write_array<edge_index_t>(f, g, n + 1, get_offset<Graph>) &&
+              write_array<int>(f, g, m, get_target<Graph>) &&
+              (!g.is_weighted() || write_array<W>(f, g, m, get_weight<Graph>));
+    if (fclose(f) != 0 || !ok) {
+      throw std::runtime_error("Failed to write " + path + ".");
+    }
+  }
+
+  mapped_csr_graph(const std::string &path) : data(NULL), bytes(0) {
+#ifdef CSR_GRAPH_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      if (fd >= 0) {
+        close(fd);
+      }
+      throw std::runtime_error("Failed to open " + path + ".");
+    }
+    bytes = st.st_size;
+    void *p = (bytes > 0) ? mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0)
+                          : MAP_FAILED;
+    close(fd);
+    if (p == MAP_FAILED) {
+      throw std::runtime_error("Failed to map " + path + ".");
+    }
+    data = (const char*)p;
+#else
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == NULL) {
+      throw std::runtime_error("Failed to open " + path + ".");
+    }
+    char chunk[1 << 16];
+    for (size_t k; (k = fread(chunk, 1, sizeof(chunk), f)) > 0; ) {
+      buffer.insert(buffer.end(), chunk, chunk + k);
+    }
+    fclose(f);
+    bytes = buffer.size();
+    data = buffer.empty() ? NULL : &buffer[0];
+#endif
+    const header *h = (const header*)data;
+    bool ok = bytes >= sizeof(header) &&
+              std::equal(magic(), magic() + 8, h->magic) &&
+              (h->weight_size == 0 || h->weight_size == sizeof(W));
+    if (ok) {
+      size_t n = h->num_nodes, m = h->num_edges;
+      size_t offsets_bytes = padded((n + 1)*sizeof(edge_index_t));
+      size_t targets_bytes = padded(m*sizeof(int));
+      ok = bytes == sizeof(header) + offsets_bytes + targets_bytes +
+                    padded(m*h->weight_size);
+      if (ok) {
+        num_nodes = n;
+        offsets = (const edge_index_t*)(data + sizeof(header));
+        targets = (const int*)(data + sizeof(header) + offsets_bytes);
+        weights = (h->weight_size == 0) ? NULL
+            : (const W*)(data + sizeof(header) + offsets_bytes + targets_bytes);
+        ok = offsets[0] == 0 && offsets[n] == m;
+      }
+    }
+    if (!ok) {
+      release();
+      throw std::runtime_error("Invalid graph file " + path + ".");
+    }
+  }
+
+  ~mapped_csr_graph() {
+    release();
+  }
+
+  int nodes() const {
+    return num_nodes;
+  }
+
+  edge_index_t edges() const {
+    return offsets[num_nodes];
+  }
+
+  edge_index_t offset(int u) const {
+    return offsets[u];
+  }
+
+  int degree(int u) const {
+    return offsets[u + 1] - offsets[u];
+  }
+
+  int target(edge_index_t e) const {
+    return targets[e];
+  }
+
+  W weight(edge_index_t e) const {
+    return (weights == NULL) ? W(1) : weights[e];
+  }
+
+  bool is_weighted() const {
+    return weights != NULL;
+  }
+};
+
+
+// An indexed d-ary heap holding each node at most once, with decrease-key.
+template<class K, int D = 4>
+class dary_heap {
+  typedef std::pair<K, int> entry;
+  std::vector<entry> heap;
+  std::vector<int> pos;
+
+  void place(int i, const entry &e) {
+    heap[i] = e;
+    pos[e.second] = i;
+  }
+
+  void sift_up(int i, entry e) {
+    while (i > 0 && e.first < heap[(i - 1)/D].first) {
+      place(i, heap[(i - 1)/D]);
+      i = (i - 1)/D;
+    }
+    place(i, e);
+  }
+
+  void sift_down(int i, const entry &e) {
+    int n = heap.size();
+    for (;;) {
+      int lo = D*i + 1, best = lo;
+      if (lo >= n) {
+        break;
+      }
+      for (int c = lo + 1; c < lo + D && c < n; c++) {
+        if (heap[c].first < heap[best].first) {
+          best = c;
+        }
+      }
+      if (!(heap[best].first < e.first)) {
+        break;
+      }
+      place(i, heap[best]);
+      i = best;
+    }
+    place(i, e);
+  }
+
+ public:
+  explicit dary_heap(int nodes = 0) : pos(nodes, -1) {}
+
+  bool empty() const {
+    return heap.empty();
+  }
+
+  const entry &top() const {
+    return heap[0];
+  }
+
+  // Inserts v, or decreases its key if it is in the heap with a larger key.
+  void push(int v, const K &key) {
+    if (pos[v] < 0) {
+      heap.push_back(entry(key, v));
+      sift_up(heap.size() - 1, heap.back());
+    } else if (key < heap[pos[v]].first) {
+      sift_up(pos[v], entry(key, v));
+    }
+  }
+
+  entry pop() {
+    entry res = heap[0];
+    pos[res.second] = -1;
+    entry e = heap.back();
+    heap.pop_back();
+    if (!heap.empty()) {
+      sift_down(0, e);
+    }
+    return res;
+  }
+
+  // Empties the heap in time proportional to its size rather than the nodes.
+  void clear() {
+    for (int i = 0; i < (int)heap.size(); i++) {
+      pos[heap[i].second] = -1;
+    }
+    heap.clear();
+  }
+};
+
+// An edge of a contraction hierarchy, which is a shortcut through the node
+// middle if middle is not -1.
+template<class W>
+struct ch_arc {
+  typedef W weight_type;
+
+  W weight;
+  int middle;
+
+  // Any edge built from a weight alone is an original edge.
+  ch_arc(const W &weight = W(), int middle = -1)
+      : weight(weight), middle(middle) {}
+};
+
+template<class Graph>
+class ch_builder {
+  typedef typename Graph::weight_type W;
+
+  struct arc {
+    int node;
+    W weight;
+    int middle;
+  };
+
+  struct shortcut {
+    int u, w;
+    W weight;
+  };
+
+  int n, witness_limit;
+  // out[u] and in[u] hold the edges between u and the remaining nodes.
+  std::vector<std::vector<arc> > out, in;
+  std::vector<int> num_contracted, touched, mark;
+  // The targets w of a witness search from u are marked with the current
+  // stamp, along with the length bound[w] of the path u -> v -> w.
+  std::vector<W> dist, bound;
+  int stamp;
+  std::vector<shortcut> pending;
+  dary_heap<W> q;
+
+  // Adds the edge (node, weight), or lowers the weight of an existing edge.
+  static void add(std::vector<arc> &list, int node, W weight, int middle) {
+    for (int i = 0; i < (int)list.size(); i++) {
+      if (list[i].node == node) {
+        if (weight < list[i].weight) {
+          list[i].weight = weight;
+          list[i].middle = middle;
+        }
+        return;
+      }
+    }
+    arc a;
+    a.node = node;
+    a.weight = weight;
+    a.middle = middle;
+    list.push_back(a);
+  }
+
+  static void remove(std::vector<arc> &list, int node) {
+    for (int i = 0; i < (int)list.size(); i++) {
+      if (list[i].node == node) {
+        list[i] = list.back();
+        list.pop_back();
+        return;
+      }
+    }
+  }
+
+  // Sets dist[] by a search from u over the remaining nodes besides v, which
+  // stops once a witness is found for all targets, or after settling
+  // witness_limit nodes or any node beyond max_dist.
+  void witness_search(int u, int v, W max_dist, int targets) {
+    for (int i = 0; i < (int)touched.size(); i++) {
+      dist[touched[i]] = std::numeric_limits<W>::max();
+    }
+    touched.assign(1, u);
+    q.clear();
+    dist[u] = 0;
+    q.push(u, W(0));
+    for (int settled = 0; !q.empty() && settled < witness_limit; settled++) {
+      std::pair<W, int> top = q.pop();
+      if (top.first > max_dist) {
+        break;
+      }
+      const std::vector<arc> &list = out[top.second];
+      for (int i = 0; i < (int)list.size(); i++) {
+        int x = list[i].node;
+        W d = top.first + list[i].weight;
+        if (x != v && d < dist[x]) {
+          if (dist[x] == std::numeric_limits<W>::max()) {
+            touched.push_back(x);
+          }
+          bool witness = (mark[x] == stamp && d <= bound[x] &&
+                          dist[x] > bound[x]);
+          dist[x] = d;
+          q.push(x, d);
+          if (witness && --targets == 0) {
+            return;
+          }
+        }
+      }
+    }
+  }
+
+  // Stores the shortcuts needed to contract v into pending[]. A shortcut (u,
+  // w) is needed if no path avoiding v is found that is as short as the path
+  // u -> v -> w.
+  void find_shortcuts(int v) {
+    pending.clear();
+    for (int i = 0; i < (int)in[v].size(); i++) {
+      int u = in[v][i].node;
+      W max_dist = 0;
+      int targets = 0;
+      stamp++;
+      for (int j = 0; j < (int)out[v].size(); j++) {
+        int w = out[v][j].node;
+        if (w != u) {
+          mark[w] = stamp;
+          bound[w] = in[v][i].weight + out[v][j].weight;
+          max_dist = std::max(max_dist, bound[w]);
+          targets++;
+        }
+      }
+      if (targets == 0) {
+        continue;
+      }
+      witness_search(u, v, max_dist, targets);
+      for (int j = 0; j < (int)out[v].size(); j++) {
+        int w = out[v][j].node;
+        W d = in[v][i].weight + out[v][j].weight;
+        if (w != u && d < dist[w]) {
+          shortcut s;
+          s.u = u;
+          s.w = w;
+          s.weight = d;
+          pending.push_back(s);
+        }
+      }
+    }
+  }
+
+  // The edge difference, plus the number of contracted neighbors so that
+  // contractions are spread evenly over the graph. This leaves the shortcuts
+  // of v in pending[].
+  int priority(int v) {
+    find_shortcuts(v);
+    return (int)pending.size() - (int)in[v].size() - (int)out[v].size() +
+           num_contracted[v];
+  }
+
+ public:
+  ch_builder(const Graph &g, int witness_limit)
+      : n(g.nodes()), witness_limit(witness_limit), out(n), in(n),
+        num_contracted(n, 0), mark(n, 0),
+        dist(n, std::numeric_limits<W>::max()), bound(n), stamp(0), q(n) {
+    for (int u = 0; u < n; u++) {
+      for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+        int v = g.target(e);
+        if (u != v) {
+          add(out[u], v, g.weight(e), -1);
+          add(in[v], u, g.weight(e), -1);
+        }
+      }
+    }
+  }
+
+  // Contracts every node, storing the edges of node v to higher nodes as the
+  // edges of node v in the hierarchy, and the edges from higher nodes into v
+  // as reversed edges of node n + v.
+  void build(std::vector<std::pair<int, int> > &edges,
+             std::vector<ch_arc<W> > &arcs) {
+    typedef std::pair<int, int> entry;
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry> > pq;
+    for (int v = 0; v < n; v++) {
+      pq.push(entry(priority(v), v));
+    }
+    while (!pq.empty()) {
+      int v = pq.top().second;
+      pq.pop();
+      // The priorities of other nodes change as their neighbors are
+      // contracted, so that of v is recomputed lazily before contracting it.
+      int p = priority(v);
+      if (!pq.empty() && p > pq.top().first) {
+        pq.push(entry(p, v));
+        continue;
+      }
+      for (int i = 0; i < (int)pending.size(); i++) {
+        const shortcut &s = pending[i];
+        add(out[s.u], s.w, s.weight, v);
+        add(in[s.w], s.u, s.weight, v);
+      }
+      std::vector<int> neighbors;
+      for (int i = 0; i < (int)out[v].size(); i++) {
+        const arc &a = out[v][i];
+        edges.push_back(std::make_pair(v, a.node));
+        arcs.push_back(ch_arc<W>(a.weight, a.middle));
+        remove(in[a.node], v);
+        neighbors.push_back(a.node);
+      }
+      for (int i = 0; i < (int)in[v].size(); i++) {
+        const arc &a = in[v][i];
+        edges.push_back(std::make_pair(n + v, a.node));
+        arcs.push_back(ch_arc<W>(a.weight, a.middle));
+        remove(out[a.node], v);
+        neighbors.push_back(a.node);
+      }
+      std::vector<arc>().swap(out[v]);
+      std::vector<arc>().swap(in[v]);
+      std::sort(neighbors.begin(), neighbors.end());
+      neighbors.erase(std::unique(neighbors.begin(), neighbors.end()),
+                      neighbors.end());
+      for (int i = 0; i < (int)neighbors.size(); i++) {
+        num_contracted[neighbors[i]]++;
+      }
+    }
+  }
+};
+
+template<class Graph>
+void build_hierarchy(
+    const Graph &g,
+    csr_graph<ch_arc<typename Graph::weight_type> > &hierarchy,
+    int witness_limit = 500) {
+  std::vector<std::pair<int, int> > edges;
+  std::vector<ch_arc<typename Graph::weight_type> > arcs;
+  ch_builder<Graph> builder(g, witness_limit);
+  builder.build(edges, arcs);
+  hierarchy = csr_graph<ch_arc<typename Graph::weight_type> >(
+      2*g.nodes(), edges, arcs);
+}
+
+template<class Hierarchy>
+class ch_query {
+  typedef typename Hierarchy::weight_type::weight_type W;
+
+  // Both searches' labels of a node are kept together to share a cache line.
+  struct label_t {
+    W dist[2];
+    int pred[2];
+    edge_index_t pred_edge[2];
+  };
+
+  const Hierarchy &h;
+  int n, meet;
+  std::vector<label_t> label;
+  std::vector<int> touched;
+  dary_heap<W> q[2];
+
+  // Returns the index of the edge of node u in the hierarchy to v.
+  edge_index_t find_edge(int u, int v) const {
+    edge_index_t e = h.offset(u);
+    while (h.target(e) != v) {
+      e++;
+    }
+    return e;
+  }
+
+  // Appends the nodes after a on the path of the hierarchy edge e from a to b.
+  void unpack(int a, int b, edge_index_t e, std::vector<int> &res) const {
+    std::vector<std::pair<std::pair<int, int>, edge_index_t> > stack;
+    stack.push_back(std::make_pair(std::make_pair(a, b), e));
+    while (!stack.empty()) {
+      a = stack.back().first.first;
+      b = stack.back().first.second;
+      int m = h.weight(stack.back().second).middle;
+      stack.pop_back();
+      if (m < 0) {
+        res.push_back(b);
+        continue;
+      }
+      // Edges from a higher node into m are stored as reversed edges of n + m.
+      stack.push_back(std::make_pair(std::make_pair(m, b), find_edge(m, b)));
+      stack.push_back(std::make_pair(std::make_pair(a, m),
+                                     find_edge(n + m, a)));
+    }
+  }
+
+ public:
+  explicit ch_query(const Hierarchy &h)
+      : h(h), n(h.nodes()/2), meet(-1), label(n) {
+    for (int i = 0; i < n; i++) {
+      for (int s = 0; s < 2; s++) {
+        label[i].dist[s] = std::numeric_limits<W>::max();
+        label[i].pred[s] = -1;
+      }
+    }
+    q[0] = q[1] = dary_heap<W>(n);
+  }
+
+  W query(int start, int target) {
+    const W inf = std::numeric_limits<W>::max();
+    for (int i = 0; i < (int)touched.size(); i++) {
+      label_t &l = label[touched[i]];
+      l.dist[0] = l.dist[1] = inf;
+      l.pred[0] = l.pred[1] = -1;
+    }
+    touched.clear();
+    int ends[2] = {start, target};
+    for (int s = 0; s < 2; s++) {
+      q[s].clear();
+      label[ends[s]].dist[s] = 0;
+      q[s].push(ends[s], W(0));
+      touched.push_back(ends[s]);
+    }
+    W best = inf;
+    meet = -1;
+    // Each search only moves up the hierarchy, so it may stop once its keys
+    // reach the best distance, regardless of the other search.
+    for (;;) {
+      bool open[2];
+      for (int s = 0; s < 2; s++) {
+        open[s] = !q[s].empty() && (best == inf || q[s].top().first < best);
+      }
+      if (!open[0] && !open[1]) {
+        break;
+      }
+      int s = (open[0] && (!open[1] || q[0].top().first <= q[1].top().first))
+              ? 0 : 1;
+      int u = q[s].pop().second;
+      label_t &lu = label[u];
+      if (lu.dist[1 - s] != inf && lu.dist[0] + lu.dist[1] < best) {
+        best = lu.dist[0] + lu.dist[1];
+        meet = u;
+      }
+      // Stall-on-demand: skip u if a higher node already reached by this
+      // search has a shorter path to u, since u is then not on a shortest
+      // path. The edges from higher nodes into u are those of the other
+      // direction.
+      int back = (s == 0) ? n + u : u;
+      bool stalled = false;
+      for (edge_index_t e = h.offset(back); e < h.offset(back + 1); e++) {
+        const label_t &lx = label[h.target(e)];
+        if (lx.dist[s] != inf && lx.dist[s] + h.weight(e).weight < lu.dist[s]) {
+          stalled = true;
+          break;
+        }
+      }
+      if (stalled) {
+        continue;
+      }
+      int node = (s == 0) ? u : n + u;
+      for (edge_index_t e = h.offset(node); e < h.offset(node + 1); e++) {
+        int v = h.target(e);
+        W d = lu.dist[s] + h.weight(e).weight;
+        label_t &lv = label[v];
+        if (d < lv.dist[s]) {
+          if (lv.dist[0] == inf && lv.dist[1] == inf) {
+            touched.push_back(v);
+          }
+          lv.dist[s] = d;
+          lv.pred[s] = u;
+          lv.pred_edge[s] = e;
+          q[s].push(v, d);
+        }
+      }
+    }
+    return best;
+  }
+
+  // Returns the nodes of a shortest path in the original graph found by the
+  // last query, if any.
+  std::vector<int> path() const {
+    std::vector<int> res;
+    if (meet < 0) {
+      return res;
+    }
+    std::vector<int> up;
+    for (int u = meet; u != -1; u = label[u].pred[0]) {
+      up.push_back(u);
+    }
+    res.push_back(up.back());
+    for (int i = (int)up.size() - 1; i > 0; i--) {
+      unpack(up[i], up[i - 1], label[up[i - 1]].pred_edge[0], res);
+    }
+    for (int u = meet; label[u].pred[1] != -1; u = label[u].pred[1]) {
+      unpack(u, label[u].pred[1], label[u].pred_edge[1], res);
+    }
+    return res;
+  }
+};
+
+/*** Example Usage and Output:
+
+The shortest distance from 0 to 3 is 5.
+Take the path: 0->1->2->3.
+Grid with 65536 nodes and 261120 edges:
+  build 2.90425s, 565964 edges in hierarchy, write 0.003085s
+  200 queries: dijkstra 0.706306s, ch_query 0.0116384s
+  200 queries with paths: 0.015543s
+
+***/
+
+#include <cassert>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+using namespace std;
+
+double wall_time() {
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+int rand30() {
+  return (rand() & 0x7fff) << 15 | (rand() & 0x7fff);
+}
+
+// Dijkstra's algorithm as a reference, stopping early if target is not -1.
+void dijkstra(const csr_graph<> &g, int start, vector<int> &dist,
+              int target = -1) {
+  dist.assign(g.nodes(), numeric_limits<int>::max());
+  dary_heap<int> q(g.nodes());
+  dist[start] = 0;
+  q.push(start, 0);
+  while (!q.empty()) {
+    int u = q.pop().second;
+    if (u == target) {
+      break;
+    }
+    for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+      int v = g.target(e);
+      if (dist[u] + g.weight(e) < dist[v]) {
+        dist[v] = dist[u] + g.weight(e);
+        q.push(v, dist[v]);
+      }
+    }
+  }
+}
+
+// Returns the total weight of a path in g, or -1 if it is not a path.
+long long path_weight(const csr_graph<> &g, const vector<int> &path) {
+  long long res = 0;
+  for (int i = 0; i + 1 < (int)path.size(); i++) {
+    int best = -1;
+    for (edge_index_t e = g.offset(path[i]); e < g.offset(path[i] + 1); e++) {
+      if (g.target(e) == path[i + 1] && (best < 0 || g.weight(e) < best)) {
+        best = g.weight(e);
+      }
+    }
+    if (best < 0) {
+      return -1;
+    }
+    res += best;
+  }
+  return res;
+}
+
+template<class Hierarchy>
+void check_queries(const csr_graph<> &g, const Hierarchy &h) {
+  int n = g.nodes();
+  ch_query<Hierarchy> q(h);
+  vector<int> dist;
+  for (int start = 0; start < n; start++) {
+    dijkstra(g, start, dist);
+    for (int i = 0; i < 5; i++) {
+      int target = rand() % n;
+      assert(q.query(start, target) == dist[target]);
+      vector<int> path = q.path();
+      if (dist[target] == numeric_limits<int>::max()) {
+        assert(path.empty());
+      } else {
+        assert(path.front() == start && path.back() == target);
+        assert(path_weight(g, path) == dist[target]);
+      }
+    }
+  }
+}
+
+void test_hierarchy(int n, int m, bool symmetric, int witness_limit) {
+  vector<pair<int, int> > edges(m);
+  vector<int> weights(m);
+  for (int i = 0; i < m; i++) {
+    edges[i] = make_pair(rand() % n, rand() % n);
+    weights[i] = rand() % 20;
+  }
+  csr_graph<> g(n, edges, weights, symmetric);
+  csr_graph<ch_arc<int> > h;
+  build_hierarchy(g, h, witness_limit);
+  assert(h.nodes() == 2*n);
+  check_queries(g, h);
+}
+
+// A grid of roads with random travel times, similar to a road network.
+csr_graph<> grid_graph(int side) {
+  int n = side*side;
+  vector<pair<int, int> > edges;
+  vector<int> weights;
+  for (int u = 0; u < n; u++) {
+    if (u % side + 1 < side) {
+      edges.push_back(make_pair(u, u + 1));
+      weights.push_back(1 + rand() % 100);
+    }
+    if (u + side < n) {
+      edges.push_back(make_pair(u, u + side));
+      weights.push_back(1 + rand() % 100);
+    }
+  }
+  return csr_graph<>(n, edges, weights, true);
+}
+
+int main() {
+  {
+    // A path 0 -> 1 -> 2 -> 3 with a detour 0 -> 3 of weight 8.
+    vector<pair<int, int> > edges;
+    vector<int> weights;
+    edges.push_back(make_pair(0, 1));
+    weights.push_back(2);
+    edges.push_back(make_pair(1, 2));
+    weights.push_back(2);
+    edges.push_back(make_pair(2, 3));
+    weights.push_back(1);
+    edges.push_back(make_pair(0, 3));
+    weights.push_back(8);
+    csr_graph<> g(4, edges, weights);
+    csr_graph<ch_arc<int> > h;
+    build_hierarchy(g, h);
+    ch_query<csr_graph<ch_arc<int> > > q(h);
+    cout << "The shortest distance from 0 to 3 is " << q.query(0, 3) << "."
+         << endl;
+    vector<int> path = q.path();
+    cout << "Take the path: ";
+    for (int i = 0; i < (int)path.size(); i++) {
+      cout << (i > 0 ? "->" : "") << path[i];
+    }
+    cout << "." << endl;
+    assert(q.query(0, 3) == 5 && q.query(3, 0) == numeric_limits<int>::max());
+    assert(q.path().empty() && q.query(2, 2) == 0);
+  }
+  for (int iter = 0; iter < 200; iter++) {
+    int n = 1 + rand() % 60;
+    test_hierarchy(n, rand() % (4*n), iter % 2 == 0, (iter % 3 == 0) ? 1 : 50);
+  }
+
+  csr_graph<> g = grid_graph(256);
+  csr_graph<ch_arc<int> > h;
+  double start = wall_time();
+  build_hierarchy(g, h);
+  double build_time = wall_time() - start;
+  start = wall_time();
+  mapped_csr_graph<ch_arc<int> >::write("hierarchy.tmp", h);
+  double write_time = wall_time() - start;
+  cout << "Grid with " << g.nodes() << " nodes and " << g.edges()
+       << " edges:" << endl << "  build " << build_time << "s, " << h.edges()
+       << " edges in hierarchy, write " << write_time << "s" << endl;
+  {
+    mapped_csr_graph<ch_arc<int> > mapped("hierarchy.tmp");
+    assert(mapped.nodes() == h.nodes() && mapped.edges() == h.edges());
+    ch_query<mapped_csr_graph<ch_arc<int> > > q(mapped);
+    int num_queries = 200;
+    vector<int> sources(num_queries), targets(num_queries), dist;
+    for (int i = 0; i < num_queries; i++) {
+      sources[i] = rand30() % g.nodes();
+      targets[i] = rand30() % g.nodes();
+    }
+    vector<int> expected(num_queries);
+    start = wall_time();
+    for (int i = 0; i < num_queries; i++) {
+      dijkstra(g, sources[i], dist, targets[i]);
+      expected[i] = dist[targets[i]];
+    }
+    double dijkstra_time = wall_time() - start;
+    start = wall_time();
+    int reps = 50;
+    for (int r = 0; r < reps; r++) {
+      for (int i = 0; i < num_queries; i++) {
+        assert(q.query(sources[i], targets[i]) == expected[i]);
+      }
+    }
+    double ch_time = (wall_time() - start)/reps;
+    cout << "  " << num_queries << " queries: dijkstra " << dijkstra_time
+         << "s, ch_query " << ch_time << "s" << endl;
+    start = wall_time();
+    for (int i = 0; i < num_queries; i++) {
+      q.query(sources[i], targets[i]);
+      vector<int> path = q.path();
+      assert(path_weight(g, path) == expected[i]);
+    }
+    cout << "  " << num_queries << " queries with paths: "
+         << wall_time() - start
+         << "s" << endl;
+  }
+  remove("hierarchy.tmp");
+  return 0;
+}
@@ -9,6 +9,11 @@ global, pre-populated adjacency list adj[] which must only consist of nodes
 numbered with integers between 0 (inclusive) and the total number of nodes
 (exclusive), as passed in the function argument.
 
+The search runs on the explicit-stack depth-first search engine of section
+4.1.1, whose visitor is notified when each node is entered, for each edge, and
+when each node is finished. Since no recursion is used, the graph may have
+paths of any length.
+
 Time Complexity:
 - O(max(n, m)) per call to tarjan(), where n is the number of nodes and m is the
   number of edges.
@@ -16,58 +21,94 @@ Time Complexity:
 Space Complexity:
 - O(max(n, m)) for storage of the graph, where n the number of nodes and m is
   the number of edges.
-- O(n) auxiliary stack space for tarjan().
+- O(n) auxiliary heap space for tarjan().
 
 */
 
 #include <algorithm>
+#include <utility>
 #include <vector>
 
-const int MAXN = 100, INF = 0x3f3f3f3f;
+const int MAXN = 1000000, INF = 0x3f3f3f3f;
 std::vector<int> adj[MAXN], stack;
 int timer, lowlink[MAXN];
-std::vector<bool> visit(MAXN);
+std::vector<bool> visit(MAXN), is_component_root(MAXN);
 std::vector<std::vector<int> > scc;
 
-void dfs(int u) {
-  lowlink[u] = timer++;
-  visit[u] = true;
-  stack.push_back(u);
-  bool is_component_root = true;
-  int v;
-  for (int j = 0; j < (int)adj[u].size(); j++) {
-    v = adj[u][j];
-    if (!visit[v]) {
-      dfs(v);
+template<class Visitor>
+void dfs(int start, Visitor &v) {
+  std::vector<std::pair<int, int> > frames;
+  visit[start] = true;
+  v.pre(start, -1);
+  frames.push_back(std::make_pair(start, 0));
+  while (!frames.empty()) {
+    int u = frames.back().first, j = frames.back().second++;
+    if (j == (int)adj[u].size()) {
+      frames.pop_back();
+      v.post(u, frames.empty() ? -1 : frames.back().first);
+      continue;
+    }
+    int w = adj[u][j];
+    bool tree = !visit[w];
+    v.edge(u, w, tree);
+    if (tree) {
+      visit[w] = true;
+      v.pre(w, u);
+      frames.push_back(std::make_pair(w, 0));
     }
+  }
+}
+
+struct tarjan_visitor {
+  static void lower(int u, int v) {
     if (lowlink[u] > lowlink[v]) {
       lowlink[u] = lowlink[v];
-      is_component_root = false;
+      is_component_root[u] = false;
     }
   }
-  if (!is_component_root) {
-    return;
+
+  void pre(int u, int) {
+    lowlink[u] = timer++;
+    is_component_root[u] = true;
+    stack.push_back(u);
   }
-  std::vector<int> component;
-  do {
-    v = stack.back();
-    visit[v] = true;
-    stack.pop_back();
-    lowlink[v] = INF;
-    component.push_back(v);
-  } while (u != v);
-  scc.push_back(component);
-}
+
+  void edge(int u, int v, bool tree) {
+    if (!tree) {
+      lower(u, v);
+    }
+  }
+
+  // Pops the component of u if it is the root, before its parent p takes the
+  // lowlink of u (which is INF for nodes already assigned to a component).
+  void post(int u, int p) {
+    if (is_component_root[u]) {
+      std::vector<int> component;
+      int v;
+      do {
+        v = stack.back();
+        stack.pop_back();
+        lowlink[v] = INF;
+        component.push_back(v);
+      } while (u != v);
+      scc.push_back(component);
+    }
+    if (p != -1) {
+      lower(p, u);
+    }
+  }
+};
 
 void tarjan(int nodes) {
   scc.clear();
   stack.clear();
   std::fill(lowlink, lowlink + nodes, 0);
-  std::fill(visit.begin(), visit.end(), false);
+  std::fill(visit.begin(), visit.begin() + nodes, false);
   timer = 0;
+  tarjan_visitor v;
   for (int i = 0; i < nodes; i++) {
     if (!visit[i]) {
-      dfs(i);
+      dfs(i, v);
     }
   }
 }
@@ -81,6 +122,7 @@ Components:
 
 ***/
 
+#include <cassert>
 #include <iostream>
 using namespace std;
 
@@ -107,5 +149,24 @@ int main() {
     }
     cout << endl;
   }
+  assert(scc.size() == 3 && scc[1].size() == 3 && scc[2][0] == 4);
+
+  // A recursive search would overflow the call stack on such a long cycle.
+  int n = MAXN;
+  for (int i = 0; i < n; i++) {
+    adj[i].clear();
+    adj[i].push_back((i + 1) % n);
+  }
+  adj[n/2].push_back(0);
+  tarjan(n);
+  assert(scc.size() == 1 && (int)scc[0].size() == n);
+  for (int i = 0; i < n; i++) {
+    adj[i].clear();
+    if (i + 1 < n) {
+      adj[i].push_back(i + 1);
+    }
+  }
+  tarjan(n);
+  assert((int)scc.size() == n && scc[0][0] == n - 1);
   return 0;
 }
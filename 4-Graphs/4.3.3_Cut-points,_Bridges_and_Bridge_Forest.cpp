@@ -8,6 +8,11 @@ also exists in adj[v]. Nodes in adj[] must be numbered with integers between 0
 arguments. get_block_forest() applies to a global vector blocks[] which must be
 already precomputed by a call to tarjan().
 
+The search runs on the explicit-stack depth-first search engine of section
+4.1.1, whose visitor is notified when each node is entered, for each edge, and
+when each node is finished. Since no recursion is used, the graph may have
+paths of any length.
+
 A cut-point (i.e. cut-node, or articulation point) is any node whose removal
 increases the number of connected components in the graph.
 
@@ -20,68 +25,144 @@ decompose any connected graph into a bridge-block tree (a.k.a. bridge-tree or
 block-tree), with bridges connecting each block. An unconnected graph will thus
 decompose into a "bridge-block forest."
 
+A biconnected component (or block) is a maximal subgraph which remains
+connected after removing any one of its nodes, where a single edge also counts
+as a block. Every edge lies in exactly one block, and two blocks share at most
+one node, which is then a cut-point. The block-cut tree has one node for every
+block and one for every cut-point, with an edge between each cut-point and
+every block containing it.
+
+biconnectivity(g) computes all of the above for an undirected csr_graph (see
+section 4.1.5), or any graph type with the same read-only interface, in which
+every edge is stored in both directions (e.g. built with symmetric = true).
+The same explicit-stack search is run directly over the edges of the graph,
+skipping only one edge back to the parent of each node, so that parallel edges
+are handled correctly. The results are kept in flat arrays indexed by node:
+- blocks() returns the number of blocks, and block_of(v) returns the block of
+  node v, which is the one in which v was reached first by the search. Every
+  block b other than a single isolated node has a head block_head(b), the one
+  node of b seen before the rest of b by the search, which belongs to b as well
+  (and is either a cut-point or the root of the search). block_of(v) is -1 if v
+  is the root of a search with at least one edge, since v then only belongs to
+  blocks which it heads.
+- is_cutpoint(v) returns whether node v is a cut-point, and cutpoints() returns
+  their number.
+- tree_parent(x) returns the parent of node x of the block-cut forest, or -1 if
+  x is a root, where x is either a block b in [0, blocks()) or tree_node(v) for
+  a cut-point v, in [blocks(), blocks() + cutpoints()). The parent of a block is
+  its head if that is a cut-point, and the parent of a cut-point v is the block
+  block_of(v).
+- two_edge_components() returns the number of bridge-blocks, and
+  two_edge_component(v) returns the index of the bridge-block of node v.
+- bridges() returns the bridges of the graph as pairs of nodes.
+- biconnected(u, v) returns whether nodes u and v are in a common block, so that
+  (unless the block is a single edge) there are two paths from u to v without
+  any common node except for their ends.
+- two_edge_connected(u, v) returns whether nodes u and v are in the same bridge-
+  block, so that there are two paths from u to v without any common edge.
+
 Time Complexity:
 - O(max(n, m)) per call to tarjan() and get_block_forest(), where n is the
   number of nodes and m is the number of edges.
+- O(n + m) per call to the biconnectivity constructor.
+- O(1) per call to all other member functions of biconnectivity.
 
 Space Complexity:
 - O(max(n, m)) for storage of the graph, where n the number of nodes and m is
   the number of edges
-- O(n) auxiliary stack space for tarjan().
+- O(n) auxiliary heap space for tarjan().
 - O(1) auxiliary stack space for get_block_forest().
+- O(n) for storage of biconnectivity, plus O(n) auxiliary heap space for the
+  constructor.
 
 */
 
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 #include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-const int MAXN = 100;
-int timer, lowlink[MAXN], tin[MAXN], comp[MAXN];
-std::vector<bool> visit(MAXN);
+const int MAXN = 1000000;
+int timer, lowlink[MAXN], tin[MAXN], comp[MAXN], parent[MAXN], children[MAXN];
+std::vector<bool> visit(MAXN), is_cutpoint(MAXN);
 std::vector<int> adj[MAXN], block_forest[MAXN];
 std::vector<int> stack, cutpoints;
 std::vector<std::vector<int> > block;
 std::vector<std::pair<int, int> > bridges;
 
-void dfs(int u, int p) {
-  visit[u] = true;
-  lowlink[u] = tin[u] = timer++;
-  stack.push_back(u);
-  int v, children = 0;
-  bool cutpoint = false;
-  for (int j = 0; j < (int)adj[u].size(); j++) {
-    v = adj[u][j];
-    if (v == p) {
+template<class Visitor>
+void dfs(int start, Visitor &v) {
+  std::vector<std::pair<int, int> > frames;
+  visit[start] = true;
+  v.pre(start, -1);
+  frames.push_back(std::make_pair(start, 0));
+  while (!frames.empty()) {
+    int u = frames.back().first, j = frames.back().second++;
+    if (j == (int)adj[u].size()) {
+      frames.pop_back();
+      v.post(u, frames.empty() ? -1 : frames.back().first);
       continue;
     }
-    if (visit[v]) {
-      lowlink[u] = std::min(lowlink[u], tin[v]);
-    } else {
-      dfs(v, u);
-      lowlink[u] = std::min(lowlink[u], lowlink[v]);
-      cutpoint |= (lowlink[v] >= tin[u]);
-      if (lowlink[v] > tin[u]) {
-        bridges.push_back(std::make_pair(u, v));
-      }
-      children++;
+    int w = adj[u][j];
+    bool tree = !visit[w];
+    v.edge(u, w, tree);
+    if (tree) {
+      visit[w] = true;
+      v.pre(w, u);
+      frames.push_back(std::make_pair(w, 0));
     }
   }
-  if (p == -1) {
-    cutpoint = (children >= 2);
+}
+
+struct tarjan_visitor {
+  void pre(int u, int p) {
+    lowlink[u] = tin[u] = timer++;
+    parent[u] = p;
+    children[u] = 0;
+    is_cutpoint[u] = false;
+    stack.push_back(u);
   }
-  if (cutpoint) {
-    cutpoints.push_back(u);
+
+  void edge(int u, int v, bool tree) {
+    if (!tree && v != parent[u]) {
+      lowlink[u] = std::min(lowlink[u], tin[v]);
+    }
   }
-  if (lowlink[u] == tin[u]) {
-    std::vector<int> component;
-    do {
-      v = stack.back();
-      stack.pop_back();
-      component.push_back(v);
-    } while (u != v);
-    block.push_back(component);
+
+  // Finishes u, then updates its parent p with the lowlink of u.
+  void post(int u, int p) {
+    if (p == -1) {
+      is_cutpoint[u] = (children[u] >= 2);
+    }
+    if (is_cutpoint[u]) {
+      cutpoints.push_back(u);
+    }
+    if (lowlink[u] == tin[u]) {
+      std::vector<int> component;
+      int v;
+      do {
+        v = stack.back();
+        stack.pop_back();
+        component.push_back(v);
+      } while (u != v);
+      block.push_back(component);
+    }
+    if (p != -1) {
+      lowlink[p] = std::min(lowlink[p], lowlink[u]);
+      if (lowlink[u] >= tin[p]) {
+        is_cutpoint[p] = true;
+      }
+      if (lowlink[u] > tin[p]) {
+        bridges.push_back(std::make_pair(p, u));
+      }
+      children[p]++;
+    }
   }
-}
+};
 
 void tarjan(int nodes) {
   block.clear();
@@ -90,11 +171,12 @@ void tarjan(int nodes) {
   stack.clear();
   std::fill(lowlink, lowlink + nodes, 0);
   std::fill(tin, tin + nodes, 0);
-  std::fill(visit.begin(), visit.end(), false);
+  std::fill(visit.begin(), visit.begin() + nodes, false);
   timer = 0;
+  tarjan_visitor v;
   for (int i = 0; i < nodes; i++) {
     if (!visit[i]) {
-      dfs(i, -1);
+      dfs(i, v);
     }
   }
 }
@@ -118,6 +200,292 @@ void get_block_forest(int nodes) {
   }
 }
 
+typedef unsigned int edge_index_t;
+
+template<class W = int>
+class csr_graph {
+  int num_nodes;
+  std::vector<edge_index_t> offsets;
+  std::vector<int> targets;
+  std::vector<W> weights;
+
+  void build(const std::vector<std::pair<int, int> > &edges, const W *w,
+             bool symmetric) {
+    int n = num_nodes;
+    long long total = (long long)edges.size()*(symmetric ? 2 : 1);
+    if (total > (long long)std::numeric_limits<edge_index_t>::max()) {
+      throw std::runtime_error("Too many edges for 32-bit offsets.");
+    }
+    edge_index_t m = total, half = edges.size();
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = std::max(1, std::min(omp_get_max_threads(),
+                                       (int)(m/65536) + 1));
+#endif
+    // count[t*n + u] is the number of edges from u in chunk t, which is then
+    // replaced by the first slot of those edges within the list of u.
+    std::vector<edge_index_t> count((size_t)num_threads*n, 0);
+    offsets.assign(n + 1, 0);
+    targets.resize(m);
+    if (w != NULL) {
+      weights.resize(m);
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        c[(e < half) ? edges[e].first : edges[e - half].second]++;
+      }
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(num_threads)
+#endif
+    for (int u = 0; u < n; u++) {
+      edge_index_t sum = 0;
+      for (int t = 0; t < num_threads; t++) {
+        edge_index_t c = count[(size_t)t*n + u];
+        count[(size_t)t*n + u] = sum;
+        sum += c;
+      }
+      offsets[u + 1] = sum;
+    }
+    for (int u = 0; u < n; u++) {
+      offsets[u + 1] += offsets[u];
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        int u = edges[(e < half) ? e : e - half].first;
+        int v = edges[(e < half) ? e : e - half].second;
+        if (e >= half) {
+          std::swap(u, v);
+        }
+        edge_index_t slot = offsets[u] + c[u]++;
+        targets[slot] = v;
+        if (w != NULL) {
+          weights[slot] = w[(e < half) ? e : e - half];
+        }
+      }
+    }
+  }
+
+ public:
+  typedef W weight_type;
+
+  csr_graph() : num_nodes(0), offsets(1, 0) {}
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            bool symmetric = false) : num_nodes(nodes) {
+    build(edges, NULL, symmetric);
+  }
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            const std::vector<W> &weights, bool symmetric = false)
+      : num_nodes(nodes) {
+    if (weights.size() != edges.size()) {
+      throw std::runtime_error("Expected one weight per edge.");
+    }
+    build(edges, weights.empty() ? NULL : &weights[0], symmetric);
+  }
+
+  int nodes() const {
+    return num_nodes;
+  }
+
+  edge_index_t edges() const {
+    return offsets[num_nodes];
+  }
+
+  edge_index_t offset(int u) const {
+    return offsets[u];
+  }
+
+  int degree(int u) const {
+    return offsets[u + 1] - offsets[u];
+  }
+
+  int target(edge_index_t e) const {
+    return targets[e];
+  }
+
+  W weight(edge_index_t e) const {
+    return weights.empty() ? W(1) : weights[e];
+  }
+
+  bool is_weighted() const {
+    return !weights.empty();
+  }
+};
+
+template<class Graph>
+class biconnectivity {
+  struct frame {
+    int u;
+    edge_index_t e;
+    bool skipped_parent;
+
+    frame(int u, edge_index_t e) : u(u), e(e), skipped_parent(false) {}
+  };
+
+  int num_blocks, num_cutpoints, num_two_edge;
+  std::vector<int> block, head, tree, parent, two_edge;
+  std::vector<std::pair<int, int> > bridge_list;
+  std::vector<bool> cut;
+
+ public:
+  biconnectivity(const Graph &g)
+      : num_blocks(0), num_cutpoints(0), num_two_edge(0),
+        block(g.nodes(), -1), tree(g.nodes(), -1), two_edge(g.nodes(), -1),
+        cut(g.nodes(), false) {
+    int n = g.nodes(), timer = 0;
+    std::vector<int> tin(n, -1), low(n), children(n, 0);
+    std::vector<int> block_stack, two_edge_stack;
+    std::vector<frame> frames;
+    for (int root = 0; root < n; root++) {
+      if (tin[root] != -1) {
+        continue;
+      }
+      tin[root] = low[root] = timer++;
+      block_stack.push_back(root);
+      two_edge_stack.push_back(root);
+      frames.push_back(frame(root, g.offset(root)));
+      while (!frames.empty()) {
+        frame &f = frames.back();
+        int u = f.u;
+        if (f.e < g.offset(u + 1)) {
+          int v = g.target(f.e++);
+          int p = (frames.size() > 1) ? frames[frames.size() - 2].u : -1;
+          if (tin[v] == -1) {
+            tin[v] = low[v] = timer++;
+            block_stack.push_back(v);
+            two_edge_stack.push_back(v);
+            frames.push_back(frame(v, g.offset(v)));
+          } else if (v == p && !f.skipped_parent) {
+            f.skipped_parent = true;
+          } else {
+            low[u] = std::min(low[u], tin[v]);
+          }
+          continue;
+        }
+        frames.pop_back();
+        if (low[u] == tin[u]) {
+          int v;
+          do {
+            v = two_edge_stack.back();
+            two_edge_stack.pop_back();
+            two_edge[v] = num_two_edge;
+          } while (v != u);
+          num_two_edge++;
+        }
+        if (frames.empty()) {
+          block_stack.pop_back();
+          if (children[u] == 0) {
+            block[u] = num_blocks++;
+            head.push_back(-1);
+          }
+          cut[u] = (children[u] >= 2);
+          continue;
+        }
+        int p = frames.back().u;
+        low[p] = std::min(low[p], low[u]);
+        children[p]++;
+        if (low[u] >= tin[p]) {
+          int v;
+          do {
+            v = block_stack.back();
+            block_stack.pop_back();
+            block[v] = num_blocks;
+          } while (v != u);
+          head.push_back(p);
+          num_blocks++;
+          cut[p] = cut[p] || (p != root);
+        }
+        if (low[u] > tin[p]) {
+          bridge_list.push_back(std::make_pair(p, u));
+        }
+      }
+    }
+    // Cut-points take the tree nodes after the blocks, in order of index.
+    parent.resize(num_blocks);
+    for (int v = 0; v < n; v++) {
+      if (cut[v]) {
+        tree[v] = num_blocks + num_cutpoints++;
+        parent.push_back(block[v]);
+      }
+    }
+    for (int b = 0; b < num_blocks; b++) {
+      parent[b] = (head[b] != -1 && cut[head[b]]) ? tree[head[b]] : -1;
+    }
+  }
+
+  int blocks() const {
+    return num_blocks;
+  }
+
+  int block_of(int v) const {
+    return block[v];
+  }
+
+  int block_head(int b) const {
+    return head[b];
+  }
+
+  bool is_cutpoint(int v) const {
+    return cut[v];
+  }
+
+  int cutpoints() const {
+    return num_cutpoints;
+  }
+
+  int tree_node(int v) const {
+    return tree[v];
+  }
+
+  int tree_parent(int x) const {
+    return parent[x];
+  }
+
+  int two_edge_components() const {
+    return num_two_edge;
+  }
+
+  int two_edge_component(int v) const {
+    return two_edge[v];
+  }
+
+  const std::vector<std::pair<int, int> >& bridges() const {
+    return bridge_list;
+  }
+
+  bool biconnected(int u, int v) const {
+    int bu = block[u], bv = block[v];
+    return u == v || (bu != -1 && (bu == bv || head[bu] == v)) ||
+           (bv != -1 && head[bv] == u);
+  }
+
+  bool two_edge_connected(int u, int v) const {
+    return two_edge[u] == two_edge[v];
+  }
+};
+
 /*** Example Usage and Output:
 
 Cut-points: 5 1
@@ -125,7 +493,7 @@ Bridges:
 1 2
 5 4
 3 7
-Blocks, a.k.a. Edge-Biconnected Components:
+Blocks, or Edge-Biconnected Components:
 2 
 4 
 5 1 0 
@@ -139,17 +507,167 @@ Adjacency List for Bridge-Block Forest:
 3 => 4
 4 => 3
 5 =>
+1000000 nodes, 1981827 edges, 38895 blocks:
+  tarjan 0.52399s, biconnectivity 0.276419s, 10000000 queries 0.548842s
 
 ***/
 
+#include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <sys/time.h>
 using namespace std;
 
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+int rand30() {
+  return (rand() & 0x7fff) << 15 ^ (rand() & 0x7fff);
+}
+
 void add_edge(int u, int v) {
   adj[u].push_back(v);
   adj[v].push_back(u);
 }
 
+// Returns the component of every node after removing node x and edge y.
+vector<int> components(int n, const vector<pair<int, int> > &edges, int x,
+                       int y) {
+  vector<vector<int> > g(n);
+  for (int i = 0; i < (int)edges.size(); i++) {
+    if (i != y && edges[i].first != x && edges[i].second != x) {
+      g[edges[i].first].push_back(edges[i].second);
+      g[edges[i].second].push_back(edges[i].first);
+    }
+  }
+  vector<int> comp(n, -1);
+  for (int s = 0; s < n; s++) {
+    if (comp[s] != -1 || s == x) {
+      continue;
+    }
+    vector<int> q(1, s);
+    comp[s] = s;
+    for (int i = 0; i < (int)q.size(); i++) {
+      for (int j = 0; j < (int)g[q[i]].size(); j++) {
+        int v = g[q[i]][j];
+        if (comp[v] == -1) {
+          comp[v] = s;
+          q.push_back(v);
+        }
+      }
+    }
+  }
+  return comp;
+}
+
+int count_components(const vector<int> &comp) {
+  int res = 0;
+  for (int v = 0; v < (int)comp.size(); v++) {
+    res += (comp[v] == v);
+  }
+  return res;
+}
+
+void test_biconnectivity(int n, const vector<pair<int, int> > &edges) {
+  csr_graph<> g(n, edges, true);
+  biconnectivity<csr_graph<> > b(g);
+  vector<int> all = components(n, edges, -1, -1);
+  vector<bool> adjacent(n*n, false);
+  for (int i = 0; i < (int)edges.size(); i++) {
+    adjacent[edges[i].first*n + edges[i].second] = true;
+    adjacent[edges[i].second*n + edges[i].first] = true;
+  }
+  // vertex_cut[x][u] and edge_cut[y][u] are the components without x or y.
+  vector<vector<int> > vertex_cut(n), edge_cut(edges.size());
+  int cutpoints = 0, bridges = 0;
+  for (int x = 0; x < n; x++) {
+    vertex_cut[x] = components(n, edges, x, -1);
+    bool is_cut = count_components(vertex_cut[x]) > count_components(all);
+    assert(b.is_cutpoint(x) == is_cut);
+    cutpoints += is_cut;
+  }
+  for (int y = 0; y < (int)edges.size(); y++) {
+    edge_cut[y] = components(n, edges, -1, y);
+    bridges += count_components(edge_cut[y]) > count_components(all);
+  }
+  assert(b.cutpoints() == cutpoints && (int)b.bridges().size() == bridges);
+  for (int u = 0; u < n; u++) {
+    for (int v = 0; v < n; v++) {
+      // Two paths without a common inner node exist unless some other node
+      // separates u from v (by Menger's theorem), and an edge is a block.
+      bool bi = (all[u] == all[v]);
+      bool two_edge = bi;
+      for (int x = 0; x < n && bi && !adjacent[u*n + v]; x++) {
+        bi = (x == u || x == v || vertex_cut[x][u] == vertex_cut[x][v]);
+      }
+      for (int y = 0; y < (int)edges.size() && two_edge; y++) {
+        two_edge = (edge_cut[y][u] == edge_cut[y][v]);
+      }
+      assert(b.biconnected(u, v) == bi);
+      assert(b.two_edge_connected(u, v) == two_edge);
+    }
+  }
+  // Check that the tree links each block to the cut-points it contains.
+  for (int v = 0; v < n; v++) {
+    int t = b.tree_node(v);
+    assert((t != -1) == b.is_cutpoint(v));
+    if (t != -1) {
+      assert(t >= b.blocks() && t < b.blocks() + b.cutpoints());
+      assert(b.tree_parent(t) == b.block_of(v));
+    }
+  }
+  for (int x = 0; x < b.blocks(); x++) {
+    int h = b.block_head(x), p = b.tree_parent(x);
+    assert(p == -1 || p == b.tree_node(h));
+  }
+}
+
+void benchmark(int n, int m) {
+  vector<pair<int, int> > edges;
+  for (int i = 0; i < n; i++) {
+    adj[i].clear();
+  }
+  // A random tree of small cycles, with a few random chords.
+  for (int i = 1; i < n; i++) {
+    edges.push_back(make_pair((i % 3 == 0) ? rand30() % i : i - 1, i));
+  }
+  while ((int)edges.size() < m) {
+    int u = rand30() % n, v = (u + 1 + rand() % 64) % n;
+    edges.push_back(make_pair(min(u, v), max(u, v)));
+  }
+  // The global tarjan() requires a graph without parallel edges.
+  sort(edges.begin(), edges.end());
+  edges.erase(unique(edges.begin(), edges.end()), edges.end());
+  m = edges.size();
+  for (int i = 0; i < (int)edges.size(); i++) {
+    add_edge(edges[i].first, edges[i].second);
+  }
+  double start = wall_time();
+  tarjan(n);
+  double global_time = wall_time() - start;
+  csr_graph<> g(n, edges, true);
+  start = wall_time();
+  biconnectivity<csr_graph<> > b(g);
+  double build_time = wall_time() - start;
+  assert(b.two_edge_components() == (int)block.size());
+  assert(b.bridges().size() == bridges.size());
+  assert(b.cutpoints() == (int)cutpoints.size());
+  int queries = 10000000, count = 0;
+  start = wall_time();
+  for (int i = 0; i < queries; i++) {
+    int u = rand30() % n, v = (u + rand() % 16) % n;
+    count += b.biconnected(u, v);
+  }
+  double query_time = wall_time() - start;
+  cout << n << " nodes, " << m << " edges, " << b.blocks() << " blocks:"
+       << endl << "  tarjan " << global_time << "s, biconnectivity "
+       << build_time << "s, " << queries << " queries " << query_time << "s"
+       << endl;
+}
+
 int main() {
   add_edge(0, 1);
   add_edge(0, 5);
@@ -182,5 +700,46 @@ int main() {
     }
     cout << endl;
   }
+  assert(cutpoints.size() == 2 && bridges.size() == 3 && block.size() == 6);
+
+  // A recursive search would overflow the call stack on such a long path.
+  int n = MAXN;
+  for (int i = 0; i < n; i++) {
+    adj[i].clear();
+  }
+  for (int i = 0; i + 1 < n; i++) {
+    add_edge(i, i + 1);
+  }
+  tarjan(n);
+  assert((int)cutpoints.size() == n - 2 && (int)bridges.size() == n - 1);
+  add_edge(n - 1, 0);
+  tarjan(n);
+  assert(cutpoints.empty() && bridges.empty() && block.size() == 1);
+
+  {
+    int e[][2] = {{0, 1}, {0, 5}, {1, 2}, {1, 5}, {3, 7}, {4, 5}, {2, 6},
+                  {6, 2}};
+    vector<pair<int, int> > edges;
+    for (int i = 0; i < 8; i++) {
+      edges.push_back(make_pair(e[i][0], e[i][1]));
+    }
+    csr_graph<> g(8, edges, true);
+    biconnectivity<csr_graph<> > b(g);
+    // The parallel edges between 2 and 6 are not bridges.
+    assert(b.blocks() == 5 && b.cutpoints() == 3 && b.bridges().size() == 3);
+    assert(b.biconnected(0, 5) && b.biconnected(2, 6) && !b.biconnected(0, 2));
+    assert(b.two_edge_connected(2, 6) && !b.two_edge_connected(1, 2));
+    assert(b.is_cutpoint(1) && b.is_cutpoint(2) && b.is_cutpoint(5));
+  }
+  for (int n = 1; n <= 14; n++) {
+    for (int m = 0; m <= 2*n; m += 2) {
+      vector<pair<int, int> > edges;
+      for (int i = 0; i < m; i++) {
+        edges.push_back(make_pair(rand() % n, rand() % n));
+      }
+      test_biconnectivity(n, edges);
+    }
+  }
+  benchmark(MAXN, 2*MAXN);
   return 0;
 }
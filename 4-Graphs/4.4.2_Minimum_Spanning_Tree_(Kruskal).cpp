@@ -8,22 +8,58 @@ of nodes numbered with integers between 0 (inclusive) and the total number of
 nodes (exclusive), as passed in the function argument. If the input graph is not
 connected, then this implementation will find the minimum spanning forest.
 
+The following find the same minimum spanning forest for much larger graphs,
+using the concurrent disjoint set forest of section 2.6.2. Ties between equal
+weights are broken by the indices of the endpoints of each edge.
+
+- filter_kruskal(nodes, edges, mst) takes a vector of (weight, (u, v)) edges in
+  the same form as above (which it reorders) and returns the total weight of
+  the forest, whose edges are stored into mst, using the Filter-Kruskal method
+  of Osipov, Sanders, and Singler (2009). Rather than sorting every edge, the
+  edges are split around their median into a lighter and a heavier half. The
+  lighter half is processed first, recursively, after which every edge of the
+  heavier half joining two nodes already connected is discarded before the
+  heavier half is in turn processed. Ranges of at most 1024 edges are sorted
+  and scanned as in kruskal(). Processing stops as soon as the forest connects
+  every node. Edges heavier than the heaviest edge of the forest are thus
+  usually only filtered, but never sorted.
+- boruvka(g, mst) returns the total weight of the minimum spanning forest of an
+  undirected csr_graph (see section 4.1.5), or any graph type with the same
+  read-only interface, in which every edge is stored in both directions (e.g.
+  built with symmetric = true), storing its edges into mst. In each round of
+  Boruvka's algorithm, every node first finds its lightest edge leaving its
+  tree, then every tree keeps the lightest such edge of its nodes by atomic
+  compare-and-swap, and finally every tree unites with the tree across its kept
+  edge. Each round at least halves the number of trees that have any edges out,
+  and all three steps are processed in parallel if compiled with -fopenmp.
+
 Time Complexity:
 - O(m log n) per call to kruskal(), where m is the number of edges and n is the
   number of nodes.
+- O(m + n log n log(m/n)) expected per call to filter_kruskal() on graphs with
+  random weights, and O(m log m) in the worst case.
+- O((n + m) log n) per call to boruvka().
 
 Space Complexity:
 - O(max(n, m)) for storage of the graph, where n the number of nodes and m is
   the number of edges
 - O(n) auxiliary stack space for kruskal().
+- O(n) auxiliary heap space and O(log m) stack space for filter_kruskal().
+- O(n) auxiliary heap space for boruvka().
 
 */
 
 #include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
 #include <utility>
 #include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-const int MAXN = 100;
+const int MAXN = 1000000;
 std::vector<std::pair<int, std::pair<int, int> > > edges;
 int root[MAXN];
 std::vector<std::pair<int, int> > mst;
@@ -54,6 +90,384 @@ int kruskal(int nodes) {
   return total_dist;
 }
 
+class concurrent_disjoint_set_forest {
+  int num_elements, num_sets;
+  std::vector<int> root, priority;
+
+  int load(int u) const {
+    return __atomic_load_n(&root[u], __ATOMIC_ACQUIRE);
+  }
+
+  bool compare_and_swap(int u, int expected, int desired) {
+    return __atomic_compare_exchange_n(&root[u], &expected, desired, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+  }
+
+  bool before(int u, int v) const {
+    return priority[u] < priority[v];
+  }
+
+ public:
+  concurrent_disjoint_set_forest(int n)
+      : num_elements(n), num_sets(n), root(n), priority(n) {
+    for (int i = 0; i < n; i++) {
+      root[i] = priority[i] = i;
+    }
+    for (int i = n - 1; i > 0; i--) {
+      std::swap(priority[i], priority[rand() % (i + 1)]);
+    }
+  }
+
+  int size() const {
+    return num_elements;
+  }
+
+  int sets() const {
+    return __atomic_load_n(&num_sets, __ATOMIC_RELAXED);
+  }
+
+  int find_root(int u) {
+    for (;;) {
+      int p = load(u);
+      if (p == u) {
+        return u;
+      }
+      int gp = load(p);
+      if (gp != p) {
+        compare_and_swap(u, p, gp);
+      }
+      u = gp;
+    }
+  }
+
+  bool is_united(int u, int v) {
+    for (;;) {
+      u = find_root(u);
+      v = find_root(v);
+      if (u == v) {
+        return true;
+      }
+      // If u is still a root after v was found, then u and v were in different
+      // partitions at that moment.
+      if (load(u) == u) {
+        return false;
+      }
+    }
+  }
+
+  bool unite(int u, int v) {
+    for (;;) {
+      u = find_root(u);
+      v = find_root(v);
+      if (u == v) {
+        return false;
+      }
+      if (before(v, u)) {
+        std::swap(u, v);
+      }
+      if (compare_and_swap(u, u, v)) {
+        __atomic_fetch_sub(&num_sets, 1, __ATOMIC_RELAXED);
+        return true;
+      }
+    }
+  }
+};
+
+// Returns whether an edge joins two different trees of the forest so far.
+template<class E>
+struct joins_trees {
+  concurrent_disjoint_set_forest &dsf;
+
+  joins_trees(concurrent_disjoint_set_forest &dsf) : dsf(dsf) {}
+
+  bool operator()(const E &e) const {
+    return !dsf.is_united(e.second.first, e.second.second);
+  }
+};
+
+template<class E>
+void filter_kruskal(E *lo, E *hi, concurrent_disjoint_set_forest &dsf,
+                    typename E::first_type &total,
+                    std::vector<std::pair<int, int> > &mst) {
+  if (dsf.sets() == 1) {
+    return;
+  }
+  if (hi - lo <= 1024) {
+    std::sort(lo, hi);
+    for (E *e = lo; e != hi; e++) {
+      if (dsf.unite(e->second.first, e->second.second)) {
+        mst.push_back(e->second);
+        total += e->first;
+      }
+    }
+    return;
+  }
+  E *mid = lo + (hi - lo)/2;
+  std::nth_element(lo, mid, hi);
+  filter_kruskal(lo, mid, dsf, total, mst);
+  hi = std::partition(mid, hi, joins_trees<E>(dsf));
+  filter_kruskal(mid, hi, dsf, total, mst);
+}
+
+template<class W>
+W filter_kruskal(int nodes,
+                 std::vector<std::pair<W, std::pair<int, int> > > &edges,
+                 std::vector<std::pair<int, int> > &mst) {
+  mst.clear();
+  W total = 0;
+  if (!edges.empty()) {
+    concurrent_disjoint_set_forest dsf(nodes);
+    filter_kruskal(&edges[0], &edges[0] + edges.size(), dsf, total, mst);
+  }
+  return total;
+}
+
+typedef unsigned int edge_index_t;
+
+template<class W = int>
+class csr_graph {
+  int num_nodes;
+  std::vector<edge_index_t> offsets;
+  std::vector<int> targets;
+  std::vector<W> weights;
+
+  void build(const std::vector<std::pair<int, int> > &edges, const W *w,
+             bool symmetric) {
+    int n = num_nodes;
+    long long total = (long long)edges.size()*(symmetric ? 2 : 1);
+    if (total > (long long)std::numeric_limits<edge_index_t>::max()) {
+      throw std::runtime_error("Too many edges for 32-bit offsets.");
+    }
+    edge_index_t m = total, half = edges.size();
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = std::max(1, std::min(omp_get_max_threads(),
+                                       (int)(m/65536) + 1));
+#endif
+    // count[t*n + u] is the number of edges from u in chunk t, which is then
+    // replaced by the first slot of those edges within the list of u.
+    std::vector<edge_index_t> count((size_t)num_threads*n, 0);
+    offsets.assign(n + 1, 0);
+    targets.resize(m);
+    if (w != NULL) {
+      weights.resize(m);
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        c[(e < half) ? edges[e].first : edges[e - half].second]++;
+      }
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(num_threads)
+#endif
+    for (int u = 0; u < n; u++) {
+      edge_index_t sum = 0;
+      for (int t = 0; t < num_threads; t++) {
+        edge_index_t c = count[(size_t)t*n + u];
+        count[(size_t)t*n + u] = sum;
+        sum += c;
+      }
+      offsets[u + 1] = sum;
+    }
+    for (int u = 0; u < n; u++) {
+      offsets[u + 1] += offsets[u];
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        int u = edges[(e < half) ? e : e - half].first;
+        int v = edges[(e < half) ? e : e - half].second;
+        if (e >= half) {
+          std::swap(u, v);
+        }
+        edge_index_t slot = offsets[u] + c[u]++;
+        targets[slot] = v;
+        if (w != NULL) {
+          weights[slot] = w[(e < half) ? e : e - half];
+        }
+      }
+    }
+  }
+
+ public:
+  typedef W weight_type;
+
+  csr_graph() : num_nodes(0), offsets(1, 0) {}
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            bool symmetric = false) : num_nodes(nodes) {
+    build(edges, NULL, symmetric);
+  }
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            const std::vector<W> &weights, bool symmetric = false)
+      : num_nodes(nodes) {
+    if (weights.size() != edges.size()) {
+      throw std::runtime_error("Expected one weight per edge.");
+    }
+    build(edges, weights.empty() ? NULL : &weights[0], symmetric);
+  }
+
+  int nodes() const {
+    return num_nodes;
+  }
+
+  edge_index_t edges() const {
+    return offsets[num_nodes];
+  }
+
+  edge_index_t offset(int u) const {
+    return offsets[u];
+  }
+
+  int degree(int u) const {
+    return offsets[u + 1] - offsets[u];
+  }
+
+  int target(edge_index_t e) const {
+    return targets[e];
+  }
+
+  W weight(edge_index_t e) const {
+    return weights.empty() ? W(1) : weights[e];
+  }
+
+  bool is_weighted() const {
+    return !weights.empty();
+  }
+};
+
+template<class Graph>
+class boruvka_state {
+  typedef typename Graph::weight_type W;
+
+  const Graph &g;
+
+ public:
+  // choice[u] is the lightest edge out of the tree of u among those of u (or
+  // -1), and best[r] the node with the lightest choice in the tree of root r.
+  std::vector<int> comp, best;
+  std::vector<long long> choice;
+
+  boruvka_state(const Graph &g)
+      : g(g), comp(g.nodes()), best(g.nodes(), -1), choice(g.nodes(), -1) {}
+
+  // Returns whether the chosen edge of u is lighter than that of v, breaking
+  // ties by the endpoints of both edges.
+  bool lighter(int u, int v) const {
+    edge_index_t e = choice[u], f = choice[v];
+    W a = g.weight(e), b = g.weight(f);
+    if (a < b || b < a) {
+      return a < b;
+    }
+    int x = g.target(e), y = g.target(f);
+    return std::make_pair(std::min(u, x), std::max(u, x)) <
+           std::make_pair(std::min(v, y), std::max(v, y));
+  }
+
+  void choose(int u) {
+    choice[u] = -1;
+    for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+      if (comp[g.target(e)] != comp[u]) {
+        edge_index_t f = choice[u];
+        if (choice[u] == -1 || g.weight(e) < g.weight(f) ||
+            (!(g.weight(f) < g.weight(e)) && g.target(e) < g.target(f))) {
+          choice[u] = e;
+        }
+      }
+    }
+  }
+
+  // Replaces best[r] by u while the choice of u is lighter.
+  void offer(int u) {
+    int r = comp[u], v = __atomic_load_n(&best[r], __ATOMIC_RELAXED);
+    while ((v == -1 || lighter(u, v)) &&
+           !__atomic_compare_exchange_n(&best[r], &v, u, false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+  }
+};
+
+template<class Graph>
+typename Graph::weight_type boruvka(const Graph &g,
+                                    std::vector<std::pair<int, int> > &mst) {
+  typedef typename Graph::weight_type W;
+  int n = g.nodes();
+  concurrent_disjoint_set_forest dsf(n);
+  boruvka_state<Graph> s(g);
+  mst.clear();
+  W total = 0;
+  for (bool merged = true; merged;) {
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int u = 0; u < n; u++) {
+      s.comp[u] = dsf.find_root(u);
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 1024)
+#endif
+    for (int u = 0; u < n; u++) {
+      s.choose(u);
+      if (s.choice[u] != -1) {
+        s.offer(u);
+      }
+    }
+    std::vector<std::pair<int, int> > added;
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+      std::vector<std::pair<int, int> > local;
+      W local_total = 0;
+#ifdef _OPENMP
+      #pragma omp for nowait
+#endif
+      for (int r = 0; r < n; r++) {
+        int u = s.best[r];
+        if (u == -1) {
+          continue;
+        }
+        s.best[r] = -1;
+        edge_index_t e = s.choice[u];
+        // Two trees may keep the same edge, but only one unites them.
+        if (dsf.unite(u, g.target(e))) {
+          local.push_back(std::make_pair(u, g.target(e)));
+          local_total += g.weight(e);
+        }
+      }
+#ifdef _OPENMP
+      #pragma omp critical(boruvka_merge)
+#endif
+      {
+        added.insert(added.end(), local.begin(), local.end());
+        total += local_total;
+      }
+    }
+    mst.insert(mst.end(), added.begin(), added.end());
+    merged = !added.empty();
+  }
+  return total;
+}
+
 /*** Example Usage and Output:
 
 Total distance: 13
@@ -62,16 +476,105 @@ Total distance: 13
 2 <-> 0
 5 <-> 6
 0 <-> 1
+262144 nodes, 786431 edges:
+  kruskal 0.157682s, filter_kruskal 0.106303s, boruvka 0.218768s
+262144 nodes, 2359295 edges:
+  kruskal 0.37448s, filter_kruskal 0.151637s, boruvka 0.305617s
+262144 nodes, 8650751 edges:
+  kruskal 1.36193s, filter_kruskal 0.307401s, boruvka 0.802376s
 
 ***/
 
+#include <cassert>
 #include <iostream>
+#include <sys/time.h>
 using namespace std;
 
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+int rand30() {
+  return (rand() & 0x7fff) << 15 ^ (rand() & 0x7fff);
+}
+
 void add_edge(int u, int v, int w) {
   edges.push_back(make_pair(w, make_pair(u, v)));
 }
 
+typedef vector<pair<int, pair<int, int> > > edge_list;
+
+csr_graph<> make_csr(int n, const edge_list &e) {
+  vector<pair<int, int> > pairs;
+  vector<int> weights;
+  for (int i = 0; i < (int)e.size(); i++) {
+    pairs.push_back(e[i].second);
+    weights.push_back(e[i].first);
+  }
+  return csr_graph<>(n, pairs, weights, true);
+}
+
+// Checks that mst is a spanning forest of the graph with the given weight.
+void check_forest(int n, const edge_list &e,
+                  const vector<pair<int, int> > &mst, int total, int expected,
+                  int components) {
+  assert(total == expected && (int)mst.size() == n - components);
+  concurrent_disjoint_set_forest dsf(n);
+  for (int i = 0; i < (int)mst.size(); i++) {
+    assert(dsf.unite(mst[i].first, mst[i].second));
+  }
+  for (int i = 0; i < (int)e.size(); i++) {
+    assert(dsf.is_united(e[i].second.first, e[i].second.second));
+  }
+}
+
+edge_list random_edges(int n, int m, int max_weight) {
+  edge_list e;
+  for (int i = 0; i < m; i++) {
+    e.push_back(make_pair(rand() % max_weight,
+                          make_pair(rand30() % n, rand30() % n)));
+  }
+  return e;
+}
+
+void test(int n, const edge_list &e) {
+  edges = e;
+  int expected = kruskal(n), components = n - mst.size();
+  edge_list copy(e);
+  vector<pair<int, int> > res;
+  int total = filter_kruskal(n, copy, res);
+  check_forest(n, e, res, total, expected, components);
+  total = boruvka(make_csr(n, e), res);
+  check_forest(n, e, res, total, expected, components);
+}
+
+void benchmark(int n, int degree) {
+  edge_list e = random_edges(n, n*degree/2, 1000);
+  // Include a random spanning tree, so that the graph is connected.
+  for (int i = 1; i < n; i++) {
+    e.push_back(make_pair(rand() % 1000, make_pair(rand30() % i, i)));
+  }
+  csr_graph<> g = make_csr(n, e);
+  edges = e;
+  double start = wall_time();
+  int expected = kruskal(n);
+  double kruskal_time = wall_time() - start;
+  vector<pair<int, int> > res;
+  start = wall_time();
+  int total = filter_kruskal(n, e, res);
+  double filter_time = wall_time() - start;
+  assert(total == expected);
+  start = wall_time();
+  total = boruvka(g, res);
+  double boruvka_time = wall_time() - start;
+  assert(total == expected);
+  cout << n << " nodes, " << e.size() << " edges:" << endl << "  kruskal "
+       << kruskal_time << "s, filter_kruskal " << filter_time
+       << "s, boruvka " << boruvka_time << "s" << endl;
+}
+
 int main() {
   add_edge(0, 1, 4);
   add_edge(1, 2, 6);
@@ -84,5 +587,15 @@ int main() {
   for (int i = 0; i < (int)mst.size(); i++) {
     cout << mst[i].first << " <-> " << mst[i].second << endl;
   }
+
+  for (int n = 1; n <= 3000; n += (n < 30) ? 1 : 997) {
+    for (int density = 0; density <= 8; density += 2) {
+      test(n, random_edges(n, n*density, 2 + n % 5*1000));
+    }
+  }
+  int degrees[] = {4, 16, 64};
+  for (int i = 0; i < 3; i++) {
+    benchmark(1 << 18, degrees[i]);
+  }
   return 0;
 }
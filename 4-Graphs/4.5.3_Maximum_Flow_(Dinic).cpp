@@ -4,39 +4,86 @@ Given a flow network with integer capacities, find the maximum flow from a given
 source node to a given sink node. The flow of a given edge u -> v is defined as
 the minimum of its capacity and the sum of the flows of all incoming edges of u.
 dinic() applies to a global adjacency list adj[] that will be modified by the
-function call.
+function call. Capacities are 64-bit integers. Each blocking flow is found by an
+iterative search which keeps the current path from the source in an explicit
+stack, so that deep level graphs cannot overflow the call stack. The current
+edge ptr[u] of every node persists across the augmenting paths of one phase,
+and nodes found to be dead ends are removed from the level graph. If scaling is
+true, then dinic() first considers only edges with a residual capacity of at
+least delta, for delta running through the powers of two from the largest one
+not exceeding any capacity down to 1.
 
-Dinic's algorithm will also support real-valued flow capacities. As such, this
-implementation will work as intended upon changing the appropriate variables to
-doubles.
+dinic() requires integer capacities, since with or without scaling it only uses
+edges with a residual capacity of at least delta >= 1. Dinic's algorithm also
+supports real-valued capacities, for which flow_network<double> below may be
+used, as it uses every edge with a positive residual capacity.
+
+flow_network<T> holds a flow network with capacities of type T, independent of
+the globals above, so that any number of networks may be solved at once. Edges
+are stored contiguously, with edge 2i being the i-th edge added and 2i + 1 its
+reverse, so that the reverse of any edge e is e^1. The outgoing edges of every
+node are indexed in compressed sparse row form, which is rebuilt before a solve
+only if nodes or edges have been added since the last one. The flow is kept
+between solves, so that after capacities change, max_flow() resumes from the
+current flow and only needs to find the augmenting paths that were added.
+- flow_network(n) constructs a network with n nodes and no edges.
+- nodes() and edges() return the numbers of nodes and of edges (not counting
+  reverse edges).
+- add_node() adds a node, returning its index.
+- add_edge(u, v, cap) adds an edge from u to v with capacity cap, returning its
+  index e (which is even) for use with the functions below.
+- from(e), to(e), capacity(e), and flow(e) return the properties of edge e.
+- set_capacity(e, cap) changes the capacity of edge e, which must be at least
+  the current flow of e. The current flow remains valid, so the next max_flow()
+  starts from it.
+- reset() sets the flow of every edge to 0.
+- max_flow(s, t) augments the current flow to a maximum flow from s to t using
+  Dinic's algorithm, returning its value. If s or t differs from the last call,
+  the flow is reset first, since it would not be a valid flow from s to t.
+  Blocking flows are found by an iterative search, with the nodes found
+  to be dead ends removed from the level graph.
+- source_side(v) returns whether node v is on the source side of the minimum
+  cut found by the last call to max_flow(), that is, reachable from the source
+  in the residual network. It throws if max_flow() has not been called since
+  the last call to add_node() or add_edge().
 
 Time Complexity:
 - O(n^2*m) per call to dinic(), where n is the number of nodes and m is the
-  number of edges.
+  number of edges, or O(n*m*log(U)) with scaling, where U is the largest
+  capacity.
+- O(1) amortized per call to add_node(), add_edge(), and set_capacity(), and
+  O(1) per call to all other functions of flow_network except for the below.
+- O(m) per call to reset().
+- O(n^2*m) per call to max_flow(), and O(k*n*m) if the flow of the previous
+  call needs at most k more augmenting paths, plus O(n + m) if the network was
+  extended since the previous call.
 
 Space Complexity:
 - O(max(n, m)) for storage of the flow network, where n is the number of nodes
   and m is the number of edges.
-- O(n) auxiliary stack and heap space for dinic().
+- O(n) auxiliary heap space for dinic().
+- O(n + m) for storage of flow_network, including auxiliary space.
 
 */
 
 #include <algorithm>
+#include <limits>
 #include <queue>
+#include <stdexcept>
 #include <vector>
 
-struct edge { int v, rev, cap, f; };
+struct edge { int v, rev; long long cap, f; };
 
-const int MAXN = 100, INF = 0x3f3f3f3f;
+const int MAXN = 1000000;
 std::vector<edge> adj[MAXN];
-int dist[MAXN], ptr[MAXN];
+int dist[MAXN], ptr[MAXN], path[MAXN];
 
-void add_edge(int u, int v, int cap) {
+void add_edge(int u, int v, long long cap) {
   adj[u].push_back((edge){v, (int)adj[v].size(), cap, 0});
   adj[v].push_back((edge){u, (int)adj[u].size() - 1, 0, 0});
 }
 
-bool dinic_bfs(int nodes, int source, int sink) {
+bool dinic_bfs(int nodes, int source, int sink, long long delta) {
   std::fill(dist, dist + nodes, -1);
   dist[source] = 0;
   std::queue<int> q;
@@ -46,7 +93,7 @@ bool dinic_bfs(int nodes, int source, int sink) {
     q.pop();
     for (int j = 0; j < (int)adj[u].size(); j++) {
       edge &e = adj[u][j];
-      if (dist[e.v] < 0 && e.f < e.cap) {
+      if (dist[e.v] < 0 && e.cap - e.f >= delta) {
         dist[e.v] = dist[u] + 1;
         q.push(e.v);
       }
@@ -55,38 +102,402 @@ bool dinic_bfs(int nodes, int source, int sink) {
   return dist[sink] >= 0;
 }
 
-int dinic_dfs(int u, int f, int sink) {
-  if (u == sink) {
-    return f;
-  }
-  for (; ptr[u] < (int)adj[u].size(); ptr[u]++) {
-    edge &e = adj[u][ptr[u]];
-    if (dist[e.v] == dist[u] + 1 && e.f < e.cap) {
-      int flow = dinic_dfs(e.v, std::min(f, e.cap - e.f), sink);
-      if (flow > 0) {
-        e.f += flow;
-        adj[e.v][e.rev].f -= flow;
-        return flow;
+// Returns the value of a blocking flow of edges with at least delta residual
+// capacity, where path[0..len) holds the nodes of the current path.
+long long dinic_augment(int nodes, int source, int sink, long long delta) {
+  std::fill(ptr, ptr + nodes, 0);
+  long long res = 0;
+  int len = 1;
+  path[0] = source;
+  while (len > 0) {
+    int u = path[len - 1];
+    if (u == sink) {
+      long long f = std::numeric_limits<long long>::max();
+      for (int i = 0; i + 1 < len; i++) {
+        edge &e = adj[path[i]][ptr[path[i]]];
+        f = std::min(f, e.cap - e.f);
+      }
+      int back = -1;
+      for (int i = 0; i + 1 < len; i++) {
+        edge &e = adj[path[i]][ptr[path[i]]];
+        e.f += f;
+        adj[e.v][e.rev].f -= f;
+        if (back < 0 && e.cap - e.f < delta) {
+          back = i;
+        }
+      }
+      res += f;
+      // Retreat to the tail of the first edge which is now saturated.
+      len = back + 1;
+      continue;
+    }
+    for (; ptr[u] < (int)adj[u].size(); ptr[u]++) {
+      edge &e = adj[u][ptr[u]];
+      if (dist[e.v] == dist[u] + 1 && e.cap - e.f >= delta) {
+        break;
+      }
+    }
+    if (ptr[u] < (int)adj[u].size()) {
+      path[len++] = adj[u][ptr[u]].v;
+    } else {
+      dist[u] = -1;
+      if (--len > 0) {
+        ptr[path[len - 1]]++;
       }
     }
   }
-  return 0;
+  return res;
 }
 
-int dinic(int nodes, int source, int sink) {
-  int flow, max_flow = 0;
-  while (dinic_bfs(nodes, source, sink)) {
-    std::fill(ptr, ptr + nodes, 0);
-    while ((flow = dinic_dfs(source, INF, sink)) != 0) {
-      max_flow += flow;
+long long dinic(int nodes, int source, int sink, bool scaling = false) {
+  long long delta = 1, max_flow = 0;
+  if (scaling) {
+    for (int u = 0; u < nodes; u++) {
+      for (int j = 0; j < (int)adj[u].size(); j++) {
+        while (delta <= adj[u][j].cap/2) {
+          delta *= 2;
+        }
+      }
+    }
+  }
+  for (; delta > 0 && source != sink; delta /= 2) {
+    while (dinic_bfs(nodes, source, sink, delta)) {
+      max_flow += dinic_augment(nodes, source, sink, delta);
     }
   }
   return max_flow;
 }
 
-/*** Example Usage ***/
+template<class T = int>
+class flow_network {
+  struct arc {
+    int to;
+    T cap, flow;
+
+    arc(int to, const T &cap) : to(to), cap(cap), flow(0) {}
+  };
+
+  int num_nodes, source, sink;
+  bool built;
+  std::vector<arc> arcs;
+  std::vector<int> offset, out, dist, ptr, path;
+
+  T residual(int e) const {
+    return arcs[e].cap - arcs[e].flow;
+  }
+
+  void build() {
+    offset.assign(num_nodes + 1, 0);
+    for (int e = 0; e < (int)arcs.size(); e++) {
+      offset[arcs[e ^ 1].to + 1]++;
+    }
+    for (int u = 0; u < num_nodes; u++) {
+      offset[u + 1] += offset[u];
+    }
+    std::vector<int> pos(offset.begin(), offset.end() - 1);
+    out.resize(arcs.size());
+    for (int e = 0; e < (int)arcs.size(); e++) {
+      out[pos[arcs[e ^ 1].to]++] = e;
+    }
+    dist.resize(num_nodes);
+    ptr.resize(num_nodes);
+    built = true;
+  }
+
+  bool bfs() {
+    std::fill(dist.begin(), dist.end(), -1);
+    std::vector<int> &q = path;
+    q.assign(1, source);
+    dist[source] = 0;
+    for (int i = 0; i < (int)q.size() && dist[sink] < 0; i++) {
+      int u = q[i];
+      for (int j = offset[u]; j < offset[u + 1]; j++) {
+        int v = arcs[out[j]].to;
+        if (dist[v] < 0 && residual(out[j]) > 0) {
+          dist[v] = dist[u] + 1;
+          q.push_back(v);
+        }
+      }
+    }
+    return dist[sink] >= 0;
+  }
+
+  // Finds a blocking flow in the level graph, keeping the current path from
+  // the source as a stack of edges.
+  void augment() {
+    std::copy(offset.begin(), offset.end() - 1, ptr.begin());
+    path.clear();
+    int u = source;
+    for (;;) {
+      if (u == sink) {
+        T f = residual(path[0]);
+        for (int i = 1; i < (int)path.size(); i++) {
+          f = std::min(f, residual(path[i]));
+        }
+        int back = -1;
+        for (int i = 0; i < (int)path.size(); i++) {
+          arcs[path[i]].flow += f;
+          arcs[path[i] ^ 1].flow -= f;
+          if (back < 0 && residual(path[i]) == 0) {
+            back = i;
+          }
+        }
+        // Retreat to the tail of the first edge which is now saturated.
+        path.resize(back);
+        u = path.empty() ? source : arcs[path.back()].to;
+        continue;
+      }
+      for (; ptr[u] < offset[u + 1]; ptr[u]++) {
+        int e = out[ptr[u]];
+        if (dist[arcs[e].to] == dist[u] + 1 && residual(e) > 0) {
+          break;
+        }
+      }
+      if (ptr[u] < offset[u + 1]) {
+        path.push_back(out[ptr[u]]);
+        u = arcs[path.back()].to;
+      } else if (u == source) {
+        break;
+      } else {
+        dist[u] = -1;
+        path.pop_back();
+        u = path.empty() ? source : arcs[path.back()].to;
+      }
+    }
+  }
+
+ public:
+  flow_network(int nodes = 0)
+      : num_nodes(nodes), source(-1), sink(-1), built(false) {}
+
+  int nodes() const {
+    return num_nodes;
+  }
+
+  int edges() const {
+    return arcs.size()/2;
+  }
+
+  int add_node() {
+    built = false;
+    return num_nodes++;
+  }
+
+  int add_edge(int u, int v, const T &cap) {
+    built = false;
+    arcs.push_back(arc(v, cap));
+    arcs.push_back(arc(u, 0));
+    return arcs.size() - 2;
+  }
+
+  int from(int e) const {
+    return arcs[e ^ 1].to;
+  }
+
+  int to(int e) const {
+    return arcs[e].to;
+  }
+
+  T capacity(int e) const {
+    return arcs[e].cap;
+  }
+
+  T flow(int e) const {
+    return arcs[e].flow;
+  }
+
+  void set_capacity(int e, const T &cap) {
+    if (cap < arcs[e].flow) {
+      throw std::runtime_error("Capacity is less than the current flow.");
+    }
+    arcs[e].cap = cap;
+  }
+
+  void reset() {
+    for (int e = 0; e < (int)arcs.size(); e++) {
+      arcs[e].flow = 0;
+    }
+  }
+
+  T max_flow(int s, int t) {
+    if (!built) {
+      build();
+    }
+    if (s != source || t != sink) {
+      reset();
+      source = s;
+      sink = t;
+    }
+    if (s != t) {
+      while (bfs()) {
+        augment();
+      }
+    }
+    T res = 0;
+    for (int j = offset[s]; j < offset[s + 1]; j++) {
+      res += arcs[out[j]].flow;
+    }
+    return res;
+  }
+
+  bool source_side(int v) const {
+    if (!built) {
+      throw std::runtime_error("Cannot get the minimum cut before max_flow().");
+    }
+    return dist[v] >= 0;
+  }
+};
+
+/*** Example Usage and Output:
+
+Maximum flow: 5
+Maximum flow after increasing capacities: 6
+Source side of the minimum cut: 0
+dinic() on a strip of 200000 nodes and width 100:
+  plain 4.53342s, scaling 0.516467s
+dinic() on a strip of 1000000 nodes and width 1000:
+  plain 4.03046s, scaling 6.4841s
+100 re-solves of 5000 nodes and 25000 edges:
+  from zero flow 0.434895s, warm start 4.50611e-05s
+
+***/
 
 #include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sys/time.h>
+using namespace std;
+
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+// Checks capacities, conservation, and that the minimum cut matches the flow.
+template<class T>
+void check_flow(const flow_network<T> &g, int s, int t, T value) {
+  vector<T> net(g.nodes(), 0);
+  T cut = 0;
+  for (int e = 0; e < 2*g.edges(); e += 2) {
+    assert(0 <= g.flow(e) && g.flow(e) <= g.capacity(e));
+    net[g.from(e)] -= g.flow(e);
+    net[g.to(e)] += g.flow(e);
+    if (g.source_side(g.from(e)) && !g.source_side(g.to(e))) {
+      cut += g.capacity(e);
+      assert(g.flow(e) == g.capacity(e));
+    }
+  }
+  for (int v = 0; v < g.nodes(); v++) {
+    assert(v == s || v == t || net[v] == 0);
+  }
+  assert(net[t] == value && cut == value);
+  assert(g.source_side(s) && !g.source_side(t));
+}
+
+void reset_adj(int nodes) {
+  for (int u = 0; u < nodes; u++) {
+    for (int j = 0; j < (int)adj[u].size(); j++) {
+      adj[u][j].f = 0;
+    }
+  }
+}
+
+void test_random(int n, int m) {
+  for (int i = 0; i < n; i++) {
+    adj[i].clear();
+  }
+  flow_network<> g(n);
+  vector<int> ids;
+  for (int i = 0; i < m; i++) {
+    int u = rand() % n, v = rand() % n, cap = rand() % 20;
+    add_edge(u, v, cap);
+    ids.push_back(g.add_edge(u, v, cap));
+  }
+  int s = 0, t = n - 1, expected = dinic(n, s, t), value = g.max_flow(s, t);
+  assert(value == expected);
+  reset_adj(n);
+  assert(dinic(n, s, t, true) == expected);
+  check_flow(g, s, t, value);
+  // Increase some capacities, then compare a warm start with a fresh solve.
+  for (int k = 0; k < 5; k++) {
+    for (int i = 0; i < m/4; i++) {
+      int e = ids[rand() % m];
+      g.set_capacity(e, g.capacity(e) + rand() % 10);
+    }
+    flow_network<> fresh(g);
+    fresh.reset();
+    value = g.max_flow(s, t);
+    assert(value == fresh.max_flow(s, t));
+    check_flow(g, s, t, value);
+  }
+  if (n > 2) {
+    value = g.max_flow(s, 1);
+    check_flow(g, s, 1, value);
+  }
+}
+
+// A transport network of n nodes in a long strip of the given width, where
+// every node has edges to a few random nodes of the next columns, so that the
+// level graphs are about n/width deep.
+void build_strip(int n, int width) {
+  for (int u = 0; u < n; u++) {
+    adj[u].clear();
+  }
+  for (int u = 0; u + width < n; u++) {
+    for (int k = 0; k < 3; k++) {
+      int v = min(n - 1, u + width - u % width + rand() % (2*width));
+      long long cap = (long long)(rand() % 1000 + 1) << (rand() % 24);
+      add_edge(u, v, cap);
+    }
+  }
+  for (int i = 0; i < width; i++) {
+    add_edge(n - 1 - i, n - 1, 1LL << 40);
+  }
+}
+
+void benchmark_strip(int n, int width) {
+  build_strip(n, width);
+  double start = wall_time();
+  long long value = dinic(n, 0, n - 1);
+  double plain_time = wall_time() - start;
+  reset_adj(n);
+  start = wall_time();
+  assert(dinic(n, 0, n - 1, true) == value);
+  double scaling_time = wall_time() - start;
+  cout << "dinic() on a strip of " << n << " nodes and width " << width
+       << ":" << endl << "  plain " << plain_time << "s, scaling "
+       << scaling_time << "s" << endl;
+}
+
+void benchmark(int n, int m, int rounds) {
+  flow_network<long long> g(n);
+  vector<int> ids;
+  // Layers from the source to the sink, as in a scheduling network.
+  for (int i = 0; i < m; i++) {
+    int u = rand() % (n - 1), v = u + 1 + rand() % min(n - 1 - u, 64);
+    ids.push_back(g.add_edge(u, v, rand() % 1000));
+  }
+  g.max_flow(0, n - 1);
+  double warm_time = 0, cold_time = 0;
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < 4; i++) {
+      int e = ids[rand() % m];
+      g.set_capacity(e, g.capacity(e) + rand() % 100);
+    }
+    flow_network<long long> cold(g);
+    double start = wall_time();
+    long long value = g.max_flow(0, n - 1);
+    warm_time += wall_time() - start;
+    start = wall_time();
+    cold.reset();
+    assert(cold.max_flow(0, n - 1) == value);
+    cold_time += wall_time() - start;
+  }
+  cout << rounds << " re-solves of " << n << " nodes and " << m << " edges:"
+       << endl << "  from zero flow " << cold_time << "s, warm start "
+       << warm_time << "s" << endl;
+}
 
 int main() {
   add_edge(0, 1, 3);
@@ -98,5 +509,65 @@ int main() {
   add_edge(3, 5, 2);
   add_edge(4, 5, 3);
   assert(dinic(6, 0, 5) == 5);
+
+  flow_network<> g(6);
+  g.add_edge(0, 1, 3);
+  g.add_edge(0, 2, 3);
+  g.add_edge(1, 2, 2);
+  g.add_edge(1, 3, 3);
+  int e = g.add_edge(2, 4, 2);
+  g.add_edge(3, 4, 1);
+  g.add_edge(3, 5, 2);
+  int f = g.add_edge(4, 5, 3);
+  cout << "Maximum flow: " << g.max_flow(0, 5) << endl;
+  g.set_capacity(f, 4);
+  g.set_capacity(e, 3);
+  int value = g.max_flow(0, 5);
+  cout << "Maximum flow after increasing capacities: " << value << endl;
+  cout << "Source side of the minimum cut:";
+  for (int v = 0; v < g.nodes(); v++) {
+    if (g.source_side(v)) {
+      cout << " " << v;
+    }
+  }
+  cout << endl;
+  assert(value == 6);
+  check_flow(g, 0, 5, value);
+  g.add_edge(5, 0, 1);
+  bool thrown = false;
+  try {
+    g.source_side(0);
+  } catch (std::runtime_error &) {
+    thrown = true;
+  }
+  assert(thrown && g.max_flow(0, 5) == 6 && g.source_side(0));
+
+  // Capacities below 1, which dinic() would never augment.
+  flow_network<double> r(4);
+  r.add_edge(0, 1, 0.5);
+  r.add_edge(0, 2, 0.25);
+  r.add_edge(1, 2, 0.125);
+  r.add_edge(1, 3, 0.25);
+  r.add_edge(2, 3, 0.75);
+  assert(r.max_flow(0, 3) == 0.625);
+  check_flow(r, 0, 3, 0.625);
+
+  for (int n = 2; n <= 100; n += 7) {
+    test_random(n, 2*n);
+    test_random(n, 6*n);
+  }
+  // A path of MAXN nodes is as deep as a level graph can be.
+  for (int u = 0; u < MAXN; u++) {
+    adj[u].clear();
+  }
+  for (int u = 0; u + 1 < MAXN; u++) {
+    add_edge(u, u + 1, (1LL << 40) + u % 7);
+  }
+  assert(dinic(MAXN, 0, MAXN - 1) == 1LL << 40);
+  reset_adj(MAXN);
+  assert(dinic(MAXN, 0, MAXN - 1, true) == 1LL << 40);
+  benchmark_strip(200000, 100);
+  benchmark_strip(MAXN, 1000);
+  benchmark(5000, 25000, 100);
   return 0;
 }
@@ -0,0 +1,664 @@
+/*
+
+Given a flow network where every edge has an integer capacity and a cost per
+unit of flow, find a maximum flow from a given source node to a given sink node
+whose total cost (the sum over every edge of its flow times its cost) is
+minimal. Assignment and transportation problems reduce to this by connecting
+the source to every supply node and every demand node to the sink.
+
+min_cost_flow<F, C> holds a network with capacities of type F and costs of type
+C. Edges are stored contiguously, with edge 2i being the i-th edge added and
+2i + 1 its reverse, whose cost is the negation of the cost of edge 2i. The
+outgoing edges of every node are indexed in compressed sparse row form.
+- min_cost_flow(n) constructs a network with n nodes and no edges.
+- nodes(), edges(), add_edge(u, v, cap, cost), from(e), to(e), capacity(e),
+  cost(e), and flow(e) behave as for the flow_network of section 4.5.3, with
+  add_edge() also taking the cost of the new edge, which may be negative.
+- successive_shortest_paths(s, t, limit) sends up to limit units of flow from s
+  to t (as many as possible if limit is omitted), returning the amount of flow
+  sent and its minimum cost as a pair. Flow is always augmented along a
+  shortest path in the residual network by cost. Initial node potentials that
+  make every reduced cost c(u, v) + p(u) - p(v) nonnegative are found by the
+  Bellman-Ford algorithm (only if some cost is negative), then every shortest
+  path is found by Dijkstra's algorithm on reduced costs with the dary_heap of
+  section 4.2.2. Each search adds its distances to the potentials, which keeps
+  the reduced costs of all residual edges nonnegative. An exception is thrown
+  if the network has a cycle of negative cost.
+- cost_scaling(s, t, alpha) returns the same pair for a maximum flow using the
+  cost scaling algorithm of Goldberg and Tarjan (1990), which is faster for
+  large networks, and allows cycles of negative cost. A maximum flow is first
+  found by Dinic's algorithm, then turned into one of minimum cost by
+  refinements, each of which takes a flow which is eps-optimal (with no
+  residual edge of reduced cost below -eps) and makes it (eps/alpha)-optimal.
+  A refinement saturates every residual edge of negative reduced cost, then
+  restores the balance of every node by push-relabel, where pushes go along
+  residual edges of negative reduced cost and relabels lower potentials. With
+  costs multiplied by n + 1, a 1-optimal flow is of minimum cost. alpha
+  defaults to 8.
+
+Time Complexity:
+- O(1) amortized per call to add_edge(), and O(1) per call to all other
+  functions except for the solvers below.
+- O(n*m + k*m log n) per call to successive_shortest_paths(), where n is the
+  number of nodes, m is the number of edges, and k is the number of augmenting
+  paths, which is at most the amount of flow sent. The O(n*m) term for the
+  Bellman-Ford algorithm only applies if some cost is negative.
+- O(n^2*m log(n*C)) per call to cost_scaling(), where C is the largest absolute
+  value of a cost, and usually far faster in practice.
+
+Space Complexity:
+- O(n + m) for storage of the network, including auxiliary space.
+
+*/
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// An indexed d-ary heap holding each node at most once, with decrease-key.
+template<class K, int D = 4>
+class dary_heap {
+  typedef std::pair<K, int> entry;
+  std::vector<entry> heap;
+  std::vector<int> pos;
+
+  void place(int i, const entry &e) {
+    heap[i] = e;
+    pos[e.second] = i;
+  }
+
+  void sift_up(int i, entry e) {
+    while (i > 0 && e.first < heap[(i - 1)/D].first) {
+      place(i, heap[(i - 1)/D]);
+      i = (i - 1)/D;
+    }
+    place(i, e);
+  }
+
+  void sift_down(int i, const entry &e) {
+    int n = heap.size();
+    for (;;) {
+      int lo = D*i + 1, best = lo;
+      if (lo >= n) {
+        break;
+      }
+      for (int c = lo + 1; c < lo + D && c < n; c++) {
+        if (heap[c].first < heap[best].first) {
+          best = c;
+        }
+      }
+      if (!(heap[best].first < e.first)) {
+        break;
+      }
+      place(i, heap[best]);
+      i = best;
+    }
+    place(i, e);
+  }
+
+ public:
+  explicit dary_heap(int nodes = 0) : pos(nodes, -1) {}
+
+  bool empty() const {
+    return heap.empty();
+  }
+
+  const entry &top() const {
+    return heap[0];
+  }
+
+  // Inserts v, or decreases its key if it is in the heap with a larger key.
+  void push(int v, const K &key) {
+    if (pos[v] < 0) {
+      heap.push_back(entry(key, v));
+      sift_up(heap.size() - 1, heap.back());
+    } else if (key < heap[pos[v]].first) {
+      sift_up(pos[v], entry(key, v));
+    }
+  }
+
+  entry pop() {
+    entry res = heap[0];
+    pos[res.second] = -1;
+    entry e = heap.back();
+    heap.pop_back();
+    if (!heap.empty()) {
+      sift_down(0, e);
+    }
+    return res;
+  }
+
+  // Empties the heap in time proportional to its size rather than the nodes.
+  void clear() {
+    for (int i = 0; i < (int)heap.size(); i++) {
+      pos[heap[i].second] = -1;
+    }
+    heap.clear();
+  }
+};
+
+template<class F = long long, class C = long long>
+class min_cost_flow {
+  struct arc {
+    int to;
+    F cap, flow;
+    C cost;
+
+    arc(int to, const F &cap, const C &cost)
+        : to(to), cap(cap), flow(0), cost(cost) {}
+  };
+
+  int num_nodes;
+  bool built;
+  std::vector<arc> arcs;
+  std::vector<int> offset, out, dist, ptr, path;
+  std::vector<C> potential;
+  std::vector<F> excess;
+
+  F residual(int e) const {
+    return arcs[e].cap - arcs[e].flow;
+  }
+
+  void build() {
+    offset.assign(num_nodes + 1, 0);
+    for (int e = 0; e < (int)arcs.size(); e++) {
+      offset[arcs[e ^ 1].to + 1]++;
+    }
+    for (int u = 0; u < num_nodes; u++) {
+      offset[u + 1] += offset[u];
+    }
+    std::vector<int> pos(offset.begin(), offset.end() - 1);
+    out.resize(arcs.size());
+    for (int e = 0; e < (int)arcs.size(); e++) {
+      out[pos[arcs[e ^ 1].to]++] = e;
+    }
+    dist.resize(num_nodes);
+    ptr.resize(num_nodes);
+    built = true;
+  }
+
+  void reset() {
+    if (!built) {
+      build();
+    }
+    for (int e = 0; e < (int)arcs.size(); e++) {
+      arcs[e].flow = 0;
+    }
+  }
+
+  void push(int e, const F &d) {
+    arcs[e].flow += d;
+    arcs[e ^ 1].flow -= d;
+  }
+
+  C total_cost() const {
+    C res = 0;
+    for (int e = 0; e < (int)arcs.size(); e += 2) {
+      res += arcs[e].flow*arcs[e].cost;
+    }
+    return res;
+  }
+
+  // Sets potentials to the shortest distances from a virtual node with an
+  // edge of cost 0 to every node, by the Bellman-Ford algorithm with a queue.
+  void initial_potentials() {
+    int n = num_nodes;
+    potential.assign(n, 0);
+    std::vector<int> q, length(n, 0);
+    std::vector<bool> queued(n, true);
+    for (int u = 0; u < n; u++) {
+      q.push_back(u);
+    }
+    for (int i = 0; i < (int)q.size(); i++) {
+      int u = q[i];
+      queued[u] = false;
+      for (int j = offset[u]; j < offset[u + 1]; j++) {
+        int e = out[j], v = arcs[e].to;
+        if (residual(e) > 0 && potential[u] + arcs[e].cost < potential[v]) {
+          potential[v] = potential[u] + arcs[e].cost;
+          if ((length[v] = length[u] + 1) >= n) {
+            throw std::runtime_error("Negative cost cycle found.");
+          }
+          if (!queued[v]) {
+            queued[v] = true;
+            q.push_back(v);
+          }
+        }
+      }
+    }
+  }
+
+  // Dinic's algorithm as in section 4.5.3, returning the value of a maximum
+  // flow from s to t.
+  F max_flow(int s, int t) {
+    F res = 0;
+    for (;;) {
+      std::fill(dist.begin(), dist.end(), -1);
+      path.assign(1, s);
+      dist[s] = 0;
+      for (int i = 0; i < (int)path.size() && dist[t] < 0; i++) {
+        int u = path[i];
+        for (int j = offset[u]; j < offset[u + 1]; j++) {
+          int v = arcs[out[j]].to;
+          if (dist[v] < 0 && residual(out[j]) > 0) {
+            dist[v] = dist[u] + 1;
+            path.push_back(v);
+          }
+        }
+      }
+      if (dist[t] < 0) {
+        return res;
+      }
+      std::copy(offset.begin(), offset.end() - 1, ptr.begin());
+      path.clear();
+      for (int u = s;;) {
+        if (u == t) {
+          F f = residual(path[0]);
+          for (int i = 1; i < (int)path.size(); i++) {
+            f = std::min(f, residual(path[i]));
+          }
+          int back = -1;
+          for (int i = 0; i < (int)path.size(); i++) {
+            push(path[i], f);
+            if (back < 0 && residual(path[i]) == 0) {
+              back = i;
+            }
+          }
+          res += f;
+          path.resize(back);
+          u = path.empty() ? s : arcs[path.back()].to;
+          continue;
+        }
+        for (; ptr[u] < offset[u + 1]; ptr[u]++) {
+          int e = out[ptr[u]];
+          if (dist[arcs[e].to] == dist[u] + 1 && residual(e) > 0) {
+            break;
+          }
+        }
+        if (ptr[u] < offset[u + 1]) {
+          path.push_back(out[ptr[u]]);
+          u = arcs[path.back()].to;
+        } else if (u == s) {
+          break;
+        } else {
+          dist[u] = -1;
+          path.pop_back();
+          u = path.empty() ? s : arcs[path.back()].to;
+        }
+      }
+    }
+  }
+
+  // Makes an eps*alpha-optimal flow eps-optimal with respect to the scaled
+  // costs c, where potentials only ever decrease.
+  void refine(const std::vector<C> &c, const C &eps) {
+    std::vector<C> &p = potential;
+    excess.assign(num_nodes, 0);
+    for (int u = 0; u < num_nodes; u++) {
+      for (int j = offset[u]; j < offset[u + 1]; j++) {
+        int e = out[j];
+        F r = residual(e);
+        if (r > 0 && c[e] + p[u] - p[arcs[e].to] < 0) {
+          push(e, r);
+          excess[u] -= r;
+          excess[arcs[e].to] += r;
+        }
+      }
+    }
+    std::vector<int> &q = path;
+    q.clear();
+    for (int u = 0; u < num_nodes; u++) {
+      if (excess[u] > 0) {
+        q.push_back(u);
+      }
+    }
+    std::copy(offset.begin(), offset.end() - 1, ptr.begin());
+    // The queue is a ring buffer, since each node is in it at most once.
+    for (int head = 0, size = q.size(); size > 0; size--) {
+      int u = q[head];
+      head = (head + 1 == num_nodes) ? 0 : head + 1;
+      while (excess[u] > 0) {
+        if (ptr[u] == offset[u + 1]) {
+          C best = -std::numeric_limits<C>::max();
+          for (int j = offset[u]; j < offset[u + 1]; j++) {
+            int e = out[j];
+            if (residual(e) > 0) {
+              best = std::max(best, p[arcs[e].to] - c[e]);
+            }
+          }
+          p[u] = best - eps;
+          ptr[u] = offset[u];
+          continue;
+        }
+        int e = out[ptr[u]], v = arcs[e].to;
+        F r = residual(e);
+        if (r > 0 && c[e] + p[u] - p[v] < 0) {
+          F d = std::min(excess[u], r);
+          push(e, d);
+          excess[u] -= d;
+          if (excess[v] <= 0 && excess[v] + d > 0) {
+            if ((int)q.size() < num_nodes) {
+              q.push_back(v);
+            } else {
+              q[(head + size - 1) % num_nodes] = v;
+            }
+            size++;
+          }
+          excess[v] += d;
+        } else {
+          ptr[u]++;
+        }
+      }
+    }
+  }
+
+ public:
+  min_cost_flow(int nodes = 0) : num_nodes(nodes), built(false) {}
+
+  int nodes() const {
+    return num_nodes;
+  }
+
+  int edges() const {
+    return arcs.size()/2;
+  }
+
+  int add_edge(int u, int v, const F &cap, const C &cost) {
+    built = false;
+    arcs.push_back(arc(v, cap, cost));
+    arcs.push_back(arc(u, 0, -cost));
+    return arcs.size() - 2;
+  }
+
+  int from(int e) const {
+    return arcs[e ^ 1].to;
+  }
+
+  int to(int e) const {
+    return arcs[e].to;
+  }
+
+  F capacity(int e) const {
+    return arcs[e].cap;
+  }
+
+  C cost(int e) const {
+    return arcs[e].cost;
+  }
+
+  F flow(int e) const {
+    return arcs[e].flow;
+  }
+
+  std::pair<F, C> successive_shortest_paths(
+      int s, int t, F limit = std::numeric_limits<F>::max()) {
+    reset();
+    potential.assign(num_nodes, 0);
+    for (int e = 0; e < (int)arcs.size(); e += 2) {
+      if (arcs[e].cost < 0 && arcs[e].cap > 0) {
+        initial_potentials();
+        break;
+      }
+    }
+    const C inf = std::numeric_limits<C>::max();
+    std::vector<C> d(num_nodes);
+    std::vector<int> &pred = ptr;
+    dary_heap<C> q(num_nodes);
+    F value = 0;
+    while (value < limit && s != t) {
+      std::fill(d.begin(), d.end(), inf);
+      d[s] = 0;
+      q.push(s, C(0));
+      while (!q.empty()) {
+        int u = q.pop().second;
+        for (int j = offset[u]; j < offset[u + 1]; j++) {
+          int e = out[j], v = arcs[e].to;
+          if (residual(e) > 0) {
+            C dv = d[u] + arcs[e].cost + potential[u] - potential[v];
+            if (dv < d[v]) {
+              d[v] = dv;
+              pred[v] = e;
+              q.push(v, dv);
+            }
+          }
+        }
+      }
+      if (d[t] == inf) {
+        break;
+      }
+      for (int u = 0; u < num_nodes; u++) {
+        if (d[u] < inf) {
+          potential[u] += d[u];
+        }
+      }
+      F f = limit - value;
+      for (int v = t; v != s; v = arcs[pred[v] ^ 1].to) {
+        f = std::min(f, residual(pred[v]));
+      }
+      for (int v = t; v != s; v = arcs[pred[v] ^ 1].to) {
+        push(pred[v], f);
+      }
+      value += f;
+    }
+    return std::make_pair(value, total_cost());
+  }
+
+  std::pair<F, C> cost_scaling(int s, int t, int alpha = 8) {
+    reset();
+    F value = (s == t) ? 0 : max_flow(s, t);
+    std::vector<C> c(arcs.size());
+    C eps = 0;
+    for (int e = 0; e < (int)arcs.size(); e++) {
+      c[e] = arcs[e].cost*(num_nodes + 1);
+      eps = std::max(eps, c[e]);
+    }
+    potential.assign(num_nodes, 0);
+    while (eps > 1) {
+      eps = std::max(eps/alpha, C(1));
+      refine(c, eps);
+    }
+    return std::make_pair(value, total_cost());
+  }
+};
+
+/*** Example Usage and Output:
+
+Flow 5 at minimum cost 25:
+  0 -> 1: 3/3 at cost 1
+  0 -> 2: 2/2 at cost 4
+  1 -> 2: 1/2 at cost 1
+  1 -> 3: 2/2 at cost 5
+  2 -> 3: 3/3 at cost 1
+transportation with 2002 nodes and 22000 edges, flow 477831 at cost 718307231:
+  successive_shortest_paths() 2.37797s, cost_scaling() 0.140576s
+assignment with 602 nodes and 90600 edges, flow 300 at cost 1636027:
+  successive_shortest_paths() 0.278827s, cost_scaling() 0.0851619s
+
+***/
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sys/time.h>
+using namespace std;
+
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+int rand30() {
+  return (rand() & 0x7fff) << 15 | (rand() & 0x7fff);
+}
+
+// Checks that the flow is valid with the given value and cost, has no
+// augmenting path left, and has no residual cycle of negative cost.
+void check(const min_cost_flow<> &g, int s, int t, pair<long long, long long> r,
+           bool maximum) {
+  int n = g.nodes();
+  vector<long long> net(n, 0);
+  long long cost = 0;
+  for (int e = 0; e < 2*g.edges(); e += 2) {
+    assert(0 <= g.flow(e) && g.flow(e) <= g.capacity(e));
+    net[g.from(e)] -= g.flow(e);
+    net[g.to(e)] += g.flow(e);
+    cost += g.flow(e)*g.cost(e);
+  }
+  for (int v = 0; v < n; v++) {
+    assert(v == s || v == t || net[v] == 0);
+  }
+  assert(s == t || net[t] == r.first);
+  assert(cost == r.second);
+  // Bellman-Ford on the residual network from a virtual node, which settles
+  // within n rounds unless some cycle has negative cost.
+  vector<long long> d(n, 0);
+  vector<bool> seen(n, false);
+  seen[s] = true;
+  for (int round = 0; round <= n; round++) {
+    bool changed = false;
+    for (int e = 0; e < 2*g.edges(); e++) {
+      int u = g.from(e), v = g.to(e);
+      if (g.capacity(e) - g.flow(e) > 0) {
+        if (d[u] + g.cost(e) < d[v]) {
+          d[v] = d[u] + g.cost(e);
+          changed = true;
+        }
+        if (seen[u] && !seen[v]) {
+          seen[v] = changed = true;
+        }
+      }
+    }
+    if (!changed) {
+      break;
+    }
+    assert(round < n);
+  }
+  assert(!maximum || s == t || !seen[t]);
+}
+
+void test_random(int n, int m, bool negative) {
+  min_cost_flow<> g(n);
+  vector<long long> p(n);
+  for (int i = 0; i < n; i++) {
+    p[i] = negative ? rand() % 100 : 0;
+  }
+  // Costs are reduced costs under the potentials p, so no cycle is negative.
+  for (int i = 0; i < m; i++) {
+    int u = rand() % n, v = rand() % n;
+    g.add_edge(u, v, rand() % 20, rand() % 100 - p[u] + p[v]);
+  }
+  int s = rand() % n, t = rand() % n;
+  pair<long long, long long> r1 = g.successive_shortest_paths(s, t);
+  check(g, s, t, r1, true);
+  pair<long long, long long> r2 = g.cost_scaling(s, t, 2 + rand() % 15);
+  check(g, s, t, r2, true);
+  assert(r1 == r2);
+  long long limit = r1.first/2;
+  pair<long long, long long> r3 = g.successive_shortest_paths(s, t, limit);
+  check(g, s, t, r3, false);
+  assert(r3.first == limit);
+  // With arbitrary negative costs, cycles of negative cost carry flow too.
+  min_cost_flow<> h(n);
+  for (int i = 0; i < m; i++) {
+    h.add_edge(rand() % n, rand() % n, rand() % 20, rand() % 100 - 50);
+  }
+  check(h, s, t, h.cost_scaling(s, t), true);
+}
+
+// Compares with trying every assignment of n workers to n jobs.
+void test_assignment(int n) {
+  vector<vector<long long> > cost(n, vector<long long>(n));
+  min_cost_flow<> g(2*n + 2);
+  for (int i = 0; i < n; i++) {
+    g.add_edge(2*n, i, 1, 0);
+    g.add_edge(n + i, 2*n + 1, 1, 0);
+    for (int j = 0; j < n; j++) {
+      cost[i][j] = rand() % 1000 - 500;
+      g.add_edge(i, n + j, 1, cost[i][j]);
+    }
+  }
+  vector<int> perm(n);
+  for (int i = 0; i < n; i++) {
+    perm[i] = i;
+  }
+  long long best = numeric_limits<long long>::max();
+  do {
+    long long sum = 0;
+    for (int i = 0; i < n; i++) {
+      sum += cost[i][perm[i]];
+    }
+    best = min(best, sum);
+  } while (next_permutation(perm.begin(), perm.end()));
+  assert(g.successive_shortest_paths(2*n, 2*n + 1) == make_pair((long long)n,
+                                                                 best));
+  assert(g.cost_scaling(2*n, 2*n + 1) == make_pair((long long)n, best));
+}
+
+void benchmark(const char *name, min_cost_flow<> &g, int s, int t) {
+  double start = wall_time();
+  pair<long long, long long> r1 = g.successive_shortest_paths(s, t);
+  double ssp_time = wall_time() - start;
+  start = wall_time();
+  pair<long long, long long> r2 = g.cost_scaling(s, t);
+  double scaling_time = wall_time() - start;
+  assert(r1 == r2);
+  cout << name << " with " << g.nodes() << " nodes and " << g.edges()
+       << " edges, flow " << r1.first << " at cost " << r1.second << ":"
+       << endl << "  successive_shortest_paths() " << ssp_time
+       << "s, cost_scaling() " << scaling_time << "s" << endl;
+}
+
+int main() {
+  min_cost_flow<> g(4);
+  g.add_edge(0, 1, 3, 1);
+  g.add_edge(0, 2, 2, 4);
+  g.add_edge(1, 2, 2, 1);
+  g.add_edge(1, 3, 2, 5);
+  g.add_edge(2, 3, 3, 1);
+  pair<long long, long long> r = g.successive_shortest_paths(0, 3);
+  cout << "Flow " << r.first << " at minimum cost " << r.second << ":" << endl;
+  for (int e = 0; e < 2*g.edges(); e += 2) {
+    cout << "  " << g.from(e) << " -> " << g.to(e) << ": " << g.flow(e)
+         << "/" << g.capacity(e) << " at cost " << g.cost(e) << endl;
+  }
+  assert(r == make_pair(5LL, 25LL));
+  assert(g.cost_scaling(0, 3) == r);
+  assert(g.successive_shortest_paths(0, 3, 2) == make_pair(2LL, 6LL));
+
+  for (int n = 1; n <= 40; n++) {
+    test_random(n, 3*n, n % 2 == 0);
+    test_random(n, 10*n, n % 3 == 0);
+  }
+  for (int n = 1; n <= 7; n++) {
+    for (int k = 0; k < 5; k++) {
+      test_assignment(n);
+    }
+  }
+
+  // Transportation from 1000 suppliers to 1000 customers.
+  int n = 1000;
+  min_cost_flow<> transport(2*n + 2);
+  for (int i = 0; i < n; i++) {
+    transport.add_edge(2*n, i, 1 + rand() % 1000, 0);
+    transport.add_edge(n + i, 2*n + 1, 1 + rand() % 1000, 0);
+    for (int k = 0; k < 20; k++) {
+      transport.add_edge(i, n + rand() % n, 1 + rand() % 500, rand30() % 10000);
+    }
+  }
+  benchmark("transportation", transport, 2*n, 2*n + 1);
+  // Dense assignment of 300 workers to 300 jobs.
+  n = 300;
+  min_cost_flow<> assignment(2*n + 2);
+  for (int i = 0; i < n; i++) {
+    assignment.add_edge(2*n, i, 1, 0);
+    assignment.add_edge(n + i, 2*n + 1, 1, 0);
+    for (int j = 0; j < n; j++) {
+      assignment.add_edge(i, n + j, 1, rand30() % 1000000);
+    }
+  }
+  benchmark("assignment", assignment, 2*n, 2*n + 1);
+  return 0;
+}
@@ -6,20 +6,57 @@ applies to a global, pre-populated adjacency list adj[] which must only consist
 of nodes numbered with integers between 0 (inclusive) and the total number of
 nodes (exclusive), as passed in the function argument.
 
+For large graphs, the following operates on a symmetric csr_graph (see section
+4.1.5), or any graph type with the same read-only interface.
+
+- maximum_matching(g, match) computes a maximum matching, returning its size
+  and setting match[u] to the node matched to u, or -1 if u is unmatched.
+  Nodes are first matched greedily in order of increasing degree. Then from
+  every free node, a breadth-first search grows an alternating tree, shrinking
+  blossoms with a disjoint-set forest over their bases instead of relabeling
+  every node, and finding lowest common ancestors by walking up both paths
+  with timestamps. A search only resets the nodes it reached, and if it finds
+  no augmenting path, then its tree is Hungarian, so that its nodes are never
+  visited again by any later search.
+
+maximum_weight_matching finds a matching of maximum total weight in a graph
+with positive integer edge weights (not necessarily of maximum size), by the
+primal-dual blossom algorithm of Edmonds with a dense n by n edge matrix, where
+blossoms are contracted into new nodes with dual variables.
+- maximum_weight_matching(n) constructs a graph with n nodes and no edges.
+- add_edge(u, v, w) adds an undirected edge of weight w > 0, keeping the larger
+  weight of parallel edges.
+- solve() returns the maximum total weight of a matching.
+- mate(u) returns the node matched to u by the last call to solve(), or -1.
+
 Time Complexity:
 - O(n^3) per call to edmonds(), where n is the number of nodes.
+- O(n*m*a(n)) per call to maximum_matching(), where m is the number of edges
+  and a is the inverse Ackermann function, though usually far less since
+  searches only explore their part of the graph and Hungarian trees are removed.
+- O(1) per call to add_edge() and mate(), and O(n^3) per call to solve().
 
 Space Complexity:
 - O(max(n, m)) for storage of the graph, where n the number of nodes and m is
   the number of edges.
 - O(n) auxiliary heap space for edmonds(), where n is the number of nodes.
+- O(n) auxiliary heap space for maximum_matching().
+- O(n^2) for storage of maximum_weight_matching, including auxiliary space.
 
 */
 
+#include <algorithm>
+#include <deque>
+#include <limits>
 #include <queue>
+#include <stdexcept>
+#include <utility>
 #include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-const int MAXN = 100;
+const int MAXN = 2000;
 std::vector<int> adj[MAXN];
 int p[MAXN], base[MAXN], match[MAXN];
 
@@ -120,17 +157,749 @@ int edmonds(int nodes) {
   return matches/2;
 }
 
+typedef unsigned int edge_index_t;
+
+template<class W = int>
+class csr_graph {
+  int num_nodes;
+  std::vector<edge_index_t> offsets;
+  std::vector<int> targets;
+  std::vector<W> weights;
+
+  void build(const std::vector<std::pair<int, int> > &edges, const W *w,
+             bool symmetric) {
+    int n = num_nodes;
+    long long total = (long long)edges.size()*(symmetric ? 2 : 1);
+    if (total > (long long)std::numeric_limits<edge_index_t>::max()) {
+      throw std::runtime_error("Too many edges for 32-bit offsets.");
+    }
+    edge_index_t m = total, half = edges.size();
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = std::max(1, std::min(omp_get_max_threads(),
+                                       (int)(m/65536) + 1));
+#endif
+    // count[t*n + u] is the number of edges from u in chunk t, which is then
+    // replaced by the first slot of those edges within the list of u.
+    std::vector<edge_index_t> count((size_t)num_threads*n, 0);
+    offsets.assign(n + 1, 0);
+    targets.resize(m);
+    if (w != NULL) {
+      weights.resize(m);
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        c[(e < half) ? edges[e].first : edges[e - half].second]++;
+      }
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(num_threads)
+#endif
+    for (int u = 0; u < n; u++) {
+      edge_index_t sum = 0;
+      for (int t = 0; t < num_threads; t++) {
+        edge_index_t c = count[(size_t)t*n + u];
+        count[(size_t)t*n + u] = sum;
+        sum += c;
+      }
+      offsets[u + 1] = sum;
+    }
+    for (int u = 0; u < n; u++) {
+      offsets[u + 1] += offsets[u];
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        int u = edges[(e < half) ? e : e - half].first;
+        int v = edges[(e < half) ? e : e - half].second;
+        if (e >= half) {
+          std::swap(u, v);
+        }
+        edge_index_t slot = offsets[u] + c[u]++;
+        targets[slot] = v;
+        if (w != NULL) {
+          weights[slot] = w[(e < half) ? e : e - half];
+        }
+      }
+    }
+  }
+
+ public:
+  typedef W weight_type;
+
+  csr_graph() : num_nodes(0), offsets(1, 0) {}
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            bool symmetric = false) : num_nodes(nodes) {
+    build(edges, NULL, symmetric);
+  }
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            const std::vector<W> &weights, bool symmetric = false)
+      : num_nodes(nodes) {
+    if (weights.size() != edges.size()) {
+      throw std::runtime_error("Expected one weight per edge.");
+    }
+    build(edges, weights.empty() ? NULL : &weights[0], symmetric);
+  }
+
+  int nodes() const {
+    return num_nodes;
+  }
+
+  edge_index_t edges() const {
+    return offsets[num_nodes];
+  }
+
+  edge_index_t offset(int u) const {
+    return offsets[u];
+  }
+
+  int degree(int u) const {
+    return offsets[u + 1] - offsets[u];
+  }
+
+  int target(edge_index_t e) const {
+    return targets[e];
+  }
+
+  W weight(edge_index_t e) const {
+    return weights.empty() ? W(1) : weights[e];
+  }
+
+  bool is_weighted() const {
+    return !weights.empty();
+  }
+};
+
+class blossom_forest {
+  std::vector<int> &match;
+  std::vector<int> label, parent, base, mark, touched, queue;
+  std::vector<char> dead;
+  int stamp;
+
+  int find(int u) {
+    while (base[u] != u) {
+      u = base[u] = base[base[u]];
+    }
+    return u;
+  }
+
+  void touch(int u, int l) {
+    label[u] = l;
+    touched.push_back(u);
+  }
+
+  int lca(int u, int v) {
+    for (stamp++;; std::swap(u, v)) {
+      if (u == -1) {
+        continue;
+      }
+      u = find(u);
+      if (mark[u] == stamp) {
+        return u;
+      }
+      mark[u] = stamp;
+      u = (match[u] == -1) ? -1 : parent[match[u]];
+    }
+  }
+
+  // Walks from u up to the base b, making the odd nodes on the way even and
+  // merging every node of the path into the blossom of b.
+  void shrink(int u, int v, int b) {
+    while (find(u) != b) {
+      parent[u] = v;
+      v = match[u];
+      if (label[v] == 1) {
+        label[v] = 0;
+        queue.push_back(v);
+      }
+      base[find(u)] = b;
+      if (find(v) != b) {
+        base[find(v)] = b;
+      }
+      u = parent[v];
+    }
+  }
+
+  void augment(int u, int v) {
+    while (u != -1) {
+      int w = match[u];
+      match[u] = v;
+      match[v] = u;
+      v = w;
+      u = (v == -1) ? -1 : parent[v];
+    }
+  }
+
+ public:
+  blossom_forest(int n, std::vector<int> &match)
+      : match(match), label(n, -1), parent(n, -1), base(n), mark(n, 0),
+        dead(n, 0), stamp(0) {
+    for (int u = 0; u < n; u++) {
+      base[u] = u;
+    }
+  }
+
+  // Searches for an augmenting path from the free node root, applying it if
+  // found. Otherwise, the nodes of the search tree are removed for good.
+  template<class Graph>
+  bool search(const Graph &g, int root) {
+    touched.clear();
+    queue.assign(1, root);
+    touch(root, 0);
+    bool found = false;
+    for (int i = 0; i < (int)queue.size() && !found; i++) {
+      int u = queue[i];
+      for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+        int v = g.target(e);
+        if (dead[v] || label[v] == 1 || find(u) == find(v)) {
+          continue;
+        }
+        if (label[v] == -1) {
+          if (match[v] == -1) {
+            augment(u, v);
+            found = true;
+            break;
+          }
+          parent[v] = u;
+          touch(v, 1);
+          touch(match[v], 0);
+          queue.push_back(match[v]);
+        } else {
+          int b = lca(u, v);
+          shrink(u, v, b);
+          shrink(v, u, b);
+        }
+      }
+    }
+    for (int i = 0; i < (int)touched.size(); i++) {
+      int u = touched[i];
+      if (found) {
+        label[u] = parent[u] = -1;
+        base[u] = u;
+      } else {
+        dead[u] = 1;
+      }
+    }
+    return found;
+  }
+};
+
+template<class Graph>
+int maximum_matching(const Graph &g, std::vector<int> &match) {
+  int n = g.nodes(), res = 0;
+  match.assign(n, -1);
+  std::vector<std::pair<int, int> > order(n);
+  for (int u = 0; u < n; u++) {
+    order[u] = std::make_pair(g.degree(u), u);
+  }
+  std::sort(order.begin(), order.end());
+  for (int i = 0; i < n; i++) {
+    int u = order[i].second;
+    for (edge_index_t e = g.offset(u); e < g.offset(u + 1) && match[u] < 0;
+         e++) {
+      int v = g.target(e);
+      if (v != u && match[v] < 0) {
+        match[u] = v;
+        match[v] = u;
+        res++;
+      }
+    }
+  }
+  blossom_forest forest(n, match);
+  for (int u = 0; u < n; u++) {
+    if (match[u] < 0 && forest.search(g, u)) {
+      res++;
+    }
+  }
+  return res;
+}
+
+class maximum_weight_matching {
+  struct edge {
+    int u, v;
+    long long w;
+  };
+
+  // Nodes are numbered from 1, with 0 meaning none, and blossoms from n + 1 to
+  // 2n. st[x] is the outermost blossom containing x, and s[x] its label of -1
+  // (unreached), 0 (even), or 1 (odd).
+  int n, n_x, stamp;
+  std::vector<edge> g;
+  std::vector<long long> lab;
+  std::vector<int> match, slack, st, pa, flower_from, s, vis;
+  std::vector<std::vector<int> > flower;
+  std::deque<int> q;
+
+  edge &at(int u, int v) {
+    return g[u*(2*n + 1) + v];
+  }
+
+  int &from(int b, int x) {
+    return flower_from[b*(n + 1) + x];
+  }
+
+  long long dist(const edge &e) const {
+    return lab[e.u] + lab[e.v] - e.w*2;
+  }
+
+  void update_slack(int u, int x) {
+    if (slack[x] == 0 || dist(at(u, x)) < dist(at(slack[x], x))) {
+      slack[x] = u;
+    }
+  }
+
+  void set_slack(int x) {
+    slack[x] = 0;
+    for (int u = 1; u <= n; u++) {
+      if (at(u, x).w > 0 && st[u] != x && s[st[u]] == 0) {
+        update_slack(u, x);
+      }
+    }
+  }
+
+  void q_push(int x) {
+    if (x <= n) {
+      q.push_back(x);
+    } else {
+      for (int i = 0; i < (int)flower[x].size(); i++) {
+        q_push(flower[x][i]);
+      }
+    }
+  }
+
+  void set_st(int x, int b) {
+    st[x] = b;
+    if (x > n) {
+      for (int i = 0; i < (int)flower[x].size(); i++) {
+        set_st(flower[x][i], b);
+      }
+    }
+  }
+
+  int get_pr(int b, int xr) {
+    std::vector<int> &f = flower[b];
+    int pr = std::find(f.begin(), f.end(), xr) - f.begin();
+    if (pr % 2 == 1) {
+      std::reverse(f.begin() + 1, f.end());
+      return (int)f.size() - pr;
+    }
+    return pr;
+  }
+
+  void set_match(int u, int v) {
+    match[u] = at(u, v).v;
+    if (u <= n) {
+      return;
+    }
+    edge e = at(u, v);
+    int xr = from(u, e.u), pr = get_pr(u, xr);
+    for (int i = 0; i < pr; i++) {
+      set_match(flower[u][i], flower[u][i ^ 1]);
+    }
+    set_match(xr, v);
+    std::rotate(flower[u].begin(), flower[u].begin() + pr, flower[u].end());
+  }
+
+  void augment(int u, int v) {
+    for (;;) {
+      int xnv = st[match[u]];
+      set_match(u, v);
+      if (xnv == 0) {
+        return;
+      }
+      set_match(xnv, st[pa[xnv]]);
+      u = st[pa[xnv]];
+      v = xnv;
+    }
+  }
+
+  int get_lca(int u, int v) {
+    for (stamp++; u != 0 || v != 0; std::swap(u, v)) {
+      if (u == 0) {
+        continue;
+      }
+      if (vis[u] == stamp) {
+        return u;
+      }
+      vis[u] = stamp;
+      u = st[match[u]];
+      if (u != 0) {
+        u = st[pa[u]];
+      }
+    }
+    return 0;
+  }
+
+  void add_blossom(int u, int lca, int v) {
+    int b = n + 1;
+    while (b <= n_x && st[b] != 0) {
+      b++;
+    }
+    if (b > n_x) {
+      n_x++;
+    }
+    lab[b] = 0;
+    s[b] = 0;
+    match[b] = match[lca];
+    std::vector<int> &f = flower[b];
+    f.assign(1, lca);
+    for (int x = u, y; x != lca; x = st[pa[y]]) {
+      f.push_back(x);
+      f.push_back(y = st[match[x]]);
+      q_push(y);
+    }
+    std::reverse(f.begin() + 1, f.end());
+    for (int x = v, y; x != lca; x = st[pa[y]]) {
+      f.push_back(x);
+      f.push_back(y = st[match[x]]);
+      q_push(y);
+    }
+    set_st(b, b);
+    for (int x = 1; x <= n_x; x++) {
+      at(b, x).w = at(x, b).w = 0;
+    }
+    for (int x = 1; x <= n; x++) {
+      from(b, x) = 0;
+    }
+    for (int i = 0; i < (int)f.size(); i++) {
+      int xs = f[i];
+      for (int x = 1; x <= n_x; x++) {
+        if (at(b, x).w == 0 || dist(at(xs, x)) < dist(at(b, x))) {
+          at(b, x) = at(xs, x);
+          at(x, b) = at(x, xs);
+        }
+      }
+      for (int x = 1; x <= n; x++) {
+        if (from(xs, x) != 0) {
+          from(b, x) = xs;
+        }
+      }
+    }
+    set_slack(b);
+  }
+
+  void expand_blossom(int b) {
+    std::vector<int> &f = flower[b];
+    for (int i = 0; i < (int)f.size(); i++) {
+      set_st(f[i], f[i]);
+    }
+    int xr = from(b, at(b, pa[b]).u), pr = get_pr(b, xr);
+    for (int i = 0; i < pr; i += 2) {
+      int xs = f[i], xns = f[i + 1];
+      pa[xs] = at(xns, xs).u;
+      s[xs] = 1;
+      s[xns] = 0;
+      slack[xs] = 0;
+      set_slack(xns);
+      q_push(xns);
+    }
+    s[xr] = 1;
+    pa[xr] = pa[b];
+    for (int i = pr + 1; i < (int)f.size(); i++) {
+      s[f[i]] = -1;
+      set_slack(f[i]);
+    }
+    st[b] = 0;
+  }
+
+  bool on_found_edge(const edge &e) {
+    int u = st[e.u], v = st[e.v];
+    if (s[v] == -1) {
+      pa[v] = e.u;
+      s[v] = 1;
+      int nu = st[match[v]];
+      slack[v] = slack[nu] = 0;
+      s[nu] = 0;
+      q_push(nu);
+    } else if (s[v] == 0) {
+      int lca = get_lca(u, v);
+      if (lca == 0) {
+        augment(u, v);
+        augment(v, u);
+        return true;
+      }
+      add_blossom(u, lca, v);
+    }
+    return false;
+  }
+
+  // Grows the alternating forest from every free node while adjusting the
+  // duals, returning whether an augmenting path was found and applied.
+  bool augment_once() {
+    std::fill(s.begin() + 1, s.begin() + n_x + 1, -1);
+    std::fill(slack.begin() + 1, slack.begin() + n_x + 1, 0);
+    q.clear();
+    for (int x = 1; x <= n_x; x++) {
+      if (st[x] == x && match[x] == 0) {
+        pa[x] = 0;
+        s[x] = 0;
+        q_push(x);
+      }
+    }
+    if (q.empty()) {
+      return false;
+    }
+    for (;;) {
+      while (!q.empty()) {
+        int u = q.front();
+        q.pop_front();
+        if (s[st[u]] == 1) {
+          continue;
+        }
+        for (int v = 1; v <= n; v++) {
+          if (at(u, v).w > 0 && st[u] != st[v]) {
+            if (dist(at(u, v)) == 0) {
+              if (on_found_edge(at(u, v))) {
+                return true;
+              }
+            } else {
+              update_slack(u, st[v]);
+            }
+          }
+        }
+      }
+      long long d = std::numeric_limits<long long>::max();
+      for (int b = n + 1; b <= n_x; b++) {
+        if (st[b] == b && s[b] == 1) {
+          d = std::min(d, lab[b]/2);
+        }
+      }
+      for (int x = 1; x <= n_x; x++) {
+        if (st[x] == x && slack[x] != 0) {
+          if (s[x] == -1) {
+            d = std::min(d, dist(at(slack[x], x)));
+          } else if (s[x] == 0) {
+            d = std::min(d, dist(at(slack[x], x))/2);
+          }
+        }
+      }
+      // Once the dual of an even node would reach 0, the matching is optimal.
+      for (int u = 1; u <= n; u++) {
+        if (s[st[u]] == 0 && lab[u] <= d) {
+          return false;
+        }
+      }
+      for (int u = 1; u <= n; u++) {
+        if (s[st[u]] == 0) {
+          lab[u] -= d;
+        } else if (s[st[u]] == 1) {
+          lab[u] += d;
+        }
+      }
+      for (int b = n + 1; b <= n_x; b++) {
+        if (st[b] == b) {
+          if (s[b] == 0) {
+            lab[b] += d*2;
+          } else if (s[b] == 1) {
+            lab[b] -= d*2;
+          }
+        }
+      }
+      q.clear();
+      for (int x = 1; x <= n_x; x++) {
+        if (st[x] == x && slack[x] != 0 && st[slack[x]] != x &&
+            dist(at(slack[x], x)) == 0 && on_found_edge(at(slack[x], x))) {
+          return true;
+        }
+      }
+      for (int b = n + 1; b <= n_x; b++) {
+        if (st[b] == b && s[b] == 1 && lab[b] == 0) {
+          expand_blossom(b);
+        }
+      }
+    }
+  }
+
+ public:
+  maximum_weight_matching(int nodes) : n(nodes), stamp(0) {
+    int size = 2*n + 1;
+    g.resize(size*size);
+    for (int u = 0; u < size; u++) {
+      for (int v = 0; v < size; v++) {
+        edge e = {u, v, 0};
+        at(u, v) = e;
+      }
+    }
+  }
+
+  void add_edge(int u, int v, long long w) {
+    if (w <= 0) {
+      throw std::runtime_error("Edge weights must be positive.");
+    }
+    if (u != v && w > at(u + 1, v + 1).w) {
+      at(u + 1, v + 1).w = at(v + 1, u + 1).w = w;
+    }
+  }
+
+  long long solve() {
+    int size = 2*n + 1;
+    n_x = n;
+    lab.assign(size, 0);
+    match.assign(size, 0);
+    slack.assign(size, 0);
+    st.assign(size, 0);
+    pa.assign(size, 0);
+    s.assign(size, -1);
+    vis.assign(size, 0);
+    flower.assign(size, std::vector<int>());
+    flower_from.assign(size*(n + 1), 0);
+    for (int u = 0; u < size; u++) {
+      st[u] = u;
+    }
+    long long w_max = 0;
+    for (int u = 1; u <= n; u++) {
+      from(u, u) = u;
+      for (int v = 1; v <= n; v++) {
+        w_max = std::max(w_max, at(u, v).w);
+      }
+    }
+    for (int u = 1; u <= n; u++) {
+      lab[u] = w_max;
+    }
+    while (augment_once()) {}
+    long long res = 0;
+    for (int u = 1; u <= n; u++) {
+      if (match[u] != 0 && match[u] < u) {
+        res += at(u, match[u]).w;
+      }
+    }
+    return res;
+  }
+
+  int mate(int u) const {
+    return match[u + 1] - 1;
+  }
+};
+
 /*** Example Usage and Output:
 
 Matched 2 pair(s):
 0 1
 2 3
+Graph of 2000 nodes: edmonds() 0.00483108s, maximum_matching() 0.000339031s
+Graph of 100000 nodes and 299999 edges: matched 49873 pairs in 0.0335748s
+Complete graph of 400 nodes: maximum weight 199223466 in 0.101191s
 
 ***/
 
+#include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <sys/time.h>
 using namespace std;
 
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+int rand30() {
+  return (rand() & 0x7fff) << 15 | (rand() & 0x7fff);
+}
+
+// Builds a random graph into a symmetric csr_graph, and also into adj[] if it
+// has at most MAXN nodes.
+csr_graph<> random_graph(int n, int m) {
+  vector<pair<int, int> > edges;
+  for (int u = 0; u < n && n <= MAXN; u++) {
+    adj[u].clear();
+  }
+  for (int i = 0; i < m; i++) {
+    int u = rand30() % n, v = rand30() % n;
+    if (u != v) {
+      edges.push_back(make_pair(u, v));
+      if (n <= MAXN) {
+        adj[u].push_back(v);
+        adj[v].push_back(u);
+      }
+    }
+  }
+  return csr_graph<>(n, edges, true);
+}
+
+void check_matching(const csr_graph<> &g, const vector<int> &match,
+                    int size) {
+  int count = 0;
+  for (int u = 0; u < g.nodes(); u++) {
+    if (match[u] >= 0) {
+      assert(match[match[u]] == u && match[u] != u);
+      bool adjacent = false;
+      for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+        adjacent = adjacent || g.target(e) == match[u];
+      }
+      assert(adjacent);
+      count++;
+    }
+  }
+  assert(count == 2*size);
+}
+
+// Returns the maximum weight of a matching among the nodes in mask.
+long long brute_force(const vector<vector<long long> > &w, int mask,
+                      vector<long long> &memo) {
+  if (mask == 0) {
+    return 0;
+  }
+  if (memo[mask] >= 0) {
+    return memo[mask];
+  }
+  int u = __builtin_ctz(mask), rest = mask & (mask - 1);
+  long long res = brute_force(w, rest, memo);
+  for (int v = u + 1; v < (int)w.size(); v++) {
+    if ((rest >> v & 1) && w[u][v] > 0) {
+      res = max(res, w[u][v] + brute_force(w, rest & ~(1 << v), memo));
+    }
+  }
+  return memo[mask] = res;
+}
+
+void test_weighted(int n, int m, int max_weight) {
+  vector<vector<long long> > w(n, vector<long long>(n, 0));
+  maximum_weight_matching g(n);
+  for (int i = 0; i < m; i++) {
+    int u = rand() % n, v = rand() % n;
+    long long c = 1 + rand() % max_weight;
+    g.add_edge(u, v, c);
+    if (u != v) {
+      w[u][v] = w[v][u] = max(w[u][v], c);
+    }
+  }
+  vector<long long> memo(1 << n, -1);
+  long long expected = brute_force(w, (1 << n) - 1, memo), value = g.solve();
+  assert(value == expected);
+  long long sum = 0;
+  for (int u = 0; u < n; u++) {
+    int v = g.mate(u);
+    if (v >= 0) {
+      assert(g.mate(v) == u && w[u][v] > 0);
+      sum += (u < v) ? w[u][v] : 0;
+    }
+  }
+  assert(sum == value);
+}
+
 int main() {
   int nodes = 4;
   adj[0].push_back(1);
@@ -147,5 +916,50 @@ int main() {
       cout << i << " " << match[i] << endl;
     }
   }
+
+  for (int n = 1; n <= 100; n++) {
+    for (int k = 0; k < 5; k++) {
+      csr_graph<> g = random_graph(n, rand() % (2*n + 1));
+      vector<int> m;
+      int size = maximum_matching(g, m);
+      assert(size == edmonds(n));
+      check_matching(g, m, size);
+    }
+  }
+  for (int n = 1; n <= 12; n++) {
+    for (int k = 0; k < 20; k++) {
+      test_weighted(n, rand() % (n*n + 1), (k % 2 == 0) ? 3 : 1000);
+    }
+  }
+
+  int n = MAXN;
+  csr_graph<> g = random_graph(n, 3*n);
+  vector<int> m;
+  double start = wall_time();
+  int size = edmonds(n);
+  double edmonds_time = wall_time() - start;
+  start = wall_time();
+  assert(maximum_matching(g, m) == size);
+  cout << "Graph of " << n << " nodes: edmonds() " << edmonds_time
+       << "s, maximum_matching() " << wall_time() - start << "s" << endl;
+  n = 100000;
+  g = random_graph(n, 3*n);
+  start = wall_time();
+  size = maximum_matching(g, m);
+  cout << "Graph of " << n << " nodes and " << g.edges()/2 << " edges: "
+       << "matched " << size << " pairs in " << wall_time() - start << "s"
+       << endl;
+  check_matching(g, m, size);
+  n = 400;
+  maximum_weight_matching wg(n);
+  for (int u = 0; u < n; u++) {
+    for (int v = u + 1; v < n; v++) {
+      wg.add_edge(u, v, 1 + rand30() % 1000000);
+    }
+  }
+  start = wall_time();
+  long long weight = wg.solve();
+  cout << "Complete graph of " << n << " nodes: maximum weight " << weight
+       << " in " << wall_time() - start << "s" << endl;
   return 0;
 }
@@ -0,0 +1,486 @@
+/*
+
+Given an n by m matrix of costs with n <= m, assign every row to a distinct
+column so that the sum of the costs of the assigned cells is minimal. This is
+the minimum cost (or, with negated costs, maximum weight) perfect matching
+problem on a bipartite graph with n + m nodes.
+
+- hungarian(n, m, cost, match) returns the minimum total cost of an assignment
+  for a cost matrix stored contiguously in row-major order, so that cost[i*m +
+  j] is the cost of assigning row i to column j, and sets match[i] to the column
+  assigned to row i. Rows are added one at a time, each by a Dijkstra-like
+  search for a shortest augmenting path on reduced costs, with the potentials u
+  of rows and v of columns updated so that every reduced cost cost[i][j] - u[i]
+  - v[j] stays nonnegative. The inner loops over columns are branch-free and
+  read the matrix row of the last row reached sequentially. For int costs, the
+  relaxation of a row is done four columns at a time with SSE2 if available.
+- auction(n, edges, cost, match) returns the same value and assignment for a
+  sparse n by n instance, where row edges[k].first may be assigned to column
+  edges[k].second at cost cost[k], using the auction algorithm of Bertsekas
+  (1988) with epsilon scaling. Every unassigned row bids for the column of the
+  lowest cost plus price, raising its price by the difference to its second
+  best column plus eps, then every column goes to its highest bidder. All rows
+  bid at once from the same prices (the Jacobi variant), in parallel if
+  compiled with -fopenmp. Costs are multiplied by n + 1, so that the final
+  phase with eps = 1 yields an optimal assignment. eps starts at the largest
+  scaled cost over alpha and is divided by alpha after each phase, where alpha
+  defaults to 8. An exception is thrown if no row can be assigned to every
+  column distinctly, which is checked by augmenting paths beforehand.
+
+Time Complexity:
+- O(n^2*m) per call to hungarian().
+- O(n*k log(n*C)) per call to auction(), where k is the number of edges and C
+  is the largest absolute value of a cost, though usually far less. The check
+  for a perfect matching takes O(n*k) in the worst case, and usually O(n + k).
+
+Space Complexity:
+- O(n*m) for storage of the matrix and O(m) auxiliary heap space for
+  hungarian().
+- O(n + k) auxiliary heap space for auction().
+
+*/
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Lowers minv[j] to the reduced cost a[j] - ui - v[j] of every column j with
+// used[j] == 0, recording the column j0 reached before in way[j].
+template<class T>
+void hungarian_relax(int m, const T *a, T ui, const T *v, const int *used,
+                     T *minv, int *way, int j0) {
+  for (int j = 0; j < m; j++) {
+    T cur = a[j] - ui - v[j];
+    bool take = (used[j] == 0) & (cur < minv[j]);
+    minv[j] = take ? cur : minv[j];
+    way[j] = take ? j0 : way[j];
+  }
+}
+
+#ifdef __SSE2__
+inline void hungarian_relax(int m, const int *a, int ui, const int *v,
+                            const int *used, int *minv, int *way, int j0) {
+  __m128i vu = _mm_set1_epi32(ui), vj = _mm_set1_epi32(j0);
+  int j = 0;
+  for (; j + 4 <= m; j += 4) {
+    __m128i cur = _mm_sub_epi32(
+        _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(a + j)), vu),
+        _mm_loadu_si128((const __m128i *)(v + j)));
+    __m128i mv = _mm_loadu_si128((const __m128i *)(minv + j));
+    __m128i w = _mm_loadu_si128((const __m128i *)(way + j));
+    __m128i take = _mm_andnot_si128(
+        _mm_loadu_si128((const __m128i *)(used + j)),
+        _mm_cmplt_epi32(cur, mv));
+    _mm_storeu_si128((__m128i *)(minv + j),
+                     _mm_or_si128(_mm_and_si128(take, cur),
+                                  _mm_andnot_si128(take, mv)));
+    _mm_storeu_si128((__m128i *)(way + j),
+                     _mm_or_si128(_mm_and_si128(take, vj),
+                                  _mm_andnot_si128(take, w)));
+  }
+  hungarian_relax<int>(m - j, a + j, ui, v + j, used + j, minv + j, way + j,
+                       j0);
+}
+#endif
+
+template<class T>
+T hungarian(int n, int m, const std::vector<T> &cost, std::vector<int> &match) {
+  if (n > m || (long long)cost.size() != (long long)n*m) {
+    throw std::runtime_error("Expected an n by m cost matrix with n <= m.");
+  }
+  const T inf = std::numeric_limits<T>::max();
+  // Index 0 of the column arrays is a virtual column holding the new row, and
+  // used[j] is -1 (all bits set) for the columns reached by the search.
+  std::vector<T> u(n + 1, 0), v(m + 1, 0), minv(m + 1);
+  std::vector<int> p(m + 1, 0), way(m + 1, 0), used(m + 1), reached;
+  for (int i = 1; i <= n; i++) {
+    p[0] = i;
+    int j0 = 0;
+    std::fill(minv.begin(), minv.end(), inf);
+    std::fill(used.begin(), used.end(), 0);
+    reached.clear();
+    do {
+      used[j0] = -1;
+      reached.push_back(j0);
+      int i0 = p[j0], j1 = 0;
+      hungarian_relax(m, &cost[(size_t)(i0 - 1)*m], u[i0], &v[1], &used[1],
+                      &minv[1], &way[1], j0);
+      T delta = inf;
+      for (int j = 1; j <= m; j++) {
+        if (used[j] == 0 && minv[j] < delta) {
+          delta = minv[j];
+          j1 = j;
+        }
+      }
+      for (int k = 0; k < (int)reached.size(); k++) {
+        u[p[reached[k]]] += delta;
+        v[reached[k]] -= delta;
+      }
+      for (int j = 1; j <= m; j++) {
+        minv[j] -= delta;
+      }
+      j0 = j1;
+    } while (p[j0] != 0);
+    do {
+      int j1 = way[j0];
+      p[j0] = p[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+  match.assign(n, -1);
+  T res = 0;
+  for (int j = 1; j <= m; j++) {
+    if (p[j] != 0) {
+      match[p[j] - 1] = j - 1;
+      res += cost[(size_t)(p[j] - 1)*m + j - 1];
+    }
+  }
+  return res;
+}
+
+// Returns whether the rows of the graph with edges adj[offset[i]..offset[i +
+// 1]) from every row i can all be matched, by augmenting paths found by BFS.
+inline bool has_perfect_matching(int n, const std::vector<int> &offset,
+                                 const std::vector<int> &adj) {
+  std::vector<int> row_of(n, -1), col_of(n, -1), pred(n), q;
+  std::vector<int> seen(n, -1);
+  for (int i = 0; i < n; i++) {
+    for (int k = offset[i]; k < offset[i + 1] && col_of[i] < 0; k++) {
+      if (row_of[adj[k]] < 0) {
+        row_of[adj[k]] = i;
+        col_of[i] = adj[k];
+      }
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    if (col_of[i] >= 0) {
+      continue;
+    }
+    int last = -1;
+    q.assign(1, i);
+    for (int h = 0; h < (int)q.size() && last < 0; h++) {
+      int r = q[h];
+      for (int k = offset[r]; k < offset[r + 1]; k++) {
+        int c = adj[k];
+        if (seen[c] == i) {
+          continue;
+        }
+        seen[c] = i;
+        pred[c] = r;
+        if (row_of[c] < 0) {
+          last = c;
+          break;
+        }
+        q.push_back(row_of[c]);
+      }
+    }
+    if (last < 0) {
+      return false;
+    }
+    for (int c = last; c >= 0; ) {
+      int r = pred[c], next = col_of[r];
+      row_of[c] = r;
+      col_of[r] = c;
+      c = next;
+    }
+  }
+  return true;
+}
+
+inline long long auction(int n, const std::vector<std::pair<int, int> > &edges,
+                         const std::vector<long long> &cost,
+                         std::vector<int> &match, int alpha = 8) {
+  if (cost.size() != edges.size()) {
+    throw std::runtime_error("Expected one cost per edge.");
+  }
+  std::vector<int> offset(n + 1, 0), adj(edges.size());
+  std::vector<long long> c(edges.size());
+  for (int k = 0; k < (int)edges.size(); k++) {
+    offset[edges[k].first + 1]++;
+  }
+  for (int i = 0; i < n; i++) {
+    offset[i + 1] += offset[i];
+  }
+  std::vector<int> pos(offset.begin(), offset.end() - 1);
+  long long max_cost = 0;
+  for (int k = 0; k < (int)edges.size(); k++) {
+    int slot = pos[edges[k].first]++;
+    adj[slot] = edges[k].second;
+    c[slot] = cost[k]*(n + 1);
+    max_cost = std::max(max_cost, c[slot] < 0 ? -c[slot] : c[slot]);
+  }
+  if (!has_perfect_matching(n, offset, adj)) {
+    throw std::runtime_error("No perfect matching exists.");
+  }
+  std::vector<long long> price(n, 0), bid(n), best_bid(n);
+  std::vector<int> owner(n), bid_col(n), best_row(n), unassigned;
+  match.assign(n, -1);
+  long long eps = std::max(max_cost/alpha, 1LL);
+  for (;;) {
+    std::fill(owner.begin(), owner.end(), -1);
+    std::fill(best_row.begin(), best_row.end(), -1);
+    unassigned.resize(n);
+    for (int i = 0; i < n; i++) {
+      unassigned[i] = i;
+    }
+    while (!unassigned.empty()) {
+      int num = unassigned.size();
+#ifdef _OPENMP
+      #pragma omp parallel for schedule(dynamic, 64)
+#endif
+      for (int k = 0; k < num; k++) {
+        int i = unassigned[k], j1 = -1;
+        long long w1 = std::numeric_limits<long long>::max(), w2 = w1;
+        for (int e = offset[i]; e < offset[i + 1]; e++) {
+          long long w = c[e] + price[adj[e]];
+          if (w < w1) {
+            w2 = w1;
+            w1 = w;
+            j1 = adj[e];
+          } else if (w < w2) {
+            w2 = w;
+          }
+        }
+        // With a single edge, any price rise up to max_cost*2 is safe.
+        long long gap = (w2 == std::numeric_limits<long long>::max())
+                            ? 2*max_cost : w2 - w1;
+        bid_col[k] = j1;
+        bid[k] = price[j1] + gap + eps;
+      }
+      for (int k = 0; k < num; k++) {
+        int j = bid_col[k];
+        if (best_row[j] < 0 || bid[k] > best_bid[j]) {
+          best_row[j] = unassigned[k];
+          best_bid[j] = bid[k];
+        }
+      }
+      std::vector<int> next;
+      for (int k = 0; k < num; k++) {
+        int j = bid_col[k];
+        if (best_row[j] != unassigned[k]) {
+          next.push_back(unassigned[k]);
+          continue;
+        }
+        if (owner[j] >= 0) {
+          match[owner[j]] = -1;
+          next.push_back(owner[j]);
+        }
+        owner[j] = unassigned[k];
+        match[owner[j]] = j;
+        price[j] = best_bid[j];
+      }
+      for (int k = 0; k < num; k++) {
+        best_row[bid_col[k]] = -1;
+      }
+      unassigned.swap(next);
+    }
+    if (eps == 1) {
+      break;
+    }
+    eps = std::max(eps/alpha, 1LL);
+  }
+  // Of parallel edges, the cheapest one is the one assigned.
+  long long res = 0;
+  for (int i = 0; i < n; i++) {
+    long long best = std::numeric_limits<long long>::max();
+    for (int e = offset[i]; e < offset[i + 1]; e++) {
+      if (adj[e] == match[i]) {
+        best = std::min(best, c[e]/(n + 1));
+      }
+    }
+    res += best;
+  }
+  return res;
+}
+
+/*** Example Usage and Output:
+
+Minimum cost 8:
+  row 0 -> column 1
+  row 1 -> column 2
+  row 2 -> column 3
+hungarian() on 2000 by 2000: int 0.300473s, long long 0.431223s
+auction() on 1000 by 1000 with 16000 edges: 0.006212s
+  hungarian() on the dense matrix: 0.171145s
+auction() on 5000 by 5000 with 80000 edges: 0.100569s
+
+***/
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sys/time.h>
+using namespace std;
+
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+int rand30() {
+  return (rand() & 0x7fff) << 15 | (rand() & 0x7fff);
+}
+
+// Returns the minimum cost of assigning rows i..n-1 to unused columns.
+long long brute_force(int n, int m, const vector<long long> &cost, int i,
+                      vector<bool> &used) {
+  if (i == n) {
+    return 0;
+  }
+  long long best = numeric_limits<long long>::max();
+  for (int j = 0; j < m; j++) {
+    if (!used[j]) {
+      used[j] = true;
+      long long rest = brute_force(n, m, cost, i + 1, used);
+      if (rest != numeric_limits<long long>::max()) {
+        best = min(best, cost[i*m + j] + rest);
+      }
+      used[j] = false;
+    }
+  }
+  return best;
+}
+
+template<class T>
+void check_match(int n, int m, const vector<T> &cost, const vector<int> &match,
+                 T value) {
+  vector<bool> used(m, false);
+  T sum = 0;
+  for (int i = 0; i < n; i++) {
+    assert(0 <= match[i] && match[i] < m && !used[match[i]]);
+    used[match[i]] = true;
+    sum += cost[i*m + match[i]];
+  }
+  assert(sum == value);
+}
+
+void test_hungarian(int n, int m) {
+  vector<long long> cost(n*m);
+  vector<int> cost32(n*m);
+  for (int k = 0; k < n*m; k++) {
+    cost32[k] = rand() % 2000 - 1000;
+    cost[k] = cost32[k];
+  }
+  vector<bool> used(m, false);
+  long long expected = brute_force(n, m, cost, 0, used);
+  vector<int> match;
+  assert(hungarian(n, m, cost, match) == expected);
+  check_match(n, m, cost, match, expected);
+  assert(hungarian(n, m, cost32, match) == expected);
+  check_match(n, m, cost32, match, (int)expected);
+}
+
+void test_auction(int n, int degree) {
+  // A random permutation guarantees a perfect matching among random edges.
+  vector<int> perm(n);
+  for (int i = 0; i < n; i++) {
+    perm[i] = i;
+  }
+  random_shuffle(perm.begin(), perm.end());
+  vector<pair<int, int> > edges;
+  vector<long long> cost;
+  const long long inf = 1000000000;
+  vector<long long> dense(n*n, inf);
+  for (int i = 0; i < n; i++) {
+    for (int d = 0; d < degree; d++) {
+      int j = (d == 0) ? perm[i] : rand() % n;
+      long long c = rand() % 200 - 100;
+      edges.push_back(make_pair(i, j));
+      cost.push_back(c);
+      dense[i*n + j] = min(dense[i*n + j], c);
+    }
+  }
+  vector<int> match;
+  long long expected = hungarian(n, n, dense, match);
+  long long value = auction(n, edges, cost, match, 2 + rand() % 10);
+  assert(value == expected);
+  check_match(n, n, dense, match, value);
+}
+
+// Matches n riders to n drivers, each of whom has 16 offers from nearby
+// riders, at a cost growing with the distance.
+void benchmark_rides(int n, bool compare) {
+  vector<pair<int, int> > edges;
+  vector<long long> costs;
+  for (int i = 0; i < n; i++) {
+    for (int d = 0; d < 16; d++) {
+      int j = (i + rand() % 64) % n;
+      edges.push_back(make_pair(i, j));
+      costs.push_back((j - i + n) % n * 100 + rand() % 1000);
+    }
+  }
+  vector<int> match;
+  double start = wall_time();
+  long long value = auction(n, edges, costs, match);
+  cout << "auction() on " << n << " by " << n << " with " << edges.size()
+       << " edges: " << wall_time() - start << "s" << endl;
+  if (compare) {
+    vector<int> full(n*n, 100000000);
+    for (int k = 0; k < (int)edges.size(); k++) {
+      int &c = full[edges[k].first*n + edges[k].second];
+      c = min(c, (int)costs[k]);
+    }
+    start = wall_time();
+    assert(hungarian(n, n, full, match) == value);
+    cout << "  hungarian() on the dense matrix: " << wall_time() - start << "s"
+         << endl;
+  }
+}
+
+int main() {
+  int cost[3][4] = {{8, 4, 7, 9}, {5, 2, 3, 6}, {9, 4, 8, 1}};
+  vector<int> a(&cost[0][0], &cost[0][0] + 12), match;
+  int value = hungarian(3, 4, a, match);
+  cout << "Minimum cost " << value << ":" << endl;
+  for (int i = 0; i < 3; i++) {
+    cout << "  row " << i << " -> column " << match[i] << endl;
+  }
+  assert(value == 8);
+
+  for (int n = 1; n <= 6; n++) {
+    for (int m = n; m <= 7; m++) {
+      for (int k = 0; k < 5; k++) {
+        test_hungarian(n, m);
+      }
+    }
+  }
+  for (int n = 1; n <= 60; n++) {
+    test_auction(n, 1 + rand() % 4);
+    test_auction(n, n);
+  }
+  bool thrown = false;
+  try {
+    vector<pair<int, int> > edges(2, make_pair(0, 0));
+    vector<long long> costs(2, 0);
+    auction(2, edges, costs, match);
+  } catch (runtime_error &) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  int n = 2000;
+  vector<int> dense32(n*n);
+  vector<long long> dense64(n*n);
+  for (int k = 0; k < n*n; k++) {
+    dense64[k] = dense32[k] = rand30() % 1000000;
+  }
+  double start = wall_time();
+  int v32 = hungarian(n, n, dense32, match);
+  double time32 = wall_time() - start;
+  start = wall_time();
+  long long v64 = hungarian(n, n, dense64, match);
+  double time64 = wall_time() - start;
+  assert(v32 == v64);
+  cout << "hungarian() on " << n << " by " << n << ": int " << time32
+       << "s, long long " << time64 << "s" << endl;
+
+  benchmark_rides(1000, true);
+  benchmark_rides(5000, false);
+  return 0;
+}
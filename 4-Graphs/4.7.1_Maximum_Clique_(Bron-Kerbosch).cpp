@@ -13,19 +13,62 @@ total number of nodes (exclusive) as passed in the function argument. Note that
 max_clique_weighted() is an efficient implementation using bitmasks of unsigned
 64-bit integers, thus requiring the number of nodes to be less than 64.
 
+For large sparse graphs, the following operate on a symmetric csr_graph (see
+section 4.1.5), or any graph type with the same read-only interface. Nodes are
+first put in a degeneracy ordering by repeatedly removing a node of minimum
+degree, so that every node has at most d neighbors later in the order, where d
+is the degeneracy of the graph (at most sqrt(2m), and usually far less). Every
+maximal clique is searched for from its earliest node u in this order, within
+the subgraph of the neighbors of u, which is stored as a dense adjacency matrix
+of bitsets whose width is chosen per subgraph. The bitwise intersections of
+the search run over 64-bit words, four at a time with AVX2 if available. The
+searches from different nodes are independent branches, dynamically scheduled
+across threads if compiled with -fopenmp.
+- max_clique(g) returns the nodes of a maximum clique, and max_clique(g, weight)
+  those of a clique of maximum total weight given positive node weights. From
+  every node u, only the neighbors later than u are candidates, and the search
+  is a branch and bound in the style of MCQ/MCS by Tomita et al. (2003, 2010).
+  At every step, the candidates are greedily colored so that no two nodes of a
+  color are adjacent, and are expanded in order of decreasing color, pruning as
+  soon as the weight of the current clique plus that of the colors left (the
+  largest weight of a node per color) cannot beat the best clique found so far
+  by any thread. Nodes are searched from in reverse degeneracy order, so that
+  the densest parts of the graph yield a good bound early.
+- count_maximal_cliques(g) returns the number of maximal cliques in g, found as
+  by Eppstein, Loffler, and Strash (2010): from every node u, the Bron-Kerbosch
+  algorithm with candidates P being the neighbors later than u and excluded
+  nodes X those earlier, choosing as pivot the node of P or X with the most
+  neighbors in P (as proposed by Tomita et al. (2006)).
+- Both functions above also accept a symmetric bitset_graph (see section
+  4.1.5), a dense adjacency matrix of bitsets with word-parallel operations on
+  its rows, which is first converted to a csr_graph.
+
 Time Complexity:
 - O(3^(n/3)) per call to max_clique() and max_clique_weighted(), where n
   is the number of nodes.
+- O(d*n*3^(d/3)) per call to count_maximal_cliques(g), and per call to
+  max_clique(g) in the worst case, though usually far less, where d is the
+  degeneracy of g.
 
 Space Complexity:
 - O(n^2) for storage of the graph, where n is the number of nodes.
 - O(n) auxiliary stack space for max_clique() and max_clique_weighted().
+- O(n + d^3/64) auxiliary heap space per thread for the functions on g.
 
 */
 
 #include <algorithm>
 #include <bitset>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 #include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 const int MAXN = 35;
 typedef std::bitset<MAXN> bits;
@@ -106,15 +149,754 @@ int max_clique_weighted(int nodes) {
   return rec(g, 0, (1LL << nodes) - 1, 0);
 }
 
-/*** Example Usage ***/
+typedef unsigned int edge_index_t;
+
+template<class W = int>
+class csr_graph {
+  int num_nodes;
+  std::vector<edge_index_t> offsets;
+  std::vector<int> targets;
+  std::vector<W> weights;
+
+  void build(const std::vector<std::pair<int, int> > &edges, const W *w,
+             bool symmetric) {
+    int n = num_nodes;
+    long long total = (long long)edges.size()*(symmetric ? 2 : 1);
+    if (total > (long long)std::numeric_limits<edge_index_t>::max()) {
+      throw std::runtime_error("Too many edges for 32-bit offsets.");
+    }
+    edge_index_t m = total, half = edges.size();
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = std::max(1, std::min(omp_get_max_threads(),
+                                       (int)(m/65536) + 1));
+#endif
+    // count[t*n + u] is the number of edges from u in chunk t, which is then
+    // replaced by the first slot of those edges within the list of u.
+    std::vector<edge_index_t> count((size_t)num_threads*n, 0);
+    offsets.assign(n + 1, 0);
+    targets.resize(m);
+    if (w != NULL) {
+      weights.resize(m);
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        c[(e < half) ? edges[e].first : edges[e - half].second]++;
+      }
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(num_threads)
+#endif
+    for (int u = 0; u < n; u++) {
+      edge_index_t sum = 0;
+      for (int t = 0; t < num_threads; t++) {
+        edge_index_t c = count[(size_t)t*n + u];
+        count[(size_t)t*n + u] = sum;
+        sum += c;
+      }
+      offsets[u + 1] = sum;
+    }
+    for (int u = 0; u < n; u++) {
+      offsets[u + 1] += offsets[u];
+    }
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+      int t = 0;
+#ifdef _OPENMP
+      t = omp_get_thread_num();
+#endif
+      edge_index_t lo = (long long)m*t/num_threads;
+      edge_index_t hi = (long long)m*(t + 1)/num_threads;
+      edge_index_t *c = &count[(size_t)t*n];
+      for (edge_index_t e = lo; e < hi; e++) {
+        int u = edges[(e < half) ? e : e - half].first;
+        int v = edges[(e < half) ? e : e - half].second;
+        if (e >= half) {
+          std::swap(u, v);
+        }
+        edge_index_t slot = offsets[u] + c[u]++;
+        targets[slot] = v;
+        if (w != NULL) {
+          weights[slot] = w[(e < half) ? e : e - half];
+        }
+      }
+    }
+  }
+
+ public:
+  typedef W weight_type;
+
+  csr_graph() : num_nodes(0), offsets(1, 0) {}
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            bool symmetric = false) : num_nodes(nodes) {
+    build(edges, NULL, symmetric);
+  }
+
+  csr_graph(int nodes, const std::vector<std::pair<int, int> > &edges,
+            const std::vector<W> &weights, bool symmetric = false)
+      : num_nodes(nodes) {
+    if (weights.size() != edges.size()) {
+      throw std::runtime_error("Expected one weight per edge.");
+    }
+    build(edges, weights.empty() ? NULL : &weights[0], symmetric);
+  }
+
+  int nodes() const {
+    return num_nodes;
+  }
+
+  edge_index_t edges() const {
+    return offsets[num_nodes];
+  }
+
+  edge_index_t offset(int u) const {
+    return offsets[u];
+  }
+
+  int degree(int u) const {
+    return offsets[u + 1] - offsets[u];
+  }
+
+  int target(edge_index_t e) const {
+    return targets[e];
+  }
+
+  W weight(edge_index_t e) const {
+    return weights.empty() ? W(1) : weights[e];
+  }
+
+  bool is_weighted() const {
+    return !weights.empty();
+  }
+};
+
+// Sets c = a & b over n words, returning whether any bit of c is set.
+inline bool and_words(int n, const uint64 *a, const uint64 *b, uint64 *c) {
+  uint64 any = 0;
+  int i = 0;
+#ifdef __AVX2__
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                 _mm256_loadu_si256((const __m256i *)(b + i)));
+    _mm256_storeu_si256((__m256i *)(c + i), x);
+    acc = _mm256_or_si256(acc, x);
+  }
+  any = !_mm256_testz_si256(acc, acc);
+#endif
+  for (; i < n; i++) {
+    c[i] = a[i] & b[i];
+    any |= c[i];
+  }
+  return any != 0;
+}
+
+inline int count_and(int n, const uint64 *a, const uint64 *b) {
+  int res = 0;
+  for (int i = 0; i < n; i++) {
+    res += __builtin_popcountll(a[i] & b[i]);
+  }
+  return res;
+}
+
+// Sets b |= a over n words, returning whether any bit of b changed.
+inline bool or_words(int n, const uint64 *a, uint64 *b) {
+  uint64 changed = 0;
+  int i = 0;
+#ifdef __AVX2__
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+    _mm256_storeu_si256((__m256i *)(b + i), _mm256_or_si256(x, y));
+    acc = _mm256_or_si256(acc, _mm256_andnot_si256(y, x));
+  }
+  changed = !_mm256_testz_si256(acc, acc);
+#endif
+  for (; i < n; i++) {
+    changed |= a[i] & ~b[i];
+    b[i] |= a[i];
+  }
+  return changed != 0;
+}
+
+inline int count_words(int n, const uint64 *a) {
+  int res = 0;
+  for (int i = 0; i < n; i++) {
+    res += __builtin_popcountll(a[i]);
+  }
+  return res;
+}
+
+class bitset_graph {
+  int num_nodes, num_words;
+  std::vector<uint64> bits;
+
+ public:
+  explicit bitset_graph(int nodes = 0)
+      : num_nodes(nodes), num_words((nodes + 255)/256*4),
+        bits((size_t)nodes*num_words + 1, 0) {}
+
+  template<class Graph>
+  explicit bitset_graph(const Graph &g)
+      : num_nodes(g.nodes()), num_words((g.nodes() + 255)/256*4),
+        bits((size_t)g.nodes()*num_words + 1, 0) {
+    for (int u = 0; u < num_nodes; u++) {
+      for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+        add_edge(u, g.target(e));
+      }
+    }
+  }
+
+  int nodes() const {
+    return num_nodes;
+  }
+
+  int words() const {
+    return num_words;
+  }
+
+  long long edges() const {
+    long long res = 0;
+    for (int u = 0; u < num_nodes; u++) {
+      res += degree(u);
+    }
+    return res;
+  }
+
+  const uint64 *row(int u) const {
+    return &bits[(size_t)u*num_words];
+  }
+
+  uint64 *row(int u) {
+    return &bits[(size_t)u*num_words];
+  }
+
+  bool has_edge(int u, int v) const {
+    return (row(u)[v >> 6] >> (v & 63)) & 1;
+  }
+
+  void add_edge(int u, int v) {
+    row(u)[v >> 6] |= 1ULL << (v & 63);
+  }
+
+  void remove_edge(int u, int v) {
+    row(u)[v >> 6] &= ~(1ULL << (v & 63));
+  }
+
+  int degree(int u) const {
+    return count_words(num_words, row(u));
+  }
+
+  csr_graph<> to_csr() const {
+    std::vector<std::pair<int, int> > edges;
+    edges.reserve(this->edges());
+    for (int u = 0; u < num_nodes; u++) {
+      for (int i = 0; i < num_words; i++) {
+        for (uint64 x = row(u)[i]; x != 0; x &= x - 1) {
+          edges.push_back(std::make_pair(u, 64*i + __builtin_ctzll(x)));
+        }
+      }
+    }
+    return csr_graph<>(num_nodes, edges);
+  }
+
+  // Adds an edge (u, v) for every path of one or more edges from u to v.
+  void transitive_closure() {
+    for (int k = 0; k < num_nodes; k++) {
+      const uint64 *rk = row(k);
+#ifdef _OPENMP
+      #pragma omp parallel for schedule(static) if (num_nodes >= 1024)
+#endif
+      for (int i = 0; i < num_nodes; i++) {
+        if (i != k && has_edge(i, k)) {
+          or_words(num_words, rk, row(i));
+        }
+      }
+    }
+  }
+};
+
+// Computes a degeneracy ordering of g by the bucket method of Matula and Beck,
+// with pos[u] the index of u in order.
+template<class Graph>
+void degeneracy_order(const Graph &g, std::vector<int> &order,
+                      std::vector<int> &pos) {
+  int n = g.nodes(), max_degree = 0;
+  std::vector<int> degree(n);
+  for (int u = 0; u < n; u++) {
+    degree[u] = g.degree(u);
+    max_degree = std::max(max_degree, degree[u]);
+  }
+  // Nodes sorted by degree, with start[d] the first of degree d.
+  std::vector<int> start(max_degree + 2, 0);
+  for (int u = 0; u < n; u++) {
+    start[degree[u] + 1]++;
+  }
+  for (int d = 0; d <= max_degree; d++) {
+    start[d + 1] += start[d];
+  }
+  order.resize(n);
+  pos.resize(n);
+  std::vector<int> next(start.begin(), start.end() - 1);
+  for (int u = 0; u < n; u++) {
+    pos[u] = next[degree[u]]++;
+    order[pos[u]] = u;
+  }
+  for (int i = 0; i < n; i++) {
+    int u = order[i];
+    for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+      int v = g.target(e), d = degree[v];
+      if (pos[v] > i && d > degree[u]) {
+        // Swap v with the first node of its degree, then shrink its bucket.
+        int first = std::max(start[d], i + 1), w = order[first];
+        std::swap(order[pos[v]], order[first]);
+        std::swap(pos[v], pos[w]);
+        start[d] = first + 1;
+        degree[v]--;
+      }
+    }
+  }
+}
+
+// The subgraph induced by a set of nodes as an adjacency matrix of bitsets,
+// with the state of a search within it.
+class clique_worker {
+ public:
+  int k, words;
+  std::vector<int> node, index;
+  std::vector<uint64> adj, scratch;
+  std::vector<long long> weight;
+  std::vector<std::vector<uint64> > sets;
+  std::vector<std::vector<int> > orders;
+  std::vector<std::vector<long long> > bounds;
+  std::vector<int> current, *best_clique;
+  long long *best, count;
+
+  explicit clique_worker(int n)
+      : index(n, -1), best_clique(NULL), best(NULL), count(0) {}
+
+  uint64 *row(int v) {
+    return &adj[(size_t)v*words];
+  }
+
+  // Returns set which of the given depth. Creating a new depth may move those
+  // of the others, so pointers to them must be fetched again afterwards.
+  uint64 *set(int depth, int which = 0) {
+    if ((int)sets.size() <= depth) {
+      sets.resize(depth + 1);
+      orders.resize(depth + 1);
+      bounds.resize(depth + 1);
+    }
+    sets[depth].resize(3*words + 1);
+    return &sets[depth][which*words];
+  }
+
+  template<class Graph, class W>
+  void build(const Graph &g, const std::vector<int> &nodes, const W *w) {
+    for (int i = 0; i < (int)node.size(); i++) {
+      index[node[i]] = -1;
+    }
+    node = nodes;
+    k = node.size();
+    words = (k + 63)/64;
+    adj.assign((size_t)k*words, 0);
+    scratch.resize(2*words);
+    weight.resize(k);
+    for (int i = 0; i < k; i++) {
+      index[node[i]] = i;
+      weight[i] = (w == NULL) ? 1 : w[node[i]];
+    }
+    for (int i = 0; i < k; i++) {
+      int u = node[i];
+      for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+        int j = index[g.target(e)];
+        if (j >= 0 && j != i) {
+          row(i)[j >> 6] |= 1ULL << (j & 63);
+        }
+      }
+    }
+  }
+
+  // Colors the candidates p greedily into independent sets, listing them by
+  // color with bound[i] the weight of the colors up to that of order[i].
+  int color_sort(const uint64 *p, int *order, long long *bound) {
+    uint64 *q = &scratch[0], *u = &scratch[words];
+    std::copy(p, p + words, q);
+    int num = 0;
+    long long base = 0;
+    for (bool left = true; left; ) {
+      std::copy(q, q + words, u);
+      long long heaviest = 0;
+      for (int i = 0; i < words; i++) {
+        while (u[i] != 0) {
+          int v = i*64 + __builtin_ctzll(u[i]);
+          const uint64 *r = row(v);
+          for (int j = i; j < words; j++) {
+            u[j] &= ~r[j];
+          }
+          u[i] &= u[i] - 1;
+          q[i] &= ~(1ULL << (v & 63));
+          heaviest = std::max(heaviest, weight[v]);
+          order[num] = v;
+          bound[num++] = base + heaviest;
+        }
+      }
+      base += heaviest;
+      left = false;
+      for (int i = 0; i < words && !left; i++) {
+        left = q[i] != 0;
+      }
+    }
+    return num;
+  }
+
+  void record(long long w) {
+#ifdef _OPENMP
+    #pragma omp critical(clique_worker_best)
+#endif
+    if (w > *best) {
+      __atomic_store_n(best, w, __ATOMIC_RELAXED);
+      best_clique->clear();
+      for (int i = 0; i < (int)current.size(); i++) {
+        best_clique->push_back(node[current[i]]);
+      }
+    }
+  }
+
+  void expand(int depth, long long w) {
+    set(depth + 1);
+    uint64 *p = set(depth);
+    orders[depth].resize(k + 1);
+    bounds[depth].resize(k + 1);
+    int *order = &orders[depth][0];
+    long long *bound = &bounds[depth][0];
+    int num = color_sort(p, order, bound);
+    for (int i = num - 1; i >= 0; i--) {
+      if (w + bound[i] <= __atomic_load_n(best, __ATOMIC_RELAXED)) {
+        return;
+      }
+      int v = order[i];
+      current.push_back(v);
+      uint64 *np = set(depth + 1);
+      if (and_words(words, p, row(v), np)) {
+        expand(depth + 1, w + weight[v]);
+        p = set(depth);
+        order = &orders[depth][0];
+        bound = &bounds[depth][0];
+      } else {
+        record(w + weight[v]);
+      }
+      current.pop_back();
+      p[v >> 6] &= ~(1ULL << (v & 63));
+    }
+  }
+
+  // Counts the maximal cliques containing the current clique, with candidates
+  // P and excluded nodes X at sets[depth].
+  void pivot(int depth) {
+    set(depth + 1);
+    uint64 *p = set(depth), *x = set(depth, 1), *cand = set(depth, 2);
+    int u = -1, most = -1;
+    for (int i = 0; i < words; i++) {
+      for (uint64 b = p[i] | x[i]; b != 0; b &= b - 1) {
+        int v = i*64 + __builtin_ctzll(b), c = count_and(words, p, row(v));
+        if (c > most) {
+          most = c;
+          u = v;
+        }
+      }
+    }
+    if (u < 0) {
+      count++;
+      return;
+    }
+    const uint64 *r = row(u);
+    for (int i = 0; i < words; i++) {
+      cand[i] = p[i] & ~r[i];
+    }
+    for (int i = 0; i < words; i++) {
+      for (; cand[i] != 0; cand[i] &= cand[i] - 1) {
+        int v = i*64 + __builtin_ctzll(cand[i]);
+        uint64 *np = set(depth + 1), *nx = set(depth + 1, 1);
+        and_words(words, p, row(v), np);
+        and_words(words, x, row(v), nx);
+        pivot(depth + 1);
+        p = set(depth);
+        x = set(depth, 1);
+        cand = set(depth, 2);
+        p[i] &= ~(1ULL << (v & 63));
+        x[i] |= 1ULL << (v & 63);
+      }
+    }
+  }
+};
+
+template<class Graph, class W>
+std::vector<int> max_clique(const Graph &g, const W *weight) {
+  int n = g.nodes();
+  std::vector<int> order, pos, res;
+  degeneracy_order(g, order, pos);
+  long long best = 0;
+#ifdef _OPENMP
+  #pragma omp parallel
+#endif
+  {
+    clique_worker worker(n);
+    worker.best = &best;
+    worker.best_clique = &res;
+    std::vector<int> nodes;
+#ifdef _OPENMP
+    #pragma omp for schedule(dynamic, 1)
+#endif
+    for (int i = n - 1; i >= 0; i--) {
+      int u = order[i];
+      long long total = (weight == NULL) ? 1 : weight[u];
+      nodes.assign(1, u);
+      for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+        int v = g.target(e);
+        if (pos[v] > i) {
+          nodes.push_back(v);
+          total += (weight == NULL) ? 1 : weight[v];
+        }
+      }
+      if (total <= __atomic_load_n(&best, __ATOMIC_RELAXED)) {
+        continue;
+      }
+      // The candidates are put in degeneracy order, which colors well.
+      for (int j = 1; j < (int)nodes.size(); j++) {
+        nodes[j] = pos[nodes[j]];
+      }
+      std::sort(nodes.begin() + 1, nodes.end());
+      nodes.erase(std::unique(nodes.begin() + 1, nodes.end()), nodes.end());
+      for (int j = 1; j < (int)nodes.size(); j++) {
+        nodes[j] = order[nodes[j]];
+      }
+      worker.build(g, nodes, weight);
+      uint64 *p = worker.set(0);
+      std::copy(worker.row(0), worker.row(0) + worker.words, p);
+      worker.current.assign(1, 0);
+      if (worker.k == 1) {
+        worker.record(worker.weight[0]);
+      } else {
+        worker.expand(0, worker.weight[0]);
+      }
+    }
+  }
+  return res;
+}
+
+template<class Graph>
+std::vector<int> max_clique(const Graph &g) {
+  return max_clique<Graph, int>(g, NULL);
+}
+
+template<class Graph, class W>
+std::vector<int> max_clique(const Graph &g, const std::vector<W> &weight) {
+  for (int u = 0; u < (int)weight.size(); u++) {
+    if (weight[u] <= 0) {
+      throw std::runtime_error("Node weights must be positive.");
+    }
+  }
+  return max_clique(g, weight.empty() ? (const W *)NULL : &weight[0]);
+}
+
+template<class Graph>
+long long count_maximal_cliques(const Graph &g) {
+  int n = g.nodes();
+  std::vector<int> order, pos;
+  degeneracy_order(g, order, pos);
+  long long res = 0;
+#ifdef _OPENMP
+  #pragma omp parallel reduction(+:res)
+#endif
+  {
+    clique_worker worker(n);
+    std::vector<int> nodes;
+#ifdef _OPENMP
+    #pragma omp for schedule(dynamic, 16)
+#endif
+    for (int i = 0; i < n; i++) {
+      int u = order[i];
+      nodes.clear();
+      for (edge_index_t e = g.offset(u); e < g.offset(u + 1); e++) {
+        if (g.target(e) != u) {
+          nodes.push_back(g.target(e));
+        }
+      }
+      std::sort(nodes.begin(), nodes.end());
+      nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+      worker.build(g, nodes, (const int *)NULL);
+      uint64 *p = worker.set(0), *x = worker.set(0, 1);
+      std::fill(p, p + worker.words, 0);
+      std::fill(x, x + worker.words, 0);
+      for (int j = 0; j < worker.k; j++) {
+        uint64 bit = 1ULL << (j & 63);
+        if (pos[nodes[j]] > i) {
+          p[j >> 6] |= bit;
+        } else {
+          x[j >> 6] |= bit;
+        }
+      }
+      worker.count = 0;
+      worker.pivot(0);
+      res += worker.count;
+    }
+  }
+  return res;
+}
+
+// A dense graph stored as a bitset_graph is searched in CSR form, since the
+// conversion takes O(n^2/64 + m) time, which is dominated by the search.
+std::vector<int> max_clique(const bitset_graph &g) {
+  return max_clique(g.to_csr());
+}
+
+template<class W>
+std::vector<int> max_clique(const bitset_graph &g,
+                            const std::vector<W> &weight) {
+  return max_clique(g.to_csr(), weight);
+}
+
+long long count_maximal_cliques(const bitset_graph &g) {
+  return count_maximal_cliques(g.to_csr());
+}
+
+/*** Example Usage and Output:
+
+Maximum clique: 0 1 2 3
+Maximum weight clique: 2 3 4
+Maximal cliques: 2
+random graph with 10000 nodes and 200000 edges:
+  maximum clique of 4 in 0.0303121s, 180426 maximal cliques in 0.0799069s
+planted clique with 10000 nodes and 200435 edges:
+  maximum clique of 30 in 0.0101361s, 180371 maximal cliques in 0.076076s
+communities with 10000 nodes and 294264 edges:
+  maximum clique of 13 in 0.11821s, 1712472 maximal cliques in 0.453147s
+
+***/
 
 #include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sys/time.h>
+using namespace std;
+
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+int rand30() {
+  return (rand() & 0x7fff) << 15 | (rand() & 0x7fff);
+}
 
 void add_edge(int u, int v) {
   adj[u][v] = true;
   adj[v][u] = true;
 }
 
+bool is_clique(const csr_graph<> &g, const vector<int> &c) {
+  for (int i = 0; i < (int)c.size(); i++) {
+    for (int j = i + 1; j < (int)c.size(); j++) {
+      bool adjacent = false;
+      for (edge_index_t e = g.offset(c[i]); e < g.offset(c[i] + 1); e++) {
+        adjacent = adjacent || g.target(e) == c[j];
+      }
+      if (!adjacent || c[i] == c[j]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void test_random(int n, double density) {
+  vector<pair<int, int> > edges;
+  vector<uint64> mask(n, 0);
+  for (int u = 0; u < n; u++) {
+    fill(adj[u], adj[u] + n, false);
+    w[u] = 1 + rand() % 100;
+  }
+  for (int u = 0; u < n; u++) {
+    for (int v = u + 1; v < n; v++) {
+      if (rand() < density*RAND_MAX) {
+        edges.push_back(make_pair(u, v));
+        add_edge(u, v);
+        mask[u] |= 1ULL << v;
+        mask[v] |= 1ULL << u;
+      }
+    }
+  }
+  csr_graph<> g(n, edges, true);
+  // Brute force over all subsets of nodes.
+  int best_size = 0, best_weight = 0;
+  long long maximal = 0;
+  for (int s = 1; s < (1 << n); s++) {
+    bool clique = true;
+    uint64 common = (1ULL << n) - 1;
+    int total = 0;
+    for (int u = 0; u < n && clique; u++) {
+      if (s >> u & 1) {
+        clique = ((s & ~(1 << u)) & ~mask[u]) == 0;
+        common &= mask[u];
+        total += w[u];
+      }
+    }
+    if (clique) {
+      best_size = max(best_size, __builtin_popcount(s));
+      best_weight = max(best_weight, total);
+      maximal += (common == 0);
+    }
+  }
+  vector<int> c = max_clique(g);
+  assert((int)c.size() == best_size && is_clique(g, c));
+  assert(max_clique(n) == best_size);
+  vector<int> weight(w, w + n);
+  c = max_clique(g, weight);
+  int total = 0;
+  for (int i = 0; i < (int)c.size(); i++) {
+    total += w[c[i]];
+  }
+  assert(total == best_weight && is_clique(g, c));
+  assert(max_clique_weighted(n) == best_weight);
+  assert(count_maximal_cliques(g) == maximal);
+  bitset_graph b(g);
+  c = max_clique(b);
+  assert((int)c.size() == best_size && is_clique(g, c));
+  c = max_clique(b, weight);
+  assert(is_clique(g, c));
+  assert(count_maximal_cliques(b) == maximal);
+}
+
+void benchmark(const char *name, int n, const vector<pair<int, int> > &edges) {
+  csr_graph<> g(n, edges, true);
+  double start = wall_time();
+  vector<int> c = max_clique(g);
+  double clique_time = wall_time() - start;
+  assert(is_clique(g, c));
+  start = wall_time();
+  long long count = count_maximal_cliques(g);
+  cout << name << " with " << n << " nodes and " << edges.size()
+       << " edges:" << endl << "  maximum clique of " << c.size() << " in "
+       << clique_time << "s, " << count << " maximal cliques in "
+       << wall_time() - start << "s" << endl;
+}
+
 int main() {
   add_edge(0, 1);
   add_edge(0, 2);
@@ -131,5 +913,62 @@ int main() {
   w[4] = 50;
   assert(max_clique(5) == 4);
   assert(max_clique_weighted(5) == 120);
+
+  vector<pair<int, int> > edges;
+  int pairs[8][2] = {{0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}, {3, 4},
+                     {4, 2}};
+  for (int i = 0; i < 8; i++) {
+    edges.push_back(make_pair(pairs[i][0], pairs[i][1]));
+  }
+  csr_graph<> g(5, edges, true);
+  vector<int> c = max_clique(g);
+  sort(c.begin(), c.end());
+  cout << "Maximum clique:";
+  for (int i = 0; i < (int)c.size(); i++) {
+    cout << " " << c[i];
+  }
+  cout << endl;
+  vector<int> weight(w, w + 5);
+  c = max_clique(g, weight);
+  sort(c.begin(), c.end());
+  cout << "Maximum weight clique:";
+  for (int i = 0; i < (int)c.size(); i++) {
+    cout << " " << c[i];
+  }
+  cout << endl;
+  cout << "Maximal cliques: " << count_maximal_cliques(g) << endl;
+  assert(c.size() == 3 && count_maximal_cliques(g) == 2);
+
+  for (int n = 1; n <= 16; n++) {
+    for (int k = 0; k < 10; k++) {
+      test_random(n, (k + 1)/11.0);
+    }
+  }
+
+  // Sparse random graphs, one with a planted clique of 30 nodes.
+  int n = 10000;
+  edges.clear();
+  for (int i = 0; i < 20*n; i++) {
+    edges.push_back(make_pair(rand30() % n, rand30() % n));
+  }
+  benchmark("random graph", n, edges);
+  for (int i = 0; i < 30; i++) {
+    for (int j = i + 1; j < 30; j++) {
+      edges.push_back(make_pair(i*300, j*300));
+    }
+  }
+  benchmark("planted clique", n, edges);
+  // Overlapping communities of 60 nodes with 50% of their pairs connected.
+  edges.clear();
+  for (int b = 0; b + 60 <= n; b += 30) {
+    for (int u = b; u < b + 60; u++) {
+      for (int v = u + 1; v < b + 60; v++) {
+        if (rand() % 2 == 0) {
+          edges.push_back(make_pair(u, v));
+        }
+      }
+    }
+  }
+  benchmark("communities", n, edges);
   return 0;
 }
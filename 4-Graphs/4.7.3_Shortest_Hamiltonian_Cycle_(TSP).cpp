@@ -7,17 +7,35 @@ traveling salesman problem (TSP). Since this implementation uses bitmasks with
 shortest_hamiltonian_cycle() applies to a global adjacency matrix adj[][], which
 must be populated with add_edge() before the function call.
 
+shortest_hamiltonian_cycle<T>(n, dist, order) is a faster version of the same
+Held-Karp dynamic programming for directed graphs, given a row-major matrix of
+non-negative distances dist[u*n + v] from u to v. The number of nodes must be
+less than 32, and the tour is stored in order[] starting from node 0. Partial
+path lengths are stored as type T, which may be short for half the memory
+(requiring every tour to be shorter than 32767) or int. Fixing node 0 as the
+start halves the table to the 2^(n - 1) subsets of the other nodes. Subsets are
+processed in layers by size, each of which is split among threads if compiled
+with -fopenmp. Every subset extends its paths to all other nodes at once, as a
+row operation that uses AVX2 instructions if available.
+
 Time Complexity:
 - O(2^n * n^2) per call to shortest_hamiltonian_cycle(), where n is the number
   of nodes.
 
 Space Complexity:
 - O(n^2) for storage of the graph, where n is the number of nodes.
-- O(2^n * n) auxiliary heap space for shortest_hamiltonian_cycle().
+- O(2^n * n) auxiliary heap space for shortest_hamiltonian_cycle(), or
+  O(2^(n - 1) * n) values of type T for shortest_hamiltonian_cycle<T>().
 
 */
 
 #include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 const int MAXN = 20, INF = 0x3f3f3f3f;
 int adj[MAXN][MAXN], dp[1 << MAXN][MAXN], order[MAXN];
@@ -65,16 +83,217 @@ int shortest_hamiltonian_cycle(int nodes) {
   return res;
 }
 
+template<class T>
+T max_cost();
+
+template<>
+inline short max_cost<short>() {
+  return std::numeric_limits<short>::max();
+}
+
+template<>
+inline int max_cost<int>() {
+  return std::numeric_limits<int>::max()/2;
+}
+
+// Sets c[i] = min(c[i], a + b[i]) for i from 0 to n - 1, saturating at
+// max_cost<short>(), where n must be a multiple of 16.
+inline void relax_row(int n, short a, const short *b, short *c) {
+  int i = 0;
+#ifdef __AVX2__
+  __m256i x = _mm256_set1_epi16(a);
+  for (; i < n; i += 16) {
+    __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+    __m256i z = _mm256_loadu_si256((const __m256i *)(c + i));
+    z = _mm256_min_epi16(z, _mm256_adds_epi16(x, y));
+    _mm256_storeu_si256((__m256i *)(c + i), z);
+  }
+#endif
+  for (; i < n; i++) {
+    c[i] = std::min((int)c[i], a + b[i]);
+  }
+}
+
+// Sets c[i] = min(c[i], a + b[i]) for i from 0 to n - 1, where a and every b[i]
+// are at most max_cost<int>() and n must be a multiple of 16.
+inline void relax_row(int n, int a, const int *b, int *c) {
+  int i = 0;
+#ifdef __AVX2__
+  __m256i x = _mm256_set1_epi32(a);
+  for (; i < n; i += 8) {
+    __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+    __m256i z = _mm256_loadu_si256((const __m256i *)(c + i));
+    z = _mm256_min_epi32(z, _mm256_add_epi32(x, y));
+    _mm256_storeu_si256((__m256i *)(c + i), z);
+  }
+#endif
+  for (; i < n; i++) {
+    c[i] = std::min(c[i], a + b[i]);
+  }
+}
+
+template<class T>
+int shortest_hamiltonian_cycle(int n, const std::vector<int> &dist,
+                               std::vector<int> &order) {
+  if (n < 1 || n > 31 || (int)dist.size() != n*n) {
+    throw std::runtime_error("Invalid number of nodes or distance matrix.");
+  }
+  long long total = 0;
+  for (int i = 0; i < n; i++) {
+    int longest = 0;
+    for (int j = 0; j < n; j++) {
+      if (dist[i*n + j] < 0) {
+        throw std::runtime_error("Distances must not be negative.");
+      }
+      longest = std::max(longest, (i == j) ? 0 : dist[i*n + j]);
+    }
+    total += longest;
+  }
+  if (total >= max_cost<T>()) {
+    throw std::runtime_error("Distances are too large for the cost type.");
+  }
+  // Node 0 is fixed as the start, so dp[s*k + j] for every subset s of nodes 1
+  // to k = n - 1 is the length of the shortest path from 0 visiting s that
+  // ends at node j + 1 in s. Every subset s relaxes the row next[j] over all j
+  // by dp[s][i] + dist[i + 1][j + 1] for every node i in s, then sets dp[s +
+  // {j}][j] to next[j] for every j not in s. The rows of dist are padded to a
+  // multiple of 16 values with max_cost<T>().
+  int k = n - 1, stride = (k + 15)/16*16;
+  std::vector<T> dp((size_t)k << k), from((size_t)k*stride, max_cost<T>());
+  for (int i = 0; i < k; i++) {
+    dp[((size_t)k << i) + i] = dist[i + 1];
+    for (int j = 0; j < k; j++) {
+      if (i != j) {
+        from[i*stride + j] = dist[(i + 1)*n + j + 1];
+      }
+    }
+  }
+  // Subsets are processed in layers of increasing size, each depending only on
+  // the previous layer, and writing every entry of the next layer exactly once.
+  // Every layer is split into chunks of consecutive subsets in colexicographic
+  // order, each starting from a subset found by its rank.
+  std::vector<std::vector<long long> > choose(k + 1,
+                                               std::vector<long long>(k + 1));
+  for (int i = 0; i <= k; i++) {
+    choose[i][0] = 1;
+    for (int j = 1; j <= i; j++) {
+      choose[i][j] = choose[i - 1][j - 1] + choose[i - 1][j];
+    }
+  }
+  const long long CHUNK = 1024;
+  unsigned int full = (1U << k) - 1;
+  for (int c = 1; c < k; c++) {
+    long long chunks = (choose[k][c] + CHUNK - 1)/CHUNK;
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+      std::vector<T> next(stride);
+#ifdef _OPENMP
+      #pragma omp for schedule(dynamic, 1)
+#endif
+      for (long long t = 0; t < chunks; t++) {
+        long long r = t*CHUNK;
+        unsigned int s = 0;
+        for (int b = k - 1, left = c; b >= 0 && left > 0; b--) {
+          if (r >= choose[b][left]) {
+            r -= choose[b][left];
+            s |= 1U << b;
+            left--;
+          }
+        }
+        long long end = std::min(choose[k][c], (t + 1)*CHUNK);
+        for (r = t*CHUNK; r < end; r++) {
+          const T *row = &dp[(size_t)s*k];
+          std::fill(next.begin(), next.end(), max_cost<T>());
+          for (unsigned int b = s; b != 0; b &= b - 1) {
+            int i = __builtin_ctz(b);
+            relax_row(stride, row[i], &from[i*stride], &next[0]);
+          }
+          for (unsigned int b = full & ~s; b != 0; b &= b - 1) {
+            int j = __builtin_ctz(b);
+            dp[(size_t)(s | 1U << j)*k + j] = next[j];
+          }
+          // Advance to the next subset of the same size by Gosper's hack.
+          unsigned int low = s & -s, high = s + low;
+          s = high | (((s ^ high) >> 2)/low);
+        }
+      }
+    }
+  }
+  order.assign(n, 0);
+  if (n == 1) {
+    return 0;
+  }
+  unsigned int s = full;
+  int res = -1, last = -1;
+  for (int j = 0; j < k; j++) {
+    int len = dp[(size_t)s*k + j] + dist[(j + 1)*n];
+    if (res < 0 || len < res) {
+      res = len;
+      last = j;
+    }
+  }
+  for (int p = n - 1; p >= 1; p--) {
+    order[p] = last + 1;
+    unsigned int prev = s ^ (1U << last);
+    int next = -1;
+    for (int i = 0; i < k && prev != 0; i++) {
+      if ((prev >> i & 1) && dp[(size_t)prev*k + i] + from[i*stride + last] ==
+                                 dp[(size_t)s*k + last]) {
+        next = i;
+        break;
+      }
+    }
+    s = prev;
+    last = next;
+  }
+  return res;
+}
+
 /*** Example Usage and Output:
 
 The shortest hamiltonian cycle has length 5.
 Take the path: 0->3->2->4->1->0.
+24 nodes with 16-bit costs: length 1883 in 2.46042s
+24 nodes with 32-bit costs: length 1883 in 2.70821s
 
 ***/
 
+#include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <sys/time.h>
 using namespace std;
 
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+int tour_length(int n, const vector<int> &dist, const vector<int> &order) {
+  vector<bool> seen(n, false);
+  int res = 0;
+  for (int i = 0; i < n; i++) {
+    assert(!seen[order[i]]);
+    seen[order[i]] = true;
+    res += dist[order[i]*n + order[(i + 1) % n]];
+  }
+  assert(order[0] == 0);
+  return res;
+}
+
+template<class T>
+void benchmark(int n, const vector<int> &dist) {
+  vector<int> order;
+  double start = wall_time();
+  int len = shortest_hamiltonian_cycle<T>(n, dist, order);
+  assert(tour_length(n, dist, order) == len);
+  cout << n << " nodes with " << 8*sizeof(T) << "-bit costs: length " << len
+       << " in " << wall_time() - start << "s" << endl;
+}
+
 int main() {
   int nodes = 5;
   add_edge(0, 1, 1);
@@ -94,5 +313,30 @@ int main() {
     cout << order[i] << "->";
   }
   cout << order[0] << "." << endl;
+  for (int n = 1; n <= 12; n++) {
+    for (int t = 0; t < 10; t++) {
+      vector<int> dist(n*n);
+      for (int u = 0; u < n; u++) {
+        for (int v = 0; v < n; v++) {
+          adj[u][v] = dist[u*n + v] = (u == v) ? 0 : rand() % 1000;
+        }
+      }
+      int len = (n == 1) ? 0 : shortest_hamiltonian_cycle(n);
+      vector<int> tour;
+      assert(shortest_hamiltonian_cycle<int>(n, dist, tour) == len);
+      assert(tour_length(n, dist, tour) == len);
+      assert(shortest_hamiltonian_cycle<short>(n, dist, tour) == len);
+      assert(tour_length(n, dist, tour) == len);
+    }
+  }
+  int n = 24;
+  vector<int> dist(n*n);
+  for (int u = 0; u < n; u++) {
+    for (int v = 0; v < n; v++) {
+      dist[u*n + v] = (u == v) ? 0 : 1 + rand() % 1000;
+    }
+  }
+  benchmark<short>(n, dist);
+  benchmark<int>(n, dist);
   return 0;
 }
@@ -0,0 +1,794 @@
+/*
+
+Given a set of points in the plane, find a short cycle which visits every point
+exactly once under Euclidean distances. The exact algorithms of sections 4.7.3
+and 4.7.4 are limited to about 25 points, while the heuristics below find tours
+that are typically within a few percent of optimal for thousands of points.
+
+Every point is given a candidate list of its k nearest neighbors from the
+knn_tree of section 2.4.6, which is reduced here to the k-nearest neighbor
+query. Improving moves must add an edge from a point to one of its candidates,
+which are in order of increasing distance, so that the search from a point can
+stop as soon as the candidate is farther than the gain available. A queue of
+points whose don't-look bits are off holds the points from which to search, and
+the endpoints of the edges changed by every move are added back to it.
+
+- euclidean_tsp(lo, hi, k) constructs an instance from two random-access
+  iterators to std::pair<double, double> as a range [lo, hi) of points, with
+  candidate lists of size k. The initial tour visits points in input order.
+- size() returns the number of points.
+- length() returns the length of the current tour.
+- tour() returns the current tour as a vector of point indices.
+- greedy_tour() sets the tour to that of the greedy edge heuristic, which adds
+  the candidate edges in order of increasing length whenever neither endpoint
+  already has two edges and no cycle is closed. The resulting paths are then
+  joined into a tour by repeatedly moving to the nearest free path endpoint.
+  Returns the length of the tour.
+- mst_tour() sets the tour to a preorder walk of a minimum spanning tree found
+  by Prim's algorithm over the complete graph as in section 4.4.1, which is at
+  most twice as long as an optimal tour. Returns the length of the tour.
+- optimize() improves the tour by 2-opt and Or-opt moves until none is found.
+  A 2-opt move replaces two edges with two others by reversing the path between
+  them, and an Or-opt move takes a path of 1 to 3 points and reinserts it, in
+  either direction, between two other adjacent points. The tour is stored as an
+  array with the position of every point, so that moves take time linear in the
+  shorter of the paths affected. Returns the length of the tour.
+- iterated_search(seconds, seed) repeatedly perturbs the tour with a random
+  double bridge move between nearby positions, re-optimizes it from the changed
+  points only, and keeps the result if it is not longer. This is a simple form
+  of the chained Lin-Kernighan approach of Martin, Otto, and Felten (1991), with
+  optimize() in place of Lin-Kernighan moves. Stops after the given number of
+  seconds of processor time. Returns the length of the best tour found.
+
+Time Complexity:
+- O(n log n + n*k log k) on average per call to the constructor, where n is the
+  number of points.
+- O(1) per call to size() and length().
+- O(n) per call to tour().
+- O(n*k log(n*k) + f^2) per call to greedy_tour(), where f is the number of
+  paths left by the greedy edge phase, which is usually far smaller than n.
+- O(n^2) per call to mst_tour().
+- O(n) per move of optimize() in the worst case, and usually far less, with a
+  number of moves that is usually O(n).
+- O(n) per perturbation of iterated_search(), for restoring the best tour.
+
+Space Complexity:
+- O(n*k) for storage of the instance.
+- O(n*k) auxiliary heap space for greedy_tour().
+- O(n) auxiliary heap space for all other operations.
+
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+template<class T, int K>
+class knn_tree {
+  static const int LEAF_SIZE = 8;
+
+  typedef std::pair<double, int> entry;
+
+  struct axis_less {
+    const std::vector<T> *c;
+    int axis;
+
+    axis_less(const std::vector<T> *c, int axis) : c(c), axis(axis) {}
+
+    bool operator()(int a, int b) const {
+      return (*c)[a*K + axis] < (*c)[b*K + axis];
+    }
+  };
+
+  // Point i of the tree has coordinates coord[i*K] to coord[i*K + K - 1] and
+  // index[i] in the original range. Nodes of at most LEAF_SIZE points are
+  // scanned, while larger nodes [lo, hi) split at mid along axis[mid].
+  std::vector<T> coord;
+  std::vector<int> index;
+  std::vector<unsigned char> axis;
+
+  void build(const std::vector<T> &c, int lo, int hi) {
+    if (hi - lo <= LEAF_SIZE) {
+      return;
+    }
+    int best = 0;
+    double best_spread = -1;
+    for (int j = 0; j < K; j++) {
+      T lo_value = c[index[lo]*K + j], hi_value = lo_value;
+      for (int i = lo + 1; i < hi; i++) {
+        lo_value = std::min(lo_value, c[index[i]*K + j]);
+        hi_value = std::max(hi_value, c[index[i]*K + j]);
+      }
+      if ((double)hi_value - (double)lo_value > best_spread) {
+        best_spread = (double)hi_value - (double)lo_value;
+        best = j;
+      }
+    }
+    int mid = lo + (hi - lo)/2;
+    axis[mid] = best;
+    std::nth_element(index.begin() + lo, index.begin() + mid,
+                     index.begin() + hi, axis_less(&c, best));
+    build(c, lo, mid);
+    build(c, mid + 1, hi);
+  }
+
+  template<class It>
+  double dist(int i, It q) const {
+    double res = 0;
+    for (int j = 0; j < K; j++) {
+      double d = (double)q[j] - (double)coord[i*K + j];
+      res += d*d;
+    }
+    return res;
+  }
+
+  // Pushes point i onto the max-heap of the k closest points found so far.
+  template<class It>
+  void consider(int i, It q, int k, std::vector<entry> &heap) const {
+    double d = dist(i, q);
+    if ((int)heap.size() < k) {
+      heap.push_back(entry(d, index[i]));
+      std::push_heap(heap.begin(), heap.end());
+    } else if (entry(d, index[i]) < heap.front()) {
+      std::pop_heap(heap.begin(), heap.end());
+      heap.back() = entry(d, index[i]);
+      std::push_heap(heap.begin(), heap.end());
+    }
+  }
+
+  template<class It>
+  void nearest(int lo, int hi, It q, int k, std::vector<entry> &heap) const {
+    if (hi - lo <= LEAF_SIZE) {
+      for (int i = lo; i < hi; i++) {
+        consider(i, q, k, heap);
+      }
+      return;
+    }
+    int mid = lo + (hi - lo)/2;
+    consider(mid, q, k, heap);
+    double d = (double)q[axis[mid]] - (double)coord[mid*K + axis[mid]];
+    if (d < 0) {
+      nearest(lo, mid, q, k, heap);
+      if ((int)heap.size() < k || d*d <= heap.front().first) {
+        nearest(mid + 1, hi, q, k, heap);
+      }
+    } else {
+      nearest(mid + 1, hi, q, k, heap);
+      if ((int)heap.size() < k || d*d <= heap.front().first) {
+        nearest(lo, mid, q, k, heap);
+      }
+    }
+  }
+
+ public:
+  template<class It>
+  knn_tree(It lo, It hi) {
+    std::vector<T> c(lo, hi);
+    int n = c.size()/K;
+    for (int i = 0; i < n; i++) {
+      index.push_back(i);
+    }
+    axis.resize(n);
+    build(c, 0, n);
+    coord.resize(n*K);
+    for (int i = 0; i < n; i++) {
+      std::copy(c.begin() + index[i]*K, c.begin() + index[i]*K + K,
+                coord.begin() + i*K);
+    }
+  }
+
+  template<class It>
+  void nearest(It q, int k, std::vector<int> &out) const {
+    std::vector<entry> heap;
+    if (k > 0) {
+      nearest(0, index.size(), q, k, heap);
+    }
+    std::sort_heap(heap.begin(), heap.end());
+    out.clear();
+    for (int i = 0; i < (int)heap.size(); i++) {
+      out.push_back(heap[i].second);
+    }
+  }
+};
+
+class euclidean_tsp {
+  static const double EPS;
+
+  // The tour visits order[0], order[1], ..., order[n - 1], with pos[order[i]]
+  // equal to i. The candidates of point u are near[u*k] to near[u*k + k - 1].
+  int n, k;
+  std::vector<double> x, y;
+  std::vector<int> near, order, pos;
+  std::deque<int> queue;
+  std::vector<bool> queued;
+  double total;
+
+  double dist(int u, int v) const {
+    double dx = x[u] - x[v], dy = y[u] - y[v];
+    return std::sqrt(dx*dx + dy*dy);
+  }
+
+  int at(int i) const {
+    return order[(i % n + n) % n];
+  }
+
+  int next(int u) const {
+    return at(pos[u] + 1);
+  }
+
+  int prev(int u) const {
+    return at(pos[u] - 1);
+  }
+
+  void place(int i, int u) {
+    i = (i % n + n) % n;
+    order[i] = u;
+    pos[u] = i;
+  }
+
+  void push(int u) {
+    if (!queued[u]) {
+      queued[u] = true;
+      queue.push_back(u);
+    }
+  }
+
+  double compute_length() const {
+    double res = 0;
+    for (int i = 0; i < n; i++) {
+      res += dist(order[i], at(i + 1));
+    }
+    return res;
+  }
+
+  // Reverses the path of the tour from u forward to v, or equivalently the
+  // rest of the tour, whichever is shorter.
+  void reverse(int u, int v) {
+    int i = pos[u], j = pos[v], len = ((j - i) % n + n) % n + 1;
+    if (2*len > n) {
+      i = pos[v] + 1;
+      j = pos[u] - 1;
+      len = n - len;
+    }
+    for (; len >= 2; i++, j--, len -= 2) {
+      int a = at(i), b = at(j);
+      place(i, b);
+      place(j, a);
+    }
+  }
+
+  // Replaces the tour edges (a, b) and (c, d) with (a, c) and (b, d), where b
+  // follows a and d follows c in the same direction.
+  void move_2opt(int a, int b, int c, int d) {
+    if (next(a) == b) {
+      reverse(b, c);
+    } else {
+      reverse(a, d);
+    }
+  }
+
+  // Moves the len points at positions i to i + len - 1 to between positions q
+  // and q + 1, in reverse order if rev, by shifting the points in between.
+  void move_segment(int i, int len, int q, bool rev) {
+    int seg[3];
+    for (int j = 0; j < len; j++) {
+      seg[j] = at(i + j);
+    }
+    int forward = ((q - i - len + 1) % n + n) % n;
+    int backward = ((i - 1 - q) % n + n) % n, start;
+    if (forward <= backward) {
+      for (int j = 0; j < forward; j++) {
+        place(i + j, at(i + len + j));
+      }
+      start = i + forward;
+    } else {
+      for (int j = 0; j < backward; j++) {
+        place(i + len - 1 - j, at(i - 1 - j));
+      }
+      start = i - backward;
+    }
+    for (int j = 0; j < len; j++) {
+      place(start + j, rev ? seg[len - 1 - j] : seg[j]);
+    }
+  }
+
+  // Tries an improving 2-opt move adding an edge from a to a candidate,
+  // returning whether one was made.
+  bool try_2opt(int a) {
+    for (int dir = 0; dir < 2; dir++) {
+      int b = (dir == 0) ? next(a) : prev(a);
+      double d_ab = dist(a, b);
+      for (int j = 0; j < k; j++) {
+        int c = near[a*k + j];
+        double g = d_ab - dist(a, c);
+        if (g <= EPS) {
+          break;
+        }
+        int d = (dir == 0) ? next(c) : prev(c);
+        if (c == b || d == a) {
+          continue;
+        }
+        double gain = g + dist(c, d) - dist(b, d);
+        if (gain > EPS) {
+          if (dir == 0) {
+            move_2opt(a, b, c, d);
+          } else {
+            move_2opt(b, a, d, c);
+          }
+          total -= gain;
+          push(a);
+          push(b);
+          push(c);
+          push(d);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // Tries an improving Or-opt move of a path of up to 3 points ending at a,
+  // returning whether one was made.
+  bool try_or_opt(int a) {
+    for (int len = 1; len <= 3 && len + 3 <= n; len++) {
+      for (int dir = 0; dir < 2; dir++) {
+        int i = (dir == 0) ? pos[a] : pos[a] - len + 1;
+        int first = at(i), last = at(i + len - 1);
+        int p = at(i - 1), q = at(i + len);
+        double g = dist(p, first) + dist(last, q) - dist(p, q);
+        for (int end = 0; end < 2; end++) {
+          int e = (end == 0) ? first : last, f = (end == 0) ? last : first;
+          for (int j = 0; j < k; j++) {
+            int c = near[e*k + j];
+            double g1 = g - dist(e, c);
+            if (g1 <= EPS) {
+              break;
+            }
+            int offset = ((pos[c] - i) % n + n) % n;
+            if (offset < len) {
+              continue;
+            }
+            // Insert between c and either of its neighbors, with u before v.
+            for (int side = 0; side < 2; side++) {
+              int u = (side == 0) ? c : prev(c);
+              int v = (side == 0) ? next(c) : c;
+              int ou = ((pos[u] - i) % n + n) % n;
+              int ov = ((pos[v] - i) % n + n) % n;
+              if (ou < len || ov < len) {
+                continue;
+              }
+              int w = (u == c) ? v : u;
+              double gain = g1 + dist(u, v) - dist(f, w);
+              if (gain > EPS) {
+                // The point of the path next to u is e if u is c, else f.
+                int left = (u == c) ? e : f;
+                move_segment(i, len, pos[u], left != first);
+                total -= gain;
+                push(p);
+                push(q);
+                push(u);
+                push(v);
+                push(first);
+                push(last);
+                return true;
+              }
+            }
+          }
+        }
+      }
+    }
+    return false;
+  }
+
+  void local_search() {
+    while (!queue.empty()) {
+      int a = queue.front();
+      queue.pop_front();
+      queued[a] = false;
+      if (try_2opt(a) || try_or_opt(a)) {
+        push(a);
+      }
+    }
+  }
+
+ public:
+  template<class It>
+  euclidean_tsp(It lo, It hi, int k = 10)
+      : n(hi - lo), k(std::min(k, (int)(hi - lo) - 1)), order(n), pos(n),
+        queued(n, false) {
+    if (n < 3 || k < 1) {
+      throw std::runtime_error("Need at least 3 points and 1 candidate.");
+    }
+    std::vector<double> coord;
+    for (It it = lo; it != hi; ++it) {
+      x.push_back(it->first);
+      y.push_back(it->second);
+      coord.push_back(it->first);
+      coord.push_back(it->second);
+    }
+    knn_tree<double, 2> tree(coord.begin(), coord.end());
+    std::vector<int> out;
+    for (int u = 0; u < n; u++) {
+      tree.nearest(&coord[2*u], this->k + 1, out);
+      for (int j = 0, added = 0; j < (int)out.size() && added < this->k; j++) {
+        if (out[j] != u) {
+          near.push_back(out[j]);
+          added++;
+        }
+      }
+      order[u] = pos[u] = u;
+    }
+    total = compute_length();
+  }
+
+  int size() const {
+    return n;
+  }
+
+  double length() const {
+    return total;
+  }
+
+  std::vector<int> tour() const {
+    return order;
+  }
+
+  double greedy_tour() {
+    std::vector<std::pair<double, std::pair<int, int> > > edges;
+    for (int u = 0; u < n; u++) {
+      for (int j = 0; j < k; j++) {
+        int v = near[u*k + j];
+        edges.push_back(std::make_pair(dist(u, v),
+                                       std::make_pair(std::min(u, v),
+                                                      std::max(u, v))));
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    std::vector<int> root(n), adj(2*n, -1), degree(n, 0);
+    for (int u = 0; u < n; u++) {
+      root[u] = u;
+    }
+    for (int i = 0; i < (int)edges.size(); i++) {
+      int u = edges[i].second.first, v = edges[i].second.second;
+      if (degree[u] == 2 || degree[v] == 2) {
+        continue;
+      }
+      int ru = u, rv = v;
+      while (root[ru] != ru) {
+        ru = root[ru] = root[root[ru]];
+      }
+      while (root[rv] != rv) {
+        rv = root[rv] = root[root[rv]];
+      }
+      if (ru != rv) {
+        root[ru] = rv;
+        adj[2*u + degree[u]++] = v;
+        adj[2*v + degree[v]++] = u;
+      }
+    }
+    // Walk every path from one of its endpoints, then chain the paths.
+    std::vector<std::vector<int> > paths;
+    std::vector<bool> visited(n, false);
+    for (int s = 0; s < n; s++) {
+      if (degree[s] < 2 && !visited[s]) {
+        paths.push_back(std::vector<int>());
+        for (int u = s, last = -1; u >= 0;) {
+          visited[u] = true;
+          paths.back().push_back(u);
+          int succ = (adj[2*u] != last) ? adj[2*u] : adj[2*u + 1];
+          last = u;
+          u = (succ >= 0 && !visited[succ]) ? succ : -1;
+        }
+      }
+    }
+    std::vector<bool> used(paths.size(), false);
+    int count = 0, current = 0;
+    for (int step = 0; step < (int)paths.size(); step++) {
+      used[current] = true;
+      for (int j = 0; j < (int)paths[current].size(); j++) {
+        place(count++, paths[current][j]);
+      }
+      int end = paths[current].back(), best = -1;
+      bool flip = false;
+      double best_dist = std::numeric_limits<double>::max();
+      for (int p = 0; p < (int)paths.size(); p++) {
+        if (!used[p]) {
+          double d1 = dist(end, paths[p][0]), d2 = dist(end, paths[p].back());
+          if (std::min(d1, d2) < best_dist) {
+            best_dist = std::min(d1, d2);
+            best = p;
+            flip = d2 < d1;
+          }
+        }
+      }
+      if (best >= 0 && flip) {
+        std::reverse(paths[best].begin(), paths[best].end());
+      }
+      current = best;
+    }
+    return total = compute_length();
+  }
+
+  double mst_tour() {
+    std::vector<double> d(n, std::numeric_limits<double>::max());
+    std::vector<int> parent(n, -1), child_count(n + 1, 0), children(n);
+    std::vector<bool> visit(n, false);
+    d[0] = 0;
+    for (int step = 0; step < n; step++) {
+      int u = -1;
+      for (int v = 0; v < n; v++) {
+        if (!visit[v] && (u < 0 || d[v] < d[u])) {
+          u = v;
+        }
+      }
+      visit[u] = true;
+      for (int v = 0; v < n; v++) {
+        if (!visit[v] && dist(u, v) < d[v]) {
+          d[v] = dist(u, v);
+          parent[v] = u;
+        }
+      }
+    }
+    // Children lists by counting sort, then an iterative preorder walk.
+    for (int v = 1; v < n; v++) {
+      child_count[parent[v] + 1]++;
+    }
+    for (int u = 0; u < n; u++) {
+      child_count[u + 1] += child_count[u];
+    }
+    std::vector<int> slot(child_count.begin(), child_count.end() - 1);
+    for (int v = 1; v < n; v++) {
+      children[slot[parent[v]]++] = v;
+    }
+    std::vector<int> stack(1, 0);
+    for (int count = 0; !stack.empty();) {
+      int u = stack.back();
+      stack.pop_back();
+      place(count++, u);
+      for (int j = child_count[u + 1] - 1; j >= child_count[u]; j--) {
+        stack.push_back(children[j]);
+      }
+    }
+    return total = compute_length();
+  }
+
+  double optimize() {
+    // Don't-look bits may miss moves away from the changed edges, so passes
+    // from all points are repeated until one finds no improvement.
+    for (double last = total + 1; total < last - EPS;) {
+      last = total;
+      for (int i = 0; i < n; i++) {
+        push(order[i]);
+      }
+      local_search();
+    }
+    return total = compute_length();
+  }
+
+  double iterated_search(double seconds, unsigned int seed = 1) {
+    optimize();
+    std::vector<int> best_order(order), best_pos(pos);
+    double best = total;
+    std::clock_t end = std::clock() + (std::clock_t)(seconds*CLOCKS_PER_SEC);
+    while (n >= 8 && std::clock() < end) {
+      // A double bridge on positions i < j < l within a window turns the tour
+      // A B C D into A C B D, where B = [i + 1, j] and C = [j + 1, l].
+      seed = seed*1103515245 + 12345;
+      int window = std::min(n - 1, 50), i = (seed >> 8) % n, offsets[2];
+      for (int t = 0; t < 2; t++) {
+        seed = seed*1103515245 + 12345;
+        offsets[t] = 1 + (seed >> 8) % (window - 1);
+      }
+      if (offsets[0] == offsets[1]) {
+        continue;
+      }
+      int j = i + std::min(offsets[0], offsets[1]);
+      int l = i + std::max(offsets[0], offsets[1]);
+      int ends[] = {at(i), at(i + 1), at(j), at(j + 1), at(l), at(l + 1)};
+      double removed = dist(ends[0], ends[1]) + dist(ends[2], ends[3]) +
+                       dist(ends[4], ends[5]);
+      std::vector<int> moved;
+      for (int t = j + 1; t <= l; t++) {
+        moved.push_back(at(t));
+      }
+      for (int t = i + 1; t <= j; t++) {
+        moved.push_back(at(t));
+      }
+      for (int t = 0; t < (int)moved.size(); t++) {
+        place(i + 1 + t, moved[t]);
+      }
+      total += dist(ends[0], ends[3]) + dist(ends[4], ends[1]) +
+               dist(ends[2], ends[5]) - removed;
+      for (int t = 0; t < 6; t++) {
+        push(ends[t]);
+      }
+      local_search();
+      if (total <= best + EPS) {
+        best = total;
+        best_order = order;
+        best_pos = pos;
+      } else {
+        order = best_order;
+        pos = best_pos;
+        total = best;
+      }
+    }
+    return total = compute_length();
+  }
+};
+
+const double euclidean_tsp::EPS = 1e-9;
+
+/*** Example Usage and Output:
+
+Tour of length 9.65685: 0 2 4 1 3 5
+1000 points (lengths relative to 0.7124*sqrt(n*A)):
+  greedy 1.19351 in 0.00239205s, 2-opt and Or-opt 1.06334 in 0.00125599s
+  iterated search for 1s 1.04354
+5000 points (lengths relative to 0.7124*sqrt(n*A)):
+  greedy 1.18695 in 0.015686s, 2-opt and Or-opt 1.06021 in 0.00708008s
+  iterated search for 1s 1.01994
+
+***/
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sys/time.h>
+using namespace std;
+
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+int rand30() {
+  return (rand() & 0x7fff) << 15 | (rand() & 0x7fff);
+}
+
+double dist(const pair<double, double> &a, const pair<double, double> &b) {
+  double dx = a.first - b.first, dy = a.second - b.second;
+  return sqrt(dx*dx + dy*dy);
+}
+
+double tour_length(const vector<pair<double, double> > &p,
+                   const vector<int> &tour) {
+  int n = p.size();
+  vector<bool> seen(n, false);
+  double res = 0;
+  assert((int)tour.size() == n);
+  for (int i = 0; i < n; i++) {
+    assert(!seen[tour[i]]);
+    seen[tour[i]] = true;
+    res += dist(p[tour[i]], p[tour[(i + 1) % n]]);
+  }
+  return res;
+}
+
+void check(const vector<pair<double, double> > &p, const euclidean_tsp &t) {
+  assert(fabs(tour_length(p, t.tour()) - t.length()) < 1e-9*t.length());
+}
+
+// Asserts that no 2-opt move improves the tour, and that no Or-opt move does
+// which adds an edge shorter than the gain from removing the path, as these
+// are the moves that the candidate lists allow when they hold all points.
+void check_local_optimum(const vector<pair<double, double> > &p,
+                         const vector<int> &tour) {
+  int n = tour.size();
+  for (int i = 0; i < n; i++) {
+    for (int j = i + 2; j < n; j++) {
+      int a = tour[i], b = tour[i + 1], c = tour[j], d = tour[(j + 1) % n];
+      double before = dist(p[a], p[b]) + dist(p[c], p[d]);
+      assert(dist(p[a], p[c]) + dist(p[b], p[d]) >= before - 1e-6);
+    }
+  }
+  for (int len = 1; len <= 3 && len + 3 <= n; len++) {
+    for (int i = 0; i < n; i++) {
+      // Remove tour[i..i + len - 1] and reinsert it between u and v.
+      int first = tour[i], last = tour[(i + len - 1) % n];
+      int prev = tour[(i + n - 1) % n], next = tour[(i + len) % n];
+      double g = dist(p[prev], p[first]) + dist(p[last], p[next]) -
+                 dist(p[prev], p[next]);
+      for (int j = len; j < n - 1; j++) {
+        int u = tour[(i + j) % n], v = tour[(i + j + 1) % n];
+        for (int rev = 0; rev < 2; rev++) {
+          int x = rev ? last : first, y = rev ? first : last;
+          double du = dist(p[u], p[x]), dv = dist(p[y], p[v]);
+          if (min(du, dv) < g - 1e-6) {
+            assert(du + dv - dist(p[u], p[v]) >= g - 1e-6);
+          }
+        }
+      }
+    }
+  }
+}
+
+void test_random(int n) {
+  vector<pair<double, double> > p(n);
+  for (int i = 0; i < n; i++) {
+    p[i] = make_pair(rand() % 100, rand() % 100);
+  }
+  euclidean_tsp t(p.begin(), p.end(), n - 1);
+  t.greedy_tour();
+  check(p, t);
+  t.optimize();
+  check(p, t);
+  // With all points as candidates, no 2-opt or Or-opt move may improve it.
+  check_local_optimum(p, t.tour());
+  // The preorder walk is at most twice the weight of the spanning tree, which
+  // is computed here by Prim's algorithm over all pairs.
+  double mst = t.mst_tour(), weight = 0;
+  check(p, t);
+  vector<double> d(n, 1e18);
+  vector<bool> done(n, false);
+  d[0] = 0;
+  for (int it = 0; it < n; it++) {
+    int u = -1;
+    for (int v = 0; v < n; v++) {
+      if (!done[v] && (u < 0 || d[v] < d[u])) {
+        u = v;
+      }
+    }
+    done[u] = true;
+    weight += d[u];
+    for (int v = 0; v < n; v++) {
+      d[v] = min(d[v], dist(p[u], p[v]));
+    }
+  }
+  assert(mst <= 2*weight + 1e-6);
+  // The search starts by optimizing the tour and never keeps a longer one.
+  double optimized = t.optimize();
+  assert(t.iterated_search(0.002, n) <= optimized + 1e-6);
+  check(p, t);
+  check_local_optimum(p, t.tour());
+}
+
+void benchmark(int n) {
+  vector<pair<double, double> > p(n);
+  for (int i = 0; i < n; i++) {
+    p[i] = make_pair(rand30() % 1000000, rand30() % 1000000);
+  }
+  // Tours of random uniform points approach 0.7124*sqrt(n*A) for large n.
+  double scale = 0.7124*sqrt(n*1e12);
+  double start = wall_time();
+  euclidean_tsp t(p.begin(), p.end(), 10);
+  double greedy = t.greedy_tour(), build_time = wall_time() - start;
+  start = wall_time();
+  double optimized = t.optimize(), optimize_time = wall_time() - start;
+  check(p, t);
+  double iterated = t.iterated_search(1.0);
+  check(p, t);
+  cout << n << " points (lengths relative to 0.7124*sqrt(n*A)):" << endl
+       << "  greedy " << greedy/scale << " in " << build_time << "s, 2-opt"
+       << " and Or-opt " << optimized/scale << " in " << optimize_time << "s"
+       << endl << "  iterated search for 1s " << iterated/scale << endl;
+}
+
+int main() {
+  pair<double, double> points[] = {make_pair(0, 0), make_pair(2, 2),
+                                   make_pair(0, 2), make_pair(2, 0),
+                                   make_pair(1, 3), make_pair(1, -1)};
+  euclidean_tsp t(points, points + 6, 3);
+  t.optimize();
+  cout << "Tour of length " << t.length() << ":";
+  vector<int> tour = t.tour();
+  for (int i = 0; i < (int)tour.size(); i++) {
+    cout << " " << tour[i];
+  }
+  cout << endl;
+  for (int n = 3; n <= 40; n++) {
+    for (int i = 0; i < 5; i++) {
+      test_random(n);
+    }
+  }
+  benchmark(1000);
+  benchmark(5000);
+  return 0;
+}
@@ -19,9 +19,21 @@ elements.
   corresponding position.
 - permutation_by_rank(n, r) returns the permutation of the integers in the range
   [0, n) which is lexicographically ranked r, where r is a zero-based rank in
-  the range [0, n!).
+  the range [0, n!), for n <= 20.
 - rank_by_permutation(n, a) returns an integer representing the zero-based
-  rank of permutation a[], which must be a permutation of the integers [0, n).
+  rank of permutation a[], which must be a permutation of the integers [0, n),
+  for n <= 20. Both work on the factorial base digits of the rank, the i-th of
+  which is the number of values after a[i] that are smaller than it, found
+  with popcounts over a bitmask of the values not yet used.
+- permutations_by_rank(n, count, r, a) and rank_by_permutations(n, count, a, r)
+  are the batched versions of the above for count permutations stored one
+  after another in the array a[] of size n*count, and their ranks in r[]. If
+  compiled with -fopenmp, the permutations are processed in parallel.
+- permutation_by_big_rank(n, r) and big_rank_by_permutation(n, a) are the
+  versions of the above for any n, with ranks given as a big_rank, that is, a
+  vector of 32-bit digits in little-endian order. The unused values are kept
+  in a Fenwick tree, and the factorial base digits are converted to and from
+  the big rank in groups that fit in 32 bits.
 - permutation_cycles(n, a) returns the decomposition of the permutation a[] into
   cycles. A permutation cycle is a subset of a permutation whose elements are
   consecutively swapped, relative to a sorted set. For example, {3, 1, 0, 2}
@@ -32,20 +44,32 @@ elements.
 Time Complexity:
 - O(n^2) per call to next_permutation_(lo, hi), where n is the distance between
   lo and hi.
-- O(n^2) per call to next_permutation(n, a), permutation_by_rank(n, r), and
-  rank_by_permutation(n, a).
+- O(n^2) per call to next_permutation(n, a).
+- O(n) per call to permutation_by_rank(n, r) and rank_by_permutation(n, a), and
+  O(n*count) per call to permutations_by_rank() and rank_by_permutations(),
+  except that without BMI2, unranking makes O(n^2) cheap bit operations.
+- O(n log n + b*n/g) per call to permutation_by_big_rank(n, r) and
+  big_rank_by_permutation(n, a), where b = O(n log n) is the number of 32-bit
+  digits in the rank and g = 32/log2(n) is the number of factorial base
+  digits converted per pass over them.
 - O(1) per call to next_permutation(x).
 - O(n) per call to permutation_cycles().
 
 Space Complexity:
 - O(1) auxiliary for next_permutation_() and next_permutation().
 - O(n) auxiliary heap space for permutation_by_rank(), rank_by_permutation(),
-  and permutation_cycles().
+  permutation_by_big_rank(), big_rank_by_permutation(), and
+  permutation_cycles().
+- O(1) auxiliary heap space for permutations_by_rank() and
+  rank_by_permutations().
 
 */
 
 #include <algorithm>
 #include <vector>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
 
 template<class It>
 bool next_permutation_(It lo, It hi) {
@@ -97,40 +121,187 @@ long long next_permutation(long long x) {
   return r | (((x ^ r) >> 2)/s);
 }
 
-std::vector<int> permutation_by_rank(int n, long long x) {
-  std::vector<long long> factorial(n);
-  std::vector<int> values(n), res(n);
-  factorial[0] = 1;
-  for (int i = 1; i < n; i++) {
-    factorial[i] = i*factorial[i - 1];
+// Returns the position of the (d + 1)-th lowest 1-bit of m.
+int select_bit(unsigned long long m, int d) {
+#ifdef __BMI2__
+  return __builtin_ctzll(_pdep_u64(1ULL << d, m));
+#else
+  for (; d > 0; d--) {
+    m &= m - 1;
   }
-  for (int i = 0; i < n; i++) {
-    values[i] = i;
+  return __builtin_ctzll(m);
+#endif
+}
+
+// Stores in a[] the permutation of [0, n) ranked x, for n <= 20. The digit d of
+// x in factorial base selects the (d + 1)-th smallest unused value in mask.
+void permutation_by_rank(int n, long long x, int a[]) {
+  int digits[20];
+  for (int i = n - 1; i >= 0; i--) {
+    digits[i] = x % (n - i);
+    x /= n - i;
   }
+  unsigned long long mask = (1ULL << n) - 1;
   for (int i = 0; i < n; i++) {
-    int pos = x/factorial[n - 1 - i];
-    res[i] = values[pos];
-    std::copy(values.begin() + pos + 1, values.end(), values.begin() + pos);
-    x %= factorial[n - 1 - i];
+    a[i] = select_bit(mask, digits[i]);
+    mask ^= 1ULL << a[i];
   }
-  return res;
 }
 
-long long rank_by_permutation(int n, int a[]) {
-  std::vector<long long> factorial(n);
-  factorial[0] = 1;
-  for (int i = 1; i < n; i++) {
-    factorial[i] = i*factorial[i - 1];
+std::vector<int> permutation_by_rank(int n, long long x) {
+  std::vector<int> res(n);
+  if (n > 0) {
+    permutation_by_rank(n, x, &res[0]);
   }
+  return res;
+}
+
+long long rank_by_permutation(int n, const int a[]) {
+  unsigned long long mask = (1ULL << n) - 1;
   long long res = 0;
   for (int i = 0; i < n; i++) {
-    int v = a[i];
-    for (int j = 0; j < i; j++) {
-      if (a[j] < a[i]) {
-        v--;
+    res = res*(n - i) + __builtin_popcountll(mask & ((1ULL << a[i]) - 1));
+    mask ^= 1ULL << a[i];
+  }
+  return res;
+}
+
+void permutations_by_rank(int n, int count, const long long r[], int a[]) {
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for (int i = 0; i < count; i++) {
+    permutation_by_rank(n, r[i], a + (long long)i*n);
+  }
+}
+
+void rank_by_permutations(int n, int count, const int a[], long long r[]) {
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for (int i = 0; i < count; i++) {
+    r[i] = rank_by_permutation(n, a + (long long)i*n);
+  }
+}
+
+typedef std::vector<unsigned int> big_rank;
+
+// A Fenwick tree over [0, n) counting the values not yet taken.
+class unused_values {
+  std::vector<int> t;
+  int n;
+
+ public:
+  explicit unused_values(int n) : t(n + 1, 0), n(n) {
+    for (int i = 1; i <= n; i++) {
+      t[i]++;
+      if (i + (i & -i) <= n) {
+        t[i + (i & -i)] += t[i];
       }
     }
-    res += v*factorial[n - 1 - i];
+  }
+
+  void remove(int v) {
+    for (int i = v + 1; i <= n; i += i & -i) {
+      t[i]--;
+    }
+  }
+
+  // Takes v, returning the number of unused values less than v.
+  int take(int v) {
+    int res = 0;
+    for (int i = v; i > 0; i -= i & -i) {
+      res += t[i];
+    }
+    remove(v);
+    return res;
+  }
+
+  // Takes and returns the (k + 1)-th smallest unused value.
+  int take_kth(int k) {
+    int pos = 0, step = 1;
+    while (2*step <= n) {
+      step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+      if (pos + step <= n && t[pos + step] <= k) {
+        pos += step;
+        k -= t[pos];
+      }
+    }
+    remove(pos);
+    return pos;
+  }
+};
+
+// Sets x = x*m + c for 32-bit m and c.
+void big_rank_mul_add(big_rank &x, unsigned int m, unsigned int c) {
+  unsigned long long carry = c;
+  for (int i = 0; i < (int)x.size(); i++) {
+    carry += (unsigned long long)x[i]*m;
+    x[i] = (unsigned int)carry;
+    carry >>= 32;
+  }
+  if (carry > 0) {
+    x.push_back((unsigned int)carry);
+  }
+}
+
+// Sets x = x/m, returning x % m, for 32-bit m.
+unsigned int big_rank_div_mod(big_rank &x, unsigned int m) {
+  unsigned long long rem = 0;
+  for (int i = (int)x.size() - 1; i >= 0; i--) {
+    rem = (rem << 32) | x[i];
+    x[i] = (unsigned int)(rem/m);
+    rem %= m;
+  }
+  while (!x.empty() && x.back() == 0) {
+    x.pop_back();
+  }
+  return (unsigned int)rem;
+}
+
+std::vector<int> permutation_by_big_rank(int n, big_rank x) {
+  std::vector<int> digits(n), res(n);
+  // Digits n - 1 down to 0 have bases 1 up to n, and as many as fit into 32
+  // bits are split off x by a single division.
+  for (int hi = n - 1; hi >= 0; ) {
+    unsigned long long base = 1;
+    int lo = hi;
+    while (lo >= 0 && base*(n - lo) <= 0xffffffffULL) {
+      base *= n - lo;
+      lo--;
+    }
+    unsigned int rem = big_rank_div_mod(x, (unsigned int)base);
+    for (int i = hi; i > lo; i--) {
+      digits[i] = rem % (n - i);
+      rem /= n - i;
+    }
+    hi = lo;
+  }
+  unused_values unused(n);
+  for (int i = 0; i < n; i++) {
+    res[i] = unused.take_kth(digits[i]);
+  }
+  return res;
+}
+
+big_rank big_rank_by_permutation(int n, const int a[]) {
+  unused_values unused(n);
+  big_rank res;
+  unsigned long long base = 1, digits = 0;
+  for (int i = 0; i < n; i++) {
+    if (base*(n - i) > 0xffffffffULL) {
+      big_rank_mul_add(res, (unsigned int)base, (unsigned int)digits);
+      base = 1;
+      digits = 0;
+    }
+    base *= n - i;
+    digits = digits*(n - i) + unused.take(a[i]);
+  }
+  big_rank_mul_add(res, (unsigned int)base, (unsigned int)digits);
+  while (!res.empty() && res.back() == 0) {
+    res.pop_back();
   }
   return res;
 }
@@ -172,6 +343,7 @@ Decomposition of {3,1,0,2} into cycles:
 
 #include <bitset>
 #include <cassert>
+#include <cstdlib>
 #include <iostream>
 using namespace std;
 
@@ -216,6 +388,52 @@ int main() {
     } while ((lo = next_permutation(lo)) != hi);
     cout << endl;
   }
+  assert(permutation_by_rank(0, 0).empty());
+  assert(rank_by_permutation(0, NULL) == 0);
+  { // Batched and big ranks agree with each other and with the above.
+    const int n = 12, count = 100000;
+    vector<long long> r(count), r2(count);
+    vector<int> a(n*count);
+    for (int i = 0; i < count; i++) {
+      r[i] = (rand()*(long long)RAND_MAX + rand()) % 479001600;
+    }
+    permutations_by_rank(n, count, &r[0], &a[0]);
+    rank_by_permutations(n, count, &a[0], &r2[0]);
+    assert(r == r2);
+    for (int i = 0; i < 1000; i++) {
+      int *p = &a[(long long)i*n];
+      big_rank b = big_rank_by_permutation(n, p);
+      assert(b.size() == 1 && b[0] == r[i]);
+      vector<int> q = permutation_by_big_rank(n, b);
+      assert(equal(q.begin(), q.end(), p));
+    }
+    // Ranks of a permutation of 1000 elements and of the reversed identity,
+    // whose rank is n! - 1.
+    vector<int> p(1000);
+    for (int i = 0; i < 1000; i++) {
+      p[i] = i;
+    }
+    random_shuffle(p.begin(), p.end());
+    vector<int> q = permutation_by_big_rank(1000, big_rank_by_permutation(
+        1000, &p[0]));
+    assert(p == q);
+    for (int m = 1; m <= 40; m++) {
+      vector<int> rev(m);
+      for (int i = 0; i < m; i++) {
+        rev[i] = m - 1 - i;
+      }
+      big_rank b = big_rank_by_permutation(m, &rev[0]), f(1, 1);
+      for (int i = 2; i <= m; i++) {
+        big_rank_mul_add(f, i, 0);
+      }
+      big_rank_mul_add(b, 1, 1);
+      assert(b == f);
+      vector<int> identity = permutation_by_big_rank(m, big_rank());
+      for (int i = 0; i < m; i++) {
+        assert(identity[i] == i);
+      }
+    }
+  }
   { // Decomposition into cycles.
     const int n = 4;
     int a[] = {3, 1, 0, 2};
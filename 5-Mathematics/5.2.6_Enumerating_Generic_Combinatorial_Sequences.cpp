@@ -2,87 +2,168 @@
 
 Enumerate combinatorial sequence by inheriting an abstract class. Child classes
 of abstract_enumerator must implement the count() function which should return
-the number of combinatorial sequences starting with the given prefix.
+the number of combinatorial sequences starting with the given prefix. The base
+class is templated on the child class (the curiously recurring template
+pattern), so that calls to count() are resolved at compile time and can be
+inlined instead of going through a virtual function in the innermost loops.
+Child classes may also implement their own next() to replace the generic one
+with a faster successor function.
 
 - to_rank(a) returns an integer representing the zero-based rank of the
   combinatorial sequence a.
 - from_rank(r) returns a combinatorial sequence of integers that is
   lexicographically ranked r, where r is a zero-based rank in the range
   [0, total_count()).
+- next(a) re-assigns a to become the next lexicographically greater
+  combinatorial sequence, returning true if such a sequence exists, or false if
+  a is already the last sequence (in which case the values are unchanged). Only
+  the suffix of a that changes is recomputed, by backtracking to the rightmost
+  position that can be increased and refilling the positions after it with the
+  smallest values that have a nonzero count.
 - enumerate(f) calls the function f(lo, hi) on every specified combinatorial
   sequence in lexicographically increasing order, where lo and hi are two
   random-access iterators to a range [lo, hi) of integers.
+- enumerate(lo, hi, f) calls f on the sequences ranked in [lo, hi) in
+  lexicographically increasing order, by unranking lo once and then stepping
+  with next().
+- parallel_enumerate(f, chunks) splits the ranks [0, total_count()) into the
+  given number of contiguous rank ranges (or 64 per thread if chunks is 0) and
+  calls enumerate(lo, hi, f) on each range, in parallel if compiled with
+  -fopenmp. Every sequence is visited exactly once, but f must be safe to call
+  from several threads at once and sequences of different ranges are visited in
+  no particular order relative to each other.
 
 Time Complexity:
-- O(n^2) calls will be made to count() per call to all operations, where n is
-  the length of the combinatorial sequence.
+- O(n^2) calls will be made to count() per call to to_rank() and from_rank(),
+  where n is the length of the combinatorial sequence.
+- O(n^2) calls will be made to count() per call to the generic next() in the
+  worst case, but only as many calls as the changed suffix needs in general.
+- O(k) per call to combination_enumerator::next() and O(n) per call to
+  partition_enumerator::next(), neither of which calls count().
+- O(n^2 + t) calls will be made to count() and next() per call to
+  enumerate(lo, hi, f), where t = hi - lo is the number of sequences visited.
 
 Space Complexity:
 - O(n) auxiliary heap space per call to all operations.
 
 */
 
+#include <algorithm>
 #include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
+typedef void (*ReportFunction)(std::vector<int>::iterator,
+                               std::vector<int>::iterator);
+
+template<class Enumerator>
 class abstract_enumerator {
  protected:
   int range, length;
 
   abstract_enumerator(int r, int l) : range(r), length(l) {}
 
-  virtual long long count(const std::vector<int> &prefix) {
-    return 0;
+  Enumerator& derived() {
+    return *static_cast<Enumerator*>(this);
   }
 
-  std::vector<int> next(std::vector<int> &a) {
-    return from_rank(to_rank(a) + 1);
+  // Extends a valid prefix of a with the lexicographically smallest suffix.
+  void fill_suffix(std::vector<int> &a) {
+    while ((int)a.size() < length) {
+      for (a.push_back(0); derived().count(a) == 0; a.back()++) {}
+    }
   }
 
+ public:
   long long total_count() {
-    return count(std::vector<int>(0));
+    return derived().count(std::vector<int>(0));
   }
 
- public:
   long long to_rank(const std::vector<int> &a) {
     long long res = 0;
+    std::vector<int> prefix;
     for (int i = 0; i < (int)a.size(); i++) {
-      std::vector<int> prefix(a.begin(), a.end());
-      prefix.resize(i + 1);
-      for (prefix[i] = 0; prefix[i] < a[i]; prefix[i]++) {
-        res += count(prefix);
+      for (prefix.push_back(0); prefix[i] < a[i]; prefix[i]++) {
+        res += derived().count(prefix);
       }
     }
     return res;
   }
 
   std::vector<int> from_rank(long long r) {
-    std::vector<int> a(length);
-    for (int i = 0; i < (int)a.size(); i++) {
-      std::vector<int> prefix(a.begin(), a.end());
-      prefix.resize(i + 1);
-      for (prefix[i] = 0; prefix[i] < range; ++prefix[i]) {
-        long long curr = count(prefix);
+    std::vector<int> a;
+    for (int i = 0; i < length; i++) {
+      for (a.push_back(0); a[i] < range; a[i]++) {
+        long long curr = derived().count(a);
         if (r < curr) {
           break;
         }
         r -= curr;
       }
-      a[i] = prefix[i];
     }
     return a;
   }
 
-  void enumerate(void (*f)(std::vector<int>::iterator,
-                           std::vector<int>::iterator)) {
+  bool next(std::vector<int> &a) {
+    std::vector<int> old(a);
+    for (int i = length - 1; i >= 0; i--) {
+      a.resize(i + 1);
+      for (a[i]++; a[i] < range; a[i]++) {
+        if (derived().count(a) > 0) {
+          fill_suffix(a);
+          return true;
+        }
+      }
+    }
+    a.swap(old);
+    return false;
+  }
+
+  void enumerate(ReportFunction f) {
+    enumerate(0, total_count(), f);
+  }
+
+  template<class Function>
+  void enumerate(long long lo, long long hi, Function f) {
+    if (lo >= hi) {
+      return;
+    }
+    std::vector<int> a(from_rank(lo));
+    for (long long r = lo; ; ) {
+      f(a.begin(), a.end());
+      if (++r >= hi || !derived().next(a)) {
+        break;
+      }
+    }
+  }
+
+  template<class Function>
+  void parallel_enumerate(Function f, int chunks = 0) {
     long long total = total_count();
-    for (long long i = 0; i < total; i++) {
-      std::vector<int> curr = from_rank(i);
-      f(curr.begin(), curr.end());
+    if (chunks <= 0) {
+#ifdef _OPENMP
+      chunks = 64*omp_get_max_threads();
+#else
+      chunks = 1;
+#endif
+    }
+    if (chunks > total) {
+      chunks = (int)std::max(total, 1LL);
+    }
+    long long size = total / chunks, extra = total % chunks;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int c = 0; c < chunks; c++) {
+      long long lo = size*c + std::min((long long)c, extra);
+      enumerate(lo, lo + size + (c < extra ? 1 : 0), f);
     }
   }
 };
 
-class arrangement_enumerator : public abstract_enumerator {
+class arrangement_enumerator
+    : public abstract_enumerator<arrangement_enumerator> {
  public:
   arrangement_enumerator(int n, int k) : abstract_enumerator(n, k) {}
 
@@ -106,7 +187,8 @@ class permutation_enumerator : public arrangement_enumerator {
   permutation_enumerator(int n) : arrangement_enumerator(n, n) {}
 };
 
-class combination_enumerator : public abstract_enumerator {
+class combination_enumerator
+    : public abstract_enumerator<combination_enumerator> {
   std::vector<std::vector<long long> > table;
 
  public:
@@ -129,9 +211,23 @@ class combination_enumerator : public abstract_enumerator {
     }
     return table[range - prefix[n - 1] - 1][length - n];
   }
+
+  // O(k) successor, as in next_combination(n, k, a) from 5.2.4.
+  bool next(std::vector<int> &a) {
+    for (int i = length - 1; i >= 0; i--) {
+      if (a[i] < range - length + i) {
+        for (a[i]++; ++i < length; ) {
+          a[i] = a[i - 1] + 1;
+        }
+        return true;
+      }
+    }
+    return false;
+  }
 };
 
-class partition_enumerator : public abstract_enumerator {
+class partition_enumerator
+    : public abstract_enumerator<partition_enumerator> {
   std::vector<std::vector<long long> > table;
 
  public:
@@ -156,11 +252,13 @@ class partition_enumerator : public abstract_enumerator {
     for (int i = 0; i < n; i++) {
       sum += prefix[i];
     }
+    if (n >= 2 && prefix[n - 1] > prefix[n - 2]) {
+      return 0;
+    }
     if (sum == range - 1) {
       return 1;
     }
-    if (sum > range - 1 || (n > 0 && prefix[n - 1] == 0) ||
-        (n >= 2 && prefix[n - 1] > prefix[n - 2])) {
+    if (sum > range - 1 || (n > 0 && prefix[n - 1] == 0)) {
       return 0;
     }
     if (n == 0) {
@@ -168,6 +266,28 @@ class partition_enumerator : public abstract_enumerator {
     }
     return table[range - sum - 1][prefix[n - 1]];
   }
+
+  // O(n) successor, as in next_partition(p) from 5.2.5 but on partitions that
+  // are padded with trailing zeros up to length n.
+  bool next(std::vector<int> &a) {
+    int m = length;
+    while (m > 0 && a[m - 1] == 0) {
+      m--;
+    }
+    if (m <= 1) {
+      return false;
+    }
+    int s = a[m - 1] - 1, i = m - 2;
+    a[m - 1] = 0;
+    for (; i > 0 && a[i] == a[i - 1]; i--) {
+      s += a[i];
+      a[i] = 0;
+    }
+    for (a[i]++; s > 0; s--) {
+      a[++i] = 1;
+    }
+    return true;
+  }
 };
 
 /*** Example Usage and Output:
@@ -186,6 +306,7 @@ Partition of 4:
 
 ***/
 
+#include <cassert>
 #include <iostream>
 using namespace std;
 
@@ -198,9 +319,55 @@ void print_range(It lo, It hi) {
   cout << "} ";
 }
 
+template<class Enumerator>
+struct visit_counter {
+  Enumerator *e;
+  vector<int> *visits;
+
+  visit_counter(Enumerator *e, vector<int> *visits) : e(e), visits(visits) {}
+
+  void operator()(vector<int>::iterator lo, vector<int>::iterator hi) {
+    long long r = e->to_rank(vector<int>(lo, hi));
+#ifdef _OPENMP
+    #pragma omp atomic
+#endif
+    (*visits)[r]++;
+  }
+};
+
+template<class Enumerator>
+void test_enumerator(Enumerator &e) {
+  long long total = e.total_count();
+  vector<int> a(e.from_rank(0));
+  for (long long r = 0; r < total; r++) {
+    assert(a == e.from_rank(r));
+    assert(e.to_rank(a) == r);
+    vector<int> b(a);
+    assert(e.next(b) == (r + 1 < total));
+    a.swap(b);
+  }
+  assert(a == e.from_rank(total - 1));
+  for (int chunks = 0; chunks <= total + 1; chunks += 3) {
+    vector<int> visits(total, 0);
+    e.parallel_enumerate(visit_counter<Enumerator>(&e, &visits), chunks);
+    assert(visits == vector<int>(total, 1));
+  }
+}
+
+struct rank_checker {
+  combination_enumerator *e;
+  long long r;
+
+  rank_checker(combination_enumerator *e, long long r) : e(e), r(r) {}
+
+  void operator()(vector<int>::iterator lo, vector<int>::iterator hi) {
+    assert(e->from_rank(r++) == vector<int>(lo, hi));
+  }
+};
+
 int main() {
   {
-    cout << "3 permute 2 arrangement_enumerator:" << endl;
+    cout << "3 permute 2 arrangements:" << endl;
     arrangement_enumerator arr(3, 2);
     arr.enumerate(print_range);
     cout << endl;
@@ -223,5 +390,22 @@ int main() {
     part.enumerate(print_range);
     cout << endl;
   }
+  { // Stepping with next() and parallel enumeration over rank ranges.
+    arrangement_enumerator arr(5, 3);
+    test_enumerator(arr);
+    permutation_enumerator perm(5);
+    test_enumerator(perm);
+    combination_enumerator comb(7, 3);
+    test_enumerator(comb);
+    partition_enumerator part(9);
+    test_enumerator(part);
+  }
+  { // A range of 60 choose 10 combinations, unranked from the middle.
+    combination_enumerator comb(60, 10);
+    long long total = comb.total_count(), lo = total/2 + 12345;
+    assert(total == 75394027566LL);
+    comb.enumerate(lo, lo + 10000, rank_checker(&comb, lo));
+    comb.enumerate(total - 100, total + 100, rank_checker(&comb, total - 100));
+  }
   return 0;
 }
@@ -23,11 +23,27 @@ of a single element - the input itself.
   primality test, and Pollard's rho algorithm. trial_division_cutoff specifies
   the largest factor to test with trial division before falling back to the rho
   algorithm. This supports 64-bit integers up to and including 2^63 - 1.
+- prime_factorize_fast(n) returns the prime factorization of an unsigned 64-bit
+  integer n. Trial division only tries the odd primes below 1024 from a table
+  built once, each as a multiplication by its inverse modulo 2^64 instead of a
+  division. Any remaining cofactor is tested with the deterministic 7-base
+  Miller-Rabin test and otherwise split by rho_factor(), which runs Brent's
+  variant of Pollard's rho algorithm in Montgomery form, accumulating products
+  of differences over blocks of 128 steps between binary gcds. No random
+  numbers are used, so that this may be called from several threads at once.
+- prime_factorize_all(v) returns the prime factorizations of every integer in v
+  as computed by prime_factorize_fast(), in parallel if compiled with -fopenmp.
+
+pollards_rho_brent() and the Miller-Rabin test used by prime_factorize_big()
+multiply in Montgomery form (see the montgomery class of section 5.3.6), so
+that no product modulo n needs a division.
 
 Time Complexity:
 - O(sqrt n) per call to prime_factorize(n), get_divisors(n), and fermat(n).
-- Unknown, but approximately O(n^(1/4)) per call to pollards_rho_brent(n) and
-  prime_factorize_big(n).
+- Unknown, but approximately O(n^(1/4)) per call to pollards_rho_brent(n),
+  prime_factorize_big(n), and prime_factorize_fast(n).
+- Approximately O(m*n^(1/4)) per call to prime_factorize_all(v), where m is the
+  size of v and n is its largest value.
 
 Space Complexity:
 - O(f) auxiliary heap space for all operations, where f is the number of factors
@@ -38,7 +54,11 @@ Space Complexity:
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <stdexcept>
 #include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 template<class Int>
 std::vector<Int> prime_factorize(Int n) {
@@ -104,27 +124,79 @@ long long fermat(long long n) {
 
 typedef unsigned long long uint64;
 
-uint64 mulmod(uint64 x, uint64 n, uint64 m) {
-  uint64 a = 0, b = x % m;
-  for (; n > 0; n >>= 1) {
-    if (n & 1) {
-      a = (a + b) % m;
+// Returns the high 64 bits of the 128-bit product of a and b.
+inline uint64 mulhi(uint64 a, uint64 b) {
+#ifdef __SIZEOF_INT128__
+  return (uint64)(((__uint128_t)a*b) >> 64);
+#else
+  uint64 ha = a >> 32, la = (unsigned int)a;
+  uint64 hb = b >> 32, lb = (unsigned int)b;
+  uint64 hl = ha*lb, lh = la*hb, ll = la*lb;
+  uint64 mid = (ll >> 32) + (unsigned int)hl + (unsigned int)lh;
+  return ha*hb + (hl >> 32) + (lh >> 32) + (mid >> 32);
+#endif
+}
+
+class montgomery {
+  uint64 m, inv, r2;
+
+ public:
+  explicit montgomery(uint64 m) : m(m), inv(m) {
+    if (m % 2 == 0) {
+      throw std::runtime_error("Montgomery modulus must be odd.");
+    }
+    // Each Newton iteration doubles the number of correct low bits of m^-1.
+    for (int i = 0; i < 5; i++) {
+      inv *= 2 - m*inv;
+    }
+    // Doubling 2^64 (mod m) another 64 times gives 2^128 (mod m).
+    r2 = (0 - m) % m;
+    for (int i = 0; i < 64; i++) {
+      r2 = (r2 >= m - r2) ? r2 - (m - r2) : r2 + r2;
     }
-    b = (b << 1) % m;
   }
-  return a % m;
-}
 
-uint64 powmod(uint64 x, uint64 n, uint64 m) {
-  uint64 a = 1, b = x;
-  for (; n > 0; n >>= 1) {
-    if (n & 1) {
-      a = mulmod(a, b, m);
+  uint64 modulus() const {
+    return m;
+  }
+
+  // Returns t/2^64 (mod m) for t = hi*2^64 + lo < m*2^64, in [0, m).
+  uint64 reduce(uint64 lo, uint64 hi) const {
+    uint64 q = mulhi(lo*inv, m);
+    return (hi >= q) ? hi - q : hi - q + m;
+  }
+
+  uint64 to(uint64 x) const {
+    return mul(x % m, r2);
+  }
+
+  uint64 from(uint64 x) const {
+    return reduce(x, 0);
+  }
+
+  uint64 mul(uint64 a, uint64 b) const {
+    return reduce(a*b, mulhi(a, b));
+  }
+
+  uint64 add(uint64 a, uint64 b) const {
+    return (a >= m - b) ? a - (m - b) : a + b;
+  }
+
+  uint64 sub(uint64 a, uint64 b) const {
+    return (a >= b) ? a - b : a - b + m;
+  }
+
+  uint64 pow(uint64 a, uint64 n) const {
+    uint64 res = to(1);
+    for (; n > 0; n >>= 1) {
+      if (n & 1) {
+        res = mul(res, a);
+      }
+      a = mul(a, a);
     }
-    b = mulmod(b, b, m);
+    return res;
   }
-  return a % m;
-}
+};
 
 uint64 rand64u() {
   return ((uint64)(rand() & 0xf) << 60) |
@@ -147,6 +219,9 @@ long long pollards_rho_brent(long long n) {
   if (n % 2 == 0) {
     return 2;
   }
+  // Values are iterated in Montgomery form, which leaves every gcd with n the
+  // same, since 2^64 is coprime to n.
+  montgomery mont(n);
   uint64 y = rand64u() % (n - 1) + 1;
   uint64 c = rand64u() % (n - 1) + 1;
   uint64 m = rand64u() % (n - 1) + 1;
@@ -154,21 +229,21 @@ long long pollards_rho_brent(long long n) {
   for (r = 1; g == 1; r <<= 1) {
     x = y;
     for (int i = 0; i < r; i++) {
-      y = (mulmod(y, y, n) + c) % n;
+      y = mont.add(mont.mul(y, y), c);
     }
     for (long long k = 0; k < r && g == 1; k += m) {
       ys = y;
       long long lim = std::min(m, r - k);
       for (int j = 0; j < lim; j++) {
-        y = (mulmod(y, y, n) + c) % n;
-        q = mulmod(q, (x > y) ? (x - y) : (y - x), n);
+        y = mont.add(mont.mul(y, y), c);
+        q = mont.mul(q, (x > y) ? (x - y) : (y - x));
       }
       g = gcd(q, n);
     }
   }
   if (g == n) {
     do {
-      ys = (mulmod(ys, ys, n) + c) % n;
+      ys = mont.add(mont.mul(ys, ys), c);
       g = gcd((x > ys) ? (x - ys) : (ys - x), n);
     } while (g <= 1);
   }
@@ -176,7 +251,10 @@ long long pollards_rho_brent(long long n) {
 }
 
 bool is_prime(long long n) {
-  static const int np = 9, p[] = {2, 3, 5, 7, 11, 13, 17, 19, 23};
+  // The first 12 primes as bases suffice for all n < 3.3*10^24, whereas
+  // 3825123056546413051 is a strong pseudoprime to the first 9.
+  static const int np = 12;
+  static const int p[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
   for (int i = 0; i < np; i++) {
     if (n % p[i] == 0) {
       return n == p[i];
@@ -190,15 +268,17 @@ bool is_prime(long long n) {
   for (t = n - 1; !(t & 1); t >>= 1) {
     s++;
   }
+  montgomery mont(n);
+  uint64 one = mont.to(1), minus_one = mont.to(n - 1);
   for (int i = 0; i < np; i++) {
-    uint64 r = powmod(p[i], t, n);
-    if (r == 1) {
+    uint64 r = mont.pow(mont.to(p[i]), t);
+    if (r == one) {
       continue;
     }
     bool ok = false;
     for (int j = 0; j < s && !ok; j++) {
-      ok |= (r == (uint64)n - 1);
-      r = mulmod(r, r, n);
+      ok |= (r == minus_one);
+      r = mont.mul(r, r);
     }
     if (!ok) {
       return false;
@@ -219,7 +299,8 @@ std::vector<long long> prime_factorize_big(
   for (; n % 3 == 0; n /= 3) {
     res.push_back(3);
   }
-  for (int i = 5, w = 4; i <= trial_division_cutoff && i*i <= n; i += w) {
+  for (long long i = 5, w = 4; i <= trial_division_cutoff && i*i <= n;
+       i += w) {
     for (; n % i == 0; n /= i) {
       res.push_back(i);
     }
@@ -238,12 +319,193 @@ std::vector<long long> prime_factorize_big(
   return res;
 }
 
-/*** Example Usage ***/
+// The odd primes below FACTOR_TRIAL_LIMIT, with their inverses modulo 2^64 and
+// the limits (2^64 - 1)/p, so that p divides n if and only if n*inv <= limit.
+const int FACTOR_TRIAL_LIMIT = 1024;
+
+struct factor_trial_table {
+  std::vector<uint64> prime, inv, limit;
+
+  factor_trial_table() {
+    std::vector<bool> composite(FACTOR_TRIAL_LIMIT, false);
+    for (int p = 3; p < FACTOR_TRIAL_LIMIT; p += 2) {
+      if (composite[p]) {
+        continue;
+      }
+      for (int j = p*p; j < FACTOR_TRIAL_LIMIT; j += 2*p) {
+        composite[j] = true;
+      }
+      uint64 x = p;
+      for (int i = 0; i < 5; i++) {
+        x *= 2 - p*x;
+      }
+      prime.push_back(p);
+      inv.push_back(x);
+      limit.push_back(~0ULL/p);
+    }
+  }
+};
+
+uint64 binary_gcd(uint64 a, uint64 b) {
+  if (a == 0 || b == 0) {
+    return a | b;
+  }
+  int shift = __builtin_ctzll(a | b);
+  a >>= __builtin_ctzll(a);
+  while (b != 0) {
+    b >>= __builtin_ctzll(b);
+    if (a > b) {
+      std::swap(a, b);
+    }
+    b -= a;
+  }
+  return a << shift;
+}
+
+// Deterministic Miller-Rabin for all odd n < 2^64 with Jim Sinclair's 7 bases.
+bool is_prime_u64(uint64 n) {
+  static const uint64 base[] = {
+    2, 325, 9375, 28178, 450775, 9780504, 1795265022
+  };
+  if (n < 2 || n % 2 == 0) {
+    return n == 2;
+  }
+  uint64 d = n - 1;
+  int s = 0;
+  for (; !(d & 1); d >>= 1) {
+    s++;
+  }
+  montgomery mont(n);
+  uint64 one = mont.to(1), minus_one = n - one;
+  for (int i = 0; i < 7; i++) {
+    uint64 a = base[i] % n;
+    if (a == 0) {
+      continue;
+    }
+    uint64 r = mont.pow(mont.to(a), d);
+    bool ok = (r == one || r == minus_one);
+    for (int j = 1; j < s && !ok; j++) {
+      r = mont.mul(r, r);
+      ok = (r == minus_one);
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns a factor of the odd composite n found by Pollard's rho algorithm with
+// Brent's cycle detection on x -> x^2 + c in Montgomery form, multiplying the
+// differences of blocks of 128 steps together before each gcd with n. This
+// returns n if the iteration failed, in which case another c should be tried.
+uint64 rho_factor(uint64 n, uint64 c) {
+  static const uint64 BLOCK = 128;
+  montgomery mont(n);
+  c = mont.to(c);
+  uint64 x = 0, y = mont.to(2), ys = y, q = mont.to(1), g = 1;
+  for (uint64 r = 1; g == 1; r <<= 1) {
+    x = y;
+    for (uint64 i = 0; i < r; i++) {
+      y = mont.add(mont.mul(y, y), c);
+    }
+    for (uint64 k = 0; k < r && g == 1; k += BLOCK) {
+      ys = y;
+      for (uint64 j = 0; j < BLOCK && j < r - k; j++) {
+        y = mont.add(mont.mul(y, y), c);
+        q = mont.mul(q, (x > y) ? x - y : y - x);
+      }
+      g = binary_gcd(q, n);
+    }
+  }
+  if (g == n) {
+    // The block overshot, so step through it again one gcd at a time.
+    do {
+      ys = mont.add(mont.mul(ys, ys), c);
+      g = binary_gcd((x > ys) ? x - ys : ys - x, n);
+    } while (g == 1);
+  }
+  return g;
+}
+
+std::vector<uint64> prime_factorize_fast(uint64 n) {
+  static const factor_trial_table t;
+  if (n <= 3) {
+    return std::vector<uint64>(1, n);
+  }
+  std::vector<uint64> res;
+  for (; n % 2 == 0; n /= 2) {
+    res.push_back(2);
+  }
+  for (int i = 0; i < (int)t.prime.size() && t.prime[i]*t.prime[i] <= n; i++) {
+    for (; n*t.inv[i] <= t.limit[i]; n = n*t.inv[i]) {
+      res.push_back(t.prime[i]);
+    }
+  }
+  std::vector<uint64> pending;
+  if (n > 1) {
+    pending.push_back(n);
+  }
+  while (!pending.empty()) {
+    uint64 m = pending.back();
+    pending.pop_back();
+    if (m < (uint64)FACTOR_TRIAL_LIMIT*FACTOR_TRIAL_LIMIT || is_prime_u64(m)) {
+      res.push_back(m);
+      continue;
+    }
+    uint64 d = m;
+    for (uint64 c = 1; d == m; c++) {
+      d = rho_factor(m, c);
+    }
+    pending.push_back(d);
+    pending.push_back(m/d);
+  }
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+std::vector<std::vector<uint64> > prime_factorize_all(
+    const std::vector<uint64> &v) {
+  std::vector<std::vector<uint64> > res(v.size());
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 64)
+#endif
+  for (int i = 0; i < (int)v.size(); i++) {
+    res[i] = prime_factorize_fast(v[i]);
+  }
+  return res;
+}
+
+/*** Example Usage and Output:
+
+Factored 1000 products of two 31-bit primes in 2.20s
+prime_factorize_all() on 1000 products of two 31-bit primes in 0.44s
+prime_factorize_all() on 1000 products of two 32-bit primes in 0.63s
+prime_factorize_all() on 100000 random 64-bit integers in 2.24s
+
+***/
 
 #include <cassert>
+#include <cstdio>
+#include <ctime>
 #include <set>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
 using namespace std;
 
+// Returns the wall clock time in seconds. On Windows, clock() measures wall
+// time rather than processor time.
+double wall_time() {
+#ifdef _WIN32
+  return (double)clock()/CLOCKS_PER_SEC;
+#else
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+#endif
+}
+
 void validate(long long n, const vector<long long> &factors) {
   if (n == 1 || is_prime(n)) {
     assert(factors == vector<long long>(1, n));
@@ -293,5 +555,97 @@ int main() {
       validate(tests[i], prime_factorize_big(tests[i]));
     }
   }
+  { // Products of two primes of about 31 bits, the hardest case for rho.
+    double start = wall_time();
+    for (int i = 0; i < 1000; i++) {
+      long long p = rand64u() >> 33 | (1LL << 30), q = rand64u() >> 33;
+      for (; !is_prime(p); p++) {}
+      for (q |= 1LL << 30; !is_prime(q); q++) {}
+      vector<long long> f = prime_factorize_big(p*q);
+      assert(f.size() == 2 && f[0] == min(p, q) && f[1] == max(p, q));
+    }
+    printf("Factored 1000 products of two 31-bit primes in %.2fs\n",
+           wall_time() - start);
+  }
+  { // The fast engine against the existing one, and beyond 2^63.
+    for (uint64 i = 0; i <= 100000; i++) {
+      vector<uint64> f = prime_factorize_fast(i);
+      vector<long long> g = prime_factorize((long long)i);
+      assert(f == vector<uint64>(g.begin(), g.end()));
+    }
+    for (int i = 0; i < 2000; i++) {
+      long long n = rand64u() >> 1;
+      vector<uint64> f = prime_factorize_fast(n);
+      vector<long long> g = prime_factorize_big(n);
+      assert(f == vector<uint64>(g.begin(), g.end()));
+    }
+    const uint64 p = 4294967291ULL, q = 4294967279ULL;
+    const uint64 tests[] = {
+      18446744073709551615ULL, 18446744073709551557ULL, p*q, p*p, 1031*1031,
+      3ULL*3*1031*1031*1033*1033, 3825123056546413051ULL, 1ULL << 63, 0, 1
+    };
+    vector<uint64> v(tests, tests + 10);
+    for (int i = 0; i < 1000; i++) {
+      v.push_back(rand64u());
+    }
+    vector<vector<uint64> > all = prime_factorize_all(v);
+    assert(all[0].size() == 7 && all[0][6] == 6700417ULL);
+    assert(all[1] == vector<uint64>(1, tests[1]));
+    assert(all[2].size() == 2 && all[2][0] == q && all[2][1] == p);
+    assert(all[3].size() == 2 && all[3][0] == p && all[3][1] == p);
+    assert(all[7] == vector<uint64>(63, 2));
+    assert(all[8] == vector<uint64>(1, 0) && all[9] == vector<uint64>(1, 1));
+    for (int i = 0; i < (int)v.size(); i++) {
+      if (v[i] < 2) {
+        continue;
+      }
+      uint64 prod = 1;
+      for (int j = 0; j < (int)all[i].size(); j++) {
+        assert(is_prime_u64(all[i][j]));
+        assert(j == 0 || all[i][j - 1] <= all[i][j]);
+        prod *= all[i][j];
+      }
+      assert(prod == v[i]);
+    }
+  }
+  { // The same semiprimes as above, and products of two 32-bit primes.
+    srand(0);
+    vector<uint64> v;
+    for (int i = 0; i < 1000; i++) {
+      long long p = rand64u() >> 33 | (1LL << 30), q = rand64u() >> 33;
+      for (; !is_prime(p); p++) {}
+      for (q |= 1LL << 30; !is_prime(q); q++) {}
+      v.push_back(p*q);
+    }
+    double start = wall_time();
+    vector<vector<uint64> > f = prime_factorize_all(v);
+    printf("prime_factorize_all() on 1000 products of two 31-bit primes in "
+           "%.2fs\n", wall_time() - start);
+    for (int i = 0; i < (int)v.size(); i++) {
+      assert(f[i].size() == 2 && f[i][0]*f[i][1] == v[i]);
+    }
+    v.clear();
+    for (int i = 0; i < 1000; i++) {
+      uint64 p = rand64u() >> 32 | (1ULL << 31), q = rand64u() >> 32;
+      for (; !is_prime_u64(p); p++) {}
+      for (q |= 1ULL << 31; !is_prime_u64(q); q++) {}
+      v.push_back(p*q);
+    }
+    start = wall_time();
+    f = prime_factorize_all(v);
+    printf("prime_factorize_all() on 1000 products of two 32-bit primes in "
+           "%.2fs\n", wall_time() - start);
+    for (int i = 0; i < (int)v.size(); i++) {
+      assert(f[i].size() == 2 && f[i][0]*f[i][1] == v[i]);
+    }
+    v.clear();
+    for (int i = 0; i < 100000; i++) {
+      v.push_back(rand64u());
+    }
+    start = wall_time();
+    f = prime_factorize_all(v);
+    printf("prime_factorize_all() on 100000 random 64-bit integers in %.2fs\n",
+           wall_time() - start);
+  }
   return 0;
 }
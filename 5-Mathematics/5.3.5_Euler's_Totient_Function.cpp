@@ -6,15 +6,37 @@ of integers k in the range [1, n] for which gcd(n, k) = 1. The computation of
 phi(1..n) can be performed simultaneously, as done so by phi_table(n) which
 returns a vector v such that v[i] stores phi(i) for i in the range [0, n].
 
+The linear_sieve class instead computes phi(i) together with the smallest prime
+factor spf(i) and the Mobius function mu(i) for every i in [0, n] in a single
+pass of the linear (Euler) sieve, which crosses off each composite exactly once
+by its smallest prime factor. The tables use 32-bit integers (8-bit for mu), so
+n may be as large as 2^32 - 2 given enough memory.
+
+- linear_sieve(n) constructs the tables for [0, n], where spf(0) = spf(1) = 0,
+  phi(0) = 0, phi(1) = 1, mu(0) = 0, and mu(1) = 1.
+- factorize_with_spf(s, n, out) writes the prime factorization of n, where
+  2 <= n <= s.size(), to out in nondecreasing order as successive smallest prime
+  factors and returns the number of factors written (at most 32).
+- factorize_with_spf(s, n) returns the same factorization as a vector, using the
+  representation of prime_factorize() in section 5.3.4.
+
 Time Complexity:
-- O(n log(log(n))) per call to phi(n) and phi_table(n).
+- O(sqrt n) per call to phi(n).
+- O(n log n) per call to phi_table(n).
+- O(n) per call to the linear_sieve constructor.
+- O(1) per call to spf(i), phi(i), mu(i), and linear_sieve::size().
+- O(log n) per call to factorize_with_spf(s, n, out) and
+  factorize_with_spf(s, n).
 
 Space Complexity:
 - O(1) auxiliary space for phi(n).
-- O(n) auxiliary heap space for phi_table(n).
+- O(n) auxiliary heap space for phi_table(n) and linear_sieve(n), the latter
+  using 9 bytes per number plus 4 bytes per prime up to n.
+- O(1) auxiliary space for factorize_with_spf(s, n, out).
 
 */
 
+#include <stdexcept>
 #include <vector>
 
 int phi(int n) {
@@ -46,11 +68,114 @@ std::vector<int> phi_table(int n) {
   return res;
 }
 
-/*** Example Usage ***/
+class linear_sieve {
+  std::vector<unsigned int> min_factor, totient, prime_list;
+  std::vector<signed char> mobius;
+
+ public:
+  explicit linear_sieve(unsigned int n) {
+    if (n >= 0xffffffffU) {
+      throw std::runtime_error("Upper bound must be less than 2^32 - 1.");
+    }
+    min_factor.assign(n + 1, 0);
+    totient.assign(n + 1, 0);
+    mobius.assign(n + 1, 0);
+    if (n >= 1) {
+      totient[1] = mobius[1] = 1;
+    }
+    for (unsigned int i = 2; i <= n; i++) {
+      if (min_factor[i] == 0) {
+        min_factor[i] = i;
+        totient[i] = i - 1;
+        mobius[i] = -1;
+        prime_list.push_back(i);
+      }
+      unsigned int f = min_factor[i], t = totient[i];
+      int m = mobius[i];
+      for (size_t j = 0; j < prime_list.size(); j++) {
+        unsigned int p = prime_list[j];
+        if (p > f || (unsigned long long)i*p > n) {
+          break;
+        }
+        unsigned int k = i*p;
+        min_factor[k] = p;
+        if (p == f) {
+          totient[k] = t*p;
+          mobius[k] = 0;
+        } else {
+          totient[k] = t*(p - 1);
+          mobius[k] = -m;
+        }
+      }
+    }
+  }
+
+  unsigned int size() const {
+    return min_factor.size() - 1;
+  }
+
+  unsigned int spf(unsigned int i) const {
+    return min_factor[i];
+  }
+
+  unsigned int phi(unsigned int i) const {
+    return totient[i];
+  }
+
+  int mu(unsigned int i) const {
+    return mobius[i];
+  }
+
+  const std::vector<unsigned int>& primes() const {
+    return prime_list;
+  }
+};
+
+int factorize_with_spf(const linear_sieve &s, unsigned int n,
+                       unsigned int *out) {
+  int count = 0;
+  while (n > 1) {
+    unsigned int p = s.spf(n);
+    out[count++] = p;
+    n /= p;
+  }
+  return count;
+}
+
+std::vector<unsigned int> factorize_with_spf(const linear_sieve &s,
+                                             unsigned int n) {
+  unsigned int buf[32];
+  int count = factorize_with_spf(s, n, buf);
+  return std::vector<unsigned int>(buf, buf + count);
+}
+
+/*** Example Usage and Output:
+
+phi_table(10000000): 1.008s
+linear_sieve(10000000): 0.232s
+factorize_with_spf() x 10000000: 1.120s (37859851 factors)
+
+***/
 
 #include <cassert>
+#include <cstdio>
+#include <ctime>
 using namespace std;
 
+int mu_naive(int n) {
+  int res = 1;
+  for (int i = 2; i*i <= n; i++) {
+    if (n % i == 0) {
+      n /= i;
+      if (n % i == 0) {
+        return 0;
+      }
+      res = -res;
+    }
+  }
+  return (n > 1) ? -res : res;
+}
+
 int main() {
   assert(phi(1) == 1);
   assert(phi(9) == 6);
@@ -60,5 +185,43 @@ int main() {
   for (int i = 0; i <= n; i++) {
     assert(v[i] == phi(i));
   }
+
+  linear_sieve s(n);
+  assert(s.size() == n && s.primes().size() == 168);
+  assert(s.spf(0) == 0 && s.spf(1) == 0 && s.phi(0) == 0 && s.mu(0) == 0);
+  for (int i = 1; i <= n; i++) {
+    assert((int)s.phi(i) == v[i] && s.mu(i) == mu_naive(i));
+    if (i >= 2) {
+      vector<unsigned int> f = factorize_with_spf(s, i);
+      unsigned int prod = 1;
+      for (int j = 0; j < (int)f.size(); j++) {
+        assert(s.spf(f[j]) == f[j] && (j == 0 || f[j - 1] <= f[j]));
+        prod *= f[j];
+      }
+      assert(prod == (unsigned int)i && s.spf(i) == f[0]);
+    }
+  }
+  assert(linear_sieve(0).size() == 0 && linear_sieve(1).mu(1) == 1);
+
+  const int m = 10000000;
+  clock_t start = clock();
+  v = phi_table(m);
+  printf("phi_table(%d): %.3fs\n", m, (double)(clock() - start)/CLOCKS_PER_SEC);
+  start = clock();
+  linear_sieve big(m);
+  printf("linear_sieve(%d): %.3fs\n", m,
+         (double)(clock() - start)/CLOCKS_PER_SEC);
+  for (int i = 0; i <= m; i += 997) {
+    assert((int)big.phi(i) == v[i]);
+  }
+  unsigned int x = 12345, buf[32];
+  long long total = 0;
+  start = clock();
+  for (int i = 0; i < m; i++) {
+    x = x*1103515245U + 12345U;
+    total += factorize_with_spf(big, 2 + x % (m - 1), buf);
+  }
+  printf("factorize_with_spf() x %d: %.3fs (%lld factors)\n", m,
+         (double)(clock() - start)/CLOCKS_PER_SEC, total);
   return 0;
 }
@@ -2,27 +2,71 @@
 
 Given three unsigned 64-bit integers x, n, and m, powmod() returns x raised to
 the power of n (modulo m). mulmod() returns x multiplied by n (modulo m).
-Despite the fact that both functions use unsigned 64-bit integers for arguments
-and intermediate calculations, arguments x and n must not exceed 2^63 - 1 (the
-maximum value of a signed 64-bit integer) for the result to be correctly
-computed without overflow.
 
 Binary exponentiation, also known as exponentiation by squaring, decomposes the
 exponentiation into a logarithmic number of multiplications while avoiding
-overflow. To further prevent overflow in the intermediate squaring computations,
-multiplication is performed using a similar principle of repeated addition.
+overflow. Where the compiler supports 128-bit integers (as do GCC and Clang on
+64-bit targets), mulmod() takes the remainder of the full 128-bit product, and
+supports all 64-bit arguments. Otherwise, multiplication is performed using a
+similar principle of repeated addition, in which case arguments x and n must
+not exceed 2^63 - 1 (the maximum value of a signed 64-bit integer) for the
+result to be correctly computed without overflow.
+
+The following avoid division altogether for many products with the same
+modulus, by replacing each remainder with multiplications by precomputed
+constants.
+
+- montgomery(m) precomputes m^-1 (mod 2^64) by Newton's iteration, as well as
+  2^128 (mod m), for an odd modulus m. Values are kept in Montgomery form, where
+  x is represented by x*2^64 (mod m), so that the product of two values needs
+  only the reduction of Montgomery (1985), which takes two 64-bit by 64-bit
+  multiplications besides the product itself.
+  - to(x) and from(x) convert x into and out of Montgomery form.
+  - mul(a, b), add(a, b), sub(a, b), and pow(a, n) operate on values in
+    Montgomery form, returning the result in Montgomery form.
+  - reduce(lo, hi) returns t*2^-64 (mod m) for t = hi*2^64 + lo < m*2^64.
+- barrett(m) precomputes floor((2^64 - 1)/m) for a modulus m less than 2^32,
+  from which reduce(x) computes x (mod m) for any 64-bit x by Barrett reduction
+  with a single multiplication, and mul(a, b) and pow(a, n) work on values in
+  [0, m), as for powmod(). Unlike montgomery, the modulus may be even.
+- modint<M> is an integer modulo a modulus M less than 2^32 that is fixed at
+  compile time, supporting +, -, *, ==, !=, and pow(n). Since the modulus is a
+  constant expression, compilers replace each remainder by a multiplication and
+  shift as in barrett, with no precomputation at runtime.
 
 Time Complexity:
-- O(log n) per call to mulmod() and powmod(), where n is the second argument.
+- O(1) per call to mulmod(), or O(log n) without 128-bit integers, where n is
+  the second argument.
+- O(log n) multiplications per call to powmod() and pow(), where n is the
+  exponent.
+- O(1) per call to the constructors and all other operations.
 
 Space Complexity:
 - O(1) auxiliary.
 
 */
 
+#include <stdexcept>
+
 typedef unsigned long long uint64;
 
+// Returns the high 64 bits of the 128-bit product of a and b.
+inline uint64 mulhi(uint64 a, uint64 b) {
+#ifdef __SIZEOF_INT128__
+  return (uint64)(((__uint128_t)a*b) >> 64);
+#else
+  uint64 ha = a >> 32, la = (unsigned int)a;
+  uint64 hb = b >> 32, lb = (unsigned int)b;
+  uint64 hl = ha*lb, lh = la*hb, ll = la*lb;
+  uint64 mid = (ll >> 32) + (unsigned int)hl + (unsigned int)lh;
+  return ha*hb + (hl >> 32) + (lh >> 32) + (mid >> 32);
+#endif
+}
+
 uint64 mulmod(uint64 x, uint64 n, uint64 m) {
+#ifdef __SIZEOF_INT128__
+  return (uint64)((__uint128_t)x*n % m);
+#else
   uint64 a = 0, b = x % m;
   for (; n > 0; n >>= 1) {
     if (n & 1) {
@@ -31,6 +75,7 @@ uint64 mulmod(uint64 x, uint64 n, uint64 m) {
     b = (b << 1) % m;
   }
   return a % m;
+#endif
 }
 
 uint64 powmod(uint64 x, uint64 n, uint64 m) {
@@ -44,13 +89,295 @@ uint64 powmod(uint64 x, uint64 n, uint64 m) {
   return a % m;
 }
 
-/*** Example Usage ***/
+class montgomery {
+  uint64 m, inv, r2;
+
+ public:
+  explicit montgomery(uint64 m) : m(m), inv(m) {
+    if (m % 2 == 0) {
+      throw std::runtime_error("Montgomery modulus must be odd.");
+    }
+    // Each Newton iteration doubles the number of correct low bits of m^-1.
+    for (int i = 0; i < 5; i++) {
+      inv *= 2 - m*inv;
+    }
+    // Doubling 2^64 (mod m) another 64 times gives 2^128 (mod m).
+    r2 = (0 - m) % m;
+    for (int i = 0; i < 64; i++) {
+      r2 = (r2 >= m - r2) ? r2 - (m - r2) : r2 + r2;
+    }
+  }
+
+  uint64 modulus() const {
+    return m;
+  }
+
+  // Returns t/2^64 (mod m) for t = hi*2^64 + lo < m*2^64, in [0, m).
+  uint64 reduce(uint64 lo, uint64 hi) const {
+    uint64 q = mulhi(lo*inv, m);
+    return (hi >= q) ? hi - q : hi - q + m;
+  }
+
+  uint64 to(uint64 x) const {
+    return mul(x % m, r2);
+  }
+
+  uint64 from(uint64 x) const {
+    return reduce(x, 0);
+  }
+
+  uint64 mul(uint64 a, uint64 b) const {
+    return reduce(a*b, mulhi(a, b));
+  }
+
+  uint64 add(uint64 a, uint64 b) const {
+    return (a >= m - b) ? a - (m - b) : a + b;
+  }
+
+  uint64 sub(uint64 a, uint64 b) const {
+    return (a >= b) ? a - b : a - b + m;
+  }
+
+  uint64 pow(uint64 a, uint64 n) const {
+    uint64 res = to(1);
+    for (; n > 0; n >>= 1) {
+      if (n & 1) {
+        res = mul(res, a);
+      }
+      a = mul(a, a);
+    }
+    return res;
+  }
+};
+
+class barrett {
+  uint64 m, im;
+
+ public:
+  explicit barrett(unsigned int m) : m(m), im(~0ULL/m) {}
+
+  unsigned int modulus() const {
+    return m;
+  }
+
+  // Returns x (mod m) for any 64-bit x, since the quotient estimate taken from
+  // the precomputed floor((2^64 - 1)/m) is short of the true one by at most 1.
+  unsigned int reduce(uint64 x) const {
+    uint64 r = x - mulhi(x, im)*m;
+    return (r >= m) ? r - m : r;
+  }
+
+  unsigned int mul(unsigned int a, unsigned int b) const {
+    return reduce((uint64)a*b);
+  }
+
+  unsigned int pow(unsigned int a, uint64 n) const {
+    unsigned int res = reduce(1);
+    for (a = reduce(a); n > 0; n >>= 1) {
+      if (n & 1) {
+        res = mul(res, a);
+      }
+      a = mul(a, a);
+    }
+    return res;
+  }
+};
+
+template<unsigned int M>
+class modint {
+  unsigned int v;
+
+ public:
+  modint(uint64 x = 0) : v(x % M) {}
+
+  unsigned int value() const {
+    return v;
+  }
+
+  modint operator+(const modint &b) const {
+    modint res;
+    res.v = (v >= M - b.v) ? v - (M - b.v) : v + b.v;
+    return res;
+  }
+
+  modint operator-(const modint &b) const {
+    modint res;
+    res.v = (v >= b.v) ? v - b.v : v + (M - b.v);
+    return res;
+  }
+
+  modint operator*(const modint &b) const {
+    return modint((uint64)v*b.v);
+  }
+
+  bool operator==(const modint &b) const {
+    return v == b.v;
+  }
+
+  bool operator!=(const modint &b) const {
+    return v != b.v;
+  }
+
+  modint pow(uint64 n) const {
+    modint res(1), a = *this;
+    for (; n > 0; n >>= 1) {
+      if (n & 1) {
+        res = res*a;
+      }
+      a = a*a;
+    }
+    return res;
+  }
+};
+
+/*** Example Usage and Output:
+
+200000 powmod() with a 63-bit modulus:
+  repeated addition 9.47s (estimated), 128-bit 0.144s, montgomery 0.071s
+200000 powmod() with modulus 10^9 + 7:
+  128-bit 0.049s, barrett 0.026s, modint 0.019s
+
+***/
 
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+using namespace std;
+
+uint64 mulmod_repeated_addition(uint64 x, uint64 n, uint64 m) {
+  uint64 a = 0, b = x % m;
+  for (; n > 0; n >>= 1) {
+    if (n & 1) {
+      a = (a + b) % m;
+    }
+    b = (b << 1) % m;
+  }
+  return a % m;
+}
+
+uint64 powmod_repeated_addition(uint64 x, uint64 n, uint64 m) {
+  uint64 a = 1, b = x;
+  for (; n > 0; n >>= 1) {
+    if (n & 1) {
+      a = mulmod_repeated_addition(a, b, m);
+    }
+    b = mulmod_repeated_addition(b, b, m);
+  }
+  return a % m;
+}
+
+uint64 rand64u() {
+  return ((uint64)(rand() & 0xf) << 60) |
+         ((uint64)(rand() & 0x7fff) << 45) |
+         ((uint64)(rand() & 0x7fff) << 30) |
+         ((uint64)(rand() & 0x7fff) << 15) |
+         ((uint64)(rand() & 0x7fff));
+}
+
+void test_random() {
+  for (int i = 0; i < 100000; i++) {
+    uint64 m = rand64u() >> (1 + rand() % 62), x = rand64u(), y = rand64u();
+    m = (m < 2) ? 3 : m;
+    if (m < (1ULL << 63)) {
+      uint64 a = x >> 1, b = y >> 1;
+      assert(mulmod(a, b, m) == mulmod_repeated_addition(a, b, m));
+    }
+#ifdef __SIZEOF_INT128__
+    m |= (rand() % 2 == 0) ? (1ULL << 63) : 0;
+#endif
+    m |= 1;
+    montgomery mont(m);
+    uint64 a = mont.to(x), b = mont.to(y);
+    assert(mont.from(a) == x % m && mont.from(b) == y % m);
+    assert(mont.from(mont.mul(a, b)) == mulmod(x, y, m));
+    uint64 xm = x % m, ym = y % m;
+    assert(mont.from(mont.add(a, b)) == (xm >= m - ym ? xm - (m - ym)
+                                                       : xm + ym));
+    assert(mont.from(mont.sub(a, b)) == (xm >= ym ? xm - ym : xm + (m - ym)));
+    assert(mont.sub(mont.add(a, b), b) == a);
+    uint64 n = rand64u() >> (rand() % 64);
+    if (i % 16 == 0) {
+      assert(mont.from(mont.pow(a, n)) == powmod(x % m, n, m));
+    }
+    unsigned int m32 = rand64u() >> (32 + rand() % 32);
+    if (m32 > 0) {
+      barrett bar(m32);
+      assert(bar.reduce(x) == x % m32);
+      assert(bar.mul(x % m32, y % m32) == mulmod(x, y, m32));
+      if (i % 16 == 0) {
+        assert(bar.pow(x % m32, n) == powmod(x, n, m32));
+      }
+    }
+  }
+  modint<1000000007> a(rand64u()), b(rand64u());
+  assert((a - b) + b == a && a*b == b*a && (a + b)*b == a*b + b*b);
+  assert(a.pow(1000000006) == modint<1000000007>(1));
+  assert(modint<6>(5)*modint<6>(5) == modint<6>(1));
+  bool thrown = false;
+  try {
+    montgomery bad(100);
+  } catch (runtime_error &) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void benchmark() {
+  const int k = 200000;
+  uint64 m = 9223372036854775783ULL, x = 1234567, sum = 0;
+  clock_t start = clock();
+  for (int i = 0; i < k/20; i++) {
+    sum += powmod_repeated_addition(x + i, m - 1, m);
+  }
+  double slow = (double)(clock() - start)/CLOCKS_PER_SEC*20;
+  start = clock();
+  for (int i = 0; i < k; i++) {
+    sum += powmod(x + i, m - 1, m);
+  }
+  double wide = (double)(clock() - start)/CLOCKS_PER_SEC;
+  montgomery mont(m);
+  start = clock();
+  for (int i = 0; i < k; i++) {
+    sum += mont.from(mont.pow(mont.to(x + i), m - 1));
+  }
+  double fast = (double)(clock() - start)/CLOCKS_PER_SEC;
+  printf("%d powmod() with a 63-bit modulus:\n", k);
+  printf("  repeated addition %.2fs (estimated), 128-bit %.3fs, "
+         "montgomery %.3fs\n", slow, wide, fast);
+  const unsigned int p = 1000000007;
+  barrett bar(p);
+  modint<p> total;
+  start = clock();
+  for (int i = 0; i < k; i++) {
+    sum += powmod(x + i, p - 2, p);
+  }
+  wide = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  for (int i = 0; i < k; i++) {
+    sum += bar.pow(x + i, p - 2);
+  }
+  fast = (double)(clock() - start)/CLOCKS_PER_SEC;
+  start = clock();
+  for (int i = 0; i < k; i++) {
+    total = total + modint<p>(x + i).pow(p - 2);
+  }
+  double fixed = (double)(clock() - start)/CLOCKS_PER_SEC;
+  printf("%d powmod() with modulus 10^9 + 7:\n", k);
+  printf("  128-bit %.3fs, barrett %.3fs, modint %.3fs\n", wide, fast, fixed);
+  assert(sum != 0 || total.value() != 0);
+}
 
 int main() {
   assert(powmod(2, 10, 1000000007) == 1024);
   assert(powmod(2, 62, 1000000) == 387904);
   assert(powmod(10001, 10001, 100000) == 10001);
+  montgomery mont(1000000007);
+  assert(mont.from(mont.pow(mont.to(2), 10)) == 1024);
+  barrett bar(1000000);
+  assert(bar.pow(2, 62) == 387904);
+  assert(modint<100000>(10001).pow(10001).value() == 10001);
+  test_random();
+  benchmark();
   return 0;
 }
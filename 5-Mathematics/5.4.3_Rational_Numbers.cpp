@@ -15,10 +15,24 @@ for in internal operations.
   integer v converted to an std::string, long long, double, and long double
   respectively.
 - operators <, >, <=, >=, ==, !=, +, -, *, /, %, ++, --, +=, -=, *=, /=, and %=
-  are defined analogous to those on numerical primitives.
+  are defined analogous to those on numerical primitives. Results are always in
+  lowest terms, but addition, subtraction, multiplication, and division follow
+  Knuth (TAOCP 4.5.1) in taking gcds of the operands' numerators and
+  denominators rather than of the much larger unreduced results. For example,
+  the sum of two fractions whose denominators are coprime needs no reduction.
+- gcd(a, b) returns the nonnegative greatest common divisor of a and b, using
+  Stein's binary algorithm for int and long long and Euclid's algorithm for any
+  other integer type. A type with a faster gcd() of its own, such as bigint in
+  section 5.4.2 with Lehmer's algorithm, is found by argument-dependent lookup
+  and used instead. The result must fit in the type, so gcd(m, 0), gcd(0, m),
+  and gcd(m, m) are not supported for the minimum value m of a signed type,
+  such as LLONG_MIN, since their result would be -m.
 
 Time Complexity:
-- O(log(n + d)) per call to constructor rational(n, d).
+- O(log(n + d)) per call to constructor rational(n, d) and to gcd(n, d).
+- O(log n) per call to arithmetic operators, where n is the largest numerator
+  or denominator involved, assuming that operations on the template integer
+  type are O(1).
 - O(1) per call to all other operations, assuming that corresponding operations
   on the template integer type are O(1) as well.
 
@@ -31,12 +45,59 @@ Space Complexity:
 #include <istream>
 #include <ostream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 
+template<class Int>
+Int gcd(const Int &a, const Int &b) {
+  Int x(a < 0 ? -a : a), y(b < 0 ? -b : b), tmp;
+  while (y != 0) {
+    tmp = x % y;
+    x = y;
+    y = tmp;
+  }
+  return x;
+}
+
+// Stein's algorithm: after removing the common power of 2, both numbers are
+// kept odd, and the larger is replaced by the difference with its trailing
+// zeros removed. The loop has no data-dependent branches beyond its exit.
+long long gcd(long long a, long long b) {
+  unsigned long long x = (a < 0) ? -(unsigned long long)a : a;
+  unsigned long long y = (b < 0) ? -(unsigned long long)b : b;
+  if (x == 0 || y == 0) {
+    return x | y;
+  }
+  int xz = __builtin_ctzll(x), yz = __builtin_ctzll(y);
+  int shift = (xz < yz) ? xz : yz;
+  y >>= yz;
+  while (x != 0) {
+    x >>= xz;
+    // Both are odd and below 2^63, so y - x fits and is even unless zero.
+    long long diff = (long long)(y - x);
+    xz = __builtin_ctzll((unsigned long long)diff | (1ULL << 63));
+    y = (x < y) ? x : y;
+    x = (diff < 0) ? -diff : diff;
+  }
+  return y << shift;
+}
+
+int gcd(int a, int b) {
+  return (int)gcd((long long)a, (long long)b);
+}
+
 template<class Int = long long>
 class rational {
   Int num, den;
 
+  // Constructs n/d without reducing, where d > 0 and gcd(n, d) = 1.
+  static rational make(const Int &n, const Int &d) {
+    rational res;
+    res.num = n;
+    res.den = d;
+    return res;
+  }
+
  public:
   rational(): num(0), den(1) {}
   rational(const Int &n) : num(n), den(1) {}
@@ -50,15 +111,9 @@ class rational {
       num = -num;
       den = -den;
     }
-    Int a(num < 0 ? -num : num), b(den), tmp;
-    while (a != 0 && b != 0) {
-      tmp = a % b;
-      a = b;
-      b = tmp;
-    }
-    Int gcd = (b == 0) ? a : b;
-    num /= gcd;
-    den /= gcd;
+    Int g = gcd(num, den);
+    num /= g;
+    den /= g;
   }
 
   friend std::istream& operator>>(std::istream &in, rational &r) {
@@ -160,7 +215,7 @@ class rational {
   }
 
   rational abs() const {
-    return rational(num < 0 ? -num : num, den);
+    return make(num < 0 ? -num : num, den);
   }
 
   friend rational abs(const rational &r) { return r.abs(); }
@@ -174,19 +229,32 @@ class rational {
   }
 
   rational operator+(const rational &r) const {
-    return rational(num*r.den + r.num*den, den*r.den);
+    Int g = gcd(den, r.den);
+    if (g == 1) {
+      return make(num*r.den + r.num*den, den*r.den);
+    }
+    Int s = den/g, t = num*(r.den/g) + r.num*s;
+    if (t == 0) {
+      return rational();
+    }
+    Int g2 = gcd(t, g);
+    return make(t/g2, s*(r.den/g2));
   }
 
   rational operator-(const rational &r) const {
-    return rational(num*r.den - r.num*den, r.den*den);
+    return *this + make(-r.num, r.den);
   }
 
   rational operator*(const rational &r) const {
-    return rational(num*r.num, r.den*den);
+    Int g1 = gcd(num, r.den), g2 = gcd(r.num, den);
+    return make((num/g1)*(r.num/g2), (den/g2)*(r.den/g1));
   }
 
   rational operator/(const rational &r) const {
-    return rational(num*r.den, den*r.num);
+    if (r.num == 0) {
+      throw std::runtime_error("Division by zero in rational.");
+    }
+    return *this * (r.num < 0 ? make(-r.den, -r.num) : make(r.den, r.num));
   }
 
   rational operator%(const rational &r) const {
@@ -218,7 +286,7 @@ class rational {
     return rational(a) % b;
   }
 
-  rational operator-() const { return rational(-num, den); }
+  rational operator-() const { return make(-num, den); }
   rational operator++(int) { rational t(*this); operator++(); return t; }
   rational operator--(int) { rational t(*this); operator--(); return t; }
   rational& operator++() { *this = *this + 1; return *this; }
@@ -230,10 +298,17 @@ class rational {
   rational& operator%=(const rational &r) { *this = *this % r; return *this; }
 };
 
-/*** Example Usage ***/
+/*** Example Usage and Output:
+
+1000000 rounds of 5 operations in 0.793s (572904 negative)
+
+***/
 
 #include <cassert>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
 
 int main() {
   #define EQ(a, b) (fabs((a) - (b)) <= 1E-9)
@@ -243,5 +318,33 @@ int main() {
   rational r(rational(-53, 10) % rational(-17, 10));
   assert(EQ(r.to_ldouble(), fmod(-5.3, -1.7)));
   assert(r.to_string() == "-1/5");
+
+  assert(gcd(0LL, 0LL) == 0 && gcd(-12, 18) == 6 && gcd(0LL, -7LL) == 7);
+  assert(gcd(-9223372036854775807LL - 1, 6LL) == 2);
+  for (int i = 0; i < 100000; i++) {
+    long long a = rand() - RAND_MAX/2, b = (long long)rand()*rand();
+    assert(gcd(a, b) == gcd<long long>(a, b));
+  }
+  for (int i = 0; i < 100000; i++) {
+    long long an = rand() % 2001 - 1000, ad = rand() % 1000 + 1;
+    long long bn = rand() % 2001 - 1000, bd = rand() % 1000 + 1;
+    rational a(an, ad), b(bn, bd);
+    assert(a + b == rational(an*bd + bn*ad, ad*bd));
+    assert(a - b == rational(an*bd - bn*ad, ad*bd));
+    assert(a*b == rational(an*bn, ad*bd));
+    if (bn != 0) {
+      assert(a/b == rational(an*bd, ad*bn));
+    }
+    assert(-a == rational(-an, ad) && (a - a).to_string() == "0/1");
+  }
+  int negative = 0;
+  clock_t start = clock();
+  for (int i = 0; i < 1000000; i++) {
+    rational a(rand() % 20001 - 10000, rand() % 10000 + 1);
+    rational b(rand() % 20001 - 10000, rand() % 10000 + 1);
+    negative += (a*b + a/(b*b + 1) - (a + b) < 0) ? 1 : 0;
+  }
+  printf("1000000 rounds of 5 operations in %.3fs (%d negative)\n",
+         (double)(clock() - start)/CLOCKS_PER_SEC, negative);
   return 0;
 }
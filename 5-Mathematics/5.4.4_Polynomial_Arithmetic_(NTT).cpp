@@ -0,0 +1,556 @@
+/*
+
+Perform arithmetic on polynomials with coefficients modulo a prime using the
+number theoretic transform (NTT), the analogue of the fast Fourier transform
+over the integers modulo a prime p = c*2^k + 1. Since all arithmetic is exact,
+there is none of the rounding error of a floating point FFT. A polynomial of
+degree d is represented as a vector of size d + 1 where p[i] stores the
+coefficient for the x^i term (the same as in sections 5.6.3 to 5.6.5), with
+every coefficient in [0, MOD).
+
+The ntt_poly<MOD, ROOT> class collects the operations as static functions for a
+prime modulus MOD with primitive root ROOT, such that 2^k divides MOD - 1 for
+every transform size 2^k used. The default 998244353 = 119*2^23 + 1 supports
+products of up to 2^23 coefficients.
+
+- transform(a, invert) performs an in-place NTT of a, whose size must be a power
+  of two. The forward transform is decimation in frequency, leaving its output
+  in bit-reversed order, and the inverse transform is decimation in time from
+  bit-reversed order, so that a convolution never needs to permute anything.
+  Pairs of radix-2 levels are fused into radix-4 passes to halve the passes
+  over memory, and the twiddle factors are cached in a table that is only
+  extended when a larger transform is requested.
+- multiply(a, b) returns the product of a and b, using the schoolbook method
+  if either is short.
+- inverse(a, n) returns the first n coefficients of the power series 1/a, where
+  a[0] != 0, by Newton's iteration g = g*(2 - a*g) doubling the precision.
+- divide(a, b, q, r) sets q and r to the quotient and remainder of a divided by
+  b, where b has a nonzero leading coefficient, using the inverse of the
+  reversal of b.
+- derivative(a) and integral(a) return the derivative and the antiderivative
+  with a zero constant term.
+- log(a, n) returns the first n coefficients of the power series ln(a), where
+  a[0] = 1, as the integral of a'/a.
+- exp(a, n) returns the first n coefficients of the power series e^a, where
+  a[0] = 0, by Newton's iteration g = g*(1 - ln(g) + a).
+- evaluate(a, x) returns the values of a at every point in x by reducing a
+  modulo a subproduct tree of the linear factors (z - x[i]).
+- multiply_mod(a, b, m) returns the product of a and b with coefficients modulo
+  an arbitrary m <= 2^30, by multiplying modulo three NTT primes and combining
+  each coefficient by the Chinese remainder theorem (Garner's algorithm). The
+  coefficients of a and b are first reduced modulo m, so that every coefficient
+  of the exact product is below the product of the three primes.
+
+Time Complexity:
+- O(n log n) per call to transform(a, invert), multiply(a, b), inverse(a, n),
+  divide(a, b, q, r), log(a, n), exp(a, n), and multiply_mod(a, b, m), where n
+  is the size of the inputs and outputs.
+- O(n) per call to derivative(a) and integral(a).
+- O(n log^2 n) per call to evaluate(a, x), where n is the size of a and x.
+
+Space Complexity:
+- O(n) auxiliary heap space for all operations except evaluate(a, x).
+- O(n log n) auxiliary heap space for evaluate(a, x).
+
+*/
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+typedef unsigned long long uint64;
+typedef std::vector<unsigned int> poly;
+
+template<unsigned int MOD = 998244353, unsigned int ROOT = 3>
+struct ntt_poly {
+  static unsigned int add(unsigned int a, unsigned int b) {
+    return (a + b >= MOD) ? a + b - MOD : a + b;
+  }
+
+  static unsigned int sub(unsigned int a, unsigned int b) {
+    return (a >= b) ? a - b : a + MOD - b;
+  }
+
+  static unsigned int mul(unsigned int a, unsigned int b) {
+    return (uint64)a*b % MOD;
+  }
+
+  static unsigned int pow(unsigned int a, uint64 n) {
+    unsigned int res = 1;
+    for (; n > 0; n >>= 1) {
+      if (n & 1) {
+        res = mul(res, a);
+      }
+      a = mul(a, a);
+    }
+    return res;
+  }
+
+  static unsigned int inv(unsigned int a) {
+    return pow(a, MOD - 2);
+  }
+
+  // Returns a table t of size at least n such that t[len + j] is the jth power
+  // of the primitive (2*len)th root of unity (or its inverse) for every power
+  // of two len < n and j < len.
+  static const poly& roots(int n, bool invert) {
+    static poly table[2];
+    poly &t = table[invert ? 1 : 0];
+    if ((int)t.size() < n) {
+      if ((MOD - 1) % n != 0) {
+        throw std::runtime_error("Transform size is too large for modulus.");
+      }
+      t.assign(n, 0);
+      unsigned int w = pow(ROOT, (MOD - 1)/n);
+      if (invert) {
+        w = inv(w);
+      }
+      t[n/2] = 1;
+      for (int j = n/2 + 1; j < n; j++) {
+        t[j] = mul(t[j - 1], w);
+      }
+      for (int j = n/2 - 1; j > 0; j--) {
+        t[j] = t[2*j];
+      }
+    }
+    return t;
+  }
+
+  static void transform(poly &a, bool invert = false) {
+    int n = a.size();
+    if (n <= 1) {
+      return;
+    }
+    const unsigned int *w = &roots(std::max(n, 4), invert)[0], imag = w[3];
+    unsigned int *x = &a[0];
+    if (!invert) {
+      int len = n/2;
+      if (__builtin_ctz(n) % 2 == 1) {
+        for (int j = 0; j < len; j++) {
+          unsigned int u = x[j], v = x[j + len];
+          x[j] = add(u, v);
+          x[j + len] = mul(sub(u, v), w[len + j]);
+        }
+        len /= 2;
+      }
+      // Fused levels 2q and q, where w[2q + j]^2 = w[q + j] and w[3] is the
+      // primitive 4th root of unity.
+      for (int q = len/2; q >= 1; q /= 4) {
+        for (int i = 0; i < n; i += 4*q) {
+          for (int j = 0; j < q; j++) {
+            unsigned int *p = x + i + j;
+            unsigned int x0 = p[0], x1 = p[q], x2 = p[2*q], x3 = p[3*q];
+            unsigned int y0 = add(x0, x2), y1 = add(x1, x3);
+            unsigned int d0 = sub(x0, x2), d1 = mul(sub(x1, x3), imag);
+            unsigned int w1 = w[2*q + j], w2 = w[q + j];
+            p[0] = add(y0, y1);
+            p[q] = mul(sub(y0, y1), w2);
+            p[2*q] = mul(add(d0, d1), w1);
+            p[3*q] = mul(sub(d0, d1), mul(w1, w2));
+          }
+        }
+      }
+    } else {
+      int len = 1;
+      for (; 4*len <= n; len *= 4) {
+        int q = len;
+        for (int i = 0; i < n; i += 4*q) {
+          for (int j = 0; j < q; j++) {
+            unsigned int *p = x + i + j, wq = w[q + j];
+            unsigned int x1 = mul(p[q], wq), x3 = mul(p[3*q], wq);
+            unsigned int y0 = add(p[0], x1), y1 = sub(p[0], x1);
+            unsigned int y2 = add(p[2*q], x3), y3 = sub(p[2*q], x3);
+            unsigned int z2 = mul(y2, w[2*q + j]), z3 = mul(y3, w[3*q + j]);
+            p[0] = add(y0, z2);
+            p[2*q] = sub(y0, z2);
+            p[q] = add(y1, z3);
+            p[3*q] = sub(y1, z3);
+          }
+        }
+      }
+      if (len < n) {
+        for (int j = 0; j < len; j++) {
+          unsigned int u = x[j], v = mul(x[j + len], w[len + j]);
+          x[j] = add(u, v);
+          x[j + len] = sub(u, v);
+        }
+      }
+      unsigned int n_inv = inv(n);
+      for (int i = 0; i < n; i++) {
+        x[i] = mul(x[i], n_inv);
+      }
+    }
+  }
+
+  static poly multiply(const poly &a, const poly &b) {
+    if (a.empty() || b.empty()) {
+      return poly();
+    }
+    int len = a.size() + b.size() - 1;
+    if (std::min(a.size(), b.size()) <= 32) {
+      std::vector<uint64> res(len, 0);
+      for (int i = 0; i < (int)a.size(); i++) {
+        for (int j = 0; j < (int)b.size(); j++) {
+          res[i + j] = (res[i + j] + (uint64)a[i]*b[j]) % MOD;
+        }
+      }
+      return poly(res.begin(), res.end());
+    }
+    int n = 1;
+    while (n < len) {
+      n *= 2;
+    }
+    poly fa(a), fb(b);
+    fa.resize(n, 0);
+    fb.resize(n, 0);
+    transform(fa);
+    transform(fb);
+    for (int i = 0; i < n; i++) {
+      fa[i] = mul(fa[i], fb[i]);
+    }
+    transform(fa, true);
+    fa.resize(len);
+    return fa;
+  }
+
+  static poly truncate(const poly &a, int n) {
+    poly res(a.begin(), a.begin() + std::min((int)a.size(), n));
+    res.resize(n, 0);
+    return res;
+  }
+
+  static poly inverse(const poly &a, int n) {
+    if (a.empty() || a[0] == 0) {
+      throw std::runtime_error("Power series has no inverse.");
+    }
+    poly g(1, inv(a[0]));
+    for (int len = 1; len < n; len *= 2) {
+      poly ag = truncate(multiply(truncate(a, 2*len), g), 2*len);
+      for (int i = 0; i < 2*len; i++) {
+        ag[i] = sub(0, ag[i]);
+      }
+      ag[0] = add(ag[0], 2);
+      g = truncate(multiply(g, ag), 2*len);
+    }
+    return truncate(g, n);
+  }
+
+  static void divide(const poly &a, const poly &b, poly &q, poly &r) {
+    int m = b.size();
+    while (m > 0 && b[m - 1] == 0) {
+      m--;
+    }
+    if (m == 0) {
+      throw std::runtime_error("Division by the zero polynomial.");
+    }
+    int n = a.size();
+    while (n > 0 && a[n - 1] == 0) {
+      n--;
+    }
+    if (n < m) {
+      q.clear();
+      r = truncate(a, n);
+      return;
+    }
+    int k = n - m + 1;
+    poly ra(a.rbegin() + (a.size() - n), a.rend());
+    poly rb(b.rbegin() + (b.size() - m), b.rend());
+    q = truncate(multiply(truncate(ra, k), inverse(rb, k)), k);
+    std::reverse(q.begin(), q.end());
+    poly bq = multiply(truncate(b, m), q);
+    r.resize(m - 1);
+    for (int i = 0; i < m - 1; i++) {
+      r[i] = sub(a[i], bq[i]);
+    }
+    while (!r.empty() && r.back() == 0) {
+      r.pop_back();
+    }
+  }
+
+  static poly derivative(const poly &a) {
+    poly res;
+    for (int i = 1; i < (int)a.size(); i++) {
+      res.push_back(mul(a[i], i));
+    }
+    return res;
+  }
+
+  static poly integral(const poly &a) {
+    int n = a.size();
+    poly res(n + 1, 0), inverses(n + 1, 1);
+    for (int i = 2; i <= n; i++) {
+      inverses[i] = mul(MOD - MOD/i, inverses[MOD % i]);
+    }
+    for (int i = 0; i < n; i++) {
+      res[i + 1] = mul(a[i], inverses[i + 1]);
+    }
+    return res;
+  }
+
+  static poly log(const poly &a, int n) {
+    if (a.empty() || a[0] != 1) {
+      throw std::runtime_error("Logarithm requires a constant term of 1.");
+    }
+    poly d = truncate(multiply(derivative(truncate(a, n)), inverse(a, n)), n);
+    return truncate(integral(d), n);
+  }
+
+  static poly exp(const poly &a, int n) {
+    if (!a.empty() && a[0] != 0) {
+      throw std::runtime_error("Exponential requires a constant term of 0.");
+    }
+    poly g(1, 1);
+    for (int len = 1; len < n; len *= 2) {
+      poly h = log(g, 2*len);
+      for (int i = 0; i < 2*len; i++) {
+        h[i] = sub(i < (int)a.size() ? a[i] : 0, h[i]);
+      }
+      h[0] = add(h[0], 1);
+      g = truncate(multiply(g, h), 2*len);
+    }
+    return truncate(g, n);
+  }
+
+  static void evaluate(const poly &a, const poly &x, int node, int lo, int hi,
+                       const std::vector<poly> &tree, poly &res) {
+    if (hi - lo <= 32) {
+      for (int i = lo; i < hi; i++) {
+        unsigned int v = 0;
+        for (int j = (int)a.size() - 1; j >= 0; j--) {
+          v = add(mul(v, x[i]), a[j]);
+        }
+        res[i] = v;
+      }
+      return;
+    }
+    int mid = lo + (hi - lo)/2;
+    poly q, r;
+    divide(a, tree[2*node], q, r);
+    evaluate(r, x, 2*node, lo, mid, tree, res);
+    divide(a, tree[2*node + 1], q, r);
+    evaluate(r, x, 2*node + 1, mid, hi, tree, res);
+  }
+
+  static void build(const poly &x, int node, int lo, int hi,
+                    std::vector<poly> &tree) {
+    if (hi - lo == 1) {
+      tree[node].resize(2);
+      tree[node][0] = sub(0, x[lo]);
+      tree[node][1] = 1;
+      return;
+    }
+    int mid = lo + (hi - lo)/2;
+    build(x, 2*node, lo, mid, tree);
+    build(x, 2*node + 1, mid, hi, tree);
+    tree[node] = multiply(tree[2*node], tree[2*node + 1]);
+  }
+
+  static poly evaluate(const poly &a, const poly &x) {
+    poly res(x.size());
+    if (x.empty()) {
+      return res;
+    }
+    std::vector<poly> tree(4*x.size());
+    build(x, 1, 0, x.size(), tree);
+    poly q, r;
+    divide(a, tree[1], q, r);
+    evaluate(r, x, 1, 0, x.size(), tree, res);
+    return res;
+  }
+};
+
+poly multiply_mod(const poly &a, const poly &b, unsigned int m) {
+  static const unsigned int P1 = 998244353, P2 = 167772161, P3 = 469762049;
+  poly a1(a.size()), b1(b.size()), a2(a1), b2(b1), a3(a1), b3(b1);
+  for (int i = 0; i < (int)a.size(); i++) {
+    unsigned int x = a[i] % m;
+    a1[i] = x % P1;
+    a2[i] = x % P2;
+    a3[i] = x % P3;
+  }
+  for (int i = 0; i < (int)b.size(); i++) {
+    unsigned int x = b[i] % m;
+    b1[i] = x % P1;
+    b2[i] = x % P2;
+    b3[i] = x % P3;
+  }
+  poly r1 = ntt_poly<P1>::multiply(a1, b1);
+  poly r2 = ntt_poly<P2>::multiply(a2, b2);
+  poly r3 = ntt_poly<P3>::multiply(a3, b3);
+  const unsigned int p1_inv = ntt_poly<P2>::inv(P1 % P2);
+  const unsigned int p12_inv = ntt_poly<P3>::inv((uint64)P1*P2 % P3);
+  const uint64 p12 = (uint64)P1*P2 % m;
+  poly res(r1.size());
+  for (int i = 0; i < (int)res.size(); i++) {
+    uint64 t1 = r1[i];
+    uint64 t2 = (uint64)(r2[i] + P2 - t1 % P2) % P2*p1_inv % P2;
+    uint64 t3 = (r3[i] + 2ULL*P3 - t1 % P3 - t2*P1 % P3) % P3*p12_inv % P3;
+    res[i] = (t1 % m + t2*P1 % m + t3 % m*p12) % m;
+  }
+  return res;
+}
+
+/*** Example Usage and Output:
+
+multiply() of two degree 2^20 polynomials: 0.253s
+multiply_mod() of two degree 2^20 polynomials: 0.867s
+inverse() to 2^20 terms: 0.796s
+exp() to 2^18 terms: 0.483s
+evaluate() of degree 2^16 at 2^16 points: 0.360s
+
+***/
+
+#include <cassert>
+#include <cstdio>
+#include <ctime>
+using namespace std;
+
+typedef ntt_poly<> ntt;
+const unsigned int MOD = 998244353;
+
+unsigned int rand32() {
+  static uint64 x = 88172645463325252ULL;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return x >> 32;
+}
+
+poly random_poly(int n, unsigned int m = MOD) {
+  poly res(n);
+  for (int i = 0; i < n; i++) {
+    res[i] = rand32() % m;
+  }
+  return res;
+}
+
+poly naive_multiply(const poly &a, const poly &b, unsigned int m = MOD) {
+  poly res(a.size() + b.size() - 1, 0);
+  for (int i = 0; i < (int)a.size(); i++) {
+    for (int j = 0; j < (int)b.size(); j++) {
+      res[i + j] = (res[i + j] + (uint64)a[i]*b[j]) % m;
+    }
+  }
+  return res;
+}
+
+int main() {
+  { // Transforms round trip, and products against the schoolbook method.
+    for (int n = 1; n <= 1024; n *= 2) {
+      poly a = random_poly(n), b(a);
+      ntt::transform(b);
+      ntt::transform(b, true);
+      assert(a == b);
+    }
+    for (int n = 1; n <= 300; n += 37) {
+      for (int m = 1; m <= 300; m += 41) {
+        poly a = random_poly(n), b = random_poly(m);
+        assert(ntt::multiply(a, b) == naive_multiply(a, b));
+        poly c = random_poly(n, 1000000007), d = random_poly(m, 1000000007);
+        assert(multiply_mod(c, d, 1000000007) ==
+               naive_multiply(c, d, 1000000007));
+        c = random_poly(n, 1 << 30);
+        d = random_poly(m, 1 << 30);
+        assert(multiply_mod(c, d, 1 << 30) == naive_multiply(c, d, 1 << 30));
+        // Coefficients that are not yet reduced modulo m.
+        poly e(c), f(d);
+        for (int i = 0; i < (int)c.size(); i++) {
+          e[i] = c[i] + 1000*(unsigned int)rand();
+          c[i] = e[i] % 1000;
+        }
+        for (int i = 0; i < (int)d.size(); i++) {
+          f[i] = d[i] + 1000*(unsigned int)rand();
+          d[i] = f[i] % 1000;
+        }
+        assert(multiply_mod(e, f, 1000) == naive_multiply(c, d, 1000));
+      }
+    }
+    poly a(2);
+    a[0] = 1;
+    a[1] = 2;
+    poly sq = ntt::multiply(a, a);  // (1 + 2x)^2 = 1 + 4x + 4x^2
+    assert(sq.size() == 3 && sq[0] == 1 && sq[1] == 4 && sq[2] == 4);
+  }
+  { // Power series inverse, logarithm, and exponential.
+    poly a = random_poly(1000);
+    a[0] = 1;
+    poly g = ntt::inverse(a, 1000), ag = ntt::multiply(a, g);
+    assert(ag[0] == 1);
+    for (int i = 1; i < 1000; i++) {
+      assert(ag[i] == 0);
+    }
+    poly l = ntt::log(a, 1000), e = ntt::exp(l, 1000);
+    assert(e == a);
+    poly one(1, 1);  // e^x = sum of x^i/i!
+    poly x(2, 0);
+    x[1] = 1;
+    e = ntt::exp(x, 10);
+    unsigned int fact = 1;
+    for (int i = 0; i < 10; i++) {
+      fact = ntt::mul(fact, max(i, 1));
+      assert(ntt::mul(e[i], fact) == 1);
+    }
+    assert(ntt::log(one, 5) == poly(5, 0));
+  }
+  { // Division and multipoint evaluation against Horner's method.
+    for (int n = 1; n <= 500; n += 99) {
+      for (int m = 1; m <= 300; m += 61) {
+        poly a = random_poly(n), b = random_poly(m), q, r;
+        b[m - 1] = 1 + rand32() % (MOD - 1);
+        ntt::divide(a, b, q, r);
+        assert((int)r.size() < m);
+        poly bq = q.empty() ? poly() : ntt::multiply(b, q);
+        bq.resize(max(bq.size(), r.size()), 0);
+        for (int i = 0; i < (int)r.size(); i++) {
+          bq[i] = ntt::add(bq[i], r[i]);
+        }
+        while (!bq.empty() && bq.back() == 0) {
+          bq.pop_back();
+        }
+        poly a_trimmed(a);
+        while (!a_trimmed.empty() && a_trimmed.back() == 0) {
+          a_trimmed.pop_back();
+        }
+        assert(bq == a_trimmed);
+      }
+    }
+    poly a = random_poly(777), x = random_poly(555);
+    poly v = ntt::evaluate(a, x);
+    for (int i = 0; i < (int)x.size(); i++) {
+      unsigned int y = 0;
+      for (int j = (int)a.size() - 1; j >= 0; j--) {
+        y = ntt::add(ntt::mul(y, x[i]), a[j]);
+      }
+      assert(v[i] == y);
+    }
+  }
+  { // Timings.
+    const int n = 1 << 20;
+    poly a = random_poly(n), b = random_poly(n), c;
+    clock_t start = clock();
+    c = ntt::multiply(a, b);
+    printf("multiply() of two degree 2^20 polynomials: %.3fs\n",
+           (double)(clock() - start)/CLOCKS_PER_SEC);
+    start = clock();
+    c = multiply_mod(a, b, 1000000007);
+    printf("multiply_mod() of two degree 2^20 polynomials: %.3fs\n",
+           (double)(clock() - start)/CLOCKS_PER_SEC);
+    a[0] = 1;
+    start = clock();
+    c = ntt::inverse(a, n);
+    printf("inverse() to 2^20 terms: %.3fs\n",
+           (double)(clock() - start)/CLOCKS_PER_SEC);
+    a[0] = 0;
+    start = clock();
+    c = ntt::exp(a, 1 << 18);
+    printf("exp() to 2^18 terms: %.3fs\n",
+           (double)(clock() - start)/CLOCKS_PER_SEC);
+    a.resize(1 << 16);
+    b.resize(1 << 16);
+    start = clock();
+    c = ntt::evaluate(a, b);
+    printf("evaluate() of degree 2^16 at 2^16 points: %.3fs\n",
+           (double)(clock() - start)/CLOCKS_PER_SEC);
+  }
+  return 0;
+}
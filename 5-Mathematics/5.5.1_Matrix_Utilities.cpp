@@ -15,11 +15,15 @@ Basic matrix operations defined on a two-dimensional vector of numeric values.
   that of std::vector.
 - operators +, -, *, /, +=, -=, *=, and /= defines scalar addition, subtraction,
   multiplication, and division involving a matrix a numeric scalar value v.
-- operators * and *= defines vector and matrix multiplication.
+- operators * and *= defines vector and matrix multiplication. Matrix products
+  are computed by copying both operands into dense_matrix and using gemm().
 - operators ^ and ^= defines matrix exponentiation of a square matrix a by an
-  integer power p.
+  integer power p, by repeated squaring into two preallocated dense_matrix
+  buffers that are swapped after every product.
 - power_sum(a, p) returns the power sum of a square matrix a up to an integer
-  power p, that is, a + a^2 + ... + a^p.
+  power p, that is, a + a^2 + ... + a^p, reading the bits of p from the most
+  significant and using s(2k) = s(k) + a^k*s(k) and s(k + 1) = s(k) + a^(k + 1)
+  for s(k) = a + ... + a^k, so that each bit costs at most three products.
 - transpose(a) returns the transpose of an r by c matrix a, that is, a new c by
   r matrix b such that a[i][j] == b[j][i] for every i in [0, r) and j in [0, c).
 - transpose_in_place(a) assigns the square matrix a to its transpose, returning
@@ -30,33 +34,120 @@ Basic matrix operations defined on a two-dimensional vector of numeric values.
   clockwise, returning a reference to the modified argument itself. A negative d
   specifies a counter-clockwise rotation, and d must be a multiple of 90.
 
+dense_matrix<T> stores an r by c matrix contiguously in row-major order, 64-byte
+aligned, and supports the same operators as matrix, along with rows(),
+columns(), transpose(), a[i][j] access, dense_matrix<T>::identity(n), and
+conversion from and to_vectors() of a two-dimensional vector. The static
+function dense_matrix<T>::multiply(a, b, res) sets a distinct matrix res to a*b,
+reusing its storage, and a.swap(b) exchanges two matrices in O(1).
+
+- gemm(m, n, p, a, lda, b, ldb, c, ldc) adds the product of the m by n matrix a
+  and the n by p matrix b to the m by p matrix c, each given as a pointer to its
+  first entry and a row stride. Following the BLIS approach, blocks of b are
+  packed into panels NR columns wide and blocks of a into panels MR rows high,
+  so that a register-blocked microkernel computing an MR by NR tile reads only
+  contiguous, cached memory. For double, the microkernel uses AVX-512 (6 by 16)
+  or AVX2 with FMA (6 by 8) if compiled with those enabled, e.g. with
+  -march=native, or else SSE2 (6 by 4). Other types use a generic 4 by 8 tile.
+  Blocks of rows of a are processed in parallel if compiled with -fopenmp.
+
+The following generalize multiplication to a semiring S, replacing + and * by
+S::add() and S::mul(), with S::zero() as the identity of add() (annihilating
+under mul()) and S::one() as the identity of mul(). The semirings provided are
+plus_times (ordinary products, wrapping modulo 2^32 so that entries of powers
+count walks), min_plus (shortest paths, with INF as infinity), max_min
+(bottleneck paths, with INT_MIN as no path), and or_and (reachability, where
+every entry must be 0 or 1).
+
+- semiring_multiply<S>(a, b) returns the product of an r by m matrix a and an m
+  by c matrix b over S. Every semiring supplies a row_update(c, x, b, n) kernel
+  which sets c[j] = add(c[j], mul(x, b[j])) for j in [0, n), using SSE2 for 4
+  entries at a time if available. Products loop over i, k, then j, skipping the
+  kernel whenever a[i][k] is zero(). Blocks of 64 rows of a are processed in
+  parallel if compiled with -fopenmp, and each is multiplied by tiles of b that
+  fit in cache.
+- semiring_identity<S>(n) returns the n by n identity matrix over S.
+- semiring_power<S>(a, p) returns a square matrix a raised to an integer power
+  p over S by repeated squaring.
+- bounded_hop_distances(w, h) returns the matrix of shortest path lengths that
+  use at most h edges, given a square matrix w of edge weights with INF for
+  missing edges. Weights may be negative.
+- transitive_closure(a) returns the reflexive transitive closure of a square
+  0/1 adjacency matrix a, squaring over or_and until no entry changes.
+
+The following compute modulo m, where 1 <= m < 2^63, on dense_matrix<uint64>
+whose entries must be in [0, m). Products of residues are accumulated without
+division and reduced only when a sum could next overflow: for m < 1.012*10^9
+(so that 9*m^2 + 2^32 < 2^63), sums are kept below 8*m^2 by a conditional
+subtraction vectorized with AVX-512, AVX2, or SSE2; for m <= 2^32, they are
+64-bit and reduced every (2^64 - m)/(m - 1)^2 products; otherwise they are
+128-bit (or with per-product reduction if unsupported by the compiler).
+
+- multiply_mod(a, b, m) returns the product of an r by n matrix a and an n by c
+  matrix b modulo m. multiply_mod(a, b, m, res) sets a distinct matrix res to
+  the product, reusing its storage. Rows of a are processed in parallel if
+  compiled with -fopenmp.
+- power_mod(a, p, m) returns a square matrix a raised to a 64-bit power p
+  modulo m, swapping two preallocated buffers as operator ^ does.
+- linear_recurrence(c, init, n, m) returns the n-th term (0-based) modulo m of
+  the sequence with initial terms init[0], ..., init[d - 1] satisfying a[i] =
+  c[0]*a[i - 1] + ... + c[d - 1]*a[i - d] for i >= d, where d = size(c). Using
+  Kitamasa's method, it computes x^n modulo the characteristic polynomial so
+  that each of the log(n) steps is a polynomial product of size d instead of a
+  d by d matrix product.
+- berlekamp_massey(s, m) returns the coefficients c of the shortest linear
+  recurrence satisfied by the sequence s modulo a prime m, in the form taken by
+  linear_recurrence(). At least 2*d terms are needed to find one of order d.
+- nth_term(s, n, m) returns the n-th term modulo a prime m of the sequence
+  beginning with s, which is assumed to satisfy a recurrence of order at most
+  size(s)/2.
+
 Time Complexity:
 - O(n*m) for construction, output, comparison, and scalar arithmetic of n by m
   matrices.
 - O(1) for rows(a) and columns(a).
 - O(n*m) for matrix-matrix addition and subtraction of n by m matrices.
-- O(n*m*log(p)) for exponentiation of an n by m matrix to power p.
-- O(n*m*log^2(p)) for power sum of an n by m matrix to power p.
-- O(n*m*k) for multiplication of an n by m matrix by an m by k matrix.
+- O(n^3 log(p)) for exponentiation and power sum of an n by n matrix to power
+  p, and for power_mod().
+- O(n*m*k) for multiplication of an n by m matrix by an m by k matrix, and for
+  gemm() with the corresponding dimensions.
 - O(n*m) for transpose(), transpose_in_place(), rotate(), and rotate_in_place()
   of n by m matrices.
+- O(n*m*k) for semiring_multiply() of an n by m matrix by an m by k matrix.
+- O(n^3 log(p)) for semiring_power() of an n by n matrix to power p, and for
+  bounded_hop_distances() with p = h.
+- O(n^3 log(n)) for transitive_closure() of an n by n matrix.
+- O(r*n*c) for multiply_mod() of an r by n matrix by an n by c matrix.
+- O(d^2 log(n)) for linear_recurrence() of order d and nth_term() with d equal
+  to size(s)/2, plus O(size(s)^2) for berlekamp_massey().
 
 Space Complexity:
 - O(1) auxiliary space for rows(), columns(), a[i][j] access, comparison
   operators, and in-place operations.
-- O(n*m*log(p)) auxiliary stack and heap space for exponentiation of an n by m
-  matrix to power p, as well as the power sum of an n by m matrix up to power p.
+- O(n^2) auxiliary heap space for exponentiation and power sum of an n by n
+  matrix, and for power_mod().
+- O(d) auxiliary heap space for linear_recurrence() of order d,
+  berlekamp_massey(), and nth_term().
 - O(n*m) auxiliary heap space for all non-in-place operations returning an n by
-  m matrix, transpose(), and rotate().
+  m matrix, transpose(), rotate(), and the semiring operations.
+- O(KC*(NC + t*MC)) auxiliary heap space for gemm() with t threads, where the
+  block sizes KC, MC, and NC are constants.
 
 */
 
 #include <algorithm>
+#include <climits>
 #include <cstddef>
 #include <iomanip>
 #include <ostream>
 #include <stdexcept>
 #include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 typedef std::vector<std::vector<int> > matrix;
 
@@ -176,6 +267,439 @@ matrix operator-(const matrix &a, const matrix &b) {
   return c -= b;
 }
 
+// A 64-byte aligned array of n elements, which keeps its alignment when copied.
+template<class T>
+class aligned_array {
+  static const size_t ALIGN = 64;
+  std::vector<T> buf;
+  size_t n, offset;
+
+  void align() {
+    offset = (ALIGN - (size_t)&buf[0] % ALIGN) % ALIGN / sizeof(T);
+  }
+
+ public:
+  explicit aligned_array(size_t n = 0, const T &v = T())
+      : buf(n + ALIGN/sizeof(T), v), n(n) {
+    align();
+  }
+
+  aligned_array(const aligned_array &a) : buf(a.buf.size()), n(a.n) {
+    align();
+    std::copy(a.get(), a.get() + n, get());
+  }
+
+  aligned_array& operator=(const aligned_array &a) {
+    if (this != &a) {
+      buf.assign(a.buf.size(), T());
+      n = a.n;
+      align();
+      std::copy(a.get(), a.get() + n, get());
+    }
+    return *this;
+  }
+
+  void swap(aligned_array &a) {
+    buf.swap(a.buf);
+    std::swap(n, a.n);
+    std::swap(offset, a.offset);
+  }
+
+  size_t size() const { return n; }
+  T* get() { return &buf[0] + offset; }
+  const T* get() const { return &buf[0] + offset; }
+};
+
+// The microkernel adds the product of an MR by kc panel of a, packed column by
+// column, and a kc by NR panel of b, packed row by row, to the MR by NR tile
+// acc. The generic version accumulates in a local tile that compilers keep in
+// vector registers.
+template<class T>
+struct gemm_kernel {
+  static const int MR = 4, NR = 8;
+
+  static void run(int kc, const T *a, const T *b, T *acc) {
+    T t[MR*NR] = {};
+    for (int k = 0; k < kc; k++, a += MR, b += NR) {
+      for (int i = 0; i < MR; i++) {
+        for (int j = 0; j < NR; j++) {
+          t[i*NR + j] += a[i]*b[j];
+        }
+      }
+    }
+    for (int i = 0; i < MR*NR; i++) {
+      acc[i] += t[i];
+    }
+  }
+};
+
+#if defined(__AVX512F__)
+template<>
+struct gemm_kernel<double> {
+  static const int MR = 6, NR = 16;
+
+  // The 12 accumulators are named so that they stay in registers.
+  static void run(int kc, const double *a, const double *b, double *acc) {
+    __m512d z = _mm512_setzero_pd(), c00 = z, c01 = z, c10 = z, c11 = z;
+    __m512d c20 = z, c21 = z, c30 = z, c31 = z;
+    __m512d c40 = z, c41 = z, c50 = z, c51 = z;
+    for (int k = 0; k < kc; k++, a += MR, b += NR) {
+      __m512d b0 = _mm512_load_pd(b), b1 = _mm512_load_pd(b + 8), x;
+      x = _mm512_set1_pd(a[0]);
+      c00 = _mm512_fmadd_pd(x, b0, c00);
+      c01 = _mm512_fmadd_pd(x, b1, c01);
+      x = _mm512_set1_pd(a[1]);
+      c10 = _mm512_fmadd_pd(x, b0, c10);
+      c11 = _mm512_fmadd_pd(x, b1, c11);
+      x = _mm512_set1_pd(a[2]);
+      c20 = _mm512_fmadd_pd(x, b0, c20);
+      c21 = _mm512_fmadd_pd(x, b1, c21);
+      x = _mm512_set1_pd(a[3]);
+      c30 = _mm512_fmadd_pd(x, b0, c30);
+      c31 = _mm512_fmadd_pd(x, b1, c31);
+      x = _mm512_set1_pd(a[4]);
+      c40 = _mm512_fmadd_pd(x, b0, c40);
+      c41 = _mm512_fmadd_pd(x, b1, c41);
+      x = _mm512_set1_pd(a[5]);
+      c50 = _mm512_fmadd_pd(x, b0, c50);
+      c51 = _mm512_fmadd_pd(x, b1, c51);
+    }
+    __m512d c[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21},
+                        {c30, c31}, {c40, c41}, {c50, c51}};
+    for (int i = 0; i < MR; i++) {
+      for (int j = 0; j < 2; j++) {
+        double *p = acc + i*NR + 8*j;
+        _mm512_storeu_pd(p, _mm512_add_pd(_mm512_loadu_pd(p), c[i][j]));
+      }
+    }
+  }
+};
+#elif defined(__AVX2__) && defined(__FMA__)
+template<>
+struct gemm_kernel<double> {
+  static const int MR = 6, NR = 8;
+
+  // The 12 accumulators are named so that they stay in registers.
+  static void run(int kc, const double *a, const double *b, double *acc) {
+    __m256d z = _mm256_setzero_pd(), c00 = z, c01 = z, c10 = z, c11 = z;
+    __m256d c20 = z, c21 = z, c30 = z, c31 = z;
+    __m256d c40 = z, c41 = z, c50 = z, c51 = z;
+    for (int k = 0; k < kc; k++, a += MR, b += NR) {
+      __m256d b0 = _mm256_load_pd(b), b1 = _mm256_load_pd(b + 4), x;
+      x = _mm256_broadcast_sd(a + 0);
+      c00 = _mm256_fmadd_pd(x, b0, c00);
+      c01 = _mm256_fmadd_pd(x, b1, c01);
+      x = _mm256_broadcast_sd(a + 1);
+      c10 = _mm256_fmadd_pd(x, b0, c10);
+      c11 = _mm256_fmadd_pd(x, b1, c11);
+      x = _mm256_broadcast_sd(a + 2);
+      c20 = _mm256_fmadd_pd(x, b0, c20);
+      c21 = _mm256_fmadd_pd(x, b1, c21);
+      x = _mm256_broadcast_sd(a + 3);
+      c30 = _mm256_fmadd_pd(x, b0, c30);
+      c31 = _mm256_fmadd_pd(x, b1, c31);
+      x = _mm256_broadcast_sd(a + 4);
+      c40 = _mm256_fmadd_pd(x, b0, c40);
+      c41 = _mm256_fmadd_pd(x, b1, c41);
+      x = _mm256_broadcast_sd(a + 5);
+      c50 = _mm256_fmadd_pd(x, b0, c50);
+      c51 = _mm256_fmadd_pd(x, b1, c51);
+    }
+    __m256d c[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21},
+                        {c30, c31}, {c40, c41}, {c50, c51}};
+    for (int i = 0; i < MR; i++) {
+      for (int j = 0; j < 2; j++) {
+        double *p = acc + i*NR + 4*j;
+        _mm256_storeu_pd(p, _mm256_add_pd(_mm256_loadu_pd(p), c[i][j]));
+      }
+    }
+  }
+};
+#elif defined(__SSE2__)
+template<>
+struct gemm_kernel<double> {
+  static const int MR = 6, NR = 4;
+
+  // The 12 accumulators are named so that they stay in registers.
+  static void run(int kc, const double *a, const double *b, double *acc) {
+    __m128d z = _mm_setzero_pd(), c00 = z, c01 = z, c10 = z, c11 = z;
+    __m128d c20 = z, c21 = z, c30 = z, c31 = z;
+    __m128d c40 = z, c41 = z, c50 = z, c51 = z;
+    for (int k = 0; k < kc; k++, a += MR, b += NR) {
+      __m128d b0 = _mm_load_pd(b), b1 = _mm_load_pd(b + 2), x;
+      x = _mm_set1_pd(a[0]);
+      c00 = _mm_add_pd(c00, _mm_mul_pd(x, b0));
+      c01 = _mm_add_pd(c01, _mm_mul_pd(x, b1));
+      x = _mm_set1_pd(a[1]);
+      c10 = _mm_add_pd(c10, _mm_mul_pd(x, b0));
+      c11 = _mm_add_pd(c11, _mm_mul_pd(x, b1));
+      x = _mm_set1_pd(a[2]);
+      c20 = _mm_add_pd(c20, _mm_mul_pd(x, b0));
+      c21 = _mm_add_pd(c21, _mm_mul_pd(x, b1));
+      x = _mm_set1_pd(a[3]);
+      c30 = _mm_add_pd(c30, _mm_mul_pd(x, b0));
+      c31 = _mm_add_pd(c31, _mm_mul_pd(x, b1));
+      x = _mm_set1_pd(a[4]);
+      c40 = _mm_add_pd(c40, _mm_mul_pd(x, b0));
+      c41 = _mm_add_pd(c41, _mm_mul_pd(x, b1));
+      x = _mm_set1_pd(a[5]);
+      c50 = _mm_add_pd(c50, _mm_mul_pd(x, b0));
+      c51 = _mm_add_pd(c51, _mm_mul_pd(x, b1));
+    }
+    __m128d c[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21},
+                        {c30, c31}, {c40, c41}, {c50, c51}};
+    for (int i = 0; i < MR; i++) {
+      for (int j = 0; j < 2; j++) {
+        double *p = acc + i*NR + 2*j;
+        _mm_storeu_pd(p, _mm_add_pd(_mm_loadu_pd(p), c[i][j]));
+      }
+    }
+  }
+};
+#endif
+
+// Adds the product of the m by n matrix a and the n by p matrix b to the m by p
+// matrix c, all stored row-major with the given row strides. Blocks of KC rows
+// of b are packed into NR wide panels shared by all threads, and each thread
+// packs MC by KC blocks of a into MR high panels, so that the microkernel only
+// reads contiguous memory from cache.
+template<class T>
+void gemm(int m, int n, int p, const T *a, int lda, const T *b, int ldb, T *c,
+          int ldc) {
+  typedef gemm_kernel<T> K;
+  const int MR = K::MR, NR = K::NR, KC = 256, MC = 16*MR, NC = 512*NR;
+  if (m == 0 || n == 0 || p == 0) {
+    return;
+  }
+  aligned_array<T> bp((size_t)KC*((std::min(p, NC) + NR - 1)/NR*NR));
+  for (int jc = 0; jc < p; jc += NC) {
+    int nc = std::min(NC, p - jc);
+    for (int pc = 0; pc < n; pc += KC) {
+      int kc = std::min(KC, n - pc);
+      for (int jr = 0; jr < nc; jr += NR) {
+        T *dst = bp.get() + (size_t)jr*kc;
+        for (int k = 0; k < kc; k++) {
+          const T *src = b + (size_t)(pc + k)*ldb + jc + jr;
+          for (int j = 0; j < NR; j++) {
+            *dst++ = (jr + j < nc) ? src[j] : T();
+          }
+        }
+      }
+#ifdef _OPENMP
+      #pragma omp parallel
+#endif
+      {
+        aligned_array<T> ap((size_t)MC*kc);
+        T tile[MR*NR];
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic)
+#endif
+        for (int ic = 0; ic < m; ic += MC) {
+          int mc = std::min(MC, m - ic);
+          for (int ir = 0; ir < mc; ir += MR) {
+            T *dst = ap.get() + (size_t)ir*kc;
+            for (int k = 0; k < kc; k++) {
+              for (int i = 0; i < MR; i++) {
+                *dst++ = (ir + i < mc) ? a[(size_t)(ic + ir + i)*lda + pc + k]
+                                       : T();
+              }
+            }
+          }
+          for (int jr = 0; jr < nc; jr += NR) {
+            for (int ir = 0; ir < mc; ir += MR) {
+              std::fill(tile, tile + MR*NR, T());
+              K::run(kc, ap.get() + (size_t)ir*kc, bp.get() + (size_t)jr*kc,
+                     tile);
+              int mr = std::min(MR, mc - ir), nr = std::min(NR, nc - jr);
+              for (int i = 0; i < mr; i++) {
+                T *dst = c + (size_t)(ic + ir + i)*ldc + jc + jr;
+                for (int j = 0; j < nr; j++) {
+                  dst[j] += tile[i*NR + j];
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template<class T>
+class dense_matrix {
+  int r, c;
+  aligned_array<T> data;
+
+ public:
+  dense_matrix(int r = 0, int c = 0, const T &v = T())
+      : r(r), c(c), data((size_t)r*c, v) {}
+
+  explicit dense_matrix(const std::vector<std::vector<T> > &a)
+      : r(a.size()), c(a.empty() ? 0 : a[0].size()), data((size_t)r*c) {
+    for (int i = 0; i < r; i++) {
+      std::copy(a[i].begin(), a[i].end(), (*this)[i]);
+    }
+  }
+
+  static dense_matrix identity(int n) {
+    dense_matrix res(n, n, T());
+    for (int i = 0; i < n; i++) {
+      res[i][i] = T(1);
+    }
+    return res;
+  }
+
+  std::vector<std::vector<T> > to_vectors() const {
+    std::vector<std::vector<T> > res(r);
+    for (int i = 0; i < r; i++) {
+      res[i].assign((*this)[i], (*this)[i] + c);
+    }
+    return res;
+  }
+
+  // Sets res to the product a*b, reusing the storage of res if it already has
+  // the right dimensions. res must not be the same object as a or b.
+  static void multiply(const dense_matrix &a, const dense_matrix &b,
+                       dense_matrix &res) {
+    if (a.c != b.r) {
+      throw std::runtime_error("Invalid dimensions for matrix multiplication.");
+    }
+    if (res.r != a.r || res.c != b.c) {
+      res = dense_matrix(a.r, b.c);
+    }
+    std::fill(res.data.get(), res.data.get() + res.data.size(), T());
+    gemm(a.r, a.c, b.c, a.data.get(), a.c, b.data.get(), b.c, res.data.get(),
+         b.c);
+  }
+
+  void swap(dense_matrix &b) {
+    std::swap(r, b.r);
+    std::swap(c, b.c);
+    data.swap(b.data);
+  }
+
+  int rows() const { return r; }
+  int columns() const { return c; }
+  T* operator[](int i) { return data.get() + (size_t)i*c; }
+  const T* operator[](int i) const { return data.get() + (size_t)i*c; }
+
+  bool operator==(const dense_matrix &b) const {
+    return r == b.r && c == b.c &&
+           std::equal(data.get(), data.get() + data.size(), b.data.get());
+  }
+
+  bool operator!=(const dense_matrix &b) const { return !(*this == b); }
+
+  dense_matrix& operator+=(const dense_matrix &b) {
+    if (r != b.r || c != b.c) {
+      throw std::runtime_error("Invalid dimensions for matrix addition.");
+    }
+    for (size_t i = 0; i < data.size(); i++) {
+      data.get()[i] += b.data.get()[i];
+    }
+    return *this;
+  }
+
+  dense_matrix& operator-=(const dense_matrix &b) {
+    if (r != b.r || c != b.c) {
+      throw std::runtime_error("Invalid dimensions for matrix addition.");
+    }
+    for (size_t i = 0; i < data.size(); i++) {
+      data.get()[i] -= b.data.get()[i];
+    }
+    return *this;
+  }
+
+  dense_matrix& operator+=(const T &v) {
+    for (size_t i = 0; i < data.size(); i++) {
+      data.get()[i] += v;
+    }
+    return *this;
+  }
+
+  dense_matrix& operator-=(const T &v) {
+    for (size_t i = 0; i < data.size(); i++) {
+      data.get()[i] -= v;
+    }
+    return *this;
+  }
+
+  dense_matrix& operator*=(const T &v) {
+    for (size_t i = 0; i < data.size(); i++) {
+      data.get()[i] *= v;
+    }
+    return *this;
+  }
+
+  dense_matrix& operator/=(const T &v) {
+    for (size_t i = 0; i < data.size(); i++) {
+      data.get()[i] /= v;
+    }
+    return *this;
+  }
+
+  dense_matrix operator*(const dense_matrix &b) const {
+    dense_matrix res;
+    multiply(*this, b, res);
+    return res;
+  }
+
+  dense_matrix& operator*=(const dense_matrix &b) { return *this = *this * b; }
+
+  dense_matrix operator^(unsigned int p) const {
+    if (r != c) {
+      throw std::runtime_error("Matrix must be square for exponentiation.");
+    }
+    // Each product is written to tmp and swapped in, so no step allocates.
+    dense_matrix res(identity(r)), x(*this), tmp(r, r);
+    for (; p > 0; p >>= 1) {
+      if (p & 1) {
+        multiply(res, x, tmp);
+        res.swap(tmp);
+      }
+      if (p > 1) {
+        multiply(x, x, tmp);
+        x.swap(tmp);
+      }
+    }
+    return res;
+  }
+
+  dense_matrix& operator^=(unsigned int p) { return *this = *this ^ p; }
+
+  friend dense_matrix operator+(dense_matrix a, const dense_matrix &b) {
+    return a += b;
+  }
+
+  friend dense_matrix operator-(dense_matrix a, const dense_matrix &b) {
+    return a -= b;
+  }
+
+  friend dense_matrix operator+(dense_matrix a, const T &v) { return a += v; }
+  friend dense_matrix operator-(dense_matrix a, const T &v) { return a -= v; }
+  friend dense_matrix operator*(dense_matrix a, const T &v) { return a *= v; }
+  friend dense_matrix operator/(dense_matrix a, const T &v) { return a /= v; }
+  friend dense_matrix operator+(const T &v, dense_matrix a) { return a += v; }
+  friend dense_matrix operator*(const T &v, dense_matrix a) { return a *= v; }
+};
+
+template<class T>
+int rows(const dense_matrix<T> &a) { return a.rows(); }
+
+template<class T>
+int columns(const dense_matrix<T> &a) { return a.columns(); }
+
+template<class T>
+dense_matrix<T> transpose(const dense_matrix<T> &a) {
+  dense_matrix<T> res(a.columns(), a.rows());
+  for (int i = 0; i < a.rows(); i++) {
+    for (int j = 0; j < a.columns(); j++) {
+      res[j][i] = a[i][j];
+    }
+  }
+  return res;
+}
+
 template<class T>
 matrix& operator*=(matrix &a, const std::vector<T> &v) {
   if (columns(a) != (int)v.size() || v.empty()) {
@@ -197,15 +721,8 @@ matrix operator*(const matrix &a, const matrix &b) {
   if (columns(a) != rows(b)) {
     throw std::runtime_error("Invalid dimensions for matrix multiplication.");
   }
-  matrix res = make_matrix(rows(a), columns(b), 0);
-  for (int i = 0; i < rows(a); i++) {
-    for (int j = 0; j < columns(b); j++) {
-      for (int k = 0; k < rows(b); k++) {
-        res[i][j] += a[i][k]*b[k][j];
-      }
-    }
-  }
-  return res;
+  typedef dense_matrix<matrix::value_type::value_type> dense;
+  return (dense(a)*dense(b)).to_vectors();
 }
 
 matrix& operator*=(matrix &a, const matrix &b) {
@@ -240,10 +757,8 @@ matrix operator^(const matrix &a, unsigned int p) {
   if (rows(a) != columns(a)) {
     throw std::runtime_error("Matrix must be square for exponentiation.");
   }
-  if (p == 0) {
-    return identity_matrix(rows(a));
-  }
-  return (p % 2 == 0) ? (a*a)^(p/2) : a*(a^(p - 1));
+  typedef dense_matrix<matrix::value_type::value_type> dense;
+  return (dense(a)^p).to_vectors();
 }
 
 matrix operator^=(matrix &a, unsigned int p) {
@@ -254,11 +769,28 @@ matrix power_sum(const matrix &a, unsigned int p) {
   if (rows(a) != columns(a)) {
     throw std::runtime_error("Matrix must be square for power_sum.");
   }
-  if (p == 0) {
-    return make_matrix(rows(a), rows(a));
+  typedef dense_matrix<matrix::value_type::value_type> dense;
+  int n = rows(a);
+  dense x(a), pw(dense::identity(n)), sum(n, n), tmp(n, n);
+  // Scanning p from its most significant bit, maintain pw = a^k and sum = a +
+  // a^2 + ... + a^k for the prefix k of p read so far. Doubling k uses the
+  // identity sum_2k = sum_k + a^k*sum_k, and incrementing it adds a^(k + 1).
+  bool started = false;
+  for (int bit = 31; bit >= 0; bit--) {
+    if (started) {
+      dense::multiply(pw, sum, tmp);
+      sum += tmp;
+      dense::multiply(pw, pw, tmp);
+      pw.swap(tmp);
+    }
+    if ((p >> bit) & 1) {
+      dense::multiply(pw, x, tmp);
+      pw.swap(tmp);
+      sum += pw;
+      started = true;
+    }
   }
-  return (p % 2 == 0) ? power_sum(a, p/2)*(identity_matrix(rows(a)) + (a^(p/2)))
-                      : (a + a*power_sum(a, p - 1));
+  return sum.to_vectors();
 }
 
 matrix transpose(const matrix &a) {
@@ -371,12 +903,887 @@ matrix& rotate_in_place(matrix &a, int degrees = 90) {
   return a;
 }
 
-/*** Example Usage ***/
+const int INF = 0x3f3f3f3f;
+
+struct plus_times {
+  static int zero() { return 0; }
+  static int one() { return 1; }
+  static int add(int a, int b) { return (int)((unsigned int)a + b); }
+  static int mul(int a, int b) { return (int)((unsigned int)a*b); }
+
+  static void row_update(int *c, int x, const int *b, int n) {
+    int j = 0;
+#ifdef __SSE2__
+    // SSE2 only multiplies the even lanes, so the odd lanes are shifted down.
+    __m128i vx = _mm_set1_epi32(x);
+    for (; j + 4 <= n; j += 4) {
+      __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+      __m128i even = _mm_mul_epu32(vb, vx);
+      __m128i odd = _mm_mul_epu32(_mm_srli_si128(vb, 4), vx);
+      __m128i prod = _mm_unpacklo_epi32(
+          _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+          _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+      __m128i vc = _mm_loadu_si128((const __m128i*)(c + j));
+      _mm_storeu_si128((__m128i*)(c + j), _mm_add_epi32(vc, prod));
+    }
+#endif
+    for (; j < n; j++) {
+      c[j] = add(c[j], mul(x, b[j]));
+    }
+  }
+};
+
+struct min_plus {
+  static int zero() { return INF; }
+  static int one() { return 0; }
+  static int add(int a, int b) { return std::min(a, b); }
+  static int mul(int a, int b) { return (a >= INF || b >= INF) ? INF : a + b; }
+
+  static void row_update(int *c, int x, const int *b, int n) {
+    int j = 0;
+#ifdef __SSE2__
+    __m128i vx = _mm_set1_epi32(x), vinf = _mm_set1_epi32(INF);
+    for (; j + 4 <= n; j += 4) {
+      __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+      __m128i vc = _mm_loadu_si128((const __m128i*)(c + j));
+      __m128i sum = _mm_add_epi32(vx, vb);
+      __m128i less = _mm_and_si128(_mm_cmplt_epi32(sum, vc),
+                                   _mm_cmplt_epi32(vb, vinf));
+      _mm_storeu_si128((__m128i*)(c + j),
+                       _mm_or_si128(_mm_and_si128(less, sum),
+                                    _mm_andnot_si128(less, vc)));
+    }
+#endif
+    for (; j < n; j++) {
+      c[j] = add(c[j], mul(x, b[j]));
+    }
+  }
+};
+
+struct max_min {
+  static int zero() { return INT_MIN; }
+  static int one() { return INT_MAX; }
+  static int add(int a, int b) { return std::max(a, b); }
+  static int mul(int a, int b) { return std::min(a, b); }
+
+  static void row_update(int *c, int x, const int *b, int n) {
+    int j = 0;
+#ifdef __SSE2__
+    __m128i vx = _mm_set1_epi32(x);
+    for (; j + 4 <= n; j += 4) {
+      __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+      __m128i vc = _mm_loadu_si128((const __m128i*)(c + j));
+      __m128i lt = _mm_cmplt_epi32(vb, vx);
+      __m128i m = _mm_or_si128(_mm_and_si128(lt, vb), _mm_andnot_si128(lt, vx));
+      __m128i gt = _mm_cmpgt_epi32(m, vc);
+      _mm_storeu_si128((__m128i*)(c + j),
+                       _mm_or_si128(_mm_and_si128(gt, m),
+                                    _mm_andnot_si128(gt, vc)));
+    }
+#endif
+    for (; j < n; j++) {
+      c[j] = add(c[j], mul(x, b[j]));
+    }
+  }
+};
+
+struct or_and {
+  static int zero() { return 0; }
+  static int one() { return 1; }
+  static int add(int a, int b) { return a | b; }
+  static int mul(int a, int b) { return a & b; }
+
+  // The kernel is never called with x equal to zero(), so mul(x, b[j]) is b[j].
+  static void row_update(int *c, int x, const int *b, int n) {
+    int j = 0;
+#ifdef __SSE2__
+    for (; j + 4 <= n; j += 4) {
+      __m128i vb = _mm_loadu_si128((const __m128i*)(b + j));
+      __m128i vc = _mm_loadu_si128((const __m128i*)(c + j));
+      _mm_storeu_si128((__m128i*)(c + j), _mm_or_si128(vc, vb));
+    }
+#endif
+    for (; j < n; j++) {
+      c[j] = add(c[j], mul(x, b[j]));
+    }
+  }
+};
+
+template<class S>
+matrix semiring_multiply(const matrix &a, const matrix &b) {
+  static const int ROW_BLOCK = 64, K_BLOCK = 64, J_BLOCK = 1024;
+  if (columns(a) != rows(b)) {
+    throw std::runtime_error("Invalid dimensions for matrix multiplication.");
+  }
+  int r = rows(a), m = rows(b), c = columns(b);
+  matrix res = make_matrix(r, c, S::zero());
+  if (c == 0) {
+    return res;
+  }
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i0 = 0; i0 < r; i0 += ROW_BLOCK) {
+    int i1 = std::min(r, i0 + ROW_BLOCK);
+    for (int j0 = 0; j0 < c; j0 += J_BLOCK) {
+      int len = std::min(c - j0, J_BLOCK);
+      for (int k0 = 0; k0 < m; k0 += K_BLOCK) {
+        int k1 = std::min(m, k0 + K_BLOCK);
+        for (int i = i0; i < i1; i++) {
+          for (int k = k0; k < k1; k++) {
+            if (a[i][k] != S::zero()) {
+              S::row_update(&res[i][j0], a[i][k], &b[k][j0], len);
+            }
+          }
+        }
+      }
+    }
+  }
+  return res;
+}
+
+template<class S>
+matrix semiring_identity(int n) {
+  matrix res = make_matrix(n, n, S::zero());
+  for (int i = 0; i < n; i++) {
+    res[i][i] = S::one();
+  }
+  return res;
+}
+
+template<class S>
+matrix semiring_power(matrix a, unsigned int p) {
+  if (rows(a) != columns(a)) {
+    throw std::runtime_error("Matrix must be square for exponentiation.");
+  }
+  matrix res = semiring_identity<S>(rows(a));
+  for (; p > 0; p >>= 1) {
+    if (p & 1) {
+      res = semiring_multiply<S>(res, a);
+    }
+    if (p > 1) {
+      a = semiring_multiply<S>(a, a);
+    }
+  }
+  return res;
+}
+
+matrix bounded_hop_distances(matrix w, unsigned int h) {
+  if (rows(w) != columns(w)) {
+    throw std::runtime_error(
+        "Matrix must be square for bounded_hop_distances.");
+  }
+  // With zero-length self-loops, a product over min_plus of h matrices covers
+  // every path of h or fewer edges.
+  for (int i = 0; i < rows(w); i++) {
+    w[i][i] = std::min(w[i][i], 0);
+  }
+  return semiring_power<min_plus>(w, h);
+}
+
+matrix transitive_closure(matrix a) {
+  if (rows(a) != columns(a)) {
+    throw std::runtime_error("Matrix must be square for transitive_closure.");
+  }
+  for (int i = 0; i < rows(a); i++) {
+    a[i][i] = 1;
+  }
+  for (int len = 1; len < rows(a) - 1; len *= 2) {
+    matrix b = semiring_multiply<or_and>(a, a);
+    if (b == a) {
+      break;
+    }
+    a.swap(b);
+  }
+  return a;
+}
+
+typedef unsigned long long uint64;
+
+uint64 mulmod(uint64 a, uint64 b, uint64 m) {
+#ifdef __SIZEOF_INT128__
+  return (uint64)((__uint128_t)a*b % m);
+#else
+  uint64 res = 0;
+  for (a %= m; b > 0; b >>= 1) {
+    if (b & 1) {
+      res = (res >= m - a) ? res - (m - a) : res + a;
+    }
+    a = (a >= m - a) ? a - (m - a) : a + a;
+  }
+  return res;
+#endif
+}
+
+uint64 powmod(uint64 a, uint64 p, uint64 m) {
+  uint64 res = 1 % m;
+  for (a %= m; p > 0; p >>= 1) {
+    if (p & 1) {
+      res = mulmod(res, a, m);
+    }
+    a = mulmod(a, a, m);
+  }
+  return res;
+}
+
+// Accumulation policies for delayed modular reduction. row_update(s, x, b, n,
+// m) adds the products of residues x and b[j] in [0, m) to s[j] of an acc type
+// wider than m for j in [0, n), and terms(m) gives how many such updates may
+// be made on a value below m before it must be reduced modulo m.
+template<class Acc>
+struct mod_wide {
+  typedef Acc acc;
+
+  static void row_update(acc *s, uint64 x, const uint64 *b, int n, uint64) {
+    for (int j = 0; j < n; j++) {
+      s[j] += (acc)x*b[j];
+    }
+  }
+
+  static uint64 terms(uint64 m) {
+    acc sq = (acc)(m - 1)*(m - 1);
+    if (sq == 0) {
+      return ~0ULL;
+    }
+    return (uint64)std::min((~(acc)0 - m)/sq, (acc)~0ULL);
+  }
+};
+
+// Without a 128-bit type, products modulo m > 2^32 are reduced individually
+// and only their sums are delayed.
+struct mod_narrow {
+  typedef uint64 acc;
+
+  static void row_update(acc *s, uint64 x, const uint64 *b, int n, uint64 m) {
+    for (int j = 0; j < n; j++) {
+      s[j] += mulmod(x, b[j], m);
+    }
+  }
+
+  static uint64 terms(uint64 m) {
+    return (m <= 1) ? ~0ULL : (~0ULL - m)/(m - 1);
+  }
+};
+
+// For m < LAZY_LIMIT, sums are kept below 8*m^2 by a conditional subtraction
+// after each product, so no division is needed until the end. Products of the
+// 32-bit residues and the subtraction use AVX-512, AVX2, or SSE2 for 8, 4, or
+// 2 entries at a time respectively if available. The AVX2 and SSE2 comparisons
+// are signed, so the limit ensures that a sum before subtraction (below 9*m^2,
+// or 9*m^2 + 2^32 with SSE2) never reaches 2^63.
+const uint64 LAZY_LIMIT = 1012000000;
+
+struct mod_lazy {
+  typedef uint64 acc;
+
+  static void row_update(acc *s, uint64 x, const uint64 *b, int n, uint64 m) {
+    uint64 bound = 8*m*m;
+    int j = 0;
+#if defined(__AVX512F__)
+    __m512i vx = _mm512_set1_epi64(x), vb = _mm512_set1_epi64(bound);
+    for (; j + 8 <= n; j += 8) {
+      __m512i v = _mm512_add_epi64(_mm512_loadu_si512(s + j),
+                                   _mm512_mul_epu32(vx,
+                                                    _mm512_loadu_si512(b + j)));
+      _mm512_storeu_si512(s + j, _mm512_min_epu64(v, _mm512_sub_epi64(v, vb)));
+    }
+#elif defined(__AVX2__)
+    __m256i vx = _mm256_set1_epi64x(x), vb = _mm256_set1_epi64x(bound);
+    __m256i vmax = _mm256_set1_epi64x(bound - 1);
+    for (; j + 4 <= n; j += 4) {
+      __m256i v = _mm256_add_epi64(
+          _mm256_loadu_si256((const __m256i*)(s + j)),
+          _mm256_mul_epu32(vx, _mm256_loadu_si256((const __m256i*)(b + j))));
+      __m256i over = _mm256_cmpgt_epi64(v, vmax);
+      v = _mm256_sub_epi64(v, _mm256_and_si256(over, vb));
+      _mm256_storeu_si256((__m256i*)(s + j), v);
+    }
+#elif defined(__SSE2__)
+    // Without 64-bit comparisons, subtract only when the high halves exceed
+    // that of bound, so that sums stay below bound + 2^32 + m^2 < 2^63.
+    __m128i vx = _mm_set1_epi32((int)x), vb = _mm_set1_epi64x(bound);
+    __m128i vhigh = _mm_set1_epi32((int)(bound >> 32));
+    for (; j + 2 <= n; j += 2) {
+      __m128i v = _mm_add_epi64(
+          _mm_loadu_si128((const __m128i*)(s + j)),
+          _mm_mul_epu32(vx, _mm_loadu_si128((const __m128i*)(b + j))));
+      __m128i over = _mm_shuffle_epi32(_mm_cmpgt_epi32(v, vhigh),
+                                       _MM_SHUFFLE(3, 3, 1, 1));
+      v = _mm_sub_epi64(v, _mm_and_si128(over, vb));
+      _mm_storeu_si128((__m128i*)(s + j), v);
+    }
+#endif
+    for (; j < n; j++) {
+      s[j] += x*b[j];
+      s[j] -= (s[j] >= bound) ? bound : 0;
+    }
+  }
+
+  static uint64 terms(uint64) { return ~0ULL; }
+};
+
+template<class P>
+void multiply_mod_with(const dense_matrix<uint64> &a,
+                       const dense_matrix<uint64> &b,
+                       uint64 m, dense_matrix<uint64> &res) {
+  typedef typename P::acc acc;
+  int r = a.rows(), n = a.columns(), c = b.columns();
+  uint64 terms = P::terms(m);
+  int block = (int)std::min(terms, (uint64)std::max(n, 1));
+#ifdef _OPENMP
+  #pragma omp parallel
+#endif
+  {
+    std::vector<acc> sum(c);
+#ifdef _OPENMP
+    #pragma omp for schedule(dynamic)
+#endif
+    for (int i = 0; i < r; i++) {
+      std::fill(sum.begin(), sum.end(), acc(0));
+      for (int k0 = 0; k0 < n; k0 += block) {
+        int k1 = std::min(n, k0 + block);
+        for (int k = k0; k < k1; k++) {
+          uint64 x = a[i][k];
+          if (x != 0) {
+            P::row_update(&sum[0], x, b[k], c, m);
+          }
+        }
+        for (int j = 0; j < c; j++) {
+          sum[j] %= m;
+        }
+      }
+      for (int j = 0; j < c; j++) {
+        res[i][j] = (uint64)(sum[j] % m);
+      }
+    }
+  }
+}
+
+void multiply_mod(const dense_matrix<uint64> &a, const dense_matrix<uint64> &b,
+                  uint64 m, dense_matrix<uint64> &res) {
+  if (a.columns() != b.rows()) {
+    throw std::runtime_error("Invalid dimensions for matrix multiplication.");
+  }
+  if (m == 0 || m >= (1ULL << 63)) {
+    throw std::runtime_error("Modulus must be in [1, 2^63).");
+  }
+  if (res.rows() != a.rows() || res.columns() != b.columns()) {
+    res = dense_matrix<uint64>(a.rows(), b.columns());
+  }
+  if (m < LAZY_LIMIT) {
+    multiply_mod_with<mod_lazy>(a, b, m, res);
+  } else if (m <= (1ULL << 32)) {
+    multiply_mod_with<mod_wide<uint64> >(a, b, m, res);
+  } else {
+#ifdef __SIZEOF_INT128__
+    multiply_mod_with<mod_wide<__uint128_t> >(a, b, m, res);
+#else
+    multiply_mod_with<mod_narrow>(a, b, m, res);
+#endif
+  }
+}
+
+dense_matrix<uint64> multiply_mod(const dense_matrix<uint64> &a,
+                                  const dense_matrix<uint64> &b, uint64 m) {
+  dense_matrix<uint64> res;
+  multiply_mod(a, b, m, res);
+  return res;
+}
+
+dense_matrix<uint64> power_mod(const dense_matrix<uint64> &a, uint64 p,
+                               uint64 m) {
+  if (a.rows() != a.columns()) {
+    throw std::runtime_error("Matrix must be square for exponentiation.");
+  }
+  int n = a.rows();
+  dense_matrix<uint64> res(n, n), x(a), tmp(n, n);
+  for (int i = 0; i < n; i++) {
+    res[i][i] = 1 % m;
+    for (int j = 0; j < n; j++) {
+      x[i][j] %= m;
+    }
+  }
+  for (; p > 0; p >>= 1) {
+    if (p & 1) {
+      multiply_mod(res, x, m, tmp);
+      res.swap(tmp);
+    }
+    if (p > 1) {
+      multiply_mod(x, x, m, tmp);
+      x.swap(tmp);
+    }
+  }
+  return res;
+}
+
+// Returns a*b modulo f(x) = x^d - c[0]*x^(d - 1) - ... - c[d - 1], where a and
+// b are polynomials of degree less than d given by their coefficients.
+template<class P>
+std::vector<uint64> kitamasa_mulmod(const std::vector<uint64> &a,
+                                    const std::vector<uint64> &b,
+                                    const std::vector<uint64> &c, uint64 m) {
+  typedef typename P::acc acc;
+  int d = c.size();
+  uint64 terms = P::terms(m);
+  std::vector<acc> sum(2*d - 1, acc(0));
+  std::vector<uint64> rc(c.rbegin(), c.rend());
+  // Every entry of sum receives at most one product per i.
+  for (int i = 0; i < d; i++) {
+    if (i > 0 && i % terms == 0) {
+      for (int j = 0; j < 2*d - 1; j++) {
+        sum[j] %= m;
+      }
+    }
+    if (a[i] != 0) {
+      P::row_update(&sum[i], a[i], &b[0], d, m);
+    }
+  }
+  for (int j = 0; j < 2*d - 1; j++) {
+    sum[j] %= m;
+  }
+  // Replace x^i by c[0]*x^(i - 1) + ... + c[d - 1]*x^(i - d), from the top.
+  uint64 steps = 0;
+  for (int i = 2*d - 2; i >= d; i--) {
+    if (++steps > terms) {
+      for (int j = 0; j < i; j++) {
+        sum[j] %= m;
+      }
+      steps = 1;
+    }
+    uint64 t = (uint64)(sum[i] % m);
+    if (t != 0) {
+      P::row_update(&sum[i - d], t, &rc[0], d, m);
+    }
+  }
+  std::vector<uint64> res(d);
+  for (int i = 0; i < d; i++) {
+    res[i] = (uint64)(sum[i] % m);
+  }
+  return res;
+}
+
+template<class P>
+uint64 linear_recurrence_with(const std::vector<uint64> &c,
+                         const std::vector<uint64> &init, uint64 n,
+                         uint64 m) {
+  int d = c.size();
+  std::vector<uint64> cm(d), res(d, 0);
+  for (int i = 0; i < d; i++) {
+    cm[i] = c[i] % m;
+  }
+  // Compute x^n modulo f(x) from the most significant bit of n, where
+  // squaring takes O(d^2) and multiplying by x is a shift with one reduction.
+  res[0] = 1 % m;
+  int top_bit = 63;
+  while (!((n >> top_bit) & 1)) {
+    top_bit--;
+  }
+  for (int bit = top_bit; bit >= 0; bit--) {
+    if (bit < top_bit) {
+      res = kitamasa_mulmod<P>(res, res, cm, m);
+    }
+    if ((n >> bit) & 1) {
+      uint64 top = res[d - 1];
+      for (int i = d - 1; i > 0; i--) {
+        res[i] = res[i - 1];
+      }
+      res[0] = 0;
+      for (int i = 0; i < d; i++) {
+        res[d - 1 - i] = (res[d - 1 - i] + mulmod(top, cm[i], m)) % m;
+      }
+    }
+  }
+  // With x^n = r[0] + r[1]*x + ... + r[d - 1]*x^(d - 1) modulo f(x), the n-th
+  // term is the same combination of the first d terms.
+  uint64 ans = 0;
+  for (int i = 0; i < d; i++) {
+    ans = (ans + mulmod(res[i], init[i] % m, m)) % m;
+  }
+  return ans;
+}
+
+uint64 linear_recurrence(const std::vector<uint64> &c,
+                         const std::vector<uint64> &init, uint64 n,
+                         uint64 m) {
+  if (m == 0 || m >= (1ULL << 63)) {
+    throw std::runtime_error("Modulus must be in [1, 2^63).");
+  }
+  if (init.size() < c.size()) {
+    throw std::runtime_error("Recurrence needs at least d initial terms.");
+  }
+  if (n < init.size()) {
+    return init[n] % m;
+  }
+  if (c.empty()) {
+    return 0;
+  }
+  if (m < LAZY_LIMIT) {
+    return linear_recurrence_with<mod_lazy>(c, init, n, m);
+  }
+  if (m <= (1ULL << 32)) {
+    return linear_recurrence_with<mod_wide<uint64> >(c, init, n, m);
+  }
+#ifdef __SIZEOF_INT128__
+  return linear_recurrence_with<mod_wide<__uint128_t> >(c, init, n, m);
+#else
+  return linear_recurrence_with<mod_narrow>(c, init, n, m);
+#endif
+}
+
+std::vector<uint64> berlekamp_massey(const std::vector<uint64> &s, uint64 m) {
+  // cur and prev are connection polynomials, with cur[0] = prev[0] = 1.
+  std::vector<uint64> cur(1, 1), prev(1, 1);
+  uint64 prev_d = 1;
+  int len = 0, shift = 1;
+  for (int n = 0; n < (int)s.size(); n++) {
+    uint64 d = s[n] % m;
+    for (int i = 1; i <= len; i++) {
+      d = (d + mulmod(cur[i], s[n - i] % m, m)) % m;
+    }
+    if (d == 0) {
+      shift++;
+      continue;
+    }
+    std::vector<uint64> old(cur);
+    uint64 coef = mulmod(d, powmod(prev_d, m - 2, m), m);
+    if (cur.size() < prev.size() + shift) {
+      cur.resize(prev.size() + shift, 0);
+    }
+    for (int i = 0; i < (int)prev.size(); i++) {
+      uint64 t = mulmod(coef, prev[i], m);
+      cur[i + shift] = (cur[i + shift] >= t) ? cur[i + shift] - t
+                                             : cur[i + shift] + (m - t);
+    }
+    if (2*len <= n) {
+      len = n + 1 - len;
+      prev.swap(old);
+      prev_d = d;
+      shift = 1;
+    } else {
+      shift++;
+    }
+  }
+  std::vector<uint64> res(len, 0);
+  for (int i = 0; i < len && i + 1 < (int)cur.size(); i++) {
+    res[i] = (m - cur[i + 1]) % m;
+  }
+  return res;
+}
+
+uint64 nth_term(const std::vector<uint64> &s, uint64 n, uint64 m) {
+  if (n < s.size()) {
+    return s[n] % m;
+  }
+  return linear_recurrence(berlekamp_massey(s, m), s, n, m);
+}
+
+/*** Example Usage and Output:
+
+         1         2         3
+         4         5         6
+
+matrix*matrix: naive 0.14220s, operator* 0.05302s
+dense_matrix<double> 512x512: 0.02801s, 9.58253 GFLOP/s
+dense_matrix<double> 1024x1024: 0.22056s, 9.73660 GFLOP/s
+plus_times: naive 0.11656s, semiring_multiply 0.03115s
+min_plus: naive 0.12685s, semiring_multiply 0.03810s
+max_min: naive 0.12684s, semiring_multiply 0.04544s
+or_and: naive 0.12012s, semiring_multiply 0.00951s
+order 500 recurrence, term 10^18:
+  berlekamp_massey 0.00390s, linear_recurrence 0.01043s, power_mod 5.18818s
+
+***/
 
 #include <cassert>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <sys/time.h>
 using namespace std;
 
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+template<class S>
+matrix naive_multiply(const matrix &a, const matrix &b) {
+  matrix res = make_matrix(rows(a), columns(b), S::zero());
+  for (int i = 0; i < rows(a); i++) {
+    for (int j = 0; j < columns(b); j++) {
+      for (int k = 0; k < rows(b); k++) {
+        res[i][j] = S::add(res[i][j], S::mul(a[i][k], b[k][j]));
+      }
+    }
+  }
+  return res;
+}
+
+// Returns an r by c matrix with entries in [lo, hi), each replaced by zero
+// with the given probability in percent.
+matrix random_matrix(int r, int c, int lo, int hi, int zero, int percent) {
+  matrix res = make_matrix(r, c);
+  for (int i = 0; i < r; i++) {
+    for (int j = 0; j < c; j++) {
+      res[i][j] = (rand() % 100 < percent) ? zero : lo + rand() % (hi - lo);
+    }
+  }
+  return res;
+}
+
+template<class S>
+void test_semiring(int lo, int hi, int percent) {
+  for (int n = 1; n <= 70; n += (n < 10) ? 1 : 23) {
+    matrix a = random_matrix(n, n + 3, lo, hi, S::zero(), percent);
+    matrix b = random_matrix(n + 3, n/2 + 1, lo, hi, S::zero(), percent);
+    assert(semiring_multiply<S>(a, b) == naive_multiply<S>(a, b));
+    matrix c = random_matrix(n, n, lo, hi, S::zero(), percent);
+    matrix p = semiring_identity<S>(n);
+    for (unsigned int k = 0; k <= 6; k++) {
+      assert(semiring_power<S>(c, k) == p);
+      p = naive_multiply<S>(p, c);
+    }
+  }
+}
+
+void test_bounded_hops() {
+  for (int n = 1; n <= 40; n += 3) {
+    // Weights shifted by node potentials may be negative without any negative
+    // cycles, so shortest paths exist and are found with Bellman-Ford rounds.
+    vector<int> potential(n);
+    for (int i = 0; i < n; i++) {
+      potential[i] = rand() % 50;
+    }
+    matrix w = make_matrix(n, n, INF);
+    for (int e = 0; e < 3*n; e++) {
+      int u = rand() % n, v = rand() % n;
+      w[u][v] = min(w[u][v], rand() % 100 + potential[u] - potential[v]);
+    }
+    matrix d = make_matrix(n, n, INF);
+    for (int i = 0; i < n; i++) {
+      d[i][i] = 0;
+    }
+    for (unsigned int h = 0; h <= (unsigned int)n + 1; h++) {
+      assert(bounded_hop_distances(w, h) == d);
+      matrix next(d);
+      for (int i = 0; i < n; i++) {
+        for (int u = 0; u < n; u++) {
+          for (int v = 0; v < n; v++) {
+            if (d[i][u] < INF && w[u][v] < INF) {
+              next[i][v] = min(next[i][v], d[i][u] + w[u][v]);
+            }
+          }
+        }
+      }
+      d.swap(next);
+    }
+  }
+}
+
+void test_closure() {
+  for (int n = 0; n <= 60; n += 7) {
+    matrix a = random_matrix(n, n, 1, 2, 0, 97);
+    matrix reach(a);
+    for (int i = 0; i < n; i++) {
+      reach[i][i] = 1;
+    }
+    for (int k = 0; k < n; k++) {
+      for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+          reach[i][j] |= reach[i][k] & reach[k][j];
+        }
+      }
+    }
+    assert(transitive_closure(a) == reach);
+  }
+}
+
+double naive_product(const dense_matrix<double> &a, int i, int j) {
+  double res = 0;
+  for (int k = 0; k < a.columns(); k++) {
+    res += a[i][k]*a[k][j];
+  }
+  return res;
+}
+
+template<class T>
+void test_dense() {
+  for (int n = 1; n <= 150; n += (n < 12) ? 1 : 37) {
+    int m = n % 7 + 1 + (n > 100 ? 300 : 0), p = 2*n % 13 + 1;
+    vector<vector<T> > a(n, vector<T>(m)), b(m, vector<T>(p));
+    vector<vector<T> > c(n, vector<T>(p, 0));
+    for (int i = 0; i < n; i++) {
+      for (int k = 0; k < m; k++) {
+        a[i][k] = rand() % 21 - 10;
+      }
+    }
+    for (int k = 0; k < m; k++) {
+      for (int j = 0; j < p; j++) {
+        b[k][j] = rand() % 21 - 10;
+      }
+    }
+    for (int i = 0; i < n; i++) {
+      for (int k = 0; k < m; k++) {
+        for (int j = 0; j < p; j++) {
+          c[i][j] += a[i][k]*b[k][j];
+        }
+      }
+    }
+    dense_matrix<T> da(a), db(b);
+    assert((da*db).to_vectors() == c && rows(da*db) == n);
+    assert(transpose(db)*transpose(da) == transpose(dense_matrix<T>(c)));
+    assert((da*db + 1)*2 - 2*(da*db) == dense_matrix<T>(n, p, 2));
+  }
+  dense_matrix<T> q(3, 3);
+  q[0][1] = q[1][2] = q[2][0] = 1;
+  assert((q^3) == dense_matrix<T>::identity(3) && (q^0) == (q^6));
+}
+
+dense_matrix<uint64> random_mod_matrix(int r, int c, uint64 m) {
+  dense_matrix<uint64> res(r, c);
+  for (int i = 0; i < r; i++) {
+    for (int j = 0; j < c; j++) {
+      res[i][j] = (((uint64)rand() << 31 ^ rand()) << 31 ^ rand()) % m;
+    }
+  }
+  return res;
+}
+
+vector<uint64> naive_terms(const vector<uint64> &c, vector<uint64> s, int n,
+                           uint64 m) {
+  int d = c.size();
+  while ((int)s.size() < n) {
+    uint64 x = 0;
+    for (int i = 0; i < d; i++) {
+      x = (x + mulmod(c[i], s[s.size() - 1 - i], m)) % m;
+    }
+    s.push_back(x);
+  }
+  return s;
+}
+
+// The companion matrix mapping (a_(i + d - 1), ..., a_i) to (a_(i + d), ...,
+// a_(i + 1)) for a recurrence with coefficients c.
+dense_matrix<uint64> companion(const vector<uint64> &c) {
+  int d = c.size();
+  dense_matrix<uint64> res(d, d);
+  for (int i = 0; i < d; i++) {
+    res[0][i] = c[i];
+    if (i > 0) {
+      res[i][i - 1] = 1;
+    }
+  }
+  return res;
+}
+
+void test_modular() {
+  uint64 mods[] = {2, 1000000007, 1073741789, 1ULL << 32, (1ULL << 61) - 1,
+                   (1ULL << 63) - 25};
+  for (int t = 0; t < 6; t++) {
+    uint64 m = mods[t];
+    dense_matrix<uint64> a = random_mod_matrix(37, 53, m);
+    dense_matrix<uint64> b = random_mod_matrix(53, 29, m);
+    dense_matrix<uint64> c = multiply_mod(a, b, m);
+    for (int i = 0; i < 37; i++) {
+      for (int j = 0; j < 29; j++) {
+        uint64 x = 0;
+        for (int k = 0; k < 53; k++) {
+          x = (x + mulmod(a[i][k], b[k][j], m)) % m;
+        }
+        assert(c[i][j] == x);
+      }
+    }
+    dense_matrix<uint64> sq = random_mod_matrix(12, 12, m), p(12, 12);
+    dense_matrix<uint64> q = dense_matrix<uint64>::identity(12);
+    for (int e = 0; e <= 20; e++) {
+      assert(power_mod(sq, e, m) == q);
+      multiply_mod(q, sq, m, p);
+      q.swap(p);
+    }
+    // Random recurrences agree with direct iteration and companion matrices.
+    int d = 1 + t*4;
+    vector<uint64> rec(d), init(d);
+    for (int i = 0; i < d; i++) {
+      rec[i] = random_mod_matrix(1, 1, m)[0][0];
+      init[i] = random_mod_matrix(1, 1, m)[0][0];
+    }
+    vector<uint64> s = naive_terms(rec, init, 200, m);
+    for (int n = 0; n < 200; n++) {
+      assert(linear_recurrence(rec, init, n, m) == s[n]);
+    }
+    dense_matrix<uint64> pw = power_mod(companion(rec), 1000000000000000000LL,
+                                        m);
+    uint64 x = 0;
+    for (int i = 0; i < d; i++) {
+      x = (x + mulmod(pw[d - 1][i], init[d - 1 - i], m)) % m;
+    }
+    assert(linear_recurrence(rec, init, 1000000000000000000LL, m) == x);
+  }
+  // Fibonacci numbers, with F(10^18) modulo 10^9 + 7 = 209783453.
+  uint64 fc[] = {1, 1}, fi[] = {0, 1};
+  vector<uint64> fib_c(fc, fc + 2), fib_init(fi, fi + 2);
+  uint64 m = 1000000007, n = 1000000000000000000LL;
+  assert(linear_recurrence(fib_c, fib_init, n, m) == 209783453);
+  assert(power_mod(companion(fib_c), n, m)[1][0] == 209783453);
+  assert(nth_term(naive_terms(fib_c, fib_init, 10, m), n, m) == 209783453);
+  // Berlekamp-Massey recovers a random recurrence of order d from 2*d terms.
+  int d = 40;
+  vector<uint64> rec(d), init(d);
+  for (int i = 0; i < d; i++) {
+    rec[i] = rand() % m;
+    init[i] = rand() % m;
+  }
+  vector<uint64> s = naive_terms(rec, init, 2*d, m);
+  assert(berlekamp_massey(s, m) == rec);
+  assert(nth_term(s, n, m) == linear_recurrence(rec, init, n, m));
+  uint64 g[] = {2, 4, 8, 16}, g3[] = {2};
+  assert(berlekamp_massey(vector<uint64>(g, g + 4), m) ==
+         vector<uint64>(g3, g3 + 1));
+  assert(berlekamp_massey(vector<uint64>(4, 0), m).empty());
+}
+
+void benchmark_recurrences() {
+  int d = 500;
+  uint64 m = 998244353, n = 1000000000000000000LL;
+  vector<uint64> rec(d), init(d);
+  for (int i = 0; i < d; i++) {
+    rec[i] = rand() % m;
+    init[i] = rand() % m;
+  }
+  vector<uint64> s = naive_terms(rec, init, 2*d, m);
+  double start = wall_time();
+  assert(berlekamp_massey(s, m) == rec);
+  double bm_time = wall_time() - start;
+  start = wall_time();
+  uint64 x = linear_recurrence(rec, init, n, m);
+  double kitamasa_time = wall_time() - start;
+  start = wall_time();
+  dense_matrix<uint64> pw = power_mod(companion(rec), n, m);
+  double matrix_time = wall_time() - start;
+  uint64 y = 0;
+  for (int i = 0; i < d; i++) {
+    y = (y + mulmod(pw[d - 1][i], init[d - 1 - i], m)) % m;
+  }
+  assert(x == y);
+  cout << "order " << d << " recurrence, term 10^18:" << endl
+       << "  berlekamp_massey " << bm_time << "s, linear_recurrence "
+       << kitamasa_time << "s, power_mod " << matrix_time << "s" << endl;
+}
+
+template<class S>
+void benchmark(const char *name, const matrix &a) {
+  double start = wall_time();
+  matrix naive = naive_multiply<S>(a, a);
+  double naive_time = wall_time() - start;
+  start = wall_time();
+  matrix fast = semiring_multiply<S>(a, a);
+  double fast_time = wall_time() - start;
+  assert(naive == fast);
+  cout << name << ": naive " << naive_time << "s, semiring_multiply "
+       << fast_time << "s" << endl;
+}
+
 int main() {
   int a[2][3] = {{1, 2, 3}, {4, 5, 6}};
   int a90[3][2] = {{4, 1}, {5, 2}, {6, 3}};
@@ -405,5 +1812,68 @@ int main() {
   m[0][0] += 5;
   assert(m[0][0] == 25 && m[1][1] == 20);
   assert(power_sum(m, 3) == m + m*m + (m^3));
+  {
+    int c[3][3] = {{1, 1, 0}, {1, 0, 1}, {0, 1, 1}};
+    matrix f = make_matrix(c), sum = make_matrix(3, 3), pw = identity_matrix(3);
+    for (unsigned int p = 0; p <= 16; p++) {
+      assert(power_sum(f, p) == sum && (f^p) == pw);
+      pw *= f;
+      sum += pw;
+    }
+  }
+
+  test_semiring<plus_times>(-1000000, 1000000, 20);
+  test_semiring<min_plus>(-10, 100, 50);
+  test_semiring<max_min>(-1000, 1000, 50);
+  test_semiring<or_and>(1, 2, 90);
+  test_bounded_hops();
+  test_closure();
+  {
+    int c[4][4] = {{0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}, {1, 0, 0, 0}};
+    matrix p = make_matrix(c);
+    assert(semiring_power<plus_times>(p, 8) == identity_matrix(4));
+    assert(semiring_multiply<plus_times>(m, m) == m*m);
+    assert(transitive_closure(make_matrix(c)) == make_matrix(4, 4, 1));
+  }
+
+  test_dense<int>();
+  test_dense<double>();
+  test_modular();
+
+  int n = 512;
+  matrix x = random_matrix(n, n, -100, 100, 0, 0);
+  double start = wall_time();
+  matrix naive = make_matrix(n, n, 0);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      for (int k = 0; k < n; k++) {
+        naive[i][j] += x[i][k]*x[k][j];
+      }
+    }
+  }
+  double naive_time = wall_time() - start;
+  start = wall_time();
+  assert(x*x == naive);
+  cout << "matrix*matrix: naive " << naive_time << "s, operator* "
+       << wall_time() - start << "s" << endl;
+  for (int d = 512; d <= 1024; d *= 2) {
+    dense_matrix<double> y(d, d);
+    for (int i = 0; i < d; i++) {
+      for (int j = 0; j < d; j++) {
+        y[i][j] = (rand() % 2001 - 1000)/1000.0;
+      }
+    }
+    start = wall_time();
+    dense_matrix<double> z = y*y;
+    double t = wall_time() - start;
+    assert(fabs(z[d - 1][d/2] - naive_product(y, d - 1, d/2)) < 1e-9);
+    cout << "dense_matrix<double> " << d << "x" << d << ": " << t << "s, "
+         << 2.0*d*d*d/t/1e9 << " GFLOP/s" << endl;
+  }
+  benchmark<plus_times>("plus_times", random_matrix(n, n, 0, 100, 0, 0));
+  benchmark<min_plus>("min_plus", random_matrix(n, n, 0, 100, INF, 0));
+  benchmark<max_min>("max_min", random_matrix(n, n, 0, 100, INT_MIN, 0));
+  benchmark<or_and>("or_and", random_matrix(n, n, 1, 2, 0, 50));
+  benchmark_recurrences();
   return 0;
 }
@@ -4,7 +4,9 @@ Converts a matrix to reduced row echelon form using Gaussian elimination to
 solve a system of linear equations as well as compute the determinant. In
 practice, this method is prone to rounding error on certain matrices. For a more
 accurate algorithm for solving systems of linear equations, LU decomposition
-with row partial pivoting should be used.
+with row partial pivoting should be used. Large systems with mostly zero
+coefficients should instead be stored sparsely and solved iteratively, as in
+5.5.6.
 
 - row_reduce(a) assigns the matrix a to its reduced row echelon form, returning
   a reference to the modified argument itself.
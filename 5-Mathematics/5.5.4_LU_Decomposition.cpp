@@ -23,6 +23,16 @@ error due to rounding in computed solutions.
   p1col[i] stores the only column that is equal to 1 in row i of the permutation
   matrix p (all other columns in row i of p are implicitly 0). The resulting
   permutation matrix p corresponding to p1col will satisfy p*a = l*u.
+- lu_blocked(r, c, a, lda, swaps, EPS) is the right-looking blocked algorithm
+  behind all of the functions here, operating in place on an r by c row-major
+  matrix a with row stride lda. For each panel of NB columns, it factors the
+  panel with partial pivoting, recording in swaps[i] the row exchanged with row
+  i, solves the rows of the panel to its right against its unit lower triangle,
+  and subtracts the product of the blocks below and to the right of the panel
+  from the trailing submatrix using gemm(). Most of the work is thus done by the
+  register-blocked matrix multiplication of gemm() (copied from 5.5.1), which
+  uses SIMD instructions if available and multiple threads if compiled with
+  -fopenmp, as does the solve against each panel.
 - solve_system(a, b, &x) solves the system of linear equations a*x = b given an
   r by c matrix a of real values, and a length r vector b, returning 0 if there
   is one solution or -1 if there are zero or infinite solutions. If there is
@@ -32,16 +42,34 @@ error due to rounding in computed solutions.
 - invert(a) assigns the n by n matrix a to its inverse (if it exists), returning
   0 if the inversion was successful or -1 if a has no inverse.
 
+lu_factorization stores the LU decomposition of an n by n matrix a contiguously
+along with its row swaps, so that it may be reused for many right-hand sides.
+det(a) and invert(a) above are computed from one such factorization.
+
+- lu_factorization(a, EPS) factors the n by n matrix a.
+- singular() returns whether a pivot smaller than EPS in magnitude was found.
+- det() returns the determinant of a, or 0 if it is singular.
+- solve(b) assigns a vector b of length n to the solution x of a*x = b, or an n
+  by k matrix b to the solution of a*x = b for all k columns at once, returning
+  0 on success or -1 if a is singular. With 16 or more columns, triangular
+  solves are blocked so that the bulk of the work is done by gemm().
+- inverse(res) assigns res to the inverse of a, returning 0 on success or -1 if
+  a is singular.
+
 Time Complexity:
 - O(r^2*c) per call to lu_decompose(a) and solve_system(a, b), where r and c are
   the number of rows and columns respectively, in accordance to the functions'
   descriptions above.
 - O(n^3) per call to det(a) and inverse(a), where n is the dimension of a.
+- O(n^3) for constructing lu_factorization, O(1) for singular(), O(n) for
+  det(), O(n^2*k) for solve() with an n by k matrix b, and O(n^3) for
+  inverse().
 
 Space Complexity:
-- O(1) auxiliary for lu_decompose().
+- O(r*c) auxiliary heap space for lu_decompose() and solve_system(a, b).
 - O(n^2) for det(a) and inverse(a).
-- O(r*c) auxiliary heap space for solve_system(a, b).
+- O(n^2) heap space for lu_factorization, and O(n*k) auxiliary heap space for
+  solve() with an n by k matrix b.
 
 */
 
@@ -50,41 +78,367 @@ Space Complexity:
 #include <cstddef>
 #include <limits>
 #include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
 
-template<class Matrix>
-int lu_decompose(Matrix &a, std::vector<int> *p1col = NULL,
-                 const double EPS = 1e-10) {
-  int r = a.size(), c = a[0].size(), parity = 0;
-  if (p1col != NULL) {
-    p1col->resize(r);
-    for (int i = 0; i < r; i++) {
-      (*p1col)[i] = i;
+// A 64-byte aligned array of n elements, which keeps its alignment when copied.
+template<class T>
+class aligned_array {
+  static const size_t ALIGN = 64;
+  std::vector<T> buf;
+  size_t n, offset;
+
+  void align() {
+    offset = (ALIGN - (size_t)&buf[0] % ALIGN) % ALIGN / sizeof(T);
+  }
+
+ public:
+  explicit aligned_array(size_t n = 0, const T &v = T())
+      : buf(n + ALIGN/sizeof(T), v), n(n) {
+    align();
+  }
+
+  aligned_array(const aligned_array &a) : buf(a.buf.size()), n(a.n) {
+    align();
+    std::copy(a.get(), a.get() + n, get());
+  }
+
+  aligned_array& operator=(const aligned_array &a) {
+    if (this != &a) {
+      buf.assign(a.buf.size(), T());
+      n = a.n;
+      align();
+      std::copy(a.get(), a.get() + n, get());
     }
+    return *this;
   }
-  for (int i = 0; i < r && i < c; i++) {
-    int pi = i;
-    for (int k = i + 1; k < r; k++) {
-      if (fabs(a[k][i]) > fabs(a[pi][i])) {
-        pi = k;
+
+  size_t size() const { return n; }
+  T* get() { return &buf[0] + offset; }
+  const T* get() const { return &buf[0] + offset; }
+};
+
+// The microkernel adds the product of an MR by kc panel of a, packed column by
+// column, and a kc by NR panel of b, packed row by row, to the MR by NR tile
+// acc. The generic version accumulates in a local tile that compilers keep in
+// vector registers.
+template<class T>
+struct gemm_kernel {
+  static const int MR = 4, NR = 8;
+
+  static void run(int kc, const T *a, const T *b, T *acc) {
+    T t[MR*NR] = {};
+    for (int k = 0; k < kc; k++, a += MR, b += NR) {
+      for (int i = 0; i < MR; i++) {
+        for (int j = 0; j < NR; j++) {
+          t[i*NR + j] += a[i]*b[j];
+        }
       }
     }
-    if (fabs(a[pi][i]) < EPS) {
-      return -1;
+    for (int i = 0; i < MR*NR; i++) {
+      acc[i] += t[i];
     }
-    if (pi != i) {
-      if (p1col != NULL) {
-        std::iter_swap(p1col->begin() + i, p1col->begin() + pi);
+  }
+};
+
+#if defined(__AVX512F__)
+template<>
+struct gemm_kernel<double> {
+  static const int MR = 6, NR = 16;
+
+  // The 12 accumulators are named so that they stay in registers.
+  static void run(int kc, const double *a, const double *b, double *acc) {
+    __m512d z = _mm512_setzero_pd(), c00 = z, c01 = z, c10 = z, c11 = z;
+    __m512d c20 = z, c21 = z, c30 = z, c31 = z;
+    __m512d c40 = z, c41 = z, c50 = z, c51 = z;
+    for (int k = 0; k < kc; k++, a += MR, b += NR) {
+      __m512d b0 = _mm512_load_pd(b), b1 = _mm512_load_pd(b + 8), x;
+      x = _mm512_set1_pd(a[0]);
+      c00 = _mm512_fmadd_pd(x, b0, c00);
+      c01 = _mm512_fmadd_pd(x, b1, c01);
+      x = _mm512_set1_pd(a[1]);
+      c10 = _mm512_fmadd_pd(x, b0, c10);
+      c11 = _mm512_fmadd_pd(x, b1, c11);
+      x = _mm512_set1_pd(a[2]);
+      c20 = _mm512_fmadd_pd(x, b0, c20);
+      c21 = _mm512_fmadd_pd(x, b1, c21);
+      x = _mm512_set1_pd(a[3]);
+      c30 = _mm512_fmadd_pd(x, b0, c30);
+      c31 = _mm512_fmadd_pd(x, b1, c31);
+      x = _mm512_set1_pd(a[4]);
+      c40 = _mm512_fmadd_pd(x, b0, c40);
+      c41 = _mm512_fmadd_pd(x, b1, c41);
+      x = _mm512_set1_pd(a[5]);
+      c50 = _mm512_fmadd_pd(x, b0, c50);
+      c51 = _mm512_fmadd_pd(x, b1, c51);
+    }
+    __m512d c[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21},
+                        {c30, c31}, {c40, c41}, {c50, c51}};
+    for (int i = 0; i < MR; i++) {
+      for (int j = 0; j < 2; j++) {
+        double *p = acc + i*NR + 8*j;
+        _mm512_storeu_pd(p, _mm512_add_pd(_mm512_loadu_pd(p), c[i][j]));
       }
-      std::iter_swap(a.begin() + i, a.begin() + pi);
-      parity = 1 - parity;
     }
-    for (int j = i + 1; j < r; j++) {
-      a[j][i] /= a[i][i];
-      for (int k = i + 1; k < c; k++) {
-        a[j][k] -= a[j][i]*a[i][k];
+  }
+};
+#elif defined(__AVX2__) && defined(__FMA__)
+template<>
+struct gemm_kernel<double> {
+  static const int MR = 6, NR = 8;
+
+  // The 12 accumulators are named so that they stay in registers.
+  static void run(int kc, const double *a, const double *b, double *acc) {
+    __m256d z = _mm256_setzero_pd(), c00 = z, c01 = z, c10 = z, c11 = z;
+    __m256d c20 = z, c21 = z, c30 = z, c31 = z;
+    __m256d c40 = z, c41 = z, c50 = z, c51 = z;
+    for (int k = 0; k < kc; k++, a += MR, b += NR) {
+      __m256d b0 = _mm256_load_pd(b), b1 = _mm256_load_pd(b + 4), x;
+      x = _mm256_broadcast_sd(a + 0);
+      c00 = _mm256_fmadd_pd(x, b0, c00);
+      c01 = _mm256_fmadd_pd(x, b1, c01);
+      x = _mm256_broadcast_sd(a + 1);
+      c10 = _mm256_fmadd_pd(x, b0, c10);
+      c11 = _mm256_fmadd_pd(x, b1, c11);
+      x = _mm256_broadcast_sd(a + 2);
+      c20 = _mm256_fmadd_pd(x, b0, c20);
+      c21 = _mm256_fmadd_pd(x, b1, c21);
+      x = _mm256_broadcast_sd(a + 3);
+      c30 = _mm256_fmadd_pd(x, b0, c30);
+      c31 = _mm256_fmadd_pd(x, b1, c31);
+      x = _mm256_broadcast_sd(a + 4);
+      c40 = _mm256_fmadd_pd(x, b0, c40);
+      c41 = _mm256_fmadd_pd(x, b1, c41);
+      x = _mm256_broadcast_sd(a + 5);
+      c50 = _mm256_fmadd_pd(x, b0, c50);
+      c51 = _mm256_fmadd_pd(x, b1, c51);
+    }
+    __m256d c[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21},
+                        {c30, c31}, {c40, c41}, {c50, c51}};
+    for (int i = 0; i < MR; i++) {
+      for (int j = 0; j < 2; j++) {
+        double *p = acc + i*NR + 4*j;
+        _mm256_storeu_pd(p, _mm256_add_pd(_mm256_loadu_pd(p), c[i][j]));
       }
     }
   }
+};
+#elif defined(__SSE2__)
+template<>
+struct gemm_kernel<double> {
+  static const int MR = 6, NR = 4;
+
+  // The 12 accumulators are named so that they stay in registers.
+  static void run(int kc, const double *a, const double *b, double *acc) {
+    __m128d z = _mm_setzero_pd(), c00 = z, c01 = z, c10 = z, c11 = z;
+    __m128d c20 = z, c21 = z, c30 = z, c31 = z;
+    __m128d c40 = z, c41 = z, c50 = z, c51 = z;
+    for (int k = 0; k < kc; k++, a += MR, b += NR) {
+      __m128d b0 = _mm_load_pd(b), b1 = _mm_load_pd(b + 2), x;
+      x = _mm_set1_pd(a[0]);
+      c00 = _mm_add_pd(c00, _mm_mul_pd(x, b0));
+      c01 = _mm_add_pd(c01, _mm_mul_pd(x, b1));
+      x = _mm_set1_pd(a[1]);
+      c10 = _mm_add_pd(c10, _mm_mul_pd(x, b0));
+      c11 = _mm_add_pd(c11, _mm_mul_pd(x, b1));
+      x = _mm_set1_pd(a[2]);
+      c20 = _mm_add_pd(c20, _mm_mul_pd(x, b0));
+      c21 = _mm_add_pd(c21, _mm_mul_pd(x, b1));
+      x = _mm_set1_pd(a[3]);
+      c30 = _mm_add_pd(c30, _mm_mul_pd(x, b0));
+      c31 = _mm_add_pd(c31, _mm_mul_pd(x, b1));
+      x = _mm_set1_pd(a[4]);
+      c40 = _mm_add_pd(c40, _mm_mul_pd(x, b0));
+      c41 = _mm_add_pd(c41, _mm_mul_pd(x, b1));
+      x = _mm_set1_pd(a[5]);
+      c50 = _mm_add_pd(c50, _mm_mul_pd(x, b0));
+      c51 = _mm_add_pd(c51, _mm_mul_pd(x, b1));
+    }
+    __m128d c[MR][2] = {{c00, c01}, {c10, c11}, {c20, c21},
+                        {c30, c31}, {c40, c41}, {c50, c51}};
+    for (int i = 0; i < MR; i++) {
+      for (int j = 0; j < 2; j++) {
+        double *p = acc + i*NR + 2*j;
+        _mm_storeu_pd(p, _mm_add_pd(_mm_loadu_pd(p), c[i][j]));
+      }
+    }
+  }
+};
+#endif
+
+// Adds the product of the m by n matrix a and the n by p matrix b to the m by p
+// matrix c, all stored row-major with the given row strides. Blocks of KC rows
+// of b are packed into NR wide panels shared by all threads, and each thread
+// packs MC by KC blocks of a into MR high panels, so that the microkernel only
+// reads contiguous memory from cache.
+template<class T>
+void gemm(int m, int n, int p, const T *a, int lda, const T *b, int ldb, T *c,
+          int ldc) {
+  typedef gemm_kernel<T> K;
+  const int MR = K::MR, NR = K::NR, KC = 256, MC = 16*MR, NC = 512*NR;
+  if (m == 0 || n == 0 || p == 0) {
+    return;
+  }
+  aligned_array<T> bp((size_t)KC*((std::min(p, NC) + NR - 1)/NR*NR));
+  for (int jc = 0; jc < p; jc += NC) {
+    int nc = std::min(NC, p - jc);
+    for (int pc = 0; pc < n; pc += KC) {
+      int kc = std::min(KC, n - pc);
+      for (int jr = 0; jr < nc; jr += NR) {
+        T *dst = bp.get() + (size_t)jr*kc;
+        for (int k = 0; k < kc; k++) {
+          const T *src = b + (size_t)(pc + k)*ldb + jc + jr;
+          for (int j = 0; j < NR; j++) {
+            *dst++ = (jr + j < nc) ? src[j] : T();
+          }
+        }
+      }
+#ifdef _OPENMP
+      #pragma omp parallel
+#endif
+      {
+        aligned_array<T> ap((size_t)MC*kc);
+        T tile[MR*NR];
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic)
+#endif
+        for (int ic = 0; ic < m; ic += MC) {
+          int mc = std::min(MC, m - ic);
+          for (int ir = 0; ir < mc; ir += MR) {
+            T *dst = ap.get() + (size_t)ir*kc;
+            for (int k = 0; k < kc; k++) {
+              for (int i = 0; i < MR; i++) {
+                *dst++ = (ir + i < mc) ? a[(size_t)(ic + ir + i)*lda + pc + k]
+                                       : T();
+              }
+            }
+          }
+          for (int jr = 0; jr < nc; jr += NR) {
+            for (int ir = 0; ir < mc; ir += MR) {
+              std::fill(tile, tile + MR*NR, T());
+              K::run(kc, ap.get() + (size_t)ir*kc, bp.get() + (size_t)jr*kc,
+                     tile);
+              int mr = std::min(MR, mc - ir), nr = std::min(NR, nc - jr);
+              for (int i = 0; i < mr; i++) {
+                T *dst = c + (size_t)(ic + ir + i)*ldc + jc + jr;
+                for (int j = 0; j < nr; j++) {
+                  dst[j] += tile[i*NR + j];
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+// Subtracts the product of the m by n matrix a and the n by p matrix b from the
+// m by p matrix c by negating b into contiguous scratch space and using gemm().
+void gemm_subtract(int m, int n, int p, const double *a, int lda,
+                   const double *b, int ldb, double *c, int ldc,
+                   std::vector<double> &scratch) {
+  if (m == 0 || n == 0 || p == 0) {
+    return;
+  }
+  scratch.resize((size_t)n*p);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < p; j++) {
+      scratch[(size_t)i*p + j] = -b[(size_t)i*ldb + j];
+    }
+  }
+  gemm(m, n, p, a, lda, &scratch[0], p, c, ldc);
+}
+
+// Factors the r by c row-major matrix a with row stride lda in place into its
+// merged LU decomposition, setting swaps[i] to the row that was exchanged with
+// row i at step i. Returns the parity of the swaps, or -1 if a pivot is below
+// EPS in magnitude. Panels of NB columns are factored with partial pivoting,
+// after which the rows to their right are solved against the panel's unit
+// lower triangle, and the trailing submatrix is updated by gemm().
+int lu_blocked(int r, int c, double *a, int lda, int *swaps, double EPS) {
+  static const int NB = 64, COLUMN_BLOCK = 256;
+  int steps = std::min(r, c), parity = 0;
+  std::vector<double> scratch;
+  for (int j0 = 0; j0 < steps; j0 += NB) {
+    int j1 = std::min(steps, j0 + NB);
+    for (int k = j0; k < j1; k++) {
+      int p = k;
+      for (int i = k + 1; i < r; i++) {
+        if (fabs(a[(size_t)i*lda + k]) > fabs(a[(size_t)p*lda + k])) {
+          p = i;
+        }
+      }
+      if (fabs(a[(size_t)p*lda + k]) < EPS) {
+        return -1;
+      }
+      swaps[k] = p;
+      if (p != k) {
+        std::swap_ranges(a + (size_t)k*lda, a + (size_t)k*lda + c,
+                         a + (size_t)p*lda);
+        parity = 1 - parity;
+      }
+      const double *rk = a + (size_t)k*lda;
+      for (int i = k + 1; i < r; i++) {
+        double *ri = a + (size_t)i*lda;
+        double l = (ri[k] /= rk[k]);
+        for (int j = k + 1; j < j1; j++) {
+          ri[j] -= l*rk[j];
+        }
+      }
+    }
+    if (j1 == c) {
+      continue;
+    }
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int jc = j1; jc < c; jc += COLUMN_BLOCK) {
+      int jend = std::min(c, jc + COLUMN_BLOCK);
+      for (int i = j0 + 1; i < j1; i++) {
+        double *ri = a + (size_t)i*lda;
+        for (int k = j0; k < i; k++) {
+          const double *rk = a + (size_t)k*lda;
+          for (int j = jc; j < jend; j++) {
+            ri[j] -= ri[k]*rk[j];
+          }
+        }
+      }
+    }
+    gemm_subtract(r - j1, j1 - j0, c - j1, a + (size_t)j1*lda + j0, lda,
+                  a + (size_t)j0*lda + j1, lda, a + (size_t)j1*lda + j1, lda,
+                  scratch);
+  }
+  return parity;
+}
+
+template<class Matrix>
+int lu_decompose(Matrix &a, std::vector<int> *p1col = NULL,
+                 const double EPS = 1e-10) {
+  int r = a.size(), c = a[0].size();
+  std::vector<double> lu((size_t)r*c);
+  for (int i = 0; i < r; i++) {
+    std::copy(a[i].begin(), a[i].end(), lu.begin() + (size_t)i*c);
+  }
+  std::vector<int> swaps(std::min(r, c));
+  int parity = lu_blocked(r, c, &lu[0], c, swaps.empty() ? NULL : &swaps[0],
+                          EPS);
+  for (int i = 0; i < r; i++) {
+    std::copy(lu.begin() + (size_t)i*c, lu.begin() + (size_t)(i + 1)*c,
+              a[i].begin());
+  }
+  if (p1col != NULL) {
+    p1col->resize(r);
+    for (int i = 0; i < r; i++) {
+      (*p1col)[i] = i;
+    }
+    for (int i = 0; i < (int)swaps.size() && parity >= 0; i++) {
+      std::iter_swap(p1col->begin() + i, p1col->begin() + swaps[i]);
+    }
+  }
   return parity;
 }
 
@@ -98,6 +452,124 @@ double getu(const Matrix &lu, int i, int j) {
   return i <= j ? lu[i][j] : 0;
 }
 
+class lu_factorization {
+  static const int NB = 64;
+  int n, parity;
+  std::vector<double> lu;
+  std::vector<int> swaps;
+
+  // Replaces the n by k row-major matrix x with the solution of l*u*y = p*x.
+  void solve_rows(int k, double *x) const {
+    // Few right-hand sides are not worth packing for gemm().
+    const int nb = (k < 16) ? std::max(n, 1) : NB;
+    std::vector<double> scratch;
+    for (int i = 0; i < n; i++) {
+      if (swaps[i] != i) {
+        std::swap_ranges(x + (size_t)i*k, x + (size_t)(i + 1)*k,
+                         x + (size_t)swaps[i]*k);
+      }
+    }
+    for (int j0 = 0; j0 < n; j0 += nb) {
+      int j1 = std::min(n, j0 + nb);
+      for (int i = j0 + 1; i < j1; i++) {
+        for (int c = j0; c < i; c++) {
+          double l = lu[(size_t)i*n + c];
+          for (int j = 0; j < k; j++) {
+            x[(size_t)i*k + j] -= l*x[(size_t)c*k + j];
+          }
+        }
+      }
+      gemm_subtract(n - j1, j1 - j0, k, &lu[0] + (size_t)j1*n + j0, n,
+                    x + (size_t)j0*k, k, x + (size_t)j1*k, k, scratch);
+    }
+    for (int j1 = n; j1 > 0; j1 -= nb) {
+      int j0 = std::max(0, j1 - nb);
+      for (int i = j1 - 1; i >= j0; i--) {
+        for (int c = i + 1; c < j1; c++) {
+          double u = lu[(size_t)i*n + c];
+          for (int j = 0; j < k; j++) {
+            x[(size_t)i*k + j] -= u*x[(size_t)c*k + j];
+          }
+        }
+        double d = lu[(size_t)i*n + i];
+        for (int j = 0; j < k; j++) {
+          x[(size_t)i*k + j] /= d;
+        }
+      }
+      gemm_subtract(j0, j1 - j0, k, &lu[0] + j0, n, x + (size_t)j0*k, k, x, k,
+                    scratch);
+    }
+  }
+
+ public:
+  template<class SquareMatrix>
+  explicit lu_factorization(const SquareMatrix &a, const double EPS = 1e-10)
+      : n(a.size()), lu((size_t)n*n), swaps(n) {
+    for (int i = 0; i < n; i++) {
+      std::copy(a[i].begin(), a[i].end(), lu.begin() + (size_t)i*n);
+    }
+    parity = lu_blocked(n, n, lu.empty() ? NULL : &lu[0], n,
+                        swaps.empty() ? NULL : &swaps[0], EPS);
+  }
+
+  int size() const { return n; }
+  bool singular() const { return parity < 0; }
+
+  double det() const {
+    if (parity < 0) {
+      return 0;
+    }
+    double res = 1;
+    for (int i = 0; i < n; i++) {
+      res *= lu[(size_t)i*n + i];
+    }
+    return parity == 0 ? res : -res;
+  }
+
+  int solve(std::vector<double> &b) const {
+    if (parity < 0 || (int)b.size() != n) {
+      return -1;
+    }
+    if (n > 0) {
+      solve_rows(1, &b[0]);
+    }
+    return 0;
+  }
+
+  template<class Matrix>
+  int solve(Matrix &b) const {
+    if (parity < 0 || (int)b.size() != n) {
+      return -1;
+    }
+    int k = (n == 0) ? 0 : b[0].size();
+    if (k == 0) {
+      return 0;
+    }
+    std::vector<double> x((size_t)n*k);
+    for (int i = 0; i < n; i++) {
+      std::copy(b[i].begin(), b[i].end(), x.begin() + (size_t)i*k);
+    }
+    solve_rows(k, &x[0]);
+    for (int i = 0; i < n; i++) {
+      std::copy(x.begin() + (size_t)i*k, x.begin() + (size_t)(i + 1)*k,
+                b[i].begin());
+    }
+    return 0;
+  }
+
+  template<class SquareMatrix>
+  int inverse(SquareMatrix &res) const {
+    if (parity < 0) {
+      return -1;
+    }
+    res.assign(n, typename SquareMatrix::value_type(n, 0));
+    for (int i = 0; i < n; i++) {
+      res[i][i] = 1;
+    }
+    return solve(res);
+  }
+};
+
 template<class Matrix, class T>
 int solve_system(const Matrix &a, const std::vector<T> &b, std::vector<T> *x,
                  const double EPS = 1e-10) {
@@ -138,54 +610,155 @@ int solve_system(const Matrix &a, const std::vector<T> &b, std::vector<T> *x,
 
 template<class SquareMatrix>
 double det(const SquareMatrix &a) {
-  int n = a.size();
-  SquareMatrix lu;
-  int status = lu_decompose(lu = a);
-  if (status < 0) {
-    return 0;
-  }
-  double res = 1;
-  for (int i = 0; i < n; i++) {
-    res *= lu[i][i];
-  }
-  return status == 0 ? res : -res;
+  return lu_factorization(a).det();
 }
 
 template<class SquareMatrix>
 int invert(SquareMatrix &a) {
-  int n = a.size();
-  std::vector<int> p1col;
-  int status = lu_decompose(a, &p1col);
-  if (status < 0) {
-    return status;
+  return lu_factorization(a).inverse(a);
+}
+
+/*** Example Usage and Output:
+
+1000x1000: unblocked 0.215509s, blocked 0.0870719s, 7.65651 GFLOP/s,
+  100 right-hand sides 0.023787s
+2000x2000: blocked 0.5967s, 8.93805 GFLOP/s,
+  100 right-hand sides 0.0940428s
+4000x4000: blocked 4.94741s, 8.62404 GFLOP/s,
+  100 right-hand sides 0.372713s
+
+***/
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sys/time.h>
+using namespace std;
+
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+vector<vector<double> > random_matrix(int r, int c) {
+  vector<vector<double> > res(r, vector<double>(c));
+  for (int i = 0; i < r; i++) {
+    for (int j = 0; j < c; j++) {
+      res[i][j] = (rand() % 2001 - 1000)/1000.0;
+    }
   }
-  SquareMatrix ia(n, typename SquareMatrix::value_type(n, 0));
-  for (int j = 0; j < n; j++) {
-    for (int i = 0; i < n; i++) {
-      if (p1col[i] == j) {
-        ia[i][j] = 1.0;
-      } else {
-        ia[i][j] = 0.0;
-      }
-      for (int k = 0; k < i; k++) {
-        ia[i][j] -= getl(a, i, k)*ia[k][j];
+  return res;
+}
+
+// The unblocked Doolittle loop, for comparison.
+int lu_decompose_unblocked(vector<vector<double> > &a,
+                           const double EPS = 1e-10) {
+  int r = a.size(), c = a[0].size(), parity = 0;
+  for (int i = 0; i < r && i < c; i++) {
+    int pi = i;
+    for (int k = i + 1; k < r; k++) {
+      if (fabs(a[k][i]) > fabs(a[pi][i])) {
+        pi = k;
       }
     }
-    for (int i = n - 1; i >= 0; i--) {
-      for (int k = i + 1; k < n; k++) {
-        ia[i][j] -= getu(a, i, k)*ia[k][j];
+    if (fabs(a[pi][i]) < EPS) {
+      return -1;
+    }
+    if (pi != i) {
+      std::iter_swap(a.begin() + i, a.begin() + pi);
+      parity = 1 - parity;
+    }
+    for (int j = i + 1; j < r; j++) {
+      a[j][i] /= a[i][i];
+      for (int k = i + 1; k < c; k++) {
+        a[j][k] -= a[j][i]*a[i][k];
       }
-      ia[i][j] /= getu(a, i, i);
     }
   }
-  a.swap(ia);
-  return 0;
+  return parity;
 }
 
-/*** Example Usage ***/
+double max_error(const vector<vector<double> > &a,
+                 const vector<vector<double> > &x,
+                 const vector<vector<double> > &b) {
+  double res = 0;
+  for (int i = 0; i < (int)a.size(); i++) {
+    for (int j = 0; j < (int)x[0].size(); j++) {
+      double sum = 0;
+      for (int k = 0; k < (int)x.size(); k++) {
+        sum += a[i][k]*x[k][j];
+      }
+      res = max(res, fabs(sum - b[i][j]));
+    }
+  }
+  return res;
+}
 
-#include <cassert>
-using namespace std;
+void test_blocked() {
+  // The permuted matrix equals l*u for square and rectangular matrices.
+  int dims[][2] = {{1, 1}, {7, 7}, {130, 130}, {150, 70}, {70, 150}};
+  for (int t = 0; t < 5; t++) {
+    int r = dims[t][0], c = dims[t][1];
+    vector<vector<double> > a = random_matrix(r, c), lu(a), naive(a);
+    vector<int> p1col;
+    int parity = lu_decompose(lu, &p1col);
+    assert(parity == lu_decompose_unblocked(naive));
+    for (int i = 0; i < r; i++) {
+      for (int j = 0; j < c; j++) {
+        double sum = 0;
+        for (int k = 0; k <= min(i, j); k++) {
+          sum += getl(lu, i, k)*getu(lu, k, j);
+        }
+        assert(fabs(sum - a[p1col[i]][j]) < 1e-9);
+        assert(fabs(lu[i][j] - naive[i][j]) < 1e-9);
+      }
+    }
+  }
+  // One factorization solves one and many right-hand sides.
+  int n = 300;
+  vector<vector<double> > a = random_matrix(n, n), inv;
+  lu_factorization f(a);
+  assert(!f.singular() && f.size() == n);
+  for (int k = 1; k <= 70; k += 23) {
+    vector<vector<double> > b = random_matrix(n, k), x(b);
+    assert(f.solve(x) == 0);
+    assert(max_error(a, x, b) < 1e-9);
+  }
+  vector<double> v(n, 1.0);
+  assert(f.solve(v) == 0);
+  for (int i = 0; i < n; i++) {
+    double sum = 0;
+    for (int j = 0; j < n; j++) {
+      sum += a[i][j]*v[j];
+    }
+    assert(fabs(sum - 1.0) < 1e-9);
+  }
+  assert(f.inverse(inv) == 0);
+  vector<vector<double> > id(n, vector<double>(n, 0));
+  for (int i = 0; i < n; i++) {
+    id[i][i] = 1;
+  }
+  assert(max_error(a, inv, id) < 1e-9);
+  // The determinant of a product is the product of determinants.
+  int m = 40;
+  vector<vector<double> > c = random_matrix(m, m), b = random_matrix(m, m);
+  vector<vector<double> > cb(m, vector<double>(m, 0));
+  for (int i = 0; i < m; i++) {
+    for (int k = 0; k < m; k++) {
+      for (int j = 0; j < m; j++) {
+        cb[i][j] += c[i][k]*b[k][j];
+      }
+    }
+  }
+  double d = det(c)*det(b);
+  assert(d != 0 && fabs(det(cb)/d - 1) < 1e-9);
+  // Singular matrices.
+  a[n - 1] = a[0];
+  lu_factorization s(a);
+  assert(s.singular() && s.det() == 0 && s.solve(v) == -1);
+  assert(det(a) == 0 && invert(a) == -1);
+}
 
 int main() {
   { // Solve a system.
@@ -234,5 +807,30 @@ int main() {
       }
     }
   }
+  test_blocked();
+  for (int n = 1000; n <= 4000; n *= 2) {
+    vector<vector<double> > a = random_matrix(n, n), naive(a);
+    double start, naive_time = 0;
+    if (n == 1000) {
+      start = wall_time();
+      lu_decompose_unblocked(naive);
+      naive_time = wall_time() - start;
+    }
+    start = wall_time();
+    lu_factorization f(a);
+    double factor_time = wall_time() - start;
+    vector<vector<double> > b = random_matrix(n, 100), x(b);
+    start = wall_time();
+    assert(f.solve(x) == 0);
+    double solve_time = wall_time() - start;
+    assert(max_error(a, x, b) < 1e-6);
+    cout << n << "x" << n << ": ";
+    if (n == 1000) {
+      cout << "unblocked " << naive_time << "s, ";
+    }
+    cout << "blocked " << factor_time << "s, " << 2.0*n*n*n/3/factor_time/1e9
+         << " GFLOP/s," << endl << "  100 right-hand sides " << solve_time
+         << "s" << endl;
+  }
   return 0;
 }
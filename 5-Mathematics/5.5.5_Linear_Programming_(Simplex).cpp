@@ -11,18 +11,50 @@ coefficients, and b is a vector of boundary coefficients.
   if a solution was found or -1 if there are no solutions. If a solution is
   found, then the vector pointed to by x is populated with the solution vector
   of length n.
+- revised_simplex(m, n, positions, values) constructs a sparse problem with an
+  m by n matrix a having values[e] at row positions[e].first and column
+  positions[e].second (duplicates are summed), to minimize or maximize c*x
+  subject to row_lo <= a*x <= row_hi and lo <= x <= hi. Costs default to 0,
+  variable bounds to [0, INF), and row bounds to (-INF, INF).
+  Each row i has a slack variable n + i equal to its activity, and the basis
+  of m variables is kept as an LU factorization with product form updates,
+  refactored every 100 pivots.
+- revised_simplex::set_cost(j, c), set_bounds(j, lo, hi), and
+  set_row_bounds(i, lo, hi) change the problem, where bounds may be infinite
+  (revised_simplex::INF) and equal for fixed variables or equality rows.
+- revised_simplex::solve(maximize) runs a two phase primal simplex with Devex
+  pricing, a Harris ratio test, and native bounds (nonbasic variables sit at
+  either bound, possibly flipping between them without a pivot), returning 0
+  if an optimal solution was found, -1 if the problem is infeasible, -2 if it
+  is unbounded, -3 if the iteration limit was reached, or -4 if phase one
+  found an unbounded direction. Since the sum of infeasibilities minimized by
+  phase one is bounded below by zero, -4 only results from numerical trouble,
+  such as a badly scaled or nearly singular basis. The solve starts
+  from the current basis, so solving again after changing costs or bounds
+  typically takes few iterations.
+- revised_simplex::value(j), row_activity(i), objective(), and iterations()
+  return the solution and the pivots and flips taken by the last solve.
+- revised_simplex::basis() and set_basis(state) get and set the state (BASIC,
+  AT_LOWER, AT_UPPER, or AT_ZERO for free variables) of all n + m variables,
+  to warm start another instance; an invalid basis becomes the slack basis.
 
 Time Complexity:
 - Polynomial (average) on the number of equations and unknowns, but exponential
-  in the worst case.
+  in the worst case. For simplex_solve(), each iteration is O(m*n).
+- For revised_simplex, each pivot is O(nnz + f) where nnz is the number of
+  nonzeros in a and f is the size of the factorization with its updates,
+  and each bound flip is O(f + log n). Each refactorization is O(m^2 + f).
 
 Space Complexity:
-- O(m*n) auxiliary heap space.
+- O(m*n) auxiliary heap space for simplex_solve().
+- O(nnz + n + f) auxiliary heap space for revised_simplex.
 
 */
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
+#include <utility>
 #include <vector>
 
 template<class Matrix>
@@ -97,27 +129,761 @@ int simplex_solve(const Matrix &a, const std::vector<double> &b,
       }
     }
   } while (!done);
-  x->clear();
+  x->assign(n, 0);
   for (int j = 1; j <= n; j++) {
     for (int i = 2; i <= m + 1; i++) {
       if (fabs(t[i][0] - j) < EPS) {
-        x->push_back(t[i][1]);
+        (*x)[j - 1] = t[i][1];
       }
     }
   }
   return 0;
 }
 
+class revised_simplex {
+ public:
+  enum { BASIC, AT_LOWER, AT_UPPER, AT_ZERO };
+
+ private:
+  static const int REFACTOR_INTERVAL = 100;
+  static const double PRIMAL_TOL, DUAL_TOL, PIVOT_TOL;
+
+  struct eta {
+    int r;
+    double pivot;
+    std::vector<std::pair<int, double> > col;
+  };
+
+  // Columns n + i are the slacks, where column n + i of [a -I] is -e_i and the
+  // value of slack i is the activity a[i]*x of row i.
+  int m, n, updates, iters;
+  std::vector<int> col_start, row_index, row_start, col_index;
+  std::vector<double> col_value, row_value, lower, upper, cost, x, weight;
+  std::vector<int> state, head;
+  // The basis matrix b, whose column p is that of variable head[p], is
+  // factored so that step k pivoted on row prow[k] of column qcol[k], with
+  // multipliers lcol[k] (by row) and the column ucol[k] of u (by step).
+  std::vector<int> prow, qcol;
+  std::vector<double> udiag;
+  std::vector<std::vector<std::pair<int, double> > > lcol, ucol;
+  std::vector<eta> etas;
+
+  int count(int j) const {
+    return (j < n) ? col_start[j + 1] - col_start[j] : 1;
+  }
+
+  void scatter(int j, double scale, std::vector<double> &w) const {
+    if (j >= n) {
+      w[j - n] -= scale;
+      return;
+    }
+    for (int e = col_start[j]; e < col_start[j + 1]; e++) {
+      w[row_index[e]] += scale*col_value[e];
+    }
+  }
+
+  double dot_column(int j, const std::vector<double> &y) const {
+    if (j >= n) {
+      return -y[j - n];
+    }
+    double sum = 0;
+    for (int e = col_start[j]; e < col_start[j + 1]; e++) {
+      sum += col_value[e]*y[row_index[e]];
+    }
+    return sum;
+  }
+
+  double nonbasic_value(int j) const {
+    switch (state[j]) {
+      case AT_LOWER: return lower[j];
+      case AT_UPPER: return upper[j];
+      default: return 0;
+    }
+  }
+
+  int default_state(int j) const {
+    if (lower[j] > -INF) {
+      return AT_LOWER;
+    }
+    return (upper[j] < INF) ? AT_UPPER : AT_ZERO;
+  }
+
+  // Replaces w, given by row, with the solution of b*y = w by basis position.
+  void ftran(std::vector<double> &w) const {
+    std::vector<double> z(m);
+    for (int k = 0; k < m; k++) {
+      double t = z[k] = w[prow[k]];
+      if (t != 0) {
+        for (int e = 0; e < (int)lcol[k].size(); e++) {
+          w[lcol[k][e].first] -= t*lcol[k][e].second;
+        }
+      }
+    }
+    for (int k = m - 1; k >= 0; k--) {
+      double t = (z[k] /= udiag[k]);
+      if (t != 0) {
+        for (int e = 0; e < (int)ucol[k].size(); e++) {
+          z[ucol[k][e].first] -= t*ucol[k][e].second;
+        }
+      }
+    }
+    for (int k = 0; k < m; k++) {
+      w[qcol[k]] = z[k];
+    }
+    for (int i = 0; i < (int)etas.size(); i++) {
+      const eta &h = etas[i];
+      double t = (w[h.r] /= h.pivot);
+      if (t != 0) {
+        for (int e = 0; e < (int)h.col.size(); e++) {
+          w[h.col[e].first] -= t*h.col[e].second;
+        }
+      }
+    }
+  }
+
+  // Replaces c, given by basis position, with the solution of y*b = c by row.
+  void btran(std::vector<double> &c) const {
+    for (int i = (int)etas.size() - 1; i >= 0; i--) {
+      const eta &h = etas[i];
+      double sum = c[h.r];
+      for (int e = 0; e < (int)h.col.size(); e++) {
+        sum -= h.col[e].second*c[h.col[e].first];
+      }
+      c[h.r] = sum/h.pivot;
+    }
+    std::vector<double> g(m);
+    for (int k = 0; k < m; k++) {
+      double sum = c[qcol[k]];
+      for (int e = 0; e < (int)ucol[k].size(); e++) {
+        sum -= ucol[k][e].second*g[ucol[k][e].first];
+      }
+      g[k] = sum/udiag[k];
+    }
+    std::fill(c.begin(), c.end(), 0.0);
+    for (int k = m - 1; k >= 0; k--) {
+      double sum = g[k];
+      for (int e = 0; e < (int)lcol[k].size(); e++) {
+        sum -= lcol[k][e].second*c[lcol[k][e].first];
+      }
+      c[prow[k]] = sum;
+    }
+  }
+
+  // Factors the basis with a left-looking LU, taking sparser columns first
+  // and, among the rows within a factor of 10 of the largest candidate pivot,
+  // the one with the fewest nonzeros. Columns without an acceptable pivot are
+  // replaced by the slacks of the rows left unpivoted.
+  void factor() {
+    std::vector<int> order(m), row_count(m, 0);
+    std::vector<std::pair<int, int> > by_count(m);
+    for (int p = 0; p < m; p++) {
+      by_count[p] = std::make_pair(count(head[p]), p);
+      int j = head[p];
+      if (j >= n) {
+        row_count[j - n]++;
+      } else {
+        for (int e = col_start[j]; e < col_start[j + 1]; e++) {
+          row_count[row_index[e]]++;
+        }
+      }
+    }
+    std::sort(by_count.begin(), by_count.end());
+    prow.assign(m, -1);
+    qcol.assign(m, -1);
+    udiag.assign(m, 0);
+    lcol.assign(m, std::vector<std::pair<int, double> >());
+    ucol.assign(m, std::vector<std::pair<int, double> >());
+    etas.clear();
+    updates = 0;
+    std::vector<double> w(m, 0);
+    std::vector<int> step_of_row(m, -1), touched, deficient;
+    std::vector<bool> mark(m, false);
+    int k = 0;
+    for (int s = 0; s < m; s++) {
+      int p = by_count[s].second, j = head[p];
+      touched.clear();
+      if (j >= n) {
+        w[j - n] = -1;
+        touched.push_back(j - n);
+        mark[j - n] = true;
+      } else {
+        for (int e = col_start[j]; e < col_start[j + 1]; e++) {
+          int i = row_index[e];
+          if (!mark[i]) {
+            mark[i] = true;
+            touched.push_back(i);
+          }
+          w[i] += col_value[e];
+        }
+      }
+      for (int t = 0; t < k; t++) {
+        double z = w[prow[t]];
+        if (z == 0) {
+          continue;
+        }
+        ucol[k].push_back(std::make_pair(t, z));
+        for (int e = 0; e < (int)lcol[t].size(); e++) {
+          int i = lcol[t][e].first;
+          if (!mark[i]) {
+            mark[i] = true;
+            touched.push_back(i);
+          }
+          w[i] -= z*lcol[t][e].second;
+        }
+      }
+      double best = 0;
+      for (int e = 0; e < (int)touched.size(); e++) {
+        int i = touched[e];
+        if (step_of_row[i] < 0) {
+          best = std::max(best, fabs(w[i]));
+        }
+      }
+      int r = -1;
+      if (best > PIVOT_TOL) {
+        for (int e = 0; e < (int)touched.size(); e++) {
+          int i = touched[e];
+          if (step_of_row[i] < 0 && fabs(w[i]) >= 0.1*best &&
+              (r < 0 || row_count[i] < row_count[r])) {
+            r = i;
+          }
+        }
+      }
+      if (r < 0) {
+        deficient.push_back(p);
+        ucol[k].clear();
+      } else {
+        prow[k] = r;
+        qcol[k] = p;
+        udiag[k] = w[r];
+        step_of_row[r] = k;
+        for (int e = 0; e < (int)touched.size(); e++) {
+          int i = touched[e];
+          if (step_of_row[i] < 0 && w[i] != 0) {
+            lcol[k].push_back(std::make_pair(i, w[i]/w[r]));
+          }
+        }
+        k++;
+      }
+      for (int e = 0; e < (int)touched.size(); e++) {
+        w[touched[e]] = 0;
+        mark[touched[e]] = false;
+      }
+    }
+    // Each slack -e_i of an unpivoted row i needs no elimination.
+    for (int i = 0, d = 0; i < m && d < (int)deficient.size(); i++) {
+      if (step_of_row[i] < 0) {
+        int p = deficient[d++];
+        state[head[p]] = default_state(head[p]);
+        head[p] = n + i;
+        state[n + i] = BASIC;
+        prow[k] = i;
+        qcol[k] = p;
+        udiag[k] = -1;
+        step_of_row[i] = k++;
+      }
+    }
+  }
+
+  // Returns the bound at which basic variable j stops the ratio test when it
+  // changes at the given rate, or +/-INF if it does not. In phase 1, a
+  // variable outside its bounds may move until it reaches the violated one.
+  double blocking_bound(int j, double rate) const {
+    if (rate < 0) {
+      if (x[j] > upper[j] + PRIMAL_TOL) {
+        return upper[j];
+      }
+      return (x[j] < lower[j] - PRIMAL_TOL) ? -INF : lower[j];
+    }
+    if (x[j] < lower[j] - PRIMAL_TOL) {
+      return lower[j];
+    }
+    return (x[j] > upper[j] + PRIMAL_TOL) ? INF : upper[j];
+  }
+
+  // Recomputes the basic values from the nonbasic ones.
+  void compute_basic() {
+    std::vector<double> w(m, 0);
+    for (int j = 0; j < n + m; j++) {
+      if (state[j] != BASIC) {
+        x[j] = nonbasic_value(j);
+        if (x[j] != 0) {
+          scatter(j, -x[j], w);
+        }
+      }
+    }
+    ftran(w);
+    for (int p = 0; p < m; p++) {
+      x[head[p]] = w[p];
+    }
+  }
+
+  // Checks that the basis has exactly m basic variables and that every
+  // nonbasic variable sits at a finite bound (or at zero if free), or else
+  // resets it to the slack basis.
+  void prepare_basis() {
+    head.clear();
+    for (int j = 0; j < n + m; j++) {
+      if (state[j] == BASIC) {
+        head.push_back(j);
+      } else if ((state[j] == AT_LOWER && lower[j] == -INF) ||
+                 (state[j] == AT_UPPER && upper[j] == INF) ||
+                 (state[j] == AT_ZERO && (lower[j] > -INF || upper[j] < INF))) {
+        state[j] = default_state(j);
+      }
+    }
+    if ((int)head.size() != m) {
+      head.clear();
+      for (int j = 0; j < n; j++) {
+        state[j] = default_state(j);
+      }
+      for (int i = 0; i < m; i++) {
+        state[n + i] = BASIC;
+        head.push_back(n + i);
+      }
+    }
+  }
+
+ public:
+  static const double INF;
+
+  // Constructs the problem of minimizing 0 subject to -INF <= a*x <= INF and
+  // 0 <= x <= INF, for the m by n matrix a with the given nonzero entries.
+  revised_simplex(int m, int n,
+                  const std::vector<std::pair<int, int> > &positions,
+                  const std::vector<double> &values)
+      : m(m), n(n), updates(0), iters(0), col_start(n + 1, 0),
+        row_start(m + 1, 0), lower(n + m, 0), upper(n + m, INF),
+        cost(n + m, 0), x(n + m, 0), weight(n + m, 1), state(n + m) {
+    for (int i = 0; i < m; i++) {
+      lower[n + i] = -INF;
+    }
+    for (int e = 0; e < (int)positions.size(); e++) {
+      col_start[positions[e].second + 1]++;
+      row_start[positions[e].first + 1]++;
+    }
+    for (int j = 0; j < n; j++) {
+      col_start[j + 1] += col_start[j];
+    }
+    for (int i = 0; i < m; i++) {
+      row_start[i + 1] += row_start[i];
+    }
+    row_index.resize(positions.size());
+    col_value.resize(positions.size());
+    col_index.resize(positions.size());
+    row_value.resize(positions.size());
+    std::vector<int> cpos(col_start.begin(), col_start.end() - 1);
+    std::vector<int> rpos(row_start.begin(), row_start.end() - 1);
+    for (int e = 0; e < (int)positions.size(); e++) {
+      int i = positions[e].first, j = positions[e].second;
+      row_index[cpos[j]] = i;
+      col_value[cpos[j]++] = values[e];
+      col_index[rpos[i]] = j;
+      row_value[rpos[i]++] = values[e];
+    }
+    for (int j = 0; j < n + m; j++) {
+      state[j] = (j < n) ? AT_LOWER : BASIC;
+    }
+  }
+
+  void set_cost(int j, double c) { cost[j] = c; }
+
+  void set_bounds(int j, double lo, double hi) {
+    lower[j] = lo;
+    upper[j] = hi;
+  }
+
+  void set_row_bounds(int i, double lo, double hi) {
+    lower[n + i] = lo;
+    upper[n + i] = hi;
+  }
+
+  double value(int j) const { return x[j]; }
+  double row_activity(int i) const { return x[n + i]; }
+  int iterations() const { return iters; }
+
+  double objective() const {
+    double res = 0;
+    for (int j = 0; j < n; j++) {
+      res += cost[j]*x[j];
+    }
+    return res;
+  }
+
+  std::vector<int> basis() const { return state; }
+
+  void set_basis(const std::vector<int> &basis) {
+    if ((int)basis.size() == n + m) {
+      state = basis;
+    }
+  }
+
+  int solve(bool maximize = false, int max_iter = 1000000) {
+    double sign = maximize ? -1 : 1;
+    prepare_basis();
+    factor();
+    compute_basic();
+    std::vector<double> cb(m), y(m), alpha(m), rho(m), arow(n + m, 0);
+    std::vector<double> d(n + m, 0);
+    std::vector<std::pair<double, int> > candidates;
+    std::vector<int> nonzero;
+    bool fresh = false, exact = false, priced = false;
+    for (iters = 0; iters < max_iter; iters++) {
+      if (updates >= REFACTOR_INTERVAL) {
+        factor();
+        compute_basic();
+        fresh = false;
+      }
+      // Phase 1 minimizes the sum of infeasibilities of the basic variables,
+      // and phase 2 the objective, as soon as the basis is feasible.
+      bool phase1 = false;
+      for (int p = 0; p < m; p++) {
+        int j = head[p];
+        cb[p] = (x[j] < lower[j] - PRIMAL_TOL) ? -1
+              : (x[j] > upper[j] + PRIMAL_TOL) ? 1 : 0;
+        phase1 = phase1 || cb[p] != 0;
+      }
+      if (!phase1) {
+        for (int p = 0; p < m; p++) {
+          cb[p] = sign*cost[head[p]];
+        }
+      }
+      // The reduced costs d are recomputed in phase 1, where the costs
+      // change with the basic values, after a refactorization, and to
+      // confirm optimality, and are otherwise updated with the pivot row.
+      if (phase1 || !fresh) {
+        y = cb;
+        btran(y);
+        for (int j = 0; j < n + m; j++) {
+          d[j] = (state[j] == BASIC) ? 0
+               : (phase1 ? 0 : sign*cost[j]) - dot_column(j, y);
+        }
+        fresh = !phase1;
+        exact = true;
+        priced = false;
+      }
+      // Devex pricing chooses the largest d[j]^2/weight[j] among the
+      // nonbasic variables whose reduced cost allows improvement. A bound
+      // flip changes neither, so the candidates are kept in a heap and only
+      // rescanned after a change of basis.
+      if (!priced) {
+        candidates.clear();
+        for (int j = 0; j < n + m; j++) {
+          if (state[j] == BASIC || lower[j] == upper[j]) {
+            continue;
+          }
+          double dj = d[j];
+          bool ok = (state[j] == AT_LOWER) ? dj < -DUAL_TOL
+                  : (state[j] == AT_UPPER) ? dj > DUAL_TOL
+                                           : fabs(dj) > DUAL_TOL;
+          if (ok) {
+            candidates.push_back(std::make_pair(dj*dj/weight[j], j));
+          }
+        }
+        std::make_heap(candidates.begin(), candidates.end());
+        priced = true;
+      }
+      int q = -1;
+      if (!candidates.empty()) {
+        q = candidates[0].second;
+        std::pop_heap(candidates.begin(), candidates.end());
+        candidates.pop_back();
+      }
+      if (q < 0) {
+        if (!exact) {
+          fresh = false;
+          iters--;
+          continue;
+        }
+        return phase1 ? -1 : 0;
+      }
+      double dq = d[q];
+      double dir = (dq < 0) ? 1 : -1;
+      std::fill(alpha.begin(), alpha.end(), 0.0);
+      scatter(q, 1, alpha);
+      ftran(alpha);
+      // Harris' two-pass ratio test: find the largest step with bounds
+      // relaxed by PRIMAL_TOL, then the largest pivot among the rows that
+      // block within it.
+      double max_step = INF;
+      for (int p = 0; p < m; p++) {
+        if (fabs(alpha[p]) >= PIVOT_TOL) {
+          int j = head[p];
+          double rate = -dir*alpha[p], target = blocking_bound(j, rate);
+          if (fabs(target) < INF) {
+            double dist = (rate < 0) ? x[j] - target : target - x[j];
+            max_step = std::min(max_step, (dist + PRIMAL_TOL)/fabs(rate));
+          }
+        }
+      }
+      int r = -1;
+      double step = 0, leave_at = 0;
+      for (int p = 0; p < m; p++) {
+        if (fabs(alpha[p]) >= PIVOT_TOL) {
+          int j = head[p];
+          double rate = -dir*alpha[p], target = blocking_bound(j, rate);
+          if (fabs(target) < INF) {
+            double dist = (rate < 0) ? x[j] - target : target - x[j];
+            double ratio = std::max(dist, 0.0)/fabs(rate);
+            if (ratio <= max_step &&
+                (r < 0 || fabs(alpha[p]) > fabs(alpha[r]))) {
+              r = p;
+              step = ratio;
+              leave_at = target;
+            }
+          }
+        }
+      }
+      double range = upper[q] - lower[q];
+      if (range < INF && (r < 0 || range <= step)) {
+        // The entering variable reaches its other bound first.
+        for (int p = 0; p < m; p++) {
+          x[head[p]] -= dir*range*alpha[p];
+        }
+        state[q] = (state[q] == AT_LOWER) ? AT_UPPER : AT_LOWER;
+        x[q] = nonbasic_value(q);
+        continue;
+      }
+      if (r < 0) {
+        return phase1 ? -4 : -2;
+      }
+      for (int p = 0; p < m; p++) {
+        x[head[p]] -= dir*step*alpha[p];
+      }
+      x[q] += dir*step;
+      // The pivot row alpha_r = e_r*b^-1*[a -I] updates the Devex weights.
+      std::fill(rho.begin(), rho.end(), 0.0);
+      rho[r] = 1;
+      btran(rho);
+      nonzero.clear();
+      for (int i = 0; i < m; i++) {
+        if (rho[i] == 0) {
+          continue;
+        }
+        for (int e = row_start[i]; e < row_start[i + 1]; e++) {
+          if (arow[col_index[e]] == 0) {
+            nonzero.push_back(col_index[e]);
+          }
+          arow[col_index[e]] += rho[i]*row_value[e];
+        }
+        arow[n + i] = -rho[i];
+        nonzero.push_back(n + i);
+      }
+      double wq = weight[q], pivot = alpha[r];
+      for (int e = 0; e < (int)nonzero.size(); e++) {
+        int j = nonzero[e];
+        if (state[j] != BASIC && j != q) {
+          double ratio = arow[j]/pivot;
+          weight[j] = std::max(weight[j], ratio*ratio*wq);
+          d[j] -= dq*ratio;
+        }
+        arow[j] = 0;
+      }
+      int leaving = head[r];
+      d[leaving] = -dq/pivot;
+      d[q] = 0;
+      exact = priced = false;
+      weight[leaving] = std::max(wq/(pivot*pivot), 1.0);
+      x[leaving] = leave_at;
+      state[leaving] = (leave_at == lower[leaving]) ? AT_LOWER : AT_UPPER;
+      state[q] = BASIC;
+      head[r] = q;
+      eta h;
+      h.r = r;
+      h.pivot = pivot;
+      for (int p = 0; p < m; p++) {
+        if (p != r && alpha[p] != 0) {
+          h.col.push_back(std::make_pair(p, alpha[p]));
+        }
+      }
+      etas.push_back(h);
+      updates++;
+    }
+    return -3;
+  }
+};
+
+const double revised_simplex::PRIMAL_TOL = 1e-9;
+const double revised_simplex::DUAL_TOL = 1e-9;
+const double revised_simplex::PIVOT_TOL = 1e-7;
+const double revised_simplex::INF = std::numeric_limits<double>::infinity();
+
 /*** Example Usage and Output:
 
 Solution = 33.3043 at (5.30435, 4.34783).
+100 rows, 1000 columns: tableau 2.19593s, revised 0.023308s
+1000 rows, 100000 columns: 98786 iterations, 1.50475s
+warm start after 10 changes: 176 iterations, 0.0865331s
+cold start: 98768 iterations, 1.35778s
 
 ***/
 
 #include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <sys/time.h>
 using namespace std;
 
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+double random_double() {
+  return rand()/(RAND_MAX + 1.0);
+}
+
+// A random problem maximizing c*x subject to a*x <= b and 0 <= x <= u, where
+// every column of a has k nonzeros and b grows with slack, for comparison both
+// with simplex_solve() (adding the rows x[j] <= u[j]) and with itself.
+struct random_lp {
+  int m, n;
+  vector<pair<int, int> > positions;
+  vector<double> values, b, c, u;
+
+  random_lp(int m, int n, int k, double slack = 1)
+      : m(m), n(n), b(m), c(n), u(n) {
+    for (int j = 0; j < n; j++) {
+      for (int t = 0; t < k; t++) {
+        positions.push_back(make_pair(rand() % m, j));
+        values.push_back(0.1 + random_double());
+      }
+      c[j] = random_double();
+      u[j] = 1 + 9*random_double();
+    }
+    for (int i = 0; i < m; i++) {
+      b[i] = slack*n*k/m*(1 + random_double());
+    }
+  }
+
+  revised_simplex make() const {
+    revised_simplex lp(m, n, positions, values);
+    for (int i = 0; i < m; i++) {
+      lp.set_row_bounds(i, -revised_simplex::INF, b[i]);
+    }
+    for (int j = 0; j < n; j++) {
+      lp.set_cost(j, c[j]);
+      lp.set_bounds(j, 0, u[j]);
+    }
+    return lp;
+  }
+
+  double tableau_solve() const {
+    vector<vector<double> > a(m + n, vector<double>(n, 0));
+    vector<double> bb(b), x;
+    for (int e = 0; e < (int)positions.size(); e++) {
+      a[positions[e].first][positions[e].second] += values[e];
+    }
+    for (int j = 0; j < n; j++) {
+      a[m + j][j] = 1;
+      bb.push_back(u[j]);
+    }
+    assert(simplex_solve(a, bb, c, &x) == 0);
+    double res = 0;
+    for (int j = 0; j < n; j++) {
+      res += c[j]*x[j];
+    }
+    return res;
+  }
+};
+
+// Checks that the solution of lp satisfies all bounds of rows and columns.
+void check_feasible(const revised_simplex &lp, const random_lp &p) {
+  vector<double> activity(p.m, 0);
+  for (int e = 0; e < (int)p.positions.size(); e++) {
+    activity[p.positions[e].first] +=
+        p.values[e]*lp.value(p.positions[e].second);
+  }
+  for (int i = 0; i < p.m; i++) {
+    assert(activity[i] <= p.b[i] + 1e-6);
+    assert(fabs(activity[i] - lp.row_activity(i)) < 1e-6);
+  }
+  for (int j = 0; j < p.n; j++) {
+    assert(lp.value(j) >= -1e-9 && lp.value(j) <= p.u[j] + 1e-9);
+  }
+}
+
+void test_revised() {
+  typedef revised_simplex lp_t;
+  const double INF = lp_t::INF;
+  { // The example below: maximize 3x + 4y.
+    int p[][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}, {2, 0}, {2, 1}};
+    double v[] = {-2, 1, 1, 0.85, 1, 2}, b[] = {0, 9, 14};
+    vector<pair<int, int> > positions;
+    for (int e = 0; e < 6; e++) {
+      positions.push_back(make_pair(p[e][0], p[e][1]));
+    }
+    lp_t lp(3, 2, positions, vector<double>(v, v + 6));
+    for (int i = 0; i < 3; i++) {
+      lp.set_row_bounds(i, -INF, b[i]);
+    }
+    lp.set_cost(0, 3);
+    lp.set_cost(1, 4);
+    assert(lp.solve(true) == 0);
+    assert(fabs(lp.objective() - 766/23.0) < 1e-9);
+    assert(fabs(lp.value(0) - 122/23.0) < 1e-9);
+    // Minimize 3x + 4y with y <= 2x and x + 2y = 4, for x and y of any sign.
+    lp.set_row_bounds(1, -INF, INF);
+    lp.set_row_bounds(2, 4, 4);
+    lp.set_bounds(0, -INF, INF);
+    lp.set_bounds(1, -INF, INF);
+    assert(lp.solve(false) == 0);
+    // With y = (4 - x)/2 and y <= 2x, the minimum is at x = 0.8, y = 1.6.
+    assert(fabs(lp.value(0) - 0.8) < 1e-9 && fabs(lp.value(1) - 1.6) < 1e-9);
+    // Unbounded once y <= 2x is dropped, and infeasible with x + 2y >= 15
+    // and x + 2y <= 14.
+    lp.set_row_bounds(0, -INF, INF);
+    assert(lp.solve(false) == -2);
+    lp.set_row_bounds(0, -INF, 0);
+    lp.set_row_bounds(1, -INF, 9);
+    lp.set_row_bounds(2, 15, INF);
+    lp.set_bounds(0, 0, INF);
+    lp.set_bounds(1, 0, INF);
+    assert(lp.solve(true) == 0);
+    lp.set_bounds(1, 0, 1);
+    assert(lp.solve(true) == -1);
+  }
+  // Random problems agree with the tableau, and warm starts agree with cold
+  // starts after changing costs and bounds.
+  for (int t = 0; t < 30; t++) {
+    random_lp p(5 + rand() % 20, 5 + rand() % 30, 1 + rand() % 3);
+    lp_t lp = p.make();
+    assert(lp.solve(true) == 0);
+    check_feasible(lp, p);
+    assert(fabs(lp.objective() - p.tableau_solve()) < 1e-7);
+    for (int k = 0; k < 3; k++) {
+      int j = rand() % p.n;
+      p.c[j] = random_double();
+      p.u[j] = random_double();
+      lp.set_cost(j, p.c[j]);
+      lp.set_bounds(j, 0, p.u[j]);
+    }
+    assert(lp.solve(true) == 0);
+    check_feasible(lp, p);
+    lp_t cold = p.make();
+    assert(cold.solve(true) == 0);
+    assert(fabs(lp.objective() - cold.objective()) < 1e-7);
+    lp_t restored = p.make();
+    restored.set_basis(lp.basis());
+    assert(restored.solve(true) == 0 && restored.iterations() == 0);
+    // Minimizing with lower bounds on the rows needs phase 1 from the slack
+    // basis, while the optimal basis above is already feasible.
+    vector<double> low(p.m);
+    for (int i = 0; i < p.m; i++) {
+      low[i] = lp.row_activity(i)/2;
+      lp.set_row_bounds(i, low[i], p.b[i]);
+      cold.set_row_bounds(i, low[i], p.b[i]);
+    }
+    cold.set_basis(p.make().basis());
+    assert(lp.solve(false) == 0 && cold.solve(false) == 0);
+    check_feasible(cold, p);
+    assert(fabs(lp.objective() - cold.objective()) < 1e-7);
+    for (int i = 0; i < p.m; i++) {
+      assert(cold.row_activity(i) >= low[i] - 1e-7);
+    }
+  }
+}
+
 int main() {
   // Solve [x, y] that maximizes 3x + 4y, subject to x, y >= 0 and:
   //  -2x +    1y <=  0
@@ -127,7 +893,7 @@ int main() {
   double a[equations][unknowns] = {{-2, 1}, {1, 0.85}, {1, 2}};
   double b[equations] = {0, 9, 14};
   double c[unknowns] = {3, 4};
-  vector<vector<double>> va(equations, vector<double>(unknowns));
+  vector<vector<double> > va(equations, vector<double>(unknowns));
   vector<double> vb(b, b + equations), vc(c, c + unknowns), x;
   for (int i = 0; i < equations; i++) {
     for (int j = 0; j < unknowns; j++) {
@@ -144,5 +910,43 @@ int main() {
     cout << ", " << x[i];
   }
   cout << ")." << endl;
+  test_revised();
+  {
+    random_lp p(100, 1000, 3);
+    double start = wall_time();
+    double expected = p.tableau_solve();
+    double tableau_time = wall_time() - start;
+    revised_simplex lp = p.make();
+    start = wall_time();
+    assert(lp.solve(true) == 0);
+    assert(fabs(lp.objective() - expected) < 1e-6*expected);
+    cout << "100 rows, 1000 columns: tableau " << tableau_time
+         << "s, revised " << wall_time() - start << "s" << endl;
+  }
+  {
+    random_lp p(1000, 100000, 4, 3);
+    revised_simplex lp = p.make();
+    double start = wall_time();
+    assert(lp.solve(true) == 0);
+    check_feasible(lp, p);
+    cout << "1000 rows, 100000 columns: " << lp.iterations() << " iterations, "
+         << wall_time() - start << "s" << endl;
+    for (int k = 0; k < 10; k++) {
+      int i = rand() % p.m, j = rand() % p.n;
+      lp.set_cost(j, p.c[j] = -p.c[j]);
+      lp.set_row_bounds(i, -revised_simplex::INF, p.b[i] *= 0.9);
+    }
+    start = wall_time();
+    assert(lp.solve(true) == 0);
+    check_feasible(lp, p);
+    cout << "warm start after 10 changes: " << lp.iterations()
+         << " iterations, " << wall_time() - start << "s" << endl;
+    revised_simplex cold = p.make();
+    start = wall_time();
+    assert(cold.solve(true) == 0);
+    assert(fabs(cold.objective() - lp.objective()) < 1e-6*lp.objective());
+    cout << "cold start: " << cold.iterations() << " iterations, "
+         << wall_time() - start << "s" << endl;
+  }
   return 0;
 }
@@ -14,16 +14,39 @@ search space will be reduced to 2^-100 (roughly 10^-30) times its original size.
 - falsi_root(f, a, b) returns a root in an interval [a, b] for a continuous
   function f where sgn(f(a)) != sgn(f(b)), using the Illinois algorithm variant
   of the false position (a.k.a. regula falsi) method.
+- brent_root(f, a, b) returns a root in an interval [a, b] for a continuous
+  function f where sgn(f(a)) != sgn(f(b)), using Brent's method, which takes
+  inverse quadratic interpolation or secant steps when they make progress and
+  bisection steps otherwise, stopping once the root is bracketed to within
+  an absolute error of EPS.
+- brent_roots(f, n, a, b, x) solves n independent equations by Brent's method,
+  storing in x[i] the root of equation i in the interval [a[i], b[i]], or NaN
+  if sgn(f(a[i])) == sgn(f(b[i])) or the iteration limit is reached. Rather
+  than one point at a time, f(eq, x, fx, lanes) is called on up to 32 lanes at
+  once and must store in fx[k] the value of equation eq[k] at x[k] for each
+  k < lanes, so that a loop over the lanes may be vectorized. Converged lanes
+  are immediately refilled with pending equations, so every call works on
+  full lanes until the pending equations run out. If compiled with -fopenmp,
+  blocks of equations are solved in parallel, so f must be safe to call
+  concurrently. Returns a root_stats with the number of calls to f, the
+  number of lane evaluations, the number of converged and failed equations,
+  and the largest number of evaluations taken by any equation.
 
 Time Complexity:
-- O(n) calls will be made to f() in bisection_root() and falsi_illinois_root(),
-  where n is the number of iterations performed.
+- O(n) calls will be made to f() in bisection_root(), falsi_illinois_root(),
+  and brent_root(), where n is the number of iterations performed.
+- O(n*k) lane evaluations will be made by brent_roots() in about n*k/32 calls
+  to f(), where k is the average number of evaluations per equation.
 
 Space Complexity:
-- O(1) auxiliary space for both operations.
+- O(1) auxiliary space for all operations.
 
 */
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
 #include <stdexcept>
 
 template<class ContinuousFunction>
@@ -76,17 +99,269 @@ double falsi_illinois_root(ContinuousFunction f, double a, double b,
   return m;
 }
 
+// The state of Brent's method, bracketing a root between b and c, where b is
+// the best estimate so far and a is the previous one.
+struct brent_state {
+  double a, b, c, d, e, fa, fb, fc;
+
+  brent_state() {}
+
+  brent_state(double a, double b, double fa, double fb)
+      : a(a), b(b), c(b), d(b - a), e(b - a), fa(fa), fb(fb), fc(fb) {}
+
+  // Given fb = f(b), returns false if b is within EPS of the root, or else
+  // moves b to the next point at which f() must be evaluated.
+  bool advance(double EPS) {
+    if ((fb > 0 && fc > 0) || (fb < 0 && fc < 0)) {
+      c = a;
+      fc = fa;
+      d = e = b - a;
+    }
+    if (fabs(fc) < fabs(fb)) {
+      a = b;
+      b = c;
+      c = a;
+      fa = fb;
+      fb = fc;
+      fc = fa;
+    }
+    double tol = 2*DBL_EPSILON*fabs(b) + EPS/2, m = (c - b)/2;
+    if (fabs(m) <= tol || fb == 0) {
+      return false;
+    }
+    if (fabs(e) >= tol && fabs(fa) > fabs(fb)) {
+      double p, q, s = fb/fa;
+      if (a == c) {
+        p = 2*m*s;
+        q = 1 - s;
+      } else {
+        double r = fb/fc;
+        q = fa/fc;
+        p = s*(2*m*q*(q - r) - (b - a)*(r - 1));
+        q = (q - 1)*(r - 1)*(s - 1);
+      }
+      if (p > 0) {
+        q = -q;
+      } else {
+        p = -p;
+      }
+      if (2*p < std::min(3*m*q - fabs(tol*q), fabs(e*q))) {
+        e = d;
+        d = p/q;
+      } else {
+        d = e = m;
+      }
+    } else {
+      d = e = m;
+    }
+    a = b;
+    fa = fb;
+    b += (fabs(d) > tol) ? d : (m > 0 ? tol : -tol);
+    return true;
+  }
+};
+
+template<class ContinuousFunction>
+double brent_root(ContinuousFunction f, double a, double b,
+                  const double EPS = 1e-15, const int ITERATIONS = 100) {
+  double fa = f(a), fb = f(b);
+  if (a > b || fa*fb > 0) {
+    throw std::runtime_error("Must give [a, b] where sgn(f(a)) != sgn(f(b)).");
+  }
+  brent_state s(a, b, fa, fb);
+  for (int i = 0; i < ITERATIONS && s.advance(EPS); i++) {
+    s.fb = f(s.b);
+  }
+  return s.b;
+}
+
+struct root_stats {
+  long long calls, evaluations;
+  int converged, failed, max_iterations;
+
+  root_stats()
+      : calls(0), evaluations(0), converged(0), failed(0), max_iterations(0) {}
+
+  void add(const root_stats &s) {
+    calls += s.calls;
+    evaluations += s.evaluations;
+    converged += s.converged;
+    failed += s.failed;
+    max_iterations = std::max(max_iterations, s.max_iterations);
+  }
+};
+
+template<class BatchFunction>
+root_stats brent_roots_block(BatchFunction &f, int lo, int hi, const double *a,
+                             const double *b, double *x, double EPS,
+                             int ITERATIONS) {
+  const int LANES = 32;
+  // Each lane first evaluates f(a[i]) into fa, then f(b[i]) into fb, and then
+  // the points chosen by brent_state::advance().
+  int eq[LANES], iterations[LANES], active = 0;
+  double xs[LANES], fx[LANES];
+  brent_state s[LANES];
+  root_stats res;
+  for (;;) {
+    for (; active < LANES && lo < hi; active++, lo++) {
+      eq[active] = lo;
+      xs[active] = a[lo];
+      iterations[active] = 0;
+    }
+    if (active == 0) {
+      break;
+    }
+    f(eq, xs, fx, active);
+    res.calls++;
+    res.evaluations += active;
+    for (int k = 0; k < active; ) {
+      int i = eq[k];
+      bool done = false, failed = false;
+      if (++iterations[k] == 1) {
+        s[k].fa = fx[k];
+        xs[k] = b[i];
+        k++;
+        continue;
+      }
+      if (iterations[k] == 2) {
+        if (a[i] > b[i] || s[k].fa*fx[k] > 0) {
+          failed = true;
+        } else {
+          s[k] = brent_state(a[i], b[i], s[k].fa, fx[k]);
+        }
+      } else {
+        s[k].fb = fx[k];
+      }
+      if (!failed) {
+        done = !s[k].advance(EPS);
+        failed = !done && iterations[k] >= ITERATIONS + 2;
+      }
+      if (!done && !failed) {
+        xs[k] = s[k].b;
+        k++;
+        continue;
+      }
+      // Finished lanes take the last active lane's place.
+      res.max_iterations = std::max(res.max_iterations, iterations[k]);
+      if (done) {
+        x[i] = s[k].b;
+        res.converged++;
+      } else {
+        x[i] = std::numeric_limits<double>::quiet_NaN();
+        res.failed++;
+      }
+      active--;
+      eq[k] = eq[active];
+      xs[k] = xs[active];
+      fx[k] = fx[active];
+      s[k] = s[active];
+      iterations[k] = iterations[active];
+    }
+  }
+  return res;
+}
+
+template<class BatchFunction>
+root_stats brent_roots(BatchFunction f, int n, const double *a, const double *b,
+                       double *x, const double EPS = 1e-15,
+                       const int ITERATIONS = 100) {
+  const int BLOCK = 4096;
+  int blocks = (n + BLOCK - 1)/BLOCK;
+  root_stats res;
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (int i = 0; i < blocks; i++) {
+    root_stats s = brent_roots_block(f, i*BLOCK, std::min(n, (i + 1)*BLOCK),
+                                     a, b, x, EPS, ITERATIONS);
+#ifdef _OPENMP
+    #pragma omp critical
+#endif
+    res.add(s);
+  }
+  return res;
+}
+
 /*** Example Usage ***/
 
 #include <cassert>
-#include <cmath>
+#include <cstdlib>
+#include <vector>
 
 double f(double x) {
   return x*x - 4*sin(x);
 }
 
+// Black-Scholes call prices minus observed prices p[i] as functions of the
+// volatility, for strikes k[i], maturities t[i], spot price 100, and interest
+// rate 0.02.
+struct implied_volatility {
+  std::vector<double> k, t, p;
+
+  implied_volatility(int n) : k(n), t(n), p(n, 0) {}
+
+  double price(int i, double v) const {
+    double sd = v*sqrt(t[i]), d1 = (log(100/k[i]) + 0.02*t[i])/sd + sd/2;
+    return 50*erfc(-d1/sqrt(2.0)) -
+           k[i]*exp(-0.02*t[i])*erfc((sd - d1)/sqrt(2.0))/2;
+  }
+
+  void operator()(const int *eq, const double *x, double *fx,
+                  int lanes) const {
+    for (int j = 0; j < lanes; j++) {
+      fx[j] = price(eq[j], x[j]) - p[eq[j]];
+    }
+  }
+};
+
+// Equation i above, as a function of one variable.
+struct single_equation {
+  const implied_volatility &iv;
+  int i;
+
+  single_equation(const implied_volatility &iv, int i) : iv(iv), i(i) {}
+
+  double operator()(double x) const {
+    double fx;
+    iv(&i, &x, &fx, 1);
+    return fx;
+  }
+};
+
 int main() {
   assert(fabs(f(bisection_root(f, 1, 3))) < 1e-10);
   assert(fabs(f(falsi_illinois_root(f, 1, 3))) < 1e-10);
+  assert(fabs(f(brent_root(f, 1, 3))) < 1e-10);
+
+  int n = 100000;
+  implied_volatility iv(n);
+  std::vector<double> v(n), a(n, 0.01), b(n, 2), x(n);
+  for (int i = 0; i < n; i++) {
+    iv.k[i] = 80 + 40.0*rand()/RAND_MAX;
+    iv.t[i] = 0.25 + 1.75*rand()/RAND_MAX;
+    v[i] = 0.1 + 0.5*rand()/RAND_MAX;
+    iv.p[i] = iv.price(i, v[i]);
+  }
+  root_stats stats = brent_roots(iv, n, &a[0], &b[0], &x[0], 1e-12);
+  assert(stats.converged == n && stats.failed == 0);
+  assert(stats.calls < stats.evaluations/16);
+  for (int i = 0; i < n; i++) {
+    assert(fabs(x[i] - v[i]) < 1e-9);
+  }
+  // The scalar and batched searches take the same steps.
+  for (int i = 0; i < 100; i++) {
+    assert(brent_root(single_equation(iv, i), 0.01, 2, 1e-12) == x[i]);
+  }
+  // Equations with a price of 0 have no root in [0.01, 2].
+  for (int i = 0; i < 1000; i++) {
+    if (i % 4 == 0) {
+      iv.p[i] = 0;
+    }
+  }
+  stats = brent_roots(iv, 1000, &a[0], &b[0], &x[0], 1e-12);
+  assert(stats.failed == 250 && stats.converged == 750);
+  for (int i = 0; i < 1000; i++) {
+    assert((i % 4 == 0) ? (x[i] != x[i]) : fabs(x[i] - v[i]) < 1e-9);
+  }
   return 0;
 }
@@ -12,17 +12,33 @@ secant method converging approximately 1.6 times slower than Newton's.
   fprime using an initial guess x0 which should be relatively close to x.
 - secant_root(f, x0, x1) returns a root x for a function f using two initial
   guesses x0 and x1 which should be relatively close to x.
+- newton_roots(f, n, x0, x) solves n independent equations by Newton's method,
+  storing in x[i] the root of equation i found from the initial guess x0[i],
+  or NaN if the iteration failed to converge. Rather than one point at a time,
+  f(eq, x, fx, dfx, lanes) is called on up to 32 lanes at once and must store
+  in fx[k] and dfx[k] the value and derivative of equation eq[k] at x[k] for
+  each k < lanes, so that a loop over the lanes may be vectorized. Converged
+  lanes are immediately refilled with pending equations, so every call works
+  on full lanes until the pending equations run out. If compiled with
+  -fopenmp, blocks of equations are solved in parallel, so f must be safe to
+  call concurrently. Returns a root_stats with the number of calls to f, the
+  number of lane evaluations, the number of converged and failed equations,
+  and the largest number of iterations taken by any equation.
 
 Time Complexity:
 - O(n) calls will be made to f() in newton_root() and secant_root(), where n is
   the number of iterations performed.
+- O(n*k) lane evaluations will be made by newton_roots() in about n*k/32 calls
+  to f(), where k is the average number of iterations per equation.
 
 Space Complexity:
-- O(1) auxiliary space for both operations.
+- O(1) auxiliary space for all operations.
 
 */
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <stdexcept>
 
 template<class ContinuousFunction>
@@ -58,9 +74,95 @@ double secant_root(ContinuousFunction f, double x0, double x1,
   return x;
 }
 
+struct root_stats {
+  long long calls, evaluations;
+  int converged, failed, max_iterations;
+
+  root_stats()
+      : calls(0), evaluations(0), converged(0), failed(0), max_iterations(0) {}
+
+  void add(const root_stats &s) {
+    calls += s.calls;
+    evaluations += s.evaluations;
+    converged += s.converged;
+    failed += s.failed;
+    max_iterations = std::max(max_iterations, s.max_iterations);
+  }
+};
+
+template<class BatchFunction>
+root_stats newton_roots_block(BatchFunction &f, int lo, int hi,
+                              const double *x0, double *x, double EPS,
+                              int ITERATIONS) {
+  const int LANES = 32;
+  int eq[LANES], iterations[LANES], active = 0;
+  double xs[LANES], fx[LANES], dfx[LANES];
+  root_stats res;
+  for (;;) {
+    for (; active < LANES && lo < hi; active++, lo++) {
+      eq[active] = lo;
+      xs[active] = x0[lo];
+      iterations[active] = 0;
+    }
+    if (active == 0) {
+      break;
+    }
+    f(eq, xs, fx, dfx, active);
+    res.calls++;
+    res.evaluations += active;
+    for (int k = 0; k < active; ) {
+      double xnew = xs[k] - fx[k]/dfx[k], error = fabs(xnew - xs[k]);
+      xs[k] = xnew;
+      iterations[k]++;
+      if (error > EPS && iterations[k] < ITERATIONS) {
+        k++;
+        continue;
+      }
+      // Converged (or failed) lanes take the last active lane's place.
+      res.max_iterations = std::max(res.max_iterations, iterations[k]);
+      if (error <= EPS) {
+        x[eq[k]] = xnew;
+        res.converged++;
+      } else {
+        x[eq[k]] = std::numeric_limits<double>::quiet_NaN();
+        res.failed++;
+      }
+      active--;
+      eq[k] = eq[active];
+      xs[k] = xs[active];
+      fx[k] = fx[active];
+      dfx[k] = dfx[active];
+      iterations[k] = iterations[active];
+    }
+  }
+  return res;
+}
+
+template<class BatchFunction>
+root_stats newton_roots(BatchFunction f, int n, const double *x0, double *x,
+                        const double EPS = 1e-15, const int ITERATIONS = 100) {
+  const int BLOCK = 4096;
+  int blocks = (n + BLOCK - 1)/BLOCK;
+  root_stats res;
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (int b = 0; b < blocks; b++) {
+    root_stats s = newton_roots_block(f, b*BLOCK, std::min(n, (b + 1)*BLOCK),
+                                      x0, x, EPS, ITERATIONS);
+#ifdef _OPENMP
+    #pragma omp critical
+#endif
+    res.add(s);
+  }
+  return res;
+}
+
 /*** Example Usage ***/
 
 #include <cassert>
+#include <cstdlib>
+#include <vector>
 
 double f(double x) {
   return x*x - 4*sin(x);
@@ -70,8 +172,77 @@ double fprime(double x) {
   return 2*x - 4*cos(x);
 }
 
+// Black-Scholes call prices as functions of the volatility, for finding the
+// implied volatility of equation i with strike k[i], maturity t[i], and
+// observed price p[i], given spot price 100 and interest rate 0.02.
+struct implied_volatility {
+  std::vector<double> k, t, p;
+
+  implied_volatility(int n) : k(n), t(n), p(n) {}
+
+  double price(int i, double v, double *vega) const {
+    double sd = v*sqrt(t[i]), d1 = (log(100/k[i]) + 0.02*t[i])/sd + sd/2;
+    *vega = 100*sqrt(t[i])*exp(-d1*d1/2)/sqrt(2*M_PI);
+    return 50*erfc(-d1/sqrt(2.0)) -
+           k[i]*exp(-0.02*t[i])*erfc((sd - d1)/sqrt(2.0))/2;
+  }
+
+  void operator()(const int *eq, const double *x, double *fx, double *dfx,
+                  int lanes) const {
+    for (int j = 0; j < lanes; j++) {
+      fx[j] = price(eq[j], x[j], &dfx[j]) - p[eq[j]];
+    }
+  }
+};
+
+// Evaluates x^2 + c[i], which has no real root when c[i] > 0.
+struct shifted_parabola {
+  std::vector<double> c;
+
+  void operator()(const int *eq, const double *x, double *fx, double *dfx,
+                  int lanes) const {
+    for (int j = 0; j < lanes; j++) {
+      fx[j] = x[j]*x[j] + c[eq[j]];
+      dfx[j] = 2*x[j];
+    }
+  }
+};
+
 int main() {
   assert(fabs(f(newton_root(f, fprime, 3))) < 1e-10);
   assert(fabs(f(secant_root(f, 3, 2))) < 1e-10);
+
+  int n = 100000;
+  implied_volatility iv(n);
+  std::vector<double> v(n), x0(n), x(n);
+  for (int i = 0; i < n; i++) {
+    iv.k[i] = 90 + 20.0*rand()/RAND_MAX;
+    iv.t[i] = 0.5 + 1.5*rand()/RAND_MAX;
+    v[i] = 0.15 + 0.45*rand()/RAND_MAX;
+    double vega;
+    iv.p[i] = iv.price(i, v[i], &vega);
+    // The guess of Manaster and Koehler, from which Newton's method converges
+    // monotonically since the price is convex in v below it.
+    x0[i] = sqrt(2*fabs(log(100/iv.k[i]) + 0.02*iv.t[i])/iv.t[i]);
+  }
+  root_stats stats = newton_roots(iv, n, &x0[0], &x[0], 1e-12);
+  assert(stats.converged == n && stats.failed == 0);
+  assert(stats.evaluations <= (long long)n*stats.max_iterations);
+  assert(stats.calls < stats.evaluations/16);
+  for (int i = 0; i < n; i++) {
+    assert(fabs(x[i] - v[i]) < 1e-9);
+  }
+
+  shifted_parabola sp;
+  for (int i = 0; i < 1000; i++) {
+    sp.c.push_back((i % 3 == 0) ? 1 : -i);
+    x0[i] = 1;
+  }
+  stats = newton_roots(sp, 1000, &x0[0], &x[0], 1e-12, 50);
+  assert(stats.failed == 334 && stats.converged == 666);
+  assert(stats.max_iterations <= 50);
+  for (int i = 0; i < 1000; i++) {
+    assert((i % 3 == 0) ? (x[i] != x[i]) : fabs(x[i]*x[i] - i) < 1e-6*i);
+  }
   return 0;
 }
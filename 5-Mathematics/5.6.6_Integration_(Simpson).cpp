@@ -5,18 +5,43 @@ Simpson's approximation: integral ~ [f(a) + 4*f((a + b)/2) + f(b)]*(b - a)/6.
 
 - simpsons(f, a, b) returns the definite integral for a function f from a to b,
   to a tolerance of EPS in absolute error.
+- adaptive_simpsons(f, a, b) and gauss_kronrod(f, a, b) return the definite
+  integral for a function f from a to b, to a tolerance of EPS in absolute
+  error, by globally adaptive quadrature. A priority queue holds the
+  subintervals by their estimated error, and the worst ones are bisected until
+  the total estimated error is at most EPS or MAX_INTERVALS subintervals are in
+  use. adaptive_simpsons() estimates the error of each subinterval from
+  Simpson's rule over it and over its halves, and returns their Richardson
+  extrapolation. Every subinterval keeps its 5 samples of f, so that bisecting
+  it reuses 3 for each half and calls f() only 4 more times. gauss_kronrod()
+  applies the 15-point Kronrod rule and estimates the error from its
+  difference with the embedded 7-point Gauss rule, as in QUADPACK. It calls
+  f() 30 times per bisection but converges much faster for smooth f. Neither
+  calls f() at the endpoints if they are not needed. If compiled with -fopenmp,
+  each round bisects the worst subintervals in a batch of one per thread in
+  parallel, while making sure the batch does not refine more than is needed
+  to meet EPS. f must then be safe to call concurrently.
 
 Time Complexity:
 - O(p) per call to integrate(), where p = -log10(EPS) is the number of digits
   of absolute precision that is desired.
+- O(k log k) per call to adaptive_simpsons() and gauss_kronrod() besides O(k)
+  calls to f(), where k is the number of subintervals used.
 
 Space Complexity:
 - O(p) auxiliary stack and O(1) auxiliary heap space, where p = -log10(EPS)
   is the number of digits of absolute precision that is desired.
+- O(k) auxiliary heap space for adaptive_simpsons() and gauss_kronrod().
 
 */
 
+#include <algorithm>
 #include <cmath>
+#include <queue>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 template<class ContinuousFunction>
 double simpsons(ContinuousFunction f, double a, double b) {
@@ -36,6 +61,172 @@ double integrate(ContinuousFunction f, double a, double b,
   return integrate(f, a, m) + integrate(f, m, b);
 }
 
+// A subinterval [a, b] with its estimated integral and error. Simpson's rule
+// also keeps the samples fx of f at a, (3a + b)/4, (a + b)/2, (a + 3b)/4, b.
+struct quadrature_interval {
+  double a, b, value, error, fx[5];
+
+  bool operator<(const quadrature_interval &i) const {
+    return error < i.error;
+  }
+};
+
+struct simpson_rule {
+  static void estimate(quadrature_interval *i) {
+    const double *y = i->fx;
+    double whole = (y[0] + 4*y[2] + y[4])*(i->b - i->a)/6;
+    double halves = (y[0] + 4*y[1] + 2*y[2] + 4*y[3] + y[4])*(i->b - i->a)/12;
+    i->value = halves + (halves - whole)/15;
+    i->error = fabs(halves - whole)/15;
+  }
+
+  template<class ContinuousFunction>
+  static quadrature_interval make(ContinuousFunction &f, double a, double b) {
+    quadrature_interval i;
+    i.a = a;
+    i.b = b;
+    for (int k = 0; k < 5; k++) {
+      i.fx[k] = f(a + (b - a)*k/4);
+    }
+    estimate(&i);
+    return i;
+  }
+
+  template<class ContinuousFunction>
+  static void split(ContinuousFunction &f, const quadrature_interval &i,
+                    quadrature_interval *left, quadrature_interval *right) {
+    double m = i.a + (i.b - i.a)/2;
+    left->a = i.a;
+    left->b = right->a = m;
+    right->b = i.b;
+    for (int k = 0; k < 5; k += 2) {
+      left->fx[k] = i.fx[k/2];
+      right->fx[k] = i.fx[2 + k/2];
+    }
+    left->fx[1] = f(i.a + (m - i.a)/4);
+    left->fx[3] = f(i.a + 3*(m - i.a)/4);
+    right->fx[1] = f(m + (i.b - m)/4);
+    right->fx[3] = f(m + 3*(i.b - m)/4);
+    estimate(left);
+    estimate(right);
+  }
+};
+
+struct gauss_kronrod_rule {
+  template<class ContinuousFunction>
+  static quadrature_interval make(ContinuousFunction &f, double a, double b) {
+    // Kronrod nodes in [0, 1), where the odd ones are the Gauss nodes.
+    static const double x[8] = {
+        0.99145537112081263920, 0.94910791234275852452, 0.86486442335976907278,
+        0.74153118559939443986, 0.58608723546769113029, 0.40584515137739716690,
+        0.20778495500789846760, 0.0};
+    static const double wk[8] = {
+        0.02293532201052922496, 0.06309209262997855329, 0.10479001032225018383,
+        0.14065325971552591874, 0.16900472663926790282, 0.19035057806478540991,
+        0.20443294007529889241, 0.20948214108472782801};
+    static const double wg[4] = {
+        0.12948496616886969327, 0.27970539148927666790, 0.38183005050511894495,
+        0.41795918367346938775};
+    double c = (a + b)/2, h = (b - a)/2, y[15];
+    for (int k = 0; k < 7; k++) {
+      y[2*k] = f(c - h*x[k]);
+      y[2*k + 1] = f(c + h*x[k]);
+    }
+    y[14] = f(c);
+    double kronrod = wk[7]*y[14], gauss = wg[3]*y[14];
+    for (int k = 0; k < 7; k++) {
+      kronrod += wk[k]*(y[2*k] + y[2*k + 1]);
+      if (k % 2 == 1) {
+        gauss += wg[k/2]*(y[2*k] + y[2*k + 1]);
+      }
+    }
+    // QUADPACK scales |kronrod - gauss| down for smooth f, using the
+    // variation resasc of f around its mean.
+    double mean = kronrod/2, resasc = wk[7]*fabs(y[14] - mean);
+    for (int k = 0; k < 7; k++) {
+      resasc += wk[k]*(fabs(y[2*k] - mean) + fabs(y[2*k + 1] - mean));
+    }
+    quadrature_interval i;
+    i.a = a;
+    i.b = b;
+    i.value = kronrod*h;
+    i.error = fabs((kronrod - gauss)*h);
+    resasc *= fabs(h);
+    if (resasc != 0 && i.error != 0) {
+      i.error = resasc*std::min(1.0, pow(200*i.error/resasc, 1.5));
+    }
+    return i;
+  }
+
+  template<class ContinuousFunction>
+  static void split(ContinuousFunction &f, const quadrature_interval &i,
+                    quadrature_interval *left, quadrature_interval *right) {
+    double m = i.a + (i.b - i.a)/2;
+    *left = make(f, i.a, m);
+    *right = make(f, m, i.b);
+  }
+};
+
+template<class Rule, class ContinuousFunction>
+double adaptive_quadrature(ContinuousFunction &f, double a, double b,
+                           double EPS, int MAX_INTERVALS) {
+  int batch_size = 1;
+#ifdef _OPENMP
+  batch_size = omp_get_max_threads();
+#endif
+  std::priority_queue<quadrature_interval> q;
+  q.push(Rule::make(f, a, b));
+  // Subintervals too small to bisect stay in final.
+  double error = q.top().error, final_value = 0;
+  std::vector<quadrature_interval> batch, halves;
+  while (!q.empty() && error > EPS && (int)q.size() < MAX_INTERVALS) {
+    batch.clear();
+    for (double taken = 0; !q.empty() && (int)batch.size() < batch_size &&
+                           (batch.empty() || taken < error - EPS); ) {
+      quadrature_interval i = q.top();
+      double m = i.a + (i.b - i.a)/2;
+      q.pop();
+      if (m == i.a || m == i.b) {
+        final_value += i.value;
+      } else {
+        batch.push_back(i);
+        taken += i.error;
+      }
+    }
+    int n = batch.size();
+    halves.resize(2*n);
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int k = 0; k < n; k++) {
+      Rule::split(f, batch[k], &halves[2*k], &halves[2*k + 1]);
+    }
+    for (int k = 0; k < n; k++) {
+      error += halves[2*k].error + halves[2*k + 1].error - batch[k].error;
+      q.push(halves[2*k]);
+      q.push(halves[2*k + 1]);
+    }
+  }
+  for (; !q.empty(); q.pop()) {
+    final_value += q.top().value;
+  }
+  return final_value;
+}
+
+template<class ContinuousFunction>
+double adaptive_simpsons(ContinuousFunction f, double a, double b,
+                         const double EPS = 1e-12,
+                         const int MAX_INTERVALS = 1000000) {
+  return adaptive_quadrature<simpson_rule>(f, a, b, EPS, MAX_INTERVALS);
+}
+
+template<class ContinuousFunction>
+double gauss_kronrod(ContinuousFunction f, double a, double b,
+                     const double EPS = 1e-12,
+                     const int MAX_INTERVALS = 100000) {
+  return adaptive_quadrature<gauss_kronrod_rule>(f, a, b, EPS, MAX_INTERVALS);
+}
+
 /*** Example Usage ***/
 
 #include <cstdio>
@@ -46,8 +237,55 @@ double f(double x) {
   return sin(x);
 }
 
+// A sharp peak at x = 0.3, whose integral over [0, 1] is
+// (atan(70) + atan(30))*100.
+double peak(double x) {
+  return 1/(1e-4 + (x - 0.3)*(x - 0.3));
+}
+
+double root(double x) {
+  return sqrt(x);
+}
+
+template<class Function>
+class counted_function {
+  Function f;
+  long long *count;
+
+ public:
+  counted_function(Function f, long long *count) : f(f), count(count) {}
+
+  double operator()(double x) {
+#ifdef _OPENMP
+    #pragma omp atomic
+#endif
+    (*count)++;
+    return f(x);
+  }
+};
+
+template<class Function>
+counted_function<Function> make_counted(Function f, long long *count) {
+  return counted_function<Function>(f, count);
+}
+
 int main () {
   double PI = acos(-1.0);
   assert(fabs(integrate(f, 0.0, PI/2) - 1) < 1e-10);
+  assert(fabs(adaptive_simpsons(f, 0.0, PI/2) - 1) < 1e-12);
+  assert(fabs(gauss_kronrod(f, 0.0, PI/2) - 1) < 1e-12);
+  assert(fabs(adaptive_simpsons(f, PI/2, 0.0) + 1) < 1e-12);
+  assert(fabs(gauss_kronrod(root, 0.0, 1.0) - 2.0/3) < 1e-12);
+  assert(fabs(adaptive_simpsons(root, 0.0, 1.0) - 2.0/3) < 1e-12);
+
+  double exact = (atan(70.0) + atan(30.0))*100;
+  long long fixed = 0, simpson = 0, kronrod = 0;
+  double res = integrate(make_counted(peak, &fixed), 0.0, 1.0, 1e-9);
+  assert(fabs(res - exact) < 1e-6);
+  res = adaptive_simpsons(make_counted(peak, &simpson), 0.0, 1.0, 1e-9);
+  assert(fabs(res - exact) < 1e-8);
+  res = gauss_kronrod(make_counted(peak, &kronrod), 0.0, 1.0, 1e-9);
+  assert(fabs(res - exact) < 1e-8);
+  assert(simpson < fixed/2 && kronrod < simpson);
   return 0;
 }
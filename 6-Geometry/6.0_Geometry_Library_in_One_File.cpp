@@ -4,10 +4,12 @@ This combines the next few subsections in this chapter in a cross-dependent
 manner. All of these algorithms apply to a two-dimensional Cartesian plane.
 
 Time Complexity:
-- O(1) for all operations.
+- O(1) for all operations, except O(n) for the constructor, to_points(), and
+  the batched operations on a point_batch of n points.
 
 Space Complexity:
-- O(1) for storage of all data types.
+- O(1) for storage of all data types, except O(n) for a point_batch of n
+  points.
 - O(1) auxiliary for all operations.
 
 */
@@ -20,6 +22,9 @@ Space Complexity:
 #include <stdexcept>
 #include <utility>
 #include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 const double M_NAN = std::numeric_limits<double>::quiet_NaN();
 const double EPS = 1e-9;
@@ -158,6 +163,187 @@ struct point {
   }
 };
 
+// A structure-of-arrays batch of points, storing all x-coordinates and all
+// y-coordinates in two separate arrays so that the batched operations below can
+// process four points per AVX2 instruction if compiled with -mavx2.
+struct point_batch {
+  std::vector<double> x, y;
+
+  point_batch() {}
+  explicit point_batch(int n) : x(n), y(n) {}
+
+  point_batch(const std::vector<point> &p) : x(p.size()), y(p.size()) {
+    for (int i = 0; i < (int)p.size(); i++) {
+      x[i] = p[i].x;
+      y[i] = p[i].y;
+    }
+  }
+
+  int size() const { return x.size(); }
+  point operator[](int i) const { return point(x[i], y[i]); }
+  void push_back(const point &p) { x.push_back(p.x); y.push_back(p.y); }
+
+  std::vector<point> to_points() const {
+    std::vector<point> res(size());
+    for (int i = 0; i < size(); i++) {
+      res[i] = point(x[i], y[i]);
+    }
+    return res;
+  }
+
+  // Sets res[i] to the cross product (b - a) x (p[i] - a) for every point p[i].
+  void cross(const point &a, const point &b, double res[]) const {
+    int n = size(), i = 0;
+    double dx = b.x - a.x, dy = b.y - a.y;
+#ifdef __AVX2__
+    __m256d ax = _mm256_set1_pd(a.x), ay = _mm256_set1_pd(a.y);
+    __m256d vdx = _mm256_set1_pd(dx), vdy = _mm256_set1_pd(dy);
+    for (; i + 4 <= n; i += 4) {
+      __m256d u = _mm256_sub_pd(_mm256_loadu_pd(&x[i]), ax);
+      __m256d v = _mm256_sub_pd(_mm256_loadu_pd(&y[i]), ay);
+      _mm256_storeu_pd(res + i, _mm256_sub_pd(_mm256_mul_pd(vdx, v),
+                                              _mm256_mul_pd(vdy, u)));
+    }
+#endif
+    for (; i < n; i++) {
+      res[i] = dx*(y[i] - a.y) - dy*(x[i] - a.x);
+    }
+  }
+
+  // Sets res[i] to 1 if p[i] lies to the left of the directed line from a to b,
+  // -1 if it lies to the right, or 0 if the three points are collinear.
+  void turn(const point &a, const point &b, int res[]) const {
+    int n = size(), i = 0;
+    double dx = b.x - a.x, dy = b.y - a.y;
+#ifdef __AVX2__
+    __m256d ax = _mm256_set1_pd(a.x), ay = _mm256_set1_pd(a.y);
+    __m256d vdx = _mm256_set1_pd(dx), vdy = _mm256_set1_pd(dy);
+    __m256d eps = _mm256_set1_pd(EPS), neps = _mm256_set1_pd(-EPS);
+    __m256d one = _mm256_set1_pd(1), minus_one = _mm256_set1_pd(-1);
+    for (; i + 4 <= n; i += 4) {
+      __m256d u = _mm256_sub_pd(_mm256_loadu_pd(&x[i]), ax);
+      __m256d v = _mm256_sub_pd(_mm256_loadu_pd(&y[i]), ay);
+      __m256d c = _mm256_sub_pd(_mm256_mul_pd(vdx, v), _mm256_mul_pd(vdy, u));
+      __m256d s = _mm256_add_pd(
+          _mm256_and_pd(_mm256_cmp_pd(c, eps, _CMP_GT_OQ), one),
+          _mm256_and_pd(_mm256_cmp_pd(c, neps, _CMP_LT_OQ), minus_one));
+      _mm_storeu_si128((__m128i*)(res + i), _mm256_cvtpd_epi32(s));
+    }
+#endif
+    for (; i < n; i++) {
+      double c = dx*(y[i] - a.y) - dy*(x[i] - a.x);
+      res[i] = LT(0, c) ? 1 : (LT(c, 0) ? -1 : 0);
+    }
+  }
+
+  // Sets res[i] to the squared distance from p[i] to point p.
+  void sqdist(const point &p, double res[]) const {
+    int n = size(), i = 0;
+#ifdef __AVX2__
+    __m256d px = _mm256_set1_pd(p.x), py = _mm256_set1_pd(p.y);
+    for (; i + 4 <= n; i += 4) {
+      __m256d u = _mm256_sub_pd(_mm256_loadu_pd(&x[i]), px);
+      __m256d v = _mm256_sub_pd(_mm256_loadu_pd(&y[i]), py);
+      _mm256_storeu_pd(res + i, _mm256_add_pd(_mm256_mul_pd(u, u),
+                                              _mm256_mul_pd(v, v)));
+    }
+#endif
+    for (; i < n; i++) {
+      double u = x[i] - p.x, v = y[i] - p.y;
+      res[i] = u*u + v*v;
+    }
+  }
+
+  // Sets res[i] to the distance from p[i] to point p.
+  void dist(const point &p, double res[]) const {
+    int n = size(), i = 0;
+    sqdist(p, res);
+#ifdef __AVX2__
+    for (; i + 4 <= n; i += 4) {
+      _mm256_storeu_pd(res + i, _mm256_sqrt_pd(_mm256_loadu_pd(res + i)));
+    }
+#endif
+    for (; i < n; i++) {
+      res[i] = sqrt(res[i]);
+    }
+  }
+
+  // Replaces every p[i] with p + (c*u - s*v, s*u + c*v) where (u, v) is equal
+  // to p[i] - p, which rotates p[i] about p if c and s are the cosine and sine
+  // of the same angle.
+  void rotate(const point &p, double c, double s) {
+    int n = size(), i = 0;
+#ifdef __AVX2__
+    __m256d px = _mm256_set1_pd(p.x), py = _mm256_set1_pd(p.y);
+    __m256d vc = _mm256_set1_pd(c), vs = _mm256_set1_pd(s);
+    for (; i + 4 <= n; i += 4) {
+      __m256d u = _mm256_sub_pd(_mm256_loadu_pd(&x[i]), px);
+      __m256d v = _mm256_sub_pd(_mm256_loadu_pd(&y[i]), py);
+      _mm256_storeu_pd(&x[i], _mm256_add_pd(px, _mm256_sub_pd(
+          _mm256_mul_pd(vc, u), _mm256_mul_pd(vs, v))));
+      _mm256_storeu_pd(&y[i], _mm256_add_pd(py, _mm256_add_pd(
+          _mm256_mul_pd(vs, u), _mm256_mul_pd(vc, v))));
+    }
+#endif
+    for (; i < n; i++) {
+      double u = x[i] - p.x, v = y[i] - p.y;
+      x[i] = p.x + (c*u - s*v);
+      y[i] = p.y + (s*u + c*v);
+    }
+  }
+
+  // Rotates every point t radians clockwise about the origin.
+  void rotateCW(double t) { rotate(point(0, 0), cos(t), -sin(t)); }
+
+  // Rotates every point t radians counter-clockwise about the origin.
+  void rotateCCW(double t) { rotate(point(0, 0), cos(t), sin(t)); }
+
+  // Rotates every point t radians clockwise about point p.
+  void rotateCW(const point &p, double t) { rotate(p, cos(t), -sin(t)); }
+
+  // Rotates every point t radians counter-clockwise about point p.
+  void rotateCCW(const point &p, double t) { rotate(p, cos(t), sin(t)); }
+
+  // Sets lo and hi to the lower-left and upper-right corners of the smallest
+  // axis-aligned rectangle containing every point. The batch must be nonempty.
+  void bounding_box(point *lo, point *hi) const {
+    int n = size(), i = 0;
+    double xlo = x[0], xhi = x[0], ylo = y[0], yhi = y[0];
+#ifdef __AVX2__
+    if (n >= 4) {
+      __m256d vxlo = _mm256_loadu_pd(&x[0]), vxhi = vxlo;
+      __m256d vylo = _mm256_loadu_pd(&y[0]), vyhi = vylo;
+      for (i = 4; i + 4 <= n; i += 4) {
+        __m256d u = _mm256_loadu_pd(&x[i]), v = _mm256_loadu_pd(&y[i]);
+        vxlo = _mm256_min_pd(vxlo, u);
+        vxhi = _mm256_max_pd(vxhi, u);
+        vylo = _mm256_min_pd(vylo, v);
+        vyhi = _mm256_max_pd(vyhi, v);
+      }
+      double a[4], b[4], c[4], d[4];
+      _mm256_storeu_pd(a, vxlo);
+      _mm256_storeu_pd(b, vxhi);
+      _mm256_storeu_pd(c, vylo);
+      _mm256_storeu_pd(d, vyhi);
+      for (int j = 0; j < 4; j++) {
+        xlo = std::min(xlo, a[j]);
+        xhi = std::max(xhi, b[j]);
+        ylo = std::min(ylo, c[j]);
+        yhi = std::max(yhi, d[j]);
+      }
+    }
+#endif
+    for (; i < n; i++) {
+      xlo = std::min(xlo, x[i]);
+      xhi = std::max(xhi, x[i]);
+      ylo = std::min(ylo, y[i]);
+      yhi = std::max(yhi, y[i]);
+    }
+    *lo = point(xlo, ylo);
+    *hi = point(xhi, yhi);
+  }
+};
+
 // A two-dimensional line class stored of the form ax + by + c = 0, normalized
 // such that b is always either 1 (for normal line) or 0 (for vertical lines).
 struct line {
@@ -861,6 +1047,24 @@ int main() {
   assert(pt(10, -3) == p.reflect(pt(0, 0)));
   assert(pt(-10, -3) == p.reflect(pt(-2, 0), pt(5, 0)));
 
+  {
+    vector<pt> v;
+    for (int i = 0; i < 11; i++) {
+      v.push_back(pt(i, (i*7) % 11));
+    }
+    point_batch b(v);
+    vector<int> t(b.size());
+    b.turn(pt(0, 0), pt(1, 1), &t[0]);
+    for (int i = 0; i < b.size(); i++) {
+      assert(t[i] == turn(pt(1, 1), pt(0, 0), v[i]));
+    }
+    b.rotateCCW(pt(5, 5), PI / 2);
+    assert(b[10] == v[10].rotateCCW(pt(5, 5), PI / 2));
+    pt lo, hi;
+    b.bounding_box(&lo, &hi);
+    assert(lo == pt(0, 0) && hi == pt(10, 10));
+  }
+
   line l(2, -5, -8);
   line para = line(2, -5, -8).parallel(pt(-6, -2));
   line perp = line(2, -5, -8).perpendicular(pt(-6, -2));
@@ -22,12 +22,50 @@ Circle tangent and intersection calculations in two dimensions.
   2 if the circles intersect at two points (stored in p and q), 3 if the circles
   are equal and intersect at infinite points.
 - intersection_area(c1, c2) returns the intersection area of circles c1 and c2.
+- discs_intersect(c1, c2) returns whether the closed discs bounded by circles c1
+  and c2 share any point, that is, whether intersection(c1, c2) is nonzero.
+- grid_intersections(lo, hi, width) returns the sorted pairs of indices i < j
+  of all circles in the range [lo, hi) whose discs intersect, using a uniform
+  grid of square cells with the given side width as a broad phase. Each circle
+  is binned into the cells covered by its bounding box, and each pair is tested
+  with discs_intersect() in only the first cell common to both bounding boxes.
+  Cells are processed in parallel if compiled with -fopenmp. This is best for
+  circles of similar size spread evenly over an area, choosing the width near
+  the typical diameter.
+- circle_bvh(lo, hi, sah) constructs a bounding volume hierarchy over the
+  bounding boxes of the circles in the range [lo, hi), splitting each node along
+  the longer side of the bounding box of its centers. If sah is true, the split
+  minimizes the surface area heuristic over buckets of centers, otherwise it is
+  at the median center. Unlike the grid, this adapts to clustered circles and
+  widely varying radii.
+  - query(q) returns the sorted indices of the circles whose discs intersect
+    the disc of q.
+  - intersecting_pairs() returns the same result as grid_intersections(),
+    querying the hierarchy with each circle in parallel if compiled with
+    -fopenmp.
 
 Time Complexity:
-- O(1) for all operations.
+- O(1) for tangent(), intersection(), intersection_area(), and
+  discs_intersect().
+- O(n + c + m log m) per call to grid_intersections(lo, hi, width), where n is
+  the distance between lo and hi, m is the total number of cells covered by the
+  bounding boxes of circles, and c is the number of pairs of circles sharing a
+  cell.
+- O(n log n) on average for the construction of circle_bvh, where n is the
+  distance between lo and hi.
+- O(log n + k) on average per call to query(q) on well distributed circles,
+  where k is the number of overlapping bounding boxes, and O(n) in the worst
+  case.
+- O(n log n + k log k) on average per call to intersecting_pairs(), where k is
+  the number of pairs with overlapping bounding boxes.
 
 Space Complexity:
-- O(1) auxiliary for all operations.
+- O(1) auxiliary for tangent(), intersection(), intersection_area(), and
+  discs_intersect().
+- O(m + k) auxiliary heap space for grid_intersections(lo, hi, width), where k
+  is the number of intersecting pairs.
+- O(n) for the storage of circle_bvh.
+- O(k) auxiliary heap space for query(q) and intersecting_pairs().
 
 */
 
@@ -35,6 +73,7 @@ Space Complexity:
 #include <cmath>
 #include <cstddef>
 #include <utility>
+#include <vector>
 
 const double EPS = 1e-9, PI = acos(-1.0);
 
@@ -193,9 +232,308 @@ double intersection_area(const circle &c1, const circle &c2) {
          0.5*sqrt((-d + r + R)*(d + r - R)*(d - r + R)*(d + r + R));
 }
 
-/*** Example Usage ***/
+// Returns whether the closed discs of circles c1 and c2 share a point.
+bool discs_intersect(const circle &c1, const circle &c2) {
+  return intersection(c1, c2) != 0;
+}
+
+typedef std::pair<std::pair<long long, long long>, int> cell_entry;
+
+template<class It>
+std::vector<std::pair<int, int> > grid_intersections(It lo, It hi,
+                                                     double width) {
+  int n = hi - lo;
+  std::vector<circle> c(lo, hi);
+  std::vector<long long> x0(n), y0(n);
+  std::vector<cell_entry> cells;
+  for (int i = 0; i < n; i++) {
+    x0[i] = (long long)floor((c[i].h - c[i].r) / width);
+    y0[i] = (long long)floor((c[i].k - c[i].r) / width);
+    long long x1 = (long long)floor((c[i].h + c[i].r) / width);
+    long long y1 = (long long)floor((c[i].k + c[i].r) / width);
+    for (long long cx = x0[i]; cx <= x1; cx++) {
+      for (long long cy = y0[i]; cy <= y1; cy++) {
+        cells.push_back(cell_entry(std::make_pair(cx, cy), i));
+      }
+    }
+  }
+  std::sort(cells.begin(), cells.end());
+  std::vector<int> start;
+  for (int i = 0; i < (int)cells.size(); i++) {
+    if (i == 0 || cells[i].first != cells[i - 1].first) {
+      start.push_back(i);
+    }
+  }
+  start.push_back(cells.size());
+  std::vector<std::pair<int, int> > res;
+  int m = (int)start.size() - 1;
+#ifdef _OPENMP
+  #pragma omp parallel
+#endif
+  {
+    std::vector<std::pair<int, int> > local;
+#ifdef _OPENMP
+    #pragma omp for schedule(dynamic, 64) nowait
+#endif
+    for (int b = 0; b < m; b++) {
+      std::pair<long long, long long> cell = cells[start[b]].first;
+      for (int u = start[b]; u < start[b + 1]; u++) {
+        for (int v = u + 1; v < start[b + 1]; v++) {
+          int i = cells[u].second, j = cells[v].second;
+          if (std::max(x0[i], x0[j]) == cell.first &&
+              std::max(y0[i], y0[j]) == cell.second &&
+              discs_intersect(c[i], c[j])) {
+            local.push_back(std::make_pair(std::min(i, j), std::max(i, j)));
+          }
+        }
+      }
+    }
+#ifdef _OPENMP
+    #pragma omp critical
+#endif
+    res.insert(res.end(), local.begin(), local.end());
+  }
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+class circle_bvh {
+  static const int LEAF_SIZE = 4, BINS = 16;
+
+  struct box {
+    double x0, y0, x1, y1;
+
+    box() : x0(HUGE_VAL), y0(HUGE_VAL), x1(-HUGE_VAL), y1(-HUGE_VAL) {}
+
+    explicit box(const circle &c)
+        : x0(c.h - c.r), y0(c.k - c.r), x1(c.h + c.r), y1(c.k + c.r) {}
+
+    void add(const box &b) {
+      x0 = std::min(x0, b.x0);
+      y0 = std::min(y0, b.y0);
+      x1 = std::max(x1, b.x1);
+      y1 = std::max(y1, b.y1);
+    }
+
+    bool overlaps(const box &b) const {
+      return LE(x0, b.x1) && LE(b.x0, x1) && LE(y0, b.y1) && LE(b.y0, y1);
+    }
+
+    double half_perimeter() const {
+      return (x0 > x1) ? 0 : (x1 - x0) + (y1 - y0);
+    }
+  };
+
+  // A leaf stores the circles idx[lo, hi), and an internal node has children
+  // at left and left + 1 (so hi is unused).
+  struct node {
+    box b;
+    int left, lo, hi;
+  };
+
+  std::vector<circle> c;
+  std::vector<int> idx;
+  std::vector<node> nodes;
+  std::vector<box> boxes;
+  bool sah;
+  int depth;
+
+  double center(int i, int axis) const {
+    return (axis == 0) ? c[i].h : c[i].k;
+  }
+
+  // Returns the position of the split of idx[lo, hi) along axis, partitioning
+  // it so that the left part comes first. The surface area heuristic over
+  // BINS buckets of centers is used if sah is set, otherwise the median.
+  int split(int lo, int hi, int axis, double cmin, double cmax) {
+    int mid = lo + (hi - lo)/2;
+    if (sah && cmin < cmax) {
+      box bin[BINS];
+      int count[BINS] = {0};
+      double scale = BINS / (cmax - cmin);
+      for (int i = lo; i < hi; i++) {
+        int k = std::min(BINS - 1, (int)((center(idx[i], axis) - cmin)*scale));
+        bin[k].add(boxes[idx[i]]);
+        count[k]++;
+      }
+      double right_cost[BINS];
+      box acc;
+      for (int k = BINS - 1, total = 0; k > 0; k--) {
+        acc.add(bin[k]);
+        total += count[k];
+        right_cost[k] = acc.half_perimeter()*total;
+      }
+      acc = box();
+      double best = HUGE_VAL;
+      int best_k = -1;
+      for (int k = 1, total = 0; k < BINS; k++) {
+        acc.add(bin[k - 1]);
+        total += count[k - 1];
+        double cost = acc.half_perimeter()*total + right_cost[k];
+        if (total > 0 && total < hi - lo && cost < best) {
+          best = cost;
+          best_k = k;
+        }
+      }
+      if (best_k >= 0) {
+        int k = lo;
+        for (int i = lo; i < hi; i++) {
+          if ((int)((center(idx[i], axis) - cmin)*scale) < best_k) {
+            std::swap(idx[i], idx[k++]);
+          }
+        }
+        return k;
+      }
+    }
+    std::nth_element(idx.begin() + lo, idx.begin() + mid, idx.begin() + hi,
+                     axis_less(this, axis));
+    return mid;
+  }
+
+  struct axis_less {
+    const circle_bvh *t;
+    int axis;
+
+    axis_less(const circle_bvh *t, int axis) : t(t), axis(axis) {}
+
+    bool operator()(int i, int j) const {
+      return t->center(i, axis) < t->center(j, axis);
+    }
+  };
+
+  void build(int u, int lo, int hi, int d) {
+    depth = std::max(depth, d);
+    box b, cb;
+    for (int i = lo; i < hi; i++) {
+      b.add(boxes[idx[i]]);
+      cb.add(box(circle(c[idx[i]].h, c[idx[i]].k, 0)));
+    }
+    nodes[u].b = b;
+    nodes[u].lo = lo;
+    nodes[u].hi = hi;
+    nodes[u].left = -1;
+    if (hi - lo <= LEAF_SIZE) {
+      return;
+    }
+    int axis = (cb.x1 - cb.x0 >= cb.y1 - cb.y0) ? 0 : 1;
+    int mid = (axis == 0) ? split(lo, hi, 0, cb.x0, cb.x1)
+                          : split(lo, hi, 1, cb.y0, cb.y1);
+    int left = nodes.size();
+    nodes[u].left = left;
+    nodes.resize(left + 2);
+    build(left, lo, mid, d + 1);
+    build(left + 1, mid, hi, d + 1);
+  }
+
+  // Appends to res the indices j > skip of circles intersecting q, using
+  // stack (of size at least depth + 2) for the traversal.
+  void query(const circle &q, int skip, std::vector<int> &res,
+             std::vector<int> &stack) const {
+    box qb(q);
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const node &u = nodes[stack[--top]];
+      if (!u.b.overlaps(qb)) {
+        continue;
+      }
+      if (u.left >= 0) {
+        stack[top++] = u.left;
+        stack[top++] = u.left + 1;
+        continue;
+      }
+      for (int i = u.lo; i < u.hi; i++) {
+        int j = idx[i];
+        if (j > skip && boxes[j].overlaps(qb) && discs_intersect(q, c[j])) {
+          res.push_back(j);
+        }
+      }
+    }
+  }
+
+ public:
+  template<class It>
+  circle_bvh(It lo, It hi, bool sah = true) : c(lo, hi), sah(sah), depth(0) {
+    int n = c.size();
+    idx.resize(n);
+    for (int i = 0; i < n; i++) {
+      idx[i] = i;
+      boxes.push_back(box(c[i]));
+    }
+    if (n > 0) {
+      nodes.reserve(2*n);
+      nodes.resize(1);
+      build(0, 0, n, 0);
+    }
+  }
+
+  // Returns the sorted indices of the circles whose discs intersect q's.
+  std::vector<int> query(const circle &q) const {
+    std::vector<int> res, stack(depth + 2);
+    if (!nodes.empty()) {
+      query(q, -1, res, stack);
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+  std::vector<std::pair<int, int> > intersecting_pairs() const {
+    std::vector<std::pair<int, int> > res;
+    int n = c.size();
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+      std::vector<std::pair<int, int> > local;
+      std::vector<int> hits, stack(depth + 2);
+#ifdef _OPENMP
+      #pragma omp for schedule(dynamic, 256) nowait
+#endif
+      for (int i = 0; i < n; i++) {
+        hits.clear();
+        query(c[i], i, hits, stack);
+        for (int k = 0; k < (int)hits.size(); k++) {
+          local.push_back(std::make_pair(i, hits[k]));
+        }
+      }
+#ifdef _OPENMP
+      #pragma omp critical
+#endif
+      res.insert(res.end(), local.begin(), local.end());
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+};
+
+/*** Example Usage and Output:
+
+grid: 1831099 pairs in 1.690s
+bvh:  1831099 pairs in 4.084s
+
+***/
 
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+using namespace std;
+
+// Returns the wall clock time in seconds. On Windows, clock() measures wall
+// time rather than processor time.
+double wall_time() {
+#ifdef _WIN32
+  return (double)clock()/CLOCKS_PER_SEC;
+#else
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+#endif
+}
 
 bool EQP(const point &a, const point &b) {
   return EQ(a.x, b.x) && EQ(a.y, b.y);
@@ -234,5 +572,60 @@ int main() {
   // Each circle passes through the other's center.
   double r = 3, a = intersection_area(circle(-r/2, 0, r), circle(r/2, 0, r));
   assert(EQ(a, r*r*(2*PI / 3 - sqrt(3) / 2)));
+
+  // Broad phase intersections against brute force.
+  for (int t = 0; t < 4; t++) {
+    vector<circle> c;
+    for (int i = 0; i < 1500; i++) {
+      double h = rand() % 1000 / 10.0, k = rand() % 1000 / 10.0;
+      double r = (t == 3) ? rand() % 300 / 10.0 : rand() % 30 / 10.0;
+      if (t == 2) {  // Clustered around a few centers.
+        h = h / 20 + 30*(i % 3);
+        k = k / 20;
+      }
+      c.push_back(circle(h, k, r));
+    }
+    c.push_back(circle(50, 50, 0));
+    c.push_back(circle(50, 50, 0));
+    vector<pair<int, int> > expected;
+    for (int i = 0; i < (int)c.size(); i++) {
+      for (int j = i + 1; j < (int)c.size(); j++) {
+        if (discs_intersect(c[i], c[j])) {
+          expected.push_back(make_pair(i, j));
+        }
+      }
+    }
+    assert(grid_intersections(c.begin(), c.end(), 3) == expected);
+    assert(grid_intersections(c.begin(), c.end(), 0.7) == expected);
+    circle_bvh sah(c.begin(), c.end()), median(c.begin(), c.end(), false);
+    assert(sah.intersecting_pairs() == expected);
+    assert(median.intersecting_pairs() == expected);
+    circle z(20, 30, 7);
+    vector<int> hits;
+    for (int i = 0; i < (int)c.size(); i++) {
+      if (discs_intersect(z, c[i])) {
+        hits.push_back(i);
+      }
+    }
+    assert(sah.query(z) == hits && median.query(z) == hits);
+  }
+  vector<circle> none;
+  assert(circle_bvh(none.begin(), none.end()).intersecting_pairs().empty());
+
+  { // Timing on a million small circles.
+    vector<circle> c;
+    for (int i = 0; i < 1000000; i++) {
+      c.push_back(circle(rand() % 1000000 / 1000.0, rand() % 1000000 / 1000.0,
+                         rand() % 1000 / 1000.0));
+    }
+    double start = wall_time();
+    vector<pair<int, int> > res = grid_intersections(c.begin(), c.end(), 1);
+    printf("grid: %d pairs in %.3fs\n", (int)res.size(), wall_time() - start);
+    start = wall_time();
+    circle_bvh t(c.begin(), c.end());
+    vector<pair<int, int> > res2 = t.intersecting_pairs();
+    printf("bvh:  %d pairs in %.3fs\n", (int)res2.size(), wall_time() - start);
+    assert(res2 == res);
+  }
   return 0;
 }
@@ -8,20 +8,51 @@ the polygon using a ray casting algorithm.
   or counter-clockwise order, where lo and hi must be random-access iterators.
   If p lies barely on an edge (within EPS), then the result will depend on the
   setting of EDGE_IS_INSIDE.
+- polygon_index(lo, hi) constructs an index for many queries against the simple
+  polygon defined by the range [lo, hi) of vertices, in either order. The
+  bounding box is divided into a uniform grid of about n cells, each storing
+  the edges passing within EPS of it and a reference point in the cell that is
+  known to be inside or outside the polygon (these are classified row by row,
+  with only the first cell of each row requiring a full ray cast).
+- polygon_index::contains(p) returns the same result as point_in_polygon(p, lo,
+  hi), but only examines the edges in the cell of p, counting how many of them
+  cross the segment from the reference point of the cell to p.
+- convex_polygon(lo, hi) stores a convex polygon defined by the range [lo, hi)
+  of vertices, in either order.
+- convex_polygon::contains(p) returns the same result as point_in_polygon(p, lo,
+  hi) for the convex polygon, binary searching for the triangle containing p in
+  the fan of triangles from the first vertex.
+- contains(b, res) for either class sets res[i] to whether the i-th point of
+  point_batch b lies inside the polygon, processing the points in parallel if
+  compiled with -fopenmp.
 
 Time Complexity:
 - O(n) per call to point_in_polygon(lo, hi), where n is the distance between lo
   and hi.
+- O(n^1.5 + m log m) per call to the polygon_index constructor, where n is the
+  number of vertices and m is the total number of cells crossed by edges.
+- O(c) per call to polygon_index::contains(p), where c is the number of edges
+  in the cell of p (constant on average for polygons whose edges are spread
+  evenly over the bounding box), or O(n) in the rare case that no reference
+  point could be placed in the cell.
+- O(n) per call to the convex_polygon constructor and O(log n) per call to
+  convex_polygon::contains(p).
+- O(m) per call to contains(b, res), where m is the size of b, times the cost
+  of a single query.
 
 Space Complexity:
-- O(1) auxiliary.
+- O(1) auxiliary for point_in_polygon(lo, hi).
+- O(n + m) for storage of a polygon_index, and O(n) for a convex_polygon.
 
 */
 
+#include <algorithm>
 #include <cmath>
 #include <utility>
+#include <vector>
 
 const double EPS = 1e-9;
+const bool EDGE_IS_INSIDE = true;
 
 #define EQ(a, b) (fabs((a) - (b)) <= EPS)
 #define LE(a, b) ((a) <= (b) + EPS)
@@ -37,7 +68,6 @@ double cross(const point &a, const point &b, const point &o = point(0, 0)) {
 
 template<class It>
 bool point_in_polygon(const point &p, It lo, It hi) {
-  static const bool EDGE_IS_INSIDE = true;
   bool ans = 0;
   for (It i = lo, j = hi - 1; i != hi; j = i++) {
     if (EQ(i->y, p.y) &&
@@ -58,9 +88,268 @@ bool point_in_polygon(const point &p, It lo, It hi) {
   return ans;
 }
 
+// Returns whether p lies on the segment from a to b (within EPS).
+bool on_segment(const point &p, const point &a, const point &b) {
+  return EQ(cross(a, b, p), 0) &&
+         LE(std::min(a.x, b.x), p.x) && LE(p.x, std::max(a.x, b.x)) &&
+         LE(std::min(a.y, b.y), p.y) && LE(p.y, std::max(a.y, b.y));
+}
+
+// Returns whether the segment from r to p crosses the edge from a to b, given
+// that neither r nor p lies on the edge. Vertices on the line through r and p
+// are treated as lying on its right, so a crossing through a vertex shared by
+// two edges is counted for exactly one of them.
+bool crosses(const point &r, const point &p, const point &a, const point &b) {
+  if ((cross(r, p, a) > 0) == (cross(r, p, b) > 0)) {
+    return false;
+  }
+  return (cross(a, b, r) > 0) != (cross(a, b, p) > 0);
+}
+
+struct point_batch {
+  std::vector<double> x, y;
+
+  point_batch() {}
+  explicit point_batch(int n) : x(n), y(n) {}
+
+  point_batch(const std::vector<point> &p) : x(p.size()), y(p.size()) {
+    for (int i = 0; i < (int)p.size(); i++) {
+      x[i] = p[i].x;
+      y[i] = p[i].y;
+    }
+  }
+
+  int size() const { return x.size(); }
+  point operator[](int i) const { return point(x[i], y[i]); }
+  void push_back(const point &p) { x.push_back(p.x); y.push_back(p.y); }
+};
+
+// A uniform grid over the bounding box of a simple polygon, where each cell
+// stores the edges passing within EPS of it along with a reference point in
+// the cell (away from all edges) and whether the reference point is inside.
+// A query only examines the edges of its cell, counting those that cross the
+// segment from the reference point to the query point.
+class polygon_index {
+  std::vector<point> v;
+  double x0, y0, w, h;
+  int nx, ny;
+  std::vector<int> start, edges;
+  std::vector<point> ref;
+  std::vector<char> has_ref, ref_inside;
+
+  int col(double px) const {
+    return std::max(0, std::min(nx - 1, (int)floor((px - x0) / w)));
+  }
+
+  int row(double py) const {
+    return std::max(0, std::min(ny - 1, (int)floor((py - y0) / h)));
+  }
+
+  point vertex(int i) const { return v[i]; }
+  point next_vertex(int i) const { return v[(i + 1) % v.size()]; }
+
+  // Appends the cells that edge i passes within EPS of, column by column.
+  void bin_edge(int i, std::vector<std::pair<int, int> > &cells) const {
+    point a = vertex(i), b = next_vertex(i);
+    if (b < a) {
+      std::swap(a, b);
+    }
+    for (int c = col(a.x - EPS); c <= col(b.x + EPS); c++) {
+      double lx = std::max(a.x, x0 + c*w - EPS);
+      double hx = std::min(b.x, x0 + (c + 1)*w + EPS);
+      double ly = a.y, hy = b.y;
+      if (b.x > a.x) {
+        ly = a.y + (b.y - a.y)*(std::max(lx, a.x) - a.x)/(b.x - a.x);
+        hy = a.y + (b.y - a.y)*(std::min(hx, b.x) - a.x)/(b.x - a.x);
+      }
+      if (ly > hy) {
+        std::swap(ly, hy);
+      }
+      for (int r = row(ly - EPS); r <= row(hy + EPS); r++) {
+        cells.push_back(std::make_pair(r*nx + c, i));
+      }
+    }
+  }
+
+  bool clear_of_edges(const point &p, int cell) const {
+    for (int k = start[cell]; k < start[cell + 1]; k++) {
+      if (on_segment(p, vertex(edges[k]), next_vertex(edges[k]))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Returns the parity of the number of edges in the cells a and b crossing the
+  // segment from p to q, where seen marks the edges already counted.
+  bool parity(const point &p, const point &q, int a, int b,
+              std::vector<int> &seen, int stamp) const {
+    bool res = false;
+    for (int t = 0; t < 2; t++) {
+      int cell = (t == 0) ? a : b;
+      for (int k = start[cell]; k < start[cell + 1]; k++) {
+        int e = edges[k];
+        if (seen[e] != stamp) {
+          seen[e] = stamp;
+          if (crosses(p, q, vertex(e), next_vertex(e))) {
+            res = !res;
+          }
+        }
+      }
+    }
+    return res;
+  }
+
+ public:
+  template<class It>
+  polygon_index(It lo, It hi) : v(lo, hi) {
+    int n = v.size();
+    x0 = y0 = 0;
+    double x1 = 0, y1 = 0;
+    for (int i = 0; i < n; i++) {
+      x0 = (i == 0) ? v[i].x : std::min(x0, v[i].x);
+      y0 = (i == 0) ? v[i].y : std::min(y0, v[i].y);
+      x1 = (i == 0) ? v[i].x : std::max(x1, v[i].x);
+      y1 = (i == 0) ? v[i].y : std::max(y1, v[i].y);
+    }
+    nx = ny = std::max(1, (int)sqrt((double)n));
+    w = std::max((x1 - x0) / nx, EPS);
+    h = std::max((y1 - y0) / ny, EPS);
+    std::vector<std::pair<int, int> > cells;
+    for (int i = 0; i < n; i++) {
+      bin_edge(i, cells);
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    start.assign(nx*ny + 1, 0);
+    for (int i = 0; i < (int)cells.size(); i++) {
+      start[cells[i].first + 1]++;
+      edges.push_back(cells[i].second);
+    }
+    for (int i = 0; i < nx*ny; i++) {
+      start[i + 1] += start[i];
+    }
+    // Pick the first of a few candidate positions in each cell that is clear
+    // of its edges. The first reference point in each row is classified by ray
+    // casting and the rest by crossings from the one on their left.
+    static const double f[5][2] = {
+        {0.5, 0.5}, {0.25, 0.25}, {0.75, 0.75}, {0.25, 0.75}, {0.75, 0.25}};
+    ref.resize(nx*ny);
+    has_ref.assign(nx*ny, 0);
+    ref_inside.assign(nx*ny, 0);
+    std::vector<int> seen(n, -1);
+    for (int r = 0; r < ny; r++) {
+      for (int c = 0; c < nx; c++) {
+        int cell = r*nx + c;
+        for (int k = 0; k < 5 && !has_ref[cell]; k++) {
+          ref[cell] = point(x0 + (c + f[k][0])*w, y0 + (r + f[k][1])*h);
+          has_ref[cell] = clear_of_edges(ref[cell], cell);
+        }
+        if (!has_ref[cell]) {
+          continue;
+        }
+        if (c > 0 && has_ref[cell - 1]) {
+          ref_inside[cell] = ref_inside[cell - 1] ^
+              parity(ref[cell - 1], ref[cell], cell - 1, cell, seen, cell);
+        } else {
+          ref_inside[cell] = point_in_polygon(ref[cell], v.begin(), v.end());
+        }
+      }
+    }
+  }
+
+  bool contains(const point &p) const {
+    if (v.empty() || p.x < x0 - EPS || p.x > x0 + nx*w + EPS ||
+        p.y < y0 - EPS || p.y > y0 + ny*h + EPS) {
+      return false;
+    }
+    int cell = row(p.y)*nx + col(p.x);
+    if (!clear_of_edges(p, cell)) {
+      return EDGE_IS_INSIDE;
+    }
+    if (!has_ref[cell]) {
+      return point_in_polygon(p, v.begin(), v.end());
+    }
+    bool res = ref_inside[cell];
+    for (int k = start[cell]; k < start[cell + 1]; k++) {
+      if (crosses(ref[cell], p, vertex(edges[k]), next_vertex(edges[k]))) {
+        res = !res;
+      }
+    }
+    return res;
+  }
+
+  // Sets res[i] to whether the i-th point of the batch is inside, in parallel
+  // if compiled with -fopenmp.
+  void contains(const point_batch &b, bool res[]) const {
+    int n = b.size();
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static, 1024)
+#endif
+    for (int i = 0; i < n; i++) {
+      res[i] = contains(point(b.x[i], b.y[i]));
+    }
+  }
+};
+
+// A convex polygon stored in counter-clockwise order, answering queries by
+// binary searching for the triangle of the fan from its first vertex.
+class convex_polygon {
+  std::vector<point> v;
+
+ public:
+  template<class It>
+  convex_polygon(It lo, It hi) : v(lo, hi) {
+    double area = 0;
+    for (int i = 0, j = (int)v.size() - 1; i < (int)v.size(); j = i++) {
+      area += cross(v[j], v[i]);
+    }
+    if (area < 0) {
+      std::reverse(v.begin(), v.end());
+    }
+  }
+
+  bool contains(const point &p) const {
+    int n = v.size();
+    if (n < 3) {
+      return point_in_polygon(p, v.begin(), v.end());
+    }
+    const point &o = v[0];
+    double c1 = cross(v[1], p, o), c2 = cross(v[n - 1], p, o);
+    if (c1 < -EPS || c2 > EPS) {
+      return false;
+    }
+    int lo = 1, hi = n - 1;
+    while (hi - lo > 1) {
+      int mid = lo + (hi - lo)/2;
+      if (cross(v[mid], p, o) >= 0) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    double d = cross(v[hi], p, v[lo]);
+    if (EQ(d, 0) || (d > 0 && (EQ(c1, 0) || EQ(c2, 0)))) {
+      return EDGE_IS_INSIDE;
+    }
+    return d > 0;
+  }
+
+  void contains(const point_batch &b, bool res[]) const {
+    int n = b.size();
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static, 1024)
+#endif
+    for (int i = 0; i < n; i++) {
+      res[i] = contains(point(b.x[i], b.y[i]));
+    }
+  }
+};
+
 /*** Example Usage ***/
 
 #include <cassert>
+#include <cstdlib>
 using namespace std;
 
 int main() {
@@ -70,5 +359,53 @@ int main() {
   assert(point_in_polygon(point(0, 3), p, p + 4));
   assert(!point_in_polygon(point(0, 3.01), p, p + 4));
   assert(!point_in_polygon(point(2, 2), p, p + 4));
+  polygon_index index(p, p + 4);
+  convex_polygon convex(p, p + 4);
+  assert(index.contains(point(1, 2)) && convex.contains(point(1, 2)));
+  assert(index.contains(point(0, 3)) && convex.contains(point(0, 3)));
+  assert(!index.contains(point(0, 3.01)) && !convex.contains(point(0, 3.01)));
+  assert(!index.contains(point(2, 2)) && !convex.contains(point(2, 2)));
+
+  // A random star-shaped polygon and a random convex polygon (in clockwise
+  // order), queried at random points, vertices, and midpoints of edges.
+  for (int k = 0; k < 20; k++) {
+    int n = 3 + rand() % 500;
+    vector<double> t(n);
+    for (int i = 0; i < n; i++) {
+      t[i] = 2*acos(-1.0)*rand() / RAND_MAX;
+    }
+    sort(t.begin(), t.end());
+    vector<point> star(n), ring(n);
+    for (int i = 0; i < n; i++) {
+      double r = 1 + rand() % 1000;
+      star[i] = point(r*cos(t[i]), r*sin(t[i]));
+      ring[n - 1 - i] = point(500*cos(t[i]), 300*sin(t[i]));
+    }
+    polygon_index si(star.begin(), star.end());
+    convex_polygon cr(ring.begin(), ring.end());
+    point_batch b;
+    for (int i = 0; i < 2000; i++) {
+      b.push_back(point(rand() % 2400 - 1200, rand() % 2400 - 1200));
+    }
+    for (int i = 0; i < n; i++) {
+      b.push_back(star[i]);
+      b.push_back(ring[i]);
+      const point &a = star[i], &c = star[(i + 1) % n];
+      b.push_back(point((a.x + c.x)/2, (a.y + c.y)/2));
+    }
+    vector<char> in_star(b.size()), in_ring(b.size());
+    bool *res = new bool[b.size()];
+    si.contains(b, res);
+    for (int i = 0; i < b.size(); i++) {
+      in_star[i] = point_in_polygon(b[i], star.begin(), star.end());
+      assert(si.contains(b[i]) == (bool)in_star[i] && res[i] == in_star[i]);
+    }
+    cr.contains(b, res);
+    for (int i = 0; i < b.size(); i++) {
+      in_ring[i] = point_in_polygon(b[i], ring.begin(), ring.end());
+      assert(cr.contains(b[i]) == (bool)in_ring[i] && res[i] == in_ring[i]);
+    }
+    delete[] res;
+  }
   return 0;
 }
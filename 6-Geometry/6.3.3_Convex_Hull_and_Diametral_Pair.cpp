@@ -1,39 +1,186 @@
 /*
 
 Given a list of points in two dimensions, determine the convex hull using the
-monotone chain algorithm, and the diameter of the points using the method of
-rotating calipers. The convex hull is the smallest convex polygon (a polygon
-such that every line crossing through it will only do so once) that contains all
-of its points.
+monotone chain algorithm, and the diameter, width, and smallest enclosing
+rectangles of the points using the method of rotating calipers. The convex hull
+is the smallest convex polygon (a polygon such that every line crossing through
+it will only do so once) that contains all of its points.
 
 - convex_hull(lo, hi) returns the convex hull as a vector of polygon vertices in
   clockwise order, given a range [lo, hi) of points where lo and hi must be
   random-access iterators. The input range will be sorted lexicographically (by
-  x, then by y) after the function call. Note that to produce the hull points in
-  counter-clockwise order, replace every GE() comparison with LE(). To have the
-  first point on the hull repeated as the last in the resulting vector, the
-  final res.resize(k - 1) may be changed to res.resize(k).
+  x, then by y) after the function call. Turns are tested with the exact
+  orient2d() predicate, so points that are collinear with two hull vertices are
+  excluded from the hull however nearly degenerate the input is, and points
+  that are not exactly collinear are never dropped. Note that to produce the
+  hull points in counter-clockwise order, replace every >= 0 comparison of
+  orient2d() with <= 0. To have the first point on the hull repeated as the last
+  in the resulting vector, the final res.resize(k - 1) may be changed to
+  res.resize(k).
+- orient2d(a, b, c) returns a positive value if points a, b, and c are in
+  counter-clockwise order, a negative value if they are in clockwise order, or
+  zero if they are collinear. The sign is always exact: the determinant is
+  computed in floating point and only recomputed with exact arithmetic on
+  expansions of doubles (as described by Shewchuk) if it is too close to zero
+  for its rounding error bound.
+- parallel_convex_hull(lo, hi) returns the same hull as convex_hull(lo, hi)
+  without modifying the input range. Points that lie strictly inside the convex
+  hull of the extreme points in eight directions (the Akl-Toussaint octagon) are
+  first discarded in a single pass. The remaining points of each thread are
+  reduced to their own hull, and the hulls of all threads are then merged by
+  taking the hull of their vertices. The pass and the per-thread hulls run in
+  parallel if compiled with -fopenmp.
+- dynamic_hull maintains the convex hull of a stream of points, storing the
+  upper and lower hulls in balanced binary search trees keyed by x. add(p)
+  inserts a point, returning whether it changed the hull. contains(p) returns
+  whether p lies inside or on the boundary of the hull. hull() returns the
+  vertices in the same order as convex_hull().
 - diametral_pair(lo, hi) returns a maximum diametral pair given a range [lo, hi)
   of points where lo and hi must be random-access iterators. The input range
   will be sorted lexicographically (by x, then by y) after the function call.
+- The remaining functions take a hull h in clockwise order, as returned by
+  convex_hull(), so that one hull can be shared by all of them:
+  - antipodal_pairs(h) returns every pair (i, j) with i < j of indices of
+    vertices of h that admit parallel lines of support, in sorted order, found
+    by rotating calipers around the hull.
+  - hull_diameter(h) returns a maximum diametral pair, which is antipodal.
+  - hull_width(h) returns the least distance between two parallel lines that
+    enclose the hull, or 0 if the hull has fewer than three vertices.
+  - min_rectangle(h, perimeter) returns the four corners, in clockwise order,
+    of a rectangle of least area (or of least perimeter if perimeter is true)
+    that encloses the hull. One of its sides lies along an edge of the hull,
+    so the rectangle flush with each edge is found with three calipers that
+    each advance once around the hull.
 
 Time Complexity:
+- O(1) per call to orient2d(a, b, c).
 - O(n log n) per call to convex_hull(lo, hi) and diametral_pair(lo, hi), where n
   is the distance between lo and hi.
+- O(n/t + m log m) per call to parallel_convex_hull(lo, hi), where t is the
+  number of threads and m is the number of points outside of the octagon (which
+  is typically far smaller than n).
+- O(log n) amortized per call to dynamic_hull::add(p), and O(log n) per call to
+  dynamic_hull::contains(p), where n is the number of hull vertices.
+- O(n) per call to dynamic_hull::hull().
+- O(h) per call to antipodal_pairs(h), hull_diameter(h), hull_width(h), and
+  min_rectangle(h), where h is the number of hull vertices.
 
 Space Complexity:
-- O(n) auxiliary for storage of the convex hull in both operations.
+- O(n) auxiliary for storage of the convex hull in all operations.
+- O(n) for storage of a dynamic_hull with n vertices.
 
 */
 
 #include <algorithm>
+#include <cfloat>
 #include <cmath>
+#include <map>
 #include <utility>
 #include <vector>
 
-const double EPS = 1e-9;
+// Robust predicates after Shewchuk. Each predicate first evaluates its
+// determinant in floating point and returns it if its magnitude is above a
+// bound on the rounding error, otherwise it recomputes the determinant exactly
+// as an expansion (a sum of doubles that do not overlap in their bits, stored
+// in increasing order of magnitude) and returns its largest component.
 
-#define GE(a, b) ((a) >= (b) - EPS)
+typedef std::vector<double> expansion;
+
+const double ORIENT_BOUND = (3 + 8*DBL_EPSILON)*DBL_EPSILON/2;
+
+// Sets x + y = a + b exactly, where x is the rounded sum.
+void two_sum(double a, double b, double &x, double &y) {
+  x = a + b;
+  double bv = x - a, av = x - bv;
+  y = (a - av) + (b - bv);
+}
+
+// Sets x + y = a*b exactly, where x is the rounded product.
+void two_product(double a, double b, double &x, double &y) {
+  x = a*b;
+#ifdef __FMA__
+  y = __builtin_fma(a, b, -x);
+#else
+  static const double SPLITTER = 134217729.0;  // 2^27 + 1.
+  double c = SPLITTER*a, ah = c - (c - a), al = a - ah;
+  double d = SPLITTER*b, bh = d - (d - b), bl = b - bh;
+  y = al*bl - (((x - ah*bh) - al*bh) - ah*bl);
+#endif
+}
+
+bool abs_less(double a, double b) { return fabs(a) < fabs(b); }
+
+expansion expansion_sum(const expansion &e, const expansion &f) {
+  expansion g(e.size() + f.size()), h;
+  std::merge(e.begin(), e.end(), f.begin(), f.end(), g.begin(), abs_less);
+  double q = 0, r;
+  for (int i = 0; i < (int)g.size(); i++) {
+    two_sum(q, g[i], q, r);
+    if (r != 0) {
+      h.push_back(r);
+    }
+  }
+  if (q != 0 || h.empty()) {
+    h.push_back(q);
+  }
+  return h;
+}
+
+expansion scale_expansion(const expansion &e, double b) {
+  expansion h;
+  double q, r, hi, lo, s;
+  two_product(e[0], b, q, r);
+  if (r != 0) {
+    h.push_back(r);
+  }
+  for (int i = 1; i < (int)e.size(); i++) {
+    two_product(e[i], b, hi, lo);
+    two_sum(q, lo, s, r);
+    if (r != 0) {
+      h.push_back(r);
+    }
+    two_sum(hi, s, q, r);
+    if (r != 0) {
+      h.push_back(r);
+    }
+  }
+  if (q != 0 || h.empty()) {
+    h.push_back(q);
+  }
+  return h;
+}
+
+// Returns a positive value if a, b, and c are in counter-clockwise order, a
+// negative value if they are in clockwise order, or zero if they are collinear.
+// The magnitude approximates twice the area of the triangle.
+double orient2d(double ax, double ay, double bx, double by,
+                double cx, double cy) {
+  double left = (ax - cx)*(by - cy), right = (ay - cy)*(bx - cx);
+  double det = left - right, sum;
+  if (left > 0) {
+    if (right <= 0) {
+      return det;
+    }
+    sum = left + right;
+  } else if (left < 0) {
+    if (right >= 0) {
+      return det;
+    }
+    sum = -left - right;
+  } else {
+    return det;
+  }
+  if (fabs(det) >= ORIENT_BOUND*sum) {
+    return det;
+  }
+  double t[6][2] = {{ax, by}, {-ax, cy}, {-cx, by},
+                    {-ay, bx}, {ay, cx}, {cy, bx}};
+  expansion res(1, 0);
+  for (int i = 0; i < 6; i++) {
+    res = expansion_sum(res, scale_expansion(expansion(1, t[i][0]), t[i][1]));
+  }
+  return res.back();
+}
 
 typedef std::pair<double, double> point;
 #define x first
@@ -44,6 +191,10 @@ double cross(const point &a, const point &b, const point &o = point(0, 0)) {
   return (a.x - o.x)*(b.y - o.y) - (a.y - o.y)*(b.x - o.x);
 }
 
+double orient2d(const point &a, const point &b, const point &c) {
+  return orient2d(a.x, a.y, b.x, b.y, c.x, c.y);
+}
+
 template<class It>
 std::vector<point> convex_hull(It lo, It hi) {
   int k = 0;
@@ -53,14 +204,14 @@ std::vector<point> convex_hull(It lo, It hi) {
   std::vector<point> res(2*(int)(hi - lo));
   std::sort(lo, hi);
   for (It it = lo; it != hi; ++it) {
-    while (k >= 2 && GE(cross(res[k - 1], *it, res[k - 2]), 0)) {
+    while (k >= 2 && orient2d(res[k - 1], *it, res[k - 2]) >= 0) {
       k--;
     }
     res[k++] = *it;
   }
   int t = k + 1;
   for (It it = hi - 2; it != lo - 1; --it) {
-    while (k >= t && GE(cross(res[k - 1], *it, res[k - 2]), 0)) {
+    while (k >= t && orient2d(res[k - 1], *it, res[k - 2]) >= 0) {
       k--;
     }
     res[k++] = *it;
@@ -69,47 +220,375 @@ std::vector<point> convex_hull(It lo, It hi) {
   return res;
 }
 
+// Returns the extreme points of [lo, hi) in the eight directions of minimal x,
+// minimal x + y, minimal y, maximal x - y, maximal x, maximal x + y, maximal y,
+// and minimal x - y, which are the possibly repeated vertices of a convex
+// octagon in counter-clockwise order.
 template<class It>
-std::pair<point, point> diametral_pair(It lo, It hi) {
-  std::vector<point> h = convex_hull(lo, hi);
+std::vector<point> akl_toussaint_octagon(It lo, It hi) {
+  std::vector<point> res(8, *lo);
+  double best[8];
+  std::fill(best, best + 8, -HUGE_VAL);
+  for (It it = lo; it != hi; ++it) {
+    double s = it->x + it->y, d = it->x - it->y;
+    double key[8] = {-it->x, -s, -it->y, d, it->x, s, it->y, -d};
+    for (int i = 0; i < 8; i++) {
+      if (key[i] > best[i]) {
+        best[i] = key[i];
+        res[i] = *it;
+      }
+    }
+  }
+  return res;
+}
+
+// Returns whether p lies inside the convex polygon h in clockwise order (or
+// strictly inside if strict is true), or false if h has fewer than three
+// vertices.
+bool inside(const std::vector<point> &h, const point &p, bool strict) {
   int m = h.size();
-  if (m == 1) {
-    return std::make_pair(h[0], h[0]);
+  if (m < 3) {
+    return false;
+  }
+  for (int i = 0, j = m - 1; i < m; j = i++) {
+    double o = orient2d(h[j], h[i], p);
+    if (o > 0 || (strict && o == 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Points strictly inside the axis-aligned rectangle between the diagonal
+// extremes are discarded with four comparisons, if its corners are inside the
+// octagon (an open rectangle in a closed convex polygon is in its interior).
+// The rest are tested against every edge of the octagon.
+template<class It>
+std::vector<point> parallel_convex_hull(It lo, It hi) {
+  int n = hi - lo;
+  if (n == 0) {
+    return std::vector<point>();
+  }
+  std::vector<point> e = akl_toussaint_octagon(lo, hi), octagon(e), res;
+  octagon = convex_hull(octagon.begin(), octagon.end());
+  double xlo = std::max(e[1].x, e[7].x), xhi = std::min(e[3].x, e[5].x);
+  double ylo = std::max(e[1].y, e[3].y), yhi = std::min(e[5].y, e[7].y);
+  if (!inside(octagon, point(xlo, ylo), false) ||
+      !inside(octagon, point(xlo, yhi), false) ||
+      !inside(octagon, point(xhi, ylo), false) ||
+      !inside(octagon, point(xhi, yhi), false)) {
+    xlo = xhi = ylo = yhi = 0;
+  }
+#ifdef _OPENMP
+  #pragma omp parallel
+#endif
+  {
+    std::vector<point> local;
+#ifdef _OPENMP
+    #pragma omp for nowait
+#endif
+    for (int i = 0; i < n; i++) {
+      const point &p = lo[i];
+      if (!(xlo < p.x && p.x < xhi && ylo < p.y && p.y < yhi) &&
+          !inside(octagon, p, true)) {
+        local.push_back(p);
+      }
+    }
+    local = convex_hull(local.begin(), local.end());
+#ifdef _OPENMP
+    #pragma omp critical
+#endif
+    res.insert(res.end(), local.begin(), local.end());
+  }
+  return convex_hull(res.begin(), res.end());
+}
+
+// The upper hull of the points inserted so far, as a map from x to y.
+class upper_hull {
+  typedef std::map<double, double>::iterator iter;
+  std::map<double, double> h;
+
+  static point at(iter it) { return point(it->first, it->second); }
+
+ public:
+  const std::map<double, double>& points() const { return h; }
+
+  bool below(const point &p) const {
+    std::map<double, double>::const_iterator r = h.lower_bound(p.x), l = r;
+    if (r == h.end()) {
+      return false;
+    }
+    if (r->first == p.x) {
+      return p.y <= r->second;
+    }
+    if (r == h.begin()) {
+      return false;
+    }
+    --l;
+    return orient2d(point(l->first, l->second), point(r->first, r->second),
+                    p) <= 0;
+  }
+
+  bool add(const point &p) {
+    if (below(p)) {
+      return false;
+    }
+    iter it = h.find(p.x);
+    if (it != h.end()) {
+      it->second = p.y;
+    } else {
+      it = h.insert(std::make_pair(p.x, p.y)).first;
+    }
+    for (;;) {
+      iter r = it, rr;
+      if (++r == h.end() || ++(rr = r) == h.end() ||
+          orient2d(p, at(rr), at(r)) > 0) {
+        break;
+      }
+      h.erase(r);
+    }
+    while (it != h.begin()) {
+      iter l = it, ll;
+      if (--l == h.begin() || orient2d(at(--(ll = l)), p, at(l)) > 0) {
+        break;
+      }
+      h.erase(l);
+    }
+    return true;
+  }
+};
+
+class dynamic_hull {
+  upper_hull upper, lower;  // The lower hull is stored as the upper hull of
+                            // the points reflected across the x-axis.
+ public:
+  bool contains(const point &p) const {
+    return upper.below(p) && lower.below(point(p.x, -p.y));
+  }
+
+  bool add(const point &p) {
+    bool u = upper.add(p), l = lower.add(point(p.x, -p.y));
+    return u || l;
+  }
+
+  std::vector<point> hull() const {
+    typedef std::map<double, double>::const_iterator citer;
+    const std::map<double, double> &u = upper.points(), &l = lower.points();
+    std::vector<point> res;
+    if (u.empty()) {
+      return res;
+    }
+    point first(l.begin()->first, -l.begin()->second);
+    res.push_back(first);
+    for (citer it = u.begin(); it != u.end(); ++it) {
+      if (point(it->first, it->second) != res.back()) {
+        res.push_back(point(it->first, it->second));
+      }
+    }
+    for (citer it = --l.end(); it != l.begin(); --it) {
+      if (point(it->first, -it->second) != res.back()) {
+        res.push_back(point(it->first, -it->second));
+      }
+    }
+    return res;
+  }
+};
+
+// Rotating calipers over a hull h in clockwise order, as from convex_hull().
+
+double dot(const point &a, const point &b) { return a.x*b.x + a.y*b.y; }
+
+point edge(const std::vector<point> &h, int i) {
+  const point &a = h[i], &b = h[(i + 1) % h.size()];
+  return point(b.x - a.x, b.y - a.y);
+}
+
+std::vector<std::pair<int, int> > antipodal_pairs(const std::vector<point> &h) {
+  int m = h.size();
+  std::vector<std::pair<int, int> > res;
+  if (m <= 2) {
+    if (m == 2) {
+      res.push_back(std::make_pair(0, 1));
+    }
+    return res;
   }
-  if (m == 2) {
-    return std::make_pair(h[0], h[1]);
+  // For each edge, j is (one of) the vertices farthest from the edge, which is
+  // reached by advancing while the edge after j still turns away from it.
+  for (int i = 0, j = 1; i < m; i++) {
+    point e = edge(h, i);
+    while (cross(e, edge(h, j)) < 0) {
+      j = (j + 1) % m;
+    }
+    int i1 = (i + 1) % m, j1 = (j + 1) % m;
+    res.push_back(std::make_pair(std::min(i, j), std::max(i, j)));
+    res.push_back(std::make_pair(std::min(i1, j), std::max(i1, j)));
+    if (cross(e, edge(h, j)) == 0) {  // Parallel edges.
+      res.push_back(std::make_pair(std::min(i, j1), std::max(i, j1)));
+      res.push_back(std::make_pair(std::min(i1, j1), std::max(i1, j1)));
+    }
   }
-  int k = 1;
-  while (fabs(cross(h[0], h[(k + 1) % m], h[m - 1])) >
-         fabs(cross(h[0], h[k], h[m - 1]))) {
-    k++;
+  // Counting sort by the second index and then stably by the first, so that
+  // duplicates become adjacent in O(h).
+  std::vector<std::pair<int, int> > tmp(res.size());
+  for (int pass = 0; pass < 2; pass++) {
+    std::vector<int> start(m + 1, 0);
+    for (int k = 0; k < (int)res.size(); k++) {
+      start[(pass ? res[k].first : res[k].second) + 1]++;
+    }
+    for (int i = 0; i < m; i++) {
+      start[i + 1] += start[i];
+    }
+    for (int k = 0; k < (int)res.size(); k++) {
+      tmp[start[pass ? res[k].first : res[k].second]++] = res[k];
+    }
+    res.swap(tmp);
   }
-  double maxdist = 0, d;
+  res.erase(std::unique(res.begin(), res.end()), res.end());
+  return res;
+}
+
+std::pair<point, point> hull_diameter(const std::vector<point> &h) {
+  if (h.size() == 1) {
+    return std::make_pair(h[0], h[0]);
+  }
+  std::vector<std::pair<int, int> > p = antipodal_pairs(h);
   std::pair<point, point> res;
-  for (int i = 0, j = k; i <= k && j < m; i++) {
-    d = sqnorm(point(h[i].x - h[j].x, h[i].y - h[j].y));
+  double maxdist = -1;
+  for (int k = 0; k < (int)p.size(); k++) {
+    const point &a = h[p[k].first], &b = h[p[k].second];
+    double d = sqnorm(point(a.x - b.x, a.y - b.y));
     if (d > maxdist) {
       maxdist = d;
-      res = std::make_pair(h[i], h[j]);
-    }
-    while (j < m && fabs(cross(h[(i + 1) % m], h[(j + 1) % m], h[i])) >
-                    fabs(cross(h[(i + 1) % m], h[j], h[i]))) {
-      d = sqnorm(point(h[i].x - h[(j + 1) % m].x, h[i].y - h[(j + 1) % m].y));
-      if (d > maxdist) {
-        maxdist = d;
-        res = std::make_pair(h[i], h[(j + 1) % m]);
-      }
-      j++;
+      res = std::make_pair(a, b);
     }
   }
   return res;
 }
 
+// The rectangle with a side along edge i of the hull, spanning [lo, hi] along
+// the unit direction u of the edge from its start, and height inwards.
+struct flush_rectangle {
+  int edge;
+  point u;
+  double lo, hi, height;
+
+  double area() const { return (hi - lo)*height; }
+  double perimeter() const { return 2*(hi - lo + height); }
+};
+
+// Returns the rectangle flush with each edge of a hull with at least three
+// vertices, as three calipers advance around the hull: j is farthest along the
+// edge, k is farthest inwards, and l is farthest backwards.
+std::vector<flush_rectangle> flush_rectangles(const std::vector<point> &h) {
+  int m = h.size();
+  std::vector<flush_rectangle> res;
+  for (int i = 0, j = 1, k = 1, l = 1; i < m; i++) {
+    flush_rectangle r;
+    point e = edge(h, i);
+    double len = sqrt(sqnorm(e));
+    r.edge = i;
+    r.u = point(e.x/len, e.y/len);
+    point n(r.u.y, -r.u.x);  // The inward normal for a clockwise hull.
+    while (dot(edge(h, j), r.u) > 0) {
+      j = (j + 1) % m;
+    }
+    if (i == 0) {
+      k = j;
+    }
+    while (dot(edge(h, k), n) > 0) {
+      k = (k + 1) % m;
+    }
+    if (i == 0) {
+      l = k;
+    }
+    while (dot(edge(h, l), r.u) < 0) {
+      l = (l + 1) % m;
+    }
+    r.lo = dot(point(h[l].x - h[i].x, h[l].y - h[i].y), r.u);
+    r.hi = dot(point(h[j].x - h[i].x, h[j].y - h[i].y), r.u);
+    r.height = dot(point(h[k].x - h[i].x, h[k].y - h[i].y), n);
+    res.push_back(r);
+  }
+  return res;
+}
+
+// Returns the corners of r in clockwise order.
+std::vector<point> corners(const std::vector<point> &h,
+                           const flush_rectangle &r) {
+  const point &o = h[r.edge];
+  point n(r.u.y*r.height, -r.u.x*r.height);
+  std::vector<point> res;
+  res.push_back(point(o.x + r.u.x*r.lo, o.y + r.u.y*r.lo));
+  res.push_back(point(o.x + r.u.x*r.hi, o.y + r.u.y*r.hi));
+  res.push_back(point(res[1].x + n.x, res[1].y + n.y));
+  res.push_back(point(res[0].x + n.x, res[0].y + n.y));
+  return res;
+}
+
+double hull_width(const std::vector<point> &h) {
+  if (h.size() <= 2) {
+    return 0;
+  }
+  std::vector<flush_rectangle> r = flush_rectangles(h);
+  double res = r[0].height;
+  for (int i = 1; i < (int)r.size(); i++) {
+    res = std::min(res, r[i].height);
+  }
+  return res;
+}
+
+// Returns the corners of the rectangle of least area (or of least perimeter
+// if perimeter is true) containing the hull, in clockwise order. Such a
+// rectangle always has a side along an edge of the hull.
+std::vector<point> min_rectangle(const std::vector<point> &h,
+                                 bool perimeter = false) {
+  if (h.size() <= 2) {
+    std::vector<point> res(h);
+    if (h.size() == 2) {
+      res.push_back(h[1]);
+      res.push_back(h[0]);
+    } else if (h.size() == 1) {
+      res.resize(4, h[0]);
+    }
+    return res;
+  }
+  std::vector<flush_rectangle> r = flush_rectangles(h);
+  int best = 0;
+  for (int i = 1; i < (int)r.size(); i++) {
+    if (perimeter ? r[i].perimeter() < r[best].perimeter()
+                  : r[i].area() < r[best].area()) {
+      best = i;
+    }
+  }
+  return corners(h, r[best]);
+}
+
+template<class It>
+std::pair<point, point> diametral_pair(It lo, It hi) {
+  return hull_diameter(convex_hull(lo, hi));
+}
+
 /*** Example Usage ***/
 
 #include <cassert>
+#include <cstdlib>
 using namespace std;
 
+// Checks that h is strictly convex in clockwise order and contains every point.
+void check_hull(const vector<point> &v, const vector<point> &h) {
+  int m = h.size();
+  for (int i = 0; m >= 3 && i < m; i++) {
+    assert(orient2d(h[i], h[(i + 1) % m], h[(i + 2) % m]) < 0);
+  }
+  for (int i = 0; m >= 2 && i < m; i++) {
+    for (int j = 0; j < (int)v.size(); j++) {
+      assert(orient2d(h[i], h[(i + 1) % m], v[j]) <= 0);
+    }
+  }
+}
+
+bool approx(double a, double b) { return fabs(a - b) < 1e-9; }
+
 int main() {
   { // Irregular pentagon with only the vertex (1, 2) not on the hull.
     vector<point> v;
@@ -137,5 +616,148 @@ int main() {
     assert(res.first == point(0, 0));
     assert(res.second == point(4, 4));
   }
+  { // Nearly collinear points that are a few units in the last place apart.
+    vector<point> v;
+    double ulp = ldexp(1.0, -53);
+    for (int i = 0; i < 16; i++) {
+      for (int j = 0; j < 16; j++) {
+        v.push_back(point(0.5 + i*ulp, 0.5 + j*ulp));
+      }
+    }
+    v.push_back(point(12, 12));
+    v.push_back(point(24, 24));
+    v.push_back(point(17.300000000000001, 17.300000000000001));
+    for (int k = 0; k < 10; k++) {
+      random_shuffle(v.begin(), v.end());
+      vector<point> w(v), h = convex_hull(w.begin(), w.end());
+      check_hull(v, h);
+    }
+  }
+  for (int k = 0; k < 100; k++) { // Grids with many collinear points.
+    vector<point> v;
+    for (int i = 0; i < k; i++) {
+      v.push_back(point(rand() % 5, (rand() % 5)*0.1));
+    }
+    vector<point> w(v), h = convex_hull(w.begin(), w.end());
+    check_hull(v, h);
+  }
+  { // A 4 by 2 rectangle, and a diamond whose bounding box is twice as large.
+    vector<point> v;
+    v.push_back(point(0, 0));
+    v.push_back(point(4, 0));
+    v.push_back(point(4, 2));
+    v.push_back(point(0, 2));
+    v.push_back(point(1, 1));
+    vector<point> h = convex_hull(v.begin(), v.end());
+    assert(antipodal_pairs(h).size() == 6);
+    assert(approx(hull_width(h), 2));
+    vector<point> r = min_rectangle(h), c(h);
+    sort(r.begin(), r.end());
+    sort(c.begin(), c.end());
+    for (int i = 0; i < 4; i++) {
+      assert(approx(r[i].x, c[i].x) && approx(r[i].y, c[i].y));
+    }
+    v.clear();
+    v.push_back(point(1, 0));
+    v.push_back(point(0, 1));
+    v.push_back(point(-1, 0));
+    v.push_back(point(0, -1));
+    h = convex_hull(v.begin(), v.end());
+    assert(approx(hull_width(h), sqrt(2.0)));
+    r = min_rectangle(h);
+    assert(approx(cross(r[0], r[2], r[1]), 2));
+  }
+  for (int k = 0; k < 200; k++) { // Calipers against brute force.
+    vector<point> v;
+    int n = 1 + rand() % 60;
+    for (int i = 0; i < n; i++) {
+      if (k % 2 == 0) {
+        v.push_back(point(rand() % 10, rand() % 10));
+      } else {
+        double t = (double)rand() / RAND_MAX * 6.283;
+        v.push_back(point(3*cos(t) + 2, sin(t) - 1));
+      }
+    }
+    vector<point> h = convex_hull(v.begin(), v.end());
+    int m = h.size();
+    double diameter = 0, width = (m <= 2) ? 0 : 1e18, area = 1e18,
+           perimeter = 1e18;
+    for (int i = 0; i < (int)v.size(); i++) {
+      for (int j = 0; j < (int)v.size(); j++) {
+        diameter = max(diameter, sqnorm(point(v[i].x - v[j].x,
+                                              v[i].y - v[j].y)));
+      }
+    }
+    for (int i = 0; m >= 3 && i < m; i++) {
+      point e = edge(h, i), o = h[i];
+      double len = sqrt(sqnorm(e)), lo = 0, hi = 0, depth = 0;
+      for (int j = 0; j < (int)v.size(); j++) {
+        point d(v[j].x - o.x, v[j].y - o.y);
+        lo = min(lo, dot(d, e)/len);
+        hi = max(hi, dot(d, e)/len);
+        depth = max(depth, -cross(e, d)/len);
+      }
+      width = min(width, depth);
+      area = min(area, (hi - lo)*depth);
+      perimeter = min(perimeter, 2*(hi - lo + depth));
+    }
+    pair<point, point> d = hull_diameter(h);
+    assert(approx(sqnorm(point(d.first.x - d.second.x, d.first.y - d.second.y)),
+              diameter));
+    assert(fabs(hull_width(h) - width) < 1e-9);
+    vector<point> pa = min_rectangle(h), pp = min_rectangle(h, true);
+    if (m >= 3) {
+      double a = sqrt(sqnorm(point(pa[1].x - pa[0].x, pa[1].y - pa[0].y)));
+      double b = sqrt(sqnorm(point(pa[2].x - pa[1].x, pa[2].y - pa[1].y)));
+      assert(fabs(a*b - area) < 1e-9);
+      a = sqrt(sqnorm(point(pp[1].x - pp[0].x, pp[1].y - pp[0].y)));
+      b = sqrt(sqnorm(point(pp[2].x - pp[1].x, pp[2].y - pp[1].y)));
+      assert(fabs(2*(a + b) - perimeter) < 1e-9);
+      for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < (int)v.size(); j++) {
+          assert(cross(pa[(i + 1) % 4], v[j], pa[i]) <= 1e-9);
+          assert(cross(pp[(i + 1) % 4], v[j], pp[i]) <= 1e-9);
+        }
+      }
+      int pairs = antipodal_pairs(h).size();
+      assert(m <= pairs && pairs <= 3*m/2);
+    }
+  }
+  for (int k = 0; k < 300; k++) { // Parallel and dynamic hulls.
+    vector<point> v;
+    int n = (k < 20) ? k : rand() % 2000;
+    for (int i = 0; i < n; i++) {
+      if (k % 3 == 0) {
+        v.push_back(point(rand() % 7, rand() % 7));
+      } else {
+        double r = (double)rand() / RAND_MAX, t = rand()*0.001;
+        v.push_back(point(r*cos(t), r*sin(t)));
+      }
+    }
+    vector<point> w(v), h = convex_hull(w.begin(), w.end());
+    assert(parallel_convex_hull(v.begin(), v.end()) == h);
+    dynamic_hull d;
+    for (int i = 0; i < n; i++) {
+      bool inside = d.contains(v[i]);
+      assert(d.add(v[i]) == !inside);
+      assert(d.contains(v[i]));
+    }
+    assert(d.hull() == h);
+    for (int i = 0; i < 20; i++) {
+      point p(rand() % 9 - 1, rand() % 9 - 1);
+      bool on_or_inside = !h.empty();
+      for (int j = 0; j < (int)h.size(); j++) {
+        if (h.size() >= 3 && orient2d(h[j], h[(j + 1) % h.size()], p) > 0) {
+          on_or_inside = false;
+        }
+      }
+      if (h.size() < 3) {
+        on_or_inside = (h.size() == 1) ? (p == h[0]) : (h.size() == 2 &&
+            orient2d(h[0], h[1], p) == 0 && min(h[0], h[1]) <= p &&
+            p <= max(h[0], h[1]));
+      }
+      assert(d.contains(p) == on_or_inside);
+    }
+  }
   return 0;
 }
@@ -1,19 +1,49 @@
 /*
 
 Given a list of points in two dimensions, find the circle with smallest area
-which contains all the given points using a randomized algorithm.
+which contains all the given points using a randomized algorithm. The same
+method finds the smallest sphere containing points in three dimensions, and
+can maintain either ball under insertions and erasures of points.
 
 - minimum_enclosing_circle(lo, hi) returns the minimum enclosing circle given a
-  range [lo, hi) of points, where lo and hi must be random-access iterators. The
-  input range will be shuffled after the function call, though this is only to
-  avoid the worst-case running time and is not necessary for correctness.
+  range [lo, hi) of points, where lo and hi must be random-access iterators. A
+  random permutation of indices is processed to avoid the worst-case running
+  time, leaving the input range unchanged.
+- minimum_enclosing_sphere(lo, hi) returns the minimum enclosing sphere given a
+  range [lo, hi) of point3 values, where lo and hi must be random-access
+  iterators.
+- enclosing_circle and enclosing_sphere are instances of enclosing_ball, which
+  maintains the minimum enclosing ball of a set of points along with the ids of
+  the points which determine it (its support set).
+  - insert(q) adds the point q, returning its id, which is the number of
+    insertions made before it. If q is inside the current ball, nothing else is
+    done. Otherwise, q must lie on the boundary of the new ball, so only balls
+    through q are considered.
+  - erase(id) removes a present point. If it is not in the support set (nor
+    on the boundary up to EPS), the ball is unchanged. Otherwise the ball is
+    recomputed.
+  - size() returns the number of present points.
+  - ball() returns the current minimum enclosing ball, or the ball of radius 0
+    at the origin if no points are present.
+  - support_set() returns the ids of the points which determine ball().
 
 Time Complexity:
-- O(n) on average per call to minimum_enclosing_circle(lo, hi), where n is the
-  distance between lo and hi.
+- O(n) on average per call to minimum_enclosing_circle(lo, hi) and
+  minimum_enclosing_sphere(lo, hi), where n is the distance between lo and hi.
+- O(1) per call to insert(q) for a point inside the current ball, and O(n) on
+  average otherwise, where n is the number of present points. If the points are
+  inserted in random order, the i-th point lies outside with probability at
+  most d/i for d = 3 (circle) or d = 4 (sphere), so inserting n points takes
+  O(n) expected time in total.
+- O(1) per call to erase(id) for a point strictly inside the current ball, and
+  O(n) on average otherwise. Erasing a random point is O(n) with probability at
+  most d/n for the same d, and so is O(1) on average.
+- O(1) per call to size() and ball(), and O(d) per call to support_set().
 
 Space Complexity:
-- O(1) auxiliary.
+- O(n) auxiliary for the index permutation in minimum_enclosing_circle(lo, hi)
+  and minimum_enclosing_sphere(lo, hi).
+- O(n) for the storage of enclosing_ball, where n is the number of insertions.
 
 */
 
@@ -21,6 +51,7 @@ Space Complexity:
 #include <cmath>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 const double EPS = 1e-9;
 
@@ -67,51 +98,373 @@ struct circle {
   bool contains(const point &p) const {
     return LE(sqnorm(point(p.x - h, p.y - k)), r*r);
   }
+
+  bool on_boundary(const point &p) const {
+    return LE(r*r, sqnorm(point(p.x - h, p.y - k)));
+  }
 };
 
+// Returns the smallest circle with the points s[0], ..., s[m - 1] on its
+// boundary, for 1 <= m <= 3.
+template<class It>
+circle boundary_ball(It p, const int s[], int m, circle) {
+  if (m == 1) {
+    return circle(p[s[0]].x, p[s[0]].y, 0);
+  }
+  if (m == 2) {
+    return circle(p[s[0]], p[s[1]]);
+  }
+  return circle(p[s[0]], p[s[1]], p[s[2]]);
+}
+
+// Returns the smallest ball of type Ball containing p[ord[0]], ...,
+// p[ord[n - 1]] with the m points indexed by s on its boundary, where s must
+// have room for max_support indices. The indices of the points which determine
+// the result are stored into support, and their count into k. The expected
+// running time is O(n) if ord is a random permutation.
+template<class Ball, class It>
+Ball welzl(It p, const std::vector<int> &ord, int n, int s[], int m,
+           int max_support, int support[], int &k) {
+  Ball res;
+  if (m > 0) {
+    res = boundary_ball(p, s, m, res);
+  }
+  std::copy(s, s + m, support);
+  k = m;
+  if (m == max_support) {
+    return res;
+  }
+  for (int i = 0; i < n; i++) {
+    if ((m > 0 || i > 0) && res.contains(p[ord[i]])) {
+      continue;
+    }
+    s[m] = ord[i];
+    res = welzl<Ball>(p, ord, i, s, m + 1, max_support, support, k);
+  }
+  return res;
+}
+
 template<class It>
 circle minimum_enclosing_circle(It lo, It hi) {
   if (lo == hi) {
     return circle(0, 0, 0);
   }
-  if (lo + 1 == hi) {
-    return circle(lo->x, lo->y, 0);
+  std::vector<int> ord(hi - lo);
+  for (int i = 0; i < (int)ord.size(); i++) {
+    ord[i] = i;
   }
-  std::random_shuffle(lo, hi);
-  circle res(*lo, *(lo + 1));
-  for (It i = lo + 2; i != hi; ++i) {
-    if (res.contains(*i)) {
-      continue;
+  std::random_shuffle(ord.begin(), ord.end());
+  int s[3], support[3], k;
+  return welzl<circle>(lo, ord, ord.size(), s, 0, 3, support, k);
+}
+
+// Maintains the minimum enclosing ball of a set of points under insertions and
+// erasures. Inserting a point inside the ball leaves it unchanged, otherwise
+// the new point must lie on the boundary of the new ball, so only the balls
+// through it are searched. Erasing a point outside the support set leaves the
+// ball unchanged, unless the point also lies on the boundary (where it may be
+// needed for cocircular inputs), otherwise the ball is recomputed from scratch.
+template<class Point, class Ball, int MAX_SUPPORT>
+class enclosing_ball {
+  std::vector<Point> p;
+  std::vector<int> ord, pos;  // The ids of the present points, shuffled.
+  int support[MAX_SUPPORT], k;
+  Ball res;
+
+  void rebuild(int with) {
+    std::random_shuffle(ord.begin(), ord.end());
+    for (int i = 0; i < (int)ord.size(); i++) {
+      pos[ord[i]] = i;
     }
-    res = circle(*lo, *i);
-    for (It j = lo + 1; j != i; ++j) {
-      if (res.contains(*j)) {
-        continue;
-      }
-      res = circle(*i, *j);
-      for (It k = lo; k != j; ++k) {
-        if (!res.contains(*k)) {
-          res = circle(*i, *j, *k);
-        }
-      }
+    int s[MAX_SUPPORT] = {with};
+    if (with >= 0 || !ord.empty()) {
+      res = welzl<Ball>(p.begin(), ord, ord.size(), s, (with >= 0) ? 1 : 0,
+                        MAX_SUPPORT, support, k);
+    } else {
+      res = Ball();
+      k = 0;
     }
   }
-  return res;
+
+ public:
+  enclosing_ball() : k(0) {}
+
+  // Inserts q and returns its id, which is the number of insertions before it.
+  int insert(const Point &q) {
+    int id = p.size();
+    p.push_back(q);
+    pos.push_back(0);
+    if (ord.empty() || !res.contains(q)) {
+      rebuild(id);
+    }
+    pos[id] = ord.size();
+    ord.push_back(id);
+    return id;
+  }
+
+  // Erases the point with the given id, which must be present.
+  void erase(int id) {
+    int i = pos[id];
+    pos[ord.back()] = i;
+    ord[i] = ord.back();
+    ord.pop_back();
+    if (std::find(support, support + k, id) != support + k ||
+        res.on_boundary(p[id])) {
+      rebuild(-1);
+    }
+  }
+
+  int size() const { return ord.size(); }
+  const Ball& ball() const { return res; }
+
+  // Returns the ids of the (at most MAX_SUPPORT) points which determine the
+  // current ball.
+  std::vector<int> support_set() const {
+    return std::vector<int>(support, support + k);
+  }
+};
+
+typedef enclosing_ball<point, circle, 3> enclosing_circle;
+
+// Three dimensional points and spheres.
+
+struct point3 {
+  double x, y, z;
+
+  point3(double x = 0, double y = 0, double z = 0) : x(x), y(y), z(z) {}
+
+  point3 operator-(const point3 &p) const {
+    return point3(x - p.x, y - p.y, z - p.z);
+  }
+};
+
+double dot(const point3 &a, const point3 &b) {
+  return a.x*b.x + a.y*b.y + a.z*b.z;
+}
+
+point3 cross(const point3 &a, const point3 &b) {
+  return point3(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
 }
 
+struct sphere {
+  point3 c;
+  double r;
+
+  sphere() : r(0) {}
+  sphere(const point3 &c, double r) : c(c), r(fabs(r)) {}
+
+  // Sphere with the line segment ab as a diameter.
+  sphere(const point3 &a, const point3 &b) {
+    c = point3((a.x + b.x)/2.0, (a.y + b.y)/2.0, (a.z + b.z)/2.0);
+    r = sqrt(dot(a - c, a - c));
+  }
+
+  // Smallest sphere through three points, centered on their plane.
+  sphere(const point3 &a, const point3 &b, const point3 &p) {
+    point3 u = b - a, v = p - a, w = cross(u, v);
+    double d = 2*dot(w, w);
+    if (EQ(d, 0)) {
+      throw std::runtime_error("No circumcircle from collinear points.");
+    }
+    point3 t = cross(point3(dot(u, u)*v.x - dot(v, v)*u.x,
+                            dot(u, u)*v.y - dot(v, v)*u.y,
+                            dot(u, u)*v.z - dot(v, v)*u.z), w);
+    c = point3(a.x + t.x/d, a.y + t.y/d, a.z + t.z/d);
+    r = sqrt(dot(a - c, a - c));
+  }
+
+  // Circumsphere of four points.
+  sphere(const point3 &a, const point3 &b, const point3 &p, const point3 &q) {
+    point3 u = b - a, v = p - a, t = q - a;
+    point3 vt = cross(v, t), tu = cross(t, u), uv = cross(u, v);
+    double d = 2*dot(u, vt), uu = dot(u, u), vv = dot(v, v), tt = dot(t, t);
+    if (EQ(d, 0)) {
+      throw std::runtime_error("No circumsphere from coplanar points.");
+    }
+    c = point3(a.x + (uu*vt.x + vv*tu.x + tt*uv.x)/d,
+               a.y + (uu*vt.y + vv*tu.y + tt*uv.y)/d,
+               a.z + (uu*vt.z + vv*tu.z + tt*uv.z)/d);
+    r = sqrt(dot(a - c, a - c));
+  }
+
+  bool contains(const point3 &p) const {
+    return LE(dot(p - c, p - c), r*r);
+  }
+
+  bool on_boundary(const point3 &p) const {
+    return LE(r*r, dot(p - c, p - c));
+  }
+};
+
+template<class It>
+sphere boundary_ball(It p, const int s[], int m, sphere) {
+  switch (m) {
+    case 1: return sphere(p[s[0]], 0);
+    case 2: return sphere(p[s[0]], p[s[1]]);
+    case 3: return sphere(p[s[0]], p[s[1]], p[s[2]]);
+  }
+  return sphere(p[s[0]], p[s[1]], p[s[2]], p[s[3]]);
+}
+
+template<class It>
+sphere minimum_enclosing_sphere(It lo, It hi) {
+  if (lo == hi) {
+    return sphere();
+  }
+  std::vector<int> ord(hi - lo);
+  for (int i = 0; i < (int)ord.size(); i++) {
+    ord[i] = i;
+  }
+  std::random_shuffle(ord.begin(), ord.end());
+  int s[4], support[4], k;
+  return welzl<sphere>(lo, ord, ord.size(), s, 0, 4, support, k);
+}
+
+typedef enclosing_ball<point3, sphere, 4> enclosing_sphere;
+
 /*** Example Usage ***/
 
 #include <cassert>
-#include <vector>
+#include <cstdlib>
 using namespace std;
 
+// Brute force minimum over the candidate balls through every two and three of
+// the points which contain all of them.
+double brute_circle(const vector<point> &v) {
+  int n = v.size();
+  double best = 1e18;
+  for (int i = 0; i < n; i++) {
+    for (int j = i + 1; j < n; j++) {
+      for (int k = j; k < n; k++) {
+        circle c;
+        try {
+          c = (k == j) ? circle(v[i], v[j])
+                       : circle(v[i], v[j], v[k]);
+        } catch (const std::runtime_error &) {
+          continue;
+        }
+        bool ok = true;
+        for (int l = 0; l < n && ok; l++) {
+          ok = c.contains(v[l]);
+        }
+        if (ok) {
+          best = min(best, c.r);
+        }
+      }
+    }
+  }
+  return best;
+}
+
+double brute_sphere(const vector<point3> &v) {
+  int n = v.size();
+  double best = 1e18;
+  for (int i = 0; i < n; i++) {
+    for (int j = i + 1; j < n; j++) {
+      for (int k = j; k < n; k++) {
+        for (int l = k; l < n; l++) {
+          if (k == j && l > k) {
+            continue;
+          }
+          sphere s;
+          try {
+            if (k == j) {
+              s = sphere(v[i], v[j]);
+            } else if (l == k) {
+              s = sphere(v[i], v[j], v[k]);
+            } else {
+              s = sphere(v[i], v[j], v[k], v[l]);
+            }
+          } catch (const std::runtime_error &) {
+            continue;
+          }
+          bool ok = true;
+          for (int m = 0; m < n && ok; m++) {
+            ok = s.contains(v[m]);
+          }
+          if (ok) {
+            best = min(best, s.r);
+          }
+        }
+      }
+    }
+  }
+  return best;
+}
+
+double rnd() { return rand() % 20001 / 10000.0 - 1; }
+
 int main() {
-  vector<point> v;
-  v.push_back(point(0, 0));
-  v.push_back(point(0, 1));
-  v.push_back(point(1, 0));
-  v.push_back(point(1, 1));
-  circle res = minimum_enclosing_circle(v.begin(), v.end());
-  assert(EQ(res.h, 0.5) && EQ(res.k, 0.5) && EQ(res.r, 1/sqrt(2)));
+  {
+    vector<point> v;
+    v.push_back(point(0, 0));
+    v.push_back(point(0, 1));
+    v.push_back(point(1, 0));
+    v.push_back(point(1, 1));
+    circle res = minimum_enclosing_circle(v.begin(), v.end());
+    assert(EQ(res.h, 0.5) && EQ(res.k, 0.5) && EQ(res.r, 1/sqrt(2)));
+    assert(v[1] == point(0, 1) && v[2] == point(1, 0));
+  }
+  { // Corners of the unit cube.
+    vector<point3> v;
+    for (int i = 0; i < 8; i++) {
+      v.push_back(point3(i & 1, (i >> 1) & 1, i >> 2));
+    }
+    sphere res = minimum_enclosing_sphere(v.begin(), v.end());
+    assert(EQ(res.c.x, 0.5) && EQ(res.c.y, 0.5) && EQ(res.c.z, 0.5));
+    assert(EQ(res.r, sqrt(3)/2));
+  }
+  for (int t = 0; t < 100; t++) {  // Random sets against brute force.
+    vector<point> v;
+    vector<point3> w;
+    for (int i = 0, n = 1 + rand() % 12; i < n; i++) {
+      v.push_back(point(rnd(), rnd()));
+      w.push_back(point3(rnd(), rnd(), rnd()));
+    }
+    double r = minimum_enclosing_circle(v.begin(), v.end()).r;
+    assert(v.size() == 1 ? EQ(r, 0) : fabs(r - brute_circle(v)) < 1e-6);
+    r = minimum_enclosing_sphere(w.begin(), w.end()).r;
+    assert(w.size() == 1 ? EQ(r, 0) : fabs(r - brute_sphere(w)) < 1e-6);
+  }
+  // A sliding window over a stream, with the support set on the boundary, near
+  // the origin and then at large coordinates (where EPS is far below rounding).
+  for (int pass = 0; pass < 2; pass++) {
+    const int n = 3000, window = 100;
+    double offset = (pass == 0) ? 0 : 1e7, scale = (pass == 0) ? 1 : 3e5;
+    vector<point> v;
+    vector<point3> w;
+    enclosing_circle ec;
+    enclosing_sphere es;
+    for (int i = 0; i < n; i++) {
+      v.push_back(point(offset + scale*rnd(), offset + scale*rnd()));
+      w.push_back(point3(offset + scale*rnd(), offset + scale*rnd(),
+                         offset + scale*rnd()));
+      assert(ec.insert(v[i]) == i && es.insert(w[i]) == i);
+      if (i >= window) {
+        ec.erase(i - window);
+        es.erase(i - window);
+      }
+      int lo = max(0, i + 1 - window);
+      assert(ec.size() == i + 1 - lo && es.size() == i + 1 - lo);
+      circle c = minimum_enclosing_circle(v.begin() + lo, v.end());
+      sphere s = minimum_enclosing_sphere(w.begin() + lo, w.end());
+      assert(fabs(ec.ball().r - c.r) < 1e-6*scale);
+      assert(fabs(es.ball().r - s.r) < 1e-6*scale);
+      vector<int> sc = ec.support_set(), ss = es.support_set();
+      assert(1 <= sc.size() && sc.size() <= 3);
+      assert(1 <= ss.size() && ss.size() <= 4);
+      for (int j = 0; j < (int)sc.size(); j++) {
+        assert(lo <= sc[j] && (pass > 0 || ec.ball().on_boundary(v[sc[j]])));
+      }
+      for (int j = 0; j < (int)ss.size(); j++) {
+        assert(lo <= ss[j] && (pass > 0 || es.ball().on_boundary(w[ss[j]])));
+      }
+    }
+    for (int i = n - window; i < n; i++) {
+      ec.erase(i);
+      es.erase(i);
+    }
+    assert(ec.size() == 0 && EQ(ec.ball().r, 0) && ec.support_set().empty());
+  }
   return 0;
 }
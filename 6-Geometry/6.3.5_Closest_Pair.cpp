@@ -8,14 +8,39 @@ a divide and conquer algorithm.
   random-access iterators. The input range will be sorted lexicographically (by
   x, then by y) after the function call. If there is an answer, the closest pair
   will be stored into pointer *res.
+- closest_pair_merge(lo, hi, &res) returns the same as closest_pair(), but
+  leaves the input range unchanged. It works on a copy of the points sorted by
+  x, and each level of the recursion merges the halves sorted by y (as in merge
+  sort) instead of sorting the strip again.
+- closest_pair_grid(lo, hi, &res) returns the same as closest_pair(), leaving
+  the input range unchanged. The points are visited in random order and hashed
+  into a grid of cells whose side is the closest distance found so far, so that
+  only the 3 by 3 cells around each point must be searched. The grid is rebuilt
+  whenever the distance shrinks, which happens O(log n) times in expectation.
+  Cell indices are clamped to +/-2^62, so coordinates too large for their
+  quotient by the distance to fit in a long long still give the right answer,
+  though the far away points then share cells and slow down the search.
+- pairs_within(lo, hi, r) returns every pair of indices (i, j) with i < j into
+  the range [lo, hi) whose points are closer than r to each other, in sorted
+  order. The points are bucketed into a uniform grid of side r, and every cell
+  is compared with itself and four neighboring cells, in parallel over cells if
+  compiled with -fopenmp. The grid is indexed by the floor of each coordinate
+  divided by r, which must fit in a long long.
 
 Time Complexity:
 - O(n log^2 n) per call to closest_pair(lo, hi, &res), where n is the distance
   between lo and hi.
+- O(n log n) per call to closest_pair_merge(lo, hi, &res).
+- O(n) expected per call to closest_pair_grid(lo, hi, &res).
+- O(n log n + k) per call to pairs_within(lo, hi, r) for points that are not
+  too crowded in any cell, where k is the number of pairs found and the number
+  of pairs of points in neighboring cells is O(n + k).
 
 Space Complexity:
 - O(n log^2 n) auxiliary stack space for closest_pair(lo, hi, &res), where n is
   the distance between lo and hi.
+- O(n) auxiliary heap space for closest_pair_merge() and closest_pair_grid().
+- O(n + k) auxiliary heap space for pairs_within(lo, hi, r).
 
 */
 
@@ -23,6 +48,7 @@ Space Complexity:
 #include <cmath>
 #include <limits>
 #include <utility>
+#include <vector>
 
 const double EPS = 1e-9;
 
@@ -56,7 +82,7 @@ double closest_pair(It lo, It hi, std::pair<point, point> *res = NULL,
   mindist = std::min(mindist, d2);
   std::sort(lo, hi, cmp_y);
   int size = 0;
-  It t[hi - lo];
+  std::vector<It> t(hi - lo);
   for (It it = lo; it != hi; ++it) {
     if (fabs(it->x - midx) < mindist) {
       t[size++] = it;
@@ -80,9 +106,214 @@ double closest_pair(It lo, It hi, std::pair<point, point> *res = NULL,
   return mindist;
 }
 
+bool by_x(const point &a, const point &b) { return a.x < b.x; }
+bool by_y(const point &a, const point &b) { return a.y < b.y; }
+
+// Returns the closest distance among p[lo, hi), which must be sorted by x,
+// leaving the range sorted by y. buf must have room for hi - lo points.
+double closest_pair_merge(point *p, point *buf, int lo, int hi,
+                          double mindist, std::pair<point, point> *res) {
+  if (hi - lo <= 3) {
+    for (int i = lo; i < hi; i++) {
+      for (int j = i + 1; j < hi; j++) {
+        double d = norm(point(p[i].x - p[j].x, p[i].y - p[j].y));
+        if (d < mindist) {
+          mindist = d;
+          if (res) {
+            *res = std::make_pair(p[i], p[j]);
+          }
+        }
+      }
+    }
+    std::sort(p + lo, p + hi, by_y);
+    return mindist;
+  }
+  int mid = lo + (hi - lo)/2;
+  double midx = p[mid].x;
+  mindist = closest_pair_merge(p, buf, lo, mid, mindist, res);
+  mindist = closest_pair_merge(p, buf, mid, hi, mindist, res);
+  std::merge(p + lo, p + mid, p + mid, p + hi, buf, by_y);
+  std::copy(buf, buf + (hi - lo), p + lo);
+  int size = 0;
+  for (int i = lo; i < hi; i++) {
+    if (fabs(p[i].x - midx) < mindist) {
+      for (int j = size - 1; j >= 0 && p[i].y - buf[j].y < mindist; j--) {
+        double d = norm(point(p[i].x - buf[j].x, p[i].y - buf[j].y));
+        if (d < mindist) {
+          mindist = d;
+          if (res) {
+            *res = std::make_pair(buf[j], p[i]);
+          }
+        }
+      }
+      buf[size++] = p[i];
+    }
+  }
+  return mindist;
+}
+
+template<class It>
+double closest_pair_merge(It lo, It hi, std::pair<point, point> *res = NULL) {
+  std::vector<point> p(lo, hi), buf(p.size());
+  if (p.size() < 2) {
+    return std::numeric_limits<double>::max();
+  }
+  std::sort(p.begin(), p.end(), by_x);
+  return closest_pair_merge(&p[0], &buf[0], 0, p.size(),
+                            std::numeric_limits<double>::max(), res);
+}
+
+// A hash table from grid cells of a given side length to the points in them,
+// chaining the points of every bucket through next[]. Cells that collide in
+// the same bucket are not told apart, which only adds candidates.
+struct point_grid {
+  double side;
+  std::vector<int> head, next;
+
+  point_grid(int n, double side) : side(side), head(1), next(n, -1) {
+    while ((int)head.size() < 2*n) {
+      head.resize(2*head.size());
+    }
+    std::fill(head.begin(), head.end(), -1);
+  }
+
+  // Clamping is monotonic and keeps adjacent cells adjacent, while leaving room
+  // for the neighboring offsets of -1 and 1.
+  long long cell(double v) const {
+    double limit = 4611686018427387904.0;  // 2^62
+    return (long long)std::max(-limit, std::min(limit, floor(v / side)));
+  }
+
+  int bucket(long long cx, long long cy) const {
+    unsigned long long h = (unsigned long long)cx*0x9E3779B97F4A7C15ULL ^
+                           (unsigned long long)cy*0xC2B2AE3D27D4EB4FULL;
+    return (int)((h ^ (h >> 29)) & (head.size() - 1));
+  }
+
+  void insert(const point &p, int i) {
+    int b = bucket(cell(p.x), cell(p.y));
+    next[i] = head[b];
+    head[b] = i;
+  }
+};
+
+template<class It>
+double closest_pair_grid(It lo, It hi, std::pair<point, point> *res = NULL) {
+  int n = hi - lo;
+  if (n < 2) {
+    return std::numeric_limits<double>::max();
+  }
+  std::vector<point> p(lo, hi);
+  std::random_shuffle(p.begin(), p.end());
+  int a = 0, b = 1;
+  double mindist = norm(point(p[0].x - p[1].x, p[0].y - p[1].y));
+  point_grid g(n, mindist);
+  for (int i = 0; i < n && mindist > 0; i++) {
+    long long cx = g.cell(p[i].x), cy = g.cell(p[i].y);
+    int closest = -1;
+    double d = mindist;
+    for (long long dx = -1; dx <= 1; dx++) {
+      for (long long dy = -1; dy <= 1; dy++) {
+        for (int j = g.head[g.bucket(cx + dx, cy + dy)]; j != -1;
+             j = g.next[j]) {
+          double dj = norm(point(p[i].x - p[j].x, p[i].y - p[j].y));
+          if (dj < d) {
+            d = dj;
+            closest = j;
+          }
+        }
+      }
+    }
+    if (closest != -1) {
+      a = closest;
+      b = i;
+      mindist = d;
+      if (mindist > 0) {
+        g = point_grid(n, mindist);
+        for (int j = 0; j < i; j++) {
+          g.insert(p[j], j);
+        }
+      }
+    }
+    if (mindist > 0) {
+      g.insert(p[i], i);
+    }
+  }
+  if (res) {
+    *res = std::make_pair(p[a], p[b]);
+  }
+  return mindist;
+}
+
+// Grid cells with the index of the point in them, ordered by cell.
+typedef std::pair<std::pair<long long, long long>, int> cell_entry;
+
+template<class It>
+std::vector<std::pair<int, int> > pairs_within(It lo, It hi, double r) {
+  int n = hi - lo;
+  std::vector<cell_entry> cells(n);
+  for (int i = 0; i < n; i++) {
+    cells[i] = cell_entry(std::make_pair((long long)floor(lo[i].x / r),
+                                         (long long)floor(lo[i].y / r)), i);
+  }
+  std::sort(cells.begin(), cells.end());
+  std::vector<int> start;
+  for (int i = 0; i < n; i++) {
+    if (i == 0 || cells[i].first != cells[i - 1].first) {
+      start.push_back(i);
+    }
+  }
+  int m = start.size();
+  start.push_back(n);
+  std::vector<std::pair<int, int> > res;
+#ifdef _OPENMP
+  #pragma omp parallel
+#endif
+  {
+    std::vector<std::pair<int, int> > local;
+#ifdef _OPENMP
+    #pragma omp for schedule(dynamic, 64) nowait
+#endif
+    for (int c = 0; c < m; c++) {
+      long long cx = cells[start[c]].first.first;
+      long long cy = cells[start[c]].first.second;
+      // The cell itself, the cell above it, and the three cells to its right.
+      int from[3] = {start[c], 0, 0}, to[3] = {start[c + 1], 0, 0};
+      std::pair<long long, long long> keys[4] = {
+          std::make_pair(cx, cy + 1), std::make_pair(cx, cy + 2),
+          std::make_pair(cx + 1, cy - 1), std::make_pair(cx + 1, cy + 2)};
+      for (int k = 0; k < 2; k++) {
+        from[k + 1] = std::lower_bound(cells.begin(), cells.end(),
+            cell_entry(keys[2*k], -1)) - cells.begin();
+        to[k + 1] = std::lower_bound(cells.begin(), cells.end(),
+            cell_entry(keys[2*k + 1], -1)) - cells.begin();
+      }
+      for (int i = start[c]; i < start[c + 1]; i++) {
+        const point &p = lo[cells[i].second];
+        for (int k = 0; k < 3; k++) {
+          for (int j = (k == 0) ? i + 1 : from[k]; j < to[k]; j++) {
+            const point &q = lo[cells[j].second];
+            if ((p.x - q.x)*(p.x - q.x) + (p.y - q.y)*(p.y - q.y) < r*r) {
+              int u = cells[i].second, v = cells[j].second;
+              local.push_back(std::make_pair(std::min(u, v), std::max(u, v)));
+            }
+          }
+        }
+      }
+    }
+#ifdef _OPENMP
+    #pragma omp critical
+#endif
+    res.insert(res.end(), local.begin(), local.end());
+  }
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
 /*** Example Usage ***/
 
 #include <cassert>
+#include <cstdlib>
 #include <vector>
 using namespace std;
 
@@ -98,5 +329,43 @@ int main() {
   assert(EQ(closest_pair(v.begin(), v.end(), &res), sqrt(2)));
   assert(res.first == point(2, 3));
   assert(res.second == point(3, 4));
+
+  for (int k = 0; k < 200; k++) {
+    vector<point> v, w;
+    int n = (k < 10) ? k : rand() % 500 + 2;
+    for (int i = 0; i < n; i++) {
+      int range = (k % 2 == 0) ? 30 : 100000;
+      v.push_back(point(rand() % range - range/2, (rand() % range)*0.5));
+    }
+    double best = numeric_limits<double>::max(), r = 2.5;
+    vector<pair<int, int> > within;
+    for (int i = 0; i < n; i++) {
+      for (int j = i + 1; j < n; j++) {
+        double d = norm(point(v[i].x - v[j].x, v[i].y - v[j].y));
+        best = min(best, d);
+        if (d < r) {
+          within.push_back(make_pair(i, j));
+        }
+      }
+    }
+    w = v;
+    assert(closest_pair_merge(v.begin(), v.end(), &res) == best);
+    assert(norm(point(res.first.x - res.second.x,
+                      res.first.y - res.second.y)) == best || n < 2);
+    assert(closest_pair_grid(v.begin(), v.end(), &res) == best);
+    assert(norm(point(res.first.x - res.second.x,
+                      res.first.y - res.second.y)) == best || n < 2);
+    assert(v == w);
+    assert(pairs_within(v.begin(), v.end(), r) == within);
+    assert(EQ(closest_pair(w.begin(), w.end()), best) || n < 2);
+  }
+  // Coordinates of 1e300 divided by a distance of 1 overflow a long long.
+  v.clear();
+  v.push_back(point(1e300, -1e300));
+  v.push_back(point(0, 0));
+  v.push_back(point(-1e300, 1e300));
+  v.push_back(point(1, 0));
+  v.push_back(point(1e300, 1e300));
+  assert(closest_pair_grid(v.begin(), v.end(), &res) == 1);
   return 0;
 }
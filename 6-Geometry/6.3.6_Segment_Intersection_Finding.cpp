@@ -1,93 +1,200 @@
 /*
 
 Given a list of line segments in two dimensions, determine whether any pair of
-segments intersect using a sweep line algorithm.
+segments intersect, or report all of their intersections, using a sweep line
+algorithm.
 
 - find_intersection(lo, hi, &res1, &res2) returns whether any pair of segments
   intersect given a range [lo, hi) of segments, where lo and hi are
   random-access iterators. If there an intersection is found, then one such pair
   of segments will be stored into pointers res1 and res2. If some segments are
-  barely touching (close within EPS), then the result will depend on the setting
-  of TOUCH_IS_INTERSECT.
+  only touching (at an endpoint, or in a single point of collinear segments),
+  then the result will depend on the setting of TOUCH_IS_INTERSECT. Both the
+  ordering of segments in the sweep line and the tests for intersection use the
+  exact orient2d() predicate, so nearly parallel or nearly touching segments are
+  classified correctly.
+- all_intersections(lo, hi) returns every point at which two or more segments
+  in the range [lo, hi) meet using the Bentley-Ottmann algorithm, as a vector
+  of crossings sorted in lexicographic order of their points. Each crossing
+  stores an approximation of its point along with the sorted indices (relative
+  to lo) of all segments passing through it. Segments that touch or overlap
+  collinearly are reported at the endpoints where they meet, and segments with
+  equal endpoints are ignored. Event points are kept in a pool of exact
+  rational coordinates whose indices are ordered by the event queue, and all
+  decisions of the sweep are made by exact predicates (floating point with an
+  error bound, falling back to expansions), so the output is combinatorially
+  correct for any input.
+- grid_intersections(lo, hi, width) returns the sorted pairs of indices i < j
+  of all segments in the range [lo, hi) that intersect (as defined by
+  TOUCH_IS_INTERSECT), using a uniform grid of square cells with the given side
+  width as a broad phase. Each segment is binned into the cells covered by its
+  bounding box, and each pair is tested exactly in only the first cell common
+  to both bounding boxes. Cells are processed in parallel if compiled with
+  -fopenmp. This is preferable to the sweep for many short segments spread
+  evenly over an area, choosing the width near the typical segment length.
+- orient2d(a, b, c) returns a positive value if points a, b, and c are in
+  counter-clockwise order, a negative value if they are in clockwise order, or
+  zero if they are collinear. The sign is always exact: the determinant is
+  computed in floating point and only recomputed with exact arithmetic on
+  expansions of doubles (as described by Shewchuk) if it is too close to zero
+  for its rounding error bound.
 
 Time Complexity:
 - O(n log n) per call to find_intersection(lo, hi, &res1, &res2), where n is
   the distance between lo and hi.
+- O((n + k) log n) per call to all_intersections(lo, hi), where n is the
+  distance between lo and hi and k is the number of pairs of segments that
+  intersect.
+- O(n + c + m log m) per call to grid_intersections(lo, hi, width), where n is
+  the distance between lo and hi, m is the total number of cells covered by the
+  bounding boxes of segments, and c is the number of pairs of segments sharing
+  a cell.
 
 Space Complexity:
 - O(n) auxiliary heap space for find_intersection(lo, hi, &res1, &res2), where n
   is the distance between lo and hi.
+- O(n + k) auxiliary heap space for all_intersections(lo, hi).
+- O(m + k) auxiliary heap space for grid_intersections(lo, hi, width).
 
 */
 
 #include <algorithm>
+#include <cfloat>
 #include <cmath>
 #include <set>
 #include <utility>
+#include <vector>
 
-const double EPS = 1e-9;
+const bool TOUCH_IS_INTERSECT = true;
 
-#define EQ(a, b) (fabs((a) - (b)) <= EPS)
-#define LT(a, b) ((a) < (b) - EPS)
-#define LE(a, b) ((a) <= (b) + EPS)
+// Robust predicates after Shewchuk. Each predicate first evaluates its
+// determinant in floating point and returns it if its magnitude is above a
+// bound on the rounding error, otherwise it recomputes the determinant exactly
+// as an expansion (a sum of doubles that do not overlap in their bits, stored
+// in increasing order of magnitude) and returns its largest component.
 
-typedef std::pair<double, double> point;
-#define x first
-#define y second
+typedef std::vector<double> expansion;
 
-double sqnorm(const point &a) { return a.x*a.x + a.y*a.y; }
-double norm(const point &a) { return sqrt(sqnorm(a)); }
-double dot(const point &a, const point &b) { return a.x*b.x + a.y*b.y; }
-double cross(const point &a, const point &b, const point &o = point(0, 0)) {
-  return (a.x - o.x)*(b.y - o.y) - (a.y - o.y)*(b.x - o.x);
-}
-
-int seg_intersection(const point &a, const point &b, const point &c,
-                     const point &d, point *p = NULL, point *q = NULL) {
-  static const bool TOUCH_IS_INTERSECT = true;
-  point ab(b.x - a.x, b.y - a.y);
-  point ac(c.x - a.x, c.y - a.y);
-  point cd(d.x - c.x, d.y - c.y);
-  double c1 = cross(ab, cd), c2 = cross(ac, ab);
-  if (EQ(c1, 0) && EQ(c2, 0)) {  // Collinear.
-    double t0 = dot(ac, ab) / sqnorm(ab);
-    double t1 = t0 + dot(cd, ab) / sqnorm(ab);
-    double mint = std::min(t0, t1), maxt = std::max(t0, t1);
-    bool overlap = TOUCH_IS_INTERSECT ? (LE(mint, 1) && LE(0, maxt))
-                                      : (LT(mint, 1) && LT(0, maxt));
-    if (overlap) {
-      point res1 = std::max(std::min(a, b), std::min(c, d));
-      point res2 = std::min(std::max(a, b), std::max(c, d));
-      if (res1 == res2) {
-        if (p != NULL) {
-          *p = res1;
-        }
-        return 0;  // Collinear and meeting at an endpoint.
-      }
-      if (p != NULL && q != NULL) {
-        *p = res1;
-        *q = res2;
-      }
-      return 1;  // Collinear and overlapping.
-    } else {
-      return -1;  // Collinear and disjoint.
+const double ORIENT_BOUND = (3 + 8*DBL_EPSILON)*DBL_EPSILON/2;
+
+// Sets x + y = a + b exactly, where x is the rounded sum.
+void two_sum(double a, double b, double &x, double &y) {
+  x = a + b;
+  double bv = x - a, av = x - bv;
+  y = (a - av) + (b - bv);
+}
+
+// Sets x + y = a*b exactly, where x is the rounded product.
+void two_product(double a, double b, double &x, double &y) {
+  x = a*b;
+#ifdef __FMA__
+  y = __builtin_fma(a, b, -x);
+#else
+  static const double SPLITTER = 134217729.0;  // 2^27 + 1.
+  double c = SPLITTER*a, ah = c - (c - a), al = a - ah;
+  double d = SPLITTER*b, bh = d - (d - b), bl = b - bh;
+  y = al*bl - (((x - ah*bh) - al*bh) - ah*bl);
+#endif
+}
+
+bool abs_less(double a, double b) { return fabs(a) < fabs(b); }
+
+expansion expansion_sum(const expansion &e, const expansion &f) {
+  expansion g(e.size() + f.size()), h;
+  std::merge(e.begin(), e.end(), f.begin(), f.end(), g.begin(), abs_less);
+  double q = 0, r;
+  for (int i = 0; i < (int)g.size(); i++) {
+    two_sum(q, g[i], q, r);
+    if (r != 0) {
+      h.push_back(r);
+    }
+  }
+  if (q != 0 || h.empty()) {
+    h.push_back(q);
+  }
+  return h;
+}
+
+expansion scale_expansion(const expansion &e, double b) {
+  expansion h;
+  double q, r, hi, lo, s;
+  two_product(e[0], b, q, r);
+  if (r != 0) {
+    h.push_back(r);
+  }
+  for (int i = 1; i < (int)e.size(); i++) {
+    two_product(e[i], b, hi, lo);
+    two_sum(q, lo, s, r);
+    if (r != 0) {
+      h.push_back(r);
+    }
+    two_sum(hi, s, q, r);
+    if (r != 0) {
+      h.push_back(r);
     }
   }
-  if (EQ(c1, 0)) {
-    return -1;  // Parallel and disjoint.
+  if (q != 0 || h.empty()) {
+    h.push_back(q);
   }
-  double t = cross(ac, cd)/c1, u = c2/c1;
-  bool t_between_01 = TOUCH_IS_INTERSECT ? (LE(0, t) && LE(t, 1))
-                                         : (LT(0, t) && LT(t, 1));
-  bool u_between_01 = TOUCH_IS_INTERSECT ? (LE(0, u) && LE(u, 1))
-                                         : (LT(0, u) && LT(u, 1));
-  if (t_between_01 && u_between_01) {
-    if (p != NULL) {
-      *p = point(a.x + t*ab.x, a.y + t*ab.y);
+  return h;
+}
+
+expansion expansion_product(const expansion &e, const expansion &f) {
+  expansion res(1, 0);
+  for (int i = 0; i < (int)f.size(); i++) {
+    res = expansion_sum(res, scale_expansion(e, f[i]));
+  }
+  return res;
+}
+
+// Returns the exact difference a - b as an expansion.
+expansion expansion_diff(double a, double b) {
+  double x, y;
+  two_sum(a, -b, x, y);
+  expansion res(1, y);
+  res.push_back(x);
+  return res;
+}
+
+// Returns a positive value if a, b, and c are in counter-clockwise order, a
+// negative value if they are in clockwise order, or zero if they are collinear.
+// The magnitude approximates twice the area of the triangle.
+double orient2d(double ax, double ay, double bx, double by,
+                double cx, double cy) {
+  double left = (ax - cx)*(by - cy), right = (ay - cy)*(bx - cx);
+  double det = left - right, sum;
+  if (left > 0) {
+    if (right <= 0) {
+      return det;
     }
-    return 0;  // Non-parallel with one intersection.
+    sum = left + right;
+  } else if (left < 0) {
+    if (right >= 0) {
+      return det;
+    }
+    sum = -left - right;
+  } else {
+    return det;
+  }
+  if (fabs(det) >= ORIENT_BOUND*sum) {
+    return det;
   }
-  return -1;  // Non-parallel with no intersections.
+  double t[6][2] = {{ax, by}, {-ax, cy}, {-cx, by},
+                    {-ay, bx}, {ay, cx}, {cy, bx}};
+  expansion res(1, 0);
+  for (int i = 0; i < 6; i++) {
+    res = expansion_sum(res, scale_expansion(expansion(1, t[i][0]), t[i][1]));
+  }
+  return res.back();
+}
+
+typedef std::pair<double, double> point;
+#define x first
+#define y second
+
+int orientation(const point &a, const point &b, const point &c) {
+  double o = orient2d(a.x, a.y, b.x, b.y, c.x, c.y);
+  return (o > 0) ? 1 : ((o < 0) ? -1 : 0);
 }
 
 struct segment {
@@ -98,12 +205,12 @@ struct segment {
 
   bool operator<(const segment &rhs) const {
     if (p.x < rhs.p.x) {
-      double c = cross(q, rhs.p, p);
+      int c = orientation(q, rhs.p, p);
       if (c != 0) {
         return c > 0;
       }
     } else if (rhs.p.x < p.x) {
-      double c = cross(rhs.q, q, rhs.p);
+      int c = orientation(rhs.q, p, rhs.p);
       if (c != 0) {
         return c < 0;
       }
@@ -132,14 +239,26 @@ struct event {
   }
 };
 
+// Segments store their endpoints in lexicographic order, so collinear segments
+// overlap exactly if the greater of their first endpoints does not exceed the
+// lesser of their second endpoints.
 bool intersect(const segment &s1, const segment &s2) {
-  return seg_intersection(s1.p, s1.q, s2.p, s2.q) >= 0;
+  int o1 = orientation(s1.p, s1.q, s2.p), o2 = orientation(s1.p, s1.q, s2.q);
+  int o3 = orientation(s2.p, s2.q, s1.p), o4 = orientation(s2.p, s2.q, s1.q);
+  if (o1 == 0 && o2 == 0 && o3 == 0 && o4 == 0) {
+    point lo = std::max(s1.p, s2.p), hi = std::min(s1.q, s2.q);
+    return TOUCH_IS_INTERSECT ? !(hi < lo) : (lo < hi);
+  }
+  if (TOUCH_IS_INTERSECT) {
+    return o1*o2 <= 0 && o3*o4 <= 0;
+  }
+  return o1*o2 < 0 && o3*o4 < 0;
 }
 
 template<class It>
 bool find_intersection(It lo, It hi, segment *res1, segment *res2) {
   int cnt = 0;
-  event<It> e[2*(int)(hi - lo)];
+  std::vector<event<It> > e(2*(int)(hi - lo));
   for (It it = lo; it != hi; ++it) {
     if (it->p > it->q) {
       std::swap(it->p, it->q);
@@ -147,7 +266,7 @@ bool find_intersection(It lo, It hi, segment *res1, segment *res2) {
     e[cnt++] = event<It>(it->p, 1, it);
     e[cnt++] = event<It>(it->q, -1, it);
   }
-  std::sort(e, e + cnt);
+  std::sort(e.begin(), e.end());
   std::set<segment> s;
   std::set<segment>::iterator it, next, prev;
   for (int i = 0; i < cnt; i++) {
@@ -182,11 +301,396 @@ bool find_intersection(It lo, It hi, segment *res1, segment *res2) {
   return false;
 }
 
+// An event point of the sweep with exact rational coordinates (X/W, Y/W) for
+// an expansion W > 0, along with floating-point approximations (px, py). Event
+// points at segment endpoints have W = 1 and exact approximations, while those
+// at crossings remember the indices a and b of the two segments that produced
+// them (so that these are known to pass through the point without a test).
+struct sweep_point {
+  expansion X, Y, W;
+  double px, py;
+  bool exact;
+  int a, b;
+
+  sweep_point() {}
+  sweep_point(const point &p)
+      : X(1, p.x), Y(1, p.y), W(1, 1), px(p.x), py(p.y), exact(true), a(-1),
+        b(-1) {}
+};
+
+int sign(const expansion &e) {
+  return (e.back() > 0) ? 1 : ((e.back() < 0) ? -1 : 0);
+}
+
+double estimate(const expansion &e) {
+  double res = 0;
+  for (int i = 0; i < (int)e.size(); i++) {
+    res += e[i];
+  }
+  return res;
+}
+
+expansion expansion_sub(const expansion &e, const expansion &f) {
+  return expansion_sum(e, scale_expansion(f, -1));
+}
+
+// Returns the sign of a/w - b/v, given that w, v > 0.
+int compare_ratio(const expansion &a, const expansion &w, const expansion &b,
+                  const expansion &v) {
+  return sign(expansion_sub(expansion_product(a, v), expansion_product(b, w)));
+}
+
+// The approximations of inexact event points are within a few ulps of the
+// exact values, so coordinates that differ by far more are decided in floating
+// point and only the rest falls back to the expansions.
+int compare(const sweep_point &a, const sweep_point &b) {
+  double ex = 1e-12*(fabs(a.px) + fabs(b.px));
+  if (a.px < b.px - ex || a.px > b.px + ex || (a.exact && b.exact)) {
+    if (a.px != b.px) {
+      return (a.px < b.px) ? -1 : 1;
+    }
+  } else {
+    int c = compare_ratio(a.X, a.W, b.X, b.W);
+    if (c != 0) {
+      return c;
+    }
+  }
+  double ey = 1e-12*(fabs(a.py) + fabs(b.py));
+  if (a.py < b.py - ey || a.py > b.py + ey || (a.exact && b.exact)) {
+    return (a.py < b.py) ? -1 : ((a.py > b.py) ? 1 : 0);
+  }
+  return compare_ratio(a.Y, a.W, b.Y, b.W);
+}
+
+// Returns the orientation of point p relative to the line through segment s.
+int side(const segment &s, const sweep_point &p) {
+  if (p.exact) {
+    return orientation(s.p, s.q, point(p.px, p.py));
+  }
+  double dx = s.q.x - s.p.x, dy = s.q.y - s.p.y;
+  double det = dx*(p.py - s.p.y) - dy*(p.px - s.p.x);
+  double bound = 1e-12*(fabs(dx) + fabs(dy))*
+                 (fabs(p.px) + fabs(p.py) + fabs(s.p.x) + fabs(s.p.y));
+  if (det > bound || det < -bound) {
+    return (det > 0) ? 1 : -1;
+  }
+  expansion u = expansion_sub(p.Y, scale_expansion(p.W, s.p.y));
+  expansion v = expansion_sub(p.X, scale_expansion(p.W, s.p.x));
+  return sign(expansion_sub(
+      expansion_product(expansion_diff(s.q.x, s.p.x), u),
+      expansion_product(expansion_diff(s.q.y, s.p.y), v)));
+}
+
+// Returns the sign of the cross product of the directions of s and t.
+int turn(const segment &s, const segment &t) {
+  double dx1 = s.q.x - s.p.x, dy1 = s.q.y - s.p.y;
+  double dx2 = t.q.x - t.p.x, dy2 = t.q.y - t.p.y;
+  double det = dx1*dy2 - dy1*dx2;
+  double bound = 1e-12*(fabs(dx1) + fabs(dy1))*(fabs(dx2) + fabs(dy2));
+  if (det > bound || det < -bound) {
+    return (det > 0) ? 1 : -1;
+  }
+  return sign(expansion_sub(
+      expansion_product(expansion_diff(s.q.x, s.p.x),
+                        expansion_diff(t.q.y, t.p.y)),
+      expansion_product(expansion_diff(s.q.y, s.p.y),
+                        expansion_diff(t.q.x, t.p.x))));
+}
+
+// Returns the exact intersection point of the lines through non-parallel
+// segments s and t as p + (q - p)*T/W for s = (p, q).
+sweep_point line_intersection(const segment &s, const segment &t) {
+  expansion sx = expansion_diff(s.q.x, s.p.x);
+  expansion sy = expansion_diff(s.q.y, s.p.y);
+  expansion tx = expansion_diff(t.q.x, t.p.x);
+  expansion ty = expansion_diff(t.q.y, t.p.y);
+  expansion ux = expansion_diff(t.p.x, s.p.x);
+  expansion uy = expansion_diff(t.p.y, s.p.y);
+  sweep_point res;
+  res.W = expansion_sub(expansion_product(sx, ty), expansion_product(sy, tx));
+  expansion T = expansion_sub(expansion_product(ux, ty),
+                              expansion_product(uy, tx));
+  if (sign(res.W) < 0) {
+    res.W = scale_expansion(res.W, -1);
+    T = scale_expansion(T, -1);
+  }
+  res.X = expansion_sum(scale_expansion(res.W, s.p.x),
+                        expansion_product(sx, T));
+  res.Y = expansion_sum(scale_expansion(res.W, s.p.y),
+                        expansion_product(sy, T));
+  double w = estimate(res.W);
+  res.px = estimate(res.X) / w;
+  res.py = estimate(res.Y) / w;
+  res.exact = false;
+  return res;
+}
+
+struct crossing {
+  point p;
+  std::vector<int> segments;
+};
+
+// The Bentley-Ottmann sweep state. Event points are pooled in a vector and the
+// queue orders their indices, with the segments starting at each event chained
+// through first_start and next_start. The status holds segment indices ordered
+// along the sweep line just before the current event point, where the index -1
+// is a probe standing for the event point itself.
+struct bentley_ottmann {
+  struct event_order {
+    const bentley_ottmann *b;
+
+    event_order(const bentley_ottmann *b) : b(b) {}
+
+    bool operator()(int i, int j) const {
+      return compare(b->pool[i], b->pool[j]) < 0;
+    }
+  };
+
+  struct status_order {
+    const bentley_ottmann *b;
+
+    status_order(const bentley_ottmann *b) : b(b) {}
+
+    // Segments through the current event point go below those passing above
+    // it, and are ordered among themselves by their direction past the point.
+    bool operator()(int i, int j) const {
+      if (i == j) {
+        return false;
+      }
+      if (i < 0) {
+        return b->locate(j) < 0;
+      }
+      if (j < 0) {
+        return b->locate(i) > 0;
+      }
+      int si = b->locate(i), sj = b->locate(j);
+      if (si == 0 && sj == 0) {
+        int c = turn(b->seg[i], b->seg[j]);
+        return (c != 0) ? (c > 0) : (i < j);
+      }
+      if (si == 0) {
+        return sj < 0;
+      }
+      if (sj == 0) {
+        return si > 0;
+      }
+      return orientation(b->seg[j].p, b->seg[j].q, b->seg[i].p) < 0;
+    }
+  };
+
+  std::vector<segment> seg;
+  std::vector<sweep_point> pool;
+  std::vector<int> first_start, next_start, end_event, mark;
+  int current;
+  std::set<int, event_order> queue;
+  std::set<int, status_order> status;
+  std::set<std::pair<int, int> > scheduled;
+
+  bentley_ottmann(const std::vector<segment> &seg)
+      : seg(seg), next_start(seg.size()), end_event(seg.size()),
+        mark(seg.size(), -1), current(-1),
+        queue(event_order(this)), status(status_order(this)) {
+    for (int i = 0; i < (int)seg.size(); i++) {
+      if (seg[i].p == seg[i].q) {
+        continue;
+      }
+      int e = add_event(sweep_point(seg[i].p));
+      next_start[i] = first_start[e];
+      first_start[e] = i;
+      end_event[i] = add_event(sweep_point(seg[i].q));
+    }
+  }
+
+  int add_event(const sweep_point &p) {
+    pool.push_back(p);
+    first_start.push_back(-1);
+    std::pair<std::set<int, event_order>::iterator, bool> res =
+        queue.insert((int)pool.size() - 1);
+    if (!res.second) {
+      pool.pop_back();
+      first_start.pop_back();
+    }
+    return *res.first;
+  }
+
+  // Returns the side of the current event point relative to segment i, where
+  // segments marked at the current event are known to pass through it.
+  int locate(int i) const {
+    const sweep_point &p = pool[current];
+    if (mark[i] == current || i == p.a || i == p.b) {
+      return 0;
+    }
+    return side(seg[i], p);
+  }
+
+  // Schedules the crossing of segments i and j if it lies past the current
+  // event point and has not been scheduled before.
+  void check(int i, int j) {
+    if (i > j) {
+      std::swap(i, j);
+    }
+    if (scheduled.count(std::make_pair(i, j))) {
+      return;
+    }
+    const segment &s = seg[i], &t = seg[j];
+    int o1 = orientation(s.p, s.q, t.p), o2 = orientation(s.p, s.q, t.q);
+    int o3 = orientation(t.p, t.q, s.p), o4 = orientation(t.p, t.q, s.q);
+    if (o1*o2 > 0 || o3*o4 > 0 || (o1 == 0 && o2 == 0)) {
+      return;
+    }
+    sweep_point p = line_intersection(s, t);
+    if (compare(pool[current], p) < 0) {
+      p.a = i;
+      p.b = j;
+      add_event(p);
+      scheduled.insert(std::make_pair(i, j));
+    }
+  }
+
+  void run(std::vector<crossing> *res) {
+    typedef std::set<int, status_order>::iterator iter;
+    while (!queue.empty()) {
+      current = *queue.begin();
+      queue.erase(queue.begin());
+      std::pair<iter, iter> r = status.equal_range(-1);
+      std::vector<int> through, keep;
+      for (iter it = r.first; it != r.second; ++it) {
+        through.push_back(*it);
+        if (end_event[*it] != current) {
+          keep.push_back(*it);
+        }
+      }
+      for (int i = first_start[current]; i != -1; i = next_start[i]) {
+        through.push_back(i);
+        keep.push_back(i);
+      }
+      for (int i = 0; i < (int)keep.size(); i++) {
+        mark[keep[i]] = current;
+      }
+      if (through.size() > 1) {
+        crossing c;
+        c.p = point(pool[current].px, pool[current].py);
+        c.segments = through;
+        std::sort(c.segments.begin(), c.segments.end());
+        res->push_back(c);
+      }
+      status.erase(r.first, r.second);
+      for (int i = 0; i < (int)keep.size(); i++) {
+        status.insert(keep[i]);
+      }
+      if (keep.empty()) {
+        iter above = status.lower_bound(-1), below = above;
+        if (above != status.begin() && above != status.end()) {
+          check(*--below, *above);
+        }
+      } else {
+        r = status.equal_range(-1);
+        iter below = r.first, above = r.second;
+        if (below != status.begin()) {
+          --below;
+          check(*below, *r.first);
+        }
+        if (above != status.end()) {
+          check(*--r.second, *above);
+        }
+      }
+    }
+  }
+};
+
+template<class It>
+std::vector<crossing> all_intersections(It lo, It hi) {
+  std::vector<segment> seg;
+  for (It it = lo; it != hi; ++it) {
+    seg.push_back(segment(it->p, it->q));
+  }
+  std::vector<crossing> res;
+  bentley_ottmann(seg).run(&res);
+  return res;
+}
+
+typedef std::pair<std::pair<long long, long long>, int> cell_entry;
+
+template<class It>
+std::vector<std::pair<int, int> > grid_intersections(It lo, It hi,
+                                                     double width) {
+  int n = hi - lo;
+  std::vector<segment> seg;
+  std::vector<long long> x0(n), y0(n);
+  std::vector<cell_entry> cells;
+  for (It it = lo; it != hi; ++it) {
+    segment s(it->p, it->q);
+    int i = seg.size();
+    seg.push_back(s);
+    x0[i] = (long long)floor(s.p.x / width);
+    long long x1 = (long long)floor(s.q.x / width);
+    y0[i] = (long long)floor(std::min(s.p.y, s.q.y) / width);
+    long long y1 = (long long)floor(std::max(s.p.y, s.q.y) / width);
+    for (long long cx = x0[i]; cx <= x1; cx++) {
+      for (long long cy = y0[i]; cy <= y1; cy++) {
+        cells.push_back(cell_entry(std::make_pair(cx, cy), i));
+      }
+    }
+  }
+  std::sort(cells.begin(), cells.end());
+  std::vector<int> start;
+  for (int i = 0; i < (int)cells.size(); i++) {
+    if (i == 0 || cells[i].first != cells[i - 1].first) {
+      start.push_back(i);
+    }
+  }
+  start.push_back(cells.size());
+  std::vector<std::pair<int, int> > res;
+  int m = (int)start.size() - 1;
+#ifdef _OPENMP
+  #pragma omp parallel
+#endif
+  {
+    std::vector<std::pair<int, int> > local;
+#ifdef _OPENMP
+    #pragma omp for schedule(dynamic, 64) nowait
+#endif
+    for (int c = 0; c < m; c++) {
+      std::pair<long long, long long> cell = cells[start[c]].first;
+      for (int a = start[c]; a < start[c + 1]; a++) {
+        for (int b = a + 1; b < start[c + 1]; b++) {
+          int i = cells[a].second, j = cells[b].second;
+          if (std::max(x0[i], x0[j]) == cell.first &&
+              std::max(y0[i], y0[j]) == cell.second &&
+              intersect(seg[i], seg[j])) {
+            local.push_back(std::make_pair(std::min(i, j), std::max(i, j)));
+          }
+        }
+      }
+    }
+#ifdef _OPENMP
+    #pragma omp critical
+#endif
+    res.insert(res.end(), local.begin(), local.end());
+  }
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
 /*** Example Usage ***/
 
+#include <cassert>
+#include <cstdlib>
+#include <set>
 #include <vector>
 using namespace std;
 
+bool brute_force(const vector<segment> &v) {
+  for (int i = 0; i < (int)v.size(); i++) {
+    for (int j = i + 1; j < (int)v.size(); j++) {
+      if (intersect(v[i], v[j])) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 int main() {
   vector<segment> v;
   v.push_back(segment(point(0, 0), point(2, 2)));
@@ -197,5 +701,76 @@ int main() {
   assert(find_intersection(v.begin(), v.end(), &res1, &res2));
   assert(res1.p == point(0, 0) && res1.q == point(2, 2));
   assert(res2.p == point(0, 2) && res2.q == point(2, -2));
+
+  // Parallel segments 1e-12 apart, and a segment ending 1e-15 short of another.
+  v.clear();
+  v.push_back(segment(point(0, 0), point(1, 0)));
+  v.push_back(segment(point(0, 1e-12), point(1, 1e-12)));
+  v.push_back(segment(point(0.5, 1), point(0.5, 1e-12 + 1e-15)));
+  assert(!find_intersection(v.begin(), v.end(), &res1, &res2));
+  v.push_back(segment(point(0.5, 1), point(0.5, 1e-12)));
+  assert(find_intersection(v.begin(), v.end(), &res1, &res2));
+  assert(res1.p == point(0, 1e-12) && res2.q == point(0.5, 1));
+
+  for (int k = 0; k < 2000; k++) {
+    v.clear();
+    for (int i = 0; i < k % 7 + 2; i++) {
+      double a = rand() % 20, b = rand() % 20, c = rand() % 20, d = rand() % 20;
+      v.push_back(segment(point(a*0.1, b*0.3), point(c*0.1, d*0.3)));
+    }
+    bool found = find_intersection(v.begin(), v.end(), &res1, &res2);
+    assert(found == brute_force(v));
+    assert(!found || intersect(res1, res2));
+  }
+
+  // Every pair of segments through a reported point intersects, and the
+  // reported points cover exactly the intersecting pairs (as found by brute
+  // force), including touching and overlapping collinear segments.
+  for (int k = 0; k < 300; k++) {
+    v.clear();
+    for (int i = 0; i < k % 40 + 2; i++) {
+      double a = rand() % 10, b = rand() % 10, c = rand() % 10, d = rand() % 10;
+      if (a != c || b != d) {
+        v.push_back(segment(point(a*0.1, b*0.3), point(c*0.1, d*0.3)));
+      }
+    }
+    vector<crossing> cr = all_intersections(v.begin(), v.end());
+    set<pair<int, int> > pairs;
+    for (int i = 0; i < (int)cr.size(); i++) {
+      if (i > 0) {
+        assert(cr[i - 1].p.x < cr[i].p.x + 1e-9);
+      }
+      const vector<int> &s = cr[i].segments;
+      for (int a = 0; a < (int)s.size(); a++) {
+        const segment &t = v[s[a]];
+        double d = fabs((t.q.x - t.p.x)*(cr[i].p.y - t.p.y) -
+                        (t.q.y - t.p.y)*(cr[i].p.x - t.p.x));
+        assert(d < 1e-9);
+        for (int b = a + 1; b < (int)s.size(); b++) {
+          pairs.insert(make_pair(s[a], s[b]));
+        }
+      }
+    }
+    vector<pair<int, int> > expected;
+    for (int i = 0; i < (int)v.size(); i++) {
+      for (int j = i + 1; j < (int)v.size(); j++) {
+        if (intersect(v[i], v[j])) {
+          expected.push_back(make_pair(i, j));
+        }
+      }
+    }
+    vector<pair<int, int> > found(pairs.begin(), pairs.end());
+    assert(found == expected);
+    assert(grid_intersections(v.begin(), v.end(), 0.25) == expected);
+  }
+
+  // Many crossings through a single point (the origin) are reported once.
+  v.clear();
+  for (int i = 1; i <= 10; i++) {
+    v.push_back(segment(point(-i, -1), point(i, 1)));
+  }
+  vector<crossing> cr = all_intersections(v.begin(), v.end());
+  assert(cr.size() == 1 && cr[0].p == point(0, 0));
+  assert(cr[0].segments.size() == 10);
   return 0;
 }
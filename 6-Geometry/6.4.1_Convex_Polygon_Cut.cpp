@@ -2,24 +2,43 @@
 
 Given a convex polygon (a polygon such that every line crossing through it will
 only do so once) in two dimensions, and two points specifying an infinite line,
-cut off the right part of the polygon, and return the resulting left part.
+cut off the right part of the polygon, and return the resulting left part. Also
+compute the intersection of many such left half-planes at once.
 
 - convex_cut(lo, hi, p, q) returns the points of the left side of a polygon, in
   clockwise order, after it has been cut by the line containing points p and q.
   The original convex polygon is given by the range [lo, hi) of points in
   clockwise order, where lo and hi must be random-access iterators.
+- convex_cut(lo, hi, p, q, res) stores the same cut into res instead, reusing
+  its storage. The range [lo, hi) must not lie inside res, so repeated cuts
+  should alternate between two vectors.
+- half_plane_intersector::intersect(lo, hi, res) stores into res the vertices,
+  in counter-clockwise order, of the intersection of the left half-planes of
+  the directed lines in the range [lo, hi) of std::pair<point, point>, and
+  returns whether the intersection has positive area. The intersection must be
+  bounded if it is non-empty (add the four sides of a bounding box otherwise).
+  The intersector keeps its working buffers between calls, so that one object
+  intersecting many sets of half-planes does not allocate in the steady state.
+- half_plane_intersection(lo, hi) returns the same intersection as a vector.
 
 Time Complexity:
-- O(n) per call to convex_cut(lo, hi, p, q), where n is the distance between lo
-  and hi.
+- O(n) per call to convex_cut(lo, hi, p, q) and convex_cut(lo, hi, p, q, res),
+  where n is the distance between lo and hi.
+- O(m log m) per call to intersect(lo, hi, res) and half_plane_intersection(lo,
+  hi), where m is the distance between lo and hi. Repeatedly applying
+  convex_cut() to the same half-planes would instead take O(m^2).
 
 Space Complexity:
 - O(n) auxiliary for storage of the resulting convex cut.
+- O(m) auxiliary heap space for intersect(lo, hi, res), retained by the
+  intersector between calls.
 
 */
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <stdexcept>
 #include <utility>
 #include <vector>
 
@@ -60,11 +79,15 @@ int line_intersection(const point &p1, const point &p2,
 }
 
 template<class It>
-std::vector<point> convex_cut(It lo, It hi, const point &p, const point &q) {
+void convex_cut(It lo, It hi, const point &p, const point &q,
+                std::vector<point> &res) {
   if (EQ(p.x, q.x) && EQ(p.y, q.y)) {
     throw std::runtime_error("Cannot cut using line from identical points.");
   }
-  std::vector<point> res;
+  res.clear();
+  if (lo == hi) {
+    return;
+  }
   for (It i = lo, j = hi - 1; i != hi; j = i++) {
     int d1 = turn(q, p, *j), d2 = turn(q, p, *i);
     if (d1 >= 0) {
@@ -76,14 +99,135 @@ std::vector<point> convex_cut(It lo, It hi, const point &p, const point &q) {
       res.push_back(r);
     }
   }
+}
+
+template<class It>
+std::vector<point> convex_cut(It lo, It hi, const point &p, const point &q) {
+  std::vector<point> res;
+  convex_cut(lo, hi, p, q, res);
+  return res;
+}
+
+class half_plane_intersector {
+  struct half_plane {
+    point p, d;  // The boundary is p + t*d, with the kept side on the left.
+    double angle;
+
+    bool operator<(const half_plane &h) const { return angle < h.angle; }
+
+    bool out(const point &r) const {
+      return LT(cross(d, point(r.x - p.x, r.y - p.y)), 0);
+    }
+  };
+
+  std::vector<half_plane> h;
+  std::vector<int> dq;
+
+  static double norm(const point &d) { return sqrt(d.x*d.x + d.y*d.y); }
+
+  static point meet(const half_plane &a, const half_plane &b) {
+    double t = cross(point(b.p.x - a.p.x, b.p.y - a.p.y), b.d) /
+               cross(a.d, b.d);
+    return point(a.p.x + t*a.d.x, a.p.y + t*a.d.y);
+  }
+
+ public:
+  template<class It>
+  bool intersect(It lo, It hi, std::vector<point> &res) {
+    res.clear();
+    h.clear();
+    for (; lo != hi; ++lo) {
+      half_plane hp;
+      hp.p = lo->first;
+      hp.d = point(lo->second.x - lo->first.x, lo->second.y - lo->first.y);
+      if (EQ(hp.d.x, 0) && EQ(hp.d.y, 0)) {
+        throw std::runtime_error("Cannot cut using line from identical "
+                                 "points.");
+      }
+      hp.angle = atan2(hp.d.y, hp.d.x);
+      h.push_back(hp);
+    }
+    std::sort(h.begin(), h.end());
+    dq.resize(h.size());
+    // The deque is dq[head, tail). Every half-plane is pushed at most once,
+    // so the back never runs past the end of the buffer.
+    int head = 0, tail = 0;
+    for (int i = 0; i < (int)h.size(); i++) {
+      const half_plane &c = h[i];
+      while (tail - head > 1 && c.out(meet(h[dq[tail - 1]], h[dq[tail - 2]]))) {
+        tail--;
+      }
+      while (tail - head > 1 && c.out(meet(h[dq[head]], h[dq[head + 1]]))) {
+        head++;
+      }
+      if (tail > head) {
+        const half_plane &b = h[dq[tail - 1]];
+        if (fabs(cross(c.d, b.d)) <= EPS*norm(c.d)*norm(b.d)) {
+          if (c.d.x*b.d.x + c.d.y*b.d.y < 0) {
+            return false;
+          }
+          if (!c.out(b.p)) {
+            continue;  // The earlier parallel half-plane is tighter.
+          }
+          tail--;
+        }
+      }
+      dq[tail++] = i;
+    }
+    while (tail - head > 2 &&
+           h[dq[head]].out(meet(h[dq[tail - 1]], h[dq[tail - 2]]))) {
+      tail--;
+    }
+    while (tail - head > 2 &&
+           h[dq[tail - 1]].out(meet(h[dq[head]], h[dq[head + 1]]))) {
+      head++;
+    }
+    if (tail - head < 3) {
+      return false;
+    }
+    for (int i = head; i < tail; i++) {
+      point r = meet(h[dq[i]], h[dq[i + 1 < tail ? i + 1 : head]]);
+      if (res.empty() || !EQ(r.x, res.back().x) || !EQ(r.y, res.back().y)) {
+        res.push_back(r);
+      }
+    }
+    while (res.size() > 1 && EQ(res[0].x, res.back().x) &&
+           EQ(res[0].y, res.back().y)) {
+      res.pop_back();
+    }
+    if (res.size() < 3) {
+      res.clear();
+      return false;
+    }
+    return true;
+  }
+};
+
+template<class It>
+std::vector<point> half_plane_intersection(It lo, It hi) {
+  std::vector<point> res;
+  half_plane_intersector().intersect(lo, hi, res);
   return res;
 }
 
 /*** Example Usage ***/
 
 #include <cassert>
+#include <cstdlib>
 using namespace std;
 
+double area(const vector<point> &v) {
+  double a = 0;
+  for (int i = 0, j = (int)v.size() - 1; i < (int)v.size(); j = i++) {
+    a += cross(v[j], v[i]);
+  }
+  return a / 2;
+}
+
+double rand_coord() {
+  return rand() % 20001 / 1000.0 - 10;
+}
+
 int main() {
   {
     vector<point> v;
@@ -98,6 +242,9 @@ int main() {
     c.push_back(point(0, 3));
     c.push_back(point(0, 0));
     assert(convex_cut(v.begin(), v.end(), point(0, 0), point(0, 1)) == c);
+    vector<point> res(10, point(5, 5));
+    convex_cut(v.begin(), v.end(), point(0, 0), point(0, 1), res);
+    assert(res == c);
   }
   { // On a non-convex input, the result may be multiple disjoint polygons!
     vector<point> v;
@@ -115,5 +262,65 @@ int main() {
     c.push_back(point(1, 4));
     assert(convex_cut(v.begin(), v.end(), point(1, 0), point(1, 4)) == c);
   }
+  {
+    typedef pair<point, point> line;
+    vector<line> l;
+    l.push_back(line(point(2, 0), point(2, 1)));  // x <= 2
+    l.push_back(line(point(0, 3), point(-1, 3)));  // y <= 3
+    l.push_back(line(point(0, 0), point(1, 0)));  // y >= 0
+    l.push_back(line(point(5, 5), point(5, 6)));  // x <= 5 (redundant)
+    l.push_back(line(point(0, 1), point(0, 0)));  // x >= 0
+    l.push_back(line(point(0, -1), point(1, -1)));  // y >= -1 (redundant)
+    vector<point> res = half_plane_intersection(l.begin(), l.end());
+    assert(res.size() == 4);
+    assert(EQ(area(res), 6));
+    for (int i = 0; i < 4; i++) {
+      assert(EQ(res[i].x, 0) || EQ(res[i].x, 2));
+      assert(EQ(res[i].y, 0) || EQ(res[i].y, 3));
+    }
+    // Cutting the left part off leaves an empty intersection.
+    l.push_back(line(point(1, 1), point(1, 0)));
+    l.push_back(line(point(-1, 0), point(-1, 1)));
+    assert(half_plane_intersection(l.begin(), l.end()).empty());
+    half_plane_intersector hpi;
+    assert(!hpi.intersect(l.begin(), l.end(), res) && res.empty());
+    l.pop_back();
+    assert(hpi.intersect(l.begin(), l.end(), res) && EQ(area(res), 3));
+  }
+  { // Compare against repeatedly cutting a bounding box.
+    typedef pair<point, point> line;
+    half_plane_intersector hpi;
+    vector<point> res, a, b;
+    for (int t = 0; t < 300; t++) {
+      vector<line> l;
+      a.clear();
+      a.push_back(point(-10, -10));
+      a.push_back(point(10, -10));
+      a.push_back(point(10, 10));
+      a.push_back(point(-10, 10));
+      for (int i = 0; i < 4; i++) {
+        l.push_back(line(a[i], a[(i + 1) % 4]));
+      }
+      int m = rand() % 30;
+      for (int i = 0; i < m; i++) {
+        point p(rand_coord() / 2, rand_coord() / 2);
+        point q(rand_coord(), rand_coord());
+        if (EQ(p.x, q.x) && EQ(p.y, q.y)) {
+          continue;
+        }
+        l.push_back(line(p, q));
+        convex_cut(a.begin(), a.end(), p, q, b);
+        a.swap(b);
+      }
+      bool nonempty = hpi.intersect(l.begin(), l.end(), res);
+      assert(fabs(area(res) - fabs(area(a))) < 1e-6);
+      assert(nonempty == (area(res) > 1e-6));
+      for (int i = 0; i < (int)res.size(); i++) {
+        for (int j = 0; j < (int)l.size(); j++) {
+          assert(cross(l[j].second, res[i], l[j].first) > -1e-6);
+        }
+      }
+    }
+  }
   return 0;
 }
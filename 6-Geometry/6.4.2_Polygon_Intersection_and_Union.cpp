@@ -1,7 +1,9 @@
 /*
 
 Given two polygons, determine the areas of their intersection and union using a
-sweep line algorithm and the inclusion-exclusion principle.
+sweep line algorithm and the inclusion-exclusion principle. Alternatively, clip
+regions bounded by any number of contours against each other to compute the
+contours of their intersection, union, difference, or exclusive or.
 
 - intersection_area(lo1, hi1, lo2, hi2) returns the intersection area of two
   polygons respectively specified by two ranges [lo1, hi1) and [lo2, hi2) of
@@ -10,21 +12,50 @@ sweep line algorithm and the inclusion-exclusion principle.
 - union_area(lo1, hi1, lo2, hi2) returns the union area of two polygons
   respectively specified by two ranges [lo1, hi1) and [lo2, hi2) of vertices in
   clockwise order, where lo1, hi1, lo2, and hi2 must be random-access iterators.
+- polygon_boolean(a, b, op) returns the region resulting from applying op (one
+  of INTERSECTION, UNION, DIFFERENCE, or XOR) to regions a and b, where each
+  region is a vector of contours (vectors of vertices in either order) that
+  encloses the points inside an odd number of them. The result consists of
+  contours that only touch at vertices, ordered counter-clockwise around outer
+  boundaries and clockwise around holes. The Martinez-Rueda-Feito algorithm is
+  used: a sweep over the edges of both regions splits them at intersections and
+  determines from the edges below each one whether it lies inside the other
+  region, keeping only those bounding the result. These are then chained into
+  contours, where walks leave each vertex by the first edge clockwise from the
+  one they arrived by so as to separate contours touching at the vertex.
+  Vertex coordinates within EPS of one another are first snapped together.
+- union_all(p) returns the union of a vector of regions p as above. Regions are
+  sorted along a Z-order curve and then merged in pairs up a balanced tree, with
+  pairs at each level merged in parallel if compiled with -fopenmp. Contours of
+  either side of a merge whose bounding box misses that of the other side are
+  passed through without being swept again, so that the bulk of the contours
+  of far apart regions do not take part in the larger merges.
+- region_area(v) returns the area of a region produced by one of the above.
 
 Time Complexity:
 - O(n^2 log n) per call to intersection_area(lo1, hi1, lo2, hi2) and
   union_area(lo1, hi1, lo2, hi2) where n is the sum of distances between lo1 and
   hi1 and lo2 and hi2 respectively.
+- O((n + k) log n) per call to polygon_boolean(a, b, op), where n is the total
+  number of vertices in a and b and k is the number of intersections between
+  their edges.
+- O((n + k) log^2 n) per call to union_all(p) in the worst case, where n is the
+  total number of vertices and k is the number of intersections of edges.
 
 Space Complexity:
 - O(n) auxiliary heap space for intersection_area(lo1, hi1, lo2, hi2) and
   union_area(lo1, hi1, lo2, hi2), where n is the sum of distances between lo1
   and hi1 and lo2 and hi2 respectively.
+- O(n + k) auxiliary heap space for polygon_boolean(a, b, op) and union_all(p).
 
 */
 
 #include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <deque>
+#include <map>
+#include <queue>
 #include <set>
 #include <utility>
 #include <vector>
@@ -205,11 +236,601 @@ double union_area(It lo1, It hi1, It lo2, It hi2) {
          intersection_area(lo1, hi1, lo2, hi2);
 }
 
+// Polygon clipping by the Martinez-Rueda-Feito sweep. A region is given as a
+// set of contours with the even-odd rule, and the sweep splits edges at their
+// intersections, keeps the edges bounding the result, and joins them back up.
+
+enum boolean_op { INTERSECTION, UNION, DIFFERENCE, XOR };
+enum edge_type {
+  NORMAL, NON_CONTRIBUTING, SAME_TRANSITION, DIFFERENT_TRANSITION
+};
+
+typedef std::vector<point> contour;
+
+int orientation(const point &a, const point &b, const point &c) {
+  double d = cross(a, b, c);
+  return EQ(d, 0) ? 0 : (d > 0 ? 1 : -1);
+}
+
+struct sweep_event;
+
+struct segment_order {
+  bool operator()(const sweep_event *a, const sweep_event *b) const;
+};
+
+// Each edge has a left event at its lexicographically smaller endpoint and a
+// right event at the other, pointing to each other through other. For left
+// events, in_out and other_in_out store whether a vertical ray going upwards
+// from below respectively leaves the edge's own polygon and leaves the other
+// polygon when crossing the edge or the nearest edge of the other polygon
+// below it.
+struct sweep_event {
+  point p;
+  bool left;
+  int pol, id;
+  sweep_event *other;
+  edge_type type;
+  bool in_out, other_in_out, in_result;
+  int pos;
+  std::set<sweep_event*, segment_order>::iterator it;
+
+  sweep_event(const point &p, bool left, int pol, int id, sweep_event *other,
+              edge_type type = NORMAL)
+      : p(p), left(left), pol(pol), id(id), other(other), type(type),
+        in_out(false), other_in_out(false), in_result(false), pos(0) {}
+
+  bool below(const point &q) const {
+    return left ? orientation(p, other->p, q) > 0
+                : orientation(other->p, p, q) > 0;
+  }
+
+  bool above(const point &q) const { return !below(q); }
+  bool vertical() const { return p.x == other->p.x; }
+};
+
+// Returns whether event e1 is processed after event e2. Events are processed
+// in lexicographic order of points, with right events before left events and
+// events of lower edges first at the same point.
+struct event_after {
+  bool operator()(const sweep_event *e1, const sweep_event *e2) const {
+    if (e1->p.x != e2->p.x) {
+      return e1->p.x > e2->p.x;
+    }
+    if (e1->p.y != e2->p.y) {
+      return e1->p.y > e2->p.y;
+    }
+    if (e1->left != e2->left) {
+      return e1->left;
+    }
+    if (orientation(e1->p, e1->other->p, e2->other->p) != 0) {
+      return e1->above(e2->other->p);
+    }
+    return (e1->pol != e2->pol) ? (e1->pol > e2->pol) : (e1->id > e2->id);
+  }
+};
+
+struct event_before {
+  bool operator()(const sweep_event *e1, const sweep_event *e2) const {
+    return event_after()(e2, e1);
+  }
+};
+
+// Returns whether the edge of left event e1 lies below that of e2 in the sweep.
+bool segment_order::operator()(const sweep_event *e1,
+                               const sweep_event *e2) const {
+  if (e1 == e2) {
+    return false;
+  }
+  if (orientation(e1->p, e1->other->p, e2->p) != 0 ||
+      orientation(e1->p, e1->other->p, e2->other->p) != 0) {
+    if (e1->p == e2->p) {
+      return e1->below(e2->other->p);
+    }
+    if (e1->p.x == e2->p.x) {
+      return e1->p.y < e2->p.y;
+    }
+    // Compare the left endpoint of the later edge against the earlier edge,
+    // or its right endpoint if the later edge starts on the earlier one.
+    bool later = event_after()(e1, e2);
+    const sweep_event *a = later ? e2 : e1, *b = later ? e1 : e2;
+    int o = orientation(a->p, a->other->p, b->p);
+    if (o == 0) {
+      o = orientation(a->p, a->other->p, b->other->p);
+    }
+    return later ? (o < 0) : (o > 0);
+  }
+  if (e1->pol != e2->pol) {
+    return e1->pol < e2->pol;
+  }
+  if (e1->p == e2->p) {
+    return e1->id < e2->id;
+  }
+  return event_after()(e1, e2);
+}
+
+class boolean_sweep {
+  typedef std::set<sweep_event*, segment_order>::iterator iter;
+
+  boolean_op op;
+  std::deque<sweep_event> pool;
+  std::priority_queue<sweep_event*, std::vector<sweep_event*>, event_after>
+      events;
+  std::set<sweep_event*, segment_order> status;
+  std::vector<sweep_event*> processed;
+
+  sweep_event* new_event(const point &p, bool left, int pol,
+                         sweep_event *other, edge_type type = NORMAL) {
+    pool.push_back(sweep_event(p, left, pol, pool.size(), other, type));
+    return &pool.back();
+  }
+
+  // Returns the first coordinate seen within EPS of v, or else v itself.
+  // Intersections computed in earlier calls to polygon_boolean() can differ in
+  // their last bits, and vertices a hair to the left of an edge which should
+  // pass through them would otherwise be swept before the edge begins.
+  static double snap(std::set<double> &seen, double v) {
+    std::set<double>::iterator it = seen.lower_bound(v - EPS);
+    if (it != seen.end() && LE(*it, v + EPS)) {
+      return *it;
+    }
+    seen.insert(v);
+    return v;
+  }
+
+  void add_edge(const point &a, const point &b, int pol) {
+    if (a == b) {
+      return;
+    }
+    sweep_event *e1 = new_event(a, true, pol, NULL);
+    sweep_event *e2 = new_event(b, true, pol, e1);
+    e1->other = e2;
+    (a < b ? e2 : e1)->left = false;
+    events.push(e1);
+    events.push(e2);
+  }
+
+  bool in_result(const sweep_event *e) const {
+    switch (e->type) {
+      case NORMAL:
+        switch (op) {
+          case INTERSECTION: return !e->other_in_out;
+          case UNION: return e->other_in_out;
+          case DIFFERENCE: return (e->pol == 0) == e->other_in_out;
+          case XOR: return true;
+        }
+        break;
+      case SAME_TRANSITION: return op == INTERSECTION || op == UNION;
+      case DIFFERENT_TRANSITION: return op == DIFFERENCE;
+      case NON_CONTRIBUTING: return false;
+    }
+    return false;
+  }
+
+  // Returns whether the region just above the edge of left event e is part of
+  // the result, which decides whether a contour is an outer boundary or a hole.
+  bool above_in_result(const sweep_event *e) const {
+    bool own = !e->in_out, other = !e->other_in_out;
+    if (e->type == SAME_TRANSITION) {
+      other = own;
+    } else if (e->type == DIFFERENT_TRANSITION) {
+      other = !own;
+    }
+    bool a = (e->pol == 0) ? own : other, b = (e->pol == 0) ? other : own;
+    switch (op) {
+      case INTERSECTION: return a && b;
+      case UNION: return a || b;
+      case DIFFERENCE: return a && !b;
+      case XOR: return a != b;
+    }
+    return false;
+  }
+
+  void compute_fields(sweep_event *e, iter prev) {
+    if (prev == status.end()) {
+      e->in_out = false;
+      e->other_in_out = true;
+    } else if (e->pol == (*prev)->pol) {
+      e->in_out = !(*prev)->in_out;
+      e->other_in_out = (*prev)->other_in_out;
+    } else {
+      e->in_out = !(*prev)->other_in_out;
+      e->other_in_out = (*prev)->vertical() ? !(*prev)->in_out
+                                            : (*prev)->in_out;
+    }
+    e->in_result = in_result(e);
+  }
+
+  void divide(sweep_event *e, const point &p) {
+    sweep_event *r = new_event(p, false, e->pol, e);
+    sweep_event *l = new_event(p, true, e->pol, e->other);
+    if (event_after()(l, e->other)) {  // The split point rounded past the end.
+      e->other->left = true;
+      l->left = false;
+    }
+    e->other->other = l;
+    e->other = r;
+    events.push(l);
+    events.push(r);
+  }
+
+  // Splits the edges of left events e1 and e2 where they intersect, returning
+  // 2 if the edges overlap from a common left endpoint (so that their fields
+  // must be recomputed) or any other nonzero value if they intersect at all.
+  int possible_intersection(sweep_event *e1, sweep_event *e2) {
+    point p, r;
+    int res = seg_intersection(e1->p, e1->other->p, e2->p, e2->other->p, &p,
+                               &r);
+    if (res < 0) {
+      return 0;
+    }
+    if (res == 0) {
+      // Snap the intersection to an endpoint it is within EPS of, and never
+      // split an edge near its own endpoint, where the split point could lie
+      // outside of the edge and be processed before its left event.
+      const point *ends[4] = {&e1->p, &e1->other->p, &e2->p, &e2->other->p};
+      bool near[4];
+      for (int i = 0; i < 4; i++) {
+        near[i] = EQ(p.x, ends[i]->x) && EQ(p.y, ends[i]->y);
+      }
+      for (int i = 0; i < 4; i++) {
+        if (near[i]) {
+          p = *ends[i];
+        }
+      }
+      if (e1->p == e2->p || e1->other->p == e2->other->p) {
+        return 0;
+      }
+      if (!near[0] && !near[1]) {
+        divide(e1, p);
+      }
+      if (!near[2] && !near[3]) {
+        divide(e2, p);
+      }
+      return 1;
+    }
+    if (e1->pol == e2->pol) {
+      return 0;  // Overlapping edges of the same polygon are ignored.
+    }
+    std::vector<sweep_event*> s;
+    if (e1->p == e2->p) {
+      s.push_back(NULL);
+    } else if (event_after()(e1, e2)) {
+      s.push_back(e2);
+      s.push_back(e1);
+    } else {
+      s.push_back(e1);
+      s.push_back(e2);
+    }
+    if (e1->other->p == e2->other->p) {
+      s.push_back(NULL);
+    } else if (event_after()(e1->other, e2->other)) {
+      s.push_back(e2->other);
+      s.push_back(e1->other);
+    } else {
+      s.push_back(e1->other);
+      s.push_back(e2->other);
+    }
+    if (s.size() == 2 || (s.size() == 3 && s[2] != NULL)) {
+      e1->type = NON_CONTRIBUTING;
+      e2->type = (e1->in_out == e2->in_out) ? SAME_TRANSITION
+                                            : DIFFERENT_TRANSITION;
+      if (s.size() == 3) {
+        divide(s[2]->other, s[1]->p);
+      }
+      return 2;
+    }
+    if (s.size() == 3) {
+      divide(s[0], s[1]->p);
+    } else if (s[0] != s[3]->other) {
+      divide(s[0], s[1]->p);
+      divide(s[1], s[2]->p);
+    } else {
+      divide(s[0], s[1]->p);
+      divide(s[3]->other, s[2]->p);
+    }
+    return 3;
+  }
+
+  // Returns whether the edge of event e is directed away from its point, where
+  // edges are directed so that the result lies to their left.
+  bool outgoing(const sweep_event *e) const {
+    return e->left ? above_in_result(e) : !above_in_result(e->other);
+  }
+
+  // Chains the result edges into contours, counter-clockwise around outer
+  // boundaries and clockwise around holes. Arriving at a point, a walk leaves
+  // by the first unused outgoing edge clockwise from the edge it came by, so
+  // that it follows the boundary of a single region around touching points.
+  // Walks that still pass a point twice are split into simple cycles there.
+  std::vector<contour> connect_edges() {
+    std::vector<sweep_event*> e;
+    for (int i = 0; i < (int)processed.size(); i++) {
+      sweep_event *s = processed[i];
+      if (s->left ? s->in_result : s->other->in_result) {
+        e.push_back(s);
+      }
+    }
+    std::sort(e.begin(), e.end(), event_before());
+    int n = e.size();
+    std::vector<int> lo(n);
+    for (int i = 0; i < n; i++) {
+      e[i]->pos = i;
+      lo[i] = (i > 0 && e[i]->p == e[i - 1]->p) ? lo[i - 1] : i;
+    }
+    std::vector<contour> res;
+    std::vector<char> used(n, 0);
+    for (int i = 0; i < n; i++) {
+      if (used[i] || !outgoing(e[i])) {
+        continue;
+      }
+      contour c;
+      std::map<point, int> seen;
+      int cur = i;
+      do {
+        std::map<point, int>::iterator it = seen.find(e[cur]->p);
+        if (it != seen.end()) {
+          int j = it->second;
+          res.push_back(contour(c.begin() + j, c.end()));
+          for (int k = j; k < (int)c.size(); k++) {
+            seen.erase(c[k]);
+          }
+          c.resize(j);
+        }
+        seen[e[cur]->p] = c.size();
+        c.push_back(e[cur]->p);
+        used[cur] = 1;
+        const point &p = e[cur]->p, &q = e[cur]->other->p;
+        double back = atan2(p.y - q.y, p.x - q.x), best = 0;
+        int j = lo[e[cur]->other->pos];
+        cur = -1;
+        for (; j < n && e[j]->p == q; j++) {
+          if ((used[j] && j != i) || !outgoing(e[j])) {
+            continue;
+          }
+          const point &r = e[j]->other->p;
+          double a = back - atan2(r.y - q.y, r.x - q.x);
+          if (a <= 0) {
+            a += 2*acos(-1.0);
+          }
+          if (cur < 0 || a < best) {
+            cur = j;
+            best = a;
+          }
+        }
+      } while (cur >= 0 && cur != i);
+      if (!c.empty()) {
+        res.push_back(c);
+      }
+    }
+    return res;
+  }
+
+ public:
+  boolean_sweep(const std::vector<contour> &a, const std::vector<contour> &b,
+                boolean_op op) : op(op) {
+    const std::vector<contour> *v[2] = {&a, &b};
+    std::set<double> xs, ys;
+    for (int pol = 0; pol < 2; pol++) {
+      for (int i = 0; i < (int)v[pol]->size(); i++) {
+        contour c((*v[pol])[i]);
+        for (int j = 0; j < (int)c.size(); j++) {
+          c[j] = point(snap(xs, c[j].x), snap(ys, c[j].y));
+        }
+        for (int j = 0, k = (int)c.size() - 1; j < (int)c.size(); k = j++) {
+          add_edge(c[k], c[j], pol);
+        }
+      }
+    }
+  }
+
+  std::vector<contour> run() {
+    while (!events.empty()) {
+      sweep_event *e = events.top();
+      events.pop();
+      processed.push_back(e);
+      if (e->left) {
+        std::pair<iter, bool> ins = status.insert(e);
+        assert(ins.second);
+        iter it = ins.first, prev = it, next = it;
+        e->it = it;
+        prev = (prev == status.begin()) ? status.end() : --prev;
+        ++next;
+        compute_fields(e, prev);
+        if (next != status.end() && possible_intersection(e, *next) == 2) {
+          compute_fields(e, prev);
+          compute_fields(*next, it);
+        }
+        if (prev != status.end() && possible_intersection(*prev, e) == 2) {
+          iter pp = prev;
+          pp = (pp == status.begin()) ? status.end() : --pp;
+          compute_fields(*prev, pp);
+          compute_fields(e, prev);
+        }
+      } else {
+        e = e->other;
+        iter it = e->it, prev = it, next = it;
+        prev = (prev == status.begin()) ? status.end() : --prev;
+        ++next;
+        status.erase(it);
+        if (next != status.end() && prev != status.end()) {
+          possible_intersection(*prev, *next);
+        }
+      }
+    }
+    return connect_edges();
+  }
+};
+
+std::vector<contour> polygon_boolean(const std::vector<contour> &a,
+                                     const std::vector<contour> &b,
+                                     boolean_op op) {
+  return boolean_sweep(a, b, op).run();
+}
+
+struct box {
+  double x0, y0, x1, y1;
+
+  box() : x0(HUGE_VAL), y0(HUGE_VAL), x1(-HUGE_VAL), y1(-HUGE_VAL) {}
+
+  void add(const contour &c) {
+    for (int i = 0; i < (int)c.size(); i++) {
+      x0 = std::min(x0, c[i].x);
+      y0 = std::min(y0, c[i].y);
+      x1 = std::max(x1, c[i].x);
+      y1 = std::max(y1, c[i].y);
+    }
+  }
+
+  bool overlaps(const box &b) const {
+    return x0 <= b.x1 && b.x0 <= x1 && y0 <= b.y1 && b.y0 <= y1;
+  }
+};
+
+// Returns the union of regions a and b, each the output of a previous call to
+// polygon_boolean(). Contours of either whose bounding box misses that of the
+// other region are passed through without taking part in the sweep, which is
+// correct since the contours nested inside of them are passed through too.
+std::vector<contour> merge_unions(const std::vector<contour> &a,
+                                  const std::vector<contour> &b) {
+  const std::vector<contour> *v[2] = {&a, &b};
+  box bb[2];
+  for (int t = 0; t < 2; t++) {
+    for (int i = 0; i < (int)v[t]->size(); i++) {
+      bb[t].add((*v[t])[i]);
+    }
+  }
+  std::vector<contour> sweep[2], res;
+  for (int t = 0; t < 2; t++) {
+    for (int i = 0; i < (int)v[t]->size(); i++) {
+      box c;
+      c.add((*v[t])[i]);
+      (c.overlaps(bb[1 - t]) ? sweep[t] : res).push_back((*v[t])[i]);
+    }
+  }
+  std::vector<contour> rest = polygon_boolean(sweep[0], sweep[1], UNION);
+  res.insert(res.end(), rest.begin(), rest.end());
+  return res;
+}
+
+// Returns the position of point p along the Z-order curve through a 2^16 by
+// 2^16 grid over bounding box b.
+long long morton_code(const point &p, const box &b) {
+  long long res = 0;
+  int gx = (int)((p.x - b.x0) / (b.x1 - b.x0 + EPS) * 65535);
+  int gy = (int)((p.y - b.y0) / (b.y1 - b.y0 + EPS) * 65535);
+  for (int i = 15; i >= 0; i--) {
+    res = (res << 2) | (((gx >> i) & 1) << 1) | ((gy >> i) & 1);
+  }
+  return res;
+}
+
+// Sorts the polygons along a Z-order curve so that nearby polygons are merged
+// first, normalizes each one on its own, then merges pairs of unions level by
+// level in a balanced tree, in parallel if compiled with -fopenmp.
+std::vector<contour> union_all(const std::vector<std::vector<contour> > &p) {
+  int n = p.size();
+  box all;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < (int)p[i].size(); j++) {
+      all.add(p[i][j]);
+    }
+  }
+  std::vector<std::pair<long long, int> > order;
+  for (int i = 0; i < n; i++) {
+    if (!p[i].empty() && !p[i][0].empty()) {
+      order.push_back(std::make_pair(morton_code(p[i][0][0], all), i));
+    }
+  }
+  std::sort(order.begin(), order.end());
+  std::vector<std::vector<contour> > v(order.size());
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic, 64)
+#endif
+  for (int i = 0; i < (int)order.size(); i++) {
+    v[i] = polygon_boolean(p[order[i].second], std::vector<contour>(), UNION);
+  }
+  while (v.size() > 1) {
+    int m = v.size() / 2;
+    std::vector<std::vector<contour> > next(v.size() - m);
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (int i = 0; i < m; i++) {
+      next[i] = merge_unions(v[2*i], v[2*i + 1]);
+    }
+    if (v.size() % 2 == 1) {
+      next.back().swap(v.back());
+    }
+    v.swap(next);
+  }
+  return v.empty() ? std::vector<contour>() : v[0];
+}
+
+double region_area(const std::vector<contour> &v) {
+  double res = 0;
+  for (int i = 0; i < (int)v.size(); i++) {
+    for (int j = 0, k = (int)v[i].size() - 1; j < (int)v[i].size(); k = j++) {
+      res += cross(v[i][k], v[i][j]);
+    }
+  }
+  return res / 2;
+}
+
 /*** Example Usage ***/
 
 #include <cassert>
+#include <cstdlib>
 using namespace std;
 
+// Returns the area of the union of convex polygons by integrating the length of
+// their union along vertical lines. This varies linearly between consecutive
+// x-coordinates of vertices and edge intersections, so the midpoints suffice.
+double convex_union_area(const vector<contour> &v) {
+  vector<double> xs;
+  for (int i = 0; i < (int)v.size(); i++) {
+    for (int a = 0; a < (int)v[i].size(); a++) {
+      xs.push_back(v[i][a].x);
+      for (int j = 0; j < i; j++) {
+        for (int b = 0; b < (int)v[j].size(); b++) {
+          point p;
+          int a2 = (a + 1) % v[i].size(), b2 = (b + 1) % v[j].size();
+          if (seg_intersection(v[i][a], v[i][a2], v[j][b], v[j][b2], &p) == 0) {
+            xs.push_back(p.x);
+          }
+        }
+      }
+    }
+  }
+  sort(xs.begin(), xs.end());
+  double res = 0;
+  for (int k = 0; k + 1 < (int)xs.size(); k++) {
+    double mx = (xs[k] + xs[k + 1])/2;
+    vector<pair<double, double> > spans;
+    for (int i = 0; i < (int)v.size(); i++) {
+      double lo = HUGE_VAL, hi = -HUGE_VAL;
+      for (int a = 0, b = (int)v[i].size() - 1; a < (int)v[i].size(); b = a++) {
+        point p = min(v[i][a], v[i][b]), q = max(v[i][a], v[i][b]);
+        if (p.x < mx && mx < q.x) {
+          double y = p.y + (q.y - p.y)*(mx - p.x)/(q.x - p.x);
+          lo = min(lo, y);
+          hi = max(hi, y);
+        }
+      }
+      if (lo < hi) {
+        spans.push_back(make_pair(lo, hi));
+      }
+    }
+    sort(spans.begin(), spans.end());
+    double len = 0, top = -HUGE_VAL;
+    for (int i = 0; i < (int)spans.size(); i++) {
+      len += max(0.0, spans[i].second - max(top, spans[i].first));
+      top = max(top, spans[i].second);
+    }
+    res += len*(xs[k + 1] - xs[k]);
+  }
+  return res;
+}
+
 int main() {
   vector<point> p, s;
   // Irregular pentagon a triangle of area 1.5 overlapping quadrant 2.
@@ -225,5 +846,139 @@ int main() {
   s.push_back(point(-3, 0));
   assert(EQ(1.5, intersection_area(p.begin(), p.end(), s.begin(), s.end())));
   assert(EQ(12.5, union_area(p.begin(), p.end(), s.begin(), s.end())));
+
+  vector<contour> a(1, p), b(1, s);
+  assert(EQ(1.5, region_area(polygon_boolean(a, b, INTERSECTION))));
+  assert(EQ(12.5, region_area(polygon_boolean(a, b, UNION))));
+  assert(EQ(3.5, region_area(polygon_boolean(a, b, DIFFERENCE))));
+  assert(EQ(7.5, region_area(polygon_boolean(b, a, DIFFERENCE))));
+  assert(EQ(11, region_area(polygon_boolean(a, b, XOR))));
+
+  // Four rectangles forming a frame, whose union is a square with a hole.
+  double r[4][4] = {{0, 0, 3, 1}, {2, 0, 3, 3}, {0, 2, 3, 3}, {0, 0, 1, 3}};
+  vector<vector<contour> > rects;
+  for (int i = 0; i < 4; i++) {
+    contour c;
+    c.push_back(point(r[i][0], r[i][1]));
+    c.push_back(point(r[i][2], r[i][1]));
+    c.push_back(point(r[i][2], r[i][3]));
+    c.push_back(point(r[i][0], r[i][3]));
+    rects.push_back(vector<contour>(1, c));
+  }
+  vector<contour> frame = union_all(rects);
+  assert(frame.size() == 2 && EQ(8, region_area(frame)));
+
+  // Random polygons with integer coordinates, star-shaped around the origin
+  // (their vertices sorted by angle with gaps of less than pi).
+  for (int k = 0; k < 300; k++) {
+    vector<contour> u(2);
+    bool star = true;
+    for (int t = 0; t < 2; t++) {
+      int n = 3 + rand() % 8;
+      vector<pair<double, point> > v;
+      for (int i = 0; i < n; i++) {
+        point q(rand() % 11 - 5, rand() % 11 - 5);
+        if (q != point(0, 0)) {
+          v.push_back(make_pair(atan2(q.y, q.x), q));
+        }
+      }
+      sort(v.begin(), v.end());
+      for (int i = 0; i < (int)v.size(); i++) {
+        if (i == 0 || v[i].first != v[i - 1].first) {
+          u[t].push_back(v[i].second);
+        }
+      }
+      for (int i = 0, j = (int)u[t].size() - 1; i < (int)u[t].size(); j = i++) {
+        star = star && cross(u[t][j], u[t][i]) > 0;
+      }
+    }
+    if (!star || u[0].size() < 3 || u[1].size() < 3) {
+      continue;
+    }
+    double i1 = intersection_area(u[0].begin(), u[0].end(),
+                                  u[1].begin(), u[1].end());
+    double a0 = region_area(vector<contour>(1, u[0]));
+    double a1 = region_area(vector<contour>(1, u[1]));
+    vector<contour> c0(1, u[0]), c1(1, u[1]);
+    assert(fabs(region_area(polygon_boolean(c0, c1, INTERSECTION)) -
+                i1) < 1e-6);
+    assert(fabs(region_area(polygon_boolean(c0, c1, UNION)) -
+                (a0 + a1 - i1)) < 1e-6);
+    assert(fabs(region_area(polygon_boolean(c0, c1, DIFFERENCE)) -
+                (a0 - i1)) < 1e-6);
+    assert(fabs(region_area(polygon_boolean(c0, c1, XOR)) -
+                (a0 + a1 - 2*i1)) < 1e-6);
+  }
+
+  // The union of many random rectangles on an integer grid, compared against
+  // the number of covered unit cells.
+  for (int k = 0; k < 20; k++) {
+    vector<vector<char> > cover(30, vector<char>(30, 0));
+    rects.clear();
+    for (int i = 0; i < 60; i++) {
+      int x0 = rand() % 29, y0 = rand() % 29;
+      int x1 = x0 + 1 + rand() % min(8, 29 - x0);
+      int y1 = y0 + 1 + rand() % min(8, 29 - y0);
+      contour c;
+      c.push_back(point(x0, y0));
+      c.push_back(point(x1, y0));
+      c.push_back(point(x1, y1));
+      c.push_back(point(x0, y1));
+      rects.push_back(vector<contour>(1, c));
+      for (int x = x0; x < x1; x++) {
+        for (int y = y0; y < y1; y++) {
+          cover[x][y] = 1;
+        }
+      }
+    }
+    int cells = 0;
+    for (int x = 0; x < 30; x++) {
+      for (int y = 0; y < 30; y++) {
+        cells += cover[x][y];
+      }
+    }
+    assert(EQ(cells, region_area(union_all(rects))));
+  }
+
+  // Two outputs of earlier unions, with vertices computed as intersections.
+  double ca[15][2] = {{0, 0}, {1.25, 0.75}, {1, 0}, {3, 0}, {3, 1.8}, {5, 3},
+                      {4, 4}, {3, 5}, {8/3.0, 40/9.0}, {1, 5}, {0, 5}, {0, 3},
+                      {0, 2}, {1.2, 2.6}, {1.5, 2.5}};
+  double cb[18][2] = {{0, 0}, {2.5, 1.5}, {3, 1}, {3, 1.8}, {10/3.0, 2},
+                      {4, 2}, {4, 2.4}, {5, 3}, {4, 11/3.0}, {4, 4}, {4, 5},
+                      {3, 4.75}, {3, 5}, {2, 5}, {1, 5}, {16/19.0, 80/19.0},
+                      {0, 4}, {2/3.0, 10/3.0}};
+  a.assign(1, contour());
+  b.assign(1, contour());
+  for (int i = 0; i < 15; i++) {
+    a[0].push_back(point(ca[i][0], ca[i][1]));
+  }
+  for (int i = 0; i < 18; i++) {
+    b[0].push_back(point(cb[i][0], cb[i][1]));
+  }
+  assert(fabs(region_area(polygon_boolean(a, b, UNION)) +
+              region_area(polygon_boolean(a, b, INTERSECTION)) -
+              region_area(a) - region_area(b)) < 1e-6);
+
+  // The union of random triangles with integer coordinates, whose merges see
+  // nearly equal intersections computed by different calls.
+  for (int k = 0; k < 300; k++) {
+    vector<vector<contour> > tris;
+    vector<contour> all;
+    for (int i = 0; i < 16; i++) {
+      contour c;
+      for (int j = 0; j < 3; j++) {
+        c.push_back(point(rand() % 6, rand() % 6));
+      }
+      if (cross(c[1], c[2], c[0]) < 0) {
+        swap(c[1], c[2]);
+      }
+      if (cross(c[1], c[2], c[0]) > 0) {
+        tris.push_back(vector<contour>(1, c));
+        all.push_back(c);
+      }
+    }
+    assert(fabs(region_area(union_all(tris)) - convex_union_area(all)) < 1e-6);
+  }
   return 0;
 }
@@ -3,9 +3,10 @@
 Given a set P of two dimensional points, the Delaunay triangulation of P is a
 set of non-overlapping triangles that covers the entire convex hull of P such
 that no point in P lies within the circumcircle of any of the resulting
-triangles. For any point p in the convex hull of P (but not necessarily in P),
-the nearest point is guaranteed to be a vertex of the enclosing triangle from
-the triangulation.
+triangles. For any point p (not necessarily in P), the nearest point of P can be
+reached from any vertex by repeatedly moving along an edge of the triangulation
+to a vertex closer to p. The dual of the triangulation, joining the centers of
+the circumcircles of adjacent triangles, is the Voronoi diagram of P.
 
 The triangulation may not exist (e.g. for a set of collinear points), or may not
 be unique if it does exists. The following program assumes its existence and
@@ -14,27 +15,253 @@ algorithm with linear merging. Its fully documented version along with debugging
 messages for the current asserts() may be found at the following link:
 http://people.sc.fsu.edu/~jburkardt/f_src/table_delaunay/table_delaunay.html
 
+Instead of comparing against tolerances, the left-right tests of lrline() and
+the diagonal swaps of diaedg() use the robust orient2d() and incircle()
+predicates of Shewchuk, which first evaluate their determinants in floating
+point and only fall back to exact arithmetic on expansions (sums of doubles that
+do not overlap) if the result is within its rounding error bound of zero. This
+keeps nearly collinear and nearly cocircular inputs from producing inconsistent
+triangulations.
+
 - delaunay_triangulation(lo, hi) returns a Delaunay triangulation for the input
   range [lo, hi) of points, where lo and hi must be random-access iterators, or
   an empty vector if a triangulation does not exist.
+- delaunay_indices(lo, hi) returns the same triangulation as a vector holding
+  three consecutive indices into [lo, hi) for every triangle.
+- euclidean_mst(lo, hi, mst) returns the total length of a Euclidean minimum
+  spanning tree of the points in [lo, hi), storing its edges into mst as pairs
+  of indices into the range. Every edge of such a tree is an edge of the
+  Delaunay triangulation, so Kruskal's algorithm (see section 4.4.2) only has
+  to sort the O(n) edges of the triangulation rather than all n(n - 1)/2 pairs
+  of points. Points which coincide up to rounding are first reduced to one
+  point (joined to the rest by their own edges). If the remaining points are
+  collinear, the tree is instead the path through them in sorted order.
+
+- delaunay_mesh(lo, hi) constructs a triangulation of the points in [lo, hi)
+  that more points may later be inserted into. Vertex i is the i-th point of
+  points(), counting every point given to the constructor or insert(), though
+  points equal to earlier ones are not vertices of any triangle. The points are
+  triangulated by divide and conquer (after Guibas and Stolfi, with the
+  alternating cuts of Dwyer), solving the two halves of the upper levels of the
+  recursion in parallel if compiled with -fopenmp.
+- delaunay_mesh::insert(p) adds point p by the Bowyer-Watson algorithm, removing
+  the triangles whose circumcircles contain p and joining p to the boundary of
+  the cavity they leave. Returns the index of the vertex at p, which is an
+  earlier index if p equals an earlier point. Triangles are only stored once
+  some three points are not collinear.
+- delaunay_mesh::insert(lo, hi) adds the points in [lo, hi) in a biased
+  randomized insertion order: rounds of doubling sizes from a random
+  permutation, each sorted along a Hilbert curve, so that consecutive points
+  are close together while the expected total work stays that of a random
+  order.
+- delaunay_mesh::locate(p, res) stores into res the indices of the vertices of
+  a triangle containing p and returns true, or if p is outside the convex hull,
+  stores the indices of a hull edge that p lies strictly beyond (followed by -1)
+  and returns false. The triangle is found by walking from the last triangle
+  created or found, as in insert().
+- delaunay_mesh::nearest(p) returns the index of a vertex nearest to p (or -1
+  if there are no points), by walking to a triangle containing p and then
+  moving to closer neighbors as above. The walk starts from the triangle of the
+  previous answer, so queries close to the previous one take O(1) steps.
+- delaunay_mesh::triangles() returns three consecutive vertex indices, in
+  counter-clockwise order, for every triangle.
+- delaunay_mesh::voronoi() returns the Voronoi diagram, which has a vertex at
+  the circumcenter of every triangle (or at infinity, in the direction of the
+  outward normal, for each edge of the convex hull) and lists for the i-th
+  point the vertices of its cell in counter-clockwise order. The cells of
+  points on the hull begin and end at infinity, and points that are not
+  vertices have empty cells. Consecutive cell vertices coincide where four or
+  more points are cocircular.
 
 Time Complexity:
-- O(n log n) per call to delaunay_triangulation(lo, hi), where n is the distance
+- O(n log n) per call to delaunay_triangulation(lo, hi), delaunay_indices(lo,
+  hi), euclidean_mst(lo, hi, mst), and the delaunay_mesh constructor, where n is
+  the distance between lo and hi.
+- O(1) on average per call to delaunay_mesh::insert(p) to update the
+  triangles, plus the walk from the previous point, which takes O(sqrt n) on
+  average for a random p (where n is the number of vertices) and O(1) for a p
+  near the previous point. The same holds for locate(p).
+- O(n log n) on average per call to insert(lo, hi), where n is the distance
   between lo and hi.
+- O(1) on average per call to nearest(p) for a p near the previous query, or
+  O(sqrt n) for a random p.
+- O(n) per call to triangles() and voronoi().
 
 Space Complexity:
-- O(n) auxiliary heap space for storage of the Delaunay triangulation.
+- O(n) auxiliary heap space for storage of the Delaunay triangulation, and for
+  euclidean_mst() and the delaunay_mesh constructor.
+- O(k) auxiliary heap space for delaunay_mesh::insert(p), where k is the number
+  of triangles removed.
 
 */
 
 #include <algorithm>
 #include <cassert>
+#include <cfloat>
+#include <climits>
 #include <cmath>
 #include <cstddef>
 #include <limits>
 #include <utility>
 #include <vector>
 
+// Robust predicates after Shewchuk. Each predicate first evaluates its
+// determinant in floating point and returns it if its magnitude is above a
+// bound on the rounding error, otherwise it recomputes the determinant exactly
+// as an expansion (a sum of doubles that do not overlap in their bits, stored
+// in increasing order of magnitude) and returns its largest component.
+
+typedef std::vector<double> expansion;
+
+const double ORIENT_BOUND = (3 + 8*DBL_EPSILON)*DBL_EPSILON/2;
+const double INCIRCLE_BOUND = (10 + 48*DBL_EPSILON)*DBL_EPSILON/2;
+
+// Sets x + y = a + b exactly, where x is the rounded sum.
+void two_sum(double a, double b, double &x, double &y) {
+  x = a + b;
+  double bv = x - a, av = x - bv;
+  y = (a - av) + (b - bv);
+}
+
+// Sets x + y = a*b exactly, where x is the rounded product.
+void two_product(double a, double b, double &x, double &y) {
+  x = a*b;
+#ifdef __FMA__
+  y = __builtin_fma(a, b, -x);
+#else
+  static const double SPLITTER = 134217729.0;  // 2^27 + 1.
+  double c = SPLITTER*a, ah = c - (c - a), al = a - ah;
+  double d = SPLITTER*b, bh = d - (d - b), bl = b - bh;
+  y = al*bl - (((x - ah*bh) - al*bh) - ah*bl);
+#endif
+}
+
+bool abs_less(double a, double b) { return fabs(a) < fabs(b); }
+
+expansion expansion_sum(const expansion &e, const expansion &f) {
+  expansion g(e.size() + f.size()), h;
+  std::merge(e.begin(), e.end(), f.begin(), f.end(), g.begin(), abs_less);
+  double q = 0, r;
+  for (int i = 0; i < (int)g.size(); i++) {
+    two_sum(q, g[i], q, r);
+    if (r != 0) {
+      h.push_back(r);
+    }
+  }
+  if (q != 0 || h.empty()) {
+    h.push_back(q);
+  }
+  return h;
+}
+
+expansion scale_expansion(const expansion &e, double b) {
+  expansion h;
+  double q, r, hi, lo, s;
+  two_product(e[0], b, q, r);
+  if (r != 0) {
+    h.push_back(r);
+  }
+  for (int i = 1; i < (int)e.size(); i++) {
+    two_product(e[i], b, hi, lo);
+    two_sum(q, lo, s, r);
+    if (r != 0) {
+      h.push_back(r);
+    }
+    two_sum(hi, s, q, r);
+    if (r != 0) {
+      h.push_back(r);
+    }
+  }
+  if (q != 0 || h.empty()) {
+    h.push_back(q);
+  }
+  return h;
+}
+
+expansion expansion_product(const expansion &e, const expansion &f) {
+  expansion res(1, 0);
+  for (int i = 0; i < (int)f.size(); i++) {
+    res = expansion_sum(res, scale_expansion(e, f[i]));
+  }
+  return res;
+}
+
+// Returns the exact difference a - b as an expansion.
+expansion expansion_diff(double a, double b) {
+  double x, y;
+  two_sum(a, -b, x, y);
+  expansion res(1, y);
+  res.push_back(x);
+  return res;
+}
+
+// Returns a positive value if a, b, and c are in counter-clockwise order, a
+// negative value if they are in clockwise order, or zero if they are collinear.
+// The magnitude approximates twice the area of the triangle.
+double orient2d(double ax, double ay, double bx, double by,
+                double cx, double cy) {
+  double left = (ax - cx)*(by - cy), right = (ay - cy)*(bx - cx);
+  double det = left - right, sum;
+  if (left > 0) {
+    if (right <= 0) {
+      return det;
+    }
+    sum = left + right;
+  } else if (left < 0) {
+    if (right >= 0) {
+      return det;
+    }
+    sum = -left - right;
+  } else {
+    return det;
+  }
+  if (fabs(det) >= ORIENT_BOUND*sum) {
+    return det;
+  }
+  double t[6][2] = {{ax, by}, {-ax, cy}, {-cx, by},
+                    {-ay, bx}, {ay, cx}, {cy, bx}};
+  expansion res(1, 0);
+  for (int i = 0; i < 6; i++) {
+    res = expansion_sum(res, scale_expansion(expansion(1, t[i][0]), t[i][1]));
+  }
+  return res.back();
+}
+
+// Returns a positive value if d lies inside the circle through a, b, and c
+// (which must be in counter-clockwise order), a negative value if it lies
+// outside, or zero if the four points are cocircular.
+double incircle(double ax, double ay, double bx, double by, double cx,
+                double cy, double dx, double dy) {
+  double adx = ax - dx, bdx = bx - dx, cdx = cx - dx;
+  double ady = ay - dy, bdy = by - dy, cdy = cy - dy;
+  double bc = bdx*cdy - cdx*bdy, ca = cdx*ady - adx*cdy;
+  double ab = adx*bdy - bdx*ady;
+  double alift = adx*adx + ady*ady, blift = bdx*bdx + bdy*bdy;
+  double clift = cdx*cdx + cdy*cdy;
+  double det = alift*bc + blift*ca + clift*ab;
+  double permanent = (fabs(bdx*cdy) + fabs(cdx*bdy))*alift +
+                     (fabs(cdx*ady) + fabs(adx*cdy))*blift +
+                     (fabs(adx*bdy) + fabs(bdx*ady))*clift;
+  if (fabs(det) > INCIRCLE_BOUND*permanent) {
+    return det;
+  }
+  expansion ex[3] = {expansion_diff(ax, dx), expansion_diff(bx, dx),
+                     expansion_diff(cx, dx)};
+  expansion ey[3] = {expansion_diff(ay, dy), expansion_diff(by, dy),
+                     expansion_diff(cy, dy)};
+  expansion res(1, 0);
+  for (int i = 0; i < 3; i++) {
+    int j = (i + 1) % 3, k = (i + 2) % 3;
+    expansion lift = expansion_sum(expansion_product(ex[i], ex[i]),
+                                   expansion_product(ey[i], ey[i]));
+    expansion cofactor = expansion_sum(expansion_product(ex[j], ey[k]),
+                                    scale_expansion(
+                                        expansion_product(ex[k], ey[j]), -1));
+    res = expansion_sum(res, expansion_product(lift, cofactor));
+  }
+  return res.back();
+}
+
 int wrap(int ival, int ilo, int ihi) {
   int jlo = std::min(ilo, ihi), jhi = std::max(ilo, ihi);
   int wide = jhi + 1 - jlo, res = jlo;
@@ -138,6 +365,10 @@ int* sort_heap(int n, double a[][2]) {
 
 int lrline(double xu, double yu, double xv1, double yv1,
           double xv2, double yv2, double dv) {
+  if (dv == 0) {
+    double o = orient2d(xv1, yv1, xv2, yv2, xu, yu);
+    return (o < 0) ? 1 : ((o > 0) ? -1 : 0);
+  }
   static const double tol = 1e-7;
   double dx = xv2 - xv1, dy = yv2 - yv1;
   double dxu = xu - xv1, dyu = yu - yv1;
@@ -215,35 +446,8 @@ void vbedg(double x, double y, int point_num, double point_xy[][2],
 
 int diaedg(double x0, double y0, double x1, double y1,
            double x2, double y2, double x3, double y3) {
-  double ca, cb, s, tol, tola, tolb;
-  int value;
-  tol = 100.0*std::numeric_limits<double>::epsilon();
-  double dx10 = x1 - x0, dy10 = y1 - y0;
-  double dx12 = x1 - x2, dy12 = y1 - y2;
-  double dx30 = x3 - x0, dy30 = y3 - y0;
-  double dx32 = x3 - x2, dy32 = y3 - y2;
-  tola = tol*std::max(std::max(fabs(dx10), fabs(dy10)),
-                      std::max(fabs(dx30), fabs(dy30)));
-  tolb = tol*std::max(std::max(fabs(dx12), fabs(dy12)),
-                      std::max(fabs(dx32), fabs(dy32)));
-  ca = dx10*dx30 + dy10*dy30;
-  cb = dx12*dx32 + dy12*dy32;
-  if (tola < ca && tolb < cb) {
-    value = -1;
-  } else if (ca < -tola && cb < -tolb) {
-    value = 1;
-  } else {
-    tola = std::max(tola, tolb);
-    s = (dx10*dy30 - dx30*dy10)*cb + (dx32*dy12 - dx12*dy32)*ca;
-    if (tola < s) {
-      value = -1;
-    } else if (s < -tola) {
-      value = 1;
-    } else {
-      value = 0;
-    }
-  }
-  return value;
+  double s = incircle(x0, y0, x1, y1, x3, y3, x2, y2);
+  return (s > 0) ? 1 : ((s < 0) ? -1 : 0);
 }
 
 int swapec(int i, int *top, int *btri, int *bedg, int point_num,
@@ -566,31 +770,1039 @@ struct triangle {
   }
 };
 
+// The arrays are allocated on the heap, since there may be millions of points.
 template<class It>
-std::vector<triangle> delaunay_triangulation(It lo, It hi) {
+std::vector<int> delaunay_indices(It lo, It hi) {
   int n = hi - lo;
-  double points[n][2];
-  int tri_nodes[3*n][3], tri_neigh[3*n][3];
-  int curr = 0;
-  for (It it = lo; it != hi; ++curr, ++it) {
-    points[curr][0] = it->x;
-    points[curr][1] = it->y;
-  }
-  int m = dtris2(n, points, tri_nodes, tri_neigh);
+  if (n < 3) {
+    return std::vector<int>();
+  }
+  std::vector<double> points(2*n);
+  std::vector<int> tri_nodes(9*n), tri_neigh(9*n);
+  for (int i = 0; i < n; i++) {
+    points[2*i] = lo[i].x;
+    points[2*i + 1] = lo[i].y;
+  }
+  int m = dtris2(n, reinterpret_cast<double (*)[2]>(&points[0]),
+                 reinterpret_cast<int (*)[3]>(&tri_nodes[0]),
+                 reinterpret_cast<int (*)[3]>(&tri_neigh[0]));
+  tri_nodes.resize(3*m);
+  for (int i = 0; i < 3*m; i++) {
+    tri_nodes[i]--;
+  }
+  return tri_nodes;
+}
+
+template<class It>
+std::vector<triangle> delaunay_triangulation(It lo, It hi) {
+  std::vector<int> t = delaunay_indices(lo, hi);
   std::vector<triangle> res;
-  for (int i = 0; i < m; i++) {
-    res.push_back(triangle(lo[tri_nodes[i][0] - 1],
-                           lo[tri_nodes[i][1] - 1],
-                           lo[tri_nodes[i][2] - 1]));
+  for (int i = 0; i < (int)t.size(); i += 3) {
+    res.push_back(triangle(lo[t[i]], lo[t[i + 1]], lo[t[i + 2]]));
+  }
+  return res;
+}
+
+// Returns whether two points would be rejected as duplicates by dtris2().
+bool coincide(const point &a, const point &b) {
+  static const double tol = 100.0*std::numeric_limits<double>::epsilon();
+  double cx = std::max(fabs(a.x), fabs(b.x));
+  double cy = std::max(fabs(a.y), fabs(b.y));
+  return fabs(a.x - b.x) <= tol*(cx + 1.0) && fabs(a.y - b.y) <= tol*(cy + 1.0);
+}
+
+template<class It>
+struct point_order {
+  It lo;
+
+  point_order(It lo) : lo(lo) {}
+
+  bool operator()(int i, int j) const {
+    return lo[i] < lo[j];
+  }
+};
+
+int find_root(std::vector<int> &root, int u) {
+  while (root[u] != u) {
+    u = root[u] = root[root[u]];
+  }
+  return u;
+}
+
+template<class It>
+double euclidean_mst(It lo, It hi, std::vector<std::pair<int, int> > &mst) {
+  int n = hi - lo;
+  std::vector<int> order(n);
+  for (int i = 0; i < n; i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), point_order<It>(lo));
+  // Candidate edges as (length, (i, j)), first joining every point to the
+  // previously kept point which it coincides with.
+  std::vector<std::pair<double, std::pair<int, int> > > edges;
+  std::vector<int> kept;
+  std::vector<point> unique;
+  for (int i = 0; i < n; i++) {
+    const point &p = lo[order[i]];
+    if (!kept.empty() && coincide(unique.back(), p)) {
+      edges.push_back(std::make_pair(0.0, std::make_pair(kept.back(),
+                                                         order[i])));
+    } else {
+      kept.push_back(order[i]);
+      unique.push_back(p);
+    }
+  }
+  int k = kept.size(), j = 2;
+  while (j < k && lrline(unique[j].x, unique[j].y, unique[0].x, unique[0].y,
+                         unique[1].x, unique[1].y, 0.0) == 0) {
+    j++;
+  }
+  if (j < k) {
+    std::vector<int> t = delaunay_indices(unique.begin(), unique.end());
+    for (int i = 0; i < (int)t.size(); i += 3) {
+      for (int e = 0; e < 3; e++) {
+        std::pair<int, int> edge(t[i + e], t[i + (e + 1) % 3]);
+        edges.push_back(std::make_pair(0.0, edge));
+      }
+    }
+  } else {
+    for (int i = 0; i + 1 < k; i++) {
+      edges.push_back(std::make_pair(0.0, std::make_pair(i, i + 1)));
+    }
+  }
+  // Edges between kept points are listed by their positions in kept, and most
+  // appear in two triangles, so they are mapped back and deduplicated.
+  int num_duplicates = n - k;
+  for (int i = num_duplicates; i < (int)edges.size(); i++) {
+    std::pair<int, int> &e = edges[i].second;
+    e = std::make_pair(kept[e.first], kept[e.second]);
+    if (e.first > e.second) {
+      std::swap(e.first, e.second);
+    }
+  }
+  std::sort(edges.begin() + num_duplicates, edges.end());
+  edges.erase(std::unique(edges.begin() + num_duplicates, edges.end()),
+              edges.end());
+  for (int i = 0; i < (int)edges.size(); i++) {
+    const point &a = lo[edges[i].second.first], &b = lo[edges[i].second.second];
+    edges[i].first = sqrt((a.x - b.x)*(a.x - b.x) + (a.y - b.y)*(a.y - b.y));
+  }
+  std::sort(edges.begin(), edges.end());
+  std::vector<int> root(n);
+  for (int i = 0; i < n; i++) {
+    root[i] = i;
+  }
+  mst.clear();
+  double total = 0;
+  for (int i = 0; i < (int)edges.size(); i++) {
+    int u = find_root(root, edges[i].second.first);
+    int v = find_root(root, edges[i].second.second);
+    if (u != v) {
+      root[u] = v;
+      mst.push_back(edges[i].second);
+      total += edges[i].first;
+    }
+  }
+  return total;
+}
+
+/*** Incremental Triangulation ***/
+
+// Returns the position of (x, y) along a Hilbert curve filling the grid of
+// 2^bits by 2^bits cells. Consecutive positions along the curve are adjacent
+// cells, so inserting points in this order keeps consecutive points close.
+inline long long hilbert_order(int x, int y, int bits) {
+  long long res = 0;
+  for (int s = 1 << (bits - 1); s > 0; s >>= 1) {
+    int rx = (x & s) > 0, ry = (y & s) > 0;
+    res += (long long)s*s*((3*rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s - 1 - x;
+        y = s - 1 - y;
+      }
+      std::swap(x, y);
+    }
   }
   return res;
 }
 
-/*** Example Usage ***/
+double sqdist(const point &a, const point &b) {
+  return (a.x - b.x)*(a.x - b.x) + (a.y - b.y)*(a.y - b.y);
+}
+
+point circumcenter(const point &a, const point &b, const point &c) {
+  double bx = b.x - a.x, by = b.y - a.y, cx = c.x - a.x, cy = c.y - a.y;
+  double d = 2*(bx*cy - by*cx), b2 = bx*bx + by*by, c2 = cx*cx + cy*cy;
+  return point(a.x + (cy*b2 - by*c2)/d, a.y + (bx*c2 - cx*b2)/d);
+}
+
+// The dual of a Delaunay triangulation. A vertex at infinity is stored as the
+// direction of the ray along which the cell edges leading to it extend.
+struct voronoi_diagram {
+  std::vector<point> vertices;
+  std::vector<bool> at_infinity;
+  std::vector<std::vector<int> > cells;
+};
+
+// A Delaunay triangulation stored as triangles with their neighbors. Every
+// edge of the convex hull is also the side of a ghost triangle whose third
+// vertex is the point at infinity, so that points outside the hull are
+// inserted in the same way as points inside.
+class delaunay_mesh {
+  static const int GHOST = -1;
+  static const int PARALLEL_DEPTH = 6;
+
+  // The vertices of triangle t are v[3t], v[3t + 1], and v[3t + 2], in
+  // counter-clockwise order with any ghost vertex last, and nb[3t + i] is the
+  // triangle across the edge opposite v[3t + i].
+  std::vector<point> p;
+  std::vector<int> v, nb;
+  std::vector<int> mark, start, cavity, pending;
+  std::vector<std::pair<int, std::pair<int, int> > > boundary;
+  int stamp, last;
+  unsigned int seed;
+
+  double orient(int a, int b, const point &q) const {
+    return orient2d(p[a].x, p[a].y, p[b].x, p[b].y, q.x, q.y);
+  }
+
+  // Returns the index i such that the edge from vertex a of t is opposite
+  // v[3t + i].
+  int across(int t, int a) const {
+    return (v[3*t + 1] == a) ? 0 : ((v[3*t + 2] == a) ? 1 : 2);
+  }
+
+  int index_of(int t, int a) const {
+    return (v[3*t] == a) ? 0 : ((v[3*t + 1] == a) ? 1 : 2);
+  }
+
+  // Returns the next triangle counter-clockwise around vertex a of t.
+  int rotate(int t, int a) const {
+    return nb[3*t + (index_of(t, a) + 1) % 3];
+  }
+
+  void link(int t, int a, int s) {
+    nb[3*t + across(t, a)] = s;
+  }
+
+  // Stores the triangle (a, b, c) into slot t, or into a new slot if t is -1.
+  int set_triangle(int t, int a, int b, int c) {
+    if (a == GHOST) {
+      a = b;
+      b = c;
+      c = GHOST;
+    } else if (b == GHOST) {
+      b = a;
+      a = c;
+      c = GHOST;
+    }
+    if (t < 0) {
+      t = v.size() / 3;
+      v.resize(v.size() + 3);
+      nb.resize(nb.size() + 3);
+      mark.push_back(0);
+    }
+    v[3*t] = a;
+    v[3*t + 1] = b;
+    v[3*t + 2] = c;
+    return t;
+  }
+
+  // Returns whether q lies strictly inside the circumcircle of t. For a ghost
+  // triangle, that is the open half-plane beyond its hull edge together with
+  // the interior of the edge.
+  bool conflict(int t, const point &q) const {
+    const int *w = &v[3*t];
+    if (w[2] == GHOST) {
+      double o = orient(w[0], w[1], q);
+      if (o != 0) {
+        return o > 0;
+      }
+      const point &a = p[w[0]], &b = p[w[1]];
+      if (a.x != b.x) {
+        return std::min(a.x, b.x) < q.x && q.x < std::max(a.x, b.x);
+      }
+      return std::min(a.y, b.y) < q.y && q.y < std::max(a.y, b.y);
+    }
+    const point &a = p[w[0]], &b = p[w[1]], &c = p[w[2]];
+    return incircle(a.x, a.y, b.x, b.y, c.x, c.y, q.x, q.y) > 0;
+  }
+
+  // Walks from the last created triangle towards q, crossing a randomly chosen
+  // edge that separates the current triangle from q until there is none. The
+  // result is a triangle containing q, or a ghost triangle if q is outside the
+  // hull.
+  int walk(const point &q) {
+    int t = last;
+    if (v[3*t + 2] == GHOST) {
+      t = nb[3*t + 2];
+    }
+    for (;;) {
+      if (v[3*t + 2] == GHOST) {
+        return t;
+      }
+      seed = seed*1103515245u + 12345u;
+      int k0 = (seed >> 16) % 3, next = -1;
+      for (int j = 0; j < 3 && next < 0; j++) {
+        int k = (k0 + j) % 3;
+        if (orient(v[3*t + (k + 1) % 3], v[3*t + (k + 2) % 3], q) < 0) {
+          next = nb[3*t + k];
+        }
+      }
+      if (next < 0) {
+        return t;
+      }
+      t = next;
+    }
+  }
+
+  // Creates the first real triangle (a, b, c) and its three ghost triangles.
+  void init(int a, int b, int c) {
+    if (orient(a, b, p[c]) < 0) {
+      std::swap(b, c);
+    }
+    int t = set_triangle(-1, a, b, c);
+    int gab = set_triangle(-1, b, a, GHOST);
+    int gbc = set_triangle(-1, c, b, GHOST);
+    int gca = set_triangle(-1, a, c, GHOST);
+    link(t, a, gab);
+    link(gab, b, t);
+    link(t, b, gbc);
+    link(gbc, c, t);
+    link(t, c, gca);
+    link(gca, a, t);
+    link(gab, a, gca);
+    link(gca, GHOST, gab);
+    link(gab, GHOST, gbc);
+    link(gbc, b, gab);
+    link(gbc, GHOST, gca);
+    link(gca, c, gbc);
+    last = t;
+  }
+
+  // Inserts point i by removing every triangle whose circumcircle contains it
+  // (which form a region that is star-shaped from the point) and joining the
+  // point to the boundary of that region. Returns the index of the vertex at
+  // the point, which is earlier than i if the point was already a vertex.
+  int insert_vertex(int i) {
+    const point &q = p[i];
+    int t = walk(q);
+    for (int k = 0; k < 3; k++) {
+      if (v[3*t + k] != GHOST && p[v[3*t + k]] == q) {
+        return v[3*t + k];
+      }
+    }
+    if (++stamp == INT_MAX) {
+      std::fill(mark.begin(), mark.end(), 0);
+      stamp = 1;
+    }
+    cavity.assign(1, t);
+    boundary.clear();
+    mark[t] = stamp;
+    for (int c = 0; c < (int)cavity.size(); c++) {
+      int s = cavity[c];
+      for (int k = 0; k < 3; k++) {
+        int o = nb[3*s + k];
+        if (mark[o] == stamp) {
+          continue;
+        }
+        if (mark[o] != -stamp && conflict(o, q)) {
+          mark[o] = stamp;
+          cavity.push_back(o);
+        } else {
+          mark[o] = -stamp;
+          boundary.push_back(std::make_pair(o, std::make_pair(
+              v[3*s + (k + 1) % 3], v[3*s + (k + 2) % 3])));
+        }
+      }
+    }
+    if ((int)start.size() < i + 2) {
+      start.resize(p.size() + 1);
+    }
+    // Each boundary edge (a, b) becomes the triangle (a, b, i), and these are
+    // joined around i by looking up the new triangle whose edge starts at b.
+    int nc = cavity.size(), m = boundary.size();
+    for (int j = 0; j < m; j++) {
+      int o = boundary[j].first, a = boundary[j].second.first;
+      int b = boundary[j].second.second;
+      int s = set_triangle(j < nc ? cavity[j] : -1, a, b, i);
+      link(s, a, o);
+      link(o, b, s);
+      start[a + 1] = s;
+      boundary[j].first = s;
+    }
+    for (int j = 0; j < m; j++) {
+      int s = boundary[j].first, b = boundary[j].second.second;
+      link(s, b, start[b + 1]);
+      link(start[b + 1], i, s);
+    }
+    last = boundary[0].first;
+    return i;
+  }
+
+  // Inserts point i while there are no triangles yet, which is until some
+  // point is not collinear with the distinct points in pending.
+  int insert_first(int i) {
+    int n = pending.size(), j = 0;
+    while (j < n && p[pending[j]] != p[i]) {
+      j++;
+    }
+    if (j < n) {
+      return pending[j];
+    }
+    j = 1;
+    while (j < n && orient(pending[0], pending[j], p[i]) == 0) {
+      j++;
+    }
+    if (j >= n) {
+      pending.push_back(i);
+      return i;
+    }
+    init(pending[0], pending[j], i);
+    for (int k = 1; k < n; k++) {
+      if (k != j) {
+        insert_vertex(pending[k]);
+      }
+    }
+    pending.clear();
+    return i;
+  }
+
+  int add(int i) {
+    return v.empty() ? insert_first(i) : insert_vertex(i);
+  }
+
+  // Guibas and Stolfi's divide and conquer with the alternating cuts of Dwyer,
+  // which splits the points at the median of x and y in turn, so that the
+  // halves being merged stay roughly square and few edges are deleted. The
+  // graph is kept on half-edges e and e ^ 1 (its twin) that each store their
+  // origin and the next and previous half-edge counter-clockwise around it.
+  typedef std::pair<point, int> vertex;
+
+  class builder {
+    struct half_edge {
+      int org, onext, oprev;
+    };
+
+    // Orders vertices by x then y (axis 0), or by y then decreasing x (axis
+    // 1), which is the order by x after rotating the plane clockwise.
+    struct axis_order {
+      int axis;
+
+      axis_order(int axis) : axis(axis) {}
+
+      bool operator()(const vertex &a, const vertex &b) const {
+        if (axis == 0) {
+          return a.first < b.first;
+        }
+        return a.first.y < b.first.y ||
+               (a.first.y == b.first.y && a.first.x > b.first.x);
+      }
+    };
+
+    std::vector<vertex> &s;
+    std::vector<half_edge> h;
+
+   public:
+    // The half-edges 2k and 2k + 1 for k in [next, end) are unused, as well as
+    // those in free. Any planar graph on n points has at most 3n - 6 edges, so
+    // the points in [lo, hi) never need more than the edges in [3lo, 3hi).
+    struct pool {
+      std::vector<int> free;
+      int next, end;
+
+      pool(int next, int end) : next(next), end(end) {}
+    };
+
+    builder(std::vector<vertex> &s) : s(s), h(6*s.size()) {
+      for (int e = 0; e < (int)h.size(); e++) {
+        h[e].org = -1;
+      }
+    }
+
+    int origin(int e) const { return h[e].org; }
+    int dest(int e) const { return h[e ^ 1].org; }
+    int onext(int e) const { return h[e].onext; }
+    int oprev(int e) const { return h[e].oprev; }
+    int lnext(int e) const { return h[e ^ 1].oprev; }
+    int lprev(int e) const { return h[e].onext ^ 1; }
+    int size() const { return h.size(); }
+
+   private:
+    bool ccw(int a, int b, int c) const {
+      const point &u = s[a].first, &v = s[b].first, &w = s[c].first;
+      return orient2d(u.x, u.y, v.x, v.y, w.x, w.y) > 0;
+    }
+
+    // The zipping loop often asks about a vertex of the circle itself, which
+    // would otherwise always take the exact path of incircle().
+    bool in_circle(int a, int b, int c, int d) const {
+      if (d == a || d == b || d == c) {
+        return false;
+      }
+      const point &u = s[a].first, &v = s[b].first, &w = s[c].first;
+      const point &z = s[d].first;
+      return incircle(u.x, u.y, v.x, v.y, w.x, w.y, z.x, z.y) > 0;
+    }
+
+    bool right_of(int a, int e) const { return ccw(a, dest(e), origin(e)); }
+
+    int make_edge(pool &q, int a, int b) {
+      int e;
+      if (!q.free.empty()) {
+        e = q.free.back();
+        q.free.pop_back();
+      } else {
+        e = 2*q.next++;
+      }
+      h[e].org = a;
+      h[e ^ 1].org = b;
+      h[e].onext = h[e].oprev = e;
+      h[e ^ 1].onext = h[e ^ 1].oprev = e ^ 1;
+      return e;
+    }
+
+    void splice(int a, int b) {
+      std::swap(h[a].onext, h[b].onext);
+      h[h[a].onext].oprev = a;
+      h[h[b].onext].oprev = b;
+    }
+
+    int connect(pool &q, int a, int b) {
+      int e = make_edge(q, dest(a), origin(b));
+      splice(e, lnext(a));
+      splice(e ^ 1, b);
+      return e;
+    }
+
+    void delete_edge(pool &q, int e) {
+      splice(e, oprev(e));
+      splice(e ^ 1, oprev(e ^ 1));
+      h[e].org = h[e ^ 1].org = -1;
+      q.free.push_back(e);
+    }
+
+    // Given a counter-clockwise hull edge e, returns the counter-clockwise hull
+    // edge out of the first vertex in the order of axis and the clockwise hull
+    // edge out of the last. Each step to the next hull edge is O(1), and hulls
+    // of random points are small.
+    std::pair<int, int> extremes(int e, int axis) const {
+      axis_order before(axis);
+      int first = e, last = -1, f = e;
+      do {
+        int g = onext(f ^ 1);
+        if (before(s[origin(g)], s[origin(first)])) {
+          first = g;
+        }
+        if (last < 0 || before(s[origin(last)], s[origin(g)])) {
+          last = f ^ 1;
+        }
+        f = g;
+      } while (f != e);
+      return std::make_pair(first, last);
+    }
+
+   public:
+    // Triangulates the points in [lo, hi), returning a counter-clockwise hull
+    // edge (which has the outer face on its right).
+    int build(int lo, int hi, pool &q, int axis, int depth) {
+      if (hi - lo <= 3) {
+        std::sort(s.begin() + lo, s.begin() + hi);
+        int a = make_edge(q, lo, lo + 1);
+        if (hi - lo == 2) {
+          return a;
+        }
+        int b = make_edge(q, lo + 1, lo + 2);
+        splice(a ^ 1, b);
+        if (ccw(lo, lo + 1, lo + 2)) {
+          connect(q, b, a);
+        } else if (ccw(lo, lo + 2, lo + 1)) {
+          return connect(q, b, a) ^ 1;
+        }
+        return a;
+      }
+      int mid = lo + (hi - lo)/2, l, r;
+      std::nth_element(s.begin() + lo, s.begin() + mid, s.begin() + hi,
+                       axis_order(axis));
+      if (depth < PARALLEL_DEPTH && hi - lo > (1 << 14)) {
+        pool ql(3*lo, 3*mid), qr(3*mid, 3*hi);
+#ifdef _OPENMP
+        #pragma omp task shared(l, ql)
+#endif
+        l = build(lo, mid, ql, 1 - axis, depth + 1);
+        r = build(mid, hi, qr, 1 - axis, depth + 1);
+#ifdef _OPENMP
+        #pragma omp taskwait
+#endif
+        q.free.swap(ql.free);
+        q.free.insert(q.free.end(), qr.free.begin(), qr.free.end());
+        for (int k = ql.next; k < ql.end; k++) {
+          q.free.push_back(2*k);
+        }
+        q.next = qr.next;
+        q.end = qr.end;
+      } else {
+        l = build(lo, mid, q, 1 - axis, depth + 1);
+        r = build(mid, hi, q, 1 - axis, depth + 1);
+      }
+      std::pair<int, int> le = extremes(l, axis), re = extremes(r, axis);
+      int ldo = le.first, ldi = le.second, rdi = re.first;
+      // Find the lower common tangent of the two halves, where lower is to
+      // the right when looking from the first half towards the second.
+      for (;;) {
+        if (ccw(origin(rdi), origin(ldi), dest(ldi))) {
+          ldi = lnext(ldi);
+        } else if (right_of(origin(ldi), rdi)) {
+          rdi = onext(rdi ^ 1);
+        } else {
+          break;
+        }
+      }
+      int base = connect(q, rdi ^ 1, ldi);
+      if (origin(ldi) == origin(ldo)) {
+        ldo = base ^ 1;
+      }
+      // Zip the halves together upwards, deleting the edges of either half
+      // whose triangles would contain the next vertex of the other half.
+      for (;;) {
+        int lc = onext(base ^ 1), rc = oprev(base);
+        int bo = origin(base), bd = dest(base);
+        bool lvalid = right_of(dest(lc), base);
+        if (lvalid) {
+          while (in_circle(bd, bo, dest(lc), dest(onext(lc)))) {
+            int t = onext(lc);
+            delete_edge(q, lc);
+            lc = t;
+          }
+        }
+        bool rvalid = right_of(dest(rc), base);
+        if (rvalid) {
+          while (in_circle(bd, bo, dest(rc), dest(oprev(rc)))) {
+            int t = oprev(rc);
+            delete_edge(q, rc);
+            rc = t;
+          }
+        }
+        if (!lvalid && !rvalid) {
+          break;
+        }
+        if (!lvalid || (rvalid && in_circle(dest(lc), origin(lc), origin(rc),
+                                            dest(rc)))) {
+          base = connect(q, rc, base ^ 1);
+        } else {
+          base = connect(q, base ^ 1, lc ^ 1);
+        }
+      }
+      return ldo;
+    }
+  };
+
+  // Builds the triangles from the faces of the divide and conquer over the
+  // distinct input points s, each paired with its index.
+  void build(std::vector<vertex> &s) {
+    builder b(s);
+    builder::pool q(0, 3*s.size());
+#ifdef _OPENMP
+    #pragma omp parallel
+    #pragma omp single
+#endif
+    b.build(0, s.size(), q, 0, 0);
+    int m = b.size();
+    std::vector<int> face(m, -1), rep;
+    v.reserve(6*s.size());
+    nb.reserve(6*s.size());
+    mark.reserve(2*s.size());
+    for (int e = 0; e < m; e++) {
+      if (b.origin(e) < 0 || face[e] >= 0) {
+        continue;
+      }
+      int f = b.lnext(e), g = b.lnext(f);
+      const point &a = s[b.origin(e)].first, &c = s[b.origin(f)].first;
+      const point &d = s[b.origin(g)].first;
+      if (b.lnext(g) == e && orient2d(a.x, a.y, c.x, c.y, d.x, d.y) > 0) {
+        int t = set_triangle(-1, s[b.origin(e)].second, s[b.origin(f)].second,
+                             s[b.origin(g)].second);
+        face[e] = face[f] = face[g] = t;
+        rep.push_back(e);
+      } else {  // The outer face, with the hull clockwise around it.
+        int h = e;
+        do {
+          face[h] = set_triangle(-1, s[b.origin(h)].second,
+                                 s[b.dest(h)].second, GHOST);
+          rep.push_back(h);
+          h = b.lnext(h);
+        } while (h != e);
+      }
+    }
+    for (int t = 0; t < (int)rep.size(); t++) {
+      int e = rep[t];
+      if (v[3*t + 2] != GHOST) {
+        int f = b.lnext(e), g = b.lnext(f);
+        nb[3*t] = face[f ^ 1];
+        nb[3*t + 1] = face[g ^ 1];
+        nb[3*t + 2] = face[e ^ 1];
+      } else {
+        nb[3*t] = face[b.lnext(e)];
+        nb[3*t + 1] = face[b.lprev(e)];
+        nb[3*t + 2] = face[e ^ 1];
+      }
+    }
+    last = 0;
+  }
+
+  // Returns the indices [lo, hi) in biased randomized insertion order: rounds
+  // of doubling size drawn from a random permutation, each sorted along a
+  // Hilbert curve over the bounding box of the points.
+  std::vector<int> brio_order(int lo, int hi) {
+    std::vector<int> res;
+    if (lo >= hi) {
+      return res;
+    }
+    double xmin = p[lo].x, xmax = xmin, ymin = p[lo].y, ymax = ymin;
+    for (int i = lo; i < hi; i++) {
+      xmin = std::min(xmin, p[i].x);
+      xmax = std::max(xmax, p[i].x);
+      ymin = std::min(ymin, p[i].y);
+      ymax = std::max(ymax, p[i].y);
+    }
+    const int bits = 16;
+    double sx = (xmax > xmin) ? ((1 << bits) - 1)/(xmax - xmin) : 0;
+    double sy = (ymax > ymin) ? ((1 << bits) - 1)/(ymax - ymin) : 0;
+    std::vector<std::pair<long long, int> > key(hi - lo);
+    for (int i = lo; i < hi; i++) {
+      key[i - lo] = std::make_pair(0LL, i);
+    }
+    std::random_shuffle(key.begin(), key.end());
+    for (int i = 0; i < hi - lo; i++) {
+      const point &q = p[key[i].second];
+      key[i].first = hilbert_order((int)((q.x - xmin)*sx),
+                                   (int)((q.y - ymin)*sy), bits);
+    }
+    int end = hi - lo, begin = end;
+    std::vector<int> bounds;
+    while (begin > 16) {
+      bounds.push_back(begin);
+      begin /= 2;
+    }
+    std::sort(key.begin(), key.begin() + begin);
+    for (int k = (int)bounds.size() - 1; k >= 0; k--) {
+      std::sort(key.begin() + begin, key.begin() + bounds[k]);
+      begin = bounds[k];
+    }
+    for (int i = 0; i < end; i++) {
+      res.push_back(key[i].second);
+    }
+    return res;
+  }
+
+ public:
+  delaunay_mesh() : stamp(0), last(0), seed(1) {}
+
+  template<class It>
+  delaunay_mesh(It lo, It hi) : p(lo, hi), stamp(0), last(0), seed(1) {
+    int n = p.size();
+    std::vector<vertex> s(n);
+    for (int i = 0; i < n; i++) {
+      s[i] = std::make_pair(p[i], i);
+    }
+    std::sort(s.begin(), s.end());
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+      if (m == 0 || s[i].first != s[m - 1].first) {
+        s[m++] = s[i];
+      }
+    }
+    s.resize(m);
+    int k = 2;
+    while (k < m && orient(s[0].second, s[1].second, s[k].first) == 0) {
+      k++;
+    }
+    if (k < m) {
+      build(s);
+    } else {
+      for (int i = 0; i < m; i++) {
+        pending.push_back(s[i].second);
+      }
+    }
+  }
+
+  const std::vector<point>& points() const { return p; }
+
+  int insert(const point &q) {
+    p.push_back(q);
+    return add(p.size() - 1);
+  }
+
+  template<class It>
+  void insert(It lo, It hi) {
+    int first = p.size();
+    p.insert(p.end(), lo, hi);
+    // Every insertion adds two triangles, counting ghost triangles.
+    v.reserve(6*p.size());
+    nb.reserve(6*p.size());
+    mark.reserve(2*p.size());
+    std::vector<int> order = brio_order(first, p.size());
+    for (int i = 0; i < (int)order.size(); i++) {
+      add(order[i]);
+    }
+  }
+
+  bool locate(const point &q, int res[3]) {
+    if (v.empty()) {
+      return false;
+    }
+    int t = walk(q);
+    last = t;
+    for (int k = 0; k < 3; k++) {
+      res[k] = v[3*t + k];
+    }
+    return res[2] != GHOST;
+  }
+
+  // Starting from the closest vertex of the triangle found by the walk, moves
+  // to any closer neighbor of the current vertex until there is none. In a
+  // Delaunay triangulation, every vertex other than the nearest has a closer
+  // neighbor, namely one whose Voronoi cell the segment towards q enters next.
+  int nearest(const point &q) {
+    int res = -1;
+    if (v.empty()) {
+      for (int i = 0; i < (int)pending.size(); i++) {
+        if (res < 0 || sqdist(p[pending[i]], q) < sqdist(p[res], q)) {
+          res = pending[i];
+        }
+      }
+      return res;
+    }
+    int t = walk(q), i = -1;
+    for (int k = 0; k < 3; k++) {
+      int a = v[3*t + k];
+      if (a != GHOST &&
+          (i < 0 || sqdist(p[a], q) < sqdist(p[v[3*t + i]], q))) {
+        i = k;
+      }
+    }
+    for (;;) {
+      // Visit the triangles around a counter-clockwise, starting from t.
+      int a = v[3*t + i], s = t, k = i, next = -1, next_k = 0;
+      double d = sqdist(p[a], q);
+      do {
+        int b = v[3*s + (k + 1) % 3];
+        if (b != GHOST && sqdist(p[b], q) < d) {
+          d = sqdist(p[b], q);
+          next = s;
+          next_k = (k + 1) % 3;
+        }
+        s = nb[3*s + (k + 1) % 3];
+        k = index_of(s, a);
+      } while (s != t);
+      if (next < 0) {
+        last = t;
+        return a;
+      }
+      t = next;
+      i = next_k;
+    }
+  }
+
+  // Returns the Voronoi diagram, with one vertex per triangle (at infinity for
+  // ghost triangles). Each cell lists the vertices of its site in
+  // counter-clockwise order, which begin and end at infinity for sites on the
+  // hull. Cells are empty for points that are not vertices.
+  voronoi_diagram voronoi() const {
+    int m = v.size() / 3;
+    voronoi_diagram res;
+    res.vertices.resize(m);
+    res.at_infinity.resize(m);
+    res.cells.resize(p.size());
+    std::vector<int> incident(p.size(), -1);
+    for (int t = 0; t < m; t++) {
+      const int *w = &v[3*t];
+      res.at_infinity[t] = (w[2] == GHOST);
+      if (w[2] == GHOST) {
+        const point &a = p[w[0]], &b = p[w[1]];
+        res.vertices[t] = point(a.y - b.y, b.x - a.x);
+      } else {
+        res.vertices[t] = circumcenter(p[w[0]], p[w[1]], p[w[2]]);
+      }
+      for (int k = 0; k < 3; k++) {
+        if (w[k] != GHOST) {
+          incident[w[k]] = t;
+        }
+      }
+    }
+    for (int a = 0; a < (int)p.size(); a++) {
+      int t = incident[a];
+      if (t < 0) {
+        continue;
+      }
+      // Start after a ghost triangle if there is one, so that an unbounded
+      // cell lists its two vertices at infinity at its ends.
+      int s = t;
+      do {
+        s = rotate(s, a);
+      } while (s != t && v[3*s + 2] != GHOST);
+      if (v[3*s + 2] == GHOST && v[3*rotate(s, a) + 2] == GHOST) {
+        s = rotate(s, a);
+      }
+      t = s;
+      do {
+        res.cells[a].push_back(s);
+        s = rotate(s, a);
+      } while (s != t);
+    }
+    return res;
+  }
+
+  std::vector<int> triangles() const {
+    std::vector<int> res;
+    for (int i = 0; i < (int)v.size(); i += 3) {
+      if (v[i + 2] != GHOST) {
+        res.insert(res.end(), v.begin() + i, v.begin() + i + 3);
+      }
+    }
+    return res;
+  }
+};
+
+/*** Example Usage and Output:
+
+Euclidean MST of length 6.65028: (0, 1) (1, 2) (0, 4) (1, 3)
+3000 points: delaunay_mesh build 0.00189209s, insert 0.00250912s
+3000 points: nearest along a path 0.00029397s, at 3000 random points 0.0073991s
+3000 points: euclidean_mst 0.00720596s, complete graph kruskal 0.728709s
+1000000 points: delaunay_mesh build 1.12796s, insert 1.25299s
+1000000 points: nearest along a path 0.211184s, at 3000 random points 0.622202s
+1000000 points: euclidean_mst 4.4509s
+
+***/
 
 #include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sys/time.h>
 using namespace std;
 
+double wall_time() {
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+double dist(const point &a, const point &b) {
+  return sqrt((a.x - b.x)*(a.x - b.x) + (a.y - b.y)*(a.y - b.y));
+}
+
+// Returns the total length of a minimum spanning tree of the complete graph,
+// using Prim's algorithm in O(n^2).
+double prim(const vector<point> &p) {
+  int n = p.size();
+  vector<double> d(n, 1e300);
+  vector<bool> done(n, false);
+  double total = 0;
+  for (int k = 0, u = 0; k < n; k++) {
+    done[u] = true;
+    int next = -1;
+    for (int v = 0; v < n; v++) {
+      if (!done[v]) {
+        d[v] = min(d[v], dist(p[u], p[v]));
+        if (next == -1 || d[v] < d[next]) {
+          next = v;
+        }
+      }
+    }
+    if (next != -1) {
+      total += d[next];
+    }
+    u = next;
+  }
+  return total;
+}
+
+void check_mst(const vector<point> &p, const vector<pair<int, int> > &mst,
+               double total) {
+  int n = p.size();
+  assert((int)mst.size() == max(n - 1, 0));
+  vector<int> root(n);
+  double sum = 0;
+  for (int i = 0; i < n; i++) {
+    root[i] = i;
+  }
+  for (int i = 0; i < (int)mst.size(); i++) {
+    int u = find_root(root, mst[i].first), v = find_root(root, mst[i].second);
+    assert(u != v);
+    root[u] = v;
+    sum += dist(p[mst[i].first], p[mst[i].second]);
+  }
+  assert(fabs(sum - total) <= 1e-6*(1 + total));
+  assert(fabs(prim(p) - total) <= 1e-6*(1 + total));
+}
+
+// Checks that no point lies strictly inside the circumcircle of any triangle.
+void check_empty_circles(vector<point> p) {
+  sort(p.begin(), p.end());
+  p.erase(unique(p.begin(), p.end()), p.end());
+  random_shuffle(p.begin(), p.end());
+  vector<int> t = delaunay_indices(p.begin(), p.end());
+  assert(!t.empty());
+  for (int i = 0; i < (int)t.size(); i += 3) {
+    point a = p[t[i]], b = p[t[i + 1]], c = p[t[i + 2]];
+    double o = orient2d(a.x, a.y, b.x, b.y, c.x, c.y);
+    assert(o != 0);
+    if (o < 0) {
+      swap(b, c);
+    }
+    for (int j = 0; j < (int)p.size(); j++) {
+      assert(incircle(a.x, a.y, b.x, b.y, c.x, c.y, p[j].x, p[j].y) <= 0);
+    }
+  }
+}
+
+// Checks that the triangles of a mesh are counter-clockwise, have empty
+// circumcircles, and use every distinct point of p.
+void check_mesh(const vector<point> &p, const delaunay_mesh &m) {
+  vector<int> t = m.triangles();
+  vector<bool> used(p.size(), false);
+  for (int i = 0; i < (int)t.size(); i += 3) {
+    point a = p[t[i]], b = p[t[i + 1]], c = p[t[i + 2]];
+    assert(orient2d(a.x, a.y, b.x, b.y, c.x, c.y) > 0);
+    for (int j = 0; j < (int)p.size(); j++) {
+      assert(incircle(a.x, a.y, b.x, b.y, c.x, c.y, p[j].x, p[j].y) <= 0);
+    }
+    used[t[i]] = used[t[i + 1]] = used[t[i + 2]] = true;
+  }
+  vector<point> distinct(p), vertices;
+  sort(distinct.begin(), distinct.end());
+  distinct.erase(unique(distinct.begin(), distinct.end()), distinct.end());
+  for (int i = 0; i < (int)p.size(); i++) {
+    if (used[i]) {
+      vertices.push_back(p[i]);
+    }
+  }
+  sort(vertices.begin(), vertices.end());
+  assert(vertices == distinct);
+}
+
+// Returns the triangles of t with each rotated to start at its least index.
+vector<vector<int> > canonical(const vector<int> &t) {
+  vector<vector<int> > res;
+  for (int i = 0; i < (int)t.size(); i += 3) {
+    vector<int> u(t.begin() + i, t.begin() + i + 3);
+    rotate(u.begin(), min_element(u.begin(), u.end()), u.end());
+    res.push_back(u);
+  }
+  sort(res.begin(), res.end());
+  return res;
+}
+
+vector<point> random_points(int n, int range) {
+  vector<point> p;
+  for (int i = 0; i < n; i++) {
+    p.push_back(point(rand() % range, rand() % range));
+  }
+  return p;
+}
+
 int main() {
   vector<point> v;
   v.push_back(point(1, 3));
@@ -604,5 +1816,232 @@ int main() {
   t.push_back(triangle(point(1, 2), point(0, 0), point(2, 1)));
   t.push_back(triangle(point(1, 3), point(1, 2), point(2, 1)));
   assert(delaunay_triangulation(v.begin(), v.end()) == t);
+  vector<pair<int, int> > mst;
+  double total = euclidean_mst(v.begin(), v.end(), mst);
+  cout << "Euclidean MST of length " << total << ":";
+  for (int i = 0; i < (int)mst.size(); i++) {
+    cout << " (" << mst[i].first << ", " << mst[i].second << ")";
+  }
+  cout << endl;
+  check_mst(v, mst, total);
+
+  for (int n = 0; n <= 300; n += (n < 20) ? 1 : 70) {
+    // Small ranges give many duplicate and collinear points.
+    vector<point> p = random_points(n, (n % 3 == 0) ? 1000000 : 8);
+    check_mst(p, mst, euclidean_mst(p.begin(), p.end(), mst));
+    vector<point> line;
+    for (int i = 0; i < n; i++) {
+      line.push_back(point(rand() % 10, 3*(rand() % 10) + 1));
+      line.back().x = line.back().y*0.5;
+    }
+    check_mst(line, mst, euclidean_mst(line.begin(), line.end(), mst));
+  }
+
+  { // Square grids and points on a circle, which are cocircular in many ways.
+    vector<point> grid, circle;
+    for (int i = 0; i < 12; i++) {
+      for (int j = 0; j < 12; j++) {
+        grid.push_back(point(i*0.1, j*0.1));
+      }
+    }
+    check_empty_circles(grid);
+    int pythagorean[][2] = {{0, 65}, {16, 63}, {25, 60}, {33, 56}, {39, 52}};
+    for (int i = 0; i < 5; i++) {
+      for (int k = 0; k < 4; k++) {
+        int u = pythagorean[i][0], v = pythagorean[i][1];
+        int sx = (k & 1) ? -1 : 1, sy = (k & 2) ? -1 : 1;
+        circle.push_back(point(sx*u, sy*v));
+        circle.push_back(point(sy*v, sx*u));
+      }
+    }
+    check_empty_circles(circle);
+    for (int k = 0; k < 50; k++) {
+      check_empty_circles(random_points(100, 10));
+    }
+  }
+
+  for (int k = 0; k < 60; k++) {
+    int n = 3 + rand() % 150, range = (k % 3 == 0) ? 5 : 1000000;
+    vector<point> p = random_points(n, (k % 3 == 1) ? 30 : range);
+    delaunay_mesh a(p.begin(), p.end()), b, c(p.begin(), p.begin() + n/2);
+    b.insert(p.begin(), p.end());
+    for (int i = n/2; i < n; i++) {
+      int j = c.insert(p[i]);
+      assert(j <= i && c.points()[j] == p[i]);
+    }
+    check_mesh(p, a);
+    check_mesh(p, b);
+    check_mesh(p, c);
+    if (k % 3 == 2) {  // With no four points cocircular, the result is unique.
+      vector<vector<int> > t = canonical(delaunay_indices(p.begin(), p.end()));
+      assert(canonical(a.triangles()) == t);
+      assert(canonical(b.triangles()) == t && canonical(c.triangles()) == t);
+    }
+    for (int i = 0; i < 50; i++) {
+      point q(rand() % (range + 4) - 2 + 0.5, rand() % (range + 4) - 2);
+      int w[3];
+      if (c.locate(q, w)) {
+        for (int e = 0; e < 3; e++) {
+          const point &u = p[w[e]], &v = p[w[(e + 1) % 3]];
+          assert(orient2d(u.x, u.y, v.x, v.y, q.x, q.y) >= 0);
+        }
+      } else {
+        const point &u = p[w[0]], &v = p[w[1]];
+        assert(w[2] == -1 && orient2d(u.x, u.y, v.x, v.y, q.x, q.y) > 0);
+      }
+    }
+  }
+  { // Collinear points are held back until a point off their line arrives.
+    vector<point> p;
+    for (int i = 0; i < 10; i++) {
+      p.push_back(point(i, 2*i));
+    }
+    p.push_back(point(3, 6));
+    delaunay_mesh m(p.begin(), p.end());
+    int w[3];
+    assert(m.triangles().empty() && !m.locate(point(0, 0), w));
+    assert(m.insert(point(3, 6)) == 3);
+    p.push_back(point(3, 6));
+    p.push_back(point(5, 0));
+    m.insert(p.back());
+    check_mesh(p, m);
+    assert(m.triangles().size() == 3*9);
+  }
+  { // The cell of the center of a square is the diamond between the sides.
+    vector<point> p;
+    p.push_back(point(0, 0));
+    p.push_back(point(2, 0));
+    p.push_back(point(2, 2));
+    p.push_back(point(0, 2));
+    p.push_back(point(1, 1));
+    delaunay_mesh m(p.begin(), p.end());
+    voronoi_diagram d = m.voronoi();
+    vector<point> c;
+    for (int i = 0; i < (int)d.cells[4].size(); i++) {
+      assert(!d.at_infinity[d.cells[4][i]]);
+      c.push_back(d.vertices[d.cells[4][i]]);
+    }
+    rotate(c.begin(), min_element(c.begin(), c.end()), c.end());
+    assert(c.size() == 4 && c[0] == point(0, 1) && c[1] == point(1, 0));
+    assert(c[2] == point(2, 1) && c[3] == point(1, 2));
+    for (int i = 0; i < 4; i++) {
+      const vector<int> &e = d.cells[i];
+      assert(e.size() == 4 && d.at_infinity[e[0]] && d.at_infinity[e[3]]);
+      assert(!d.at_infinity[e[1]] && !d.at_infinity[e[2]]);
+    }
+    assert(m.nearest(point(1.9, 0.5)) == 1 && m.nearest(point(1.2, 1.3)) == 4);
+    assert(m.nearest(point(-5, 7)) == 3);
+  }
+  for (int k = 0; k < 6; k++) {
+    vector<point> p = random_points(300, (k < 3) ? 12 : 1000000);
+    delaunay_mesh m(p.begin() + 1, p.end());
+    m.insert(p[0]);
+    p.push_back(p[0]);
+    p.erase(p.begin());
+    // Voronoi vertices are as far from their sites as from the nearest site.
+    voronoi_diagram d = m.voronoi();
+    for (int i = 0; i < (int)p.size(); i++) {
+      const vector<int> &e = d.cells[i];
+      for (int j = 0; j < (int)e.size(); j++) {
+        if (d.at_infinity[e[j]]) {
+          assert(j == 0 || j + 1 == (int)e.size());
+          continue;
+        }
+        const point &c = d.vertices[e[j]];
+        double r = sqdist(c, p[i]);
+        for (int l = 0; l < (int)p.size(); l++) {
+          assert(sqdist(c, p[l]) >= r*(1 - 1e-9));
+        }
+      }
+    }
+    // Query along a path with small steps and also at random.
+    double range = (k < 3) ? 12 : 1000000;
+    point q(range/2, range/2);
+    for (int i = 0; i < 2000; i++) {
+      if (i % 2 == 0) {
+        q.x += range*((double)rand()/RAND_MAX - 0.5)/50;
+        q.y += range*((double)rand()/RAND_MAX - 0.5)/50;
+      }
+      point r = (i % 2 == 0) ? q : point(range*((double)rand()/RAND_MAX*3 - 1),
+                                         range*((double)rand()/RAND_MAX*3 - 1));
+      double best = sqdist(p[0], r);
+      for (int j = 1; j < (int)p.size(); j++) {
+        best = min(best, sqdist(p[j], r));
+      }
+      assert(sqdist(p[m.nearest(r)], r) == best);
+    }
+  }
+
+  int sizes[] = {3000, 1000000};
+  for (int k = 0; k < 2; k++) {
+    int n = sizes[k];
+    vector<point> p;
+    for (int i = 0; i < n; i++) {
+      p.push_back(point((double)rand()/RAND_MAX, (double)rand()/RAND_MAX));
+    }
+    double start = wall_time();
+    total = euclidean_mst(p.begin(), p.end(), mst);
+    double emst_time = wall_time() - start;
+    start = wall_time();
+    delaunay_mesh built(p.begin(), p.end());
+    double build_time = wall_time() - start;
+    start = wall_time();
+    delaunay_mesh inserted;
+    inserted.insert(p.begin(), p.end());
+    double insert_time = wall_time() - start;
+    assert(built.triangles().size() == inserted.triangles().size());
+    cout << n << " points: delaunay_mesh build " << build_time << "s, insert "
+         << insert_time << "s" << endl;
+    vector<point> path(n), scattered(3000);
+    path[0] = point(0.5, 0.5);
+    for (int i = 0; i < n; i++) {
+      if (i > 0) {
+        path[i].x = path[i - 1].x + ((double)rand()/RAND_MAX - 0.5)*1e-3;
+        path[i].y = path[i - 1].y + ((double)rand()/RAND_MAX - 0.5)*1e-3;
+      }
+    }
+    for (int i = 0; i < 3000; i++) {
+      scattered[i] = point((double)rand()/RAND_MAX, (double)rand()/RAND_MAX);
+    }
+    start = wall_time();
+    for (int i = 0; i < n; i++) {
+      built.nearest(path[i]);
+    }
+    double path_time = wall_time() - start;
+    start = wall_time();
+    for (int i = 0; i < 3000; i++) {
+      built.nearest(scattered[i]);
+    }
+    cout << n << " points: nearest along a path " << path_time
+         << "s, at 3000 random points " << wall_time() - start << "s" << endl;
+    cout << n << " points: euclidean_mst " << emst_time << "s";
+    if (n <= 3000) {
+      // All n(n - 1)/2 pairs, as input to kruskal() of section 4.4.2.
+      start = wall_time();
+      vector<pair<double, pair<int, int> > > edges;
+      for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+          edges.push_back(make_pair(dist(p[i], p[j]), make_pair(i, j)));
+        }
+      }
+      sort(edges.begin(), edges.end());
+      vector<int> root(n);
+      double sum = 0;
+      for (int i = 0; i < n; i++) {
+        root[i] = i;
+      }
+      for (int i = 0; i < (int)edges.size(); i++) {
+        int u = find_root(root, edges[i].second.first);
+        int v = find_root(root, edges[i].second.second);
+        if (u != v) {
+          root[u] = v;
+          sum += edges[i].first;
+        }
+      }
+      assert(fabs(sum - total) <= 1e-9*total);
+      cout << ", complete graph kruskal " << wall_time() - start << "s";
+    }
+    cout << endl;
+  }
   return 0;
 }